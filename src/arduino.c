@@ -49,11 +49,29 @@ static int arduino_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       continue;
     }
 
+    if(str_starts(extended_param, "blocksize=")) {
+      if(stk500_parse_blocksize(pgm, extended_param) < 0) {
+        rv = -1;
+        break;
+      }
+      continue;
+    }
+
     if(str_eq(extended_param, "noautoreset")) {
       my.autoreset = false;
       continue;
     }
 
+    if(str_eq(extended_param, "fastsync")) {
+      my.fastsync = true;
+      continue;
+    }
+
+    if(str_eq(extended_param, "autobaud")) {
+      my.autobaud = true;
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rv = LIBAVRDUDE_EXIT_OK;
@@ -64,9 +82,12 @@ static int arduino_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       rv = -1;
     }
     msg_error("%s -c %s extended options:\n", progname, pgmid);
-    msg_error("  -x attempts=<n> Specify the number <n> of connection retry attempts\n");
-    msg_error("  -x noautoreset  Don't toggle RTS/DTR lines on port open to prevent a hardware reset\n");
-    msg_error("  -x help         Show this help menu and exit\n");
+    msg_error("  -x attempts=<n>  Specify the number <n> of connection retry attempts\n");
+    msg_error("  -x blocksize=<n> Bootloader takes blocks of <n> bytes (multiple pages)\n");
+    msg_error("  -x noautoreset   Don't toggle RTS/DTR lines on port open to prevent a hardware reset\n");
+    msg_error("  -x fastsync      Probe for the bootloader right after reset instead of waiting\n");
+    msg_error("  -x autobaud      Use the fastest baud the bootloader answers at, up to -b if given\n");
+    msg_error("  -x help          Show this help menu and exit\n");
     return rv;
   }
   return rv;
@@ -111,6 +132,41 @@ static int arduino_read_sig_bytes(const PROGRAMMER *pgm, const AVRPART *p, const
   return 3;
 }
 
+#define ARDUINO_AUTOBAUD_MS 300 // Time a bootloader has to answer after reset at a candidate baud
+
+/*
+ * Reset the board at each candidate baud and probe for the bootloader; the
+ * first baud it answers at is remembered in the target cache and tried
+ * first next time. Returns 0 if the bootloader is in sync, -1 otherwise.
+ */
+static int arduino_autobaud(PROGRAMMER *pgm, const char *port) {
+  long bauds[TGTCACHE_NBAUDS];
+  const AVRPART *part = partdesc? locate_part(part_list, partdesc): NULL;
+
+  tgtcache_target(pgm, part, port);
+  int n = tgtcache_bauds(pgm->baudrate, bauds);
+
+  for(int i = 0; i < n; i++) {
+    if(serial_setparams(&pgm->fd, bauds[i], SERIAL_8N1) < 0) {
+      pmsg_notice2("%s(): port does not support %ld baud\n", __func__, bauds[i]);
+      continue;
+    }
+    serial_set_dtr_rts(&pgm->fd, 1);
+    usleep(100);
+    serial_set_dtr_rts(&pgm->fd, 0);
+    if(stk500_fastsync(pgm, ARDUINO_AUTOBAUD_MS) == 0) {
+      pmsg_notice("bootloader answers at %ld baud\n", bauds[i]);
+      pgm->baudrate = bauds[i];
+      tgtcache_put("baud", str_ccprintf("%ld", bauds[i]));
+      return 0;
+    }
+    pmsg_notice2("%s(): no answer at %ld baud\n", __func__, bauds[i]);
+  }
+  pmsg_error("bootloader does not answer at any baud%s\n", pgm->baudrate? " up to -b": "");
+
+  return -1;
+}
+
 static int arduino_open(PROGRAMMER *pgm, const char *port) {
   if(pgm->bitclock)
     pmsg_warning("-c %s does not support adjustable bitclock speed; ignoring -B\n", pgmid);
@@ -132,8 +188,13 @@ static int arduino_open(PROGRAMMER *pgm, const char *port) {
      * calls in quick succession fails:
      *
      * avrdude -c arduino -qqp m328p -U x.hex; avrdude -c arduino -qqp m328p -U x.hex
+     *
+     * With -x fastsync a short discharge suffices as stk500_getsync() resets
+     * the board again should the probes find no bootloader
      */
-    usleep(250*1000);
+    usleep(my.fastsync || my.autobaud? 20*1000: 250*1000);
+    if(my.autobaud)             // Resets the board for each baud it tries
+      return arduino_autobaud(pgm, port);
     // Pull the RTS/DTR line low to reset AVR
     serial_set_dtr_rts(&pgm->fd, 1);
     // Max 100 us: charging a cap longer creates a high reset spike above Vcc
@@ -141,8 +202,14 @@ static int arduino_open(PROGRAMMER *pgm, const char *port) {
     // Set the RTS/DTR line back to high, so direct connection to reset works
     serial_set_dtr_rts(&pgm->fd, 0);
 
-    usleep(100*1000);
+    // Optiboot answers within a few tens of ms after reset and waits 1 s for input
+    if(my.fastsync && stk500_fastsync(pgm, 500) == 0)
+      return 0;
+    if(!my.fastsync)
+      usleep(100*1000);
   }
+  if(my.autobaud)
+    pmsg_warning("-x autobaud needs to reset the board; ignoring it with -x noautoreset\n");
   // Drain any extraneous input
   stk500_drain(pgm, 0);
 
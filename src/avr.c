@@ -28,6 +28,11 @@
 #include <sys/time.h>
 #include <time.h>
 
+#if defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
 #include "avrdude.h"
 #include "libavrdude.h"
 
@@ -42,8 +47,11 @@ int avr_tpi_poll_nvmbsy(const PROGRAMMER *pgm) {
 
   pmsg_trace2("%s(%s)\n", __func__, pgmid);
 
+  int span = avr_span_detail("NVM busy poll", NULL);
+
   cmd = TPI_CMD_SIN | TPI_SIO_ADDR(TPI_IOREG_NVMCSR);
   (void) pgm->cmd_tpi(pgm, &cmd, 1, &res, 1);
+  avr_span_end(span, -1);
   return (res & TPI_IOREG_NVMCSR_NVMBSY);
 }
 
@@ -103,6 +111,60 @@ int avr_tpi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   }
 }
 
+/*
+ * Does an ISP part understand the Poll RDY/BSY command 0xF0 0x00 0x00 0x00?
+ * Parts whose flash mode byte (AVR068) selects RDY/BSY polling do.
+ */
+int avr_isp_has_rdybsy(const AVRPART *p) {
+  const AVRMEM *fl = avr_locate_flash(p);
+
+  return fl && (fl->mode & 1? fl->mode & 0x40: fl->mode & 0x08);
+}
+
+/*
+ * Wait for an ISP part to finish a chip erase or write: if the part supports
+ * it poll RDY/BSY with delay us only as timeout, otherwise sleep for delay
+ * us; what names the operation in trace spans and debug messages. Returns 0
+ * if the device reported ready and 1 otherwise.
+ */
+int avr_isp_ready_wait(const PROGRAMMER *pgm, const AVRPART *p, int delay, const char *what) {
+  unsigned char cmd[4] = { 0xf0, 0, 0, 0 }, res[4];
+  uint64_t start = avr_ustimestamp();
+
+  if(!pgm->cmd || !avr_isp_has_rdybsy(p)) {
+    avr_usleep(delay);
+    return 1;
+  }
+
+  int span = avr_span_detail(what, NULL), ret = 1;
+
+  do {
+    usleep(delay/32 + 100);     // Don't flood the programmer with polls
+    if(pgm->cmd(pgm, cmd, res) < 0)
+      break;
+    if(!(res[3] & 1)) {
+      ret = 0;
+      break;
+    }
+  } while(avr_ustimestamp() - start < (uint64_t) delay);
+
+  if(ret) {                     // Programmer or part did not tell: wait out the rest
+    uint64_t gone = avr_ustimestamp() - start;
+
+    if(gone < (uint64_t) delay)
+      usleep(delay - gone);
+  } else
+    pmsg_trace("%s(): %s done after %.2f ms\n", __func__, what, (avr_ustimestamp() - start)/1000.0);
+  avr_span_end(span, -1);
+
+  return ret;
+}
+
+// Wait for an ISP chip erase to finish, see avr_isp_ready_wait()
+int avr_isp_erase_wait(const PROGRAMMER *pgm, const AVRPART *p) {
+  return avr_isp_ready_wait(pgm, p, p->chip_erase_delay, "chip erase poll");
+}
+
 // TPI program enable sequence
 int avr_tpi_program_enable(const PROGRAMMER *pgm, const AVRPART *p, unsigned char guard_time) {
   int err, retry;
@@ -332,8 +394,17 @@ int avr_mem_hiaddr(const AVRMEM *mem) {
   if(cx->avr_disableffopt || !mem_is_in_flash(mem))
     return mem->size;
 
+  // Skip trailing 0xff a machine word at a time
+  int n = mem->size;
+
+  for(uint64_t w; n >= 8; n -= 8) {
+    memcpy(&w, mem->buf + n - 8, sizeof w);
+    if(w != ~(uint64_t) 0)
+      break;
+  }
+
   // Return smallest even memory size outsize beyond which only 0xff reside
-  for(int i = mem->size - 1; i >= 0; i--) {
+  for(int i = n - 1; i >= 0; i--) {
     if(mem->buf[i] != 0xff) {
       ret = i + 1 + !(i & 1);   // Ensure even return
       goto ok;
@@ -345,10 +416,56 @@ ok:
   return ret;
 }
 
+/*
+ * Return a freshly allocated bitmap with one bit per page of pgsize bytes
+ * that is set when any of the first size bytes of that page in mem is
+ * allocated; the tag bitset is scanned a machine word at a time. Test pages
+ * with page_is_allocated(map, k) and free the map with mmt_free().
+ */
+unsigned char *avr_page_map(const AVRMEM *mem, int pgsize, int size) {
+  if(pgsize < 1)
+    pgsize = 1;
+  if(size < 0)
+    size = 0;
+
+  // Map covers all of size but only pages within mem can be allocated
+  unsigned char *map = mmt_malloc((size + pgsize - 1)/pgsize/8 + 1);
+
+  if(size > mem->size)
+    size = mem->size;
+  int npages = (size + pgsize - 1)/pgsize;
+
+  for(int pg = 0; pg < npages; pg++)
+    if(tag_any(mem->tags, pg*pgsize, pg == npages - 1? size - pg*pgsize: pgsize))
+      map[pg/8] |= 1 << (pg%8);
+
+  return map;
+}
+
+/*
+ * Paged transfer of page addr failed after earlier pages had succeeded:
+ * resynchronise the programmer link once more within the budget of tries
+ * and return 0 if the page should be retried, -1 otherwise
+ */
+static int avr_paged_resync(const PROGRAMMER *pgm, const AVRMEM *mem, unsigned int addr, int *tries) {
+  if(!pgm->resync || ++*tries > 3)
+    return -1;
+
+  pmsg_warning("paged access to %s failed at 0x%04x; resynchronising and retrying\n", mem->desc, addr);
+  if(pgm->resync(pgm) < 0) {
+    pmsg_warning("unable to resynchronise with programmer\n");
+    return -1;
+  }
+
+  return 0;
+}
+
 /*
  * Read the entirety of the specified memory into the corresponding buffer of
  * the avrpart pointed to by p. If v is non-NULL, verify against v's memory
- * area, only those cells that are tagged TAG_ALLOCATED are verified.
+ * area, only those cells that are tagged TAG_ALLOCATED are verified. While
+ * reading all of a paged or byte-wise memory avr_read_mem() tells
+ * cx->avr_read_hook(mem, upto), if set, that mem->buf[0, upto) is final.
  *
  * Return the number of bytes read, or < 0 if an error occurs.
  */
@@ -363,9 +480,45 @@ int avr_read(const PROGRAMMER *pgm, const AVRPART *p, const char *memstr, const
   return avr_read_mem(pgm, p, mem, v);
 }
 
+#define AVR_MULTI_RANGES 32     // Ranges per scatter-gather call; progress is reported in between
+
+/*
+ * Load the runs of pages in map, at most maxrun pages each, through
+ * pgm->paged_load_multi() in lists of up to AVR_MULTI_RANGES ranges
+ */
+static int load_pages_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  const unsigned char *map, int maxrun, int npages) {
+
+  int pgsz = mem->page_size, npg = mem->size/pgsz, nr = 0, ndone = 0, rc = 0;
+  Avr_range r[AVR_MULTI_RANGES];
+
+  for(int k = 0; k <= npg && rc >= 0; k++) {
+    if(k < npg && page_is_allocated(map, k)) {
+      if(nr && r[nr - 1].addr + r[nr - 1].n == (unsigned) (k*pgsz) && r[nr - 1].n < (unsigned) (maxrun*pgsz)) {
+        r[nr - 1].n += pgsz;
+        continue;
+      }
+      if(nr < AVR_MULTI_RANGES) {
+        r[nr].addr = k*pgsz, r[nr++].n = pgsz;
+        continue;
+      }
+    }
+    if(nr && (k == npg || page_is_allocated(map, k))) { // List full or end of memory
+      if((rc = avr_paged_load_multi(pgm, p, mem, pgsz, r, nr)) >= 0) {
+        ndone += rc/pgsz;
+        report_progress(ndone, npages, NULL);
+      }
+      nr = 0;
+      if(k < npg)
+        k--;                    // Page k starts the next list
+    }
+  }
+
+  return rc;
+}
+
 int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, const AVRPART *v) {
   unsigned long i, lastaddr;
-  unsigned char cmd[4];
   AVRMEM *vmem = NULL;
   int rc;
 
@@ -392,17 +545,29 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
     // Setup for read (NOOP)
     avr_tpi_setup_rw(pgm, mem, 0, TPI_NVMCMD_NO_OPERATION);
 
-    // Load bytes
+    unsigned char sld[TPI_BATCH_MAX];
+
+    memset(sld, TPI_CMD_SLD_PI, sizeof sld);
+
+    // Load bytes, runs of allocated bytes in one batch if the programmer can
     for(lastaddr = i = 0; i < (unsigned long) mem->size; i++) {
-      if(vmem == NULL || (vmem->tags[i] & TAG_ALLOCATED) != 0) {
+      if(vmem == NULL || tag_isset(vmem->tags, i)) {
+        unsigned long n = 1;
+
         if(lastaddr != i) {
           // Need to setup new address
           avr_tpi_setup_rw(pgm, mem, i, TPI_NVMCMD_NO_OPERATION);
           lastaddr = i;
         }
-        cmd[0] = TPI_CMD_SLD_PI;
-        rc = pgm->cmd_tpi(pgm, cmd, 1, mem->buf + i, 1);
-        lastaddr++;
+        if(pgm->cmd_tpi_batch) {
+          while(n < TPI_BATCH_MAX && i + n < (unsigned long) mem->size &&
+            (vmem == NULL || tag_isset(vmem->tags, i + n)))
+            n++;
+          rc = pgm->cmd_tpi_batch(pgm, sld, 1, mem->buf + i, 1, n);
+        } else {
+          rc = pgm->cmd_tpi(pgm, sld, 1, mem->buf + i, 1);
+        }
+        lastaddr += n;
         if(rc == -1) {
           pmsg_error("unable to read address 0x%04lx\n", i);
           report_progress(1, -1, NULL);
@@ -410,6 +575,7 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
           led_clr(pgm, LED_PGM);
           return -1;
         }
+        i += n - 1;
       }
       report_progress(i, mem->size, NULL);
     }
@@ -418,6 +584,16 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
     return avr_mem_hiaddr(mem);
   }
 
+  // Small unpaged memories, eg, all fuses, in one block read if the programmer can
+  if(pgm->range_load && pgm->paged_load && mem->page_size <= 1 && mem->size > 1 &&
+    mem->size <= 256 && mem_is_fuses(mem)) {
+    if(avr_paged_load(pgm, p, mem, mem->size, 0, mem->size) >= 0) {
+      led_clr(pgm, LED_PGM);
+      return avr_mem_hiaddr(mem);
+    }
+    // Else: fall back to byte-at-a-time read below
+  }
+
   // HW programmers need a page size > 1, bootloader typ only offer paged r/w
   if((pgm->paged_load && mem->page_size > 1 && mem->size%mem->page_size == 0) ||
     (is_spm(pgm) && avr_has_paged_access(pgm, p, mem))) {
@@ -426,40 +602,56 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
     unsigned int pageaddr;
     unsigned int npages, nread;
 
-    // Quickly scan number of pages to be written to first
-    for(pageaddr = 0, npages = 0; pageaddr < (unsigned int) mem->size; pageaddr += mem->page_size) {
-      // Check whether this page must be read
-      for(i = pageaddr; i < pageaddr + mem->page_size; i++) {
-        // No verify: read everything; verify: only read needed pages in input file
-        if(vmem == NULL || (mem->tags[i] & TAG_ALLOCATED) != 0) {
-          npages++;
-          break;
-        }
-      }
+    // No verify: read everything; verify: only read needed pages in input file
+    unsigned char *map = vmem? avr_page_map(vmem, mem->page_size, mem->size): NULL;
+
+    for(pageaddr = 0, npages = 0; pageaddr < (unsigned int) mem->size; pageaddr += mem->page_size)
+      if(!map || page_is_allocated(map, pageaddr/mem->page_size))
+        npages++;
+
+    // Programmers that can stream consecutive pages receive runs of needed pages in one call
+    int maxrun = avr_load_maxrun(pgm, mem);
+
+    // Scatter-gather programmers receive lists of the runs of needed pages
+    if(map && pgm->paged_load_multi && load_pages_multi(pgm, p, mem, map, maxrun, npages) >= 0) {
+      mmt_free(map);
+      led_clr(pgm, LED_PGM);
+      return avr_mem_hiaddr(mem);
     }
 
-    for(pageaddr = 0, failure = 0, nread = 0;
-      !failure && pageaddr < (unsigned int) mem->size; pageaddr += mem->page_size) {
+    int tries = 0;
 
-      // Check whether this page must be read
-      for(i = pageaddr, need_read = 0; i < pageaddr + mem->page_size; i++) {
-        // No verify: read everything; verify: only read needed pages in input file
-        if(vmem == NULL || (vmem->tags[i] & TAG_ALLOCATED) != 0) {
-          need_read = 1;
+    for(pageaddr = 0, failure = 0, nread = 0; !failure && pageaddr < (unsigned int) mem->size;) {
+      int run;
+
+      for(run = 0; run < maxrun && pageaddr + run*mem->page_size < (unsigned int) mem->size; run++) {
+        need_read = !map || page_is_allocated(map, pageaddr/mem->page_size + run);
+        if(!need_read)
           break;
-        }
       }
-      if(need_read) {
-        rc = pgm->paged_load(pgm, p, mem, mem->page_size, pageaddr, mem->page_size);
-        if(rc < 0)
+
+      if(run) {
+        rc = avr_paged_load(pgm, p, mem, mem->page_size, pageaddr, run*mem->page_size);
+        if(rc < 0) {
+          // Mid-memory glitch? Retry from the failed page after resync
+          if(nread && avr_paged_resync(pgm, mem, pageaddr, &tries) == 0)
+            continue;
           // Paged load failed, fall back to byte-at-a-time read below
           failure = 1;
-        nread++;
+        } else {
+          tries = 0;            // Only give up after repeated glitches in a row
+          if(cx->avr_read_hook && !map)
+            cx->avr_read_hook(mem, pageaddr + run*mem->page_size);
+        }
+        nread += run;
         report_progress(nread, npages, NULL);
+        pageaddr += run*mem->page_size;
       } else {
         pmsg_debug("%s(): skipping page %u: no interesting data\n", __func__, pageaddr/mem->page_size);
+        pageaddr += mem->page_size;
       }
     }
+    mmt_free(map);
     if(!failure) {
       led_clr(pgm, LED_PGM);
       return avr_mem_hiaddr(mem);
@@ -479,7 +671,7 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
   }
 
   for(i = 0; i < (unsigned long) mem->size; i++) {
-    if(vmem == NULL || (vmem->tags[i] & TAG_ALLOCATED) != 0) {
+    if(vmem == NULL || tag_isset(vmem->tags, i)) {
       rc = pgm->read_byte(pgm, p, mem, i, mem->buf + i);
       if(rc != LIBAVRDUDE_SUCCESS) {
         pmsg_error("unable to read byte at address 0x%04lx\n", i);
@@ -497,6 +689,8 @@ int avr_read_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, con
         return LIBAVRDUDE_SOFTFAIL;
       }
     }
+    if(cx->avr_read_hook && !vmem && (i + 1)%256 == 0)
+      cx->avr_read_hook(mem, i + 1);
     report_progress(i, mem->size, NULL);
   }
 
@@ -551,9 +745,10 @@ int avr_write_page(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, u
 
   /*
    * Since we don't know what voltage the target AVR is powered by, be
-   * conservative and delay the max amount the spec says to wait
+   * conservative and delay the max amount the spec says to wait unless the
+   * part can tell through RDY/BSY when it is done
    */
-  usleep(mem->max_write_delay);
+  avr_isp_ready_wait(pgm, p, mem->max_write_delay, "page write poll");
 
   led_clr(pgm, LED_PGM);
   return 0;
@@ -565,23 +760,60 @@ error:
 }
 
 
-// Return us since first call
-uint64_t avr_ustimestamp() {
-  struct timeval tv;
+/*
+ * Monotonic time in us from an arbitrary origin; unlike the wall clock it
+ * does not jump when the system time is set or stepped by NTP, so timeouts
+ * and elapsed times stay correct. On Linux clock_gettime() is served by the
+ * vDSO without entering the kernel. If coarse is set, a cheaper clock with a
+ * resolution of a few ms is used where there is one on the same time line.
+ */
+static uint64_t avr_monotonic_us(int coarse) {
+#if defined(WIN32)
+  LARGE_INTEGER cnt;
 
-  memset(&tv, 0, sizeof tv);
-  if(gettimeofday(&tv, NULL) == 0) {
-    uint64_t now;
+  (void) coarse;
+  if(!cx->avr_tickfreq) {
+    LARGE_INTEGER freq;
 
-    now = tv.tv_sec*1000000ULL + tv.tv_usec;
-    if(!cx->avr_epoch_init) {
-      cx->avr_epoch = now;
-      cx->avr_epoch_init = 1;
-    }
-    return now - cx->avr_epoch;
+    cx->avr_tickfreq = QueryPerformanceFrequency(&freq) && freq.QuadPart > 0? (uint64_t) freq.QuadPart: 1;
   }
+  if(cx->avr_tickfreq > 1 && QueryPerformanceCounter(&cnt)) {
+    uint64_t c = cnt.QuadPart, f = cx->avr_tickfreq;
 
-  return 0;
+    return c/f*1000000ULL + c%f*1000000ULL/f;
+  }
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+#if defined(CLOCK_MONOTONIC_COARSE)
+  if(coarse && clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0)
+    return ts.tv_sec*1000000ULL + ts.tv_nsec/1000;
+#else
+  (void) coarse;
+#endif
+  if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return ts.tv_sec*1000000ULL + ts.tv_nsec/1000;
+#else
+  (void) coarse;
+#endif
+
+  struct timeval tv;            // Last resort: wall clock
+
+  return gettimeofday(&tv, NULL) == 0? tv.tv_sec*1000000ULL + tv.tv_usec: 0;
+}
+
+static uint64_t avr_since_epoch(uint64_t now) {
+  if(!cx->avr_epoch_init) {
+    cx->avr_epoch = now;
+    cx->avr_epoch_init = 1;
+  }
+
+  return now > cx->avr_epoch? now - cx->avr_epoch: 0;
+}
+
+// Return us since first call
+uint64_t avr_ustimestamp() {
+  return avr_since_epoch(avr_monotonic_us(0));
 }
 
 // Return ms since first call to avr_ustimestamp() above
@@ -589,11 +821,388 @@ uint64_t avr_mstimestamp() {
   return avr_ustimestamp()/1000;
 }
 
+// Same as avr_mstimestamp() but cheaper and with a resolution of only a few ms, eg, for LEDs
+uint64_t avr_mstimestamp_coarse() {
+  return avr_since_epoch(avr_monotonic_us(1))/1000;
+}
+
 // Return s since program start as double
 double avr_timestamp() {
   return avr_ustimestamp()/1e6;
 }
 
+/*
+ * Timing spans for --timing
+ *
+ * avr_span_begin() opens a span for a phase of the run, optionally for a
+ * named memory, and returns its handle; avr_span_end() closes it and notes
+ * the number of bytes moved. Spans nest, and nothing is recorded unless
+ * cx->avr_timing was set. Fine-grained spans for page transfers, serial
+ * transfers, NVM busy waits and sleeps are opened with avr_span_detail()
+ * and only recorded when cx->avr_timing > 1. avr_timing_json() writes all
+ * spans as JSON report, avr_timing_trace_event() in Trace Event Format for
+ * viewers such as https://ui.perfetto.dev or chrome://tracing.
+ */
+int avr_span_begin(const char *phase, const char *memory) {
+  Avr_span *sp;
+
+  if(!cx->avr_timing)
+    return -1;
+  if(cx->avr_nspans%64 == 0)
+    cx->avr_spans = mmt_realloc(cx->avr_spans, (cx->avr_nspans + 64)*sizeof *cx->avr_spans);
+  sp = cx->avr_spans + cx->avr_nspans;
+  sp->phase = phase;
+  sp->memory = memory? mmt_strdup(memory): NULL;
+  sp->depth = cx->avr_spandepth++;
+  sp->detail = 0;
+  sp->nbytes = -1;
+  sp->start = avr_ustimestamp();
+  sp->duration = 0;
+  return cx->avr_nspans++;
+}
+
+int avr_span_detail(const char *phase, const char *memory) {
+  int span = cx->avr_timing > 1? avr_span_begin(phase, memory): -1;
+
+  if(span >= 0)
+    cx->avr_spans[span].detail = 1;
+  return span;
+}
+
+void avr_span_end(int span, long nbytes) {
+  if(span < 0 || span >= cx->avr_nspans)
+    return;
+  Avr_span *sp = cx->avr_spans + span;
+
+  sp->duration = avr_ustimestamp() - sp->start;
+  sp->nbytes = nbytes;
+  if(cx->avr_spandepth > 0)
+    cx->avr_spandepth--;
+}
+
+/*
+ * Mark the begin (begin = 1) and end (begin = 0) of a bulk-heavy phase,
+ * ie, reading back or verifying memories. Applications that run several
+ * programmers on the same USB hub can set cx->avr_bulk_hook to a function
+ * that blocks at the begin of such a phase until bandwidth is available,
+ * while latency-bound phases such as writing pages carry on unthrottled.
+ * Nested phases only call the hook at the outermost level.
+ */
+void avr_bulk_phase(int begin) {
+  if(!cx->avr_bulk_hook)
+    return;
+  if(begin? cx->avr_bulkdepth++ == 0: cx->avr_bulkdepth > 0 && --cx->avr_bulkdepth == 0)
+    cx->avr_bulk_hook(begin);
+}
+
+static void json_string(FILE *f, const char *str) {
+  fputc('"', f);
+  for(; *str; str++)
+    if(*str == '"' || *str == '\\')
+      fprintf(f, "\\%c", *str);
+    else if((unsigned char) *str < 0x20)
+      fprintf(f, "\\u%04x", *str);
+    else
+      fputc(*str, f);
+  fputc('"', f);
+}
+
+void avr_timing_json(FILE *f, const char *pgmid, const char *partid, int exitrc) {
+  fprintf(f, "{\n  \"version\": ");
+  json_string(f, AVRDUDE_FULL_VERSION);
+  fprintf(f, ",\n  \"programmer\": ");
+  json_string(f, pgmid? pgmid: "");
+  fprintf(f, ",\n  \"part\": ");
+  json_string(f, partid? partid: "");
+  fprintf(f, ",\n  \"verify_policy\": ");
+  json_string(f, update_verify_policy());
+  fprintf(f, ",\n  \"exit\": %d,\n  \"total_s\": %.6f,\n  \"spans\": [", exitrc, avr_timestamp());
+  int n = 0;
+
+  for(int i = 0; i < cx->avr_nspans; i++) {
+    const Avr_span *sp = cx->avr_spans + i;
+
+    if(sp->detail)              // Only in avr_timing_trace_event()
+      continue;
+    fprintf(f, "%s\n    {\"phase\": ", n++? ",": "");
+    json_string(f, sp->phase);
+    if(sp->memory) {
+      fprintf(f, ", \"memory\": ");
+      json_string(f, sp->memory);
+    }
+    fprintf(f, ", \"depth\": %d, \"start_s\": %.6f, \"duration_s\": %.6f",
+      sp->depth, sp->start/1e6, sp->duration/1e6);
+    if(sp->nbytes >= 0) {
+      fprintf(f, ", \"bytes\": %ld", sp->nbytes);
+      if(sp->duration)
+        fprintf(f, ", \"bytes_per_s\": %.1f", sp->nbytes*1e6/sp->duration);
+    }
+    fputc('}', f);
+  }
+  fprintf(f, "%s]\n}\n", n? "\n  ": "");
+}
+
+// Write all spans as complete events of the Trace Event Format
+void avr_timing_trace_event(FILE *f) {
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  for(int i = 0; i < cx->avr_nspans; i++) {
+    const Avr_span *sp = cx->avr_spans + i;
+
+    fprintf(f, "%s\n  {\"name\": ", i? ",": "");
+    json_string(f, sp->phase);
+    fprintf(f, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %llu, \"dur\": %llu",
+      sp->detail? "detail": "phase", (unsigned long long) sp->start, (unsigned long long) sp->duration);
+    if(sp->memory || sp->nbytes >= 0) {
+      fprintf(f, ", \"args\": {");
+      if(sp->memory) {
+        fprintf(f, "\"memory\": ");
+        json_string(f, sp->memory);
+      }
+      if(sp->nbytes >= 0)
+        fprintf(f, "%s\"bytes\": %ld", sp->memory? ", ": "", sp->nbytes);
+      fputc('}', f);
+    }
+    fputc('}', f);
+  }
+  fprintf(f, "\n]}\n");
+}
+
+// Call pgm->paged_load() and pgm->paged_write(), recorded as detail spans
+int avr_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int baseaddr, unsigned int n_bytes) {
+
+  int span = avr_span_detail("paged_load", mem->desc);
+  uint64_t start = avr_ustimestamp();
+  int rc = pgm->paged_load(pgm, p, mem, page_size, baseaddr, n_bytes);
+
+  if(rc >= 0) {
+    costmodel_note(COST_READ, mem, n_bytes, avr_ustimestamp() - start);
+    devcache_update(mem, baseaddr, n_bytes, mem->buf + baseaddr);
+  }
+  avr_span_end(span, rc < 0? 0: (long) n_bytes);
+  return rc;
+}
+
+// Flash is no longer known to be erased, nor are the pages write_mem() skipped as blank
+static void flash_written(const AVRMEM *mem) {
+  if(mem_is_in_flash(mem)) {
+    cx->avr_flash_erased = 0;
+    mmt_free(cx->avr_blank_map);
+    cx->avr_blank_map = NULL;
+  }
+}
+
+int avr_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int baseaddr, unsigned int n_bytes) {
+
+  flash_written(mem);
+  devcache_forget(mem, baseaddr, n_bytes);
+  int span = avr_span_detail("paged_write", mem->desc);
+  uint64_t start = avr_ustimestamp();
+  int rc = pgm->paged_write(pgm, p, mem, page_size, baseaddr, n_bytes);
+
+  if(rc >= 0)
+    costmodel_note(COST_WRITE, mem, n_bytes, avr_ustimestamp() - start);
+  avr_span_end(span, rc < 0? 0: (long) n_bytes);
+  return rc;
+}
+
+/*
+ * Load or write a list of nr ranges of mem, each [r[i].addr, r[i].addr + r[i].n)
+ * and a multiple of page_size, in as few transactions as the programmer allows.
+ * Programmers without pgm->paged_load_multi() or pgm->paged_write_multi() get
+ * one pgm->paged_load() or pgm->paged_write() call per range. Returns the
+ * number of bytes in the ranges or a negative value on error.
+ */
+int avr_paged_load_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, const Avr_range *r, int nr) {
+
+  int rc = 0;
+  long nbytes = 0;
+
+  for(int i = 0; i < nr; i++)
+    nbytes += r[i].n;
+  if(!pgm->paged_load_multi) {
+    for(int i = 0; i < nr && rc >= 0; i++)
+      rc = avr_paged_load(pgm, p, mem, page_size, r[i].addr, r[i].n);
+    return rc < 0? rc: nbytes;
+  }
+
+  int span = avr_span_detail("paged_load_multi", mem->desc);
+  uint64_t start = avr_ustimestamp();
+
+  rc = pgm->paged_load_multi(pgm, p, mem, page_size, r, nr);
+  if(rc >= 0) {
+    costmodel_note(COST_READ, mem, nbytes, avr_ustimestamp() - start);
+    for(int i = 0; i < nr; i++)
+      devcache_update(mem, r[i].addr, r[i].n, mem->buf + r[i].addr);
+  }
+  avr_span_end(span, rc < 0? 0: nbytes);
+  return rc < 0? rc: nbytes;
+}
+
+int avr_paged_write_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, const Avr_range *r, int nr) {
+
+  int rc = 0;
+  long nbytes = 0;
+
+  for(int i = 0; i < nr; i++)
+    nbytes += r[i].n;
+  if(!pgm->paged_write_multi) {
+    for(int i = 0; i < nr && rc >= 0; i++)
+      rc = avr_paged_write(pgm, p, mem, page_size, r[i].addr, r[i].n);
+    return rc < 0? rc: nbytes;
+  }
+
+  flash_written(mem);
+  for(int i = 0; i < nr; i++)
+    devcache_forget(mem, r[i].addr, r[i].n);
+  int span = avr_span_detail("paged_write_multi", mem->desc);
+  uint64_t start = avr_ustimestamp();
+
+  rc = pgm->paged_write_multi(pgm, p, mem, page_size, r, nr);
+  if(rc >= 0)
+    costmodel_note(COST_WRITE, mem, nbytes, avr_ustimestamp() - start);
+  avr_span_end(span, rc < 0? 0: nbytes);
+  return rc < 0? rc: nbytes;
+}
+
+/*
+ * Merge ranges, sorted by address, with the gaps between them as long as the
+ * merged range does not exceed maxlen bytes, so reading a few unwanted bytes
+ * saves a transaction; returns the new number of ranges
+ */
+int avr_ranges_coalesce(Avr_range *r, int nr, unsigned int maxlen) {
+  int k = 0;
+
+  for(int i = 1; i < nr; i++) {
+    if(r[i].addr + r[i].n - r[k].addr <= maxlen)
+      r[k].n = r[i].addr + r[i].n - r[k].addr;
+    else
+      r[++k] = r[i];
+  }
+
+  return nr > 0? k + 1: 0;
+}
+
+// Erase and write pages in one NVM command each; returns -2 if the programmer cannot do so for mem
+static int avr_paged_erase_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int baseaddr, unsigned int n_bytes) {
+
+  if(!pgm->paged_erase_write)
+    return -2;
+  flash_written(mem);
+  devcache_forget(mem, baseaddr, n_bytes);
+  int span = avr_span_detail("paged_erase_write", mem->desc);
+  uint64_t start = avr_ustimestamp();
+  int rc = pgm->paged_erase_write(pgm, p, mem, page_size, baseaddr, n_bytes);
+
+  if(rc >= 0)
+    costmodel_note(COST_WRITE, mem, n_bytes, avr_ustimestamp() - start);
+  avr_span_end(span, rc < 0? 0: (long) n_bytes);
+  return rc;
+}
+
+/*
+ * Paged ISP access for programmers with a multi-byte pgm->spi() transfer: the
+ * read or load page commands of a whole range are built into one buffer and
+ * issued with a single pgm->spi() call, so they can install these as
+ * pgm->paged_load() and pgm->paged_write()
+ */
+
+// Read flash, EEPROM or other ISP memories; load extended address only at the start and each 128 KiB
+int avr_spi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  int isflash = m->op[AVR_OP_READ_LO] && m->op[AVR_OP_READ_HI];
+  OPCODE *lext = isflash? m->op[AVR_OP_LOAD_EXT_ADDR]: NULL;
+
+  if(!pgm->spi || is_tpi(p) || (!isflash && !m->op[AVR_OP_READ]))
+    return -2;
+  if(!n_bytes)
+    return 0;
+
+  // One command per byte plus load extended address at start and each 128 KiB boundary
+  int nc = 0, maxc = n_bytes + n_bytes/0x20000 + 2;
+  unsigned char *tx = mmt_malloc(4*maxc), *rx = mmt_malloc(4*maxc);
+
+  for(unsigned int a = addr; a < addr + n_bytes; a++) {
+    if(lext && (a == addr || a%0x20000 == 0)) {
+      avr_set_bits(lext, tx + 4*nc);
+      avr_set_addr(lext, tx + 4*nc++, a/2);
+    }
+    OPCODE *rop = m->op[!isflash? AVR_OP_READ: a & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
+
+    avr_set_bits(rop, tx + 4*nc);
+    avr_set_addr(rop, tx + 4*nc++, isflash? a/2: a + avr_sigrow_offset(p, m, a));
+  }
+
+  int ret = pgm->spi(pgm, tx, rx, 4*nc);
+
+  if(ret >= 0) {
+    nc = 0;
+    for(unsigned int a = addr; a < addr + n_bytes; a++) {
+      if(lext && (a == addr || a%0x20000 == 0))
+        nc++;
+      m->buf[a] = 0;
+      avr_get_output(m->op[!isflash? AVR_OP_READ: a & 1? AVR_OP_READ_HI: AVR_OP_READ_LO], rx + 4*nc++, m->buf + a);
+    }
+  }
+  mmt_free(tx);
+  mmt_free(rx);
+
+  return ret < 0? -1: (int) n_bytes;
+}
+
+// Write flash loading each page with one pgm->spi() call; other memories are written byte by byte
+int avr_spi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  if(!pgm->spi || is_tpi(p))
+    return -2;
+
+  if(!(m->paged && m->page_size > 1 && m->op[AVR_OP_LOADPAGE_LO] && m->op[AVR_OP_LOADPAGE_HI])) {
+    if(m->paged)                // Leave other paged memories to the generic byte loop
+      return -2;
+    for(unsigned int a = addr; a < addr + n_bytes; a++)
+      if(avr_write_byte_default(pgm, p, m, a, m->buf[a]) != 0)
+        return -2;
+    return n_bytes;
+  }
+
+  unsigned char *tx = mmt_malloc(4*m->page_size), *rx = mmt_malloc(4*m->page_size);
+  int ret = 0;
+
+  for(unsigned int pg = addr - addr%m->page_size; ret >= 0 && pg < addr + n_bytes; pg += m->page_size) {
+    unsigned int lo = pg < addr? addr: pg, hi = pg + m->page_size < addr + n_bytes? pg + m->page_size: addr + n_bytes;
+    int nc = 0;
+
+    for(unsigned int a = lo; a < hi; a++) {
+      OPCODE *lop = m->op[a & 1? AVR_OP_LOADPAGE_HI: AVR_OP_LOADPAGE_LO];
+
+      memset(tx + 4*nc, 0, 4);
+      avr_set_bits(lop, tx + 4*nc);
+      avr_set_addr(lop, tx + 4*nc, a/2);
+      avr_set_input(lop, tx + 4*nc++, m->buf[a]);
+    }
+    if((ret = pgm->spi(pgm, tx, rx, 4*nc)) >= 0)
+      ret = avr_write_page(pgm, p, m, pg);
+  }
+  mmt_free(tx);
+  mmt_free(rx);
+
+  return ret < 0? -1: (int) n_bytes;
+}
+
+// Sleep for us microseconds, recorded as detail span
+void avr_usleep(unsigned long us) {
+  int span = avr_span_detail("sleep", NULL);
+
+  usleep(us);
+  avr_span_end(span, -1);
+}
+
 /*
  * Initialize the global context pointer cx
  *
@@ -604,11 +1213,40 @@ double avr_timestamp() {
 void init_cx(PROGRAMMER *pgm) {
   if(pgm)
     pgm->flag = 0;              // Clear out remnants of previous session(s)
-  mmt_free(cx);
+  free_cx();
   cx = mmt_malloc(sizeof *cx);  // Allocate and initialise context structure
   (void) avr_ustimestamp();     // Base timestamps from program start
 }
 
+// Deallocate the context of this thread and the buffers it owns
+void free_cx(void) {
+  if(!cx)
+    return;
+  mmt_free(cx->avr_space);
+  for(int i = 0; i < OPC_NTABS; i++)
+    mmt_free(cx->opc_tabs[i]);
+  mmt_free(cx);
+  cx = NULL;
+}
+
+/*
+ * Verbosity and the other options of avrdude.h are thread local, and a new
+ * thread starts with all of them 0: a thread that starts a worker saves its
+ * own options with avr_opts_save() and the worker adopts them with
+ * avr_opts_load() before it prints anything
+ */
+void avr_opts_save(Avr_opts *o) {
+  o->verbose = verbose;
+  o->quell_progress = quell_progress;
+  o->ovsigck = ovsigck;
+}
+
+void avr_opts_load(const Avr_opts *o) {
+  verbose = o->verbose;
+  quell_progress = o->quell_progress;
+  ovsigck = o->ovsigck;
+}
+
 int avr_read_byte_silent(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned long addr, unsigned char *datap) {
 
@@ -640,6 +1278,33 @@ int avr_bitmask_data(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   return data;
 }
 
+// Record that a polled write to mem completed after us microseconds
+static void avr_wd_observe(const AVRMEM *mem, int us) {
+  if(cx->avr_wd_mem != mem) {
+    cx->avr_wd_mem = mem;
+    cx->avr_wd_max = cx->avr_wd_n = 0;
+  }
+  if(us > cx->avr_wd_max)
+    cx->avr_wd_max = us;
+  cx->avr_wd_n++;
+}
+
+/*
+ * Time to wait for a write to mem that cannot be polled: once a few polled
+ * writes to the same memory have been timed, 1.5 times the longest of those
+ * plus 0.5 ms, but never more than max_write_delay
+ */
+static int avr_wd_delay(const AVRMEM *mem) {
+  if(cx->avr_wd_mem == mem && cx->avr_wd_n >= 4) {
+    int delay = cx->avr_wd_max + cx->avr_wd_max/2 + 500;
+
+    if(delay < mem->max_write_delay)
+      return delay;
+  }
+
+  return mem->max_write_delay;
+}
+
 int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned long addr, unsigned char data) {
 
@@ -790,8 +1455,8 @@ int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   }
 
   if(readok == 0) {
-    // Read operation not supported for this memory, just wait the max programming time
-    usleep(mem->max_write_delay);       // Maximum write delay
+    // Read operation not supported for this memory, just wait the programming time
+    avr_usleep(avr_wd_delay(mem));
     goto success;
   }
 
@@ -803,9 +1468,10 @@ int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
       /*
        * Use an extra long delay when we happen to be writing values used for
        * polled data read-back.  In this case, polling doesn't work, and we
-       * need to delay the worst case write time specified for the chip.
+       * need to delay the worst case write time specified for the chip or,
+       * once known, the write time observed when polling other values.
        */
-      usleep(mem->max_write_delay);
+      avr_usleep(avr_wd_delay(mem));
       rc = pgm->read_byte(pgm, p, mem, addr, &r);
       if(rc != 0) {
         rc = -5;
@@ -822,6 +1488,8 @@ int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
         }
         now = avr_ustimestamp();
       } while(r != data && mem->max_write_delay >= 0 && (int) (now-start) < mem->max_write_delay);
+      if(r == data)
+        avr_wd_observe(mem, now - start);
     }
 
     // At this point we either have a valid readback or the max_write_delay is expired
@@ -841,7 +1509,7 @@ int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
       if((pgm->pinno[PPI_AVR_VCC] & PIN_MASK) <= PIN_MAX) {
         pmsg_info("attempting to do this now ...\n");
         pgm->powerdown(pgm);
-        usleep(250000);
+        avr_usleep(250000);
         rc = pgm->initialize(pgm, p);
         if(rc < 0) {
           pmsg_error("initialization failed (rc = %d):\n", rc);
@@ -888,6 +1556,8 @@ int avr_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   pmsg_debug("%s(%s, %s, %s, %s, 0x%02x)\n", __func__, pgmid, p->id, mem->desc,
     str_ccaddress(addr, mem->size), data);
 
+  flash_written(mem);
+  devcache_forget(mem, addr, 1);
   if(mem_is_readonly(mem)) {
     unsigned char is;
 
@@ -908,7 +1578,7 @@ int avr_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
 /*
  * Write the whole memory region of the specified memory from its buffer of the
  * avrpart pointed to by p to the device.  Write up to size bytes from the
- * buffer.  Data is only written if the corresponding tags byte is set. Data
+ * buffer.  Data is only written if the corresponding tag is set. Data
  * beyond size bytes are not affected.
  *
  * Return the number of bytes written, or LIBAVRDUDE_GENERAL_FAILURE on error.
@@ -924,14 +1594,213 @@ int avr_write(const PROGRAMMER *pgm, const AVRPART *p, const char *memstr, int s
   return avr_write_mem(pgm, p, m, size, auto_erase);
 }
 
-int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int size, int auto_erase) {
+/*
+ * Write the EEPROM page at pageaddr of a classic part through its loadpage and
+ * writepage opcodes; bytes not allocated or beyond wsize are first read from
+ * the device so the page write leaves them unchanged. Waits min_write_delay and
+ * then polls a byte of the page that is not a readback value until the write
+ * completes, up to max_write_delay; without such a byte it polls RDY/BSY or
+ * waits the maximum.
+ */
+static int avr_write_eeprom_page(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int pageaddr, unsigned int wsize) {
+
+  unsigned char cmd[4], res[4], page[256], r;
+  int i, poll = -1;
+
+  if(m->page_size > (int) sizeof page)
+    return -1;
+
+  for(i = 0; i < m->page_size; i++) {
+    unsigned int addr = pageaddr + i;
+
+    page[i] = m->buf[addr];
+    if((addr >= wsize || !tag_isset(m->tags, addr)) && pgm->read_byte(pgm, p, m, addr, page + i) < 0)
+      return -1;
+  }
+
+  for(i = 0; i < m->page_size; i++) {
+    memset(cmd, 0, sizeof cmd);
+    avr_set_bits(m->op[AVR_OP_LOADPAGE_LO], cmd);
+    avr_set_addr(m->op[AVR_OP_LOADPAGE_LO], cmd, pageaddr + i);
+    avr_set_input(m->op[AVR_OP_LOADPAGE_LO], cmd, page[i]);
+    if(pgm->cmd(pgm, cmd, res) < 0)
+      return -1;
+    if(page[i] != m->readback[0] && page[i] != m->readback[1])
+      poll = i;
+  }
+
+  memset(cmd, 0, sizeof cmd);
+  avr_set_bits(m->op[AVR_OP_WRITEPAGE], cmd);
+  avr_set_addr(m->op[AVR_OP_WRITEPAGE], cmd, pageaddr);
+  if(pgm->cmd(pgm, cmd, res) < 0)
+    return -1;
+
+  if(poll < 0) {
+    avr_isp_ready_wait(pgm, p, m->max_write_delay, "page write poll");
+    return 0;
+  }
+
+  avr_usleep(m->min_write_delay);
+  unsigned long start = avr_ustimestamp();
+
+  do {
+    if(pgm->read_byte(pgm, p, m, pageaddr + poll, &r) < 0)
+      return -1;
+  } while(r != page[poll] && (int) (avr_ustimestamp() - start) < m->max_write_delay - m->min_write_delay);
+
+  return 0;
+}
+
+// Does the page of n bytes at addr have allocated bytes, all of which are 0xff?
+static int page_is_blank(const AVRMEM *m, int addr, int n) {
+  int nset = 0;
+
+  for(int i = addr; i < addr + n && i < m->size; i++)
+    if(tag_isset(m->tags, i)) {
+      if(m->buf[i] != 0xff)
+        return 0;
+      nset++;
+    }
+
+  return nset > 0;
+}
+
+// Remember the blank pages that write_mem() skipped so verification can trust them
+static void blank_publish(const AVRMEM *m, unsigned char *blank) {
+  mmt_free(cx->avr_blank_map);
+  cx->avr_blank_map = blank;
+  cx->avr_blank_desc = m->desc;
+  cx->avr_blank_pgsize = m->page_size;
+  cx->avr_blank_npages = (m->size + m->page_size - 1)/m->page_size;
+}
+
+/*
+ * Untag in vmem the pages of mem that the last write of mem skipped, because
+ * they only had 0xff bytes and flash was known to be erased, so that verify
+ * neither reads them back nor compares them; returns the number of pages
+ */
+int avr_untag_blank(const AVRMEM *mem, AVRMEM *vmem) {
+  int n = 0, pgsize = cx->avr_blank_pgsize;
+
+  if(!cx->avr_blank_map || !vmem || pgsize < 1 || !str_eq(mem->desc, cx->avr_blank_desc))
+    return 0;
+
+  for(int pg = 0; pg < cx->avr_blank_npages && pg*pgsize < vmem->size; pg++)
+    if(page_is_allocated(cx->avr_blank_map, pg)) {
+      for(int i = pg*pgsize; i < (pg + 1)*pgsize && i < vmem->size; i++)
+        tag_clr(vmem->tags, i);
+      n++;
+    }
+  if(n)
+    pmsg_debug("%s(): %d blank page%s of %s expected erased\n", __func__, n, str_plural(n), mem->desc);
+
+  return n;
+}
+
+// Call pgm->page_erase() and note its cost
+static int erase_page(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, unsigned int addr) {
+  uint64_t start = avr_ustimestamp();
+  int rc = pgm->page_erase(pgm, p, mem, addr);
+
+  if(rc >= 0)
+    costmodel_note(COST_ERASE, mem, mem->page_size, avr_ustimestamp() - start);
+  return rc;
+}
+
+/*
+ * Write the pages in map through pgm->paged_write_multi() in lists of up to
+ * AVR_MULTI_RANGES ranges; pages that need erasing are erased first, and
+ * differential writes skip the pages that the device already holds, which
+ * are counted in *nskipped
+ */
+static int write_pages_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *cm,
+  const unsigned char *map, int cwsize, int diff, int auto_erase, unsigned char *spc, int npages, int *nskipped) {
+
+  int pgsz = cm->page_size, npg = cwsize/pgsz, maxrun = pgsz < 4096? 4096/pgsz: 1;
+  int nr = 0, ndone = 0, rc = 0;
+  Avr_range r[AVR_MULTI_RANGES];
+
+  for(int k = 0; k <= npg && rc >= 0; k++) {
+    unsigned int addr = k*pgsz;
+
+    if(k < npg && page_is_allocated(map, k)) {
+      int erase = auto_erase && pgm->page_erase && !mem_is_eeprom(cm);
+      const unsigned char *dev = diff? devcache_page(cm, addr): NULL;
+
+      if(diff && !dev && avr_read_page_default(pgm, p, cm, addr, spc) >= 0)
+        dev = spc;
+      if(dev == spc)
+        costmodel_compared(cm, memcmp(cm->buf + addr, dev, pgsz) != 0);
+      if(dev) {
+        if(!memcmp(cm->buf + addr, dev, pgsz)) {
+          pmsg_debug("%s(): skipping page %u: unchanged on device\n", __func__, k);
+          report_progress(++ndone, npages, NULL);
+          ++*nskipped;
+          continue;
+        }
+        erase = pgm->page_erase && !mem_is_eeprom(cm) && !avr_is_and(cm->buf + addr, dev, cm->buf + addr, pgsz);
+      }
+      if(nr == AVR_MULTI_RANGES && !(r[nr - 1].addr + r[nr - 1].n == addr && r[nr - 1].n < (unsigned) (maxrun*pgsz))) {
+        if((rc = avr_paged_write_multi(pgm, p, cm, pgsz, r, nr)) < 0)
+          break;
+        ndone += rc/pgsz;
+        report_progress(ndone, npages, NULL);
+        nr = 0;
+      }
+      if(erase && (rc = erase_page(pgm, p, cm, addr)) < 0)
+        break;
+      if(nr && r[nr - 1].addr + r[nr - 1].n == addr && r[nr - 1].n < (unsigned) (maxrun*pgsz))
+        r[nr - 1].n += pgsz;
+      else
+        r[nr].addr = addr, r[nr++].n = pgsz;
+    } else if(k == npg && nr) {
+      if((rc = avr_paged_write_multi(pgm, p, cm, pgsz, r, nr)) >= 0) {
+        ndone += rc/pgsz;
+        report_progress(ndone, npages, NULL);
+      }
+    }
+  }
+
+  return rc;
+}
+
+/*
+ * Read back n pages of m from addr right after writing them and compare them
+ * with the tagged bytes of m; returns 0 if they match, 1 if not and -1 if
+ * they cannot be read
+ */
+static int inline_verify(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, unsigned int addr, int n,
+  unsigned char *buf) {
+
+  for(int r = 0; r < n; r++, addr += m->page_size) {
+    if(avr_read_page_default(pgm, p, m, addr, buf) < 0)
+      return -1;
+    for(int i = 0; i < m->page_size; i++)
+      if(tag_isset(m->tags, addr + i) && buf[i] != m->buf[addr + i] &&
+        !(pgm->readonly && pgm->readonly(pgm, p, m, addr + i))) {
+        pmsg_debug("%s(): device 0x%02x != input 0x%02x at addr 0x%04x\n", __func__,
+          buf[i], m->buf[addr + i], addr + i);
+        return 1;
+      }
+    devcache_update(m, addr, m->page_size, buf);
+  }
+
+  return 0;
+}
+
+static int write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int size, int auto_erase, int diff,
+  int *verified) {
   int wsize;
   unsigned int i, lastaddr;
   unsigned char data;
-  unsigned char cmd[4];
+  unsigned char *blank = NULL;  // Pages skipped as all 0xff after a chip erase
+
+  pmsg_debug("%s(%s, %s, %s, %s, auto_erase = %d, diff = %d)\n", __func__, pgmid, p->id,
+    m->desc, str_ccaddress(size, m->size), auto_erase, diff);
 
-  pmsg_debug("%s(%s, %s, %s, %s, auto_erase = %d)\n", __func__, pgmid, p->id,
-    m->desc, str_ccaddress(size, m->size), auto_erase);
+  if(verified)
+    *verified = 0;
 
   led_clr(pgm, LED_ERR);
   led_set(pgm, LED_PGM);
@@ -951,6 +1820,41 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
     return wsize;
   }
 
+  // After a chip erase there is no need to write pages that only have 0xff bytes
+  int erased = cx->avr_flash_erased && mem_is_in_flash(m) && m->page_size > 1 && !diff && !is_spm(pgm);
+  int nblank = (m->size + m->page_size - 1)/(m->page_size > 1? m->page_size: 1);
+
+  flash_written(m);
+
+  /*
+   * Differential EEPROM write through the cache: pages are read in once, only
+   * bytes that differ modify the cache and only pages with changes are written
+   */
+  if(diff && mem_is_eeprom(m) && avr_has_paged_access(pgm, p, m)) {
+    // Start from a cache that reflects the device
+    if(avr_flush_cache(pgm, p) < 0 || avr_reset_cache(pgm, p) < 0)
+      goto error;
+    for(i = 0; i < (unsigned int) wsize; i++) {
+      if(tag_isset(m->tags, i)) {
+        int rc = avr_write_byte_cached(pgm, p, m, i, m->buf[i]);
+
+        if(rc < 0 && rc != LIBAVRDUDE_SOFTFAIL) {
+          report_progress(1, -1, NULL);
+          led_set(pgm, LED_ERR);
+          goto error;
+        }
+      }
+      report_progress(i, wsize, NULL);
+    }
+    if(avr_flush_cache(pgm, p) < 0) {
+      led_set(pgm, LED_ERR);
+      goto error;
+    }
+    avr_reset_cache(pgm, p);
+    led_clr(pgm, LED_PGM);
+    return wsize;
+  }
+
   if(is_tpi(p) && m->page_size > 1 && pgm->cmd_tpi) {
     unsigned int chunk;         // Number of words for each write command
     unsigned int j, writeable_chunk;
@@ -992,7 +1896,7 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
     for(lastaddr = i = 0; i < (unsigned int) wsize; i += chunk) {
       // Check that at least one byte in this chunk is allocated
       for(writeable_chunk = j = 0; !writeable_chunk && j < chunk; j++) {
-        writeable_chunk = m->tags[i + j] & TAG_ALLOCATED;
+        writeable_chunk = tag_isset(m->tags, i + j);
       }
 
       if(writeable_chunk) {
@@ -1002,15 +1906,19 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
           lastaddr = i;
         }
         // Write each byte of the chunk; unallocated bytes should read as 0xFF
-        cmd[0] = TPI_CMD_SST_PI;
+        unsigned char sst[2*8];
+
         for(j = 0; j < chunk; j++) {
-          cmd[1] = m->buf[i + j];
-          if(pgm->cmd_tpi(pgm, cmd, 2, NULL, 0) < 0) {
-            report_progress(1, -1, NULL);
-            led_set(pgm, LED_ERR);
-            led_clr(pgm, LED_PGM);
-            return LIBAVRDUDE_GENERAL_FAILURE;
-          }
+          sst[2*j] = TPI_CMD_SST_PI;
+          sst[2*j + 1] = m->buf[i + j];
+          if(!pgm->cmd_tpi_batch && pgm->cmd_tpi(pgm, sst + 2*j, 2, NULL, 0) < 0)
+            break;
+        }
+        if(j < chunk || (pgm->cmd_tpi_batch && pgm->cmd_tpi_batch(pgm, sst, 2, NULL, 0, chunk) < 0)) {
+          report_progress(1, -1, NULL);
+          led_set(pgm, LED_ERR);
+          led_clr(pgm, LED_PGM);
+          return LIBAVRDUDE_GENERAL_FAILURE;
         }
 
         lastaddr += chunk;
@@ -1028,7 +1936,7 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
     (is_spm(pgm) && avr_has_paged_access(pgm, p, m))) {
 
     // The programmer supports a paged mode write
-    int need_write, failure, nset;
+    int failure, nset;
     unsigned int pageaddr;
     unsigned int npages, nwritten;
 
@@ -1066,9 +1974,13 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
     // Set cwsize as rounded-up wsize
     int cwsize = (wsize + pgsize - 1)/pgsize*pgsize;
 
+    unsigned char *map = avr_page_map(cm, pgsize, cwsize);
+
     for(pageaddr = 0; pageaddr < (unsigned int) cwsize; pageaddr += pgsize) {
+      if(!page_is_allocated(map, pageaddr/pgsize))
+        continue;
       for(i = pageaddr, nset = 0; i < pageaddr + pgsize; i++)
-        if(cm->tags[i] & TAG_ALLOCATED)
+        if(tag_isset(cm->tags, i))
           nset++;
 
       if(nset && nset != pgsize) {      // Effective page has holes
@@ -1077,18 +1989,20 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
           unsigned int end = beg + cm->page_size;
 
           for(i = beg; i < end; i++)
-            if(!(cm->tags[i] & TAG_ALLOCATED))
+            if(!tag_isset(cm->tags, i))
               break;
 
           if(i >= end)          // Memory page has no holes
             continue;
 
-          // Read flash contents to separate memory spc and fill in holes
-          if(avr_read_page_default(pgm, p, cm, beg, spc) >= 0) {
+          // Read flash contents, or know them if erased, to separate memory spc and fill in holes
+          if(erased)
+            memset(spc, 0xff, cm->page_size);
+          if(erased || avr_read_page_default(pgm, p, cm, beg, spc) >= 0) {
             pmsg_debug("padding %s [0x%04x, 0x%04x]\n", cm->desc, beg, end - 1);
             for(i = beg; i < end; i++)
-              if(!(cm->tags[i] & TAG_ALLOCATED)) {
-                cm->tags[i] |= TAG_ALLOCATED;
+              if(!tag_isset(cm->tags, i)) {
+                tag_set(cm->tags, i);
                 cm->buf[i] = spc[i - beg];
               }
           } else {
@@ -1098,45 +2012,141 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
       }
     }
 
-    // Quickly scan number of pages to be written to
-    for(pageaddr = 0, npages = 0; pageaddr < (unsigned int) cwsize; pageaddr += cm->page_size) {
-      for(i = pageaddr; i < pageaddr + cm->page_size; i++)
-        if(cm->tags[i] & TAG_ALLOCATED) {
-          npages++;
-          break;
+    // Padding may have changed the tags: map pages to be written to and count them
+    mmt_free(map);
+    map = avr_page_map(cm, cm->page_size, cwsize);
+    if(erased) {
+      int k, n = 0;
+
+      blank = mmt_malloc(nblank/8 + 1);
+      for(pageaddr = 0, k = 0; pageaddr < (unsigned int) cwsize; pageaddr += cm->page_size, k++)
+        if(page_is_allocated(map, k) && page_is_blank(cm, pageaddr, cm->page_size)) {
+          map[k/8] &= ~(1 << (k%8));
+          blank[k/8] |= 1 << (k%8);
+          n++;
         }
+      if(n)
+        pmsg_debug("%s(): skipping %d blank page%s of erased %s\n", __func__, n, str_plural(n), cm->desc);
     }
+    for(pageaddr = 0, npages = 0; pageaddr < (unsigned int) cwsize; pageaddr += cm->page_size)
+      if(page_is_allocated(map, pageaddr/cm->page_size))
+        npages++;
 
-    for(pageaddr = 0, failure = 0, nwritten = 0;
-      !failure && pageaddr < (unsigned int) cwsize; pageaddr += cm->page_size) {
+    /*
+     * Programmers that can stream consecutive pages in one paged_write() call
+     * receive runs of pages to be written, so they can skip per-page address
+     * set-up and round trips; not so if each page needs a separate erase first
+     */
+    int maxrun = 1;
 
-      // Check whether this page must be written to
-      for(i = pageaddr, need_write = 0; i < pageaddr + cm->page_size; i++)
-        if((cm->tags[i] & TAG_ALLOCATED) != 0) {
-          need_write = 1;
-          break;
-        }
+    if(pgm->multipage_write && !diff &&
+      !(auto_erase && pgm->page_erase && !pgm->paged_erase_write && !mem_is_eeprom(cm)))
+      maxrun = cm->page_size < 4096? 4096/cm->page_size: 1;
 
-      if(need_write) {
-        int rc = 0;
+    int tries = 0, vfailed = 0, vfy = verified != NULL; // Inline verification while vfy is set
+    int nskipped = 0;           // Pages that differential writes found unchanged on the device
+
+    /*
+     * Scatter-gather programmers receive lists of the pages to be written
+     * unless pages are verified inline or should be erased and written with
+     * one command each; on failure the page loop below starts over
+     */
+    int multi = pgm->paged_write_multi && !vfy &&
+      !((auto_erase || diff) && pgm->page_erase && pgm->paged_erase_write && !mem_is_eeprom(cm)) &&
+      write_pages_multi(pgm, p, cm, map, cwsize, diff, auto_erase, spc, npages, &nskipped) >= 0;
+    if(!multi)                  // The page loop starts over
+      nskipped = 0;
+
+    for(pageaddr = 0, failure = 0, nwritten = 0; !multi && !failure && !vfailed && pageaddr < (unsigned int) cwsize;) {
+      int run;
+
+      for(run = 0; run < maxrun && pageaddr + run*cm->page_size < (unsigned int) cwsize; run++) {
+        // Check whether this page must be written to
+        if(!page_is_allocated(map, pageaddr/cm->page_size + run))
+          break;
+      }
 
-        if(auto_erase && pgm->page_erase && !mem_is_eeprom(cm))
-          rc = pgm->page_erase(pgm, p, cm, pageaddr);
-        if(rc >= 0)
-          rc = pgm->paged_write(pgm, p, cm, cm->page_size, pageaddr, cm->page_size);
-        if(rc < 0)
+      if(run) {
+        int rc = 0, erase = auto_erase && pgm->page_erase && !mem_is_eeprom(cm);
+
+        // Differential write: skip pages the device already holds, erase only if needed
+        const unsigned char *dev = diff? devcache_page(cm, pageaddr): NULL;
+
+        if(diff && !dev && avr_read_page_default(pgm, p, cm, pageaddr, spc) >= 0)
+          dev = spc;
+        if(dev == spc)
+          costmodel_compared(cm, memcmp(cm->buf + pageaddr, dev, cm->page_size) != 0);
+        if(dev) {
+          if(!memcmp(cm->buf + pageaddr, dev, cm->page_size)) {
+            pmsg_debug("%s(): skipping page %u: unchanged on device\n", __func__, pageaddr/cm->page_size);
+            report_progress(++nwritten, npages, NULL);
+            nskipped++;
+            pageaddr += cm->page_size;
+            continue;
+          }
+          // Page erase is only needed if programming cannot reach new from old
+          erase = pgm->page_erase && !mem_is_eeprom(cm) &&
+            !avr_is_and(cm->buf + pageaddr, dev, cm->buf + pageaddr, cm->page_size);
+        }
+        // With inline verification pages are read back at once and a mismatch is rewritten once
+        for(int vtry = 0, vrc = 1; vrc > 0 && vtry < 2; vtry++) {
+          // Combined erase-write halves the NVM commands; otherwise erase each page before writing
+          rc = erase? avr_paged_erase_write(pgm, p, cm, cm->page_size, pageaddr, run*cm->page_size): -2;
+          if(rc == -2) {
+            rc = 0;
+            for(int r = 0; erase && rc >= 0 && r < run; r++)
+              rc = erase_page(pgm, p, cm, pageaddr + r*cm->page_size);
+            if(rc >= 0)
+              rc = avr_paged_write(pgm, p, cm, cm->page_size, pageaddr, run*cm->page_size);
+          }
+          if(rc < 0 || !vfy)
+            break;
+          if((vrc = inline_verify(pgm, p, cm, pageaddr, run, spc)) < 0) {
+            pmsg_notice("cannot read back %s right after writing; verifying separately\n", cm->desc);
+            vfy = 0;
+          } else if(vrc > 0 && !vtry) {
+            pmsg_notice("%s mismatch right after writing page %u; writing it again\n", cm->desc,
+              pageaddr/cm->page_size);
+          } else if(vrc > 0) {
+            pmsg_error("%s verification mismatch in page %u right after writing\n", cm->desc,
+              pageaddr/cm->page_size);
+            vfailed = 1;
+          }
+        }
+        if(vfailed)
+          break;
+        if(rc < 0) {
+          // Mid-memory glitch? Retry from the failed page after resync
+          if(nwritten && avr_paged_resync(pgm, cm, pageaddr, &tries) == 0)
+            continue;
           failure = 1;          // Paged write failed, fall back to byte-at-a-time write below
-        nwritten++;
+        } else
+          tries = 0;            // Only give up after repeated glitches in a row
+        nwritten += run;
         report_progress(nwritten, npages, NULL);
+        pageaddr += run*cm->page_size;
       } else {
         pmsg_debug("%s(): skipping page %u: no interesting data\n", __func__, pageaddr/cm->page_size);
+        pageaddr += cm->page_size;
       }
     }
 
     avr_free_mem(cm);
     mmt_free(spc);
+    mmt_free(map);
 
+    if(vfailed) {
+      led_set(pgm, LED_ERR);
+      goto error;
+    }
     if(!failure) {
+      if(diff)
+        pmsg_notice("differential write skipped %d of %d %s page%s unchanged on the device\n",
+          nskipped, npages, m->desc, str_plural(npages));
+      if(blank)
+        blank_publish(m, blank);
+      if(verified)
+        *verified = vfy;
       led_clr(pgm, LED_PGM);
       return wsize;
     }
@@ -1150,12 +2160,65 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
   int flush_page = 0;
   int paged = mem_is_in_flash(m) && m->paged;
 
+  // Classic parts with EEPROM page opcodes: write EEPROM page by page
+  if(mem_is_eeprom(m) && m->page_size > 1 && m->size%m->page_size == 0 && !is_tpi(p) &&
+    m->op[AVR_OP_LOADPAGE_LO] && m->op[AVR_OP_WRITEPAGE] && m->op[AVR_OP_READ] &&
+    pgm->cmd && pgm->write_byte == avr_write_byte_default && pgm->read_byte == avr_read_byte_default) {
+
+    for(i = 0; i < (unsigned int) wsize; i += m->page_size) {
+      unsigned int j, end = i + m->page_size < (unsigned int) wsize? i + m->page_size: (unsigned int) wsize;
+
+      report_progress(i, wsize, NULL);
+      for(j = i; j < end && !tag_isset(m->tags, j); j++)
+        continue;
+      if(j < end && avr_write_eeprom_page(pgm, p, m, i, wsize) < 0) {
+        msg_error(" *** failed to write page %d [0x%04x, 0x%04x]\n", i/m->page_size, i, i + m->page_size - 1);
+        led_set(pgm, LED_ERR);
+        goto error;
+      }
+    }
+    led_clr(pgm, LED_PGM);
+    return wsize;
+  }
+
+  // A contiguous run of bytes of small unpaged memories, eg, fuses, in one block if the programmer can
+  if(pgm->range_write && pgm->paged_write && m->page_size <= 1 && mem_is_fuses(m) && wsize <= 256) {
+    int lo, hi, k;
+
+    for(lo = 0; lo < wsize && !tag_isset(m->tags, lo); lo++)
+      continue;
+    for(hi = wsize; hi > lo && !tag_isset(m->tags, hi - 1); hi--)
+      continue;
+    for(k = lo; k < hi && tag_isset(m->tags, k); k++)
+      continue;
+    if(lo == hi) {
+      led_clr(pgm, LED_PGM);
+      return wsize;
+    }
+    if(k == hi && avr_paged_write(pgm, p, m, hi - lo, lo, hi - lo) >= 0) {
+      led_clr(pgm, LED_PGM);
+      return wsize;
+    }
+    // Else: fall back to byte-at-a-time write below
+  }
+
   if(paged)
     wsize = (wsize + 1)/2*2;        // Round up write size for word boundary
+  if(erased && paged && !blank)
+    blank = mmt_malloc(nblank/8 + 1);
   for(i = 0; i < (unsigned int) wsize; i++) {
     data = m->buf[i];
     report_progress(i, wsize, NULL);
 
+    // Skip pages of erased flash that would only be loaded with 0xff
+    if(erased && paged && (int) i%m->page_size == 0 && page_is_blank(m, i, m->page_size)) {
+      int k = i/m->page_size;
+
+      blank[k/8] |= 1 << (k%8);
+      i += m->page_size - 1;
+      continue;
+    }
+
     /*
      * Find out whether the write action must be invoked for this byte.
      *
@@ -1167,7 +2230,7 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
      * the last byte of each tainted page, the write operation must also be
      * invoked in order to actually write the page buffer to device memory.
      */
-    int do_write = (paged? m->tags[i & ~1] | m->tags[i | 1]: m->tags[i]) & TAG_ALLOCATED;
+    int do_write = paged? tag_isset(m->tags, i & ~1) || tag_isset(m->tags, i | 1): tag_isset(m->tags, i);
 
     if(paged) {
       page_tainted |= do_write;
@@ -1199,23 +2262,58 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int
     }
   }
 
+  if(blank)
+    blank_publish(m, blank);
   led_clr(pgm, LED_PGM);
   return i;
 
 error:
+  mmt_free(blank);
   led_clr(pgm, LED_PGM);
   return -1;
 }
 
+int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int size, int auto_erase) {
+  return write_mem(pgm, p, m, size, auto_erase, 0, NULL);
+}
+
+/*
+ * Differential write for already programmed devices: as avr_write_mem() but
+ * with paged access each page is first read from the device; pages that
+ * already hold the data are skipped, and pages that differ are only erased
+ * beforehand if some bit needs to change from 0 to 1. Returns the number of
+ * bytes written or LIBAVRDUDE_GENERAL_FAILURE on error.
+ */
+int avr_write_mem_diff(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int size) {
+  return write_mem(pgm, p, m, size, 0, 1, NULL);
+}
+
+/*
+ * As avr_write_mem() or, with diff set, as avr_write_mem_diff(), but with
+ * paged access each run of pages is read back right after writing it, and
+ * pages that do not hold what was written are written once more. *verified
+ * is set when all written pages have been checked in this way; otherwise,
+ * eg, for byte-wise writes, the caller still needs to verify separately.
+ * Returns the number of bytes written or LIBAVRDUDE_GENERAL_FAILURE, which
+ * includes pages that still differ after the second write.
+ */
+int avr_write_mem_verified(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int size, int auto_erase,
+  int diff, int *verified) {
+
+  return write_mem(pgm, p, m, size, diff? 0: auto_erase, diff, verified);
+}
+
 // Read the AVR device's signature bytes
 int avr_signature(const PROGRAMMER *pgm, const AVRPART *p) {
-  int rc;
+  int rc, span;
 
   pmsg_debug("%s(%s, %s)\n", __func__, pgmid, p->id);
 
   if(verbose > 1)
     report_progress(0, 1, "Reading");
+  span = avr_span_begin("signature", NULL);
   rc = avr_read(pgm, p, "signature", 0);
+  avr_span_end(span, rc);
   if(rc < LIBAVRDUDE_SUCCESS && rc != LIBAVRDUDE_EXIT_OK) {
     pmsg_error("unable to read signature data for part %s (rc = %d)\n", p->desc, rc);
     return rc;
@@ -1299,6 +2397,37 @@ int avr_verify(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const
   return avr_verify_mem(pgm, p, v, a, size);
 }
 
+/*
+ * Return the first index in [i, size) where buf1 and buf2 differ in an
+ * allocated byte, or size if there is none; runs of 8 bytes that are equal
+ * or not allocated are skipped a machine word or a tag byte at a time
+ */
+static int avr_next_mismatch(const unsigned char *tags, const unsigned char *buf1,
+  const unsigned char *buf2, int i, int size) {
+
+  uint64_t w1, w2;
+
+  for(; i < size && i%8; i++)   // Align to tag byte boundary
+    if(tag_isset(tags, i) && buf1[i] != buf2[i])
+      return i;
+
+  while(i < size) {
+    if(i + 8 <= size) {
+      memcpy(&w1, buf1 + i, 8);
+      memcpy(&w2, buf2 + i, 8);
+      if(w1 == w2 || !tags[i/8]) {
+        i += 8;
+        continue;
+      }
+    }
+    for(int n = i + 8 < size? i + 8: size; i < n; i++)
+      if(tag_isset(tags, i) && buf1[i] != buf2[i])
+        return i;
+  }
+
+  return size;
+}
+
 int avr_verify_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const AVRMEM *a, int size) {
   int i;
   unsigned char *buf1, *buf2;
@@ -1327,47 +2456,45 @@ int avr_verify_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, co
   int verror = 0, vroerror = 0, maxerrs = verbose >= MSG_DEBUG? size + 1: 10;
   int ro = mem_is_readonly(a);  // Other memories can have known protected zones such as bootloaders
 
-  for(i = 0; i < size; i++) {
-    if((b->tags[i] & TAG_ALLOCATED) != 0 && buf1[i] != buf2[i]) {
-      uint8_t bitmask = is_isp(p)? get_fuse_bitmask(a): avr_mem_bitmask(p, a, i);
-
-      if(ro || (pgm->readonly && pgm->readonly(pgm, p, a, i))) {
-        if(quell_progress < 2) {
-          if(vroerror < 10) {
-            if(!(verror + vroerror))
-              pmsg_warning("%s verification mismatch%s\n", a->desc,
-                mem_is_in_flash(a)? " in r/o areas, expected for vectors and/or bootloader": "");
-            imsg_warning("  device 0x%02x != input 0x%02x at addr 0x%04x "
-              "(read only location: ignored)\n", buf1[i], buf2[i], i);
-          } else if(vroerror == 10)
-            imsg_warning("  suppressing further mismatches in read-only areas\n");
-        }
-        vroerror++;
-      } else if((buf1[i] & bitmask) != (buf2[i] & bitmask)) {
-        // Mismatch is not just in unused bits
-        if(verror < maxerrs) {
+  for(i = 0; (i = avr_next_mismatch(b->tags, buf1, buf2, i, size)) < size; i++) {
+    uint8_t bitmask = is_isp(p)? get_fuse_bitmask(a): avr_mem_bitmask(p, a, i);
+
+    if(ro || (pgm->readonly && pgm->readonly(pgm, p, a, i))) {
+      if(quell_progress < 2) {
+        if(vroerror < 10) {
           if(!(verror + vroerror))
-            pmsg_warning("%s verification mismatch\n", a->desc);
-          imsg_error("  device 0x%02x != input 0x%02x at addr 0x%04x (error)\n", buf1[i], buf2[i], i);
-        } else if(verror == maxerrs) {
-          imsg_warning("  suppressing further verification errors\n");
-        }
-        verror++;
-        if(verbose < MSG_NOTICE)
-          return -1;
+            pmsg_warning("%s verification mismatch%s\n", a->desc,
+              mem_is_in_flash(a)? " in r/o areas, expected for vectors and/or bootloader": "");
+          imsg_warning("  device 0x%02x != input 0x%02x at addr 0x%04x "
+            "(read only location: ignored)\n", buf1[i], buf2[i], i);
+        } else if(vroerror == 10)
+          imsg_warning("  suppressing further mismatches in read-only areas\n");
+      }
+      vroerror++;
+    } else if((buf1[i] & bitmask) != (buf2[i] & bitmask)) {
+      // Mismatch is not just in unused bits
+      if(verror < maxerrs) {
+        if(!(verror + vroerror))
+          pmsg_warning("%s verification mismatch\n", a->desc);
+        imsg_error("  device 0x%02x != input 0x%02x at addr 0x%04x (error)\n", buf1[i], buf2[i], i);
+      } else if(verror == maxerrs) {
+        imsg_warning("  suppressing further verification errors\n");
+      }
+      verror++;
+      if(verbose < MSG_NOTICE)
+        return -1;
+    } else {
+      // Mismatch is only in unused bits
+      if((buf1[i] | bitmask) != 0xff) {
+        // Programmer returned unused bits as 0, must be the part/programmer
+        pmsg_debug("ignoring mismatch in unused bits of %s\n", a->desc);
+        imsg_debug("(device 0x%02x != input 0x%02x); to prevent this warning fix\n", buf1[i], buf2[i]);
+        imsg_debug("the part or programmer definition in the config file\n");
       } else {
-        // Mismatch is only in unused bits
-        if((buf1[i] | bitmask) != 0xff) {
-          // Programmer returned unused bits as 0, must be the part/programmer
-          pmsg_debug("ignoring mismatch in unused bits of %s\n", a->desc);
-          imsg_debug("(device 0x%02x != input 0x%02x); to prevent this warning fix\n", buf1[i], buf2[i]);
-          imsg_debug("the part or programmer definition in the config file\n");
-        } else {
-          // Programmer returned unused bits as 1, must be the user
-          pmsg_debug("ignoring mismatch in unused bits of %s\n", a->desc);
-          imsg_debug("(device 0x%02x != input 0x%02x); to prevent this warning set\n", buf1[i], buf2[i]);
-          imsg_debug("unused bits to 1 when writing (double check with datasheet)\n");
-        }
+        // Programmer returned unused bits as 1, must be the user
+        pmsg_debug("ignoring mismatch in unused bits of %s\n", a->desc);
+        imsg_debug("(device 0x%02x != input 0x%02x); to prevent this warning set\n", buf1[i], buf2[i]);
+        imsg_debug("unused bits to 1 when writing (double check with datasheet)\n");
       }
     }
   }
@@ -1375,6 +2502,111 @@ int avr_verify_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, co
   return verror? -1: size;
 }
 
+/*
+ * Ask the programmer to confirm contiguous ranges of the input data in v
+ * directly on the device, eg, by comparing a device-side CRC, and clear the
+ * TAG_ALLOCATED tags of confirmed ranges in v so that avr_read_mem() and
+ * avr_verify_mem() skip these. Returns the number of input bytes that still
+ * need reading back from the device.
+ */
+int avr_verify_ranges(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const AVRMEM *a, int size) {
+  AVRMEM *b;
+  int left = 0, rc = -1;
+
+  if(!(b = avr_locate_mem(v, a->desc)))
+    return size;
+  if(size > a->size)
+    size = a->size;
+
+  for(int i = 0, j; i < size; i = j) {
+    if(!tag_isset(b->tags, i)) {
+      j = i + 1;
+      continue;
+    }
+    for(j = i; j < size && tag_isset(b->tags, j); j++)
+      continue;
+
+    uint64_t start = avr_ustimestamp();
+
+    if(pgm->verify_range && (rc = pgm->verify_range(pgm, p, a, i, j - i, b->buf + i)) >= 0)
+      costmodel_note(COST_CRC, a, j - i, avr_ustimestamp() - start);
+    if(rc == 1) {
+      pmsg_debug("%s(): %s [0x%04x, 0x%04x] confirmed by programmer\n", __func__, a->desc, i, j - 1);
+      devcache_update(a, i, j - i, b->buf + i);
+      for(int k = i; k < j; k++)
+        tag_clr(b->tags, k);
+    } else
+      left += j - i;
+    if(rc < 0)                  // Programmer cannot tell: read back the remainder
+      for(; j < size; j++)
+        if(tag_isset(b->tags, j))
+          left++;
+  }
+
+  return left;
+}
+
+/*
+ * Check whether the first size bytes of device memory mem are all 0xff, eg,
+ * to validate a chip erase. Programmers that can compare a range on the
+ * device are asked to confirm it against 0xff; otherwise, or if the range is
+ * not blank, the memory is read back with paged access where available and
+ * checked with is_memset(), which compares with memcmp() and is fast. Returns
+ * 1 if blank, 0 if not with *firstp set to the first non-0xff address, and a
+ * negative value if the memory could not be read.
+ */
+int avr_blank_check(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size, int *firstp) {
+  int rc;
+
+  if(size < 0 || size > mem->size)
+    size = mem->size;
+  if(firstp)
+    *firstp = -1;
+  if(size == 0)
+    return 1;
+
+  if(pgm->verify_range) {
+    unsigned char *ff = mmt_malloc(size);
+
+    memset(ff, 0xff, size);
+    rc = pgm->verify_range(pgm, p, mem, 0, size, ff);
+    mmt_free(ff);
+    if(rc == 1) {
+      pmsg_debug("%s(): %s [0x%04x, 0x%04x] confirmed blank by programmer\n", __func__, mem->desc, 0, size - 1);
+      return 1;
+    }
+  }
+
+  // Read back only the first size bytes
+  AVRPART *v = avr_dup_part_mem(p, mem);
+  AVRMEM *vmem = avr_locate_mem(v, mem->desc);
+
+  if(!vmem) {
+    avr_free_part(v);
+    return LIBAVRDUDE_GENERAL_FAILURE;
+  }
+  memset(vmem->tags, 0, tag_bytes(vmem->size));
+  for(int i = 0; i < size; i++)
+    tag_set(vmem->tags, i);
+
+  rc = avr_read_mem(pgm, p, mem, v);
+  avr_free_part(v);
+  if(rc < 0)
+    return rc;
+
+  if(is_memset(mem->buf, 0xff, size))
+    return 1;
+  if(firstp) {
+    int i = 0;
+
+    while(i < size && mem->buf[i] == 0xff)
+      i++;
+    *firstp = i;
+  }
+
+  return 0;
+}
+
 int avr_get_cycle_count(const PROGRAMMER *pgm, const AVRPART *p, int *cycles) {
   AVRMEM *a;
   unsigned int cycle_count = 0;
@@ -1433,31 +2665,43 @@ int avr_put_cycle_count(const PROGRAMMER *pgm, const AVRPART *p, int cycles) {
   return 0;
 }
 
-// Return temporary string buffer with n bytes from a closed-circuit space
+/*
+ * Return temporary string buffer with n bytes from a closed-circuit space;
+ * the buffer starts with an empty string and ends in a '\0'. Its contents
+ * survive until the space wraps around, ie, for at least 32 kB worth of
+ * further calls. As cx is per thread, so is the space, and allocation is
+ * O(1): the buffers are handed out back-to-back and only the first byte of
+ * the safety margin is checked, which any overrun writing past the end of
+ * the space must touch.
+ */
 char *avr_cc_buffer(size_t n) {
-  size_t avail = sizeof cx->avr_space - AVR_SAFETY_MARGIN;
+  size_t avail = AVR_CC_SPACE;
+  char *ret;
 
-  if(!is_memset(cx->avr_space + avail, 0, AVR_SAFETY_MARGIN)) {
+  if(!cx->avr_space)            // Sessions that never need the space do not pay for it
+    cx->avr_space = mmt_malloc(AVR_CC_SPACE + AVR_SAFETY_MARGIN);
+  if(cx->avr_space[avail]) {
     pmsg_warning("avr_cc_buffer(n) overran; n chosen too small in previous calls? Change and recompile\n");
-    memset(cx->avr_space + avail, 0, AVR_SAFETY_MARGIN);
+    cx->avr_space[avail] = 0;
   }
 
   if(n > avail) {
     pmsg_error("requested size %lu too big for cx->avr_space[%lu+AVR_SAFETY_MARGIN] (change source)\n",
       (unsigned long) n, (unsigned long) avail);
-    cx->avr_s = cx->avr_space;
     n = avail;
-  } else if(!cx->avr_s)
-    cx->avr_s = cx->avr_space;
-
-  cx->avr_s += strlen(cx->avr_s) + 1;   // Move behind string from last call
+  }
+  if(!n)
+    n = 1;
 
   // Rewind if too little space left
-  if((size_t) (cx->avr_s - cx->avr_space) > avail - n)
+  if(!cx->avr_s || (size_t) (cx->avr_s - cx->avr_space) > avail - n)
     cx->avr_s = cx->avr_space;
 
-  memset(cx->avr_s, 0, n);
-  return cx->avr_s;
+  ret = cx->avr_s;
+  cx->avr_s += n;
+  ret[0] = ret[n - 1] = 0;
+
+  return ret;
 }
 
 /*
@@ -1677,7 +2921,19 @@ int avr_mem_might_be_known(const char *str) {
 int avr_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   pmsg_debug("%s(%s, %s)\n", __func__, pgmid, p->id);
 
-  return led_chip_erase(pgm, p);
+  int span = avr_span_begin("chip erase", NULL);
+  int rc = led_chip_erase(pgm, p);
+
+  avr_span_end(span, -1);
+  // Bootloaders only emulate chip erase, so only trust physical programmers to leave flash blank
+  mmt_free(cx->avr_blank_map);
+  cx->avr_blank_map = NULL;
+  cx->avr_flash_erased = rc >= 0 && !is_spm(pgm);
+  if(cx->avr_flash_erased)
+    devcache_erased();
+  else
+    devcache_forget(NULL, 0, -1);
+  return rc;
 }
 
 int avr_unlock(const PROGRAMMER *pgm, const AVRPART *p) {
@@ -1685,6 +2941,7 @@ int avr_unlock(const PROGRAMMER *pgm, const AVRPART *p) {
 
   if(pgm->unlock)
     rc = pgm->unlock(pgm, p);
+  devcache_forget(NULL, 0, -1);
 
   return rc;
 }
@@ -1776,16 +3033,52 @@ int avr_unlock(const PROGRAMMER *pgm, const AVRPART *p) {
  *
  */
 
+static int progress_percent(int completed, int total) {
+  return
+    completed >= total || total <= 0? 100:
+    completed < 0? 0: completed < INT_MAX/100? 100*completed/total: completed/(total/100);
+}
+
+// Smallest completed count that yields a percentage above percent
+static int progress_next(int completed, int total, int percent) {
+  int lo = completed < 0? 0: completed + 1, hi = total;
+
+  if(percent >= 100 || total <= 0 || lo >= total)
+    return percent >= 100? INT_MAX: total;
+  while(lo < hi) {              // Percentage is monotonic in completed
+    int mid = lo + (hi - lo)/2;
+
+    if(progress_percent(mid, total) > percent)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
 void report_progress(int completed, int total, const char *hdr) {
   int percent;
   double t;
 
-  if(update_progress == NULL)
+  if(update_progress == NULL && !cx->avr_prog_slot)
     return;
 
-  percent =
-    completed >= total || total <= 0? 100:
-    completed < 0? 0: completed < INT_MAX/100? 100*completed/total: completed/(total/100);
+  // Nothing to show until the percentage can change: skip the timestamp
+  if(!hdr && total == cx->avr_prog_total && completed < cx->avr_prog_next)
+    return;
+
+  percent = progress_percent(completed, total);
+
+  if(cx->avr_prog_slot) {       // Publish to gang parent: one writer per slot, no locking
+    if(hdr)
+      cx->avr_prog_phase++;
+    *cx->avr_prog_slot = cx->avr_prog_phase*128 + percent;
+    if(update_progress == NULL) {
+      cx->avr_prog_total = total;
+      cx->avr_prog_next = progress_next(completed, total, percent);
+      return;
+    }
+  }
 
   t = avr_timestamp();
 
@@ -1796,10 +3089,14 @@ void report_progress(int completed, int total, const char *hdr) {
     cx->avr_last_percent = percent;
     update_progress(percent, t - cx->avr_start_time, hdr, total < 0? -1: !!total);
   }
+  cx->avr_prog_total = total;
+  cx->avr_prog_next = progress_next(completed, total, cx->avr_last_percent);
 }
 
 // Output comms buffer
 void trace_buffer(const char *funstr, const unsigned char *buf, size_t buflen) {
+  if(!msg_lvl_on(MSG_TRACE))
+    return;
   pmsg_trace("%s: ", funstr);
   while(buflen--) {
     unsigned char c = *buf++;
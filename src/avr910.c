@@ -45,6 +45,9 @@ struct pdata {
   unsigned char test_blockmode;
   unsigned char use_blockmode;
 
+  char next_mtype;              // Memory type of last block access, 0 if address unknown
+  unsigned long next_addr;      // Auto-incremented address after that block access
+
   int ctype;                    // Cache one byte for flash
   unsigned char cvalue;
   unsigned long caddr;
@@ -105,6 +108,7 @@ static int avr910_vfy_cmd_sent(const PROGRAMMER *pgm, char *errmsg) {
 
 // Issue the 'chip erase' command to the AVR device
 static int avr910_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
+  my.next_mtype = 0;
   EI(avr910_send(pgm, "e", 1));
   if(avr910_vfy_cmd_sent(pgm, "chip erase") < 0)
     return -1;
@@ -126,6 +130,7 @@ static int avr910_leave_prog_mode(const PROGRAMMER *pgm) {
 }
 
 static int avr910_program_enable(const PROGRAMMER *pgm, const AVRPART *p) {
+  my.next_mtype = 0;
   return avr910_enter_prog_mode(pgm);
 }
 
@@ -348,6 +353,7 @@ static void avr910_display(const PROGRAMMER *pgm, const char *p) {
 static void avr910_set_addr(const PROGRAMMER *pgm, unsigned long addr) {
   char cmd[3];
 
+  my.next_mtype = 0;
   cmd[0] = 'A';
   cmd[1] = (addr >> 8) & 0xff;
   cmd[2] = addr & 0xff;
@@ -356,6 +362,17 @@ static void avr910_set_addr(const PROGRAMMER *pgm, unsigned long addr) {
   avr910_vfy_cmd_sent(pgm, "set addr");
 }
 
+/*
+ * Set the address for a block access unless the programmer's auto-increment already left
+ * it there after the previous block access of the same memory type; this saves one round
+ * trip per paged call when consecutive pages are streamed
+ */
+static void avr910_block_addr(const PROGRAMMER *pgm, char mtype, unsigned long addr) {
+  if(my.has_auto_incr_addr == 'Y' && my.next_mtype == mtype && my.next_addr == addr)
+    return;
+  avr910_set_addr(pgm, addr);
+}
+
 static int avr910_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned long addr, unsigned char value) {
 
@@ -537,7 +554,8 @@ static int avr910_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
     else
       my.ctype = 0;             // Invalidate read cache
 
-    avr910_set_addr(pgm, isee? addr: addr >> 1);
+    avr910_block_addr(pgm, isee? 'E': 'F', isee? addr: addr >> 1);
+    my.next_mtype = 0;          // Unknown until all blocks have been written
 
     cmd = mmt_malloc(4 + blocksize);
 
@@ -560,6 +578,8 @@ static int avr910_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       addr += blocksize;
     }
     mmt_free(cmd);
+    my.next_mtype = isee? 'E': 'F';
+    my.next_addr = isee? addr: addr >> 1;
   }
 
   return n_bytes;
@@ -581,14 +601,14 @@ static int avr910_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
   else
     return -2;
 
-  avr910_set_addr(pgm, isee? addr: addr >> 1);
-
   if(my.use_blockmode) {
     // Use buffered mode
     int blocksize = my.buffersize;
 
     cmd[0] = 'g';
     cmd[3] = isee? 'E': 'F';
+    avr910_block_addr(pgm, cmd[3], isee? addr: addr >> 1);
+    my.next_mtype = 0;          // Unknown until all blocks have been read
 
     while(addr < max_addr) {
       if(max_addr - addr < (unsigned int) blocksize)
@@ -602,7 +622,10 @@ static int avr910_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
 
       addr += blocksize;
     }
+    my.next_mtype = cmd[3];
+    my.next_addr = isee? addr: addr >> 1;
   } else {
+    avr910_set_addr(pgm, isee? addr: addr >> 1);
     while(addr < max_addr) {
       EI(avr910_send(pgm, cmd, 1));
       if(!isee) {
@@ -666,6 +689,8 @@ void avr910_initpgm(PROGRAMMER *pgm) {
 
   pgm->paged_write = avr910_paged_write;
   pgm->paged_load = avr910_paged_load;
+  pgm->multipage_write = 1;
+  pgm->multipage_load = 1;
 
   pgm->read_sig_bytes = avr910_read_sig_bytes;
 
@@ -17,7 +17,10 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 
+#include <ac_cfg.h>
+#include "avrdude.h"
 #include "libavrdude.h"
 
 /*
@@ -632,7 +635,7 @@ static int bitmask_first_chr(const char *bits, int chr) {
 }
 
 // Return first match of opcode that is compatible with avrlevel or MNEMO_NONE
-AVR_mnemo opcode_mnemo(int op, int avrlevel) {
+static AVR_mnemo opcode_mnemo_scan(int op, int avrlevel) {
   for(AVR_mnemo i = 0; i < MNEMO_N; i++)
     if(avr_opcodes[i].avrlevel & avrlevel)
       if(op16_is_mnemo(op, i)) {
@@ -650,6 +653,39 @@ AVR_mnemo opcode_mnemo(int op, int avrlevel) {
   return MNEMO_NONE;
 }
 
+/*
+ * As above but, after a few lookups for the same avrlevel, use a table that
+ * has the decoded mnemonic of every 16-bit opcode so disassembly and opcode
+ * checks of large flash images cost a single lookup per opcode
+ */
+AVR_mnemo opcode_mnemo(int op, int avrlevel) {
+  int i;
+
+  for(i = 0; i < OPC_NTABS; i++)
+    if(cx->opc_levels[i] == avrlevel && cx->opc_calls[i])
+      break;
+  if(i == OPC_NTABS) {          // Not seen yet: take a free slot or the last one
+    for(i = 0; i < OPC_NTABS - 1; i++)
+      if(!cx->opc_calls[i])
+        break;
+    mmt_free(cx->opc_tabs[i]);
+    cx->opc_tabs[i] = NULL;
+    cx->opc_levels[i] = avrlevel;
+    cx->opc_calls[i] = 0;
+  }
+
+  if(!cx->opc_tabs[i]) {
+    if(++cx->opc_calls[i] < 256)
+      return opcode_mnemo_scan(op & 0xffff, avrlevel);
+    int16_t *tab = cx->opc_tabs[i] = mmt_malloc(65536*sizeof *tab);
+
+    for(int o = 0; o < 65536; o++)
+      tab[o] = opcode_mnemo_scan(o, avrlevel);
+  }
+
+  return cx->opc_tabs[i][op & 0xffff];
+}
+
 // Is 16-bit opcode valid for AVR part with avrlevel architecture?
 int op16_is_valid(int op16, int avrlevel) {
   int mnemo = opcode_mnemo(op16, avrlevel);
@@ -0,0 +1,525 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Asynchronous operation of libavrdude
+ *
+ * avr_read_mem(), avr_write_mem(), do_op() etc block until they are done.
+ * An application that drives several programmers from one event loop, or
+ * that needs to stay responsive while programming, creates one session per
+ * programmer with avr_session_new(). Each session has a worker thread with
+ * its own libavrdude context and thread-local variables (see the notes on
+ * cx in libavrdude.h) that executes the operations started with
+ * avr_async_*() one after the other in the order they were started. The
+ * worker starts with the verbosity and other options of avrdude.h that the
+ * thread calling avr_session_new() had; changing them later, eg, with the
+ * terminal verbose command inside the session, only affects that session.
+ * Everything that touches the programmer, including pgm->open() and
+ * pgm->initialize(), should therefore go through the session, if need be
+ * with avr_async_call() and a function of the application.
+ *
+ * The application learns about completed operations by calling
+ * avr_async_poll(), which runs the completion callbacks in the calling
+ * thread, so these need no locking. avr_session_fd() returns a file
+ * descriptor that becomes readable whenever an operation has completed;
+ * it can be added to the poll()/select() set of the event loop.
+ * avr_async_progress() returns the progress percentage of an operation
+ * from the report_progress() calls of the worker; applications that use
+ * the asynchronous interface should leave update_progress NULL or make
+ * that function thread safe, and the same goes for avrdude_message2().
+ *
+ * Operations that are still waiting in the queue can be cancelled; the
+ * worker cannot interrupt an operation that is already running. Without
+ * POSIX threads (eg, on Windows) operations execute synchronously when
+ * they are started, and their callbacks run with the next poll.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#define AVR_ASYNC_THREADS 1
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+typedef enum {
+  ASYNC_CALL,
+  ASYNC_READ,
+  ASYNC_WRITE,
+  ASYNC_VERIFY,
+  ASYNC_DO_OP,
+} Async_kind;
+
+struct avr_async_op {
+  Avr_session *sess;
+  Async_kind kind;
+  int state;                    // AVR_ASYNC_PENDING, ..., AVR_ASYNC_CANCELLED
+  int rc;                       // Return value of the operation once completed
+  volatile int progress;        // Gang-style progress slot: phase*128 + percent
+  const AVRMEM *mem;
+  const AVRPART *v;
+  int size, auto_erase;
+  const UPDATE *upd;
+  enum updateflags flags;
+  Avr_async_fn fn;
+  void *arg;
+  Avr_async_cb cb;
+  void *ud;
+  Avr_async_op *next;
+};
+
+struct avr_session {
+  PROGRAMMER *pgm;
+  const AVRPART *p;
+  Avr_opts opts;                // Options of the creating thread for the worker
+  Avr_async_op *ops, *last;     // All operations not yet reported or freed, oldest first
+#ifdef AVR_ASYNC_THREADS
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;          // Signals new operations to the worker and completions to waiters
+  int notify[2];                // Pipe that receives one byte per completed operation
+  int quit;
+#endif
+};
+
+#ifdef AVR_ASYNC_THREADS
+#define async_lock(s)   pthread_mutex_lock(&(s)->lock)
+#define async_unlock(s) pthread_mutex_unlock(&(s)->lock)
+#else
+#define async_lock(s)   (void) (s)
+#define async_unlock(s) (void) (s)
+#endif
+
+// Execute the operation in the context of the session worker
+static int async_run(Avr_async_op *op) {
+  PROGRAMMER *pgm = op->sess->pgm;
+  const AVRPART *p = op->sess->p;
+  AVRMEM *m;
+  int rc;
+
+  switch(op->kind) {
+  case ASYNC_CALL:
+    return op->fn(pgm, p, op->arg);
+  case ASYNC_READ:
+    report_progress(0, 1, "Reading");
+    rc = avr_read_mem(pgm, p, op->mem, op->v);
+    report_progress(1, 1, NULL);
+    return rc;
+  case ASYNC_WRITE:
+    report_progress(0, 1, "Writing");
+    rc = avr_write_mem(pgm, p, op->mem, op->size, op->auto_erase);
+    report_progress(1, 1, NULL);
+    return rc;
+  case ASYNC_VERIFY:
+    if(!(m = avr_locate_mem(op->v, op->mem->desc))) {
+      pmsg_error("memory %s not defined for part %s\n", op->mem->desc, op->v->desc);
+      return LIBAVRDUDE_GENERAL_FAILURE;
+    }
+    report_progress(0, 1, "Reading");
+    rc = avr_read_mem(pgm, p, op->mem, op->v);
+    report_progress(1, 1, NULL);
+    if(rc < 0)
+      return rc;
+    return avr_verify_mem(pgm, p, op->v, op->mem, op->size);
+  case ASYNC_DO_OP:
+    return do_op(pgm, p, op->upd, op->flags);
+  }
+
+  return LIBAVRDUDE_GENERAL_FAILURE;
+}
+
+static void async_execute(Avr_async_op *op) {
+  cx->avr_prog_slot = &op->progress;    // Publish progress without calling update_progress()
+  cx->avr_prog_phase = 0;
+  int rc = async_run(op);
+
+  cx->avr_prog_slot = NULL;
+
+  async_lock(op->sess);
+  op->rc = rc;
+  op->state = AVR_ASYNC_DONE;
+#ifdef AVR_ASYNC_THREADS
+  pthread_cond_broadcast(&op->sess->cond);
+  if(write(op->sess->notify[1], "", 1) < 0) {
+    // Pipe full: the application has enough to poll for
+  }
+#endif
+  async_unlock(op->sess);
+}
+
+#ifdef AVR_ASYNC_THREADS
+static Avr_async_op *async_next(const Avr_session *s) {
+  for(Avr_async_op *op = s->ops; op; op = op->next)
+    if(op->state == AVR_ASYNC_PENDING)
+      return op;
+
+  return NULL;
+}
+
+static void *async_worker(void *arg) {
+  Avr_session *s = arg;
+  Avr_async_op *op;
+
+  init_cx(NULL);                // The worker's own context
+  avr_opts_load(&s->opts);
+  async_lock(s);
+  for(;;) {
+    while(!(op = async_next(s)) && !s->quit)
+      pthread_cond_wait(&s->cond, &s->lock);
+    if(!op)
+      break;
+    op->state = AVR_ASYNC_RUNNING;
+    async_unlock(s);
+    async_execute(op);
+    async_lock(s);
+  }
+  async_unlock(s);
+  free_cx();
+
+  return NULL;
+}
+#endif
+
+/*
+ * Create a session for operations on part p through programmer pgm; the
+ * session must be the only user of pgm until avr_session_free(). Returns
+ * NULL if the worker cannot be started.
+ */
+Avr_session *avr_session_new(PROGRAMMER *pgm, const AVRPART *p) {
+  Avr_session *s = mmt_malloc(sizeof *s);
+
+  s->pgm = pgm;
+  s->p = p;
+  avr_opts_save(&s->opts);
+#ifdef AVR_ASYNC_THREADS
+  if(pipe(s->notify) < 0) {
+    pmsg_ext_error("cannot create notification pipe: %s\n", strerror(errno));
+    mmt_free(s);
+    return NULL;
+  }
+  for(int i = 0; i < 2; i++)
+    fcntl(s->notify[i], F_SETFL, fcntl(s->notify[i], F_GETFL) | O_NONBLOCK);
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->cond, NULL);
+  int rc = pthread_create(&s->worker, NULL, async_worker, s);
+
+  if(rc) {
+    pmsg_error("cannot start session worker: %s\n", strerror(rc));
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    close(s->notify[0]);
+    close(s->notify[1]);
+    mmt_free(s);
+    return NULL;
+  }
+#endif
+
+  return s;
+}
+
+/*
+ * Cancel the operations still waiting, wait for the running one to finish,
+ * stop the worker and free the session together with all its operations;
+ * no more callbacks are run
+ */
+void avr_session_free(Avr_session *s) {
+  if(!s)
+    return;
+
+  async_lock(s);
+  for(Avr_async_op *op = s->ops; op; op = op->next)
+    if(op->state == AVR_ASYNC_PENDING)
+      op->state = AVR_ASYNC_CANCELLED;
+#ifdef AVR_ASYNC_THREADS
+  s->quit = 1;
+  pthread_cond_broadcast(&s->cond);
+#endif
+  async_unlock(s);
+
+#ifdef AVR_ASYNC_THREADS
+  pthread_join(s->worker, NULL);
+  pthread_cond_destroy(&s->cond);
+  pthread_mutex_destroy(&s->lock);
+  close(s->notify[0]);
+  close(s->notify[1]);
+#endif
+
+  for(Avr_async_op *op = s->ops, *nxt; op; op = nxt) {
+    nxt = op->next;
+    mmt_free(op);
+  }
+  mmt_free(s);
+}
+
+// File descriptor that becomes readable when an operation has completed, -1 if there is none
+int avr_session_fd(const Avr_session *s) {
+#ifdef AVR_ASYNC_THREADS
+  return s->notify[0];
+#else
+  (void) s;
+  return -1;
+#endif
+}
+
+static Avr_async_op *async_start(Avr_session *s, Async_kind kind, Avr_async_cb cb, void *ud) {
+  Avr_async_op *op = mmt_malloc(sizeof *op);
+
+  op->sess = s;
+  op->kind = kind;
+  op->state = AVR_ASYNC_PENDING;
+  op->progress = -1;
+  op->cb = cb;
+  op->ud = ud;
+
+  return op;
+}
+
+// Queue the operation for the worker
+static Avr_async_op *async_queue(Avr_async_op *op) {
+  Avr_session *s = op->sess;
+
+  async_lock(s);
+  if(s->last)
+    s->last->next = op;
+  else
+    s->ops = op;
+  s->last = op;
+#ifdef AVR_ASYNC_THREADS
+  pthread_cond_broadcast(&s->cond);
+#endif
+  async_unlock(s);
+
+#ifndef AVR_ASYNC_THREADS
+  op->state = AVR_ASYNC_RUNNING;
+  async_execute(op);
+#endif
+
+  return op;
+}
+
+// Run fn(pgm, p, arg) in the worker, eg, to open and initialise the programmer
+Avr_async_op *avr_async_call(Avr_session *s, Avr_async_fn fn, void *arg, Avr_async_cb cb, void *ud) {
+  Avr_async_op *op = async_start(s, ASYNC_CALL, cb, ud);
+
+  op->fn = fn;
+  op->arg = arg;
+
+  return async_queue(op);
+}
+
+// Start avr_read_mem() of memory mem; buffers must not be touched until completion
+Avr_async_op *avr_async_read_mem(Avr_session *s, const AVRMEM *mem, const AVRPART *v,
+  Avr_async_cb cb, void *ud) {
+
+  Avr_async_op *op = async_start(s, ASYNC_READ, cb, ud);
+
+  op->mem = mem;
+  op->v = v;
+
+  return async_queue(op);
+}
+
+// Start avr_write_mem() of the first size bytes of memory mem
+Avr_async_op *avr_async_write_mem(Avr_session *s, const AVRMEM *mem, int size, int auto_erase,
+  Avr_async_cb cb, void *ud) {
+
+  Avr_async_op *op = async_start(s, ASYNC_WRITE, cb, ud);
+
+  op->mem = mem;
+  op->size = size;
+  op->auto_erase = auto_erase;
+
+  return async_queue(op);
+}
+
+/*
+ * Start reading memory mem of the session part where v has data and then
+ * comparing it with avr_verify_mem() to the same memory of v
+ */
+Avr_async_op *avr_async_verify_mem(Avr_session *s, const AVRPART *v, const AVRMEM *mem, int size,
+  Avr_async_cb cb, void *ud) {
+
+  Avr_async_op *op = async_start(s, ASYNC_VERIFY, cb, ud);
+
+  op->v = v;
+  op->mem = mem;
+  op->size = size;
+
+  return async_queue(op);
+}
+
+// Start do_op() of upd, which must stay valid until completion
+Avr_async_op *avr_async_do_op(Avr_session *s, const UPDATE *upd, enum updateflags flags,
+  Avr_async_cb cb, void *ud) {
+
+  Avr_async_op *op = async_start(s, ASYNC_DO_OP, cb, ud);
+
+  op->upd = upd;
+  op->flags = flags;
+
+  return async_queue(op);
+}
+
+// Remove op from the list of its session; session must be locked
+static void async_unlink(Avr_async_op *op) {
+  Avr_session *s = op->sess;
+  Avr_async_op *prev = NULL;
+
+  for(Avr_async_op *o = s->ops; o; prev = o, o = o->next)
+    if(o == op) {
+      if(prev)
+        prev->next = op->next;
+      else
+        s->ops = op->next;
+      if(s->last == op)
+        s->last = prev;
+      op->next = NULL;
+      break;
+    }
+}
+
+/*
+ * Run the callbacks of completed or cancelled operations in the calling
+ * thread and free these operations; operations without callback remain until
+ * avr_async_free(). Returns the number of operations still waiting or running.
+ */
+int avr_async_poll(Avr_session *s) {
+  Avr_async_op *done = NULL, **tail = &done;
+  int busy = 0;
+
+#ifdef AVR_ASYNC_THREADS
+  char drain[64];
+
+  while(read(s->notify[0], drain, sizeof drain) > 0)
+    continue;
+#endif
+
+  async_lock(s);
+  for(Avr_async_op *op = s->ops, *nxt; op; op = nxt) {
+    nxt = op->next;
+    if(op->state == AVR_ASYNC_PENDING || op->state == AVR_ASYNC_RUNNING)
+      busy++;
+    else if(op->cb) {
+      async_unlink(op);
+      *tail = op;
+      tail = &op->next;
+    }
+  }
+  async_unlock(s);
+
+  // Callbacks may start new operations, so they run without the lock
+  for(Avr_async_op *op = done, *nxt; op; op = nxt) {
+    nxt = op->next;
+    op->cb(op, op->rc, op->ud);
+    mmt_free(op);
+  }
+
+  return busy;
+}
+
+// State of op: AVR_ASYNC_PENDING, AVR_ASYNC_RUNNING, AVR_ASYNC_DONE or AVR_ASYNC_CANCELLED
+int avr_async_state(const Avr_async_op *op) {
+  async_lock(op->sess);
+  int ret = op->state;
+
+  async_unlock(op->sess);
+
+  return ret;
+}
+
+// Return value of the completed operation, LIBAVRDUDE_GENERAL_FAILURE if cancelled or not done
+int avr_async_result(const Avr_async_op *op) {
+  async_lock(op->sess);
+  int ret = op->state == AVR_ASYNC_DONE? op->rc: LIBAVRDUDE_GENERAL_FAILURE;
+
+  async_unlock(op->sess);
+
+  return ret;
+}
+
+// Percentage of op done in [0, 100] as reported by the library, -1 if it has not started
+int avr_async_progress(const Avr_async_op *op) {
+  int state = avr_async_state(op), slot = op->progress;
+
+  return
+    state == AVR_ASYNC_DONE? 100:
+    state != AVR_ASYNC_RUNNING? -1:
+    slot < 0? 0: slot % 128;
+}
+
+// Block until op has completed or was cancelled; returns the result of the operation
+int avr_async_wait(Avr_async_op *op) {
+#ifdef AVR_ASYNC_THREADS
+  Avr_session *s = op->sess;
+
+  async_lock(s);
+  while(op->state == AVR_ASYNC_PENDING || op->state == AVR_ASYNC_RUNNING)
+    pthread_cond_wait(&s->cond, &s->lock);
+  async_unlock(s);
+#endif
+
+  return avr_async_result(op);
+}
+
+// Cancel an operation that has not yet started; returns 0 on success and -1 otherwise
+int avr_async_cancel(Avr_async_op *op) {
+  Avr_session *s = op->sess;
+  int ret = -1;
+
+  async_lock(s);
+  if(op->state == AVR_ASYNC_PENDING) {
+    op->state = AVR_ASYNC_CANCELLED;
+    op->rc = LIBAVRDUDE_GENERAL_FAILURE;
+    ret = 0;
+#ifdef AVR_ASYNC_THREADS
+    pthread_cond_broadcast(&s->cond);
+    if(write(s->notify[1], "", 1) < 0) {
+      // Pipe full: the application has enough to poll for
+    }
+#endif
+  }
+  async_unlock(s);
+
+  return ret;
+}
+
+// Free a completed or cancelled operation without callback; returns -1 if it is still busy
+int avr_async_free(Avr_async_op *op) {
+  Avr_session *s = op->sess;
+  int ret = -1;
+
+  async_lock(s);
+  if(op->state == AVR_ASYNC_DONE || op->state == AVR_ASYNC_CANCELLED) {
+    async_unlink(op);
+    ret = 0;
+  }
+  async_unlock(s);
+  if(!ret)
+    mmt_free(op);
+
+  return ret;
+}
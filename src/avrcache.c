@@ -37,6 +37,12 @@
  * int avr_write_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const
  *  AVRMEM *mem, unsigned long addr, unsigned char data);
  *
+ * int avr_read_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const
+ *   AVRMEM *mem, unsigned long addr, int len, unsigned char *buf);
+ *
+ * int avr_write_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const
+ *   AVRMEM *mem, unsigned long addr, int len, const unsigned char *buf);
+ *
  * int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p);
  *
  * int avr_chip_erase_cached(const PROGRAMMER *pgm, const AVRPART *p);
@@ -57,10 +63,16 @@
  * Bytewise cached write with an address in memory range only ever modifies
  * the cache. Any modifications are written to the device after calling
  * avr_flush_cache() or when attempting to read or write from a location
- * outside the address range of the device memory.
+ * outside the address range of the device memory. avr_read_range_cached()
+ * and avr_write_range_cached() do the same for a whole range inside the
+ * memory, copying from/to the cache pages and loading missing pages in
+ * batches, rather than going through the bytewise functions for each byte.
  *
  * avr_flush_cache() synchronises pending writes to flash, EEPROM, bootrow
- * and usersig with the device. With some programmer and part combinations,
+ * and usersig with the device. avr_write_byte_cached() marks the pages it
+ * modifies as dirty so that only these need comparing with the device copy,
+ * and runs of consecutive modified pages are written with one paged_write()
+ * call if the programmer can stream several pages. With some programmer and part combinations,
  * flash (and sometimes EEPROM, too) looks like a NOR memory, ie, a write can
  * only clear bits, never set them. For NOR memories a page erase or, if not
  * available, a chip erase needs to be issued before writing arbitrary data.
@@ -96,11 +108,24 @@
  * Finally, avr_reset_cache() resets the cache without synchronising pending
  * writes() to the device.
  *
+ * The cache is sparse: a page table holds for each loaded page its current
+ * contents followed by its device copy, allocated when the page is first
+ * needed; pages known to be blank after a chip erase take no memory until
+ * they are written to. avr_cache_limit() sets the number of bytes that the
+ * pages of each cache may occupy, eg, to bound the memory of processes that
+ * hold many sessions; once the limit is reached, loading a new page evicts
+ * the least recently used clean page that the current operation has not
+ * touched. Pages with pending writes are never evicted, so the limit can be
+ * exceeded temporarily, as can a single operation that needs more pages.
+ *
  * This file also holds the following utility functions
  *
  * // Does the programmer/memory combo have paged memory access?
  * int avr_has_paged_access(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem);
  *
+ * // Number of consecutive pages of mem that one paged_load() call should read
+ * int avr_load_maxrun(const PROGRAMMER *pgm, const AVRMEM *mem);
+ *
  * // Read the page containing addr from the device into buf
  * int avr_read_page_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int addr, unsigned char *buf);
  *
@@ -128,6 +153,16 @@ int avr_has_paged_access(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *
     mem->size > 0 && mem->size%mem->page_size == 0 && mem_is_paged_type(mem) && !(p && avr_mem_exclude(pgm, p, mem));
 }
 
+/*
+ * Programmers that can stream consecutive pages receive runs of up to
+ * pgm->max_load bytes, 4096 bytes unless initpgm() says otherwise
+ */
+int avr_load_maxrun(const PROGRAMMER *pgm, const AVRMEM *mem) {
+  int pgsz = mem->page_size, max = pgm->max_load > 0? pgm->max_load: 4096;
+
+  return !pgm->multipage_load || pgsz <= 1 || pgsz >= max? 1: max/pgsz;
+}
+
 #define fallback_read_byte (pgm->read_byte != avr_read_byte_cached? led_read_byte: avr_read_byte_default)
 #define fallback_write_byte (pgm->write_byte != avr_write_byte_cached? led_write_byte: avr_write_byte_default)
 
@@ -156,7 +191,7 @@ int avr_read_page_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   unsigned char *pagecopy = mmt_malloc(pgsize);
 
   memcpy(pagecopy, mem->buf + base, pgsize);
-  if((rc = pgm->paged_load(pgm, p, mem, pgsize, base, pgsize)) >= 0)
+  if((rc = avr_paged_load(pgm, p, mem, pgsize, base, pgsize)) >= 0)
     memcpy(buf, mem->buf + base, pgsize);
   memcpy(mem->buf + base, pagecopy, pgsize);
 
@@ -199,7 +234,7 @@ int avr_write_page_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
 
   memcpy(pagecopy, mem->buf + base, pgsize);
   memcpy(mem->buf + base, data, pgsize);
-  rc = pgm->paged_write(pgm, p, mem, pgsize, base, pgsize);
+  rc = avr_paged_write(pgm, p, mem, pgsize, base, pgsize);
   memcpy(mem->buf + base, pagecopy, pgsize);
   mmt_free(pagecopy);
 
@@ -231,6 +266,118 @@ static int cacheAddress(int addr, const AVR_Cache *cp, const AVRMEM *mem) {
   return cacheaddr;
 }
 
+// Limit the memory of each cache's pages to about bytes; 0 means no limit
+void avr_cache_limit(long bytes) {
+  cx->avc_limit = bytes > 0? bytes: 0;
+}
+
+// Start a cache operation: pages used from now on must not be evicted until the next one
+static void beginCacheOp(AVR_Cache *cp) {
+  cp->epoch = ++cp->clock;
+}
+
+// Does cache page pgno at address n hold changes not yet on the device?
+static int pageDirty(const AVR_Cache *cp, int pgno, int n) {
+  unsigned char *pg = cp->pages[pgno];
+
+  return cp->iscached[pgno] && cp->isdirty[pgno] && pg && memcmp(pg + cp->page_size, pg, cp->page_size);
+}
+
+// Free page pgno, which then is no longer cached
+static void dropPage(AVR_Cache *cp, int pgno) {
+  if(cp->pages[pgno]) {
+    mmt_free(cp->pages[pgno]);
+    cp->pages[pgno] = NULL;
+    cp->nresident--;
+  }
+  cp->iscached[pgno] = 0;
+  cp->isdirty[pgno] = 0;
+}
+
+// Free all pages; those still marked cached are blank on the device and in the cache
+static void freePages(AVR_Cache *cp) {
+  for(int pgno = 0; pgno < cp->size/cp->page_size; pgno++)
+    if(cp->pages[pgno]) {
+      mmt_free(cp->pages[pgno]);
+      cp->pages[pgno] = NULL;
+    }
+  cp->nresident = 0;
+}
+
+// Evict least recently used clean pages that the current operation has not used
+static void evictPages(AVR_Cache *cp) {
+  size_t limit = cx->avc_limit;
+
+  while(limit && (size_t) (cp->nresident + 1)*2*cp->page_size > limit) {
+    int lru = -1;
+
+    for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size)
+      if(cp->pages[pgno] && cp->lastuse[pgno] < cp->epoch && !pageDirty(cp, pgno, n) &&
+        (lru < 0 || cp->lastuse[pgno] < cp->lastuse[lru]))
+        lru = pgno;
+    if(lru < 0)
+      break;
+    dropPage(cp, lru);
+  }
+}
+
+// Cache page pgno: page_size bytes contents followed by the device copy; a new page is blank
+static unsigned char *cachePage(AVR_Cache *cp, int pgno) {
+  if(!cp->pages[pgno]) {
+    evictPages(cp);
+    cp->pages[pgno] = mmt_malloc(2*cp->page_size);
+    memset(cp->pages[pgno], 0xff, 2*cp->page_size);
+    cp->nresident++;
+  }
+  cp->lastuse[pgno] = ++cp->clock;
+
+  return cp->pages[pgno];
+}
+
+// Pointer to cache address n in the cache contents and in the device copy, respectively
+static unsigned char *pageCont(AVR_Cache *cp, int n) {
+  return cachePage(cp, n/cp->page_size) + n%cp->page_size;
+}
+
+static unsigned char *pageCopy(AVR_Cache *cp, int n) {
+  return cachePage(cp, n/cp->page_size) + cp->page_size + n%cp->page_size;
+}
+
+// Record the device copy of all cached pages as erased
+static void setCopyBlank(AVR_Cache *cp) {
+  for(int pgno = 0; pgno < cp->size/cp->page_size; pgno++)
+    if(cp->pages[pgno])
+      memset(cp->pages[pgno] + cp->page_size, 0xff, cp->page_size);
+}
+
+/*
+ * Read npages consecutive cache pages from cachebase (being mem address base)
+ * with one paged_load() call; mem->buf is unaffected (though temporarily changed)
+ */
+static int loadCachePages(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  int base, int cachebase, int npages) {
+
+  int rc, len = npages*cp->page_size;
+  unsigned char *save = mmt_malloc(len);
+
+  led_clr(pgm, LED_ERR);
+  led_set(pgm, LED_PGM);
+  memcpy(save, mem->buf + base, len);
+  if((rc = avr_paged_load(pgm, p, mem, cp->page_size, base, len)) >= 0) {
+    for(int n = 0; n < len; n += cp->page_size) {
+      memcpy(pageCont(cp, cachebase + n), mem->buf + base + n, cp->page_size);
+      memcpy(pageCopy(cp, cachebase + n), mem->buf + base + n, cp->page_size);
+    }
+    memset(cp->iscached + cachebase/cp->page_size, 1, npages);
+    memset(cp->isdirty + cachebase/cp->page_size, 0, npages);
+  }
+  memcpy(mem->buf + base, save, len);
+  mmt_free(save);
+  led_clr(pgm, LED_PGM);
+
+  return rc < 0? LIBAVRDUDE_GENERAL_FAILURE: LIBAVRDUDE_SUCCESS;
+}
+
 static int loadCachePage(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   int addr, int cacheaddr, int nlOnErr) {
 
@@ -239,8 +386,37 @@ static int loadCachePage(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p,
   if(!cp->iscached[pgno]) {
     // Read cached section from device
     int cachebase = cacheaddr & ~(cp->page_size - 1);
+    int base = addr & ~(cp->page_size - 1);
+    const unsigned char *known = devcache_page(mem, base);
+
+    if(known) {                 // Persistent device cache knows the page
+      memcpy(pageCont(cp, cachebase), known, cp->page_size);
+      memcpy(pageCopy(cp, cachebase), known, cp->page_size);
+      cp->iscached[pgno] = 1;
+      cp->isdirty[pgno] = 0;
+      return LIBAVRDUDE_SUCCESS;
+    }
+
+    // Sequential misses double the read-ahead up to avr_load_maxrun() pages, others reset it
+    if(pgno == cp->nextpg && pgm->multipage_load && cp->page_size > 1) {
+      int maxahead = avr_load_maxrun(pgm, mem);
+
+      cp->ahead = cp->ahead < 1? 2: cp->ahead*2 > maxahead? maxahead: cp->ahead*2;
+    } else {
+      cp->ahead = 1;
+    }
+    int npages = 1;
+
+    while(npages < cp->ahead && cachebase + (npages + 1)*cp->page_size <= cp->size &&
+      base + (npages + 1)*cp->page_size <= mem->size && !cp->iscached[pgno + npages] &&
+      !devcache_page(mem, base + npages*cp->page_size))
+      npages++;
+    cp->nextpg = pgno + npages;
 
-    if(avr_read_page_default(pgm, p, mem, addr & ~(cp->page_size - 1), cp->cont + cachebase) < 0) {
+    if(npages > 1 && loadCachePages(cp, pgm, p, mem, base, cachebase, npages) == LIBAVRDUDE_SUCCESS)
+      return LIBAVRDUDE_SUCCESS;
+
+    if(avr_read_page_default(pgm, p, mem, base, pageCont(cp, cachebase)) < 0) {
       report_progress(1, -1, NULL);
       if(nlOnErr && quell_progress)
         msg_info("\n");
@@ -248,8 +424,9 @@ static int loadCachePage(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p,
       return LIBAVRDUDE_GENERAL_FAILURE;
     }
     // Copy last read device page, so we can later check for changes
-    memcpy(cp->copy + cachebase, cp->cont + cachebase, cp->page_size);
+    memcpy(pageCopy(cp, cachebase), pageCont(cp, cachebase), cp->page_size);
     cp->iscached[pgno] = 1;
+    cp->isdirty[pgno] = 0;
   }
 
   return LIBAVRDUDE_SUCCESS;
@@ -265,9 +442,13 @@ static int initCache(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p) {
   cp->size = basemem->size;
   cp->page_size = basemem->page_size;
   cp->offset = basemem->offset;
-  cp->cont = mmt_malloc(cp->size);
-  cp->copy = mmt_malloc(cp->size);
+  cp->pages = mmt_malloc(cp->size/cp->page_size*sizeof *cp->pages);
+  cp->lastuse = mmt_malloc(cp->size/cp->page_size*sizeof *cp->lastuse);
+  cp->nresident = 0;
   cp->iscached = mmt_malloc(cp->size/cp->page_size);
+  cp->isdirty = mmt_malloc(cp->size/cp->page_size);
+  cp->nextpg = -1;
+  cp->ahead = 1;
 
   if(is_spm(pgm) && mem_is_in_flash(basemem)) {  // Could be vector bootloader
     // Caching the vector page hands over to the progammer that then can patch the reset vector
@@ -281,15 +462,17 @@ static int initCache(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p) {
 static int writeCachePage(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p,
   const AVRMEM *mem, int base, int nlOnErr) {
 
+  unsigned char *cont = pageCont(cp, base), *copy = pageCopy(cp, base);
+
   led_clr(pgm, LED_ERR);
   led_set(pgm, LED_PGM);
   // Write modified page cont to device; if unsuccessful try bytewise access
-  if(avr_write_page_default(pgm, p, mem, base, cp->cont + base) < 0) {
+  if(avr_write_page_default(pgm, p, mem, base, cont) < 0) {
     if(pgm->read_byte != avr_read_byte_cached && pgm->write_byte != avr_write_byte_cached) {
       for(int i = 0; i < cp->page_size; i++)
-        if(cp->cont[base + i] != cp->copy[base + i])
-          if(pgm->write_byte(pgm, p, mem, base + i, cp->cont[base + i]) < 0 ||
-            pgm->read_byte(pgm, p, mem, base + i, cp->copy + base + i) < 0) {
+        if(cont[i] != copy[i])
+          if(pgm->write_byte(pgm, p, mem, base + i, cont[i]) < 0 ||
+            pgm->read_byte(pgm, p, mem, base + i, copy + i) < 0) {
             report_progress(1, -1, NULL);
             if(nlOnErr && quell_progress)
               msg_info("\n");
@@ -306,7 +489,7 @@ static int writeCachePage(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p
     goto error;
   }
   // Read page back from device and update copy to what is on device
-  if(avr_read_page_default(pgm, p, mem, base, cp->copy + base) < 0) {
+  if(avr_read_page_default(pgm, p, mem, base, copy) < 0) {
     report_progress(1, -1, NULL);
     if(nlOnErr && quell_progress)
       msg_info("\n");
@@ -324,6 +507,47 @@ error:
   return LIBAVRDUDE_GENERAL_FAILURE;
 }
 
+// Mark all cached pages as dirty after device-side changes to copy
+static void markCacheDirty(AVR_Cache *cp) {
+  memcpy(cp->isdirty, cp->iscached, cp->size/cp->page_size);
+}
+
+/*
+ * Write npages consecutive modified pages from base to the device with one
+ * paged_write() call if the programmer can stream several pages, otherwise
+ * or on failure page by page; then update copy to what is on the device
+ */
+static int writeCachePages(AVR_Cache *cp, const PROGRAMMER *pgm, const AVRPART *p,
+  const AVRMEM *mem, int base, int npages) {
+
+  int len = npages*cp->page_size, rc = -1;
+
+  if(npages > 1 && pgm->multipage_write && cp->page_size > 1) {
+    unsigned char *save = mmt_malloc(len);
+
+    led_clr(pgm, LED_ERR);
+    led_set(pgm, LED_PGM);
+    memcpy(save, mem->buf + base, len);
+    for(int n = 0; n < len; n += cp->page_size)
+      memcpy(mem->buf + base + n, pageCont(cp, base + n), cp->page_size);
+    rc = avr_paged_write(pgm, p, mem, cp->page_size, base, len);
+    memcpy(mem->buf + base, save, len);
+    mmt_free(save);
+
+    for(int n = base; rc >= 0 && n < base + len; n += cp->page_size)
+      if(avr_read_page_default(pgm, p, mem, n, pageCopy(cp, n)) < 0)
+        rc = -1;
+    led_clr(pgm, LED_PGM);
+  }
+
+  if(rc < 0)
+    for(int n = base; n < base + len; n += cp->page_size)
+      if(writeCachePage(cp, pgm, p, mem, n, 1) < 0)
+        return LIBAVRDUDE_GENERAL_FAILURE;
+
+  return LIBAVRDUDE_SUCCESS;
+}
+
 // A coarse guess where any bootloader might start (prob underestimates the start)
 static int guessBootStart(const PROGRAMMER *pgm, const AVRPART *p) {
   int bootstart = 0;
@@ -346,9 +570,13 @@ static int silent_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
   int bakverb = verbose;
 
   verbose = -123;
+  uint64_t start = avr_ustimestamp();
   int ret = pgm->page_erase? pgm->page_erase(pgm, p, m, a): -1;
 
   verbose = bakverb;
+  if(ret >= 0)
+    costmodel_note(COST_ERASE, m, m->page_size, avr_ustimestamp() - start);
+  devcache_forget(m, a, m->page_size);
 
   return ret;
 }
@@ -356,16 +584,39 @@ static int silent_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
 typedef struct {
   AVRMEM *mem;
   AVR_Cache *cp;
-  int isflash, iseeprom, zopaddr, pgerase;
+  int isflash, iseeprom, zopaddr, pgerase, cesafe;
 } Cache_desc;
 
+// Does the EESAVE configuration of the part preserve EEPROM during chip erase?
+static int eepromSurvivesCE(const PROGRAMMER *pgm, const AVRPART *p) {
+  int nc = 0, fusel = 0;
+  const Configitem *cfg = avr_locate_configitems(p, &nc), *c;
+  AVRMEM *mem;
+
+  if(!cfg || nc < 1 || !(c = avr_locate_config(cfg, nc, "eesave", str_eq)))
+    return 0;
+  if(!(mem = avr_locate_fuse_by_offset(p, c->memoffset)) || mem->size < 1 || mem->size > 4)
+    return 0;
+  for(int i = 0; i < mem->size; i++)
+    if(led_read_byte(pgm, p, mem, i, (unsigned char *) &fusel + i) < 0)
+      return 0;
+
+  int value = (fusel & c->mask) >> c->lsh;
+
+  for(int i = 0; i < c->nvalues; i++)
+    if(c->vlist[i].value == value)
+      return str_contains(c->vlist[i].label, "preserved");
+
+  return 0;
+}
+
 // Write flash, EEPROM, bootrow and usersig caches to device and free them
 int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
   Cache_desc mems[] = {
-    {avr_locate_flash(p), pgm->cp_flash, 1, 0, -1, 0},
-    {avr_locate_eeprom(p), pgm->cp_eeprom, 0, 1, -1, 0},
-    {avr_locate_bootrow(p), pgm->cp_bootrow, 0, 0, -1, 0},
-    {avr_locate_usersig(p), pgm->cp_usersig, 0, 0, -1, 0},
+    {avr_locate_flash(p), pgm->cp_flash, 1, 0, -1, 0, 0},
+    {avr_locate_eeprom(p), pgm->cp_eeprom, 0, 1, -1, 0, 0},
+    {avr_locate_bootrow(p), pgm->cp_bootrow, 0, 0, -1, 0, 0},
+    {avr_locate_usersig(p), pgm->cp_usersig, 0, 0, -1, 0, 0},
   };
 
   int chpages = 0;
@@ -379,16 +630,18 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
     AVRMEM *mem = mems[i].mem;
     AVR_Cache *cp = mems[i].cp;
 
-    if(!mem || !cp->cont)
+    if(!mem || !cp->pages)
       continue;
 
+    beginCacheOp(cp);
     for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size) {
-      if(cp->iscached[pgno])
-        if(memcmp(cp->copy + n, cp->cont + n, cp->page_size)) {
-          chpages++;
-          if(mems[i].zopaddr == -1 && !avr_is_and(cp->cont + n, cp->copy + n, cp->cont + n, cp->page_size))
-            mems[i].zopaddr = n;
-        }
+      if(pageDirty(cp, pgno, n)) {
+        chpages++;
+        if(mems[i].zopaddr == -1 && !avr_is_and(pageCont(cp, n), pageCopy(cp, n), pageCont(cp, n), cp->page_size))
+          mems[i].zopaddr = n;
+      } else {
+        cp->isdirty[pgno] = 0;
+      }
     }
   }
 
@@ -406,7 +659,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
     if(!mem)
       continue;
 
-    if(!cp->cont)               // Ensure cache is initialised from now on
+    if(!cp->pages)              // Ensure cache is initialised from now on
       if(initCache(cp, pgm, p) < 0) {
         if(quell_progress)
           msg_info("\n");
@@ -422,7 +675,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
     if(writeCachePage(cp, pgm, p, mem, n, 1) < 0)
       return LIBAVRDUDE_GENERAL_FAILURE;
     // Same? OK, can set cleared bit to one, "normal" memory
-    if(!memcmp(cp->copy + n, cp->cont + n, cp->page_size)) {
+    if(!memcmp(pageCopy(cp, n), pageCont(cp, n), cp->page_size)) {
       chpages--;
       continue;
     }
@@ -431,7 +684,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
       if(writeCachePage(cp, pgm, p, mem, n, 1) < 0)
         return LIBAVRDUDE_GENERAL_FAILURE;
       // Worked OK? Can use page erase on this memory
-      if(!memcmp(cp->copy + n, cp->cont + n, cp->page_size)) {
+      if(!memcmp(pageCopy(cp, n), pageCont(cp, n), cp->page_size)) {
         mems[i].pgerase = 1;
         chpages--;
         continue;
@@ -448,14 +701,13 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
   }
 
   if(chiperase) {
-    if(quell_progress) {
-      msg_info("reading/chip erase/writing cycle needed ... ");
-      fflush(stderr);
-    }
+    int nrd = 0, nwrmax = 0;
 
-    int nrd = 0;
-
-    // Count read operations needed
+    /*
+     * Plan the cycle: memories that a chip erase leaves alone need neither be
+     * read nor restored; of the others, all pages not yet cached have to be
+     * read, and only pages that are not blank need writing back
+     */
     for(size_t i = 0; i < sizeof mems/sizeof *mems; i++) {
       AVRMEM *mem = mems[i].mem;
       AVR_Cache *cp = mems[i].cp;
@@ -463,13 +715,23 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
       if(!mem)
         continue;
       if(mem_is_usersig(mem))   // CE does not affect usersig/userrow
-        continue;
+        mems[i].cesafe = 1;
+      else if(mems[i].iseeprom && eepromSurvivesCE(pgm, p))
+        mems[i].cesafe = 1;
 
       for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size)
-        if(!cp->iscached[pgno])
-          nrd++;
+        if(mems[i].cesafe)
+          nwrmax += pageDirty(cp, pgno, n);
+        else if(!cp->iscached[pgno])
+          nrd++, nwrmax++;
+        else
+          nwrmax += cp->pages[pgno] && !is_memset(pageCont(cp, n), 0xff, cp->page_size);
     }
 
+    msg_info("reading %d page%s, chip erase and writing up to %d page%s needed ...%s",
+      nrd, str_plural(nrd), nwrmax, str_plural(nwrmax), quell_progress? " ": "\n");
+    fflush(stderr);
+
     report_progress(0, 1, "Reading");
     if(nrd) {
       // Read full flash and EEPROM
@@ -477,9 +739,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
         AVRMEM *mem = mems[i].mem;
         AVR_Cache *cp = mems[i].cp;
 
-        if(!mem)
-          continue;
-        if(mem_is_usersig(mem)) // CE does not affect usersig/userrow
+        if(!mem || mems[i].cesafe)      // Chip erase leaves usersig/userrow (and EESAVE EEPROM) alone
           continue;
 
         for(int ird = 0, pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size) {
@@ -512,7 +772,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
         continue;
 
       if(mems[i].isflash) {
-        memset(cp->copy, 0xff, cp->size); // Record device memory as erased
+        setCopyBlank(cp);       // Record device memory as erased
         if(is_spm(pgm)) {       // Bootloaders will not overwrite themselves
           // Read back generously estimated bootloader section to avoid verification errors
           int bootstart = guessBootStart(pgm, p);
@@ -520,7 +780,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
 
           for(int ibo = 0, n = bootstart; n < cp->size; n += cp->page_size) {
             report_progress(1 + ibo++, nbo + 2, NULL);
-            if(avr_read_page_default(pgm, p, mem, n, cp->copy + n) < 0) {
+            if(avr_read_page_default(pgm, p, mem, n, pageCopy(cp, n)) < 0) {
               report_progress(1, -1, NULL);
               if(quell_progress)
                 msg_info("\n");
@@ -531,9 +791,10 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
         }
       } else if(mems[i].iseeprom) {
         // Don't know whether chip erase has zapped EEPROM
-        for(int n = 0; n < cp->size; n += cp->page_size) {
-          if(!is_memset(cp->copy + n, 0xff, cp->page_size)) { // First page that had EEPROM data
-            if(avr_read_page_default(pgm, p, mem, n, cp->copy + n) < 0) {
+        for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size) {
+          // First page that had EEPROM data
+          if(!cp->iscached[pgno] || !is_memset(pageCopy(cp, n), 0xff, cp->page_size)) {
+            if(avr_read_page_default(pgm, p, mem, n, pageCopy(cp, n)) < 0) {
               report_progress(1, -1, NULL);
               if(quell_progress)
                 msg_info("\n");
@@ -541,12 +802,13 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
               return LIBAVRDUDE_GENERAL_FAILURE;
             }
             // EEPROM zapped by chip erase? Set all of copy to 0xff
-            if(is_memset(cp->copy + n, 0xff, cp->page_size))
-              memset(cp->copy, 0xff, cp->size);
+            if(is_memset(pageCopy(cp, n), 0xff, cp->page_size))
+              setCopyBlank(cp);
             break;
           }
         }
       }
+      markCacheDirty(cp);       // Device copy changed: compare all cached pages
     }
     report_progress(1, 0, NULL);
   }
@@ -562,7 +824,7 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
       continue;
 
     for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size)
-      if(cp->iscached[pgno] && memcmp(cp->copy + n, cp->cont + n, cp->page_size))
+      if(pageDirty(cp, pgno, n))
         nwr++;
   }
 
@@ -573,22 +835,37 @@ int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p) {
       AVRMEM *mem = mems[i].mem;
       AVR_Cache *cp = mems[i].cp;
 
-      if(!mem || !cp->cont)
+      if(!mem || !cp->pages)
         continue;
 
-      for(int iwr = 0, pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size) {
-        if(cp->iscached[pgno] && memcmp(cp->copy + n, cp->cont + n, cp->page_size)) {
-          if(!chiperase && mems[i].pgerase && pgm->page_erase)
-            led_page_erase(pgm, p, mem, n);
-          if(writeCachePage(cp, pgm, p, mem, n, 1) < 0)
-            return LIBAVRDUDE_GENERAL_FAILURE;
-          if(memcmp(cp->copy + n, cp->cont + n, cp->page_size)) {
+      // Runs of consecutive pages can be written in one go unless each needs a page erase
+      int pgerase = !chiperase && mems[i].pgerase && pgm->page_erase;
+      int maxrun = pgerase || cp->page_size >= 4096? 1: 4096/cp->page_size;
+
+      for(int iwr = 0, pgno = 0, n = 0; n < cp->size;) {
+        int run = 0;
+
+        while(run < maxrun && n + run*cp->page_size < cp->size && pageDirty(cp, pgno + run, n + run*cp->page_size))
+          run++;
+        if(!run) {
+          cp->isdirty[pgno++] = 0;
+          n += cp->page_size;
+          continue;
+        }
+
+        if(pgerase)
+          led_page_erase(pgm, p, mem, n);
+        if(writeCachePages(cp, pgm, p, mem, n, run) < 0)
+          return LIBAVRDUDE_GENERAL_FAILURE;
+        for(; run--; pgno++, n += cp->page_size) {
+          if(memcmp(pageCopy(cp, n), pageCont(cp, n), cp->page_size)) {
             report_progress(1, -1, NULL);
             if(quell_progress)
               msg_info("\n");
             pmsg_error("verification mismatch at %s page addr 0x%04x\n", mem->desc, n);
             return LIBAVRDUDE_GENERAL_FAILURE;
           }
+          cp->isdirty[pgno] = 0;
           report_progress(iwr++, nwr, NULL);
         }
       }
@@ -625,9 +902,10 @@ int avr_read_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *
   AVR_Cache *cp = mem_is_eeprom(mem)? pgm->cp_eeprom: mem_is_in_flash(mem)? pgm->cp_flash:
     mem_is_bootrow(mem)? pgm->cp_bootrow: pgm->cp_usersig;
 
-  if(!cp->cont)                 // Init cache if needed
+  if(!cp->pages)                // Init cache if needed
     if(initCache(cp, pgm, p) < 0)
       return LIBAVRDUDE_GENERAL_FAILURE;
+  beginCacheOp(cp);
 
   int cacheaddr = cacheAddress((int) addr, cp, mem);
 
@@ -638,7 +916,7 @@ int avr_read_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *
   if(loadCachePage(cp, pgm, p, mem, addr, cacheaddr, 0) < 0)
     return LIBAVRDUDE_GENERAL_FAILURE;
 
-  *value = cp->cont[cacheaddr];
+  *value = *pageCont(cp, cacheaddr);
 
   return LIBAVRDUDE_SUCCESS;
 }
@@ -665,9 +943,10 @@ int avr_write_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   AVR_Cache *cp = mem_is_eeprom(mem)? pgm->cp_eeprom: mem_is_in_flash(mem)? pgm->cp_flash:
     mem_is_bootrow(mem)? pgm->cp_bootrow: pgm->cp_usersig;
 
-  if(!cp->cont)                 // Init cache if needed
+  if(!cp->pages)                // Init cache if needed
     if(initCache(cp, pgm, p) < 0)
       return LIBAVRDUDE_GENERAL_FAILURE;
+  beginCacheOp(cp);
 
   int cacheaddr = cacheAddress((int) addr, cp, mem);
 
@@ -678,23 +957,174 @@ int avr_write_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   if(loadCachePage(cp, pgm, p, mem, addr, cacheaddr, 0) < 0)
     return LIBAVRDUDE_GENERAL_FAILURE;
 
-  if(cp->cont[cacheaddr] == data)
+  unsigned char *cont = pageCont(cp, cacheaddr);
+
+  if(*cont == data)
     return LIBAVRDUDE_SUCCESS;
 
   if(pgm->readonly && pgm->readonly(pgm, p, mem, addr))
     return LIBAVRDUDE_SOFTFAIL;
 
-  cp->cont[cacheaddr] = data;
+  *cont = data;
+  cp->isdirty[cacheaddr/cp->page_size] = 1;
 
   return LIBAVRDUDE_SUCCESS;
 }
 
+/*
+ * Return the initialised cache for the range [addr, addr+len) of mem and set
+ * *cacheaddrp to the cache address of addr; all pages of the range are
+ * loaded, runs of missing pages with one paged_load() call where possible.
+ * Returns NULL if there is an error.
+ */
+static AVR_Cache *rangeCache(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned long addr, int len, int *cacheaddrp) {
+
+  AVR_Cache *cp = mem_is_eeprom(mem)? pgm->cp_eeprom: mem_is_in_flash(mem)? pgm->cp_flash:
+    mem_is_bootrow(mem)? pgm->cp_bootrow: pgm->cp_usersig;
+
+  if(!cp->pages)                // Init cache if needed
+    if(initCache(cp, pgm, p) < 0)
+      return NULL;
+  beginCacheOp(cp);
+
+  int cacheaddr = cacheAddress((int) addr, cp, mem);
+
+  if(cacheaddr < 0 || cacheaddr + len > cp->size)
+    return NULL;
+
+  int pgsz = cp->page_size, maxrun = avr_load_maxrun(pgm, mem);
+  int base = (int) addr & ~(pgsz - 1), cachebase = cacheaddr & ~(pgsz - 1);
+
+  for(; cachebase < cacheaddr + len; base += pgsz, cachebase += pgsz) {
+    int pgno = cachebase/pgsz, npages = 0;
+
+    if(cp->iscached[pgno])
+      continue;
+    while(npages < maxrun && cachebase + npages*pgsz < cacheaddr + len && !cp->iscached[pgno + npages])
+      npages++;
+    if(npages > 1 && loadCachePages(cp, pgm, p, mem, base, cachebase, npages) == LIBAVRDUDE_SUCCESS) {
+      base += (npages - 1)*pgsz, cachebase += (npages - 1)*pgsz;
+      continue;
+    }
+    if(loadCachePage(cp, pgm, p, mem, base, cachebase, 0) < 0)
+      return NULL;
+  }
+  *cacheaddrp = cacheaddr;
+
+  return cp;
+}
+
+/*
+ * Read len bytes from addr onwards into buf via the read/write cache
+ *  - Moves data with memcpy() from cache pages, loading missing pages in batches
+ *  - Falls back to bytewise pgm->read_byte_cached() if the memory is not cached
+ *    unless the programmer can read the memory in blocks (pgm->read_block)
+ *  - The range must lie within the memory
+ */
+int avr_read_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned long addr, int len, unsigned char *buf) {
+
+  if(len <= 0)
+    return LIBAVRDUDE_SUCCESS;
+  if(addr >= (unsigned long) mem->size || len > mem->size - (int) addr)
+    return LIBAVRDUDE_GENERAL_FAILURE;
+
+  if(pgm->read_byte_cached != avr_read_byte_cached || !avr_has_paged_access(pgm, p, mem)) {
+    if(pgm->read_byte_cached == avr_read_byte_cached && pgm->read_block) {
+      led_clr(pgm, LED_ERR);
+      led_set(pgm, LED_PGM);
+      int rc = pgm->read_block(pgm, p, mem, addr, len, buf);
+
+      if(rc < 0 && rc != -2)
+        led_set(pgm, LED_ERR);
+      led_clr(pgm, LED_PGM);
+      if(rc != -2)
+        return rc < 0? LIBAVRDUDE_GENERAL_FAILURE: LIBAVRDUDE_SUCCESS;
+    }
+    for(int i = 0; i < len; i++)
+      if(pgm->read_byte_cached(pgm, p, mem, addr + i, buf + i) < 0)
+        return LIBAVRDUDE_GENERAL_FAILURE;
+    return LIBAVRDUDE_SUCCESS;
+  }
+
+  int cacheaddr;
+  AVR_Cache *cp = rangeCache(pgm, p, mem, addr, len, &cacheaddr);
+
+  if(!cp)
+    return LIBAVRDUDE_GENERAL_FAILURE;
+  for(int i = 0, chunk; i < len; i += chunk) {  // Piecewise as pages are not contiguous
+    int n = cacheaddr + i;
+
+    chunk = cp->page_size - n%cp->page_size;
+    if(chunk > len - i)
+      chunk = len - i;
+    memcpy(buf + i, pageCont(cp, n), chunk);
+  }
+
+  return LIBAVRDUDE_SUCCESS;
+}
+
+/*
+ * Write len bytes from buf to addr onwards via the read/write cache
+ *  - Only modifies the cache up to the next avr_flush_cache()
+ *  - Bytes that the programmer reports as readonly are left unchanged, in
+ *    which case LIBAVRDUDE_SOFTFAIL is returned after writing the others
+ *  - Falls back to bytewise pgm->write_byte_cached() if the memory is not cached
+ *  - The range must lie within the memory
+ */
+int avr_write_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned long addr, int len, const unsigned char *buf) {
+
+  int ret = LIBAVRDUDE_SUCCESS;
+
+  if(len <= 0)
+    return LIBAVRDUDE_SUCCESS;
+  if(addr >= (unsigned long) mem->size || len > mem->size - (int) addr)
+    return LIBAVRDUDE_GENERAL_FAILURE;
+
+  if(pgm->write_byte_cached != avr_write_byte_cached || !avr_has_paged_access(pgm, p, mem)) {
+    for(int i = 0; i < len; i++) {
+      int rc = pgm->write_byte_cached(pgm, p, mem, addr + i, buf[i]);
+
+      if(rc == LIBAVRDUDE_SOFTFAIL)
+        ret = rc;
+      else if(rc < 0)
+        return LIBAVRDUDE_GENERAL_FAILURE;
+    }
+    return ret;
+  }
+
+  int cacheaddr;
+  AVR_Cache *cp = rangeCache(pgm, p, mem, addr, len, &cacheaddr);
+
+  if(!cp)
+    return LIBAVRDUDE_GENERAL_FAILURE;
+
+  for(int i = 0; i < len; i++) {
+    int n = cacheaddr + i;
+
+    unsigned char *cont = pageCont(cp, n);
+
+    if(*cont == buf[i])
+      continue;
+    if(pgm->readonly && pgm->readonly(pgm, p, mem, addr + i)) {
+      ret = LIBAVRDUDE_SOFTFAIL;
+      continue;
+    }
+    *cont = buf[i];
+    cp->isdirty[n/cp->page_size] = 1;
+  }
+
+  return ret;
+}
+
 // Erase the chip and set the cache accordingly
 int avr_chip_erase_cached(const PROGRAMMER *pgm, const AVRPART *p) {
   Cache_desc mems[] = {
-    {avr_locate_flash(p), pgm->cp_flash, 1, 0, -1, 0},
-    {avr_locate_eeprom(p), pgm->cp_eeprom, 0, 1, -1, 0},
-    {avr_locate_bootrow(p), pgm->cp_bootrow, 0, 0, -1, 0},
+    {avr_locate_flash(p), pgm->cp_flash, 1, 0, -1, 0, 0},
+    {avr_locate_eeprom(p), pgm->cp_eeprom, 0, 1, -1, 0, 0},
+    {avr_locate_bootrow(p), pgm->cp_bootrow, 0, 0, -1, 0, 0},
     // usersig is unaffected by CE
   };
   int rc;
@@ -709,40 +1139,41 @@ int avr_chip_erase_cached(const PROGRAMMER *pgm, const AVRPART *p) {
     if(!mem || !avr_has_paged_access(pgm, p, mem))
       continue;
 
-    if(!cp->cont)               // Init cache if needed
+    if(!cp->pages)              // Init cache if needed
       if(initCache(cp, pgm, p) < 0)
         return LIBAVRDUDE_GENERAL_FAILURE;
+    beginCacheOp(cp);
 
     if(mems[i].isflash) {
+      freePages(cp);
       if(is_spm(pgm)) {         // Reset cache to unknown
         memset(cp->iscached, 0, cp->size/cp->page_size);
-      } else {                  // Preset all pages as erased
-        memset(cp->copy, 0xff, cp->size);
-        memset(cp->cont, 0xff, cp->size);
+      } else {                  // Preset all pages as erased, which needs no memory
         memset(cp->iscached, 1, cp->size/cp->page_size);
+        memset(cp->isdirty, 0, cp->size/cp->page_size);
       }
     } else {                    // Test whether cached EEPROM/bootrow pages were zapped
       bool erased = 0;
 
       for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size) {
         if(cp->iscached[pgno]) {
-          if(!is_memset(cp->copy + n, 0xff, cp->page_size)) { // Page has data?
-            if(avr_read_page_default(pgm, p, mem, n, cp->copy + n) < 0)
+          if(!is_memset(pageCopy(cp, n), 0xff, cp->page_size)) { // Page has data?
+            if(avr_read_page_default(pgm, p, mem, n, pageCopy(cp, n)) < 0)
               return LIBAVRDUDE_GENERAL_FAILURE;
-            erased = is_memset(cp->copy + n, 0xff, cp->page_size);
+            erased = is_memset(pageCopy(cp, n), 0xff, cp->page_size);
             break;
           }
         }
       }
       if(erased) {              // Memory was erased, set cache correspondingly
-        memset(cp->copy, 0xff, cp->size);
-        memset(cp->cont, 0xff, cp->size);
+        freePages(cp);
         memset(cp->iscached, 1, cp->size/cp->page_size);
       } else {                  // Discard previous writes but leave cache
         for(int pgno = 0, n = 0; n < cp->size; pgno++, n += cp->page_size)
           if(cp->iscached[pgno])
-            memcpy(cp->cont + n, cp->copy + n, cp->page_size);
+            memcpy(pageCont(cp, n), pageCopy(cp, n), cp->page_size);
       }
+      memset(cp->isdirty, 0, cp->size/cp->page_size);
     }
   }
 
@@ -768,9 +1199,10 @@ int avr_page_erase_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   AVR_Cache *cp = mem_is_eeprom(mem)? pgm->cp_eeprom: mem_is_in_flash(mem)? pgm->cp_flash:
     mem_is_bootrow(mem)? pgm->cp_bootrow: pgm->cp_usersig;
 
-  if(!cp->cont)                 // Init cache if needed
+  if(!cp->pages)                // Init cache if needed
     if(initCache(cp, pgm, p) < 0)
       return LIBAVRDUDE_GENERAL_FAILURE;
+  beginCacheOp(cp);
 
   int cacheaddr = cacheAddress(addr, cp, mem);
 
@@ -784,7 +1216,7 @@ int avr_page_erase_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   if(loadCachePage(cp, pgm, p, mem, (int) addr, cacheaddr, 0) < 0)
     return LIBAVRDUDE_GENERAL_FAILURE;
 
-  if(!is_memset(cp->cont + (cacheaddr & ~(cp->page_size - 1)), 0xff, cp->page_size))
+  if(!is_memset(pageCont(cp, cacheaddr & ~(cp->page_size - 1)), 0xff, cp->page_size))
     return LIBAVRDUDE_GENERAL_FAILURE;
 
   return LIBAVRDUDE_SUCCESS;
@@ -797,12 +1229,16 @@ int avr_reset_cache(const PROGRAMMER *pgm, const AVRPART *p_unused) {
   for(size_t i = 0; i < sizeof mems/sizeof *mems; i++) {
     AVR_Cache *cp = mems[i];
 
-    if(cp->cont)
-      mmt_free(cp->cont);
-    if(cp->copy)
-      mmt_free(cp->copy);
+    if(cp->pages) {
+      freePages(cp);
+      mmt_free(cp->pages);
+    }
+    if(cp->lastuse)
+      mmt_free(cp->lastuse);
     if(cp->iscached)
       mmt_free(cp->iscached);
+    if(cp->isdirty)
+      mmt_free(cp->isdirty);
     memset(cp, 0, sizeof *cp);
   }
 
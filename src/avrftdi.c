@@ -248,7 +248,7 @@ static void avrftdi_powerdown(const PROGRAMMER *pgm) {
   set_pin(pgm, PPI_AVR_VCC, OFF);
 }
 
-static inline int set_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned char data, bool read_data) {
+static inline int make_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned char data, bool read_data) {
   int j;
   int buf_pos = 0;
   unsigned char bit = 0x80;
@@ -282,6 +282,38 @@ static inline int set_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned c
   return buf_pos;
 }
 
+/*
+ * Copy the bitbang command sequence for data into buf from a table of all 256
+ * sequences, which is made anew whenever the other pins or directions change
+ */
+static inline int set_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned char data, bool read_data) {
+  Avrftdi_data *pdata = to_pdata(pgm);
+  int len = read_data? 8*14: 8*12;
+  uint16_t base = SET_BITS_0(pdata->pin_value, pgm, PIN_AVR_SDO, 0);
+
+  base = SET_BITS_0(base, pgm, PIN_AVR_SCK, 0);
+  if(pdata->bb_len != len || pdata->bb_base != base || pdata->bb_direction != pdata->pin_direction) {
+    if(!pdata->bb_seq)
+      pdata->bb_seq = mmt_malloc(256*8*14);
+    for(int d = 0; d < 256; d++) {
+      pdata->pin_value = base;
+      make_data(pgm, pdata->bb_seq + d*len, d, read_data);
+    }
+    pdata->bb_len = len;
+    pdata->bb_base = base;
+    pdata->bb_direction = pdata->pin_direction;
+  }
+
+  unsigned char *seq = pdata->bb_seq + data*len;
+
+  memcpy(buf, seq, len);
+  // Pin values after the last SCK high: SET_BITS_LOW, low, dir, SET_BITS_HIGH, high, dir
+  seq += 7*(len/8) + 6;
+  pdata->pin_value = seq[1] | seq[4] << 8;
+
+  return len;
+}
+
 static inline unsigned char extract_data(const PROGRAMMER *pgm, unsigned char *buf, int offset) {
   int j;
   unsigned char bit = 0x80;
@@ -390,6 +422,26 @@ static int avrftdi_transmit_mpsse(Avrftdi_data *pdata, unsigned char mode, const
 
   E(ftdi_write_data(pdata->ftdic, cmd, sizeof(cmd)) != sizeof(cmd), pdata->ftdic);
 
+#if defined(HAVE_LIBFTDI1) && defined(HAVE_LIBUSB_1_0)
+  /*
+   * Submit the whole stream and its readback as asynchronous transfers that
+   * libusb services together, so the MPSSE engine is never left waiting for
+   * the host to pick up the next chunk
+   */
+  if(mode & MPSSE_DO_READ) {
+    struct ftdi_transfer_control *rtc, *wtc;
+
+    E(!(rtc = ftdi_read_data_submit(pdata->ftdic, data, buf_size)), pdata->ftdic);
+    if(!(wtc = ftdi_write_data_submit(pdata->ftdic, (unsigned char *) buf, buf_size)))
+      ftdi_transfer_data_cancel(rtc, NULL);
+    E(!wtc, pdata->ftdic);
+    int nw = ftdi_transfer_data_done(wtc), nr = ftdi_transfer_data_done(rtc);
+
+    E(nw != buf_size || nr != buf_size, pdata->ftdic);
+    return buf_size;
+  }
+#endif
+
   while(remaining) {
     size_t transfer_size = (remaining > blocksize)? blocksize: remaining;
 
@@ -872,7 +924,7 @@ static int avrftdi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -1100,10 +1152,10 @@ static int avrftdi_flash_read(const PROGRAMMER *pgm, const AVRPART *p, const AVR
     buf_dump(i_buf, sizeof(i_buf), "i_buf", 0, 32);
   }
 
-  memset(&m->buf[addr], 0, page_size);
+  memset(&m->buf[addr], 0, len);
 
   // Every (read) op is 4 bytes in size and yields one byte of memory data
-  for(unsigned int byte = 0; byte < page_size; byte++) {
+  for(unsigned int byte = 0; byte < len; byte++) {
     if(byte & 1)
       readop = m->op[AVR_OP_READ_HI];
     else
@@ -1116,7 +1168,7 @@ static int avrftdi_flash_read(const PROGRAMMER *pgm, const AVRPART *p, const AVR
   }
 
   if(verbose >= MSG_TRACE2)
-    buf_dump(&m->buf[addr], page_size, "page:", 0, 32);
+    buf_dump(&m->buf[addr], len, "page:", 0, 32);
 
   return len;
 }
@@ -1133,8 +1185,15 @@ static int avrftdi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
 
 static int avrftdi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
-  if(mem_is_flash(m))
-    return avrftdi_flash_read(pgm, p, m, page_size, addr, n_bytes);
+  if(mem_is_flash(m)) {
+    // Runs of several pages must not straddle a 128 KiB extended address boundary
+    unsigned int n = addr/0x20000 == (addr + n_bytes - 1)/0x20000? n_bytes: 0x20000 - addr%0x20000;
+    int rc = avrftdi_flash_read(pgm, p, m, page_size, addr, n);
+
+    if(rc < 0 || n == n_bytes)
+      return rc;
+    return avrftdi_paged_load(pgm, p, m, page_size, addr + n, n_bytes - n);
+  }
   else if(mem_is_eeprom(m))
     return avrftdi_eeprom_read(pgm, p, m, page_size, addr, n_bytes);
   else
@@ -1176,6 +1235,7 @@ static void avrftdi_teardown(PROGRAMMER *pgm) {
 
     ftdi_deinit(pdata->ftdic);
     ftdi_free(pdata->ftdic);
+    mmt_free(pdata->bb_seq);
     mmt_free(pdata);
     pgm->cookie = NULL;
   }
@@ -1198,134 +1258,220 @@ static int avrftdi_jtag_reset(const PROGRAMMER *pgm) {
   return 0;
 }
 
-static int avrftdi_jtag_ir_out(const PROGRAMMER *pgm, unsigned char ir) {
+#define JTAG_MAX_BITS 1024      // Longest scan through the whole chain
+
+static void jtag_setbits(unsigned char *v, int pos, unsigned int val, int n) {
+  for(int i = 0; i < n; i++, pos++, val >>= 1)
+    if(val & 1)
+      v[pos/8] |= 1 << (pos%8);
+    else
+      v[pos/8] &= ~(1 << (pos%8));
+}
+
+static unsigned int jtag_getbits(const unsigned char *v, int pos, int n) {
+  unsigned int val = 0;
+
+  for(int i = 0; i < n; i++, pos++)
+    val |= ((v[pos/8] >> (pos%8)) & 1U) << i;
+
+  return val;
+}
+
+/*
+ * Shift bits from tdi, LSB first, through the IR (ir != 0) or DR of the
+ * whole chain, starting and ending in Run-Test/Idle; what the chain shifts
+ * out is stored in tdo unless that is NULL
+ */
+static int avrftdi_jtag_shift(const PROGRAMMER *pgm, int ir, const unsigned char *tdi, int bits,
+  unsigned char *tdo) {
+
   Avrftdi_data *pdata = to_pdata(pgm);
-  unsigned char buf[9], *ptr = buf;
+  unsigned char buf[3*(JTAG_MAX_BITS/8 + 1) + 4], *ptr = buf;
+  unsigned char rd = tdo? MPSSE_DO_READ: 0;
+  int nread = 0;
 
-  // Idle -> Select-DR -> Select-IR -> Capture-IR -> Shift-IR
+  if(bits <= 0 || bits > JTAG_MAX_BITS)
+    return -1;
+
+  // Run-Test/Idle -> Select-DR [-> Select-IR] -> Capture -> Shift
   *ptr++ = MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 3;
-  *ptr++ = 0x03;
+  *ptr++ = ir? 3: 2;
+  *ptr++ = ir? 0x03: 0x01;
 
-  // Clock out first 3 bits
-  *ptr++ = MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 2;
-  *ptr++ = ir & 0x7;
+  // All bits but the last in chunks of up to 8
+  for(int i = 0; i < bits - 1; i += 8, nread++) {
+    int n = bits - 1 - i < 8? bits - 1 - i: 8;
 
-  // Clock out 4th bit and Shift-IR -> Exit1-IR -> Update-IR -> Idle
-  *ptr++ = MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
+    *ptr++ = MPSSE_DO_WRITE | rd | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
+    *ptr++ = n - 1;
+    *ptr++ = jtag_getbits(tdi, i, n);
+  }
+
+  // Last bit and Shift -> Exit1 -> Update -> Run-Test/Idle
+  *ptr++ = MPSSE_WRITE_TMS | rd | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
   *ptr++ = 2;
-  *ptr++ = (ir & 0x8) << 4 | 0x03;
+  *ptr++ = jtag_getbits(tdi, bits - 1, 1) << 7 | 0x03;
+  nread++;
+  if(rd)
+    *ptr++ = SEND_IMMEDIATE;
 
   E(ftdi_write_data(pdata->ftdic, buf, ptr - buf) != ptr - buf, pdata->ftdic);
+  if(!tdo)
+    return 0;
+
+  for(int pos = 0; pos < nread;) {
+    int n = ftdi_read_data(pdata->ftdic, buf + pos, nread - pos);
+
+    E(n < 0, pdata->ftdic);
+    pos += n;
+  }
+
+  // Bit-mode reads shift in from the MSB: a chunk of n bits sits in the top n bits
+  for(int i = 0, k = 0; i < bits - 1; i += 8, k++) {
+    int n = bits - 1 - i < 8? bits - 1 - i: 8;
+
+    jtag_setbits(tdo, i, buf[k] >> (8 - n), n);
+  }
+  jtag_setbits(tdo, bits - 1, buf[nread - 1] >> 5, 1);
 
   return 0;
 }
 
+// Load ir into the target's IR and put all other devices of the chain into BYPASS
+static int avrftdi_jtag_ir_out(const PROGRAMMER *pgm, unsigned char ir) {
+  Avrftdi_data *pdata = to_pdata(pgm);
+  unsigned char v[JTAG_MAX_BITS/8];
+  int ba = pdata->jtagchain[3], bb = pdata->jtagchain[2];
+
+  // Devices after the target, ie, nearer to the programmer's TDI, take the first bits
+  memset(v, 0xff, sizeof v);
+  jtag_setbits(v, ba, ir, 4);
+
+  return avrftdi_jtag_shift(pgm, 1, v, ba + 4 + bb, NULL);
+}
+
+// Shift bits of dr into the target's DR past the one-bit bypass registers of the others
 static int avrftdi_jtag_dr_out(const PROGRAMMER *pgm, unsigned int dr, int bits) {
   Avrftdi_data *pdata = to_pdata(pgm);
-  unsigned char buf[18], *ptr = buf;
+  unsigned char v[JTAG_MAX_BITS/8];
+  int ua = pdata->jtagchain[1], ub = pdata->jtagchain[0];
 
   if(bits <= 0 || bits > 31) {
     return -1;
   }
 
-  // Idle -> Select-DR -> Capture-DR -> Shift-DR
-  *ptr++ = MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 2;
-  *ptr++ = 0x01;
-
-  while(bits > 8) {
-    // Write bits
-    *ptr++ = MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-    *ptr++ = 7;
-    *ptr++ = dr & 0xff;
-    bits -= 8;
-    dr >>= 8;
-  }
-
-  if(bits > 1) {
-    // Write
-    *ptr++ = MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-    *ptr++ = bits - 2;
-    *ptr++ = dr & ((1 << (bits - 1)) - 1);
-  }
-  dr <<= 8 - bits;
-
-  // Write MSB and Shift-DR -> Exit1-DR -> Update-DR -> Idle
-  *ptr++ = MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 2;
-  *ptr++ = (dr & 0x80) | 0x03;
-
-  E(ftdi_write_data(pdata->ftdic, buf, ptr - buf) != ptr - buf, pdata->ftdic);
+  memset(v, 0, sizeof v);
+  jtag_setbits(v, ua, dr, bits);
 
-  return 0;
+  return avrftdi_jtag_shift(pgm, 0, v, ua + bits + ub, NULL);
 }
 
 static int avrftdi_jtag_dr_inout(const PROGRAMMER *pgm, unsigned int dr, int bits) {
   Avrftdi_data *pdata = to_pdata(pgm);
-  unsigned char buf[19], *ptr = buf;
-  unsigned char bytes = 1, pos;
-  unsigned int dr_in;
+  unsigned char v[JTAG_MAX_BITS/8], in[JTAG_MAX_BITS/8];
+  int ua = pdata->jtagchain[1], ub = pdata->jtagchain[0];
 
   if(bits <= 0 || bits > 31) {
     return -1;
   }
 
-  // Run-Test/Idle -> Select-DR -> Capture-DR -> Shift-DR
-  *ptr++ = MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 2;
-  *ptr++ = 0x01;
-
-  while(bits > 8) {
-    // Read/write bits
-    *ptr++ = MPSSE_DO_READ | MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-    *ptr++ = 7;
-    *ptr++ = dr & 0xff;
-    bits -= 8;
-    bytes++;
-    dr >>= 8;
+  memset(v, 0, sizeof v);
+  jtag_setbits(v, ua, dr, bits);
+  if(avrftdi_jtag_shift(pgm, 0, v, ua + bits + ub, in) < 0)
+    return -1;
+
+  return jtag_getbits(in, ua, bits);
+}
+
+/*
+ * List the devices on the chain: after Test-Logic-Reset each device has its
+ * 32-bit IDCODE register, which always starts with a 1 bit, or its one-bit
+ * BYPASS register (a 0 bit) in the DR path; shifting in ones ends the list
+ * with an all-ones IDCODE
+ */
+static int avrftdi_jtag_scan(const PROGRAMMER *pgm) {
+  unsigned char ones[JTAG_MAX_BITS/8], in[JTAG_MAX_BITS/8];
+  unsigned int ids[32];
+  int n = 0;
+
+  memset(ones, 0xff, sizeof ones);
+  if(avrftdi_jtag_shift(pgm, 0, ones, JTAG_MAX_BITS, in) < 0)
+    return -1;
+
+  for(int pos = 0; pos + 32 <= JTAG_MAX_BITS && n < (int) (sizeof ids/sizeof *ids);) {
+    if(!jtag_getbits(in, pos, 1)) {     // Device without IDCODE
+      ids[n++] = 0;
+      pos++;
+      continue;
+    }
+    unsigned int id = jtag_getbits(in, pos, 32);
+
+    if(id == 0xffffffffU)
+      break;
+    ids[n++] = id;
+    pos += 32;
   }
 
-  if(bits > 1) {
-    // Read/write
-    *ptr++ = MPSSE_DO_READ | MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-    *ptr++ = bits - 2;
-    *ptr++ = dr & ((1 << (bits - 1)) - 1);
-    bytes++;
+  msg_info("JTAG chain with %d device%s, nearest to the programmer's TDI first\n", n, str_plural(n));
+  for(int k = 0; k < n; k++) {
+    if(!ids[k])
+      msg_info("  %2d: device in BYPASS without IDCODE", k);
+    else
+      msg_info("  %2d: IDCODE 0x%08x (version %u, part 0x%04x, manufacturer 0x%03x)", k, ids[k],
+        ids[k] >> 28, (ids[k] >> 12) & 0xffff, (ids[k] >> 1) & 0x7ff);
+    // Assumes 4-bit IRs throughout as with AVR devices
+    msg_info(", -x jtagchain=%d,%d,%d,%d\n", n - 1 - k, k, 4*(n - 1 - k), 4*k);
   }
-  dr <<= 8 - bits;
 
-  // Read/write MSB and Shift-DR -> Exit1-DR -> Update-DR -> Run-Test/Idle
-  *ptr++ = MPSSE_WRITE_TMS | MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-  *ptr++ = 2;
-  *ptr++ = (dr & 0x80) | 0x03;
-  *ptr++ = SEND_IMMEDIATE;
+  return n;
+}
 
-  E(ftdi_write_data(pdata->ftdic, buf, ptr - buf) != ptr - buf, pdata->ftdic);
+static int avrftdi_jtag_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
+  Avrftdi_data *pdata = to_pdata(pgm);
+  int rv = 0;
+  bool help = false;
 
-  pos = 0;
-  do {
-    int n = ftdi_read_data(pdata->ftdic, &buf[pos], bytes - pos);
+  for(LNODEID ln = lfirst(extparms); ln; ln = lnext(ln)) {
+    const char *extended_param = ldata(ln);
 
-    E(n < 0, pdata->ftdic);
-    pos += n;
-  } while(pos < bytes);
+    if(str_starts(extended_param, "jtagchain=")) {
+      unsigned int ub, ua, bb, ba;
 
-  dr_in = 0;
-  ptr = buf;
-  pos = 0;
-  while(bytes - (ptr - buf) > 2) {
-    dr_in |= *ptr++ << pos;
-    pos += 8;
-  }
-  if(bytes >= 1) {
-    dr_in |= *ptr++ << (pos - 8 + bits - 1);
-    pos += bits - 1;
+      if(sscanf(extended_param, "jtagchain=%u,%u,%u,%u", &ub, &ua, &bb, &ba) != 4 ||
+        ub > 255 || ua > 255 || bb > 255 || ba > 255) {
+        pmsg_error("invalid JTAG chain in -x %s\n", extended_param);
+        rv = -1;
+        break;
+      }
+      pmsg_notice2("%s(): JTAG chain parsed as:\n", __func__);
+      imsg_notice2("%u units before, %u units after, %u bits before, %u bits after\n", ub, ua, bb, ba);
+      pdata->jtagchain[0] = ub;
+      pdata->jtagchain[1] = ua;
+      pdata->jtagchain[2] = bb;
+      pdata->jtagchain[3] = ba;
+      continue;
+    }
+    if(str_eq(extended_param, "jtagscan")) {
+      pdata->jtagscan = true;
+      continue;
+    }
+    if(str_eq(extended_param, "help")) {
+      help = true;
+      rv = LIBAVRDUDE_EXIT_OK;
+    }
+
+    if(!help) {
+      pmsg_error("invalid extended parameter -x %s\n", extended_param);
+      rv = -1;
+    }
+    msg_error("%s -c %s extended options:\n", progname, pgmid);
+    msg_error("  -x jtagchain=UB,UA,BB,BA Setup the JTAG scan chain order\n");
+    msg_error("  -x jtagscan              List the devices on the JTAG chain and exit\n");
+    msg_error("  -x help                  Show this help menu and exit\n");
+    return rv;
   }
-  dr_in |= (*ptr++ & 0x20) << (pos - 5);
 
-  return dr_in;
+  return rv;
 }
 
 static void avrftdi_jtag_enable(PROGRAMMER *pgm, const AVRPART *p) {
@@ -1340,6 +1486,12 @@ static void avrftdi_jtag_enable(PROGRAMMER *pgm, const AVRPART *p) {
 }
 
 static int avrftdi_jtag_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
+  if(to_pdata(pgm)->jtagscan) {
+    set_pin(pgm, PPI_AVR_BUFF, ON);
+    avrftdi_jtag_reset(pgm);
+    return avrftdi_jtag_scan(pgm) < 0? LIBAVRDUDE_EXIT_FAIL: LIBAVRDUDE_EXIT_OK;
+  }
+
   if(!ovsigck) {
     if(str_eq(p->id, "m128a") || str_eq(p->id, "m128") ||
       str_eq(p->id, "m64a") || str_eq(p->id, "m64") ||
@@ -1709,6 +1861,7 @@ void avrftdi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = avrftdi_paged_write;
   pgm->paged_load = avrftdi_paged_load;
+  pgm->multipage_load = 1;
   pgm->setpin = set_pin;
   pgm->setup = avrftdi_setup;
   pgm->teardown = avrftdi_teardown;
@@ -1737,6 +1890,7 @@ void avrftdi_jtag_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = avrftdi_jtag_paged_write;
   pgm->paged_load = avrftdi_jtag_paged_read;
+  pgm->parseextparams = avrftdi_jtag_parseextparms;
   pgm->setup = avrftdi_setup;
   pgm->teardown = avrftdi_teardown;
   pgm->rdy_led = avrftdi_rdy_led;
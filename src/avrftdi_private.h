@@ -99,5 +99,15 @@ typedef struct avrftdi_s {
   struct pindef valid_pins;     // Used in avrftdi_check_pins_bb()
   struct pindef mpsse_pins[4];  // Used in avrftdi_check_pins_mpsse()
   struct pindef other_pins;     // Used in avrftdi_check_pins_mpsse()
+
+  // Bitbang command sequences of all SPI bytes made by set_data() for ...
+  unsigned char *bb_seq;        // ... 256 sequences of bb_len bytes each
+  int bb_len;                   // ... 0 if not yet made
+  uint16_t bb_base;             // ... pin values with SDO and SCK low
+  uint16_t bb_direction;        // ... pin directions
+
+  // JTAG chain: units before, units after, IR bits before, IR bits after the target (-x jtagchain)
+  unsigned char jtagchain[4];
+  bool jtagscan;                // List the devices on the JTAG chain and exit (-x jtagscan)
 } Avrftdi_data;
 #endif                          // Do_not_build_avrfdti
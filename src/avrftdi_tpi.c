@@ -87,6 +87,7 @@ void avrftdi_tpi_initpgm(PROGRAMMER *pgm) {
 
   pgm->program_enable = avrftdi_tpi_program_enable;
   pgm->cmd_tpi = avrftdi_cmd_tpi;
+  pgm->cmd_tpi_batch = avrftdi_cmd_tpi_batch;
   pgm->chip_erase = avr_tpi_chip_erase;
   pgm->disable = avrftdi_tpi_disable;
 
@@ -230,6 +231,93 @@ int avrftdi_cmd_tpi(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len
   return 0;
 }
 
+/*
+ * Send n TPI frames of cmd_len bytes each and collect res_len bytes per frame;
+ * the MPSSE commands for a whole batch go out in one buffer followed by a
+ * single SEND_IMMEDIATE, and all read frames come back in one transfer. Each
+ * read clocks the same 3 bytes as avrftdi_tpi_read_byte(), which covers the 2
+ * guard bits before the target answers. Batches are cut so their readback fits
+ * into the FTDI receive buffer.
+ */
+int avrftdi_cmd_tpi_batch(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len,
+  unsigned char *res, int res_len, int n) {
+
+  Avrftdi_data *pdata = to_pdata(pgm);
+  const int rbytes = 3;         // Bytes clocked in per read frame
+  int max_frames = n;
+
+  if(!res)
+    res_len = 0;
+  if(res_len > 0) {
+    max_frames = pdata->rx_buffer_size/(rbytes*res_len);
+    if(max_frames < 1)
+      max_frames = 1;
+    if(max_frames > n)
+      max_frames = n;
+  }
+
+  unsigned char *buf = mmt_malloc(max_frames*(5*cmd_len + 3*res_len) + 1);
+  unsigned char *rbuf = res_len > 0? mmt_malloc(max_frames*rbytes*res_len): NULL;
+  int ret = 0;
+
+  for(int done = 0; done < n && !ret;) {
+    int nf = n - done < max_frames? n - done: max_frames, len = 0;
+
+    for(int k = 0; k < nf; k++) {
+      for(int i = 0; i < cmd_len; i++) {
+        uint16_t frame = tpi_byte2frame(cmd[(done + k)*cmd_len + i]);
+
+        buf[len++] = MPSSE_DO_WRITE | MPSSE_WRITE_NEG | MPSSE_LSB;
+        buf[len++] = 1;
+        buf[len++] = 0;
+        buf[len++] = frame & 0xff;
+        buf[len++] = frame >> 8;
+      }
+      for(int i = 0; i < res_len; i++) {
+        buf[len++] = MPSSE_DO_READ | MPSSE_LSB;
+        buf[len++] = (rbytes - 1) & 0xff;
+        buf[len++] = ((rbytes - 1) >> 8) & 0xff;
+      }
+    }
+    if(res_len > 0)
+      buf[len++] = SEND_IMMEDIATE;
+
+    if(ftdi_write_data(pdata->ftdic, buf, len) != len) {
+      pmsg_error("ftdi_write_data() failed: %s\n", ftdi_get_error_string(pdata->ftdic));
+      ret = -1;
+      break;
+    }
+
+    int want = nf*rbytes*res_len;
+
+    for(int got = 0; got < want;) {
+      int r = ftdi_read_data(pdata->ftdic, rbuf + got, want - got);
+
+      if(r < 0) {
+        pmsg_error("ftdi_read_data() failed: %s\n", ftdi_get_error_string(pdata->ftdic));
+        ret = -1;
+        break;
+      }
+      got += r;
+    }
+
+    for(int j = 0; j < nf*res_len && !ret; j++) {
+      uint16_t frame = rbuf[rbytes*j] | (rbuf[rbytes*j + 1] << 8);
+
+      if(tpi_frame2byte(frame, res + done*res_len + j)) {
+        pmsg_error("parity error in TPI frame 0x%04x\n", frame);
+        ret = -1;
+      }
+    }
+    done += nf;
+  }
+
+  mmt_free(rbuf);
+  mmt_free(buf);
+
+  return ret;
+}
+
 static void avrftdi_tpi_disable(const PROGRAMMER *pgm) {
   unsigned char cmd[] = { TPI_OP_SSTCS(TPIPCR), 0 };
   pgm->cmd_tpi(pgm, cmd, sizeof(cmd), NULL, 0);
@@ -24,33 +24,101 @@
 #include <limits.h>
 #include <unistd.h>
 
+#include "avrdude.h"
 #include "libavrdude.h"
 
+#define UP_N ((int) (sizeof uP_table/sizeof *uP_table))
+
+// Comparison of uP_table[] indices by key with ties broken by index so lookups find the first entry
+static int upcmp_mcuid(const void *v1, const void *v2) {
+  int i1 = *(const int *) v1, i2 = *(const int *) v2;
+  int diff = uP_table[i1].mcuid - uP_table[i2].mcuid;
+
+  return diff? diff: i1 - i2;
+}
+
+static int upcmp_sig(const void *v1, const void *v2) {
+  int i1 = *(const int *) v1, i2 = *(const int *) v2;
+  int diff = memcmp(uP_table[i1].sigs, uP_table[i2].sigs, sizeof uP_table->sigs);
+
+  return diff? diff: i1 - i2;
+}
+
+static int upcmp_name(const void *v1, const void *v2) {
+  int i1 = *(const int *) v1, i2 = *(const int *) v2;
+  int diff = strcasecmp(uP_table[i1].name, uP_table[i2].name);
+
+  return diff? diff: i1 - i2;
+}
+
+// Return an index into uP_table[] sorted by cmp, building it on first use
+static const int *upindex(int **idxp, int (*cmp)(const void *, const void *)) {
+  const int *ret;
+
+  avr_db_lock();
+  if(!*idxp) {
+    int *idx = mmt_malloc(UP_N*sizeof *idx);
+
+    for(int i = 0; i < UP_N; i++)
+      idx[i] = i;
+    qsort(idx, UP_N, sizeof *idx, cmp);
+    *idxp = idx;
+  }
+  ret = *idxp;
+  avr_db_unlock();
+
+  return ret;
+}
+
 // Given the MCU id return index in uP_table or -1 if not found
 int upidxmcuid(int mcuid) {
-  for(size_t i=0; i< sizeof uP_table/sizeof *uP_table; i++) {
-    if(mcuid == uP_table[i].mcuid)
-      return i;
+  const int *idx = upindex(&avr_db.upi_mcuid, upcmp_mcuid);
+  int lo = 0, hi = UP_N;
+
+  while(lo < hi) {              // Lower bound
+    int mid = (lo + hi)/2;
+
+    if(uP_table[idx[mid]].mcuid < mcuid)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  return -1;
+
+  return lo < UP_N && uP_table[idx[lo]].mcuid == mcuid? idx[lo]: -1;
 }
 
 // Given three signature bytes return index in uP_table or -1 if not found
 int upidxsig(const uint8_t *sigs) {
-  for(size_t i=0; i< sizeof uP_table/sizeof *uP_table; i++) {
-    if(0 == memcmp(sigs, uP_table[i].sigs, sizeof uP_table->sigs))
-      return i;
+  const int *idx = upindex(&avr_db.upi_sig, upcmp_sig);
+  int lo = 0, hi = UP_N;
+
+  while(lo < hi) {
+    int mid = (lo + hi)/2;
+
+    if(memcmp(uP_table[idx[mid]].sigs, sigs, sizeof uP_table->sigs) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  return -1;
+
+  return lo < UP_N && !memcmp(uP_table[idx[lo]].sigs, sigs, sizeof uP_table->sigs)? idx[lo]: -1;
 }
 
 // Given the long name of a part return index in uP table or -1 if not found
 int upidxname(const char *name) {
-  for(size_t i=0; i < sizeof uP_table/sizeof *uP_table; i++)
-    if(0 == strcasecmp(name, uP_table[i].name))
-      return i;
+  const int *idx = upindex(&avr_db.upi_name, upcmp_name);
+  int lo = 0, hi = UP_N;
+
+  while(lo < hi) {
+    int mid = (lo + hi)/2;
+
+    if(strcasecmp(uP_table[idx[mid]].name, name) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
 
-  return -1;
+  return lo < UP_N && !strcasecmp(uP_table[idx[lo]].name, name)? idx[lo]: -1;
 }
 
 // Given sig bytes return number of matching indices in uP_table and create a list of names in p
@@ -49,6 +49,99 @@ void avr_free_opcode(OPCODE *op) {
   mmt_free(op);
 }
 
+// Add command bit i with source bit bitno to the runs of its kind; return -1 if too many shifts
+static int oprun_add(OPRUN *r, int i, int bitno) {
+  int k, shift = i - bitno;
+
+  for(k = 0; k < r->n; k++)
+    if(r->shift[k] == shift)
+      break;
+  if(k == r->n) {
+    if(r->n == OP_NRUNS)
+      return -1;
+    r->shift[r->n++] = shift;
+  }
+  r->mask[k] |= 1UL << i;
+
+  return 0;
+}
+
+// Scatter source bits into command word bits as described by the runs
+static uint32_t oprun_put(const OPRUN *r, uint32_t src) {
+  uint32_t w = 0;
+
+  for(int k = 0; k < r->n; k++)
+    w |= (r->shift[k] >= 0? src << r->shift[k]: src >> -r->shift[k]) & r->mask[k];
+
+  return w;
+}
+
+// Gather command word bits into source bit positions as described by the runs
+static uint32_t oprun_get(const OPRUN *r, uint32_t w) {
+  uint32_t src = 0;
+
+  for(int k = 0; k < r->n; k++)
+    src |= r->shift[k] >= 0? (w & r->mask[k]) >> r->shift[k]: (w & r->mask[k]) << -r->shift[k];
+
+  return src;
+}
+
+static uint32_t cmd2word(const unsigned char *cmd) {
+  return (uint32_t) cmd[0] << 24 | (uint32_t) cmd[1] << 16 | (uint32_t) cmd[2] << 8 | cmd[3];
+}
+
+static void word2cmd(unsigned char *cmd, uint32_t w) {
+  cmd[0] = w >> 24, cmd[1] = w >> 16, cmd[2] = w >> 8, cmd[3] = w;
+}
+
+/*
+ * avr_compile_opcode()
+ *
+ * Translate the 32 bit specs of the opcode into masks and a few shifts so
+ * that the functions below build a command with a handful of word operations
+ * instead of interpreting each bit; opcodes that cannot be compiled (source
+ * bit numbers out of range or too many different shifts) keep using the bit
+ * specs.
+ */
+void avr_compile_opcode(OPCODE *op) {
+  memset(&op->compiled, 0, sizeof *op - offsetof(OPCODE, compiled));
+
+  for(int i = 0; i < 32; i++) {
+    const CMDBIT *b = op->bit + i;
+
+    switch(b->type) {
+    case AVR_CMDBIT_VALUE:
+      if(b->value)
+        op->fixval |= 1UL << i;
+      // Fall through
+    case AVR_CMDBIT_IGNORE:
+      op->fixmask |= 1UL << i;
+      break;
+    case AVR_CMDBIT_ADDRESS:
+      if(b->bitno < 0 || b->bitno > 31 || oprun_add(&op->arun, i, b->bitno) < 0)
+        goto fail;
+      op->amask |= 1UL << i;
+      op->abits |= 1UL << b->bitno;
+      break;
+    case AVR_CMDBIT_INPUT:
+      if(b->bitno < 0 || b->bitno > 7 || oprun_add(&op->irun, i, b->bitno) < 0)
+        goto fail;
+      op->imask |= 1UL << i;
+      break;
+    case AVR_CMDBIT_OUTPUT:
+      if(b->bitno < 0 || b->bitno > 7 || oprun_add(&op->orun, i, b->bitno) < 0)
+        goto fail;
+      op->omask |= 1UL << i;
+      break;
+    }
+  }
+  op->compiled = 1;
+  return;
+
+fail:
+  memset(&op->compiled, 0, sizeof *op - offsetof(OPCODE, compiled));
+}
+
 // Returns position 0..31 of highest bit set or INT_MIN if no bit is set
 int intlog2(unsigned int n) {
   int ret;
@@ -71,6 +164,11 @@ int avr_set_bits(const OPCODE *op, unsigned char *cmd) {
   int i, j, bit;
   unsigned char mask;
 
+  if(op->compiled) {
+    word2cmd(cmd, (cmd2word(cmd) & ~op->fixmask) | op->fixval);
+    return 0;
+  }
+
   for(i = 0; i < 32; i++) {
     if(op->bit[i].type == AVR_CMDBIT_VALUE || op->bit[i].type == AVR_CMDBIT_IGNORE) {
       j = 3 - i/8;
@@ -97,6 +195,11 @@ int avr_set_addr(const OPCODE *op, unsigned char *cmd, unsigned long addr) {
   unsigned long value;
   unsigned char mask;
 
+  if(op->compiled) {
+    word2cmd(cmd, (cmd2word(cmd) & ~op->amask) | oprun_put(&op->arun, addr));
+    return 0;
+  }
+
   for(i = 0; i < 32; i++) {
     if(op->bit[i].type == AVR_CMDBIT_ADDRESS) {
       j = 3 - i/8;
@@ -176,6 +279,15 @@ int avr_set_addr_mem(const AVRMEM *mem, int opnum, unsigned char *cmd, unsigned
   if(opnum != AVR_OP_LOAD_EXT_ADDR && hi > 15)
     hi = 15;
 
+  if(op->compiled) {
+    uint32_t range = lo >= 0 && hi < 32 && lo <= hi? (0xffffffffUL >> (31 - hi)) & (0xffffffffUL << lo): 0;
+
+    word2cmd(cmd, (cmd2word(cmd) & ~op->amask) | oprun_put(&op->arun, addr & range));
+    range &= ~op->abits;        // Necessary bits that miss in opcode
+
+    return range? intlog2(range) + 1: 0;
+  }
+
   unsigned char avail[32];
 
   memset(avail, 0, sizeof avail);
@@ -219,6 +331,11 @@ int avr_set_input(const OPCODE *op, unsigned char *cmd, unsigned char data) {
   unsigned char value;
   unsigned char mask;
 
+  if(op->compiled) {
+    word2cmd(cmd, (cmd2word(cmd) & ~op->imask) | oprun_put(&op->irun, data));
+    return 0;
+  }
+
   for(i = 0; i < 32; i++) {
     if(op->bit[i].type == AVR_CMDBIT_INPUT) {
       j = 3 - i/8;
@@ -245,6 +362,11 @@ int avr_get_output(const OPCODE *op, const unsigned char *res, unsigned char *da
   unsigned char value;
   unsigned char mask;
 
+  if(op->compiled) {            // Only sets output bits, as below
+    *data |= oprun_get(&op->orun, cmd2word(res));
+    return 0;
+  }
+
   for(i = 0; i < 32; i++) {
     if(op->bit[i].type == AVR_CMDBIT_OUTPUT) {
       j = 3 - i/8;
@@ -270,6 +392,9 @@ int avr_get_output(const OPCODE *op, const unsigned char *res, unsigned char *da
 int avr_get_output_index(const OPCODE *op) {
   int i, j;
 
+  if(op->compiled)
+    return op->omask? 3 - intlog2(op->omask & -op->omask)/8: -1;
+
   for(i = 0; i < 32; i++) {
     if(op->bit[i].type == AVR_CMDBIT_OUTPUT) {
       j = 3 - i/8;
@@ -301,7 +426,7 @@ AVRMEM *avr_new_memory(const char *name, int size) {
   m->page_size = 1;             // Ensure not 0
   m->size = size;
   m->buf = mmt_malloc(size);
-  m->tags = mmt_malloc(size);
+  m->tags = mmt_malloc(tag_bytes(size));
   m->initval = -1;              // Unknown value represented as -1
   m->bitmask = -1;              // Default to -1
 
@@ -335,6 +460,57 @@ const char *avr_mem_name(const AVRPART *p, const AVRMEM *mem) {
   return cache_string(ret);
 }
 
+// Memory lookup tables of a part valid while its memory and alias lists remain unchanged
+typedef struct avrmem_index {
+  unsigned long mem_gen, alias_gen;     // Generations of p->mem and p->mem_alias when built
+  AVRMEM *type[32];                     // First memory that has Memtype bit n set
+  AVRMEM *fuse[MEM_FUSEOFF_MASK + 1];   // First fuse with offset n
+  LHASHID mems, aliases;                // First memory/alias by exact name
+} Avrmem_index;
+
+static void avr_free_mem_index(AVRPART *p) {
+  if(p->mem_index) {
+    lhdestroy(p->mem_index->mems);
+    lhdestroy(p->mem_index->aliases);
+    mmt_free(p->mem_index);
+    p->mem_index = NULL;
+  }
+}
+
+static void avr_build_mem_index(AVRPART *p) {
+  Avrmem_index *x;
+
+  avr_free_mem_index(p);
+  p->mem_index = x = mmt_malloc(sizeof *x);
+  x->mem_gen = lgen(p->mem);
+  x->alias_gen = lgen(p->mem_alias);
+  x->mems = lhcreat();
+  x->aliases = lhcreat();
+
+  for(LNODEID ln = lfirst(p->mem); ln; ln = lnext(ln)) {
+    AVRMEM *m = ldata(ln);
+
+    for(int i = 0; i < 32; i++)
+      if(m->type & (1U << i) && !x->type[i])
+        x->type[i] = m;
+    if(mem_is_a_fuse(m) && !x->fuse[mem_fuse_offset(m)])
+      x->fuse[mem_fuse_offset(m)] = m;
+    lhadd(x->mems, m->desc, m);
+  }
+  for(LNODEID ln = lfirst(p->mem_alias); ln; ln = lnext(ln)) {
+    AVRMEM_ALIAS *a = ldata(ln);
+
+    lhadd(x->aliases, a->desc, a);
+  }
+}
+
+// Return the memory index of p if it is still valid, NULL otherwise
+static const Avrmem_index *avr_mem_index(const AVRPART *p) {
+  const Avrmem_index *x = p->mem_index;
+
+  return x && x->mem_gen == lgen(p->mem) && x->alias_gen == lgen(p->mem_alias)? x: NULL;
+}
+
 // Allocate and initialize memory buffers for each of the device's defined memory regions
 int avr_initmem(const AVRPART *p) {
   if(p == NULL || p->mem == NULL)
@@ -344,8 +520,9 @@ int avr_initmem(const AVRPART *p) {
     AVRMEM *m = ldata(ln);
 
     m->buf = mmt_malloc(m->size);
-    m->tags = mmt_malloc(m->size);
+    m->tags = mmt_malloc(tag_bytes(m->size));
   }
+  avr_build_mem_index((AVRPART *) p);
 
   return 0;
 }
@@ -356,14 +533,17 @@ AVRMEM *avr_dup_mem(const AVRMEM *m) {
   if(m) {
     *n = *m;
 
+    // Fresh buffers are zero: only copy contents that were written to
     if(m->buf) {
       n->buf = mmt_malloc(n->size);
-      memcpy(n->buf, m->buf, n->size);
+      if(!is_memset(m->buf, 0, n->size))
+        memcpy(n->buf, m->buf, n->size);
     }
 
     if(m->tags) {
-      n->tags = (unsigned char *) mmt_malloc(n->size);
-      memcpy(n->tags, m->tags, n->size);
+      n->tags = (unsigned char *) mmt_malloc(tag_bytes(n->size));
+      if(tag_any(m->tags, 0, n->size))
+        memcpy(n->tags, m->tags, tag_bytes(n->size));
     }
 
     for(int i = 0; i < AVR_OP_MAX; i++)
@@ -407,20 +587,94 @@ void avr_free_memalias(AVRMEM_ALIAS *m) {
   mmt_free(m);
 }
 
+// Set the allocation tags of bytes [from, from+n)
+void tag_set_range(unsigned char *tags, int from, int n) {
+  for(; n > 0 && from%8; n--, from++)
+    tag_set(tags, from);
+  if(n >= 8) {
+    memset(tags + from/8, 0xff, n/8);
+    from += n/8*8, n %= 8;
+  }
+  for(; n > 0; n--, from++)
+    tag_set(tags, from);
+}
+
+// Clear the allocation tags of bytes [from, from+n)
+void tag_clr_range(unsigned char *tags, int from, int n) {
+  for(; n > 0 && from%8; n--, from++)
+    tag_clr(tags, from);
+  if(n >= 8) {
+    memset(tags + from/8, 0, n/8);
+    from += n/8*8, n %= 8;
+  }
+  for(; n > 0; n--, from++)
+    tag_clr(tags, from);
+}
+
+// First index in [from, to) whose tag is set (set == 1) or clear (set == 0), or to if none
+int tag_next(const unsigned char *tags, int from, int to, int set) {
+  const uint64_t skip = set? 0: ~(uint64_t) 0;
+  uint64_t w;
+
+  for(; from < to && from%8; from++)
+    if(tag_isset(tags, from) == !!set)
+      return from;
+
+  // Skip 64 bytes a machine word at a time, then 8 bytes a tag byte at a time
+  for(; from + 64 <= to; from += 64) {
+    memcpy(&w, tags + from/8, sizeof w);
+    if(w != skip)
+      break;
+  }
+  for(; from + 8 <= to && tags[from/8] == (unsigned char) skip; from += 8)
+    continue;
+
+  for(; from < to; from++)
+    if(tag_isset(tags, from) == !!set)
+      return from;
+
+  return to;
+}
+
+// Whether any tag of bytes [from, from+n) is set
+int tag_any(const unsigned char *tags, int from, int n) {
+  return n > 0 && tag_next(tags, from, from + n, 1) < from + n;
+}
+
+// Copy n tags starting at index sfrom of src to those starting at dfrom of dst
+void tag_copy(unsigned char *dst, int dfrom, const unsigned char *src, int sfrom, int n) {
+  if(dfrom%8 == sfrom%8) {      // Same bit alignment: copy whole bytes in the middle
+    for(; n > 0 && dfrom%8; n--, dfrom++, sfrom++)
+      tag_isset(src, sfrom)? tag_set(dst, dfrom): tag_clr(dst, dfrom);
+    if(n >= 8) {
+      memcpy(dst + dfrom/8, src + sfrom/8, n/8);
+      dfrom += n/8*8, sfrom += n/8*8, n %= 8;
+    }
+  }
+  for(; n > 0; n--, dfrom++, sfrom++)
+    tag_isset(src, sfrom)? tag_set(dst, dfrom): tag_clr(dst, dfrom);
+}
+
 AVRMEM_ALIAS *avr_locate_memalias(const AVRPART *p, const char *desc) {
   AVRMEM_ALIAS *m, *match;
-  LNODEID ln;
   int matches, d1;
   size_t l;
 
   if(!p || !desc || !(d1 = *desc) || !p->mem_alias)
     return NULL;
 
+  const Avrmem_index *x = avr_mem_index(p);
+
+  if(x && (m = lhget(x->aliases, desc)) && str_eq(m->desc, desc))
+    return m;
+
   l = strlen(desc);
   matches = 0;
   match = NULL;
-  for(ln = lfirst(p->mem_alias); ln; ln = lnext(ln)) {
-    m = ldata(ln);
+  void **v = lvec(p->mem_alias);
+
+  for(int i = 0, n = lsize(p->mem_alias); i < n; i++) {
+    m = v[i];
     if(d1 == *m->desc && !strncmp(m->desc, desc, l)) {  // Partial initial match
       match = m;
       matches++;
@@ -434,18 +688,24 @@ AVRMEM_ALIAS *avr_locate_memalias(const AVRPART *p, const char *desc) {
 
 AVRMEM *avr_locate_mem_noalias(const AVRPART *p, const char *desc) {
   AVRMEM *m, *match;
-  LNODEID ln;
   int matches, d1;
   size_t l;
 
   if(!p || !desc || !(d1 = *desc) || !p->mem)
     return NULL;
 
+  const Avrmem_index *x = avr_mem_index(p);
+
+  if(x && (m = lhget(x->mems, desc)) && str_eq(m->desc, desc))
+    return m;
+
   l = strlen(desc);
   matches = 0;
   match = NULL;
-  for(ln = lfirst(p->mem); ln; ln = lnext(ln)) {
-    m = ldata(ln);
+  void **v = lvec(p->mem);
+
+  for(int i = 0, n = lsize(p->mem); i < n; i++) {
+    m = v[i];
     if(d1 == *m->desc && !strncmp(m->desc, desc, l)) {  // Partial initial match
       match = m;
       matches++;
@@ -473,11 +733,14 @@ AVRMEM *avr_locate_mem(const AVRPART *p, const char *desc) {
 AVRMEM *avr_locate_fuse_by_offset(const AVRPART *p, unsigned int off) {
   AVRMEM *m;
 
-  if(p && p->mem)
-    for(LNODEID ln = lfirst(p->mem); ln; ln = lnext(ln))
-      if(mem_is_a_fuse(m = ldata(ln)))
+  if(p && p->mem) {
+    void **v = lvec(p->mem);
+
+    for(int i = 0, n = lsize(p->mem); i < n; i++)
+      if(mem_is_a_fuse(m = v[i]))
         if(off == mem_fuse_offset(m) || (m->size == 2 && off - 1 == mem_fuse_offset(m)))
           return m;
+  }
 
   return NULL;
 }
@@ -486,14 +749,27 @@ AVRMEM *avr_locate_fuse_by_offset(const AVRPART *p, unsigned int off) {
 AVRMEM *avr_locate_mem_by_type(const AVRPART *p, Memtype type) {
   AVRMEM *m;
   Memtype off = type & MEM_FUSEOFF_MASK;
+  const Avrmem_index *x;
 
   type &= ~(Memtype) MEM_FUSEOFF_MASK;
 
-  if(p && p->mem)
-    for(LNODEID ln = lfirst(p->mem); ln; ln = lnext(ln))
-      if((m = ldata(ln))->type & type)
+  if(p && (x = avr_mem_index(p))) {     // Single type bit: look up index
+    if(type == MEM_IS_A_FUSE)
+      return x->fuse[off];
+    if(type && !(type & (type - 1)))
+      for(int i = 0; i < 32; i++)
+        if(type == 1U << i)
+          return x->type[i];
+  }
+
+  if(p && p->mem) {
+    void **v = lvec(p->mem);
+
+    for(int i = 0, n = lsize(p->mem); i < n; i++)
+      if((m = v[i])->type & type)
         if(type != MEM_IS_A_FUSE || off == mem_fuse_offset(m))
           return m;
+  }
 
   return NULL;
 }
@@ -504,13 +780,16 @@ unsigned int avr_data_offset(const AVRPART *p) {
 }
 
 AVRMEM_ALIAS *avr_find_memalias(const AVRPART *p, const AVRMEM *m_orig) {
-  if(p && p->mem_alias && m_orig)
-    for(LNODEID ln = lfirst(p->mem_alias); ln; ln = lnext(ln)) {
-      AVRMEM_ALIAS *m = ldata(ln);
+  if(p && p->mem_alias && m_orig) {
+    void **v = lvec(p->mem_alias);
+
+    for(int i = 0, n = lsize(p->mem_alias); i < n; i++) {
+      AVRMEM_ALIAS *m = v[i];
 
       if(m->aliased_mem == m_orig)
         return m;
     }
+  }
 
   return NULL;
 }
@@ -947,8 +1226,8 @@ AVRPART *avr_new_part(void) {
   p->parent_id = nulp;
   p->family_id = nulp;
   p->config_file = nulp;
-  p->mem = lcreat(NULL, 0);
-  p->mem_alias = lcreat(NULL, 0);
+  p->mem = lcreat_vec(NULL, 0);
+  p->mem_alias = lcreat_vec(NULL, 0);
   p->variants = lcreat(NULL, 0);
 
   // Default values
@@ -974,8 +1253,8 @@ AVRPART *avr_dup_part(const AVRPART *d) {
 
     // Leave variants list empty but duplicate the memory and alias chains
     p->variants = lcreat(NULL, 0);
-    p->mem = lcreat(NULL, 0);
-    p->mem_alias = lcreat(NULL, 0);
+    p->mem = lcreat_vec(NULL, 0);
+    p->mem_alias = lcreat_vec(NULL, 0);
     for(LNODEID ln = lfirst(d->mem); ln; ln = lnext(ln)) {
       AVRMEM *m = ldata(ln);
       AVRMEM *m2 = avr_dup_mem(m);
@@ -997,12 +1276,44 @@ AVRPART *avr_dup_part(const AVRPART *d) {
 
     for(int i = 0; i < AVR_OP_MAX; i++)
       p->op[i] = avr_dup_opcode(p->op[i]);
+
+    p->mem_index = NULL;
+    if(d->mem_index)
+      avr_build_mem_index(p);
+  }
+
+  return p;
+}
+
+/*
+ * Lightweight duplicate of part d that only carries a copy of its memory m,
+ * eg, as verification reference for m; part-level fields are copied as in
+ * avr_dup_part() but d's other memories and aliases are left out. Free with
+ * avr_free_part().
+ */
+AVRPART *avr_dup_part_mem(const AVRPART *d, const AVRMEM *m) {
+  AVRPART *p = avr_new_part();
+
+  if(d) {
+    *p = *d;
+
+    p->variants = lcreat(NULL, 0);
+    p->mem = lcreat_vec(NULL, 0);
+    p->mem_alias = lcreat_vec(NULL, 0);
+    if(m)
+      ladd(p->mem, avr_dup_mem(m));
+
+    for(int i = 0; i < AVR_OP_MAX; i++)
+      p->op[i] = avr_dup_opcode(p->op[i]);
+
+    p->mem_index = NULL;
   }
 
   return p;
 }
 
 void avr_free_part(AVRPART *d) {
+  avr_free_mem_index(d);
   ldestroy_cb(d->mem, (void (*)(void *)) avr_free_mem);
   d->mem = NULL;
   ldestroy_cb(d->mem_alias, (void (*)(void *)) avr_free_memalias);
@@ -1020,48 +1331,109 @@ void avr_free_part(AVRPART *d) {
   mmt_free(d);
 }
 
-AVRPART *locate_part(const LISTID parts, const char *partdesc) {
-  AVRPART *p = NULL;
-  int found = 0;
+// Add the names that part_eq() matches and the signature of p to the part index
+static void part_index_add(AVRPART *p) {
+  size_t desclen = strlen(p->desc), variantlen, dashlen;
+  char query[1024];
+
+  lhadd(avr_db.avr_pidx_names, p->id, p);
+  lhadd(avr_db.avr_pidx_names, p->desc, p);
+  for(LNODEID ln = lfirst(p->variants); ln; ln = lnext(ln)) {
+    const char *q = (const char *) ldata(ln), *qdash = strchr(q, '-'), *qcolon = strchr(q, ':');
+
+    variantlen = qcolon? (size_t) (qcolon - q): strlen(q);
+    dashlen = qdash? (size_t) (qdash - q): variantlen;
+    if(variantlen < sizeof query && (variantlen != desclen || memcmp(q, p->desc, desclen))) {
+      memcpy(query, q, variantlen);
+      query[variantlen] = 0;
+      lhadd(avr_db.avr_pidx_names, query, p);
+      if(dashlen > desclen && dashlen < variantlen) {
+        query[dashlen] = 0;
+        lhadd(avr_db.avr_pidx_names, query, p);
+      }
+    }
+  }
+
+  if(*p->id && *p->id != '.' && !is_memset(p->signature, 0xff, 3) && !is_memset(p->signature, 0, 3)) {
+    const char *sig = str_ccprintf("%02x%02x%02x", p->signature[0], p->signature[1], p->signature[2]);
+    LISTID same = lhget(avr_db.avr_pidx_sigs, sig);
+
+    if(!same)
+      lhadd(avr_db.avr_pidx_sigs, sig, same = lcreat(NULL, 0));
+    ladd(same, p);
+  }
+}
 
+/*
+ * Bring the index of parts up to date: rebuild it when the list is a
+ * different one or has changed other than by appending; otherwise only
+ * index the parts added since last time
+ */
+static void part_index_update(const LISTID parts) {
+  if(parts != avr_db.avr_pidx_list || lgen(parts) != avr_db.avr_pidx_gen || !avr_db.avr_pidx_names) {
+    lhdestroy(avr_db.avr_pidx_names);
+    lhdestroy_cb(avr_db.avr_pidx_sigs, (void (*)(void *)) ldestroy);
+    avr_db.avr_pidx_names = lhcreat();
+    avr_db.avr_pidx_sigs = lhcreat();
+    avr_db.avr_pidx_list = parts;
+    avr_db.avr_pidx_gen = lgen(parts);
+    avr_db.avr_pidx_last = NULL;
+  }
+
+  for(LNODEID ln = avr_db.avr_pidx_last? lnext(avr_db.avr_pidx_last): lfirst(parts); ln; ln = lnext(ln)) {
+    part_index_add(ldata(ln));
+    avr_db.avr_pidx_last = ln;
+  }
+}
+
+AVRPART *locate_part(const LISTID parts, const char *partdesc) {
   if(!parts || !partdesc)
     return NULL;
 
-  for(LNODEID ln1 = lfirst(parts); ln1 && !found; ln1 = lnext(ln1)) {
-    p = ldata(ln1);
-    if(part_eq(p, partdesc, str_caseeq))
-      found = 1;
-  }
+  avr_db_lock();
+  part_index_update(parts);
+  AVRPART *p = lhget(avr_db.avr_pidx_names, partdesc);
 
-  return found? p: NULL;
+  avr_db_unlock();
+
+  return p;
 }
 
 AVRPART *locate_part_by_avr910_devcode(const LISTID parts, int devcode) {
-  if(parts)
-    for(LNODEID ln1 = lfirst(parts); ln1; ln1 = lnext(ln1)) {
-      AVRPART *p = ldata(ln1);
+  if(parts) {
+    void **v = lvec(parts);
+
+    for(int i = 0, n = lsize(parts); i < n; i++) {
+      AVRPART *p = v[i];
 
       if(p->avr910_devcode == devcode)
         return p;
     }
+  }
 
   return NULL;
 }
 
 // Return pointer to first part that has signature sig (unless all 0xff or all 0x00); NULL if no match
 AVRPART *locate_part_by_signature_pm(const LISTID parts, unsigned char *sig, int sigsize, int prog_modes) {
+  AVRPART *ret = NULL;
+
   if(parts && sigsize == 3) {
-    for(LNODEID ln = lfirst(parts); ln; ln = lnext(ln)) {
+    avr_db_lock();
+    part_index_update(parts);
+    LISTID same = lhget(avr_db.avr_pidx_sigs, str_ccprintf("%02x%02x%02x", sig[0], sig[1], sig[2]));
+
+    for(LNODEID ln = same? lfirst(same): NULL; ln; ln = lnext(ln)) {
       AVRPART *p = ldata(ln);
 
-      if(!*p->id || *p->id == '.')      // Skip stump entries
-        continue;
-      if(!is_memset(p->signature, 0xff, 3) && !is_memset(p->signature, 0, 3))
-        if(!memcmp(p->signature, sig, 3) && p->prog_modes & prog_modes)
-          return p;
+      if(p->prog_modes & prog_modes) {
+        ret = p;
+        break;
+      }
     }
+    avr_db_unlock();
   }
-  return NULL;
+  return ret;
 }
 
 AVRPART *locate_part_by_signature(const LISTID parts, unsigned char *sig, int sigsize) {
@@ -0,0 +1,383 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Running many serial programmers on one thread
+ *
+ * Sessions of avrasync.c need one worker thread per programmer, which for a
+ * rack of dozens of serial-protocol targets (serialupdi, urclock, arduino,
+ * stk500v2 over CDC etc) means dozens of threads that spend nearly all their
+ * time blocked waiting for replies. A reactor created with avr_reactor_new()
+ * instead runs the jobs added with avr_reactor_add() as coroutines on the
+ * thread that calls avr_reactor_run(). Each job has its own libavrdude
+ * context and its own copy of the other thread-local variables, eg, verbose
+ * and serdev, and runs fn(pgm, p, arg), typically opening, initialising and
+ * programming one target. Whenever the serial layer of ser_posix.c would
+ * wait for a port to become readable or writable it yields instead (see
+ * cx->ser_wait_hook), and the reactor resumes the job once epoll() (poll()
+ * outside Linux) reports the port ready or the timeout is over. The protocol
+ * code thus runs unchanged as a state machine driven by readiness events.
+ *
+ * Delays that drivers implement with usleep() still block the thread, as do
+ * programmers that are not driven through the serial layer, eg, USB ones;
+ * these are better served by avrasync.c sessions. Without ucontext
+ * coroutines (eg, on Windows) the jobs run one after the other.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if !defined(WIN32) && (defined(__GLIBC__) || defined(__FreeBSD__))
+#define AVR_REACTOR_COROUTINES 1
+#include <ucontext.h>
+#if defined(__linux__)
+#define AVR_REACTOR_EPOLL 1
+#include <sys/epoll.h>
+#include <unistd.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+#define REACTOR_STACK (1 << 20) // Stack size of each job
+
+enum {                          // States of jobs
+  JOB_READY,                    // Can run
+  JOB_WAITING,                  // Waits for its fd or timeout
+  JOB_DONE,
+};
+
+typedef struct {                // Thread-local variables outside cx that jobs on one thread share
+  Avr_opts opts;
+  struct serial_device *serdev;
+  long recv_timeout, drain_timeout;
+} Job_tls;
+
+// Save the thread-local variables of the running job or the reactor
+static void job_tls_save(Job_tls *t) {
+  avr_opts_save(&t->opts);
+  t->serdev = serdev;
+  t->recv_timeout = serial_recv_timeout;
+  t->drain_timeout = serial_drain_timeout;
+}
+
+static void job_tls_load(const Job_tls *t) {
+  avr_opts_load(&t->opts);
+  serdev = t->serdev;
+  serial_recv_timeout = t->recv_timeout;
+  serial_drain_timeout = t->drain_timeout;
+}
+
+typedef struct {
+  Avr_reactor *r;
+  PROGRAMMER *pgm;
+  const AVRPART *p;
+  Avr_async_fn fn;
+  void *arg;
+  libavrdude_context *cx;       // Context of the job
+  Job_tls tls;                  // Thread-local variables of the job while it is not running
+  int state, rc;
+#ifdef AVR_REACTOR_COROUTINES
+  ucontext_t uc;
+  void *stack;
+  int fd, out;                  // What the waiting job waits for: fd readable (out = 0) or writable
+  uint64_t deadline;            // Time in us when the wait times out, 0 for never
+  int ready;                    // Result of the wait: 1 ready, 0 timeout, -1 error
+  int regfd;                    // File descriptor registered with epoll, -1 if none
+#endif
+} Reactor_job;
+
+struct avr_reactor {
+  Reactor_job **jobs;
+  int njobs;
+#ifdef AVR_REACTOR_COROUTINES
+  ucontext_t main;              // Context of the thread running the reactor
+#ifdef AVR_REACTOR_EPOLL
+  int epfd;
+#endif
+#endif
+};
+
+// Create a reactor; returns NULL if the event mechanism is not available
+Avr_reactor *avr_reactor_new(void) {
+  Avr_reactor *r = mmt_malloc(sizeof *r);
+
+#ifdef AVR_REACTOR_EPOLL
+  if((r->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    pmsg_ext_error("cannot create epoll instance: %s\n", strerror(errno));
+    mmt_free(r);
+    return NULL;
+  }
+#endif
+
+  return r;
+}
+
+// Free the reactor and its jobs; programmers and parts remain with the caller
+void avr_reactor_free(Avr_reactor *r) {
+  if(!r)
+    return;
+  for(int i = 0; i < r->njobs; i++) {
+    Reactor_job *job = r->jobs[i];
+
+#ifdef AVR_REACTOR_COROUTINES
+    mmt_free(job->stack);
+#endif
+    libavrdude_context *mine = cx;
+
+    cx = job->cx;
+    free_cx();
+    cx = mine;
+    mmt_free(job);
+  }
+  mmt_free(r->jobs);
+#ifdef AVR_REACTOR_EPOLL
+  close(r->epfd);
+#endif
+  mmt_free(r);
+}
+
+#ifdef AVR_REACTOR_COROUTINES
+// cx->ser_wait_hook of jobs: yield to the reactor until fd is ready or timeout_ms are over
+static int reactor_wait(int fd, int out, int timeout_ms) {
+  Reactor_job *job = cx->rct_job;
+  Avr_reactor *r = job->r;
+
+  job->fd = fd;
+  job->out = out;
+  job->deadline = timeout_ms < 0? 0: avr_ustimestamp() + 1000ULL*timeout_ms + !timeout_ms;
+#ifdef AVR_REACTOR_EPOLL
+  struct epoll_event ev = {
+    .events = (out? EPOLLOUT: EPOLLIN) | EPOLLONESHOT,
+    .data.ptr = job,
+  };
+  int op = job->regfd == fd? EPOLL_CTL_MOD: EPOLL_CTL_ADD;
+
+  if(op == EPOLL_CTL_ADD && job->regfd >= 0)
+    epoll_ctl(r->epfd, EPOLL_CTL_DEL, job->regfd, NULL);
+  if(epoll_ctl(r->epfd, op, fd, &ev) < 0 && (errno != ENOENT ||
+    epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) && (errno != EEXIST ||
+    epoll_ctl(r->epfd, EPOLL_CTL_MOD, fd, &ev) < 0)) {
+    pmsg_ext_error("cannot wait for fd %d: %s\n", fd, strerror(errno));
+    job->regfd = -1;
+    return -1;
+  }
+  job->regfd = fd;
+#endif
+
+  job->state = JOB_WAITING;
+  swapcontext(&job->uc, &r->main);
+
+  return job->ready;
+}
+
+static void reactor_entry(void) {
+  Reactor_job *job = cx->rct_job;
+
+  job->rc = job->fn(job->pgm, job->p, job->arg);
+  job->state = JOB_DONE;
+}                               // Returns to job->uc.uc_link, ie, the reactor
+#endif
+
+/*
+ * Add a job that runs fn(pgm, p, arg) with its own libavrdude context in
+ * avr_reactor_run(); pgm must not be used by anything else until then.
+ * Returns the job number or -1 on error.
+ */
+int avr_reactor_add(Avr_reactor *r, PROGRAMMER *pgm, const AVRPART *p, Avr_async_fn fn, void *arg) {
+  Reactor_job *job = mmt_malloc(sizeof *job);
+  libavrdude_context *mine = cx;
+
+  job->r = r;
+  job->pgm = pgm;
+  job->p = p;
+  job->fn = fn;
+  job->arg = arg;
+  job->state = JOB_READY;
+  job_tls_save(&job->tls);      // The job starts with the options of the caller
+  cx = NULL;                    // New context for the job
+  init_cx(NULL);
+  job->cx = cx;
+  cx = mine;
+
+#ifdef AVR_REACTOR_COROUTINES
+  job->regfd = -1;
+  job->cx->rct_job = job;
+  job->cx->ser_wait_hook = reactor_wait;
+  job->stack = mmt_malloc(REACTOR_STACK);
+  if(getcontext(&job->uc) < 0) {
+    pmsg_ext_error("cannot create job context: %s\n", strerror(errno));
+    mmt_free(job->stack);
+    libavrdude_context *mine = cx;
+
+    cx = job->cx;
+    free_cx();
+    cx = mine;
+    mmt_free(job);
+    return -1;
+  }
+  job->uc.uc_stack.ss_sp = job->stack;
+  job->uc.uc_stack.ss_size = REACTOR_STACK;
+  job->uc.uc_link = &r->main;
+  makecontext(&job->uc, reactor_entry, 0);
+#endif
+
+  r->jobs = mmt_realloc(r->jobs, (r->njobs + 1)*sizeof *r->jobs);
+  r->jobs[r->njobs] = job;
+
+  return r->njobs++;
+}
+
+// Run the job until it waits or is done
+static void reactor_resume(Avr_reactor *r, Reactor_job *job) {
+  libavrdude_context *mine = cx;
+  Job_tls tls;
+
+  job_tls_save(&tls);
+  job_tls_load(&job->tls);
+  cx = job->cx;
+#ifdef AVR_REACTOR_COROUTINES
+  job->state = JOB_READY;
+  swapcontext(&r->main, &job->uc);
+  job->cx = cx;                 // In case the job has replaced its context
+#else
+  job->rc = job->fn(job->pgm, job->p, job->arg);
+  job->state = JOB_DONE;
+#endif
+  cx = mine;
+  job_tls_save(&job->tls);
+  job_tls_load(&tls);
+}
+
+#ifdef AVR_REACTOR_COROUTINES
+// Wait for events of waiting jobs and make those ready whose fd is ready or whose wait timed out
+static void reactor_collect(Avr_reactor *r) {
+  uint64_t now = avr_ustimestamp(), first = 0;
+  int nwait = 0, timeout;
+
+  for(int i = 0; i < r->njobs; i++) {
+    Reactor_job *job = r->jobs[i];
+
+    if(job->state == JOB_WAITING) {
+      nwait++;
+      if(job->deadline && (!first || job->deadline < first))
+        first = job->deadline;
+    }
+  }
+  if(!nwait)
+    return;
+  timeout = !first? -1: first <= now? 0: (int) ((first - now + 999)/1000);
+
+#ifdef AVR_REACTOR_EPOLL
+  struct epoll_event evs[64];
+  int n = epoll_wait(r->epfd, evs, sizeof evs/sizeof *evs, timeout);
+
+  for(int i = 0; i < n; i++) {
+    Reactor_job *job = evs[i].data.ptr;
+
+    if(job->state == JOB_WAITING) {
+      job->ready = evs[i].events & EPOLLERR && !(evs[i].events & (EPOLLIN | EPOLLOUT))? -1: 1;
+      job->state = JOB_READY;
+    }
+  }
+#else
+  struct pollfd *pfds = mmt_malloc(nwait*sizeof *pfds);
+  Reactor_job **waiting = mmt_malloc(nwait*sizeof *waiting);
+  int k = 0, n;
+
+  for(int i = 0; i < r->njobs; i++)
+    if(r->jobs[i]->state == JOB_WAITING) {
+      waiting[k] = r->jobs[i];
+      pfds[k].fd = waiting[k]->fd;
+      pfds[k].events = waiting[k]->out? POLLOUT: POLLIN;
+      k++;
+    }
+  if((n = poll(pfds, nwait, timeout)) > 0)
+    for(k = 0; k < nwait; k++)
+      if(pfds[k].revents) {
+        waiting[k]->ready = pfds[k].revents & (POLLERR | POLLNVAL) &&
+          !(pfds[k].revents & (POLLIN | POLLOUT))? -1: 1;
+        waiting[k]->state = JOB_READY;
+      }
+  mmt_free(pfds);
+  mmt_free(waiting);
+#endif
+
+  int failed = n < 0 && errno != EINTR;
+
+  if(failed)
+    pmsg_ext_error("cannot wait for serial ports: %s\n", strerror(errno));
+
+  now = avr_ustimestamp();
+  for(int i = 0; i < r->njobs; i++) {
+    Reactor_job *job = r->jobs[i];
+
+    if(job->state == JOB_WAITING && (failed || (job->deadline && now >= job->deadline))) {
+      job->ready = failed? -1: 0;
+      job->state = JOB_READY;
+    }
+  }
+}
+#endif
+
+/*
+ * Run all jobs until they are done; returns the number of jobs whose
+ * function returned a negative value
+ */
+int avr_reactor_run(Avr_reactor *r) {
+  int busy, nfail = 0;
+
+  do {
+    busy = 0;
+    for(int i = 0; i < r->njobs; i++) {
+      Reactor_job *job = r->jobs[i];
+
+      if(job->state == JOB_READY)
+        reactor_resume(r, job);
+      busy += job->state != JOB_DONE;
+    }
+#ifdef AVR_REACTOR_COROUTINES
+    if(busy)
+      reactor_collect(r);
+#endif
+  } while(busy);
+
+  for(int i = 0; i < r->njobs; i++) {
+#ifdef AVR_REACTOR_EPOLL
+    if(r->jobs[i]->regfd >= 0) {
+      epoll_ctl(r->epfd, EPOLL_CTL_DEL, r->jobs[i]->regfd, NULL);
+      r->jobs[i]->regfd = -1;
+    }
+#endif
+    nfail += r->jobs[i]->rc < 0;
+  }
+
+  return nfail;
+}
+
+// Return value of the function of job jno once avr_reactor_run() has finished
+int avr_reactor_result(const Avr_reactor *r, int jno) {
+  return jno >= 0 && jno < r->njobs? r->jobs[jno]->rc: LIBAVRDUDE_GENERAL_FAILURE;
+}
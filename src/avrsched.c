@@ -0,0 +1,240 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Scheduling production units over several sessions
+ *
+ * A rack of fixtures often mixes programmers of very different speed, eg,
+ * UPDI over a serial adapter next to an Atmel-ICE and a few USBasps, and
+ * handing out units in rounds, one per programmer, lets every round wait
+ * for the slowest one. A scheduler created with avr_sched_new() instead
+ * keeps one queue of unit numbers for all its workers, which are sessions
+ * of avrasync.c added with avr_sched_add_worker(). Whenever a worker is
+ * idle it takes the next unit from the queue and runs the unit function
+ * fn(pgm, p, unit, arg) in its session, so fast programmers end up doing
+ * more units than slow ones and no worker waits while work is left.
+ *
+ * The unit function typically waits for the next board at its fixture and
+ * then programs and verifies it; it returns 0 on success and a negative
+ * value if the unit failed. LIBAVRDUDE_EXIT_FAIL means that the worker
+ * itself is no longer usable, eg, because the programmer was unplugged: the
+ * worker is retired and its unit goes back to the front of the queue for
+ * another worker. Writing and verifying a unit always happen in the same
+ * worker, as each target is wired to only one programmer.
+ *
+ * avr_sched_run() blocks until all units are done; event loops can instead
+ * call avr_sched_poll() whenever the fd of one of the sessions becomes
+ * readable. The scheduler itself runs in the calling thread.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if !defined(WIN32)
+#include <poll.h>
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+typedef struct {
+  Avr_sched *sc;
+  Avr_session *sess;
+  int unit;                     // Unit being worked on, -1 if idle
+  int retired;                  // Worker failed and takes no more units
+  int nok, nfail;               // Units done by this worker
+  uint64_t start, busy;         // Time in us when the current unit started and total time busy
+} Sched_worker;
+
+struct avr_sched {
+  Avr_unit_fn fn;
+  void *arg;
+  Sched_worker **w;             // Workers (pointers stay valid when the array grows)
+  int nw;
+  int *queue;                   // Unit numbers waiting for a worker
+  int qlen;
+  int nrunning;                 // Workers busy with a unit
+  int nok, nfail;
+};
+
+// Create a scheduler that runs fn(pgm, p, unit, arg) for each unit in one of its workers
+Avr_sched *avr_sched_new(Avr_unit_fn fn, void *arg) {
+  Avr_sched *sc = mmt_malloc(sizeof *sc);
+
+  sc->fn = fn;
+  sc->arg = arg;
+
+  return sc;
+}
+
+// Free the scheduler, which must not run units any more; the sessions remain with the caller
+void avr_sched_free(Avr_sched *sc) {
+  if(!sc)
+    return;
+  for(int i = 0; i < sc->nw; i++)
+    mmt_free(sc->w[i]);
+  mmt_free(sc->w);
+  mmt_free(sc->queue);
+  mmt_free(sc);
+}
+
+// Add a session as worker; returns the worker number
+int avr_sched_add_worker(Avr_sched *sc, Avr_session *s) {
+  Sched_worker *w = mmt_malloc(sizeof *w);
+
+  w->sc = sc;
+  w->sess = s;
+  w->unit = -1;
+  sc->w = mmt_realloc(sc->w, (sc->nw + 1)*sizeof *sc->w);
+  sc->w[sc->nw] = w;
+
+  return sc->nw++;
+}
+
+// Queue n units numbered first, first+1, ..., first+n-1
+void avr_sched_add_units(Avr_sched *sc, int first, int n) {
+  if(n <= 0)
+    return;
+  sc->queue = mmt_realloc(sc->queue, (sc->qlen + n)*sizeof *sc->queue);
+  for(int i = 0; i < n; i++)
+    sc->queue[sc->qlen++] = first + i;
+}
+
+// Put a unit back to the front of the queue
+static void sched_requeue(Avr_sched *sc, int unit) {
+  sc->queue = mmt_realloc(sc->queue, (sc->qlen + 1)*sizeof *sc->queue);
+  memmove(sc->queue + 1, sc->queue, sc->qlen*sizeof *sc->queue);
+  sc->queue[0] = unit;
+  sc->qlen++;
+}
+
+// Runs in the session worker
+static int sched_unit(PROGRAMMER *pgm, const AVRPART *p, void *arg) {
+  Sched_worker *w = arg;
+
+  return w->sc->fn(pgm, p, w->unit, w->sc->arg);
+}
+
+// Completion callback, runs in the thread calling avr_sched_poll()
+static void sched_done(Avr_async_op *op, int rc, void *ud) {
+  Sched_worker *w = ud;
+  Avr_sched *sc = w->sc;
+
+  (void) op;
+  w->busy += avr_ustimestamp() - w->start;
+  if(rc == LIBAVRDUDE_EXIT_FAIL) {
+    int wno = 0;
+
+    while(wno < sc->nw && sc->w[wno] != w)
+      wno++;
+    pmsg_warning("retiring worker %d; unit %d goes to another worker\n", wno, w->unit);
+    w->retired = 1;
+    sched_requeue(sc, w->unit);
+  } else if(rc < 0) {
+    w->nfail++, sc->nfail++;
+  } else {
+    w->nok++, sc->nok++;
+  }
+  w->unit = -1;
+  sc->nrunning--;
+}
+
+// Give the next units to idle workers
+static void sched_dispatch(Avr_sched *sc) {
+  for(int i = 0; i < sc->nw && sc->qlen; i++) {
+    Sched_worker *w = sc->w[i];
+
+    if(w->retired || w->unit >= 0)
+      continue;
+    w->unit = sc->queue[0];
+    memmove(sc->queue, sc->queue + 1, --sc->qlen*sizeof *sc->queue);
+    w->start = avr_ustimestamp();
+    sc->nrunning++;
+    if(!avr_async_call(w->sess, sched_unit, w, sched_done, w)) {
+      w->retired = 1;           // Put the unit back and try another worker
+      sc->nrunning--;
+      sched_requeue(sc, w->unit);
+      w->unit = -1;
+    }
+  }
+}
+
+/*
+ * Collect finished units and hand out queued ones to idle workers without
+ * blocking; returns the number of units waiting or running, excluding
+ * waiting units that no worker is left to take on
+ */
+int avr_sched_poll(Avr_sched *sc) {
+  int active = 0;
+
+  for(int i = 0; i < sc->nw; i++)
+    if(sc->w[i]->unit >= 0)
+      avr_async_poll(sc->w[i]->sess);
+  sched_dispatch(sc);
+  for(int i = 0; i < sc->nw; i++)
+    active += !sc->w[i]->retired;
+
+  return sc->nrunning + (active? sc->qlen: 0);
+}
+
+/*
+ * Run all queued units; returns the number of units that failed or that
+ * could not be run because all workers have been retired
+ */
+int avr_sched_run(Avr_sched *sc) {
+  while(avr_sched_poll(sc)) {
+#if !defined(WIN32)
+    struct pollfd *fds = mmt_malloc(sc->nw*sizeof *fds);
+    int n = 0;
+
+    for(int i = 0; i < sc->nw; i++)
+      if(sc->w[i]->unit >= 0 && (fds[n].fd = avr_session_fd(sc->w[i]->sess)) >= 0)
+        fds[n++].events = POLLIN;
+    if(n)                       // Timeout as safety net should a notification get lost
+      poll(fds, n, 100);
+    mmt_free(fds);
+#endif
+  }
+
+  return sc->nfail + sc->qlen;
+}
+
+/*
+ * Statistics of worker wno: units that succeeded and failed and the time in
+ * s spent on them; returns 1 if the worker has been retired, 0 if not and -1
+ * if there is no such worker
+ */
+int avr_sched_stats(const Avr_sched *sc, int wno, int *nok, int *nfail, double *busy) {
+  if(wno < 0 || wno >= sc->nw)
+    return -1;
+
+  const Sched_worker *w = sc->w[wno];
+
+  if(nok)
+    *nok = w->nok;
+  if(nfail)
+    *nfail = w->nfail;
+  if(busy)
+    *busy = w->busy/1e6;
+
+  return w->retired;
+}
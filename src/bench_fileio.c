@@ -0,0 +1,302 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmarks for the file parsers and writers of fileio.c
+ *
+ * bench_fileio writes pseudo-random images of 1 KiB to 8 MiB with
+ * fileio_mem() in every output format (b2ihex(), b2srec(), b2num() etc),
+ * reads them back in the same format (ihex2b(), srec2b(), num2b() etc),
+ * checks the round trip and prints the throughput of the fastest of a
+ * number of runs as markdown table. Immediate mode reads the hex number
+ * list as -U argument, and ELF images are produced by a minimal writer
+ * below, as fileio.c can read but not write ELF. The program is built with
+ * the CMake target bench_fileio and run by the benchmark target; it is
+ * neither installed nor part of the regression tests.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBELF
+#ifdef HAVE_LIBELF_H
+#include <libelf.h>
+#elif defined(HAVE_LIBELF_LIBELF_H)
+#include <libelf/libelf.h>
+#endif
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+// Global variables referenced by the library
+char *progname = "bench_fileio";
+LIBAVRDUDE_THREAD_LOCAL int verbose;
+LIBAVRDUDE_THREAD_LOCAL int quell_progress = 2;
+LIBAVRDUDE_THREAD_LOCAL int ovsigck;
+const char *partdesc = "";
+const char *pgmid = "";
+LIBAVRDUDE_THREAD_LOCAL libavrdude_context *cx;
+
+int avrdude_message2(FILE *fp, int lno, const char *file, const char *func, int msgmode, int msglvl,
+  const char *format, ...) {
+
+  int rc = 0;
+  va_list ap;
+
+  if(msglvl <= MSG_WARNING) {
+    if(msgmode & MSG2_PROGNAME)
+      fprintf(stderr, "%s: ", progname);
+    va_start(ap, format);
+    rc = vfprintf(stderr, *format == '\v'? format + 1: format, ap);
+    va_end(ap);
+  }
+
+  return rc;
+}
+
+static const struct {
+  const char *name;
+  FILEFMT format;
+  int elfsize;                  // Maximum image size for ELF (8 MiB - 1), 0 for other formats
+} formats[] = {
+  {"ihex", FMT_IHEX, 0},
+  {"ihex+comments", FMT_IHXC, 0},
+  {"srec", FMT_SREC, 0},
+  {"raw", FMT_RBIN, 0},
+  {"hex", FMT_HEX, 0},
+  {"dec", FMT_DEC, 0},
+  {"oct", FMT_OCT, 0},
+  {"bin", FMT_BIN, 0},
+  {"immediate", FMT_IMM, 0},
+  {"page image", FMT_PIMG, 0},
+#ifdef HAVE_LIBELF
+  {"elf", FMT_ELF, 0x7fffff},
+#endif
+};
+
+static const int sizes[] = { 1 << 10, 1 << 13, 1 << 16, 1 << 19, 1 << 22, 1 << 23 };
+
+#ifdef HAVE_LIBELF
+// Write n bytes of buf as ELF executable with one .text section to be loaded at flash address 0
+static int write_elf(const char *fname, const unsigned char *buf, int n) {
+  static const char shstrtab[] = "\0.text\0.shstrtab";
+  Elf32_Ehdr eh = {
+    .e_ident = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS32, ELFDATA2LSB, EV_CURRENT },
+    .e_type = ET_EXEC, .e_machine = EM_AVR, .e_version = EV_CURRENT,
+    .e_phoff = sizeof eh, .e_shoff = sizeof eh + sizeof(Elf32_Phdr) + n + sizeof shstrtab,
+    .e_ehsize = sizeof eh, .e_phentsize = sizeof(Elf32_Phdr), .e_phnum = 1,
+    .e_shentsize = sizeof(Elf32_Shdr), .e_shnum = 3, .e_shstrndx = 2,
+  };
+  Elf32_Phdr ph = {
+    .p_type = PT_LOAD, .p_offset = sizeof eh + sizeof ph, .p_filesz = n, .p_memsz = n,
+    .p_flags = PF_R | PF_X, .p_align = 1,
+  };
+  Elf32_Shdr sh[3] = {
+    {0},
+    { .sh_name = 1, .sh_type = SHT_PROGBITS, .sh_flags = SHF_ALLOC | SHF_EXECINSTR,
+      .sh_offset = ph.p_offset, .sh_size = n, .sh_addralign = 1 },
+    { .sh_name = 7, .sh_type = SHT_STRTAB, .sh_offset = ph.p_offset + n, .sh_size = sizeof shstrtab,
+      .sh_addralign = 1 },
+  };
+  FILE *f = fopen(fname, "wb");
+
+  if(!f)
+    return -1;
+  // Host byte order is assumed to be little endian as in AVR ELF files
+  fwrite(&eh, sizeof eh, 1, f);
+  fwrite(&ph, sizeof ph, 1, f);
+  fwrite(buf, 1, n, f);
+  fwrite(shstrtab, 1, sizeof shstrtab, f);
+  fwrite(sh, sizeof sh, 1, f);
+  return fclose(f) == EOF? -1: 0;
+}
+#endif
+
+// Read file contents as nul-terminated string
+static char *slurp(const char *fname) {
+  FILE *f = fopen(fname, "rb");
+  long n;
+  char *ret;
+
+  if(!f)
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  rewind(f);
+  ret = mmt_malloc(n + 1);
+  if(n > 0 && fread(ret, 1, n, f) != (size_t) n) {
+    mmt_free(ret);
+    ret = NULL;
+  }
+  fclose(f);
+  return ret;
+}
+
+static double best_of(double best, uint64_t start) {
+  double t = (avr_ustimestamp() - start)/1e6;
+
+  return best < 0 || t < best? t: best;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Syntax: %s [<opts>]\n"
+    "Function: benchmark fileio_mem() parsers and writers for images of 1 KiB to 8 MiB\n"
+    "Options:\n"
+    "    -n <runs>  number of runs per measurement, the fastest counts (default 3)\n"
+    "    -s <size>  maximum image size in bytes (default 8388608)\n"
+    "    -t <dir>   directory for the temporary image files (default /tmp)\n"
+    "    -h         show this help text\n", progname);
+}
+
+int main(int argc, char **argv) {
+  int runs = 3, maxsize = 1 << 23, opt, exitrc = 0;
+  const char *tmpdir = "/tmp";
+  const char *errptr;
+
+  init_cx(NULL);
+  while((opt = getopt(argc, argv, "hn:s:t:")) != -1) {
+    switch(opt) {
+    case 'n':
+      runs = str_int(optarg, STR_INT32, &errptr);
+      if(errptr || runs < 1) {
+        pmsg_error("invalid number of runs %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 's':
+      maxsize = str_int(optarg, STR_INT32, &errptr);
+      if(errptr || maxsize < 1) {
+        pmsg_error("invalid maximum size %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 't':
+      tmpdir = optarg;
+      break;
+    default:
+      usage();
+      return opt != 'h';
+    }
+  }
+
+  AVRPART *p = avr_new_part();
+  AVRMEM *mem = avr_new_memory("flash", sizes[sizeof sizes/sizeof *sizes - 1]);
+  unsigned char *image = mmt_malloc(mem->size);
+  char *fname = str_sprintf("%s/bench_fileio.%ld", tmpdir, (long) getpid());
+
+  p->desc = cache_string("bench");
+  p->id = cache_string("bench");
+  p->prog_modes = PM_Classic | PM_ISP;
+  mem->type = avr_get_mem_type("flash");
+  ladd(p->mem, mem);
+
+  uint32_t x = 1;               // Dense pseudo-random image contents
+
+  for(int i = 0; i < mem->size; i++)
+    x = x*1103515245 + 12345, image[i] = x >> 16;
+
+  printf("| Format | Size | File bytes | Write MB/s | Read MB/s |\n");
+  printf("|:--|--:|--:|--:|--:|\n");
+  for(size_t s = 0; s < sizeof sizes/sizeof *sizes && sizes[s] <= maxsize; s++) {
+    int size = sizes[s];
+
+    mem->size = size;
+    for(size_t k = 0; k < sizeof formats/sizeof *formats; k++) {
+      FILEFMT fmt = formats[k].format;
+      double tw = -1, tr = -1;
+      char *imm = NULL;
+      long fsize = 0;
+      int rc = 0;
+
+      if(formats[k].elfsize && size > formats[k].elfsize)
+        continue;
+
+      // Write phase; immediate and ELF images are prepared outside the timed section
+      for(int r = 0; r < runs && rc >= 0; r++) {
+        memcpy(mem->buf, image, size);
+        memset(mem->tags, 0xff, tag_bytes(size));
+        uint64_t start = avr_ustimestamp();
+
+        if(fmt == FMT_ELF) {
+#ifdef HAVE_LIBELF
+          rc = write_elf(fname, image, size);
+#endif
+          break;
+        }
+        rc = fileio_mem(FIO_WRITE, fname, fmt == FMT_IMM? FMT_HEX: fmt, p, mem, size);
+        if(fmt != FMT_IMM)
+          tw = best_of(tw, start);
+      }
+      if(rc >= 0 && fmt == FMT_IMM && !(imm = slurp(fname)))
+        rc = -1;
+      if(rc >= 0) {
+        FILE *f = fopen(fname, "rb");
+
+        if(f) {
+          fseek(f, 0, SEEK_END);
+          fsize = imm? (long) strlen(imm): ftell(f);
+          fclose(f);
+        }
+      }
+
+      // Read phase with round trip check
+      for(int r = 0; r < runs && rc >= 0; r++) {
+        memset(mem->buf, 0xff, size);
+        memset(mem->tags, 0, tag_bytes(size));
+        uint64_t start = avr_ustimestamp();
+
+        rc = fileio_mem(FIO_READ, imm? imm: fname, fmt, p, mem, -1);
+        tr = best_of(tr, start);
+        if(rc >= 0 && memcmp(mem->buf, image, size)) {
+          pmsg_error("%s round trip of %d bytes differs\n", formats[k].name, size);
+          rc = -1;
+        }
+      }
+      mmt_free(imm);
+
+      if(rc < 0) {
+        printf("| %s | %d | error | | |\n", formats[k].name, size);
+        exitrc = 1;
+        continue;
+      }
+      printf("| %s | %d | %ld ", formats[k].name, size, fsize);
+      if(tw > 0)
+        printf("| %.1f ", size/tw/1e6);
+      else
+        printf("| -- ");
+      if(tr > 0)
+        printf("| %.1f |\n", size/tr/1e6);
+      else
+        printf("| -- |\n");
+      fflush(stdout);
+    }
+  }
+
+  unlink(fname);
+  mmt_free(fname);
+  mmt_free(image);
+  return exitrc;
+}
@@ -18,6 +18,10 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#if defined(__linux__)
+#define _GNU_SOURCE             // For sched_setaffinity() and sched_getcpu()
+#endif
+
 #include <ac_cfg.h>
 
 #include <stdio.h>
@@ -33,6 +37,12 @@
 #else
 #include <signal.h>
 #include <sys/time.h>
+#include <time.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
 #endif
 
 #include "avrdude.h"
@@ -46,12 +56,24 @@
 #if defined(WIN32)
 #define freq (*(LARGE_INTEGER *)&cx->bb_freq)
 #else
+
+// Clock for busy-wait delays: not slewed by NTP where available
+#if defined(CLOCK_MONOTONIC_RAW)
+#define BB_CLOCK CLOCK_MONOTONIC_RAW
+#elif defined(CLOCK_MONOTONIC)
+#define BB_CLOCK CLOCK_MONOTONIC
+#endif
+
 static void alarmhandler(int signo) {
   *(volatile int *) &cx->bb_done = 1;
   signal(SIGALRM, cx->bb_saved_alarmf);
 }
 #endif                          // WIN32
 
+// Tails of long bitbang_delay() calls that are busy-waited after sleeping
+#define BB_SPIN_NS 200000       // Comfortably above the default Linux timer slack of 50 us
+#define BB_SPIN_COARSE_US 16000 // Default Windows scheduler tick is 15.6 ms
+
 // Calibrate the microsecond delay loop below
 static void bitbang_calibrate_delay(void) {
 
@@ -80,6 +102,20 @@ static void bitbang_calibrate_delay(void) {
   struct itimerval itv;
   volatile int i;
 
+#ifdef BB_CLOCK
+  /*
+   * Busy-waiting on a monotonic clock needs no calibration, is accurate to
+   * well below a microsecond and does not drift with CPU frequency scaling
+   */
+  struct timespec ts;
+
+  if(clock_gettime(BB_CLOCK, &ts) == 0) {
+    cx->bb_has_monoclock = 1;
+    pmsg_notice2("using monotonic clock for bitbang delays\n");
+    return;
+  }
+#endif
+
   pmsg_notice2("calibrating delay loop ...");
   i = 0;
   *(volatile int *) &cx->bb_done = 0;
@@ -110,7 +146,9 @@ static void bitbang_calibrate_delay(void) {
 /*
  * Delay for approximately the number of microseconds specified. usleep()'s
  * granularity is usually like 1 ms or 10 ms, so it's not really suitable for
- * short delays in bit-bang algorithms.
+ * short delays in bit-bang algorithms. Long delays, eg, while waiting for a
+ * chip erase, sleep for their bulk and only busy-wait the tail, so that many
+ * concurrent sessions do not each keep a CPU core spinning.
  */
 void bitbang_delay(unsigned int us) {
 
@@ -120,12 +158,43 @@ void bitbang_delay(unsigned int us) {
   if(cx->bb_has_perfcount) {
     QueryPerformanceCounter(&countNow);
     countEnd.QuadPart = countNow.QuadPart + freq.QuadPart*us/1000000ll;
+    if(us > 2*BB_SPIN_COARSE_US) // Sleep() may overrun by a scheduler tick
+      Sleep((us - BB_SPIN_COARSE_US)/1000);
 
     while(countNow.QuadPart < countEnd.QuadPart)
       QueryPerformanceCounter(&countNow);
   } else {                      // No performance counters -- run normal uncalibrated delay
 #endif
 
+#ifdef BB_CLOCK
+  if(cx->bb_has_monoclock) {
+    struct timespec now, end;
+
+    long long ns = us*1000LL - cx->bb_trim_ns;
+
+    if(ns <= 0)
+      return;
+    clock_gettime(BB_CLOCK, &end);
+    end.tv_sec += ns/1000000000;
+    end.tv_nsec += ns%1000000000;
+    if(end.tv_nsec >= 1000000000) {
+      end.tv_sec++;
+      end.tv_nsec -= 1000000000;
+    }
+    if(ns > 2*BB_SPIN_NS) {     // Sleep through the bulk, nanosleep() may overrun by the timer slack
+      struct timespec nap = {(ns - BB_SPIN_NS)/1000000000, (ns - BB_SPIN_NS)%1000000000};
+
+      while(nanosleep(&nap, &nap) < 0 && errno == EINTR)
+        continue;
+    }
+    do
+      clock_gettime(BB_CLOCK, &now);
+    while(now.tv_sec < end.tv_sec || (now.tv_sec == end.tv_sec && now.tv_nsec < end.tv_nsec));
+
+    return;
+  }
+#endif
+
     volatile unsigned int del = us*cx->bb_delay_decrement;
 
     while(del > 0)
@@ -136,6 +205,123 @@ void bitbang_delay(unsigned int us) {
 #endif
 }
 
+#define BB_JITTER_MS 20         // Duration of the jitter measurement
+#define BB_JITTER_MAX_NS 2000   // Trim delays only if no clock read is later than this
+
+#if defined(__linux__) && defined(BB_CLOCK)
+static long long bb_ns(const struct timespec *ts) {
+  return ts->tv_sec*1000000000LL + ts->tv_nsec;
+}
+
+/*
+ * Read the delay clock back to back for BB_JITTER_MS and keep the largest
+ * gap between two reads, which shows preemption and page faults. Without
+ * these the average gap is the overhead that bitbang_delay() adds to every
+ * delay, which is then deducted from the delays.
+ */
+static void bitbang_measure_jitter(void) {
+  struct timespec ts;
+  long long prev, now, end, gap, maxgap = 0;
+  long n = 0;
+
+  cx->bb_trim_ns = 0;
+  if(!cx->bb_has_monoclock)
+    return;
+  clock_gettime(BB_CLOCK, &ts);
+  prev = bb_ns(&ts);
+  end = prev + BB_JITTER_MS*1000000LL;
+  do {
+    clock_gettime(BB_CLOCK, &ts);
+    now = bb_ns(&ts);
+    if((gap = now - prev) > maxgap)
+      maxgap = gap;
+    prev = now;
+    n++;
+  } while(now < end);
+
+  if(maxgap <= BB_JITTER_MAX_NS)
+    cx->bb_trim_ns = BB_JITTER_MS*1000000LL/n;
+  pmsg_notice("bitbang clock jitter up to %lld ns%s\n", maxgap,
+    cx->bb_trim_ns? str_ccprintf(", trimming delays by %d ns", cx->bb_trim_ns): "");
+}
+#endif
+
+/*
+ * Real-time mode (--realtime): while the programmer is in use switch to the
+ * SCHED_FIFO scheduling policy where permitted, pin the process to the CPU
+ * it currently runs on and lock all its memory, so that neither preemption
+ * nor page faults stretch bit timings. If the clock jitter measured
+ * afterwards is small, delays are trimmed by the overhead of reading the
+ * clock. bitbang_realtime_end() restores the previous settings.
+ */
+void bitbang_realtime_begin(void) {
+  if(!cx->bb_realtime || cx->bb_rt_active)
+    return;
+  cx->bb_rt_active = 1;
+
+#if defined(__linux__)
+  struct sched_param sp;
+  cpu_set_t cpus;
+  int cpu;
+
+  cx->bb_rt_policy = sched_getscheduler(0);
+  cx->bb_rt_prio = sched_getparam(0, &sp) == 0? sp.sched_priority: 0;
+  sp.sched_priority = sched_get_priority_min(SCHED_FIFO);
+  if(cx->bb_rt_policy < 0 || sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+    pmsg_warning("cannot switch to real-time scheduling: %s\n", strerror(errno));
+    cx->bb_rt_policy = -1;
+  }
+
+  if(sched_getaffinity(0, sizeof cpus, &cpus) == 0 && (cpu = sched_getcpu()) >= 0) {
+    cpu_set_t one;
+
+    cx->bb_rt_cpus = mmt_malloc(sizeof cpus);
+    memcpy(cx->bb_rt_cpus, &cpus, sizeof cpus);
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    if(sched_setaffinity(0, sizeof one, &one) < 0) {
+      pmsg_warning("cannot pin process to CPU %d: %s\n", cpu, strerror(errno));
+      mmt_free(cx->bb_rt_cpus);
+      cx->bb_rt_cpus = NULL;
+    }
+  }
+
+  if(mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    pmsg_warning("cannot lock memory: %s\n", strerror(errno));
+  else
+    cx->bb_rt_locked = 1;
+
+#ifdef BB_CLOCK
+  bitbang_measure_jitter();
+#endif
+#else
+  pmsg_warning("real-time mode is only supported on Linux\n");
+#endif
+}
+
+void bitbang_realtime_end(void) {
+  if(!cx->bb_rt_active)
+    return;
+  cx->bb_rt_active = 0;
+  cx->bb_trim_ns = 0;
+
+#if defined(__linux__)
+  if(cx->bb_rt_locked)
+    munlockall();
+  cx->bb_rt_locked = 0;
+  if(cx->bb_rt_cpus) {
+    sched_setaffinity(0, sizeof(cpu_set_t), (cpu_set_t *) cx->bb_rt_cpus);
+    mmt_free(cx->bb_rt_cpus);
+    cx->bb_rt_cpus = NULL;
+  }
+  if(cx->bb_rt_policy >= 0) {
+    struct sched_param sp = { .sched_priority = cx->bb_rt_prio };
+
+    sched_setscheduler(0, cx->bb_rt_policy, &sp);
+  }
+#endif
+}
+
 // Transmit and receive a byte of data to/from the AVR device
 static unsigned char bitbang_txrx(const PROGRAMMER *pgm, unsigned char byte) {
   int i;
@@ -340,6 +526,20 @@ int bitbang_cmd_tpi(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len
   return 0;
 }
 
+/*
+ * Transmit n TPI frames of cmd_len bytes each, collecting res_len bytes per
+ * frame; bitbanging has no round trip to save, so this merely chains the frames
+ */
+int bitbang_cmd_tpi_batch(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len,
+  unsigned char *res, int res_len, int n) {
+
+  for(int k = 0; k < n; k++)
+    if(bitbang_cmd_tpi(pgm, cmd + k*cmd_len, cmd_len, res? res + k*res_len: NULL, res_len) < 0)
+      return -1;
+
+  return 0;
+}
+
 // Transmit bytes via SPI and return the results; 'cmd' and 'res' must point to data buffers
 int bitbang_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
   int i;
@@ -366,6 +566,90 @@ int bitbang_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *
   return 0;
 }
 
+/*
+ * Paged access shared by all bitbang programmers: the ISP commands of a whole
+ * range are clocked out back to back through pgm->cmd(), so a backend with a
+ * bulk way of driving its lines hooks in by overriding the cmd() method
+ */
+
+/*
+ * Read flash, EEPROM or other ISP memories: issue the load extended address
+ * command only at the start of the range and at each 128 KiB boundary rather
+ * than for every byte, and keep LEDs untouched for the duration of the range
+ */
+int bitbang_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  int isflash = m->op[AVR_OP_READ_LO] && m->op[AVR_OP_READ_HI];
+  OPCODE *lext = isflash? m->op[AVR_OP_LOAD_EXT_ADDR]: NULL;
+  unsigned char cmd[4], res[4];
+
+  if(is_tpi(p) || (!isflash && !m->op[AVR_OP_READ]))
+    return -2;
+
+  for(unsigned int a = addr; a < addr + n_bytes; a++) {
+    if(lext && (a == addr || a%0x20000 == 0)) {
+      memset(cmd, 0, sizeof cmd);
+      avr_set_bits(lext, cmd);
+      avr_set_addr(lext, cmd, a/2);
+      if(pgm->cmd(pgm, cmd, res) < 0)
+        return -1;
+    }
+    OPCODE *rop = m->op[!isflash? AVR_OP_READ: a & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
+
+    memset(cmd, 0, sizeof cmd);
+    avr_set_bits(rop, cmd);
+    avr_set_addr(rop, cmd, isflash? a/2: a + avr_sigrow_offset(p, m, a));
+    if(pgm->cmd(pgm, cmd, res) < 0)
+      return -1;
+    m->buf[a] = 0;
+    avr_get_output(rop, res, m->buf + a);
+  }
+
+  return n_bytes;
+}
+
+/*
+ * Write flash by loading each page with back-to-back commands before writing
+ * it; other memories are written byte by byte as they need a delay per byte
+ */
+int bitbang_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  unsigned char cmd[4], res[4];
+
+  if(is_tpi(p))
+    return -2;
+
+  if(!(m->paged && m->page_size > 1 && m->op[AVR_OP_LOADPAGE_LO] && m->op[AVR_OP_LOADPAGE_HI])) {
+    if(m->paged)                // Leave other paged memories to the generic byte loop
+      return -2;
+    for(unsigned int a = addr; a < addr + n_bytes; a++)
+      if(avr_write_byte_default(pgm, p, m, a, m->buf[a]) != 0)
+        return -2;
+    return n_bytes;
+  }
+
+  for(unsigned int pg = addr - addr%m->page_size; pg < addr + n_bytes; pg += m->page_size) {
+    unsigned int lo = pg < addr? addr: pg, hi = pg + m->page_size < addr + n_bytes? pg + m->page_size: addr + n_bytes;
+
+    for(unsigned int a = lo; a < hi; a++) {
+      OPCODE *lop = m->op[a & 1? AVR_OP_LOADPAGE_HI: AVR_OP_LOADPAGE_LO];
+
+      memset(cmd, 0, sizeof cmd);
+      avr_set_bits(lop, cmd);
+      avr_set_addr(lop, cmd, a/2);
+      avr_set_input(lop, cmd, m->buf[a]);
+      if(pgm->cmd(pgm, cmd, res) < 0)
+        return -1;
+    }
+    if(avr_write_page(pgm, p, m, pg) < 0)
+      return -1;
+  }
+
+  return n_bytes;
+}
+
 // Issue the 'chip erase' command to the AVR device
 int bitbang_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   unsigned char cmd[4];
@@ -409,7 +693,7 @@ int bitbang_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -455,6 +739,7 @@ int bitbang_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
   int i;
 
   bitbang_calibrate_delay();
+  bitbang_realtime_begin();
 
   pgm->powerup(pgm);
   usleep(20000);
@@ -29,6 +29,8 @@ extern "C" {
   int bitbang_getpin(int fd, int pin);
   int bitbang_highpulsepin(int fd, int pin);
   void bitbang_delay(unsigned int us);
+  void bitbang_realtime_begin(void);
+  void bitbang_realtime_end(void);
 
   int bitbang_check_prerequisites(const PROGRAMMER *pgm);
 
@@ -38,7 +40,13 @@ extern "C" {
   int bitbang_vfy_led(const PROGRAMMER *pgm, int value);
   int bitbang_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res);
   int bitbang_cmd_tpi(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len, unsigned char *res, int res_len);
+  int bitbang_cmd_tpi_batch(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len,
+    unsigned char *res, int res_len, int n);
   int bitbang_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count);
+  int bitbang_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int page_size, unsigned int addr, unsigned int n_bytes);
+  int bitbang_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int page_size, unsigned int addr, unsigned int n_bytes);
   int bitbang_chip_erase(const PROGRAMMER *pgm, const AVRPART *p);
   int bitbang_program_enable(const PROGRAMMER *pgm, const AVRPART *p);
   void bitbang_powerup(const PROGRAMMER *pgm);
@@ -64,6 +64,9 @@
 #define BP_FLAG_NOPAGEDREAD         (1<<7)
 #define BP_FLAG_PULLUPS             (1<<8)
 #define BP_FLAG_HIZ                 (1<<9)
+#define BP_FLAG_STREAMREAD          (1<<10)
+
+#define BP_STREAM_DEPTH             32  // Write-then-read commands in flight when streaming reads
 
 struct pdata {
   int binmode_version;
@@ -662,6 +665,9 @@ static int buspirate_start_mode_bin(PROGRAMMER *pgm) {
       buspirate_recv_bin(pgm, buf, 3);
       ver = buf[1] << 8 | buf[2];
       msg_notice2("AVR Extended Commands version %d\n", ver);
+    } else if(!(my.flag & BP_FLAG_NOPAGEDWRITE)) {
+      msg_notice2("AVR Extended Commands not found, streaming paged read with write-then-read\n");
+      my.flag |= BP_FLAG_STREAMREAD;
     } else {
       msg_notice2("AVR Extended Commands not found\n");
       my.flag |= BP_FLAG_NOPAGEDREAD;
@@ -913,13 +919,74 @@ static int buspirate_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsign
     return buspirate_cmd_ascii(pgm, cmd, res);
 }
 
+/*
+ * Paged load for firmware without the AVR Extended Commands: each byte is read
+ * by a "write then read" command that shifts out the first three bytes of the
+ * SPI read command and reads back the fourth; BP_STREAM_DEPTH such commands are
+ * sent back to back before their replies are collected
+ */
+static int buspirate_paged_load_stream(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int address, unsigned int n_bytes) {
+
+  unsigned char buf[8*BP_STREAM_DEPTH], res[4], cmd[4];
+  int isflash = mem_is_flash(m);
+
+  if(isflash? !m->op[AVR_OP_READ_LO] || !m->op[AVR_OP_READ_HI]: !m->op[AVR_OP_READ])
+    return -1;
+
+  // Always called with address at page boundary and n_bytes == m->page_size
+  if(isflash && m->op[AVR_OP_LOAD_EXT_ADDR]) {
+    memset(cmd, 0, sizeof cmd);
+    avr_set_bits(m->op[AVR_OP_LOAD_EXT_ADDR], cmd);
+    avr_set_addr(m->op[AVR_OP_LOAD_EXT_ADDR], cmd, address/2);
+    if(pgm->cmd(pgm, cmd, res) < 0)
+      return -1;
+  }
+
+  for(unsigned int done = 0; done < n_bytes;) {
+    unsigned int k, n = n_bytes - done > BP_STREAM_DEPTH? BP_STREAM_DEPTH: n_bytes - done;
+
+    for(k = 0; k < n; k++) {
+      unsigned int addr = address + done + k;
+      OPCODE *op = m->op[!isflash? AVR_OP_READ: addr & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
+
+      memset(cmd, 0, sizeof cmd);
+      avr_set_bits(op, cmd);
+      avr_set_addr(op, cmd, isflash? addr/2: addr);
+      buf[8*k + 0] = 0x05;      // Write then read without CS
+      buf[8*k + 1] = 0;         // Write 3 bytes
+      buf[8*k + 2] = 3;
+      buf[8*k + 3] = 0;         // Read 1 byte
+      buf[8*k + 4] = 1;
+      memcpy(buf + 8*k + 5, cmd, 3);
+    }
+    buspirate_send_bin(pgm, buf, 8*n);
+    if(buspirate_recv_bin(pgm, buf, 2*n) == EOF)
+      return -1;
+
+    for(k = 0; k < n; k++, done++) {
+      unsigned int addr = address + done;
+
+      if(buf[2*k] != 0x01) {
+        pmsg_error("write then read did not succeed\n");
+        return -1;
+      }
+      memset(res, 0, sizeof res);
+      res[3] = buf[2*k + 1];
+      m->buf[addr] = 0;
+      avr_get_output(m->op[!isflash? AVR_OP_READ: addr & 1? AVR_OP_READ_HI: AVR_OP_READ_LO], res, m->buf + addr);
+    }
+  }
+
+  return n_bytes;
+}
+
 // Paged load function which utilizes the AVR Extended Commands set
 static int buspirate_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int address, unsigned int n_bytes) {
 
   unsigned char commandbuf[10];
-  unsigned char buf[275];
-  unsigned int addr = 0;
+  unsigned char buf[1];
 
   msg_debug("buspirate_paged_load(..,%s,%d,%d,%d)\n", m->desc, m->page_size, address, n_bytes);
 
@@ -928,6 +995,15 @@ static int buspirate_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const A
     pmsg_error("called while in nopagedread mode\n");
     return -1;
   }
+  if(!(my.flag & BP_FLAG_IN_BINMODE))
+    return -1;
+
+  if(my.flag & BP_FLAG_STREAMREAD) {
+    if(!mem_is_flash(m) && !mem_is_eeprom(m))
+      return -1;
+    return buspirate_paged_load_stream(pgm, p, m, page_size, address, n_bytes);
+  }
+
   // Determine what type of memory to read, only flash is supported
   if(!mem_is_flash(m)) {
     return -1;
@@ -957,9 +1033,8 @@ static int buspirate_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const A
     return -1;
   }
 
-  for(addr = 0; addr < n_bytes; addr++) {
-    buspirate_recv_bin(pgm, &m->buf[addr + address], 1);
-  }
+  if(buspirate_recv_bin(pgm, m->buf + address, n_bytes) == EOF)
+    return -1;
 
   return n_bytes;
 }
@@ -972,8 +1047,8 @@ static int buspirate_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   int addr = base_addr;
   int n_page_writes;
   int this_page_size;
-  unsigned char cmd_buf[4096] = { '\0' };
-  unsigned char send_byte, recv_byte;
+  unsigned char cmd_buf[5 + 4096] = { '\0' };
+  unsigned char recv_byte;
 
   if(!(my.flag & BP_FLAG_IN_BINMODE)) {
     // Return if we are not in binary mode
@@ -1019,39 +1094,29 @@ static int buspirate_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
       this_page_size = n_data_bytes - page_size*page;
 
     // Set up command buffer
-    memset(cmd_buf, 0, 4*this_page_size);
+    memset(cmd_buf, 0, 5 + 4*this_page_size);
     for(i = 0; i < this_page_size; i++) {
 
       addr = base_addr + page*page_size + i;
 
       if(i%2 == 0) {
-        avr_set_bits(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[4*i]));
-        avr_set_addr(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[4*i]), addr/2);
-        avr_set_input(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[4*i]), m->buf[addr]);
+        avr_set_bits(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[5 + 4*i]));
+        avr_set_addr(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[5 + 4*i]), addr/2);
+        avr_set_input(m->op[AVR_OP_LOADPAGE_LO], &(cmd_buf[5 + 4*i]), m->buf[addr]);
       } else {
-        avr_set_bits(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[4*i]));
-        avr_set_addr(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[4*i]), addr/2);
-        avr_set_input(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[4*i]), m->buf[addr]);
+        avr_set_bits(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[5 + 4*i]));
+        avr_set_addr(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[5 + 4*i]), addr/2);
+        avr_set_input(m->op[AVR_OP_LOADPAGE_HI], &(cmd_buf[5 + 4*i]), m->buf[addr]);
       }
     }
 
-    // 00000100 - Write then read
-    send_byte = 0x05;
-    buspirate_send_bin(pgm, &send_byte, 1);
-
-    // Number of bytes to write
-    send_byte = (4*this_page_size)/0x100;
-    buspirate_send_bin(pgm, &send_byte, 1);     // High byte
-    send_byte = (4*this_page_size)%0x100;
-    buspirate_send_bin(pgm, &send_byte, 1);     // Low byte
-
-    // Number of bytes to read
-    send_byte = 0x0;
-    buspirate_send_bin(pgm, &send_byte, 1);     // High byte
-    buspirate_send_bin(pgm, &send_byte, 1);     // Low byte
-
-    // Send command buffer
-    buspirate_send_bin(pgm, cmd_buf, 4*this_page_size);
+    // 00000101 - Write then read without CS, header and data in one transfer
+    cmd_buf[0] = 0x05;
+    cmd_buf[1] = (4*this_page_size)/0x100;      // Number of bytes to write
+    cmd_buf[2] = (4*this_page_size)%0x100;
+    cmd_buf[3] = 0;             // Number of bytes to read
+    cmd_buf[4] = 0;
+    buspirate_send_bin(pgm, cmd_buf, 5 + 4*this_page_size);
 
     // Check for write failure
     if((buspirate_recv_bin(pgm, &recv_byte, 1) == EOF) || (recv_byte != 0x01)) {
@@ -1106,7 +1171,7 @@ static int buspirate_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -1337,6 +1402,7 @@ void buspirate_bb_initpgm(PROGRAMMER *pgm) {
   pgm->chip_erase = bitbang_chip_erase;
   pgm->cmd = bitbang_cmd;
   pgm->cmd_tpi = bitbang_cmd_tpi;
+  pgm->cmd_tpi_batch = bitbang_cmd_tpi_batch;
   pgm->powerup = buspirate_bb_powerup;
   pgm->powerdown = buspirate_bb_powerdown;
   pgm->setpin = buspirate_bb_setpin;
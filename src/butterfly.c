@@ -50,6 +50,9 @@ struct pdata {
   char has_auto_incr_addr;
   unsigned int buffersize;
 
+  char next_mtype;              // Memory type of last block access, 0 if address unknown
+  unsigned long next_addr;      // Auto-incremented address after that block access
+
   int ctype;                    // Cache one byte for flash
   unsigned char cvalue;
   unsigned long caddr;
@@ -125,6 +128,7 @@ static int butterfly_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   if(serial_recv_timeout < new_timeout)
     serial_recv_timeout = new_timeout;
 
+  my.next_mtype = 0;
   EI(butterfly_send(pgm, "e", 1));
   if(butterfly_vfy_cmd_sent(pgm, "chip erase") < 0)
     ret = -1;
@@ -144,6 +148,7 @@ static void butterfly_leave_prog_mode(const PROGRAMMER *pgm) {
 }
 
 static int butterfly_program_enable(const PROGRAMMER *pgm, const AVRPART *p) {
+  my.next_mtype = 0;
   return butterfly_enter_prog_mode(pgm);
 }
 
@@ -366,6 +371,7 @@ static void butterfly_display(const PROGRAMMER *pgm, const char *p) {
 }
 
 static void butterfly_set_addr(const PROGRAMMER *pgm, unsigned long addr) {
+  my.next_mtype = 0;
   if(addr < 0x10000) {
     char cmd[3];
 
@@ -391,6 +397,7 @@ static void butterfly_set_addr(const PROGRAMMER *pgm, unsigned long addr) {
 static void butterfly_set_extaddr(const PROGRAMMER *pgm, unsigned long addr) {
   char cmd[4];
 
+  my.next_mtype = 0;
   cmd[0] = 'H';
   cmd[1] = (addr >> 16) & 0xff;
   cmd[2] = (addr >> 8) & 0xff;
@@ -518,6 +525,17 @@ static int butterfly_read_byte(const PROGRAMMER *pgm, const AVRPART *p, const AV
   return *value == '?'? -1: 0;
 }
 
+/*
+ * Set the address for a block access unless the bootloader's auto-increment already left
+ * it there after the previous block access of the same memory type; this saves one round
+ * trip per paged call when consecutive pages are streamed
+ */
+static void butterfly_block_addr(const PROGRAMMER *pgm, char mtype, int ext_addr, unsigned long addr) {
+  if(my.has_auto_incr_addr == 'Y' && !ext_addr && my.next_mtype == mtype && my.next_addr == addr)
+    return;
+  (ext_addr? butterfly_set_extaddr: butterfly_set_addr) (pgm, addr);
+}
+
 static int butterfly_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   unsigned int max_addr = addr + n_bytes;
@@ -534,7 +552,10 @@ static int butterfly_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   else
     my.ctype = 0;               // Invalidate flash byte read cache
 
-  (ext_addr? butterfly_set_extaddr: butterfly_set_addr) (pgm, isee? addr: addr >> 1);
+  char mtype = isee? 'E': mem_is_flash(m)? 'F': 'U';
+
+  butterfly_block_addr(pgm, mtype, ext_addr, isee? addr: addr >> 1);
+  my.next_mtype = 0;            // Unknown until all blocks have been written
 
 #if 0
   usleep(1000000);
@@ -546,7 +567,7 @@ static int butterfly_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   cmd = mmt_malloc(4 + blocksize);
 
   cmd[0] = 'B';
-  cmd[3] = isee? 'E': mem_is_flash(m)? 'F': 'U';
+  cmd[3] = mtype;
 
   while(addr < max_addr) {
     if((max_addr - addr) < blocksize)
@@ -565,6 +586,8 @@ static int butterfly_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
     addr += blocksize;
   }
   mmt_free(cmd);
+  my.next_mtype = mtype;
+  my.next_addr = isee? addr: addr >> 1;
 
   return n_bytes;
 }
@@ -588,7 +611,8 @@ static int butterfly_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const A
   cmd[0] = 'g';
   cmd[3] = isee? 'E': mem_is_flash(m)? 'F': 'U';
 
-  (ext_addr? butterfly_set_extaddr: butterfly_set_addr) (pgm, isee? addr: addr >> 1);
+  butterfly_block_addr(pgm, cmd[3], ext_addr, isee? addr: addr >> 1);
+  my.next_mtype = 0;            // Unknown until all blocks have been read
 
   while(addr < max_addr) {
     if((max_addr - addr) < (unsigned int) blocksize)
@@ -602,6 +626,8 @@ static int butterfly_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const A
 
     addr += blocksize;
   }
+  my.next_mtype = cmd[3];
+  my.next_addr = isee? addr: addr >> 1;
 
   return n_bytes;
 }
@@ -682,6 +708,8 @@ void butterfly_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = butterfly_paged_write;
   pgm->paged_load = butterfly_paged_load;
+  pgm->multipage_write = 1;
+  pgm->multipage_load = 1;
 
   pgm->read_sig_bytes = butterfly_read_sig_bytes;
   pgm->parseextparams = butterfly_parseextparms;
@@ -92,8 +92,7 @@ struct pdata {
   libusb_device_handle *usbhandle;
   int sckfreq_hz;
 
-  libusb_context *ctx;
-  int USB_init;                 // Used in ch341a_open()
+  libusb_context *ctx;           // Shared context of the USB enumeration cache
 };
 
 #define my (*(struct pdata *) (pgm->cookie))
@@ -107,6 +106,7 @@ static void ch341a_close(PROGRAMMER *pgm);
 static int ch341a_initialize(const PROGRAMMER *pgm, const AVRPART *p);
 static int ch341a_spi_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res);
 static int ch341a_spi(const PROGRAMMER *pgm, const unsigned char *in, unsigned char *out, int size);
+static int ch341a_spi_stream(const PROGRAMMER *pgm, const unsigned char *in, unsigned char *out, int size);
 static int ch341a_spi_program_enable(const PROGRAMMER *pgm, const AVRPART *p);
 static int ch341a_spi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p);
 
@@ -115,12 +115,18 @@ static void ch341a_enable(PROGRAMMER *pgm, const AVRPART *p);
 static void ch341a_display(const PROGRAMMER *pgm, const char *p);
 
 // ch341 requires LSB first: invert the bit order before sending and after receiving
-static unsigned char swap_byte(unsigned char byte) {
-  byte = ((byte >> 1) & 0x55) | ((byte << 1) & 0xaa);
-  byte = ((byte >> 2) & 0x33) | ((byte << 2) & 0xcc);
-  byte = ((byte >> 4) & 0x0f) | ((byte << 4) & 0xf0);
+#define R2(n) (n), (n) + 2*64, (n) + 1*64, (n) + 3*64
+#define R4(n) R2(n), R2((n) + 2*16), R2((n) + 1*16), R2((n) + 3*16)
+#define R6(n) R4(n), R4((n) + 2*4), R4((n) + 1*4), R4((n) + 3*4)
+
+static const unsigned char swap_table[256] = { R6(0), R6(2), R6(1), R6(3) };
 
-  return byte;
+#undef R2
+#undef R4
+#undef R6
+
+static unsigned char swap_byte(unsigned char byte) {
+  return swap_table[byte];
 }
 
 static int CH341USBTransferPart(const PROGRAMMER *pgm, enum libusb_endpoint_direction dir,
@@ -205,10 +211,8 @@ static int ch341a_open(PROGRAMMER *pgm, const char *port) {
   if(!str_eq(port, "usb"))
     pmsg_warning("option -P %s ignored\n", port);
 
-  if(!my.USB_init) {
-    my.USB_init = 1;
-    libusb_init(&my.ctx);
-  }
+  if(!(my.ctx = usb_enum_context()))
+    return -1;
 
   if(usbpid) {
     pid = *(int *) (ldata(usbpid));
@@ -220,9 +224,9 @@ static int ch341a_open(PROGRAMMER *pgm, const char *port) {
   vid = pgm->usbvid? pgm->usbvid: CH341A_VID;
 
   libusb_device **dev_list;
-  int dev_list_len = libusb_get_device_list(my.ctx, &dev_list);
+  int dev_list_len = usb_enum_devices(&dev_list);
 
-  for(j = 0; j < dev_list_len; ++j) {
+  for(j = 0; j < dev_list_len && !handle; ++j) {
     libusb_device *dev = dev_list[j];
     struct libusb_device_descriptor descriptor;
 
@@ -236,7 +240,6 @@ static int ch341a_open(PROGRAMMER *pgm, const char *port) {
       }
     }
   }
-  libusb_free_device_list(dev_list, 1);
   if(handle != NULL) {
     errorCode = 0;
     my.usbhandle = handle;
@@ -249,7 +252,6 @@ static int ch341a_open(PROGRAMMER *pgm, const char *port) {
   if((r = libusb_claim_interface(my.usbhandle, 0))) {
     pmsg_error("libusb_claim_interface failed, return value %d (%s)\n", r, libusb_error_name(r));
     libusb_close(my.usbhandle);
-    libusb_exit(my.ctx);
     return -1;
   }
 
@@ -273,7 +275,6 @@ static void ch341a_close(PROGRAMMER *pgm) {
     libusb_release_interface(my.usbhandle, 0);
     libusb_close(my.usbhandle);
   }
-  libusb_exit(my.ctx);
 }
 
 static int ch341a_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
@@ -304,7 +305,7 @@ static int ch341a_spi(const PROGRAMMER *pgm, const unsigned char *in, unsigned c
     return 0;
 
   if(size > CH341A_PACKET_LENGTH - 1)
-    size = CH341A_PACKET_LENGTH - 1;
+    return ch341a_spi_stream(pgm, in, out, size);
 
   pkt[0] = CH341A_CMD_SPI_STREAM;
 
@@ -327,6 +328,95 @@ static int ch341a_spi(const PROGRAMMER *pgm, const unsigned char *in, unsigned c
   return size;
 }
 
+static void LIBUSB_CALL ch341a_stream_cb(struct libusb_transfer *transfer) {
+  (*(int *) transfer->user_data)--;
+}
+
+/*
+ * Shift size bytes through SPI by queuing up to CH341A_STREAM_PACKETS SPI
+ * stream packets at a time: one bulk OUT transfer carries all their commands
+ * and each packet's reply is collected by its own asynchronous IN transfer,
+ * so the CH341 never waits for the host between packets of a batch
+ */
+static int ch341a_spi_stream(const PROGRAMMER *pgm, const unsigned char *in, unsigned char *out, int size) {
+  const int chunk = CH341A_PACKET_LENGTH - 1;
+  unsigned char obuf[CH341A_STREAM_PACKETS*CH341A_PACKET_LENGTH];
+  struct libusb_transfer *xfer[CH341A_STREAM_PACKETS + 1];
+  int done = 0, rc = 0;
+
+  if(!my.usbhandle)
+    return -1;
+
+  while(done < size && !rc) {
+    int len = size - done, npkt, nxfer = 0, pending = 0, pos = 0;
+
+    if(len > CH341A_STREAM_PACKETS*chunk)
+      len = CH341A_STREAM_PACKETS*chunk;
+    npkt = (len + chunk - 1)/chunk;
+
+    for(int i = 0; i < len; i++) {
+      if(i%chunk == 0)
+        obuf[pos++] = CH341A_CMD_SPI_STREAM;
+      obuf[pos++] = swap_table[in[done + i]];
+    }
+
+    // Queue the IN transfers first so no reply packet finds the host unprepared
+    for(int k = 0; k <= npkt; k++) {
+      if(!(xfer[k] = libusb_alloc_transfer(0))) {
+        pmsg_error("cannot allocate USB transfer\n");
+        rc = -1;
+        break;
+      }
+      nxfer++;
+      if(k < npkt)
+        libusb_fill_bulk_transfer(xfer[k], my.usbhandle, CH341A_USB_BULK_ENDPOINT | LIBUSB_ENDPOINT_IN,
+          out + done + k*chunk, k < npkt - 1? chunk: len - k*chunk, ch341a_stream_cb, &pending,
+          CH341A_USB_TIMEOUT);
+      else
+        libusb_fill_bulk_transfer(xfer[k], my.usbhandle, CH341A_USB_BULK_ENDPOINT | LIBUSB_ENDPOINT_OUT,
+          obuf, pos, ch341a_stream_cb, &pending, CH341A_USB_TIMEOUT);
+      int ret = libusb_submit_transfer(xfer[k]);
+
+      if(ret) {
+        pmsg_error("libusb_submit_transfer() failed, return value %d (%s)\n", ret, libusb_error_name(ret));
+        rc = -1;
+        break;
+      }
+      pending++;
+    }
+
+    if(rc)                      // Retract whatever was submitted before the failure
+      for(int k = 0; k < nxfer; k++)
+        libusb_cancel_transfer(xfer[k]);
+
+    while(pending > 0) {
+      struct timeval tv = { .tv_sec = 1 + CH341A_USB_TIMEOUT/1000 };
+      int ret = libusb_handle_events_timeout_completed(my.ctx, &tv, NULL);
+
+      if(ret && ret != LIBUSB_ERROR_INTERRUPTED) {
+        pmsg_error("libusb_handle_events() failed, return value %d (%s)\n", ret, libusb_error_name(ret));
+        rc = -1;
+        break;
+      }
+    }
+
+    for(int k = 0; k < nxfer; k++) {
+      if(!rc && (xfer[k]->status != LIBUSB_TRANSFER_COMPLETED || xfer[k]->actual_length != xfer[k]->length)) {
+        pmsg_error("failed to transfer data %s CH341\n", k < npkt? "from": "to");
+        rc = -1;
+      }
+      if(pending <= 0)          // Cannot free transfers that libusb still holds
+        libusb_free_transfer(xfer[k]);
+    }
+
+    for(int i = 0; i < len && !rc; i++)
+      out[done + i] = swap_table[out[done + i]];
+    done += len;
+  }
+
+  return rc? rc: size;
+}
+
 static int ch341a_spi_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res) {
   return pgm->spi(pgm, cmd, res, 4);
 }
@@ -342,12 +432,24 @@ static int ch341a_spi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   memset(cmd, 0, sizeof(cmd));
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
   return 0;
 }
 
-// Fall back on bytewise write (followed by write page if flash)
+// Shift the 4-byte SPI commands in cmd through the stream and check for errors
+static int ch341a_spi_cmds(const PROGRAMMER *pgm, unsigned char *cmd, unsigned int ncmd) {
+  unsigned char *res = mmt_malloc(4*ncmd);
+  int rc = ch341a_spi_stream(pgm, cmd, res, 4*ncmd);
+
+  if(rc >= 0)
+    memcpy(cmd, res, 4*ncmd);
+  mmt_free(res);
+
+  return rc < 0? -1: 0;
+}
+
+// Send all loadpage commands of a flash page in one stream, then write page; EEPROM bytewise
 static int ch341a_spi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
 
@@ -358,9 +460,27 @@ static int ch341a_spi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
       return -2;
 
     // Always called with addr at page boundary and n_bytes == m->page_size
-    for(unsigned int end = addr + n_bytes; addr < end; addr++)
-      if(pgm->write_byte(pgm, p, m, addr, m->buf[addr]) < 0)
+    if(isflash && m->op[AVR_OP_LOADPAGE_LO] && m->op[AVR_OP_LOADPAGE_HI]) {
+      unsigned char *cmd = mmt_malloc(4*n_bytes);
+
+      for(unsigned int i = 0; i < n_bytes; i++) {
+        OPCODE *op = m->op[(addr + i) & 1? AVR_OP_LOADPAGE_HI: AVR_OP_LOADPAGE_LO];
+
+        avr_set_bits(op, cmd + 4*i);
+        avr_set_addr(op, cmd + 4*i, (addr + i)/2);
+        avr_set_input(op, cmd + 4*i, m->buf[addr + i]);
+      }
+      int rc = ch341a_spi_cmds(pgm, cmd, n_bytes);
+
+      mmt_free(cmd);
+      if(rc < 0)
         return -1;
+      addr += n_bytes;
+    } else {
+      for(unsigned int end = addr + n_bytes; addr < end; addr++)
+        if(pgm->write_byte(pgm, p, m, addr, m->buf[addr]) < 0)
+          return -1;
+    }
   }
 
   if(isflash && avr_write_page(pgm, p, m, addr - n_bytes) < 0)
@@ -369,7 +489,7 @@ static int ch341a_spi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   return n_bytes;
 }
 
-// Fall back on bytewise read
+// Send all read commands of a page in one stream
 static int ch341a_spi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
 
@@ -379,20 +499,38 @@ static int ch341a_spi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const
     if(!isflash && !mem_is_eeprom(m))
       return -2;
 
+    if(isflash? !m->op[AVR_OP_READ_LO] || !m->op[AVR_OP_READ_HI]: !m->op[AVR_OP_READ]) {
+      for(unsigned int end = addr + n_bytes; addr < end; addr++)
+        if(pgm->read_byte(pgm, p, m, addr, m->buf + addr) < 0)
+          return -1;
+      return n_bytes;
+    }
+
     // Always called with addr at page boundary and n_bytes == m->page_size
-    if(isflash && m->op[AVR_OP_LOAD_EXT_ADDR]) {
-      unsigned char cmd[4], res[4];
+    unsigned int ext = isflash && m->op[AVR_OP_LOAD_EXT_ADDR]? 1: 0;
+    unsigned char *cmd = mmt_malloc(4*(ext + n_bytes)), *rd = cmd + 4*ext;
 
-      memset(cmd, 0, sizeof cmd);
+    if(ext) {
       avr_set_bits(m->op[AVR_OP_LOAD_EXT_ADDR], cmd);
       avr_set_addr(m->op[AVR_OP_LOAD_EXT_ADDR], cmd, addr/2);
-      if(pgm->cmd(pgm, cmd, res) < 0)
-        return -1;
     }
+    for(unsigned int i = 0; i < n_bytes; i++) {
+      OPCODE *op = m->op[!isflash? AVR_OP_READ: (addr + i) & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
 
-    for(unsigned int end = addr + n_bytes; addr < end; addr++)
-      if(pgm->read_byte(pgm, p, m, addr, m->buf + addr) < 0)
-        return -1;
+      avr_set_bits(op, rd + 4*i);
+      avr_set_addr(op, rd + 4*i, isflash? (addr + i)/2: addr + i);
+    }
+    if(ch341a_spi_cmds(pgm, cmd, ext + n_bytes) < 0) {
+      mmt_free(cmd);
+      return -1;
+    }
+    for(unsigned int i = 0; i < n_bytes; i++) {
+      OPCODE *op = m->op[!isflash? AVR_OP_READ: (addr + i) & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
+
+      m->buf[addr + i] = 0;
+      avr_get_output(op, rd + 4*i, m->buf + addr + i);
+    }
+    mmt_free(cmd);
   }
 
   return n_bytes;
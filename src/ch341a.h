@@ -30,6 +30,7 @@
 #define CH341A_PACKET_LENGTH     0x20
 
 #define CH341A_USB_TIMEOUT      15000
+#define CH341A_STREAM_PACKETS      32   // SPI stream packets in flight per batch
 
 #define CH341A_CMD_SPI_STREAM    0xA8   // SPI command
 #define CH341A_CMD_UIO_STREAM    0xAB   // UIO command
@@ -0,0 +1,65 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Parts and programmer database compiled into libavrdude
+ *
+ * With the BUILTIN_CONFIG build option (cmake -D BUILTIN_CONFIG=1 or
+ * configure --enable-builtin-config) the build turns the avrdude.conf
+ * generated from avrdude.conf.in into the header confbuiltin.h, which holds
+ * the file as comma-separated byte values. Included here, it becomes a
+ * const array in the read-only data of the library, shared by all processes
+ * using it. read_config_builtin() in config.c parses it in place of the
+ * system wide configuration file, which then need not be installed at all;
+ * as with avrdude.conf only the entries needed for -p, -c and -P are parsed.
+ * The per-user configuration file and -C +file can still override entries.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+#include "config.h"
+
+#if defined(BUILTIN_CONFIG)
+
+static const unsigned char builtin_conf[] = {
+#include "confbuiltin.h"
+  0
+};
+
+// Compiled-in configuration text and, in *lenp, its length
+const char *cfg_builtin(size_t *lenp) {
+  if(lenp)
+    *lenp = sizeof builtin_conf - 1;
+
+  return (const char *) builtin_conf;
+}
+
+#else
+
+const char *cfg_builtin(size_t *lenp) {
+  if(lenp)
+    *lenp = 0;
+
+  return NULL;
+}
+#endif
@@ -0,0 +1,24 @@
+#
+# confbuiltin.cmake - turn avrdude.conf into confbuiltin.h
+# Copyright (C) 2026 The AVRDUDE authors
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Write the bytes of avrdude.conf as initialiser list for the array in confbuiltin.c
+file(READ avrdude.conf CONTENTS HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," CONTENTS "${CONTENTS}")
+string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n" CONTENTS "${CONTENTS}")
+file(WRITE confbuiltin.h.tmp "// Generated from avrdude.conf by confbuiltin.cmake\n${CONTENTS}\n")
+file(RENAME confbuiltin.h.tmp confbuiltin.h)
@@ -0,0 +1,534 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Binary snapshot of a parsed configuration file
+ *
+ * Parsing avrdude.conf takes the lion's share of time for quick operations
+ * such as reading a fuse. When the user has created a cache directory
+ * $XDG_CACHE_HOME/avrdude or ~/.cache/avrdude, read_config() stores the
+ * part and programmer database in a binary snapshot there after parsing the
+ * first configuration file and, on subsequent runs, loads that snapshot
+ * instead of parsing the file again. The snapshot records the build version,
+ * the sizes of the involved structures and the size and modification time
+ * of the configuration file; any mismatch causes the file to be parsed
+ * afresh and the snapshot to be rewritten. The snapshot is specific to the
+ * machine and the avrdude build that wrote it.
+ *
+ * Only a file read into an empty database is cached as the snapshot would
+ * otherwise depend on previously read files.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(WIN32)
+#include <process.h>
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+#include "config.h"
+
+#define CC_MAGIC "avrdude config cache 1"
+
+// Sequential reader of the snapshot in memory
+typedef struct {
+  const unsigned char *p, *end;
+  int err;
+} Cc_in;
+
+static void put_raw(FILE *f, const void *data, size_t n) {
+  fwrite(data, 1, n, f);
+}
+
+static void put_int(FILE *f, int n) {
+  put_raw(f, &n, sizeof n);
+}
+
+// Strings are stored with a length prefix, NULL pointers as length -1
+static void put_str(FILE *f, const char *s) {
+  int n = s? (int) strlen(s): -1;
+
+  put_int(f, n);
+  if(n > 0)
+    put_raw(f, s, n);
+}
+
+static void put_strlist(FILE *f, LISTID l) {
+  put_int(f, l? lsize(l): -1);
+  for(LNODEID ln = l? lfirst(l): NULL; ln; ln = lnext(ln))
+    put_str(f, ldata(ln));
+}
+
+static void put_intlist(FILE *f, LISTID l) {
+  put_int(f, l? lsize(l): -1);
+  for(LNODEID ln = l? lfirst(l): NULL; ln; ln = lnext(ln))
+    put_int(f, *(int *) ldata(ln));
+}
+
+// Comments are a list of COMMENT structures, see config.c
+static void put_comments(FILE *f, LISTID l) {
+  put_int(f, l? lsize(l): -1);
+  for(LNODEID ln = l? lfirst(l): NULL; ln; ln = lnext(ln)) {
+    COMMENT *c = ldata(ln);
+
+    put_str(f, c->kw);
+    put_int(f, c->rhs);
+    put_strlist(f, c->comms);
+  }
+}
+
+static void put_ops(FILE *f, OPCODE *const *op) {
+  for(int i = 0; i < AVR_OP_MAX; i++) {
+    put_int(f, !!op[i]);
+    if(op[i])
+      put_raw(f, op[i], sizeof *op[i]);
+  }
+}
+
+static void put_part(FILE *f, const AVRPART *p) {
+  put_raw(f, p, sizeof *p);     // Scalars; pointers are replaced on loading
+  put_str(f, p->desc);
+  put_str(f, p->id);
+  put_str(f, p->parent_id);
+  put_str(f, p->family_id);
+  put_str(f, p->config_file);
+  put_comments(f, p->comments);
+  put_strlist(f, p->variants);
+  put_ops(f, p->op);
+
+  put_int(f, lsize(p->mem));
+  for(LNODEID ln = lfirst(p->mem); ln; ln = lnext(ln)) {
+    AVRMEM *m = ldata(ln);
+
+    put_raw(f, m, sizeof *m);
+    put_str(f, m->desc);
+    put_comments(f, m->comments);
+    put_ops(f, m->op);
+  }
+
+  put_int(f, lsize(p->mem_alias));
+  for(LNODEID ln = lfirst(p->mem_alias); ln; ln = lnext(ln)) {
+    AVRMEM_ALIAS *a = ldata(ln);
+    int idx = -1, i = 0;
+
+    for(LNODEID lm = lfirst(p->mem); lm; lm = lnext(lm), i++)
+      if(ldata(lm) == a->aliased_mem)
+        idx = i;
+    put_str(f, a->desc);
+    put_int(f, idx);
+  }
+}
+
+static void put_pgm(FILE *f, const PROGRAMMER *pgm) {
+  put_raw(f, pgm, sizeof *pgm); // Scalars; pointers are replaced on loading
+  put_strlist(f, pgm->id);
+  put_str(f, pgm->desc);
+  put_str(f, pgm->initpgm? locate_programmer_type_id(pgm->initpgm): NULL);
+  put_comments(f, pgm->comments);
+  put_str(f, pgm->parent_id);
+  put_intlist(f, pgm->usbpid);
+  put_str(f, pgm->usbdev);
+  put_str(f, pgm->usbsn);
+  put_str(f, pgm->usbvendor);
+  put_str(f, pgm->usbproduct);
+  put_intlist(f, pgm->hvupdi_support);
+  put_str(f, pgm->config_file);
+}
+
+static void get_raw(Cc_in *in, void *data, size_t n) {
+  if(in->err || (size_t) (in->end - in->p) < n) {
+    in->err = 1;
+    memset(data, 0, n);
+    return;
+  }
+  memcpy(data, in->p, n);
+  in->p += n;
+}
+
+static int get_int(Cc_in *in) {
+  int n;
+
+  get_raw(in, &n, sizeof n);
+  return n;
+}
+
+// Return malloc'd string or NULL
+static char *get_dupstr(Cc_in *in) {
+  int n = get_int(in);
+
+  if(n < 0 || in->err)
+    return NULL;
+  if(in->end - in->p < n) {
+    in->err = 1;
+    return NULL;
+  }
+  char *s = mmt_malloc(n + 1);
+
+  get_raw(in, s, n);
+  return s;
+}
+
+// Return cached string, NULL pointers stay NULL
+static const char *get_str(Cc_in *in) {
+  char *s = get_dupstr(in);
+  const char *ret = s? cache_string(s): NULL;
+
+  mmt_free(s);
+  return ret;
+}
+
+// Fill list l or, if l is NULL, a newly created list with malloc'd strings
+static LISTID get_strlist(Cc_in *in, LISTID l) {
+  int n = get_int(in);
+
+  if(n < 0 || in->err)
+    return l;
+  if(!l)
+    l = lcreat(NULL, 0);
+  while(n-- > 0 && !in->err)
+    ladd(l, get_dupstr(in));
+
+  return l;
+}
+
+static void get_intlist(Cc_in *in, LISTID l) {
+  for(int n = get_int(in); n > 0 && !in->err; n--) {
+    int *ip = mmt_malloc(sizeof *ip);
+
+    *ip = get_int(in);
+    ladd(l, ip);
+  }
+}
+
+static LISTID get_comments(Cc_in *in) {
+  int n = get_int(in);
+
+  if(n < 0 || in->err)
+    return NULL;
+
+  LISTID l = lcreat(NULL, 0);
+
+  while(n-- > 0 && !in->err) {
+    COMMENT *c = mmt_malloc(sizeof *c);
+
+    c->kw = get_dupstr(in);
+    c->rhs = get_int(in);
+    c->comms = get_strlist(in, NULL);
+    ladd(l, c);
+  }
+
+  return l;
+}
+
+static void get_ops(Cc_in *in, OPCODE **op) {
+  for(int i = 0; i < AVR_OP_MAX; i++) {
+    op[i] = NULL;
+    if(get_int(in)) {
+      op[i] = avr_new_opcode();
+      get_raw(in, op[i], sizeof *op[i]);
+    }
+  }
+}
+
+static AVRPART *get_part(Cc_in *in) {
+  AVRPART *p = avr_new_part();
+  LISTID mem = p->mem, mem_alias = p->mem_alias, variants = p->variants;
+
+  get_raw(in, p, sizeof *p);
+  p->mem = mem;
+  p->mem_alias = mem_alias;
+  p->mem_index = NULL;
+  p->desc = get_str(in);
+  p->id = get_str(in);
+  p->parent_id = get_str(in);
+  p->family_id = get_str(in);
+  p->config_file = get_str(in);
+  p->comments = get_comments(in);
+  p->variants = get_strlist(in, variants);
+  get_ops(in, p->op);
+
+  for(int n = get_int(in); n > 0 && !in->err; n--) {
+    AVRMEM *m = avr_new_mem();
+
+    get_raw(in, m, sizeof *m);
+    m->buf = NULL;
+    m->tags = NULL;
+    m->desc = get_str(in);
+    m->comments = get_comments(in);
+    get_ops(in, m->op);
+    ladd(p->mem, m);
+  }
+
+  for(int n = get_int(in); n > 0 && !in->err; n--) {
+    AVRMEM_ALIAS *a = avr_new_memalias();
+    const char *desc = get_str(in);
+    int idx = get_int(in);
+
+    a->desc = desc? desc: cache_string("");
+    a->aliased_mem = idx >= 0 && idx < lsize(p->mem)? lget_n(p->mem, idx + 1): NULL;
+    ladd(p->mem_alias, a);
+  }
+
+  return p;
+}
+
+static PROGRAMMER *get_pgm(Cc_in *in) {
+  PROGRAMMER *pgm = pgm_new(), *raw = mmt_malloc(sizeof *raw);
+
+  // Only copy what config_gram.y sets; pgm_new() has initialised the rest
+  get_raw(in, raw, sizeof *raw);
+  pgm->prog_modes = raw->prog_modes;
+  pgm->is_serialadapter = raw->is_serialadapter;
+  pgm->extra_features = raw->extra_features;
+  memcpy(pgm->pin, raw->pin, sizeof pgm->pin);
+  memcpy(pgm->pinno, raw->pinno, sizeof pgm->pinno);
+  pgm->conntype = raw->conntype;
+  pgm->baudrate = raw->baudrate;
+  pgm->usbvid = raw->usbvid;
+  pgm->lineno = raw->lineno;
+  mmt_free(raw);
+
+  get_strlist(in, pgm->id);
+  pgm->desc = get_str(in);
+
+  char *type = get_dupstr(in);
+
+  if(type) {
+    const PROGRAMMER_TYPE *pt = locate_programmer_type(type);
+
+    if(pt)
+      pgm->initpgm = pt->initpgm;
+    else
+      in->err = 1;
+    mmt_free(type);
+  }
+  pgm->comments = get_comments(in);
+  pgm->parent_id = get_str(in);
+  get_intlist(in, pgm->usbpid);
+  pgm->usbdev = get_str(in);
+  pgm->usbsn = get_str(in);
+  pgm->usbvendor = get_str(in);
+  pgm->usbproduct = get_str(in);
+  get_intlist(in, pgm->hvupdi_support);
+  pgm->config_file = get_str(in);
+
+  return pgm;
+}
+
+// Header that identifies build, structure layout and the configuration file
+static char *cache_header(const char *file, const struct stat *sb) {
+  return mmt_sprintf("%s\n%s\n%d %d %d %d %d %d\n%s\n%lld %lld\n", CC_MAGIC, AVRDUDE_FULL_VERSION,
+    (int) sizeof(AVRPART), (int) sizeof(AVRMEM), (int) sizeof(AVRMEM_ALIAS), (int) sizeof(OPCODE),
+    (int) sizeof(PROGRAMMER), (int) AVR_OP_MAX, file, (long long) sb->st_size, (long long) sb->st_mtime);
+}
+
+// Hash of the full file name (strhash() only looks at the first 20 characters)
+static unsigned namehash(const char *str) {
+  unsigned c, hash = 5381;
+
+  while((c = (unsigned char) *str++))
+    hash = 33*hash ^ c;
+
+  return hash;
+}
+
+// The cache directory in a mmt_malloc'd string if the user has created one, NULL otherwise
+char *cfg_cache_dir(void) {
+  const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+  char *dir = xdg && *xdg? mmt_sprintf("%s/avrdude", xdg):
+    home && *home? mmt_sprintf("%s/.cache/avrdude", home): NULL;
+  struct stat sb;
+
+  if(dir && (stat(dir, &sb) < 0 || !(sb.st_mode & S_IFDIR))) {
+    mmt_free(dir);
+    dir = NULL;
+  }
+
+  return dir;
+}
+
+// Name of the cache file for file if the user has created a cache directory, NULL otherwise
+static char *cache_filename(const char *file) {
+  char *dir = cfg_cache_dir();
+
+  if(!dir)
+    return NULL;
+
+  char *ret = mmt_sprintf("%s/conf-%08x.cache", dir, namehash(file));
+
+  mmt_free(dir);
+  return ret;
+}
+
+// Is the snapshot cache in use for file, ie, has the user created a cache directory?
+int cfg_cache_enabled(const char *file) {
+  char *cfile = cache_filename(file);
+
+  mmt_free(cfile);
+  return !!cfile;
+}
+
+/*
+ * Load the database from the snapshot of the configuration file file (the
+ * realpath) into empty part and programmer lists
+ *
+ * Returns 0 if the database has been loaded and -1 if not, in which case
+ * file needs parsing
+ */
+int cfg_cache_load(const char *file) {
+  char *cfile, *hdr = NULL;
+  unsigned char *buf = NULL;
+  struct stat sb;
+  FILE *f = NULL;
+  int ret = -1;
+
+  if(lsize(part_list) || lsize(programmers) || !(cfile = cache_filename(file)))
+    return -1;
+
+  if(stat(file, &sb) < 0 || !(f = fopen(cfile, "rb")))
+    goto done;
+
+  hdr = cache_header(file, &sb);
+  size_t hlen = strlen(hdr);
+  long len;
+
+  if(fseek(f, 0, SEEK_END) < 0 || (len = ftell(f)) < (long) hlen || fseek(f, 0, SEEK_SET) < 0)
+    goto done;
+  buf = mmt_malloc(len);
+  if(fread(buf, 1, len, f) != (size_t) len || memcmp(buf, hdr, hlen))
+    goto done;
+
+  Cc_in in = { buf + hlen, buf + len, 0 };
+
+  avrdude_conf_version = get_str(&in);
+  default_programmer = get_str(&in);
+  default_parallel = get_str(&in);
+  default_serial = get_str(&in);
+  default_spi = get_str(&in);
+  default_baudrate = get_int(&in);
+  get_raw(&in, &default_bitclock, sizeof default_bitclock);
+  default_linuxgpio = get_str(&in);
+  allow_subshells = get_int(&in);
+  avr_db.cfg_prologue = get_strlist(&in, NULL);
+
+  for(int n = get_int(&in); n > 0 && !in.err; n--)
+    ladd(programmers, get_pgm(&in));
+  for(int n = get_int(&in); n > 0 && !in.err; n--)
+    ladd(part_list, get_part(&in));
+
+  if(in.err || in.p != in.end || !avrdude_conf_version) { // Corrupt: discard and parse file instead
+    pmsg_warning("ignoring corrupt configuration cache %s\n", cfile);
+    ldestroy_cb(part_list, (void (*)(void *)) avr_free_part);
+    ldestroy_cb(programmers, (void (*)(void *)) pgm_free);
+    part_list = lcreat_vec(NULL, 0);
+    programmers = lcreat_vec(NULL, 0);
+    avr_db.cfg_prologue = NULL;
+    avrdude_conf_version = default_programmer = default_parallel = default_serial = default_spi = "";
+    default_linuxgpio = "";
+    default_baudrate = allow_subshells = 0;
+    default_bitclock = 0.0;
+    goto done;
+  }
+
+  pmsg_debug("loaded configuration cache %s\n", cfile);
+  ret = 0;
+
+done:
+  if(f)
+    fclose(f);
+  mmt_free(buf);
+  mmt_free(hdr);
+  mmt_free(cfile);
+  return ret;
+}
+
+/*
+ * Save the database just parsed from the configuration file file (the
+ * realpath) as snapshot; has no effect if no cache directory exists or the
+ * database was not empty before reading file (signalled by was_empty = 0)
+ */
+void cfg_cache_save(const char *file, int was_empty) {
+  char *cfile, *tmp, *hdr;
+  struct stat sb;
+  FILE *f;
+
+  if(!was_empty || !(cfile = cache_filename(file)))
+    return;
+  if(stat(file, &sb) < 0) {
+    mmt_free(cfile);
+    return;
+  }
+
+  // Write to a temporary file first so concurrent runs never see a partial snapshot
+  tmp = mmt_sprintf("%s.%ld", cfile, (long) getpid());
+  if(!(f = fopen(tmp, "wb"))) {
+    pmsg_notice("cannot write configuration cache %s\n", tmp);
+    goto done;
+  }
+
+  hdr = cache_header(file, &sb);
+  put_raw(f, hdr, strlen(hdr));
+  mmt_free(hdr);
+
+  put_str(f, avrdude_conf_version);
+  put_str(f, default_programmer);
+  put_str(f, default_parallel);
+  put_str(f, default_serial);
+  put_str(f, default_spi);
+  put_int(f, default_baudrate);
+  put_raw(f, &default_bitclock, sizeof default_bitclock);
+  put_str(f, default_linuxgpio);
+  put_int(f, allow_subshells);
+  put_strlist(f, avr_db.cfg_prologue);
+
+  put_int(f, lsize(programmers));
+  for(LNODEID ln = lfirst(programmers); ln; ln = lnext(ln))
+    put_pgm(f, ldata(ln));
+  put_int(f, lsize(part_list));
+  for(LNODEID ln = lfirst(part_list); ln; ln = lnext(ln))
+    put_part(f, ldata(ln));
+
+  int err = ferror(f);
+
+  if(fclose(f) || err)
+    err = 1;
+
+#if defined(WIN32)
+  if(!err)
+    unlink(cfile);              // Windows rename() does not overwrite
+#endif
+
+  if(err || rename(tmp, cfile) < 0) {
+    pmsg_notice("cannot write configuration cache %s\n", cfile);
+    unlink(tmp);
+  } else
+    pmsg_debug("wrote configuration cache %s\n", cfile);
+
+done:
+  mmt_free(tmp);
+  mmt_free(cfile);
+}
@@ -28,6 +28,11 @@
 #include <ctype.h>
 #include <wchar.h>
 
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#include <pthread.h>
+#define CFG_THREADS 1
+#endif
+
 #include "avrdude.h"
 #include "libavrdude.h"
 #include "config.h"
@@ -53,6 +58,7 @@ AVRMEM *current_mem;
 int current_strct;
 LISTID part_list;
 LISTID programmers;
+Avr_db avr_db;                  // Shared by all sessions, see libavrdude.h
 bool is_alias;
 
 int cfg_lineno;
@@ -160,11 +166,106 @@ Component avr_comp[] = {
 
 #define DEBUG 0
 
+/*
+ * Arena for config objects
+ *
+ * While config files are read, cfg_malloc() and cfg_strdup() carve parts,
+ * programmers, memories, opcodes, list node pools and tokens out of large
+ * blocks rather than asking malloc() for each of the many small objects.
+ * cfg_free() ignores arena pointers, and cfg_realloc() moves them onto the
+ * heap, so the usual ownership rules of the code base still apply;
+ * cleanup_config() then hands back the whole arena in one go.
+ */
+
+#define CFG_ARENA_BLOCK (256*1024)     // Size of first arena block
+#define CFG_ARENA_LARGE (CFG_ARENA_BLOCK/16) // Larger requests go to the heap
+#define CFG_ARENA_ALIGN sizeof(double) // Config objects need no more alignment
+
+typedef struct cfg_arena {
+  struct cfg_arena *next;
+  size_t size;                  // Usable bytes after this header
+} Cfg_arena;
+
+#define cfg_arena_round(n) (((n) + CFG_ARENA_ALIGN - 1)/CFG_ARENA_ALIGN*CFG_ARENA_ALIGN)
+#define cfg_arena_data(b) ((char *) (b) + cfg_arena_round(sizeof(Cfg_arena)))
+
+// Each arena allocation is preceded by its size so cfg_realloc() can copy it
+#define CFG_ARENA_HDR cfg_arena_round(sizeof(size_t))
+
+static void *cfg_arena_alloc(size_t n) {
+  size_t need = CFG_ARENA_HDR + cfg_arena_round(n);
+
+  if(need > avr_db.cfg_arena_left) {
+    // Double block sizes to keep the chain short for cfg_in_arena()
+    size_t size = avr_db.cfg_arena? 2*((Cfg_arena *) avr_db.cfg_arena)->size: CFG_ARENA_BLOCK;
+    Cfg_arena *b = calloc(1, cfg_arena_round(sizeof(Cfg_arena)) + size);
+
+    if(!b)
+      return NULL;
+    b->next = avr_db.cfg_arena;
+    b->size = size;
+    avr_db.cfg_arena = b;
+    avr_db.cfg_arena_ptr = cfg_arena_data(b);
+    avr_db.cfg_arena_left = size;
+  }
+
+  char *ret = avr_db.cfg_arena_ptr + CFG_ARENA_HDR;
+
+  memcpy(avr_db.cfg_arena_ptr, &n, sizeof n); // Arena blocks are zeroed, so is the object
+  avr_db.cfg_arena_ptr += need;
+  avr_db.cfg_arena_left -= need;
+
+  return ret;
+}
+
+// Is p inside one of the arena blocks?
+static int cfg_in_arena(const void *p) {
+  if(p)
+    for(Cfg_arena *b = avr_db.cfg_arena; b; b = b->next)
+      if((const char *) p >= cfg_arena_data(b) && (const char *) p < cfg_arena_data(b) + b->size)
+        return 1;
+
+  return 0;
+}
+
+// Release all arena blocks at once; pointers into the arena become invalid
+static void cfg_arena_free(void) {
+  // Part and programmer indices and the comment chains may live in the arena
+  lhdestroy(avr_db.avr_pidx_names);
+  lhdestroy_cb(avr_db.avr_pidx_sigs, (void (*)(void *)) ldestroy);
+  avr_db.avr_pidx_names = avr_db.avr_pidx_sigs = NULL;
+  avr_db.avr_pidx_list = NULL;
+  avr_db.avr_pidx_last = NULL;
+  lhdestroy(avr_db.pgm_idx_ids);
+  avr_db.pgm_idx_ids = NULL;
+  avr_db.pgm_idx_list = NULL;
+  avr_db.pgm_idx_last = NULL;
+  if(cfg_in_arena(avr_db.cfg_comms))
+    avr_db.cfg_comms = NULL;
+  if(cfg_in_arena(avr_db.cfg_prologue))
+    avr_db.cfg_prologue = NULL;
+  if(cfg_in_arena(avr_db.cfg_lkw))
+    avr_db.cfg_lkw = NULL;
+  if(cfg_in_arena(avr_db.cfg_strctcomms))
+    avr_db.cfg_strctcomms = NULL;
+  if(cfg_in_arena(avr_db.cfg_pushedcomms))
+    avr_db.cfg_pushedcomms = NULL;
+
+  for(Cfg_arena *b = avr_db.cfg_arena, *next; b; b = next) {
+    next = b->next;
+    free(b);
+  }
+  avr_db.cfg_arena = NULL;
+  avr_db.cfg_arena_ptr = NULL;
+  avr_db.cfg_arena_left = 0;
+}
+
 void cleanup_config(void) {
   ldestroy_cb(part_list, (void (*)(void *)) avr_free_part);
   ldestroy_cb(programmers, (void (*)(void *)) pgm_free);
   ldestroy_cb(string_list, (void (*)(void *)) free_token);
   ldestroy_cb(number_list, (void (*)(void *)) free_token);
+  cfg_arena_free();
 }
 
 int init_config(void) {
@@ -173,8 +274,8 @@ int init_config(void) {
   current_prog = NULL;
   current_part = NULL;
   current_mem = NULL;
-  part_list = lcreat(NULL, 0);
-  programmers = lcreat(NULL, 0);
+  part_list = lcreat_vec(NULL, 0);
+  programmers = lcreat_vec(NULL, 0);
   is_alias = false;
 
   cfg_lineno = 1;
@@ -183,21 +284,31 @@ int init_config(void) {
   return 0;
 }
 
+// Zeroed memory from calloc(): large blocks then only use RAM once written to
 void *cfg_malloc(const char *funcname, size_t n) {
-  void *ret = malloc(n);
+  void *ret = cx && cx->cfg_arena_on && n <= CFG_ARENA_LARGE? cfg_arena_alloc(n): calloc(1, n);
 
   if(!ret) {
-    pmsg_error("out of memory in %s() for malloc(); needed %lu bytes\n", funcname, (unsigned long) n);
+    pmsg_error("out of memory in %s() for calloc(); needed %lu bytes\n", funcname, (unsigned long) n);
     exit(1);
   }
-  memset(ret, 0, n);
   return ret;
 }
 
 void *cfg_realloc(const char *funcname, void *p, size_t n) {
   void *ret;
 
-  if(!(ret = p? realloc(p, n): calloc(1, n))) {
+  if(cfg_in_arena(p)) {         // Move arena object onto the heap
+    size_t old;
+
+    memcpy(&old, (char *) p - CFG_ARENA_HDR, sizeof old);
+    if((ret = calloc(1, n)))
+      memcpy(ret, p, old < n? old: n);
+    p = NULL;
+  } else
+    ret = NULL;
+
+  if(!ret && !(ret = p? realloc(p, n): calloc(1, n))) {
     pmsg_error("out of memory in %s() for %salloc(); needed %lu bytes\n", funcname, p? "re": "c", (unsigned long) n);
     exit(1);
   }
@@ -205,7 +316,11 @@ void *cfg_realloc(const char *funcname, void *p, size_t n) {
 }
 
 char *cfg_strdup(const char *funcname, const char *s) {
-  char *ret = strdup(s);
+  size_t n = strlen(s) + 1;
+  char *ret = cx && cx->cfg_arena_on && n <= CFG_ARENA_LARGE? cfg_arena_alloc(n): malloc(n);
+
+  if(ret)
+    memcpy(ret, s, n);
 
   if(!ret) {
     pmsg_error("out of memory in %s() for strdup()\n", funcname);
@@ -214,6 +329,12 @@ char *cfg_strdup(const char *funcname, const char *s) {
   return ret;
 }
 
+// Free heap memory; arena objects live until cleanup_config()
+void cfg_free(void *p) {
+  if(!cfg_in_arena(p))
+    free(p);
+}
+
 void mmt_f_free(void *ptr) {
   mmt_free(ptr);
 }
@@ -421,6 +542,27 @@ void pyytext(void) {
 extern int yylex_destroy(void);
 #endif
 
+// Parse the opened configuration file f; cfg_infile is the name used in messages
+static int parse_config(FILE *f) {
+  int r;
+
+  int arena = cx->cfg_arena_on;
+
+  cfg_lineno = 1;
+  yyin = f;
+
+  cx->cfg_arena_on = 1;
+  r = yyparse();
+  cx->cfg_arena_on = arena;
+
+#ifdef HAVE_YYLEX_DESTROY
+  // Reset lexer and free any allocated memory
+  yylex_destroy();
+#endif
+
+  return r;
+}
+
 int read_config(const char *file) {
   FILE *f;
   int r;
@@ -430,6 +572,19 @@ int read_config(const char *file) {
     return -1;
   }
 
+  int was_empty = !lsize(part_list) && !lsize(programmers);
+
+  int arena = cx->cfg_arena_on, cached;
+
+  cx->cfg_arena_on = 1;
+  cached = cfg_cache_load(cfg_infile) == 0;
+  cx->cfg_arena_on = arena;
+  if(cached) {                  // Snapshot of previous parse still valid
+    mmt_free(cfg_infile);
+    cfg_infile = NULL;
+    return 0;
+  }
+
   f = fopen(cfg_infile, "r");
   if(f == NULL) {
     pmsg_ext_error("cannot open config file %s: %s\n", cfg_infile, strerror(errno));
@@ -438,18 +593,12 @@ int read_config(const char *file) {
     return -1;
   }
 
-  cfg_lineno = 1;
-  yyin = f;
-
-  r = yyparse();
-
-#ifdef HAVE_YYLEX_DESTROY
-  // Reset lexer and free any allocated memory
-  yylex_destroy();
-#endif
-
+  r = parse_config(f);
   fclose(f);
 
+  if(r == 0)
+    cfg_cache_save(cfg_infile, was_empty);
+
   if(cfg_infile) {
     mmt_free(cfg_infile);
     cfg_infile = NULL;
@@ -458,6 +607,343 @@ int read_config(const char *file) {
   return r;
 }
 
+/*
+ * Lazy reading of the configuration file
+ *
+ * A quick prescan finds the top-level part, programmer and serialadapter
+ * entries of the file without building them. Only entries that have an id,
+ * desc or variant starting with one of the requested names, those that they
+ * inherit from via parent and all serial adapters are then handed to the
+ * parser; skipped entries are overwritten with spaces keeping all newlines so
+ * that line numbers in messages and in the config_file and lineno fields of
+ * parts and programmers remain correct.
+ */
+
+typedef struct {
+  size_t beg, end;              // Byte range in buffer including preceding comments
+  int kind;                     // 'p' part, 'g' programmer, 's' serial adapter
+  int keep;
+  char *parent;                 // Parent's name or NULL
+  LISTID names;                 // Strings in id, desc and variants assignments
+} Cfg_entry;
+
+// Skip white space and comments; return next token type and set *beg, *end
+static int cfg_scan(const char *p, const char **beg, const char **end) {
+  for(;;) {
+    while(isspace((unsigned char) *p))
+      p++;
+    if(*p == '#') {
+      while(*p && *p != '\n')
+        p++;
+    } else if(p[0] == '/' && p[1] == '*') {
+      const char *q = strstr(p + 2, "*/");
+
+      if(!q)
+        return 0;
+      p = q + 2;
+    } else
+      break;
+  }
+
+  *beg = p;
+  if(!*p)
+    return *end = p, 0;
+
+  if(*p == '"') {
+    for(p++; *p && *p != '"'; p++)
+      if(*p == '\\' && p[1])
+        p++;
+    if(!*p)
+      return 0;
+    *end = p + 1;
+    return 's';
+  }
+
+  if(isalpha((unsigned char) *p) || *p == '_') {
+    while(isalnum((unsigned char) *p) || *p == '_')
+      p++;
+    *end = p;
+    return 'w';
+  }
+
+  *end = p + 1;
+  return *p;
+}
+
+static int cfg_scan_word(const char *beg, const char *end, const char *word) {
+  size_t len = strlen(word);
+
+  return (size_t) (end - beg) == len && !strncmp(beg, word, len);
+}
+
+static void cfg_free_entry(void *p) {
+  Cfg_entry *e = p;
+
+  mmt_free(e->parent);
+  ldestroy_cb(e->names, mmt_f_free);
+  mmt_free(e);
+}
+
+// Scan the buffer for top-level entries; return list of them or NULL on syntax error
+static LISTID cfg_prescan(const char *buf) {
+  LISTID entries = lcreat(NULL, 0);
+  Cfg_entry *e = NULL;
+  const char *p = buf, *beg, *end, *stmt = NULL;
+  int t, depth = 0, fresh = 1;
+  size_t prevend = 0;
+
+  while((t = cfg_scan(p, &beg, &end))) {
+    p = end;
+    if(depth == 0) {            // Top level: entry or global assignment
+      int kind = cfg_scan_word(beg, end, "part")? 'p': cfg_scan_word(beg, end, "programmer")? 'g':
+        cfg_scan_word(beg, end, "serialadapter")? 's': 0;
+
+      if(kind) {
+        e = mmt_malloc(sizeof *e);
+        e->beg = prevend;
+        e->kind = kind;
+        e->names = lcreat(NULL, 0);
+        ladd(entries, e);
+        if(cfg_scan(p, &beg, &end) == 'w' && cfg_scan_word(beg, end, "parent")) {
+          if(cfg_scan(end, &beg, &end) != 's')
+            goto error;
+          e->parent = mmt_sprintf("%.*s", (int) (end - beg - 2), beg + 1);
+          p = end;
+        }
+        depth = 1, fresh = 1;
+      } else {
+        while(t && t != ';')
+          t = cfg_scan(p, &beg, &end), p = end;
+        if(!t)
+          goto error;
+        prevend = p - buf;
+      }
+    } else if(fresh) {          // Start of a new statement or end of the current block
+      if(t == ';') {
+        if(--depth == 0) {
+          e->end = prevend = p - buf;
+          e = NULL;
+        }
+      } else if(depth == 1 && t == 'w' && cfg_scan_word(beg, end, "memory")) {
+        if(cfg_scan(p, &beg, &end) != 's')
+          goto error;
+        p = end;
+        if(cfg_scan(p, &beg, &end) == '=')      // memory "..." = NULL;
+          fresh = 0, stmt = NULL;
+        else
+          depth = 2;
+      } else {
+        fresh = 0;
+        stmt = depth == 1 && t == 'w' && (cfg_scan_word(beg, end, "id") || cfg_scan_word(beg, end, "desc") ||
+          cfg_scan_word(beg, end, "variants"))? beg: NULL;
+      }
+    } else if(t == ';') {
+      fresh = 1;
+    } else if(t == 's' && stmt) {
+      ladd(e->names, mmt_sprintf("%.*s", (int) (end - beg - 2), beg + 1));
+    }
+  }
+
+  if(depth == 0)
+    return entries;
+
+error:
+  ldestroy_cb(entries, cfg_free_entry);
+  return NULL;
+}
+
+// Does any of the names of entry e start with one of the strings in want?
+static int cfg_wanted(const Cfg_entry *e, LISTID want) {
+  for(LNODEID ln = lfirst(e->names); ln; ln = lnext(ln))
+    for(LNODEID lw = lfirst(want); lw; lw = lnext(lw))
+      if(str_casestarts(ldata(ln), ldata(lw)))
+        return 1;
+
+  return 0;
+}
+
+// Read the contents of file into a nul-terminated buffer; return NULL on failure
+static char *cfg_read_file(const char *file, long *lenp) {
+  char *buf = NULL;
+  FILE *f = fopen(file, "rb");
+  long len;
+
+  if(f && fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+    buf = mmt_malloc(len + 1);
+    if(fread(buf, 1, len, f) != (size_t) len) {
+      mmt_free(buf);
+      buf = NULL;
+    } else {
+      buf[len] = 0;
+      *lenp = len;
+    }
+  }
+  if(f)
+    fclose(f);
+
+  return buf;
+}
+
+// Add the parents of all entries in file to the list names; return -1 if file cannot be scanned
+int cfg_lazy_parents(const char *file, LISTID names) {
+  long len;
+  char *buf = cfg_read_file(file, &len);
+  LISTID entries = buf? cfg_prescan(buf): NULL;
+
+  for(LNODEID ln = entries? lfirst(entries): NULL; ln; ln = lnext(ln)) {
+    Cfg_entry *e = ldata(ln);
+
+    if(e->parent)
+      ladd(names, (void *) cache_string(e->parent));
+  }
+  if(entries)
+    ldestroy_cb(entries, cfg_free_entry);
+  mmt_free(buf);
+
+  return entries? 0: -1;
+}
+
+/*
+ * Blank all entries in buf that are not needed to find the names in the
+ * list names, keeping their parents and all serial adapters; names is
+ * extended with the parents' names. Returns the number of kept entries and
+ * sets *nentries to the number of all entries, or returns -1 if the prescan
+ * encounters a syntax error (which the full parse then reports).
+ */
+static int cfg_prune(char *buf, LISTID names, int *nentries) {
+  LISTID entries = cfg_prescan(buf);
+  int nkeep = 0;
+
+  if(!entries)
+    return -1;
+
+  // Mark wanted entries and, repeatedly, the entries they inherit from
+  for(int more = 1; more; ) {
+    more = 0;
+    for(LNODEID ln = lfirst(entries); ln; ln = lnext(ln)) {
+      Cfg_entry *e = ldata(ln);
+
+      if(!e->keep && (e->kind == 's' || cfg_wanted(e, names))) {
+        e->keep = 1, nkeep++;
+        if(e->parent)
+          ladd(names, (void *) cache_string(e->parent)), more = 1;
+      }
+    }
+  }
+
+  for(LNODEID ln = lfirst(entries); ln; ln = lnext(ln)) {
+    Cfg_entry *e = ldata(ln);
+
+    if(!e->keep)
+      for(size_t i = e->beg; i < e->end; i++)
+        if(buf[i] != '\n')
+          buf[i] = ' ';
+  }
+  *nentries = lsize(entries);
+  ldestroy_cb(entries, cfg_free_entry);
+
+  return nkeep;
+}
+
+// Stream for parsing buf of length len, which must remain valid until the stream is closed
+static FILE *cfg_memfile(char *buf, long len) {
+#if !defined(WIN32)
+  return fmemopen(buf, len, "r");
+#else
+  FILE *tf = tmpfile();
+
+  if(tf && (fwrite(buf, 1, len, tf) != (size_t) len || fseek(tf, 0, SEEK_SET) < 0)) {
+    fclose(tf);
+    tf = NULL;
+  }
+
+  return tf;
+#endif
+}
+
+/*
+ * Read configuration file file only parsing the part and programmer entries
+ * that may be needed to find the names in the list names (plus their parents
+ * and all serial adapters); names is extended with the parents' names
+ *
+ * Falls back to reading the full file if a configuration cache is in use, if
+ * the prescan encounters a syntax error (which the full parse then reports)
+ * or if the database is not empty
+ */
+int read_config_lazy(const char *file, LISTID names) {
+  char *rfile = NULL, *buf = NULL;
+  FILE *tf = NULL;
+  long len;
+  int r = -1, nkeep, nentries;
+
+  if(!names || !lsize(names) || lsize(part_list) || lsize(programmers) || cfg_cache_enabled(file))
+    return read_config(file);
+
+  if(!(rfile = realpath(file, NULL)) || !(buf = cfg_read_file(rfile, &len)) ||
+    (nkeep = cfg_prune(buf, names, &nentries)) < 0 || !(tf = cfg_memfile(buf, len)))
+    goto fallback;
+
+  pmsg_debug("lazily parsing %d of %d entries in %s\n", nkeep, nentries, rfile);
+  cfg_infile = rfile;
+  rfile = NULL;
+  r = parse_config(tf);
+  mmt_free(cfg_infile);
+  cfg_infile = NULL;
+  goto done;
+
+fallback:
+  r = read_config(file);
+
+done:
+  if(tf)
+    fclose(tf);
+  mmt_free(buf);
+  mmt_free(rfile);
+
+  return r;
+}
+
+/*
+ * Read the parts and programmer database compiled into libavrdude, see
+ * confbuiltin.c, in place of the system wide configuration file; if names
+ * is not NULL, only parse the entries needed for them as read_config_lazy()
+ * does. Returns -1 if avrdude was built without a compiled-in database.
+ */
+int read_config_builtin(LISTID names) {
+  size_t len;
+  const char *text = cfg_builtin(&len);
+  char *buf = NULL;
+  FILE *f;
+  int r, nkeep = -1, nentries;
+
+  if(!text) {
+    pmsg_error("this avrdude was built without a compiled-in configuration\n");
+    return -1;
+  }
+
+  if(names && lsize(names) && !lsize(part_list) && !lsize(programmers)) {
+    buf = memcpy(mmt_malloc(len + 1), text, len);
+    if((nkeep = cfg_prune(buf, names, &nentries)) < 0) { // Parse all so parser reports the error
+      memcpy(buf, text, len);
+    } else
+      pmsg_debug("lazily parsing %d of %d entries in %s\n", nkeep, nentries, CFG_BUILTIN);
+  }
+
+  if(!(f = cfg_memfile(buf? buf: (char *) text, len))) {
+    pmsg_ext_error("cannot open stream for %s: %s\n", CFG_BUILTIN, strerror(errno));
+    mmt_free(buf);
+    return -1;
+  }
+  cfg_infile = mmt_strdup(CFG_BUILTIN);
+  r = parse_config(f);
+  mmt_free(cfg_infile);
+  cfg_infile = NULL;
+  fclose(f);
+  mmt_free(buf);
+
+  return r;
+}
+
 // Adapted version of a neat empirical hash function from comp.lang.c by Daniel Bernstein
 unsigned strhash(const char *str) {
   unsigned c, hash = 5381, n = 0;
@@ -468,28 +954,95 @@ unsigned strhash(const char *str) {
   return hash;
 }
 
+/*
+ * Intern table for cache_string(): open addressing with linear probing in a
+ * power-of-2 sized table that is kept at most half full; each slot stores
+ * the full-length hash and the length next to the string, so looking up a
+ * string already seen is normally a single probe and a memcmp()
+ */
+struct cfg_istr {
+  unsigned hash, len;
+  const char *str;
+};
+
+// FNV-1a hash over the whole string; also returns its length
+static unsigned istr_hash(const char *str, unsigned *lenp) {
+  unsigned hash = 2166136261U;
+  const char *s;
+
+  for(s = str; *s; s++)
+    hash = (hash ^ (unsigned char) *s)*16777619U;
+  *lenp = s - str;
+
+  return hash;
+}
+
+static struct cfg_istr *istr_slot(struct cfg_istr *tab, size_t size, unsigned hash, const char *str, unsigned len) {
+  size_t i = hash & (size - 1);
+
+  while(tab[i].str && !(tab[i].hash == hash && tab[i].len == len && !memcmp(tab[i].str, str, len)))
+    i = (i + 1) & (size - 1);
+
+  return tab + i;
+}
+
+static void istr_grow(void) {
+  size_t size = avr_db.cfg_istrsize? 2*avr_db.cfg_istrsize: 4096;
+  struct cfg_istr *tab = mmt_realloc(NULL, size*sizeof *tab); // Zeroed heap memory, not arena
+
+  for(size_t i = 0; i < avr_db.cfg_istrsize; i++) {
+    struct cfg_istr *e = avr_db.cfg_istrs + i;
+
+    if(e->str)
+      *istr_slot(tab, size, e->hash, e->str, e->len) = *e;
+  }
+  mmt_free(avr_db.cfg_istrs);
+  avr_db.cfg_istrs = tab;
+  avr_db.cfg_istrsize = size;
+}
+
 // Return a copy of the argument as hashed string
-const char *cache_string(const char *p) {
-  int h, k;
-  char **hs;
+#ifdef CFG_THREADS
+static pthread_mutex_t cfg_db_mutex = PTHREAD_MUTEX_INITIALIZER; // Guards lazy updates of avr_db
+#endif
 
-  if(!p)
-    p = "(NULL)";
+// Serialise updates of the shared database, eg, of its lookup indices, between sessions
+void avr_db_lock(void) {
+#ifdef CFG_THREADS
+  pthread_mutex_lock(&cfg_db_mutex);
+#endif
+}
 
-  h = strhash(p)%(sizeof cx->cfg_hstrings/sizeof *cx->cfg_hstrings);
-  if(!(hs = cx->cfg_hstrings[h]))
-    hs = cx->cfg_hstrings[h] = (char **) mmt_realloc(NULL, (16 + 1)*sizeof **cx->cfg_hstrings);
+void avr_db_unlock(void) {
+#ifdef CFG_THREADS
+  pthread_mutex_unlock(&cfg_db_mutex);
+#endif
+}
 
-  for(k = 0; hs[k]; k++)
-    if(*p == *hs[k] && str_eq(p, hs[k]))
-      return hs[k];
+const char *cache_string(const char *p) {
+  unsigned len, hash;
+  struct cfg_istr *e;
+  const char *ret;
 
-  if(k && k%16 == 0)
-    cx->cfg_hstrings[h] = (char **) mmt_realloc(cx->cfg_hstrings[h], (k + 16 + 1)*sizeof **cx->cfg_hstrings);
+  if(!p)
+    p = "(NULL)";
 
-  cx->cfg_hstrings[h][k + 1] = NULL;
+  avr_db_lock();
+  if(2*(avr_db.cfg_nistrs + 1) > avr_db.cfg_istrsize)
+    istr_grow();
+
+  hash = istr_hash(p, &len);
+  if(!(e = istr_slot(avr_db.cfg_istrs, avr_db.cfg_istrsize, hash, p, len))->str) {
+    // Cached strings outlive the config arena, so put them onto the heap
+    e->hash = hash;
+    e->len = len;
+    e->str = memcpy(mmt_realloc(NULL, len + 1), p, len + 1);
+    avr_db.cfg_nistrs++;
+  }
+  ret = e->str;                 // The table may grow once unlocked
+  avr_db_unlock();
 
-  return cx->cfg_hstrings[h][k] = mmt_strdup(p);
+  return ret;
 }
 
 COMMENT *locate_comment(const LISTID comments, const char *where, int rhs) {
@@ -505,58 +1058,58 @@ COMMENT *locate_comment(const LISTID comments, const char *where, int rhs) {
 }
 
 static void addcomment(int rhs) {
-  if(cx->cfg_lkw) {
+  if(avr_db.cfg_lkw) {
     COMMENT *node = mmt_malloc(sizeof(*node));
 
     node->rhs = rhs;
-    node->kw = mmt_strdup(cx->cfg_lkw);
-    node->comms = cx->cfg_comms;
-    cx->cfg_comms = NULL;
-    if(!cx->cfg_strctcomms)
-      cx->cfg_strctcomms = lcreat(NULL, 0);
-    ladd(cx->cfg_strctcomms, node);
+    node->kw = mmt_strdup(avr_db.cfg_lkw);
+    node->comms = avr_db.cfg_comms;
+    avr_db.cfg_comms = NULL;
+    if(!avr_db.cfg_strctcomms)
+      avr_db.cfg_strctcomms = lcreat(NULL, 0);
+    ladd(avr_db.cfg_strctcomms, node);
   }
 }
 
 // Capture prologue during parsing (triggered by lexer.l)
 void cfg_capture_prologue(void) {
-  cx->cfg_prologue = cx->cfg_comms;
-  cx->cfg_comms = NULL;
+  avr_db.cfg_prologue = avr_db.cfg_comms;
+  avr_db.cfg_comms = NULL;
 }
 
 LISTID cfg_get_prologue(void) {
-  return cx->cfg_prologue;
+  return avr_db.cfg_prologue;
 }
 
 // Captures comments during parsing
 void capture_comment_str(const char *com, int lineno) {
-  if(!cx->cfg_comms)
-    cx->cfg_comms = lcreat(NULL, 0);
-  ladd(cx->cfg_comms, mmt_strdup(com));
+  if(!avr_db.cfg_comms)
+    avr_db.cfg_comms = lcreat(NULL, 0);
+  ladd(avr_db.cfg_comms, mmt_strdup(com));
 
   // Last keyword lineno is the same as this comment's
-  if(cx->cfg_lkw && cx->cfg_lkw_lineno == lineno)
+  if(avr_db.cfg_lkw && avr_db.cfg_lkw_lineno == lineno)
     addcomment(1);              // Register comms to show right of lkw = ...;
 }
 
 // Capture assignments (keywords left of =) and associate comments to them
 void capture_lvalue_kw(const char *kw, int lineno) {
   if(str_eq(kw, "memory")) {    // Push part comments and start memory comments
-    if(!cx->cfg_pushed) {       // config_gram.y pops the part comments
-      cx->cfg_pushed = 1;
-      cx->cfg_pushedcomms = cx->cfg_strctcomms;
-      cx->cfg_strctcomms = NULL;
+    if(!avr_db.cfg_pushed) {       // config_gram.y pops the part comments
+      avr_db.cfg_pushed = 1;
+      avr_db.cfg_pushedcomms = avr_db.cfg_strctcomms;
+      avr_db.cfg_strctcomms = NULL;
     }
   }
 
   if(str_eq(kw, "programmer") || str_eq(kw, "serialadapter") || str_eq(kw, "part") || str_eq(kw, "memory"))
     kw = "*";                   // Show comment before programmer/part/memory
 
-  if(cx->cfg_lkw)
-    mmt_free(cx->cfg_lkw);
-  cx->cfg_lkw = mmt_strdup(kw);
-  cx->cfg_lkw_lineno = lineno;
-  if(cx->cfg_comms)             // Accrued list of # one-line comments
+  if(avr_db.cfg_lkw)
+    mmt_free(avr_db.cfg_lkw);
+  avr_db.cfg_lkw = mmt_strdup(kw);
+  avr_db.cfg_lkw_lineno = lineno;
+  if(avr_db.cfg_comms)             // Accrued list of # one-line comments
     addcomment(0);              // Register comment to appear before lkw assignment
 }
 
@@ -564,17 +1117,17 @@ void capture_lvalue_kw(const char *kw, int lineno) {
 LISTID cfg_move_comments(void) {
   capture_lvalue_kw(";", -1);
 
-  LISTID ret = cx->cfg_strctcomms;
+  LISTID ret = avr_db.cfg_strctcomms;
 
-  cx->cfg_strctcomms = NULL;
+  avr_db.cfg_strctcomms = NULL;
   return ret;
 }
 
 // config_gram.y calls this after ingressing the memory structure
 void cfg_pop_comms(void) {
-  if(cx->cfg_pushed) {
-    cx->cfg_pushed = 0;
-    cx->cfg_strctcomms = cx->cfg_pushedcomms;
+  if(avr_db.cfg_pushed) {
+    avr_db.cfg_pushed = 0;
+    avr_db.cfg_strctcomms = avr_db.cfg_pushedcomms;
   }
 }
 
@@ -958,8 +1511,10 @@ static int cmp_comp(const void *v1, const void *v2) {
 Component *cfg_comp_search(const char *name, int strct) {
   Component key;
 
-  if(!cx->cfg_init_search++)
+  avr_db_lock();
+  if(!avr_db.cfg_init_search++)
     qsort(avr_comp, sizeof avr_comp/sizeof *avr_comp, sizeof(Component), cmp_comp);
+  avr_db_unlock();
 
   key.name = name;
   key.strct = strct;
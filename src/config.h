@@ -155,6 +155,18 @@ extern "C" {
 
   void cfg_update_mcuid(AVRPART *part);
 
+  int cfg_cache_load(const char *file);
+
+  void cfg_cache_save(const char *file, int was_empty);
+
+  int cfg_cache_enabled(const char *file);
+
+  char *cfg_cache_dir(void);
+
+  int cfg_lazy_parents(const char *file, LISTID names);
+
+  const char *cfg_builtin(size_t *lenp);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,165 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cost model for choosing between equivalent programming strategies
+ *
+ * Whether a differential write beats rewriting all pages, or whether a
+ * device-side range check beats reading back, depends on the programmer,
+ * its connection and the part. So avr.c measures every paged read, paged
+ * write, page erase and pgm->verify_range() call and notes its duration
+ * and size with costmodel_note(); differential writes note with
+ * costmodel_compared() how many of the pages read from the device differed
+ * from the input. Measurements are kept per memory class (flash, EEPROM,
+ * others) and include those of the terminal's bench command, which uses
+ * the same paged accessors.
+ *
+ * If the target cache is in use (see tgtcache.c), costmodel_open() adds the
+ * measurements of earlier sessions with the same target and
+ * costmodel_close() saves the accumulated ones, scaled down once they cover
+ * more than COST_KEEPOPS operations so that recent sessions weigh more.
+ * do_op() asks costmodel_us() for the predicted time of alternative
+ * strategies; it keeps the default strategy while the cost of an access
+ * kind has not been measured often enough for a prediction.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+#define COST_KEEPOPS   1000     // Older measurements are scaled down beyond this many operations
+#define COST_MINOPS       2     // Operations needed for a prediction ...
+#define COST_MINBYTES   256     // ... and bytes
+#define COST_MINPAGES     8     // Pages compared before the share of changed pages is trusted
+
+static const char *cost_kinds[COST_N] = { "read", "write", "erase", "crc" };
+static const char *cost_classes[COST_NCLASS] = { "flash", "eeprom", "other" };
+
+static int cost_class(const AVRMEM *mem) {
+  return mem_is_in_flash(mem)? 0: mem_is_eeprom(mem)? 1: 2;
+}
+
+// Add the measurements that earlier sessions saved for the current target
+void costmodel_open(void) {
+  const char *val;
+
+  if(cx->cst_open)
+    return;
+  cx->cst_open = 1;
+  for(int k = 0; k < COST_N; k++)
+    for(int c = 0; c < COST_NCLASS; c++) {
+      Cost_stat *st = &cx->cst_stats[k][c];
+      double us, bytes, ops;
+
+      if((val = tgtcache_get(str_ccprintf("cost-%s-%s", cost_kinds[k], cost_classes[c]))) &&
+        sscanf(val, "%lf %lf %lf", &us, &bytes, &ops) == 3 && us >= 0 && bytes >= 0 && ops >= 0) {
+        st->us += us;
+        st->bytes += bytes;
+        st->ops += ops;
+      }
+    }
+  for(int c = 0; c < COST_NCLASS; c++) {
+    double cmp, chg;
+
+    if((val = tgtcache_get(str_ccprintf("cost-changed-%s", cost_classes[c]))) &&
+      sscanf(val, "%lf %lf", &cmp, &chg) == 2 && cmp >= 0 && chg >= 0 && chg <= cmp) {
+      cx->cst_compared[c] += cmp;
+      cx->cst_changed[c] += chg;
+    }
+  }
+}
+
+// An access of kind to nbytes of mem took us microseconds
+void costmodel_note(Cost_kind kind, const AVRMEM *mem, long nbytes, uint64_t us) {
+  if(kind < 0 || kind >= COST_N || !mem || nbytes <= 0)
+    return;
+  Cost_stat *st = &cx->cst_stats[kind][cost_class(mem)];
+
+  st->us += us;
+  st->bytes += nbytes;
+  st->ops++;
+}
+
+// A differential write read a page of mem from the device; changed is set if it differed from the input
+void costmodel_compared(const AVRMEM *mem, int changed) {
+  int c = cost_class(mem);
+
+  cx->cst_compared[c]++;
+  if(changed)
+    cx->cst_changed[c]++;
+}
+
+// Predicted time in us for an access of kind to nbytes of mem or -1 if not known
+double costmodel_us(Cost_kind kind, const AVRMEM *mem, long nbytes) {
+  if(kind < 0 || kind >= COST_N || !mem)
+    return -1;
+  const Cost_stat *st = &cx->cst_stats[kind][cost_class(mem)];
+
+  if(st->ops < COST_MINOPS || st->bytes < COST_MINBYTES)
+    return -1;
+
+  return st->us*nbytes/st->bytes;
+}
+
+// Expected share of pages of mem that differ from the input in a differential write
+double costmodel_changed(const AVRMEM *mem) {
+  int c = cost_class(mem);
+
+  return cx->cst_compared[c] < COST_MINPAGES? 1.0: cx->cst_changed[c]/cx->cst_compared[c];
+}
+
+// Save the measurements for the current target in the target cache
+void costmodel_close(void) {
+  if(!cx->cst_open)
+    return;
+  for(int k = 0; k < COST_N; k++)
+    for(int c = 0; c < COST_NCLASS; c++) {
+      Cost_stat *st = &cx->cst_stats[k][c];
+
+      if(st->ops < 1)
+        continue;
+      if(st->ops > COST_KEEPOPS) {
+        double f = COST_KEEPOPS/st->ops;
+
+        st->us *= f;
+        st->bytes *= f;
+        st->ops = COST_KEEPOPS;
+      }
+      tgtcache_put(str_ccprintf("cost-%s-%s", cost_kinds[k], cost_classes[c]),
+        str_ccprintf("%.0f %.0f %.0f", st->us, st->bytes, st->ops));
+    }
+  for(int c = 0; c < COST_NCLASS; c++) {
+    if(cx->cst_compared[c] < 1)
+      continue;
+    if(cx->cst_compared[c] > COST_KEEPOPS) {
+      cx->cst_changed[c] *= COST_KEEPOPS/cx->cst_compared[c];
+      cx->cst_compared[c] = COST_KEEPOPS;
+    }
+    tgtcache_put(str_ccprintf("cost-changed-%s", cost_classes[c]),
+      str_ccprintf("%.0f %.0f", cx->cst_compared[c], cx->cst_changed[c]));
+  }
+  memset(cx->cst_stats, 0, sizeof cx->cst_stats);
+  memset(cx->cst_compared, 0, sizeof cx->cst_compared);
+  memset(cx->cst_changed, 0, sizeof cx->cst_changed);
+  cx->cst_open = 0;
+}
@@ -2,6 +2,13 @@
  * Derived from CRC algorithm for JTAG ICE mkII, published in Atmel Appnote
  * AVR067. Converted from C++ to C.
  */
+#include <ac_cfg.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#include <pthread.h>
+#define CRC_THREADS 1
+#endif
+
 #include "crc16.h"
 
 // CRC16 Definitions
@@ -44,12 +51,94 @@ static const unsigned short crc_table[256] = {
 #define CRC_INIT 0xFFFF
 #define CRC(crcval, newchar) ((crcval) = (crcval>>8) ^ crc_table[((crcval) ^ (newchar)) & 0x00ff])
 
+/*
+ * Slice-by-8 tables: crc16_slice[k][b] and crc32_slice[k][b] advance the CRC
+ * of byte b by k further zero bytes; filled in once on first use, row 0 of
+ * the CRC-16 tables being crc_table itself
+ */
+static unsigned short crc16_slice[8][256];
+static unsigned long crc32_slice[8][256];
+
+static void crc16_init_slices(void) {
+  for(int i = 0; i < 256; i++)
+    crc16_slice[0][i] = crc_table[i];
+  for(int k = 1; k < 8; k++)
+    for(int i = 0; i < 256; i++)
+      crc16_slice[k][i] = (crc16_slice[k-1][i] >> 8) ^ crc_table[crc16_slice[k-1][i] & 0xff];
+}
+
 unsigned short crcsum(const unsigned char *message, unsigned long length, unsigned short crc) {
-  unsigned long i;
+#ifdef CRC_THREADS
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once(&once, crc16_init_slices);
+#else
+  if(!crc16_slice[1][1])
+    crc16_init_slices();
+#endif
+
+  // Eight bytes per round, then the remainder byte by byte
+  for(; length >= 8; length -= 8, message += 8) {
+    unsigned x = crc ^ (message[0] | message[1] << 8);
+
+    crc = crc16_slice[7][x & 0xff] ^ crc16_slice[6][x >> 8] ^
+      crc16_slice[5][message[2]] ^ crc16_slice[4][message[3]] ^
+      crc16_slice[3][message[4]] ^ crc16_slice[2][message[5]] ^
+      crc16_slice[1][message[6]] ^ crc16_slice[0][message[7]];
+  }
+  while(length--)
+    CRC(crc, *message++);
+
+  return crc;
+}
+
+// CRC-32 (IEEE 802.3) as computed by the AVR CRCSCAN and XMEGA CRC modules
+static void crc32_init_slices(void) {
+  for(unsigned long i = 0; i < 256; i++) {
+    unsigned long c = i;
 
-  for(i = 0; i < length; i++) {
-    CRC(crc, message[i]);
+    for(int j = 0; j < 8; j++)
+      c = c & 1? (c >> 1) ^ 0xEDB88320UL: c >> 1;
+    crc32_slice[0][i] = c;
   }
+  for(int k = 1; k < 8; k++)
+    for(int i = 0; i < 256; i++)
+      crc32_slice[k][i] = (crc32_slice[k-1][i] >> 8) ^ crc32_slice[0][crc32_slice[k-1][i] & 0xff];
+}
+
+unsigned long crc32sum(const unsigned char *message, unsigned long length, unsigned long crc) {
+#ifdef CRC_THREADS
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once(&once, crc32_init_slices);
+#else
+  if(!crc32_slice[0][1])
+    crc32_init_slices();
+#endif
+
+  crc = ~crc & 0xffffffffUL;
+  for(; length >= 8; length -= 8, message += 8) {
+    unsigned long x = crc ^ (message[0] | message[1] << 8 | message[2] << 16 | (unsigned long) message[3] << 24);
+
+    crc = crc32_slice[7][x & 0xff] ^ crc32_slice[6][(x >> 8) & 0xff] ^
+      crc32_slice[5][(x >> 16) & 0xff] ^ crc32_slice[4][x >> 24] ^
+      crc32_slice[3][message[4]] ^ crc32_slice[2][message[5]] ^
+      crc32_slice[1][message[6]] ^ crc32_slice[0][message[7]];
+  }
+  while(length--)
+    crc = (crc >> 8) ^ crc32_slice[0][(crc ^ *message++) & 0xff];
+
+  return ~crc & 0xffffffffUL;
+}
+
+// 24-bit CRC with polynomial 0x80001B, MSB first, as the XMEGA NVM controller's range CRC
+unsigned long crc24sum(const unsigned char *message, unsigned long length, unsigned long crc) {
+  for(; length--; message++) {
+    crc ^= (unsigned long) *message << 16;
+    for(int j = 0; j < 8; j++)
+      crc = (crc & 0x800000? (crc << 1) ^ 0x80001BUL: crc << 1) & 0xffffffUL;
+  }
+
   return crc;
 }
 
@@ -17,6 +17,12 @@ extern "C" {
    */
   extern void crcappend(unsigned char *message, unsigned long length);
 
+  // CRC-32 (IEEE 802.3); start with crc = 0, feed back the result to continue
+  extern unsigned long crc32sum(const unsigned char *message, unsigned long length, unsigned long crc);
+
+  // 24-bit CRC (polynomial 0x80001B, initial value 0, no reflection)
+  extern unsigned long crc24sum(const unsigned char *message, unsigned long length, unsigned long crc);
+
 #ifdef __cplusplus
 }
 #endif
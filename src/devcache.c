@@ -0,0 +1,305 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Persistent cache of device flash contents
+ *
+ * Development loops read and write the same board over and over again. If
+ * the user has created the directory devices in the cache directory (see
+ * confcache.c), devcache_open() looks up the flash contents that an earlier
+ * session left on the device, which is identified by its signature and its
+ * serial number; parts without a readable sernum memory are not cached.
+ *
+ * The cache knows a flash page if it has been read from or erased on the
+ * device; paged writes, byte writes and page erases make their pages
+ * unknown, which the read-back of the ensuing verification normally turns
+ * into known again. Cached pages of an earlier session are only used once
+ * the programmer has confirmed all of them on the device (see
+ * pgm->verify_range); as differential writes skip pages on the strength of
+ * the cache, reading back a few sample pages would not be good enough. If
+ * the confirmation fails or is not available the cache forgets all pages,
+ * which then become known again as the session reads or erases them. Known
+ * pages are served by devcache_page() to the terminal's flash cache (see
+ * avrcache.c) and to differential writes, which then need not read these
+ * pages from the device. devcache_close() saves the known pages for the
+ * next session.
+ *
+ * Cache files have a header line "avrdude devcache <size> <page size>"
+ * followed by a bitmap of known pages and the flash image.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+#include "config.h"
+
+#define dc_known(k) page_is_allocated(cx->dvc_known, k)
+#define dc_npages (cx->dvc_size/cx->dvc_pgsize)
+
+// Name of the cache file for key if the user has created a devices cache directory, NULL otherwise
+static char *devcache_filename(const char *key) {
+  char *dir = cfg_cache_dir(), *ret = NULL;
+  struct stat sb;
+
+  if(dir) {
+    char *ddir = mmt_sprintf("%s/devices", dir);
+
+    if(stat(ddir, &sb) >= 0 && (sb.st_mode & S_IFDIR))
+      ret = key? mmt_sprintf("%s/%s", ddir, key): mmt_strdup(ddir);
+    mmt_free(ddir);
+    mmt_free(dir);
+  }
+
+  return ret;
+}
+
+static void devcache_free(void) {
+  mmt_free(cx->dvc_key);
+  mmt_free(cx->dvc_image);
+  mmt_free(cx->dvc_known);
+  cx->dvc_key = NULL;
+  cx->dvc_image = NULL;
+  cx->dvc_known = NULL;
+}
+
+// Key of the device: signature and serial number in hex, NULL if there is no readable serial number
+static char *devcache_key(const PROGRAMMER *pgm, const AVRPART *p) {
+  const AVRMEM *sig = avr_locate_signature(p), *sn = avr_locate_sernum(p);
+
+  if(!sig || !sig->buf || !sn || sn->size < 1 || !pgm->read_byte)
+    return NULL;
+
+  char *key = mmt_malloc(2*sig->size + 1 + 2*sn->size + 1), *s = key;
+
+  for(int i = 0; i < sig->size; i++, s += 2)
+    sprintf(s, "%02x", sig->buf[i]);
+  *s++ = '-';
+  for(int i = 0; i < sn->size; i++, s += 2) {
+    unsigned char b;
+
+    if(pgm->read_byte(pgm, p, sn, i, &b) < 0) {
+      mmt_free(key);
+      return NULL;
+    }
+    sprintf(s, "%02x", b);
+  }
+
+  return key;
+}
+
+static int devcache_load(const char *fname) {
+  FILE *f = fopen(fname, "rb");
+  int size, pgsize, ret = -1;
+
+  if(!f)
+    return -1;
+  if(fscanf(f, "avrdude devcache %d %d", &size, &pgsize) == 2 && fgetc(f) == '\n' &&
+    size == cx->dvc_size && pgsize == cx->dvc_pgsize &&
+    fread(cx->dvc_known, 1, dc_npages/8 + 1, f) == (size_t) dc_npages/8 + 1 &&
+    fread(cx->dvc_image, 1, size, f) == (size_t) size)
+    ret = 0;
+  fclose(f);
+  if(ret < 0)
+    memset(cx->dvc_known, 0, dc_npages/8 + 1);
+
+  return ret;
+}
+
+// Does the device still hold the known pages? 1: yes, 0: no, < 0: cannot tell
+static int devcache_validate(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *flash) {
+  int k, n, nknown = 0, rc = -1;
+
+  for(k = 0; k < dc_npages; k++)
+    nknown += dc_known(k);
+  if(!nknown)
+    return 1;
+  if(!pgm->verify_range)
+    return -1;
+
+  for(k = 0; k < dc_npages; k = n) { // Confirm runs of known pages on the device
+    if(!dc_known(k)) {
+      n = k + 1;
+      continue;
+    }
+    for(n = k; n < dc_npages && dc_known(n); n++)
+      continue;
+    int addr = k*cx->dvc_pgsize, len = (n - k)*cx->dvc_pgsize;
+
+    if((rc = pgm->verify_range(pgm, p, flash, addr, len, cx->dvc_image + addr)) != 1)
+      break;
+  }
+
+  return rc;
+}
+
+/*
+ * Look up the cached flash contents of the device the programmer is
+ * connected to and revalidate them; returns the number of known pages or -1
+ * if the device cache is not in use
+ */
+int devcache_open(const PROGRAMMER *pgm, const AVRPART *p) {
+  AVRMEM *flash = avr_locate_flash(p);
+  char *fname, *key;
+
+  devcache_free();
+  if(!(fname = devcache_filename(NULL)))
+    return -1;
+  mmt_free(fname);
+  if(!flash || flash->page_size < 2 || flash->size%flash->page_size || !avr_has_paged_access(pgm, p, flash))
+    return -1;
+  if(!(key = devcache_key(pgm, p))) {
+    pmsg_notice("not using device cache as the serial number of %s cannot be read\n", p->desc);
+    return -1;
+  }
+
+  cx->dvc_key = key;
+  cx->dvc_size = flash->size;
+  cx->dvc_pgsize = flash->page_size;
+  cx->dvc_offset = flash->offset;
+  cx->dvc_image = mmt_malloc(cx->dvc_size);
+  cx->dvc_known = mmt_malloc(dc_npages/8 + 1);
+
+  fname = devcache_filename(key);
+  if(devcache_load(fname) < 0) {
+    mmt_free(fname);
+    pmsg_notice2("no device cache for %s yet\n", key);
+    return 0;
+  }
+  mmt_free(fname);
+
+  int rc = devcache_validate(pgm, p, flash), n = 0;
+
+  if(rc != 1) {
+    if(rc < 0)
+      pmsg_notice("cannot confirm device cache %s on the device; forgetting it\n", key);
+    else
+      pmsg_notice("device cache %s is out of date; forgetting it\n", key);
+    memset(cx->dvc_known, 0, dc_npages/8 + 1);
+    return 0;
+  }
+  for(int k = 0; k < dc_npages; k++)
+    n += dc_known(k);
+  pmsg_notice("device cache %s knows %d flash page%s\n", key, n, str_plural(n));
+
+  return n;
+}
+
+// Map [addr, addr+n) of mem to flash addresses; returns 0 if mem is not in cached flash
+static int devcache_map(const AVRMEM *mem, int *addrp, int *np) {
+  if(!cx->dvc_image || !mem_is_in_flash(mem))
+    return 0;
+
+  int addr = (int) (mem->offset - cx->dvc_offset) + *addrp, n = *np;
+
+  if(addr < 0) {
+    n += addr;
+    addr = 0;
+  }
+  if(n > cx->dvc_size - addr)
+    n = cx->dvc_size - addr;
+  *addrp = addr;
+  *np = n;
+
+  return n > 0;
+}
+
+// Known device contents of the page at addr of mem, NULL if not known
+const unsigned char *devcache_page(const AVRMEM *mem, int addr) {
+  int n = mem->page_size;
+
+  if(mem->page_size != cx->dvc_pgsize || !devcache_map(mem, &addr, &n))
+    return NULL;
+
+  return addr%cx->dvc_pgsize == 0 && n == cx->dvc_pgsize && dc_known(addr/cx->dvc_pgsize)?
+    cx->dvc_image + addr: NULL;
+}
+
+// The device holds data in [addr, addr+n) of mem, eg, after reading them
+void devcache_update(const AVRMEM *mem, int addr, int n, const unsigned char *data) {
+  int from = addr;
+
+  if(!devcache_map(mem, &addr, &n))
+    return;
+  data += addr - (int) (mem->offset - cx->dvc_offset) - from;
+  memcpy(cx->dvc_image + addr, data, n);
+  // Only pages that are wholly covered become known
+  for(int k = (addr + cx->dvc_pgsize - 1)/cx->dvc_pgsize; (k + 1)*cx->dvc_pgsize <= addr + n; k++)
+    cx->dvc_known[k/8] |= 1 << (k%8);
+}
+
+// Device contents in [addr, addr+n) of mem may have changed; n < 0 means all of flash
+void devcache_forget(const AVRMEM *mem, int addr, int n) {
+  if(!cx->dvc_image)
+    return;
+  if(n < 0 || !mem) {
+    memset(cx->dvc_known, 0, dc_npages/8 + 1);
+    return;
+  }
+  if(!devcache_map(mem, &addr, &n))
+    return;
+  for(int k = addr/cx->dvc_pgsize; k*cx->dvc_pgsize < addr + n; k++)
+    cx->dvc_known[k/8] &= ~(1 << (k%8));
+}
+
+// Flash has been erased
+void devcache_erased(void) {
+  if(!cx->dvc_image)
+    return;
+  memset(cx->dvc_image, 0xff, cx->dvc_size);
+  memset(cx->dvc_known, 0xff, dc_npages/8 + 1);
+}
+
+// Save the known pages for the next session and free the cache; returns -1 on error
+int devcache_close(void) {
+  int rc = 0;
+
+  if(cx->dvc_image) {
+    char *fname = devcache_filename(cx->dvc_key), *tmp;
+    FILE *f;
+
+    if(fname) {
+      tmp = mmt_sprintf("%s.%ld", fname, (long) getpid());
+      if((f = fopen(tmp, "wb"))) {
+        fprintf(f, "avrdude devcache %d %d\n", cx->dvc_size, cx->dvc_pgsize);
+        fwrite(cx->dvc_known, 1, dc_npages/8 + 1, f);
+        fwrite(cx->dvc_image, 1, cx->dvc_size, f);
+        if(ferror(f) | (fclose(f) == EOF) || rename(tmp, fname) < 0) {
+          pmsg_warning("cannot update device cache %s: %s\n", fname, strerror(errno));
+          unlink(tmp);
+          rc = -1;
+        }
+      } else {
+        pmsg_warning("cannot create device cache %s: %s\n", tmp, strerror(errno));
+        rc = -1;
+      }
+      mmt_free(tmp);
+      mmt_free(fname);
+    }
+  }
+  devcache_free();
+
+  return rc;
+}
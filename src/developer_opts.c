@@ -52,6 +52,11 @@
 #include "developer_opts_private.h"
 #include "usbdevs.h"
 
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#define DEV_THREADS 1
+#include <pthread.h>
+#endif
+
 // Inject part parameters into a semi-automated rewrite of avrdude.conf
 //  - Add entries to the tables below; they get written on -p*/si or -c*/si
 //  - Use the output in a new avrdude.conf
@@ -79,7 +84,7 @@ static struct {
   {NULL, NULL, NULL, NULL},
 };
 
-// Return 0 if op code would encode (essentially) the same SPI command
+// Return 0 if op code would encode (essentially) the same SPI command; only looks at bit[]
 static int opcodecmp(const OPCODE *op1, const OPCODE *op2, int opnum) {
   char *opstr1, *opstr2, *p;
   int cmp;
@@ -130,7 +135,7 @@ static void printallopcodes(const AVRPART *p, const char *d, OPCODE *const *opa)
 }
 
 static char *extra_features_str(int m) {
-  static char mode[1024];
+  static LIBAVRDUDE_THREAD_LOCAL char mode[1024];
 
   strcpy(mode, "0");
   if(m & HAS_SUFFER)
@@ -213,7 +218,13 @@ static char *dev_sprintf(const char *fmt, ...) {
   return p;
 }
 
-static int dev_nprinted;
+typedef struct {                // Output collected by a worker thread
+  char *buf;
+  size_t len, size;
+} Dev_outbuf;
+
+static LIBAVRDUDE_THREAD_LOCAL int dev_nprinted;
+static LIBAVRDUDE_THREAD_LOCAL Dev_outbuf *dev_out; // Print into this buffer rather than stdout
 
 #if defined(__GNUC__)
 __attribute__((format(printf, 2, 3)))
@@ -224,7 +235,18 @@ int dev_message(int msglvl, const char *fmt, ...) {
 
   if(verbose >= msglvl) {
     va_start(ap, fmt);
-    rc = vfprintf(stdout, fmt, ap);
+    if(!dev_out)
+      rc = vfprintf(stdout, fmt, ap);
+    else if((rc = vsnprintf(NULL, 0, fmt, ap)) > 0) {
+      if(dev_out->len + rc + 1 > dev_out->size) {
+        dev_out->size = 2*(dev_out->len + rc + 1);
+        dev_out->buf = mmt_realloc(dev_out->buf, dev_out->size);
+      }
+      va_end(ap);
+      va_start(ap, fmt);
+      vsnprintf(dev_out->buf + dev_out->len, rc + 1, fmt, ap);
+      dev_out->len += rc;
+    }
     va_end(ap);
     if(rc > 0)
       dev_nprinted += rc;
@@ -345,6 +367,14 @@ static int boolcmp(int a, int b) {
 
 // Deep copies for comparison and raw output
 
+// Only the bit[] specs of an opcode, not the compiled form of avr_compile_opcode()
+#define OPCODE_RAWSIZE offsetof(OPCODE, compiled)
+
+static void opcode_raw_copy(OPCODE *d, const OPCODE *op) {
+  memset(d, 0, sizeof *d);
+  memcpy(d, op, OPCODE_RAWSIZE);
+}
+
 typedef struct {
   char descbuf[32];
   AVRMEM base;
@@ -370,7 +400,7 @@ static int avrmem_deep_copy(AVRMEMdeep *d, const AVRMEM *m) {
   memset(d->ops, 0, sizeof d->ops);
   for(size_t i = 0; i < AVR_OP_MAX; i++)
     if(m->op[i]) {
-      d->ops[i] = *m->op[i];
+      opcode_raw_copy(d->ops + i, m->op[i]);
       for(int b = 0; b < 32; b++) {     // Replace x with 0 as they are treated the same
         if(d->ops[i].bit[b].type == AVR_CMDBIT_IGNORE) {
           d->ops[i].bit[b].type = AVR_CMDBIT_VALUE;
@@ -446,6 +476,7 @@ static int avrpart_deep_copy(AVRPARTdeep *d, const AVRPART *p) {
   d->base.family_id = NULL;
   d->base.mem = NULL;
   d->base.mem_alias = NULL;
+  d->base.mem_index = NULL;
   d->base.variants = NULL;
   for(int i = 0; i < AVR_OP_MAX; i++)
     d->base.op[i] = NULL;
@@ -453,7 +484,7 @@ static int avrpart_deep_copy(AVRPARTdeep *d, const AVRPART *p) {
   // Copy over all used SPI operations
   for(int i = 0; i < AVR_OP_MAX; i++)
     if(p->op[i])
-      d->ops[i] = *p->op[i];
+      opcode_raw_copy(d->ops + i, p->op[i]);
 
   // Fill in all memories we got in defined order
   di = 0;
@@ -498,11 +529,8 @@ static void dev_raw_dump(const void *v, int nbytes, const char *name, const char
   }
 }
 
-static char *opsnm(const char *pre, int opnum) {
-  static char ret[128];
-
-  sprintf(ret, "%.31s.%.95s", pre, opcodename(opnum));
-  return ret;
+static const char *opsnm(const char *pre, int opnum) {
+  return str_ccprintf("%.31s.%.95s", pre, opcodename(opnum));
 }
 
 static void dev_part_raw(const AVRPART *part) {
@@ -512,8 +540,8 @@ static void dev_part_raw(const AVRPART *part) {
   dev_raw_dump(&dp, (char *) &dp.base - (char *) &dp, part->desc, "part.intro", 0);
   dev_raw_dump(&dp.base, sizeof dp.base, part->desc, "part", 0);
   for(int i = 0; i < AVR_OP_MAX; i++)
-    if(!is_memset(dp.ops + i, 0, sizeof *dp.ops))
-      dev_raw_dump(dp.ops + i, sizeof *dp.ops, part->desc, opsnm("part", i), 1);
+    if(!is_memset(dp.ops + i, 0, OPCODE_RAWSIZE))
+      dev_raw_dump(dp.ops + i, OPCODE_RAWSIZE, part->desc, opsnm("part", i), 1);
 
   for(int i = 0; i < di; i++) {
     char *nm = dp.mems[i].descbuf;
@@ -521,8 +549,8 @@ static void dev_part_raw(const AVRPART *part) {
     dev_raw_dump(nm, sizeof dp.mems[i].descbuf, part->desc, nm, i + 2);
     dev_raw_dump(&dp.mems[i].base, sizeof dp.mems[i].base, part->desc, nm, i + 2);
     for(int j = 0; j < AVR_OP_MAX; j++)
-      if(!is_memset(dp.mems[i].ops + j, 0, sizeof(OPCODE)))
-        dev_raw_dump(dp.mems[i].ops + j, sizeof(OPCODE), part->desc, opsnm(nm, j), i + 2);
+      if(!is_memset(dp.mems[i].ops + j, 0, OPCODE_RAWSIZE))
+        dev_raw_dump(dp.mems[i].ops + j, OPCODE_RAWSIZE, part->desc, opsnm(nm, j), i + 2);
   }
 }
 
@@ -901,12 +929,337 @@ static const Avrintel *silent_locate_uP(const AVRPART *p) {
   return idx < 0? NULL: uP_table + idx;
 }
 
+typedef struct {                // What dev_output_part_defs() prints about each part
+  bool cmdok, waits, opspi, descs, vtabs, confs, regis, astrc, strct, cmpst, injct, raw, all, tsv;
+} Dev_partflags;
+
+typedef struct {                // A part to be printed by dev_part_defs()
+  const AVRPART *p, *base;      // Part and what its /s, /S or /A entry is compared against
+  const Avrintel *up;           // Its uP_table entry if flags need it
+  Dev_outbuf out;               // Output if formatted by a worker thread
+} Dev_partjob;
+
+// Print what the flags ask for about one part
+static void dev_part_defs(const Dev_partflags *f, const Dev_partjob *j) {
+  const AVRPART *p = j->p;
+  const Avrintel *up = j->up;
+  bool cmdok = f->cmdok, waits = f->waits, opspi = f->opspi, descs = f->descs, vtabs = f->vtabs,
+    confs = f->confs, regis = f->regis, all = f->all, tsv = f->tsv;
+  int flashsize, flashoffset, flashpagesize, eepromsize, eepromoffset, eeprompagesize;
+
+  if(f->astrc || f->strct || f->cmpst)
+    dev_part_strct(p, tsv, j->base, f->injct);
+
+  if(f->raw)
+    dev_part_raw(p);
+
+  // Identify core flash and eeprom parameters
+
+  flashsize = flashoffset = flashpagesize = eepromsize = eepromoffset = eeprompagesize = 0;
+  if(p->mem) {
+    for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
+      AVRMEM *m = ldata(lnm);
+
+      if(!flashsize && mem_is_flash(m)) {
+        flashsize = m->size;
+        flashpagesize = m->page_size;
+        flashoffset = m->offset;
+      }
+      if(!eepromsize && mem_is_eeprom(m)) {
+        eepromsize = m->size;
+        eepromoffset = m->offset;
+        eeprompagesize = m->page_size;
+      }
+    }
+  }
+  // "Real" entries don't seem to have a space in their desc (a bit hackey)
+  if(flashsize && !strchr(p->desc, ' ')) {
+    int ok, nfuses;
+    AVRMEM *m;
+    OPCODE *oc;
+
+    ok = 2047;
+    nfuses = 0;
+
+    if(!p->op[AVR_OP_PGM_ENABLE])
+      ok &= ~DEV_SPI_EN_CE_SIG;
+
+    if(!p->op[AVR_OP_CHIP_ERASE])
+      ok &= ~DEV_SPI_EN_CE_SIG;
+
+    if((m = avr_locate_flash(p))) {
+      if((oc = m->op[AVR_OP_LOAD_EXT_ADDR])) {
+        // @@@ to do: check whether address is put at lsb of third byte
+      } else
+        ok &= ~DEV_SPI_LOAD_EXT_ADDR;
+
+      if((oc = m->op[AVR_OP_READ_HI])) {
+        if(cmdok)
+          checkaddr(m->size >> 1, 1, AVR_OP_READ_HI, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM;
+
+      if((oc = m->op[AVR_OP_READ_LO])) {
+        if(cmdok)
+          checkaddr(m->size >> 1, 1, AVR_OP_READ_LO, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM;
+
+      if((oc = m->op[AVR_OP_WRITE_HI])) {
+        if(cmdok)
+          checkaddr(m->size >> 1, 1, AVR_OP_WRITE_HI, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM;
+
+      if((oc = m->op[AVR_OP_WRITE_LO])) {
+        if(cmdok)
+          checkaddr(m->size >> 1, 1, AVR_OP_WRITE_LO, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM;
+
+      if((oc = m->op[AVR_OP_LOADPAGE_HI])) {
+        if(cmdok)
+          checkaddr(m->page_size >> 1, 1, AVR_OP_LOADPAGE_HI, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM_PAGED;
+
+      if((oc = m->op[AVR_OP_LOADPAGE_LO])) {
+        if(cmdok)
+          checkaddr(m->page_size >> 1, 1, AVR_OP_LOADPAGE_LO, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM_PAGED;
+
+      if((oc = m->op[AVR_OP_WRITEPAGE])) {
+        if(cmdok)
+          checkaddr(m->size >> 1, m->page_size >> 1, AVR_OP_WRITEPAGE, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_PROGMEM_PAGED;
+    } else
+      ok &= ~(DEV_SPI_PROGMEM_PAGED | DEV_SPI_PROGMEM);
+
+    if((m = avr_locate_eeprom(p))) {
+      if((oc = m->op[AVR_OP_READ])) {
+        if(cmdok)
+          checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_EEPROM;
+
+      if((oc = m->op[AVR_OP_WRITE])) {
+        if(cmdok)
+          checkaddr(m->size, 1, AVR_OP_WRITE, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_EEPROM;
+
+      if((oc = m->op[AVR_OP_LOADPAGE_LO])) {
+        if(cmdok)
+          checkaddr(m->page_size, 1, AVR_OP_LOADPAGE_LO, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_EEPROM_PAGED;
+
+      if((oc = m->op[AVR_OP_WRITEPAGE])) {
+        if(cmdok)
+          checkaddr(m->size, m->page_size, AVR_OP_WRITEPAGE, oc, p, m);
+      } else
+        ok &= ~DEV_SPI_EEPROM_PAGED;
+    } else
+      ok &= ~(DEV_SPI_EEPROM_PAGED | DEV_SPI_EEPROM);
+
+    if((m = avr_locate_signature(p)) && (oc = m->op[AVR_OP_READ])) {
+      if(cmdok)
+        checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
+    } else
+      ok &= ~DEV_SPI_EN_CE_SIG;
+
+    if((m = avr_locate_calibration(p)) && (oc = m->op[AVR_OP_READ])) {
+      if(cmdok)
+        checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
+    } else
+      ok &= ~DEV_SPI_CALIBRATION;
+
+    // Actually, some AT90S... parts cannot read, only write lock bits :-0
+    if(!((m = avr_locate_lock(p)) && m->op[AVR_OP_WRITE]))
+      ok &= ~DEV_SPI_LOCK;
+
+    if((m = avr_locate_fuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
+      nfuses++;
+    else
+      ok &= ~DEV_SPI_LFUSE;
+
+    if((m = avr_locate_hfuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
+      nfuses++;
+    else
+      ok &= ~DEV_SPI_HFUSE;
+
+    if((m = avr_locate_efuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
+      nfuses++;
+    else
+      ok &= ~DEV_SPI_EFUSE;
+
+    if(descs) {
+      int len = 16 - strlen(p->desc);
+
+      dev_info
+        ("%s '%s' =>%*s [0x%02X, 0x%02X, 0x%02X, 0x%08x, 0x%05x, 0x%03x, "
+         "0x%06x, 0x%04x, 0x%03x, %d, 0x%03x, 0x%04x, '%s'], # %s %d\n",
+        tsv || all? ".desc": "   ",
+        p->desc, len > 0? len: 0, "",
+        p->signature[0], p->signature[1], p->signature[2],
+        flashoffset, flashsize, flashpagesize, eepromoffset, eepromsize, eeprompagesize, nfuses, ok, p->flags,
+        dev_prog_modes(p->prog_modes), p->config_file, p->lineno);
+    }
+
+    if(vtabs && up && up->isrtable)
+      for(int i = 0; i < up->ninterrupts; i++)
+        dev_info(".vtab\t%s\t%d\t%s\n", p->desc, i, up->isrtable[i]);
+
+    if(confs && up && up->cfgtable)
+      for(int i = 0; i < up->nconfigs; i++) {
+        const Configitem *cp = up->cfgtable + i;
+        unsigned c, n = cp->nvalues;
+
+        if(!n || !cp->vlist) {        // Count bits set in mask
+          for(n = cp->mask, c = 0; n; c++)
+            n &= n - 1;
+          n = 1 << c;
+        }
+        dev_info(".cfgt\t%s\t%d\t%s\n", p->desc, n, cp->name);
+        if(cp->vlist && verbose)
+          for(int k = 0; k < cp->nvalues; k++)
+            dev_info(".cfgv\t%s\t\tvalue\t%d\t%s\n", p->desc, cp->vlist[k].value, cp->vlist[k].label);
+      }
+
+    if(regis && up && up->regf)
+      for(int i = 0; i < up->nregisters; i++)
+        dev_info(".regf\t%s\t0x%02x\t%d\t%s\n", p->desc, up->regf[i].addr, up->regf[i].size, up->regf[i].reg);
+  }
+
+  if(opspi) {
+    printallopcodes(p, "part", p->op);
+    if(p->mem) {
+      for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
+        AVRMEM *m = ldata(lnm);
+
+        if(m)
+          printallopcodes(p, m->desc, m->op);
+      }
+    }
+  }
+  // Print wait delays for AVR family parts
+  if(waits) {
+    if(is_isp(p))
+      dev_info(".wd_chip_erase %.3f ms %s\n", p->chip_erase_delay/1000.0, p->desc);
+    if(p->mem) {
+      for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
+        AVRMEM *m = ldata(lnm);
+
+        // Write delays not needed for read-only calibration and signature memories
+        if(!mem_is_readonly(m)) {
+          if(is_isp(p)) {
+            if(m->min_write_delay == m->max_write_delay)
+              dev_info(".wd_%s %.3f ms %s\n", m->desc, m->min_write_delay/1000.0, p->desc);
+            else {
+              dev_info(".wd_min_%s %.3f ms %s\n", m->desc, m->min_write_delay/1000.0, p->desc);
+              dev_info(".wd_max_%s %.3f ms %s\n", m->desc, m->max_write_delay/1000.0, p->desc);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Memory lookups of a part cache a vector of its memory list in the list; a
+ * worker thread printing a child part also looks up memories of the parent,
+ * so fill these caches before several threads read the parts
+ */
+static void dev_part_warm(const AVRPART *p) {
+  if(p->mem)
+    (void) lvec(p->mem);
+  if(p->mem_alias)
+    (void) lvec(p->mem_alias);
+}
+
+#ifdef DEV_THREADS
+
+typedef struct {                // Parts shared out among worker threads
+  const Dev_partflags *f;
+  Dev_partjob *jobs;
+  int njobs, next;
+  Avr_opts opts;                // Options of the calling thread for the workers
+  pthread_mutex_t lock;
+} Dev_partqueue;
+
+// Format parts from the queue into their output buffers until none is left
+static void dev_part_drain(Dev_partqueue *q) {
+  for(;;) {
+    pthread_mutex_lock(&q->lock);
+    int i = q->next < q->njobs? q->next++: -1;
+
+    pthread_mutex_unlock(&q->lock);
+    if(i < 0)
+      break;
+
+    Dev_partjob *j = q->jobs + i;
+
+    dev_out = &j->out;
+    dev_part_defs(q->f, j);
+    if(!j->out.buf)             // Mark as done even if nothing was printed
+      j->out.buf = mmt_strdup("");
+    dev_out = NULL;
+  }
+}
+
+static void *dev_part_worker(void *arg) {
+  Dev_partqueue *q = arg;
+
+  init_cx(NULL);                // The worker's own closed-circuit space, part index etc
+  avr_opts_load(&q->opts);
+  dev_part_drain(q);
+  free_cx();
+
+  return NULL;
+}
+
+#define DEV_MAXTHREADS 16
+#endif
+
+/*
+ * Format the parts in worker threads, one per online CPU, each part into its
+ * own buffer so that dev_output_part_defs() can print them in order; parts
+ * whose out.buf remains NULL are left for the caller to print directly
+ */
+static void dev_part_defs_parallel(const Dev_partflags *f, Dev_partjob *jobs, int njobs) {
+#ifdef DEV_THREADS
+  pthread_t tid[DEV_MAXTHREADS];
+  Dev_partqueue q = { .f = f, .jobs = jobs, .njobs = njobs };
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int nt = 0, want = ncpu > DEV_MAXTHREADS? DEV_MAXTHREADS: ncpu;
+
+  if(want > njobs)
+    want = njobs;
+  if(want < 2)
+    return;
+
+  avr_opts_save(&q.opts);
+  pthread_mutex_init(&q.lock, NULL);
+  while(nt < want && pthread_create(tid + nt, NULL, dev_part_worker, &q) == 0)
+    nt++;
+  for(int i = 0; i < nt; i++)
+    pthread_join(tid[i], NULL);
+  pthread_mutex_destroy(&q.lock);
+#else
+  (void) f, (void) jobs, (void) njobs;
+#endif
+}
+
 // -p <wildcard>/[dsASRvcreow*tiBCUPTIJWHQ]
 void dev_output_part_defs(char *partdesc) {
-  bool cmdok, waits, opspi, descs, vtabs, confs, regis, astrc, strct, cmpst, injct, raw, all, tsv;
+  Dev_partflags fl;
   char *flags;
-  int nprinted;
+  int nprinted, njobs = 0;
   AVRPART *nullpart = avr_new_part();
+  Dev_partjob *jobs;
 
   if((flags = strchr(partdesc, '/')))
     *flags++ = 0;
@@ -953,20 +1306,20 @@ void dev_output_part_defs(char *partdesc) {
     return;
   }
 
-  all = *flags == '*';
-  descs = all || !!strchr(flags, 'd');
-  vtabs = all || !!strchr(flags, 'v');
-  confs = all || !!strchr(flags, 'c');
-  regis = all || !!strchr(flags, 'r');
-  cmdok = all || !!strchr(flags, 'e');
-  opspi = all || !!strchr(flags, 'o');
-  waits = all || !!strchr(flags, 'w');
-  astrc = all || !!strchr(flags, 'A');
-  raw = all || !!strchr(flags, 'R');
-  strct = !!strchr(flags, 'S');
-  cmpst = !!strchr(flags, 's');
-  tsv = !!strchr(flags, 't');
-  injct = !!strchr(flags, 'i');
+  fl.all = *flags == '*';
+  fl.descs = fl.all || !!strchr(flags, 'd');
+  fl.vtabs = fl.all || !!strchr(flags, 'v');
+  fl.confs = fl.all || !!strchr(flags, 'c');
+  fl.regis = fl.all || !!strchr(flags, 'r');
+  fl.cmdok = fl.all || !!strchr(flags, 'e');
+  fl.opspi = fl.all || !!strchr(flags, 'o');
+  fl.waits = fl.all || !!strchr(flags, 'w');
+  fl.astrc = fl.all || !!strchr(flags, 'A');
+  fl.raw = fl.all || !!strchr(flags, 'R');
+  fl.strct = !!strchr(flags, 'S');
+  fl.cmpst = !!strchr(flags, 's');
+  fl.tsv = !!strchr(flags, 't');
+  fl.injct = !!strchr(flags, 'i');
 
   // Go through all memories and add them to the memory order list
   for(LNODEID ln1 = lfirst(part_list); ln1; ln1 = lnext(ln1)) {
@@ -982,249 +1335,46 @@ void dev_output_part_defs(char *partdesc) {
         avr_get_mem_type(((AVRMEM_ALIAS *) ldata(lnm))->desc);
   }
 
+  // Select the parts and prepare all that worker threads must not modify concurrently
+  jobs = mmt_malloc((lsize(part_list) + 1)*sizeof *jobs);
+  for(LNODEID ln1 = lfirst(part_list); ln1; ln1 = lnext(ln1)) {
+    AVRPART *p = ldata(ln1);
+    Dev_partjob *j = jobs + njobs;
+
+    if(!part_eq(p, partdesc, str_casematch) || !prog_modes_in_flags(p->prog_modes, flags))
+      continue;
+    j->p = p;
+    j->base = fl.astrc? NULL: fl.strct? nullpart:
+      p->parent_id && *p->parent_id? locate_part(part_list, p->parent_id): nullpart;
+    j->up = fl.vtabs || fl.confs || fl.regis? silent_locate_uP(p): NULL;
+    dev_part_warm(p);
+    if(j->base)
+      dev_part_warm(j->base);
+    njobs++;
+  }
+  dev_part_defs_parallel(&fl, jobs, njobs);
+
   if((nprinted = dev_nprinted)) {
     dev_info("\n");
     nprinted = dev_nprinted;
   }
-  for(LNODEID ln1 = lfirst(part_list); ln1; ln1 = lnext(ln1)) {
-    AVRPART *p = ldata(ln1);
-    int flashsize, flashoffset, flashpagesize, eepromsize, eepromoffset, eeprompagesize;
-
-    if(!descs || tsv)
-      if(dev_nprinted > nprinted) {
+  for(int i = 0; i <= njobs; i++) {
+    if(!fl.descs || fl.tsv)    // Separate the output of consecutive parts in part_list
+      if(dev_nprinted > nprinted && (i < njobs || jobs[i - 1].p != ldata(llast(part_list)))) {
         dev_info("\n");
         nprinted = dev_nprinted;
       }
+    if(i == njobs)
+      break;
 
-    if(!part_eq(p, partdesc, str_casematch))
-      continue;
-    if(!prog_modes_in_flags(p->prog_modes, flags))
-      continue;
-
-    if(astrc || strct || cmpst)
-      dev_part_strct(p, tsv,
-        astrc? NULL: strct? nullpart:
-        p->parent_id && *p->parent_id? locate_part(part_list, p->parent_id): nullpart,
-        injct);
-
-    if(raw)
-      dev_part_raw(p);
-
-    // Identify core flash and eeprom parameters
-
-    flashsize = flashoffset = flashpagesize = eepromsize = eepromoffset = eeprompagesize = 0;
-    if(p->mem) {
-      for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
-        AVRMEM *m = ldata(lnm);
-
-        if(!flashsize && mem_is_flash(m)) {
-          flashsize = m->size;
-          flashpagesize = m->page_size;
-          flashoffset = m->offset;
-        }
-        if(!eepromsize && mem_is_eeprom(m)) {
-          eepromsize = m->size;
-          eepromoffset = m->offset;
-          eeprompagesize = m->page_size;
-        }
-      }
-    }
-    // "Real" entries don't seem to have a space in their desc (a bit hackey)
-    if(flashsize && !strchr(p->desc, ' ')) {
-      int ok, nfuses;
-      AVRMEM *m;
-      OPCODE *oc;
-      const Avrintel *up;
-
-      ok = 2047;
-      nfuses = 0;
-
-      if(!p->op[AVR_OP_PGM_ENABLE])
-        ok &= ~DEV_SPI_EN_CE_SIG;
-
-      if(!p->op[AVR_OP_CHIP_ERASE])
-        ok &= ~DEV_SPI_EN_CE_SIG;
-
-      if((m = avr_locate_flash(p))) {
-        if((oc = m->op[AVR_OP_LOAD_EXT_ADDR])) {
-          // @@@ to do: check whether address is put at lsb of third byte
-        } else
-          ok &= ~DEV_SPI_LOAD_EXT_ADDR;
-
-        if((oc = m->op[AVR_OP_READ_HI])) {
-          if(cmdok)
-            checkaddr(m->size >> 1, 1, AVR_OP_READ_HI, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM;
-
-        if((oc = m->op[AVR_OP_READ_LO])) {
-          if(cmdok)
-            checkaddr(m->size >> 1, 1, AVR_OP_READ_LO, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM;
-
-        if((oc = m->op[AVR_OP_WRITE_HI])) {
-          if(cmdok)
-            checkaddr(m->size >> 1, 1, AVR_OP_WRITE_HI, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM;
-
-        if((oc = m->op[AVR_OP_WRITE_LO])) {
-          if(cmdok)
-            checkaddr(m->size >> 1, 1, AVR_OP_WRITE_LO, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM;
-
-        if((oc = m->op[AVR_OP_LOADPAGE_HI])) {
-          if(cmdok)
-            checkaddr(m->page_size >> 1, 1, AVR_OP_LOADPAGE_HI, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM_PAGED;
-
-        if((oc = m->op[AVR_OP_LOADPAGE_LO])) {
-          if(cmdok)
-            checkaddr(m->page_size >> 1, 1, AVR_OP_LOADPAGE_LO, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM_PAGED;
-
-        if((oc = m->op[AVR_OP_WRITEPAGE])) {
-          if(cmdok)
-            checkaddr(m->size >> 1, m->page_size >> 1, AVR_OP_WRITEPAGE, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_PROGMEM_PAGED;
-      } else
-        ok &= ~(DEV_SPI_PROGMEM_PAGED | DEV_SPI_PROGMEM);
-
-      if((m = avr_locate_eeprom(p))) {
-        if((oc = m->op[AVR_OP_READ])) {
-          if(cmdok)
-            checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_EEPROM;
-
-        if((oc = m->op[AVR_OP_WRITE])) {
-          if(cmdok)
-            checkaddr(m->size, 1, AVR_OP_WRITE, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_EEPROM;
-
-        if((oc = m->op[AVR_OP_LOADPAGE_LO])) {
-          if(cmdok)
-            checkaddr(m->page_size, 1, AVR_OP_LOADPAGE_LO, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_EEPROM_PAGED;
-
-        if((oc = m->op[AVR_OP_WRITEPAGE])) {
-          if(cmdok)
-            checkaddr(m->size, m->page_size, AVR_OP_WRITEPAGE, oc, p, m);
-        } else
-          ok &= ~DEV_SPI_EEPROM_PAGED;
-      } else
-        ok &= ~(DEV_SPI_EEPROM_PAGED | DEV_SPI_EEPROM);
-
-      if((m = avr_locate_signature(p)) && (oc = m->op[AVR_OP_READ])) {
-        if(cmdok)
-          checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
-      } else
-        ok &= ~DEV_SPI_EN_CE_SIG;
-
-      if((m = avr_locate_calibration(p)) && (oc = m->op[AVR_OP_READ])) {
-        if(cmdok)
-          checkaddr(m->size, 1, AVR_OP_READ, oc, p, m);
-      } else
-        ok &= ~DEV_SPI_CALIBRATION;
-
-      // Actually, some AT90S... parts cannot read, only write lock bits :-0
-      if(!((m = avr_locate_lock(p)) && m->op[AVR_OP_WRITE]))
-        ok &= ~DEV_SPI_LOCK;
-
-      if((m = avr_locate_fuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
-        nfuses++;
-      else
-        ok &= ~DEV_SPI_LFUSE;
-
-      if((m = avr_locate_hfuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
-        nfuses++;
-      else
-        ok &= ~DEV_SPI_HFUSE;
-
-      if((m = avr_locate_efuse(p)) && m->op[AVR_OP_READ] && m->op[AVR_OP_WRITE])
-        nfuses++;
-      else
-        ok &= ~DEV_SPI_EFUSE;
-
-      if(descs) {
-        int len = 16 - strlen(p->desc);
-
-        dev_info
-          ("%s '%s' =>%*s [0x%02X, 0x%02X, 0x%02X, 0x%08x, 0x%05x, 0x%03x, "
-           "0x%06x, 0x%04x, 0x%03x, %d, 0x%03x, 0x%04x, '%s'], # %s %d\n",
-          tsv || all? ".desc": "   ",
-          p->desc, len > 0? len: 0, "",
-          p->signature[0], p->signature[1], p->signature[2],
-          flashoffset, flashsize, flashpagesize, eepromoffset, eepromsize, eeprompagesize, nfuses, ok, p->flags,
-          dev_prog_modes(p->prog_modes), p->config_file, p->lineno);
-      }
-
-      if(vtabs && (up = silent_locate_uP(p)) && up->isrtable)
-        for(int i = 0; i < up->ninterrupts; i++)
-          dev_info(".vtab\t%s\t%d\t%s\n", p->desc, i, up->isrtable[i]);
-
-      if(confs && (up = silent_locate_uP(p)) && up->cfgtable)
-        for(int i = 0; i < up->nconfigs; i++) {
-          const Configitem *cp = up->cfgtable + i;
-          unsigned c, n = cp->nvalues;
-
-          if(!n || !cp->vlist) {        // Count bits set in mask
-            for(n = cp->mask, c = 0; n; c++)
-              n &= n - 1;
-            n = 1 << c;
-          }
-          dev_info(".cfgt\t%s\t%d\t%s\n", p->desc, n, cp->name);
-          if(cp->vlist && verbose)
-            for(int k = 0; k < cp->nvalues; k++)
-              dev_info(".cfgv\t%s\t\tvalue\t%d\t%s\n", p->desc, cp->vlist[k].value, cp->vlist[k].label);
-        }
-
-      if(regis && (up = silent_locate_uP(p)) && up->regf)
-        for(int i = 0; i < up->nregisters; i++)
-          dev_info(".regf\t%s\t0x%02x\t%d\t%s\n", p->desc, up->regf[i].addr, up->regf[i].size, up->regf[i].reg);
-    }
-
-    if(opspi) {
-      printallopcodes(p, "part", p->op);
-      if(p->mem) {
-        for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
-          AVRMEM *m = ldata(lnm);
-
-          if(m)
-            printallopcodes(p, m->desc, m->op);
-        }
-      }
-    }
-    // Print wait delays for AVR family parts
-    if(waits) {
-      if(is_isp(p))
-        dev_info(".wd_chip_erase %.3f ms %s\n", p->chip_erase_delay/1000.0, p->desc);
-      if(p->mem) {
-        for(LNODEID lnm = lfirst(p->mem); lnm; lnm = lnext(lnm)) {
-          AVRMEM *m = ldata(lnm);
-
-          // Write delays not needed for read-only calibration and signature memories
-          if(!mem_is_readonly(m)) {
-            if(is_isp(p)) {
-              if(m->min_write_delay == m->max_write_delay)
-                dev_info(".wd_%s %.3f ms %s\n", m->desc, m->min_write_delay/1000.0, p->desc);
-              else {
-                dev_info(".wd_min_%s %.3f ms %s\n", m->desc, m->min_write_delay/1000.0, p->desc);
-                dev_info(".wd_max_%s %.3f ms %s\n", m->desc, m->max_write_delay/1000.0, p->desc);
-              }
-            }
-          }
-        }
-      }
-    }
+    if(jobs[i].out.buf) {       // Already formatted by a worker thread
+      if(jobs[i].out.len)
+        dev_info("%s", jobs[i].out.buf);
+      mmt_free(jobs[i].out.buf);
+    } else
+      dev_part_defs(&fl, jobs + i);
   }
+  mmt_free(jobs);
 }
 
 static void dev_pgm_raw(const PROGRAMMER *pgm) {
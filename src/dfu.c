@@ -125,11 +125,9 @@ struct dfu_dev *dfu_open(const char *port_spec) {
   dfu->dev_name = dev_name;
   dfu->timeout = DFU_TIMEOUT;
 
-  // LibUSB initialization
+  // LibUSB initialization and bus scan, shared with other USB backends
 
-  usb_init();
-  usb_find_busses();
-  usb_find_devices();
+  usb_enum_busses();
 
   return dfu;
 }
@@ -216,6 +214,17 @@ int dfu_init(struct dfu_dev *dfu, unsigned short vid, unsigned short pid) {
   if(found->config->interface->altsetting->endpoint != 0)
     memcpy(&dfu->endp_desc, found->config->interface->altsetting->endpoint, sizeof(dfu->endp_desc));
 
+  // The DFU functional descriptor (type 0x21) follows the interface descriptor
+  const unsigned char *extra = found->config->interface->altsetting->extra;
+  int extralen = found->config->interface->altsetting->extralen;
+
+  for(int i = 0; extra && i + 7 <= extralen && extra[i] >= 2; i += extra[i])
+    if(extra[i + 1] == 0x21 && extra[i] >= 7) {
+      dfu->transfer_size = extra[i + 5] | extra[i + 6] << 8;
+      pmsg_notice2("DFU functional descriptor reports wTransferSize %u\n", dfu->transfer_size);
+      break;
+    }
+
   // Get strings
 
   dfu->manf_str = get_usb_string(dfu->dev_handle, dfu->dev_desc.iManufacturer);
@@ -370,6 +379,9 @@ void dfu_show_info(struct dfu_dev *dfu) {
 
   if(dfu->serno_str != NULL)
     msg_info("    USB Serial No       : %s\n", dfu->serno_str);
+
+  if(dfu->transfer_size)
+    msg_info("    DFU Transfer Size   : %u\n", dfu->transfer_size);
 }
 
 /* INTERNAL FUNCTION DEFINITIONS
@@ -54,6 +54,7 @@ extern "C" {
     struct usb_endpoint_descriptor endp_desc;
     char *manf_str, *prod_str, *serno_str;
     unsigned int timeout;
+    unsigned int transfer_size; // wTransferSize of DFU functional descriptor, 0 if none
   };
 
 #else
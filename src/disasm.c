@@ -444,9 +444,18 @@ static const char *get_label_name(int destination, const char **commentp) {
     return s->name;
   }
 
-  for(int i = 0; i < cx->dis_labelN; i++)
-    if(cx->dis_labels[i].addr == destination)
-      return str_ccprintf("%s%d", cx->dis_labels[i].is_func? "Subroutine": "Label", cx->dis_labels[i].labelno);
+  // Labels are sorted by address
+  for(int lo = 0, hi = cx->dis_labelN - 1; lo <= hi;) {
+    int mid = (lo + hi)/2;
+    const Dis_label *l = cx->dis_labels + mid;
+
+    if(l->addr == destination)
+      return str_ccprintf("%s%d", l->is_func? "Subroutine": "Label", l->labelno);
+    if(l->addr < destination)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
 
   return NULL;
 }
@@ -515,6 +524,40 @@ static int is_address(int address, int xable) {
   return !!(cx->dis_jcaddr[idx/n] & (xable << (idx%n)));
 }
 
+// Whether a registered jumpcall goes to address (-1 if address outside buffer)
+static int is_xref(int address) {
+  if(!cx->dis_xref || address < cx->dis_start || address > cx->dis_end)
+    return -1;
+
+  int idx = address - cx->dis_start;
+  return !!(cx->dis_xref[idx/8] & (1 << idx%8));
+}
+
+static void set_xref(int address) {
+  if(is_xref(address) == 0) {
+    int idx = address - cx->dis_start;
+
+    cx->dis_xref[idx/8] |= 1 << idx%8;
+  }
+}
+
+// Index of first jumpcall to address in pass 2, when jumpcalls are sorted, or -1
+static int first_jumpcall_to(int address) {
+  const Dis_jumpcall *jc = cx->dis_jumpcalls;
+  int lo = 0, hi = cx->dis_jumpcallN;
+
+  while(lo < hi) {              // Lower bound
+    int mid = (lo + hi)/2;
+
+    if(jc[mid].to < address)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo < cx->dis_jumpcallN && jc[lo].to == address? lo: -1;
+}
+
 // Format output for a label list r referenced by mnemonic m
 static void output_references(const char *m, char *r) {
   disasm_out("; %c%s from ", toupper(*m & 0xff), m + 1);
@@ -551,10 +594,17 @@ static void lineout(const char *code, const char *comment,
     const char *comment = NULL, *name;
     Dis_symbol *s;
 
-    for(int i = 0; i < cx->dis_jumpcallN; i++)
-      if(jc[i].to == here)
-        if(!match++)
-          first = i;
+    if(cx->dis_pass == 2) {     // Sorted jumpcalls
+      if((first = first_jumpcall_to(here)) >= 0)
+        for(int i = first; i < cx->dis_jumpcallN && jc[i].to == here; i++)
+          match++;
+    } else if((match = is_xref(here)) < 0) {
+      match = 0;
+      for(int i = 0; i < cx->dis_jumpcallN; i++)
+        if(jc[i].to == here)
+          if(!match++)
+            first = i;
+    }
 
     if(cx->dis_pass == 2 && match) {
       cx->dis_para++;
@@ -799,17 +849,30 @@ static void emit_used_symbols() {
 void disasm_zap_jumpcalls() {
   mmt_free(cx->dis_jumpcalls); cx->dis_jumpcalls = NULL; cx->dis_jumpcallN = 0;
   mmt_free(cx->dis_labels);    cx->dis_labels = NULL;    cx->dis_labelN = 0;
+  cx->dis_jumpcallS = 0;
 }
 
+static int jumpcall_sort(const void *v1, const void *v2);
+
 static void register_jumpcall(int from, int to, int mnemo, int is_func) {
   if(cx->dis_opts.labels) {
     Dis_jumpcall *jc = cx->dis_jumpcalls;
     int N = cx->dis_jumpcallN;
 
     // Already entered this jumpcall?
-    for(int i = 0; i < N; i++)
-      if(jc[i].from == from && jc[i].to == to && jc[i].mnemo == mnemo)
+    if(cx->dis_xref) {          // Search sorted ones and, as each address is visited once, this opcode's
+      Dis_jumpcall key = {.from = from, .to = to, .mnemo = mnemo };
+
+      if(bsearch(&key, jc, cx->dis_jumpcallS, sizeof *jc, jumpcall_sort))
         return;
+      for(int i = N - 1; i >= cx->dis_jumpcallS && jc[i].from == from; i--)
+        if(jc[i].to == to && jc[i].mnemo == mnemo)
+          return;
+    } else {
+      for(int i = 0; i < N; i++)
+        if(jc[i].from == from && jc[i].to == to && jc[i].mnemo == mnemo)
+          return;
+    }
 
     if(N%1024 == 0)
       jc = mmt_realloc(jc, sizeof(Dis_jumpcall)*(N + 1024));
@@ -818,6 +881,7 @@ static void register_jumpcall(int from, int to, int mnemo, int is_func) {
     jc[N].mnemo = mnemo;
     if(is_func)
       set_address(to, callable);
+    set_xref(to);
 
     cx->dis_jumpcalls = jc;
     cx->dis_jumpcallN++;
@@ -839,6 +903,8 @@ static void set_labels(void) {
   int dest = -1, cur_no[2] = { 0, 0 }, j = 0;
 
   qsort(cx->dis_jumpcalls, cx->dis_jumpcallN, sizeof(Dis_jumpcall), jumpcall_sort);
+  cx->dis_jumpcallS = cx->dis_jumpcallN;
+  mmt_free(cx->dis_labels);
   cx->dis_labels = mmt_malloc(cx->dis_jumpcallN*sizeof*cx->dis_labels);
   for(int i = 0; i < cx->dis_jumpcallN; i++) {
     if(is_address(cx->dis_jumpcalls[i].to, jumpable) && dest != cx->dis_jumpcalls[i].to) {
@@ -1288,6 +1354,15 @@ int disasm(const char *buf, int buflen, int addr, int leadin, int leadout) {
   // Two bits in int array per word address indicate whether addr is jumpable/callable
   cx->dis_jcaddr = mmt_malloc(((buflen + 7)/8 + sizeof(int)-1)/sizeof(int)*sizeof(int));
   set_address(0, jumpable);   // Mark reset as potential rjmp destination
+  // Bitmap of addresses that jumpcalls go to; only used if each address is disassembled once
+  qsort(cx->dis_jumpcalls, cx->dis_jumpcallN, sizeof(Dis_jumpcall), jumpcall_sort);
+  cx->dis_jumpcallS = cx->dis_jumpcallN; // Those from earlier disasm commands
+  cx->dis_xref = NULL;
+  if(!cx->dis_flashsz2 || buflen <= cx->dis_flashsz2) {
+    cx->dis_xref = mmt_malloc((buflen + 7)/8);
+    for(int i = 0; i < cx->dis_jumpcallN; i++)
+      set_xref(cx->dis_jumpcalls[i].to);
+  }
 
   // Make two passes: the first gathers labels, the second outputs the assembler code
   for(cx->dis_pass = 1; cx->dis_pass < 3; cx->dis_pass++) {
@@ -1329,6 +1404,8 @@ int disasm(const char *buf, int buflen, int addr, int leadin, int leadout) {
 
   mmt_free(cx->dis_jcaddr);
   cx->dis_jcaddr = NULL;
+  mmt_free(cx->dis_xref);
+  cx->dis_xref = NULL;
   return 0;
 }
 
@@ -61,6 +61,11 @@ typedef struct {
   int datastart, datasize;      // Start and size of application data section (if any)
   int bootstart, bootsize;      // Start and size of boot section (if any)
   int initialised;              // 1 once the part memories are initialised
+  // Link model: zero values mean the respective cost is not simulated
+  unsigned latency;             // Round trip time per transaction in us
+  unsigned bandwidth;           // Link speed in bit/s, 10 bits per byte as on a UART
+  unsigned nvmdelay;            // Write time per NVM page or byte in us
+  double owed;                  // Simulated time in us not yet slept
 } Dryrun_data;
 
 // Use private programmer data as if they were a global structure dry
@@ -72,6 +77,29 @@ typedef struct {
 
 static int dryrun_readonly(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, unsigned int addr);
 
+#define DRY_FRAMING 4           // Command/address bytes per simulated transaction
+
+/*
+ * Simulate the cost of one transaction transferring n payload bytes and
+ * programming nvm pages or bytes. Delays are accumulated and only slept once
+ * at least 1 ms is owed; the time actually slept is deducted, so that
+ * oversleeping of usleep() is compensated for by subsequent transactions.
+ */
+static void dryrun_link(const PROGRAMMER *pgm, unsigned n, int nvm) {
+  if(!dry.latency && !dry.bandwidth && !dry.nvmdelay)
+    return;
+
+  dry.owed += dry.latency + (double) nvm*dry.nvmdelay;
+  if(dry.bandwidth)
+    dry.owed += (n + DRY_FRAMING)*10e6/dry.bandwidth;
+  if(dry.owed >= 1000) {
+    uint64_t start = avr_ustimestamp();
+
+    avr_usleep((unsigned long) dry.owed);
+    dry.owed -= avr_ustimestamp() - start;
+  }
+}
+
 // Read expected signature bytes from part description
 static int dryrun_read_sig_bytes(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *sigmem) {
   pmsg_debug("%s()", __func__);
@@ -79,6 +107,7 @@ static int dryrun_read_sig_bytes(const PROGRAMMER *pgm, const AVRPART *p, const
   if(sigmem->size < 3)
     Return("memory size too small for %s()", __func__);
 
+  dryrun_link(pgm, 3, 0);
   memcpy(sigmem->buf, p->signature, 3);
   msg_debug(" returns 0x%02x%02x%02x\n", sigmem->buf[0], sigmem->buf[1], sigmem->buf[2]);
   return 3;
@@ -96,6 +125,7 @@ static int dryrun_chip_erase(const PROGRAMMER *pgm, const AVRPART *punused) {
   if(mem->size < 1)
     Return("cannot erase %s flash memory owing to its size %d", dry.dp->desc, mem->size);
 
+  dryrun_link(pgm, 0, 1);
   if(dry.bl) {                  // Bootloaders won't overwrite themselves
     memset(mem->buf + (dry.bl == DRY_TOP? 0: dry.bootsize), 0xff, mem->size - dry.bootsize);
     return 0;                   // Assume that's all a bootloader does
@@ -134,6 +164,8 @@ static int dryrun_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned
 
     ret = dryrun_chip_erase(pgm, NULL);
   }
+  else
+    dryrun_link(pgm, 4, 0);
   // Pretend call happened and all is good, returning 0xff each time
   memcpy(res, cmd + 1, 3);
   res[3] = 0xff;
@@ -159,6 +191,7 @@ static int dryrun_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
     Return("%s page erase of %s reaches outside %s?", dmem->desc,
       str_ccinterval(addr, addr + dmem->page_size - 1), str_ccinterval(0, dmem->size - 1));
 
+  dryrun_link(pgm, 0, 1);
   memset(dmem->buf + addr, 0xff, dmem->page_size);
 
   return 0;
@@ -779,6 +812,7 @@ static int dryrun_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
 
     for(; addr < end; addr += chunk) {
       chunk = end - addr < page_size? end - addr: page_size;
+      dryrun_link(pgm, chunk, 1);
       // @@@ Check for bootloader write protection here
 
       // Unless it is a bootloader flash looks like NOR-memory
@@ -825,6 +859,7 @@ static int dryrun_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
 
     for(; addr < end; addr += chunk) {
       chunk = end - addr < page_size? end - addr: page_size;
+      dryrun_link(pgm, chunk, 0);
       memcpy(m->buf + addr, dmem->buf + addr, chunk);
     }
   }
@@ -832,6 +867,22 @@ static int dryrun_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
   return n_bytes;
 }
 
+// The dryrun device is in host memory, so ranges can be compared without reading them back
+static int dryrun_verify_range(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int addr, unsigned int n, const unsigned char *data) {
+
+  AVRMEM *dmem;
+
+  pmsg_debug("%s(%s, 0x%04x, %u)\n", __func__, m->desc, addr, n);
+  if(!dry.dp || !(dmem = avr_locate_mem(dry.dp, m->desc)) || dmem->size != m->size)
+    return -1;
+  if(addr >= (unsigned int) dmem->size || n > (unsigned int) dmem->size - addr)
+    return -1;
+
+  dryrun_link(pgm, n, 0);       // Programmer compares data sent to it with device memory
+  return !memcmp(dmem->buf + addr, data, n);
+}
+
 int dryrun_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned long addr, unsigned char data) {
 
@@ -867,6 +918,7 @@ int dryrun_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
     data = (data & bitmask) | (dmem->buf[addr] & ~bitmask);
   }
 
+  dryrun_link(pgm, 1, 1);
   dmem->buf[addr] = data;
 
   if(mem_is_fuses(dmem) && addr < 16) { // Copy the byte to corresponding individual fuse
@@ -911,6 +963,7 @@ int dryrun_read_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   if(!dry.bl && (mem_is_io(dmem) || mem_is_sram(dmem)) && is_classic(p))
     Return("classic part io/sram memories cannot be read externally");
 
+  dryrun_link(pgm, 1, 0);
   *value = dmem->buf[addr];
 
   msg_debug(" returns 0x%02x\n", *value);
@@ -1014,6 +1067,18 @@ static int dryrun_parseextparams(const PROGRAMMER *pgm, const LISTID extparms) {
         dry.random = 1;
       continue;
     }
+    if(str_starts(xpara, "latency=") || str_starts(xpara, "bandwidth=") || str_starts(xpara, "nvmdelay=")) {
+      const char *errptr;
+      unsigned val = str_int(strchr(xpara, '=') + 1, STR_UINT32, &errptr);
+
+      if(errptr) {
+        pmsg_error("cannot parse %s value: %s\n", xpara, errptr);
+        rc = -1;
+        break;
+      }
+      *(*xpara == 'l'? &dry.latency: *xpara == 'b'? &dry.bandwidth: &dry.nvmdelay) = val;
+      continue;
+    }
     if(str_eq(xpara, "help")) {
       help = true;
       rc = LIBAVRDUDE_EXIT_OK;
@@ -1024,16 +1089,20 @@ static int dryrun_parseextparams(const PROGRAMMER *pgm, const LISTID extparms) {
       rc = -1;
     }
     msg_error("%s -c %s extended options:\n", progname, pgmid);
-    msg_error("  -x init       Initialise memories with human-readable patterns (1, 2, 3)\n");
-    msg_error("  -x init=<n>   Shortcut for -x init -x seed=<n>\n");
-    msg_error("  -x random     Initialise memories with random code/values (1, 3)\n");
-    msg_error("  -x random=<n> Shortcut for -x random -x seed=<n>\n");
-    msg_error("  -x seed=<n>   Seed random number generator with <n>, n>0, default time(NULL)\n");
-    msg_error("  -x help       Show this help menu and exit\n");
+    msg_error("  -x init            Initialise memories with human-readable patterns (1, 2, 3)\n");
+    msg_error("  -x init=<n>        Shortcut for -x init -x seed=<n>\n");
+    msg_error("  -x random          Initialise memories with random code/values (1, 3)\n");
+    msg_error("  -x random=<n>      Shortcut for -x random -x seed=<n>\n");
+    msg_error("  -x seed=<n>        Seed random number generator with <n>, n>0, default time(NULL)\n");
+    msg_error("  -x latency=<us>    Simulate round trip time <us> per transaction (4)\n");
+    msg_error("  -x bandwidth=<bps> Simulate link speed <bps> in bit/s, 10 bits per byte (4)\n");
+    msg_error("  -x nvmdelay=<us>   Simulate NVM write time <us> per page or byte (4)\n");
+    msg_error("  -x help            Show this help menu and exit\n");
     msg_error("Notes:\n");
     msg_error("  (1) -x init and -x random randomly configure flash wrt boot/data/code length\n");
     msg_error("  (2) Patterns can best be seen with fixed-width font on -U flash:r:-:I\n");
     msg_error("  (3) Choose, eg, -x seed=1 for reproducible flash configuration and output\n");
+    msg_error("  (4) Each page, byte or command is one transaction; default 0 (not simulated)\n");
     return rc;
   }
 
@@ -1068,7 +1137,11 @@ void dryrun_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = dryrun_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = dryrun_paged_load;
+  pgm->multipage_load = 1;
+  pgm->max_load = 65536;
+  pgm->verify_range = dryrun_verify_range;
   pgm->setup = dryrun_setup;
   pgm->teardown = dryrun_teardown;
   pgm->term_keep_alive = dryrun_term_keep_alive;
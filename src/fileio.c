@@ -26,6 +26,12 @@
 #include <errno.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if !defined(WIN32)
+#include <sys/mman.h>
+#endif
 
 #ifdef HAVE_LIBELF
 
@@ -44,8 +50,21 @@
 #endif
 #endif
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBLZMA
+#include <lzma.h>
+#endif
+
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
 #include "avrdude.h"
 #include "libavrdude.h"
+#include "crc16.h"
 
 // Common internal record structure for ihex and srec files
 struct ihexsrec {
@@ -66,6 +85,8 @@ char *fileio_fmtstr(FILEFMT format) {
     return "Intel Hex";
   case FMT_IHXC:
     return "Intel Hex with comments";
+  case FMT_PIMG:
+    return "page image";
   case FMT_RBIN:
     return "raw binary";
   case FMT_ELF:
@@ -97,6 +118,8 @@ int fileio_fmtchr(FILEFMT format) {
     return 'i';
   case FMT_IHXC:
     return 'I';
+  case FMT_PIMG:
+    return 'p';
   case FMT_RBIN:
     return 'r';
   case FMT_ELF:
@@ -128,6 +151,8 @@ FILEFMT fileio_format(char c) {
     return FMT_IHEX;
   case 'I':
     return FMT_IHXC;
+  case 'p':
+    return FMT_PIMG;
   case 'r':
     return FMT_RBIN;
   case 'e':
@@ -248,28 +273,53 @@ unsigned fileio_mem_offset(const AVRPART *p, const AVRMEM *mem) {
   return location;
 }
 
-static const char *memlabel(const AVRPART *p, const AVRMEM *m, unsigned addr, int n) {
-  if(m->size < (int) ANY_MEM_SIZE)      // Ordinary (single) memory
-    return addr? NULL: m->desc;
+// Inverse lookup of which memory of size n could have been mapped to flat address addr
+static const AVRMEM *flatmem(const AVRPART *p, unsigned addr, int n) {
+  AVRMEM *m;
 
-  // Inverse lookup of which memory could have been mapped to this address
   for(LNODEID lm = lfirst(p->mem); lm; lm = lnext(lm))
     if(fileio_mem_offset(p, (m = ldata(lm))) == addr && n == m->size)
-      return avr_mem_name(p, m);
+      return m;
 
   for(LNODEID lm = lfirst(p->mem); lm; lm = lnext(lm))
     if(fileio_mem_offset(p, (m = ldata(lm))) == addr)
-      return avr_mem_name(p, m);
+      return m;
 
   return NULL;
 }
 
+static const char *memlabel(const AVRPART *p, const AVRMEM *m, unsigned addr, int n) {
+  if(m->size < (int) ANY_MEM_SIZE)      // Ordinary (single) memory
+    return addr? NULL: m->desc;
+
+  m = flatmem(p, addr, n);
+
+  return m? avr_mem_name(p, m): NULL;
+}
+
 // Tells lower level .hex/.srec routines whether to write intros/outros
 typedef enum {
   FIRST_SEG = 1,
   LAST_SEG = 2,
+  NEXT_SEG = 4,                 // Continues the previous segment, see fileio_stream_write()
 } Segorder;
 
+#define FIO_RECSIZE 32          // Data bytes per Intel Hex or Motorola S-Record line
+
+/*
+ * Put the lowest 4*width bits of val as hex digits from digits[] into s and
+ * return the position after them; the record writers below assemble a full
+ * line this way and write it with a single fwrite() instead of one fprintf()
+ * per byte.
+ */
+static char *puthex(char *s, unsigned val, int width, const char *digits) {
+  for(int i = width - 1; i >= 0; i--, val >>= 4)
+    s[i] = digits[val & 15];
+  return s + width;
+}
+
+#define HEXDIGITS "0123456789ABCDEF"
+
 static void print_ihex_extended_addr(int n_64k, FILE *outf) {
   unsigned char hi = (n_64k >> 8);
   unsigned char lo = n_64k;
@@ -309,7 +359,7 @@ static int b2ihex(const AVRPART *p, const AVRMEM *mem, const Segment *segp, Sego
   buf += segp->addr;
 
   // Give address unless it's the first segment and it would be the default 0
-  if(!((where & FIRST_SEG) && n_64k == 0))
+  if(!((where & FIRST_SEG) && n_64k == 0) && !((where & NEXT_SEG) && (nextaddr || !bufsize)))
     print_ihex_extended_addr(n_64k, outf);
 
   while(bufsize) {
@@ -321,38 +371,57 @@ static int b2ihex(const AVRPART *p, const AVRMEM *mem, const Segment *segp, Sego
       n = 0x10000 - nextaddr;
 
     if(n) {
-      fprintf(outf, ":%02X%04X00", n, nextaddr);
+      // Header 9, data and padding 2*255, checksum 2, comment 14 + 255, newline 1
+      char rec[1300], *r = rec;
       unsigned char c, cksum = n + ((nextaddr >> 8) & 0x0ff) + (nextaddr & 0x0ff);
 
+      *r++ = ':';
+      r = puthex(r, n, 2, HEXDIGITS);
+      r = puthex(r, nextaddr, 4, HEXDIGITS);
+      *r++ = '0', *r++ = '0';
       for(int i = 0; i < n; i++) {
-        fprintf(outf, "%02X", buf[i]);
+        r = puthex(r, buf[i], 2, HEXDIGITS);
         cksum += buf[i];
       }
       cksum = -cksum;
-      fprintf(outf, "%02X", cksum);
+      r = puthex(r, cksum, 2, HEXDIGITS);
+
+      const char *name = NULL;
 
       if(ffmt == FMT_IHXC) {    // Print comment with address and ASCII dump
-        const char *name = memlabel(p, mem, n_64k*0x10000 + nextaddr, n);
+        unsigned addr = n_64k*0x10000 + nextaddr;
+        int width = 5;
 
+        name = memlabel(p, mem, addr, n);
         for(int i = n; i < recsize; i++)
-          fprintf(outf, "  ");
-        fprintf(outf, " // %05x> ", n_64k*0x10000 + nextaddr);
+          *r++ = ' ', *r++ = ' ';
+        memcpy(r, " // ", 4), r += 4;
+        while(width < 8 && addr >> 4*width)
+          width++;
+        r = puthex(r, addr, width, "0123456789abcdef");
+        *r++ = '>', *r++ = ' ';
         for(int i = 0; i < n; i++)
-          if(n < 9 && name)
-            fprintf(outf, "%s0x%02x", i? " ": "", buf[i]);
-          else
-            putc((c = buf[i] & 0x7f) < ' ' || c == 0x7f? '.': c, outf);
-        if(name) {
-          fprintf(outf, " %s", name);
-          if((str_eq(name, "sigrow") || str_eq(name, "signature")) && !nextaddr) {
-            const char *mculist = str_ccmcunames_signature(buf, PM_ALL);
-
-            if(*mculist)
-              fprintf(outf, " (%s)", mculist);
-          }
+          if(n < 9 && name) {
+            if(i)
+              *r++ = ' ';
+            *r++ = '0', *r++ = 'x';
+            r = puthex(r, buf[i], 2, "0123456789abcdef");
+          } else
+            *r++ = (c = buf[i] & 0x7f) < ' ' || c == 0x7f? '.': c;
+      }
+      if(!name)
+        *r++ = '\n';
+      fwrite(rec, 1, r - rec, outf);
+      if(name) {
+        fprintf(outf, " %s", name);
+        if((str_eq(name, "sigrow") || str_eq(name, "signature")) && !nextaddr) {
+          const char *mculist = str_ccmcunames_signature(buf, PM_ALL);
+
+          if(*mculist)
+            fprintf(outf, " (%s)", mculist);
         }
+        putc('\n', outf);
       }
-      putc('\n', outf);
 
       nextaddr += n;
       hiaddr += n;
@@ -377,71 +446,50 @@ static int b2ihex(const AVRPART *p, const AVRMEM *mem, const Segment *segp, Sego
   return hiaddr;
 }
 
-static int ihex_readrec(struct ihexsrec *ihex, char *rec) {
-  int i, j;
-  char buf[8];
-  int offset, len;
-  char *e;
-  unsigned char cksum;
+// Hex digit values plus one, 0 for characters that are not hex digits
+static const unsigned char hexval1[256] = {
+  ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8,
+  ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+  ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
 
-  len = strlen(rec);
-  offset = 1;
-  cksum = 0;
+// Decode two hex digits at s; return -1 if either is not one (incl end of string)
+static int hexbyte(const char *s) {
+  int hi = hexval1[(unsigned char) s[0]], lo;
 
-  // Reclen
-  if(offset + 2 > len)
-    return -1;
-  for(i = 0; i < 2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  ihex->reclen = strtoul(buf, &e, 16);
-  if(e == buf || *e != 0)
+  if(!hi || !(lo = hexval1[(unsigned char) s[1]]))
     return -1;
 
-  // Load offset
-  if(offset + 4 > len)
-    return -1;
-  for(i = 0; i < 4; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  ihex->loadofs = strtoul(buf, &e, 16);
-  if(e == buf || *e != 0)
-    return -1;
+  return (hi - 1) << 4 | (lo - 1);
+}
 
-  // Record type
-  if(offset + 2 > len)
-    return -1;
-  for(i = 0; i < 2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  ihex->rectyp = strtoul(buf, &e, 16);
-  if(e == buf || *e != 0)
-    return -1;
+static int ihex_readrec(struct ihexsrec *ihex, char *rec) {
+  const char *s = rec + 1;
+  int b[4];
+  unsigned char cksum;
 
-  cksum = ihex->reclen + ((ihex->loadofs >> 8) & 0x0ff) + (ihex->loadofs & 0x0ff) + ihex->rectyp;
+  // Reclen, load offset and record type
+  for(int i = 0; i < 4; i++, s += 2)
+    if((b[i] = hexbyte(s)) < 0)
+      return -1;
+  ihex->reclen = b[0];
+  ihex->loadofs = b[1] << 8 | b[2];
+  ihex->rectyp = b[3];
+  cksum = b[0] + b[1] + b[2] + b[3];
 
   // Data
-  for(j = 0; j < ihex->reclen; j++) {
-    if(offset + 2 > len)
-      return -1;
-    for(i = 0; i < 2; i++)
-      buf[i] = rec[offset++];
-    buf[i] = 0;
-    ihex->data[j] = strtoul(buf, &e, 16);
-    if(e == buf || *e != 0)
+  for(int j = 0; j < ihex->reclen; j++, s += 2) {
+    int d = hexbyte(s);
+
+    if(d < 0)
       return -1;
-    cksum += ihex->data[j];
+    cksum += ihex->data[j] = d;
   }
 
   // Cksum
-  if(offset + 2 > len)
-    return -1;
-  for(i = 0; i < 2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  ihex->cksum = strtoul(buf, &e, 16);
-  if(e == buf || *e != 0)
+  if((b[0] = hexbyte(s)) < 0)
     return -1;
+  ihex->cksum = b[0];
 
   pmsg_debug("read ihex record type 0x%02x at 0x%04x with %2d bytes and chksum 0x%02x (0x%02x)\n",
     ihex->rectyp, ihex->loadofs, ihex->reclen, ihex->cksum, -cksum & 0xff);
@@ -462,9 +510,9 @@ static int any2mem(const AVRPART *p, const AVRMEM *mem, const Segment *segp, con
 
   // Copy over memory to right place and return highest written address plus one
   for(unsigned i = segp->addr, end = segp->addr + segp->len; i < end; i++)
-    if(any->tags[location + i]) {
+    if(tag_isset(any->tags, location + i)) {
       mem->buf[i] = any->buf[location + i];
-      mem->tags[i] = any->tags[location + i];
+      tag_set(mem->tags, i);
       ret = i + 1;
     }
 
@@ -568,7 +616,7 @@ static int ihex2b(const char *infile, FILE *inf, const AVRPART *p, const AVRMEM
       }
       for(int i = 0; i < ihex.reclen; i++) {
         any->buf[nextaddr + i] = ihex.data[below + i];
-        any->tags[nextaddr + i] = TAG_ALLOCATED;
+        tag_set(any->tags, nextaddr + i);
       }
       if(!ovsigck && nextaddr == mulmem[MULTI_SIGROW].base && ihex.reclen >= 3)
         if(!avr_sig_compatible(p->signature, any->buf + nextaddr)) {
@@ -697,10 +745,16 @@ static int b2srec(const AVRMEM *mem, const Segment *segp, Segorder where,
     if(n > bufsize)
       n = bufsize;
 
-    fprintf(outf, "S%c%02X%0*X", datarec, n + addr_width + 1, 2*addr_width, nextaddr);
+    char rec[2 + 2 + 8 + 2*255 + 2 + 1], *r = rec;
+
+    *r++ = 'S', *r++ = datarec;
+    r = puthex(r, n + addr_width + 1, 2, HEXDIGITS);
+    r = puthex(r, nextaddr, 2*addr_width, HEXDIGITS);
     for(int i = 0; i < n; i++)
-      fprintf(outf, "%02X", buf[i]);
-    fprintf(outf, "%02X\n", cksum_srec(buf, n, nextaddr, addr_width));
+      r = puthex(r, buf[i], 2, HEXDIGITS);
+    r = puthex(r, cksum_srec(buf, n, nextaddr, addr_width), 2, HEXDIGITS);
+    *r++ = '\n';
+    fwrite(rec, 1, r - rec, outf);
 
     buf += n;
     nextaddr += n;
@@ -724,77 +778,48 @@ static int b2srec(const AVRMEM *mem, const Segment *segp, Segorder where,
 }
 
 static int srec_readrec(struct ihexsrec *srec, char *rec) {
-  int i, j;
-  char buf[8];
-  int offset, len, addr_width;
-  char *e;
-  unsigned char cksum;
-  int rc;
-
-  len = strlen(rec);
-  offset = 1;
-  cksum = 0;
-  addr_width = 2;
+  const char *s = rec + 1;
+  int addr_width = 2, b;
+  unsigned char cksum = 0;
 
   // Record type
-  if(offset + 1 > len)
+  if(!*s)
     return -1;
-  srec->rectyp = rec[offset++];
+  srec->rectyp = *s++;
   if(srec->rectyp == 0x32 || srec->rectyp == 0x38)
     addr_width = 3;             // S2 or S8-record
   else if(srec->rectyp == 0x33 || srec->rectyp == 0x37)
     addr_width = 4;             // S3 or S7-record
 
   // Reclen
-  if(offset + 2 > len)
-    return -1;
-  for(i = 0; i < 2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  srec->reclen = strtoul(buf, &e, 16);
-  cksum += srec->reclen;
-  srec->reclen -= (addr_width + 1);
-  if(e == buf || *e != 0)
+  if((b = hexbyte(s)) < 0)
     return -1;
+  s += 2;
+  cksum += b;
+  srec->reclen = b - (addr_width + 1);
 
   // Load offset
-  if(offset + addr_width > len)
-    return -1;
-  for(i = 0; i < addr_width*2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  srec->loadofs = strtoull(buf, &e, 16);
-  if(e == buf || *e != 0)
-    return -1;
-
-  for(i = addr_width; i > 0; i--)
-    cksum += (srec->loadofs >> (i - 1)*8) & 0xff;
+  srec->loadofs = 0;
+  for(int i = 0; i < addr_width; i++, s += 2) {
+    if((b = hexbyte(s)) < 0)
+      return -1;
+    srec->loadofs = srec->loadofs << 8 | b;
+    cksum += b;
+  }
 
   // Data
-  for(j = 0; j < srec->reclen; j++) {
-    if(offset + 2 > len)
-      return -1;
-    for(i = 0; i < 2; i++)
-      buf[i] = rec[offset++];
-    buf[i] = 0;
-    srec->data[j] = strtoul(buf, &e, 16);
-    if(e == buf || *e != 0)
+  for(int j = 0; j < srec->reclen; j++, s += 2) {
+    if((b = hexbyte(s)) < 0)
       return -1;
-    cksum += srec->data[j];
+    cksum += srec->data[j] = b;
   }
 
   // Cksum
-  if(offset + 2 > len)
-    return -1;
-  for(i = 0; i < 2; i++)
-    buf[i] = rec[offset++];
-  buf[i] = 0;
-  srec->cksum = strtoul(buf, &e, 16);
-  if(e == buf || *e != 0)
+  if((b = hexbyte(s)) < 0)
     return -1;
+  srec->cksum = b;
 
-  rc = 0xff - cksum;
-  return rc;
+  return 0xff - cksum;
 }
 
 // Motorola S-Record to binary
@@ -926,7 +951,7 @@ static int srec2b(const char *infile, FILE *inf, const AVRPART *p,
       }
       for(int i = 0; i < srec.reclen; i++) {
         any->buf[nextaddr + i] = srec.data[below + i];
-        any->tags[nextaddr + i] = TAG_ALLOCATED;
+        tag_set(any->tags, nextaddr + i);
       }
       if(!ovsigck && nextaddr == mulmem[MULTI_SIGROW].base && srec.reclen >= 3)
         if(!avr_sig_compatible(p->signature, any->buf + nextaddr)) {
@@ -1035,11 +1060,169 @@ static int elf_mem_limits(const AVRMEM *mem, const AVRPART *p,
   return rv;
 }
 
+// Forget the ELF file indexed last
+static void elf_drop(void) {
+  if(cx->fio_elf)
+    (void) elf_end(cx->fio_elf);
+  cx->fio_elf = NULL;
+  mmt_free(cx->fio_elfname);
+  cx->fio_elfname = NULL;
+  mmt_free(cx->fio_elfblocks);
+  cx->fio_elfblocks = NULL;
+  cx->fio_nelfblocks = 0;
+}
+
+static int elfblock_cmp(const void *a, const void *b) {
+  const Fio_elfblock *x = a, *y = b;
+
+  return x->lma < y->lma? -1: x->lma > y->lma? 1: x->d_off < y->d_off? -1: x->d_off > y->d_off;
+}
+
+/*
+ * Open the ELF file once with libelf, preferably memory-mapped, and index
+ * the data blocks of all PROGBITS, ALLOC sections in PT_LOAD segments by
+ * their load memory address. elf2b() then fills each requested memory from
+ * this index; reading further memories of the same unchanged regular file,
+ * eg, with -U ALL:r:file.elf or flash,eeprom, does not revisit the file.
+ */
+static int elf_index(const char *infile, FILE *inf) {
+  struct stat st, named;
+  // Only cache the named file itself, not a spooled pipe or decompressed temporary file
+  int regular = fstat(fileno(inf), &st) == 0 && S_ISREG(st.st_mode) && stat(infile, &named) == 0 &&
+    named.st_dev == st.st_dev && named.st_ino == st.st_ino && named.st_size == st.st_size;
+
+  if(regular && cx->fio_elfname && str_eq(cx->fio_elfname, infile) &&
+    cx->fio_elfsize == (long long) st.st_size && cx->fio_elfmtime == (long long) st.st_mtime)
+    return 0;
+
+  elf_drop();
+  if(elf_version(EV_CURRENT) == EV_NONE) {
+    pmsg_error("ELF library initialization failed: %s\n", elf_errmsg(-1));
+    return -1;
+  }
+
+  Elf *e = elf_begin(fileno(inf), ELF_C_READ_MMAP, NULL);
+
+  if(!e && !(e = elf_begin(fileno(inf), ELF_C_READ, NULL))) {
+    pmsg_error("cannot open %s as an ELF file: %s\n", infile, elf_errmsg(-1));
+    return -1;
+  }
+  cx->fio_elf = e;
+  if(elf_kind(e) != ELF_K_ELF) {
+    pmsg_error("cannot use %s as an ELF input file\n", infile);
+    goto error;
+  }
+
+  size_t isize;
+  const char *id = elf_getident(e, &isize);
+
+  if(id == NULL) {
+    pmsg_error("unable to read ident area of %s: %s\n", infile, elf_errmsg(-1));
+    goto error;
+  }
+  cx->fio_elfclass = id[EI_CLASS];
+  cx->fio_elfdata = id[EI_DATA];
+  cx->fio_elftype = cx->fio_elfmachine = 0;
+  if(cx->fio_elfclass != ELFCLASS32)    // Header checks left to elf2b()
+    goto indexed;
+
+  Elf32_Ehdr *eh;
+
+  if((eh = elf32_getehdr(e)) == NULL) {
+    pmsg_error("unable to read ehdr of %s: %s\n", infile, elf_errmsg(-1));
+    goto error;
+  }
+  cx->fio_elftype = eh->e_type;
+  cx->fio_elfmachine = eh->e_machine;
+  if(eh->e_phnum == 0xffff /* PN_XNUM */) {
+    pmsg_error("ELF file %s uses extended program header numbers which are not expected\n", infile);
+    goto error;
+  }
+
+  Elf32_Phdr *ph;
+
+  if((ph = elf32_getphdr(e)) == NULL) {
+    pmsg_error("unable to read program header table of %s: %s\n", infile, elf_errmsg(-1));
+    goto error;
+  }
+
+  size_t sndx;
+
+  if(elf_getshdrstrndx(e, &sndx) != 0) {
+    pmsg_error("unable to obtain section name string table: %s\n", elf_errmsg(-1));
+    sndx = 0;
+  }
+
+  int nalloc = 0;
+
+  // Walk the program header table, pick up entries of type PT_LOAD that have a non-zero p_filesz
+  for(size_t i = 0; i < eh->e_phnum; i++) {
+    if(ph[i].p_type != PT_LOAD || ph[i].p_filesz == 0)
+      continue;
+
+    pmsg_debug("considering PT_LOAD program header entry #%d\n", (int) i);
+    imsg_debug("p_vaddr 0x%x, p_paddr 0x%x, p_filesz %d\n", ph[i].p_vaddr, ph[i].p_paddr, ph[i].p_filesz);
+
+    Elf_Scn *scn = NULL;
+
+    while((scn = elf_nextscn(e, scn)) != NULL) {
+      size_t ndx = elf_ndxscn(scn);
+      Elf32_Shdr *sh = elf32_getshdr(scn);
+
+      if(sh == NULL) {
+        pmsg_error("unable to read section #%u header: %s\n", (unsigned int) ndx, elf_errmsg(-1));
+        goto error;
+      }
+      // Only interested in non-empty PROGBITS, ALLOC sections that belong to this segment
+      if((sh->sh_flags & SHF_ALLOC) == 0 || sh->sh_type != SHT_PROGBITS || sh->sh_size == 0)
+        continue;
+      if(!is_section_in_segment(sh, ph + i))
+        continue;
+
+      const char *sname = sndx? elf_strptr(e, sndx, sh->sh_name): "*unknown*";
+      unsigned int lma = ph[i].p_paddr + sh->sh_offset - ph[i].p_offset;
+
+      pmsg_debug("found section %s, LMA 0x%x, sh_size %u\n", sname, lma, sh->sh_size);
+
+      Elf_Data *d = NULL;
+
+      while((d = elf_getdata(scn, d)) != NULL) {
+        if(cx->fio_nelfblocks >= nalloc) {
+          nalloc = nalloc? 2*nalloc: 16;
+          cx->fio_elfblocks = mmt_realloc(cx->fio_elfblocks, nalloc*sizeof *cx->fio_elfblocks);
+        }
+        Fio_elfblock *eb = cx->fio_elfblocks + cx->fio_nelfblocks++;
+
+        eb->lma = lma;
+        eb->secsize = sh->sh_size;
+        eb->d_off = d->d_off;
+        eb->d_size = d->d_size;
+        eb->data = d->d_buf;
+        eb->sname = cache_string(sname? sname: "*unknown*");
+      }
+    }
+  }
+  if(cx->fio_nelfblocks > 1)
+    qsort(cx->fio_elfblocks, cx->fio_nelfblocks, sizeof *cx->fio_elfblocks, elfblock_cmp);
+
+indexed:
+  (void) elf_cntl(e, ELF_C_FDREAD);     // Section data are now in memory: libelf no longer needs the file
+  if(regular) {
+    cx->fio_elfname = mmt_strdup(infile);
+    cx->fio_elfsize = st.st_size;
+    cx->fio_elfmtime = st.st_mtime;
+  }
+  return 0;
+
+error:
+  elf_drop();
+  return -1;
+}
+
 // ELF format to binary (the memory segment to read into is ignored)
 static int elf2b(const char *infile, FILE *inf, const AVRMEM *mem,
   const AVRPART *p, const Segment *segp_unused, unsigned int fileoffset_unused) {
 
-  Elf *e;
   int rv = 0, size = 0;
   unsigned int low, high, foff;
 
@@ -1066,26 +1249,8 @@ static int elf2b(const char *infile, FILE *inf, const AVRMEM *mem,
     high = low + mem->size - 1;
   }
 
-  if(elf_version(EV_CURRENT) == EV_NONE) {
-    pmsg_error("ELF library initialization failed: %s\n", elf_errmsg(-1));
-    return -1;
-  }
-  if((e = elf_begin(fileno(inf), ELF_C_READ, NULL)) == NULL) {
-    pmsg_error("cannot open %s as an ELF file: %s\n", infile, elf_errmsg(-1));
+  if(elf_index(infile, inf) < 0)
     return -1;
-  }
-  if(elf_kind(e) != ELF_K_ELF) {
-    pmsg_error("cannot use %s as an ELF input file\n", infile);
-    goto done;
-  }
-
-  size_t i, isize;
-  const char *id = elf_getident(e, &isize);
-
-  if(id == NULL) {
-    pmsg_error("unable to read ident area of %s: %s\n", infile, elf_errmsg(-1));
-    goto done;
-  }
 
   const char *endianname;
   unsigned char endianness;
@@ -1097,19 +1262,11 @@ static int elf2b(const char *infile, FILE *inf, const AVRMEM *mem,
     endianness = ELFDATA2LSB;
     endianname = "big";
   }
-  if(id[EI_CLASS] != ELFCLASS32 || id[EI_DATA] != endianness) {
+  if(cx->fio_elfclass != ELFCLASS32 || cx->fio_elfdata != endianness) {
     pmsg_error("ELF file %s is not a 32-bit, %s-endian file that was expected\n", infile, endianname);
     goto done;
   }
-
-  Elf32_Ehdr *eh;
-
-  if((eh = elf32_getehdr(e)) == NULL) {
-    pmsg_error("unable to read ehdr of %s: %s\n", infile, elf_errmsg(-1));
-    goto done;
-  }
-
-  if(eh->e_type != ET_EXEC) {
+  if(cx->fio_elftype != ET_EXEC) {
     pmsg_error("ELF file %s is not an executable file\n", infile);
     goto done;
   }
@@ -1124,138 +1281,131 @@ static int elf2b(const char *infile, FILE *inf, const AVRMEM *mem,
     machine = EM_AVR;
     mname = "AVR";
   }
-  if(eh->e_machine != machine) {
+  if(cx->fio_elfmachine != machine) {
     pmsg_error("ELF file %s is not for machine %s\n", infile, mname);
     goto done;
   }
-  if(eh->e_phnum == 0xffff /* PN_XNUM */) {
-    pmsg_error("ELF file %s uses extended program header numbers which are not expected\n", infile);
-    goto done;
-  }
-
-  Elf32_Phdr *ph;
 
-  if((ph = elf32_getphdr(e)) == NULL) {
-    pmsg_error("unable to read program header table of %s: %s\n", infile, elf_errmsg(-1));
-    goto done;
-  }
+  // Blocks are sorted by section LMA: skip those below the memory with a binary search
+  int lo = 0, hi = cx->fio_nelfblocks;
 
-  size_t sndx;
+  while(lo < hi) {
+    int mid = (lo + hi)/2;
 
-  if(elf_getshdrstrndx(e, &sndx) != 0) {
-    pmsg_error("unable to obtain section name string table: %s\n", elf_errmsg(-1));
-    sndx = 0;
+    if(cx->fio_elfblocks[mid].lma < low)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
-  /*
-   * Walk the program header table, pick up entries that are of type PT_LOAD,
-   * and have a non-zero p_filesz.
-   */
-  for(i = 0; i < eh->e_phnum; i++) {
-    if(ph[i].p_type != PT_LOAD || ph[i].p_filesz == 0)
-      continue;
-
-    pmsg_debug("considering PT_LOAD program header entry #%d\n", (int) i);
-    imsg_debug("p_vaddr 0x%x, p_paddr 0x%x, p_filesz %d\n", ph[i].p_vaddr, ph[i].p_paddr, ph[i].p_filesz);
-
-    Elf_Scn *scn = NULL;
+  for(int b = lo; b < cx->fio_nelfblocks; b++) {
+    const Fio_elfblock *eb = cx->fio_elfblocks + b;
+    unsigned int lma = eb->lma;
 
-    while((scn = elf_nextscn(e, scn)) != NULL) {
-      size_t ndx = elf_ndxscn(scn);
-      Elf32_Shdr *sh = elf32_getshdr(scn);
+    if(lma >= high)
+      break;
+    if(!(lma + eb->secsize < high)) {
+      pmsg_debug("skipping %s (inappropriate for %s)\n", eb->sname, mem->desc);
+      continue;
+    }
+    /*
+     * 1-byte sized memory regions are special: they are used for fuse bits,
+     * where multiple regions (in the config file) map to a single, larger
+     * region in the ELF file (e.g. "lfuse", "hfuse", and "efuse" all map to
+     * ".fuse").  We silently accept a larger ELF file region for these, and
+     * extract the actual byte to write from it, using the "foff" offset
+     * obtained above.
+     */
+    if(mem->size != 1 && eb->secsize > (unsigned) mem->size) {
+      if(eb->d_off == 0)        // Complain once per section
+        pmsg_error("section %s of size %u does not fit into %s of size %d\n",
+          eb->sname, eb->secsize, mem->desc, mem->size);
+      rv = -1;
+      continue;
+    }
 
-      if(sh == NULL) {
-        pmsg_error("unable to read section #%u header: %s\n", (unsigned int) ndx, elf_errmsg(-1));
+    pmsg_debug("data block of section %s: LMA 0x%x, d_off 0x%x, d_size %u\n",
+      eb->sname, lma, eb->d_off, eb->d_size);
+    if(mem->size == 1) {
+      if(eb->d_off != 0) {
+        pmsg_error("unexpected data block at offset != 0\n");
         rv = -1;
-        continue;
-      }
-      // Only interested in PROGBITS, ALLOC sections
-      if((sh->sh_flags & SHF_ALLOC) == 0 || sh->sh_type != SHT_PROGBITS)
-        continue;
-      // Not interested in empty sections
-      if(sh->sh_size == 0)
-        continue;
-      // Section must belong to this segment
-      if(!is_section_in_segment(sh, ph + i))
-        continue;
-
-      const char *sname = sndx? elf_strptr(e, sndx, sh->sh_name): "*unknown*";
-      unsigned int lma = ph[i].p_paddr + sh->sh_offset - ph[i].p_offset;
-
-      pmsg_debug("found section %s, LMA 0x%x, sh_size %u\n", sname, lma, sh->sh_size);
-
-      if(!(lma >= low && lma + sh->sh_size < high)) {
-        pmsg_debug("skipping %s (inappropriate for %s)\n", sname, mem->desc);
-        continue;
-      }
-      /*
-       * 1-byte sized memory regions are special: they are used for fuse bits,
-       * where multiple regions (in the config file) map to a single, larger
-       * region in the ELF file (e.g. "lfuse", "hfuse", and "efuse" all map to
-       * ".fuse").  We silently accept a larger ELF file region for these, and
-       * extract the actual byte to write from it, using the "foff" offset
-       * obtained above.
-       */
-      if(mem->size != 1 && sh->sh_size > (unsigned) mem->size) {
-        pmsg_error("section %s of size %u does not fit into %s of size %d\n",
-          sname, sh->sh_size, mem->desc, mem->size);
+      } else if(foff >= eb->d_size) {
+        pmsg_error("ELF file section does not contain byte at offset %d\n", foff);
         rv = -1;
-        continue;
+      } else {
+        pmsg_debug("extracting one byte from file offset %d\n", foff);
+        mem->buf[0] = eb->data[foff];
+        tag_set(mem->tags, 0);
+        size = 1;
       }
-
-      Elf_Data *d = NULL;
-
-      while((d = elf_getdata(scn, d)) != NULL) {
-        pmsg_debug("data block: d_buf %p, d_off 0x%x, d_size %ld\n",
-          d->d_buf, (unsigned int) d->d_off, (long) d->d_size);
-        if(mem->size == 1) {
-          if(d->d_off != 0) {
-            pmsg_error("unexpected data block at offset != 0\n");
-            rv = -1;
-          } else if(foff >= d->d_size) {
-            pmsg_error("ELF file section does not contain byte at offset %d\n", foff);
-            rv = -1;
-          } else {
-            pmsg_debug("extracting one byte from file offset %d\n", foff);
-            mem->buf[0] = ((unsigned char *) d->d_buf)[foff];
-            mem->tags[0] = TAG_ALLOCATED;
-            size = 1;
-          }
-        } else {
-          int idx = lma - low + d->d_off;
-          int end = idx + d->d_size;
-
-          if(idx >= 0 && idx < mem->size && end >= 0 && end <= mem->size && end - idx >= 0) {
-            if(end > size)
-              size = end;
-            pmsg_debug("writing %d bytes to mem offset 0x%x\n", end - idx, idx);
-            memcpy(mem->buf + idx, d->d_buf, end - idx);
-            memset(mem->tags + idx, TAG_ALLOCATED, end - idx);
-          } else {
-            pmsg_error("section %s [0x%04x, 0x%04x] does not fit into %s [0, 0x%04x]\n",
-              sname, idx, (int) (idx + d->d_size - 1), mem->desc, mem->size - 1);
-            rv = -1;
-          }
-        }
+    } else {
+      int idx = lma - low + eb->d_off;
+      int end = idx + eb->d_size;
+
+      if(idx >= 0 && idx < mem->size && end >= 0 && end <= mem->size && end - idx >= 0) {
+        if(end > size)
+          size = end;
+        pmsg_debug("writing %d bytes to mem offset 0x%x\n", end - idx, idx);
+        memcpy(mem->buf + idx, eb->data, end - idx);
+        tag_set_range(mem->tags, idx, end - idx);
+      } else {
+        pmsg_error("section %s [0x%04x, 0x%04x] does not fit into %s [0, 0x%04x]\n",
+          eb->sname, idx, (int) (idx + eb->d_size - 1), mem->desc, mem->size - 1);
+        rv = -1;
       }
     }
   }
 done:
-  (void) elf_end(e);
+  if(!cx->fio_elfname)          // Not a regular file: drop the index right away
+    elf_drop();
   return rv < 0? rv: size;
 }
 #endif                          // HAVE_LIBELF
 
 // Read/write binary files and return highest memory addr set + 1
+#if !defined(WIN32)
+/*
+ * Read up to len bytes at the current position of regular file f into buf by
+ * copying them straight out of a read-only mapping of the file, bypassing
+ * stdio buffering; advances the file position and returns the number of
+ * bytes read or -1 if the file cannot be mapped
+ */
+static int rbin_mmap_read(FILE *f, unsigned char *buf, int len) {
+  struct stat st;
+  long pos = ftell(f);
+
+  if(pos < 0 || fstat(fileno(f), &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= pos)
+    return -1;
+
+  size_t n = st.st_size - pos < (off_t) len? (size_t) (st.st_size - pos): (size_t) len;
+  void *map = mmap(NULL, pos + n, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+
+  if(map == MAP_FAILED)
+    return -1;
+  memcpy(buf, (unsigned char *) map + pos, n);
+  munmap(map, pos + n);
+
+  return fseek(f, pos + n, SEEK_SET) < 0? -1: (int) n;
+}
+#endif
+
 static int fileio_rbin(struct fioparms *fio, const char *filename, FILE *f, const AVRMEM *mem, const Segment *segp) {
 
   int rc;
 
   switch(fio->op) {
   case FIO_READ:
+#if !defined(WIN32)
+    if(f != stdin && (rc = rbin_mmap_read(f, mem->buf + segp->addr, segp->len)) >= 0) {
+      if(rc > 0)
+        tag_set_range(mem->tags, segp->addr, rc);
+      break;
+    }
+#endif
     rc = fread(mem->buf + segp->addr, 1, segp->len, f);
     if(rc > 0)
-      memset(mem->tags + segp->addr, TAG_ALLOCATED, rc);
+      tag_set_range(mem->tags, segp->addr, rc);
     break;
   case FIO_WRITE:
     rc = fwrite(mem->buf + segp->addr, 1, segp->len, f);
@@ -1293,7 +1443,7 @@ static int fileio_imm(struct fioparms *fio, const char *fname, FILE *f_unused,
         mmt_free(line);
         return -1;
       }
-      memset(mem->tags + n, TAG_ALLOCATED, set);
+      tag_set_range(mem->tags, n, set);
       n += set;
     }
     break;
@@ -1320,7 +1470,7 @@ static int fileio_ihex(struct fioparms *fio, const char *filename, FILE *f,
 
   switch(fio->op) {
   case FIO_WRITE:
-    rc = b2ihex(p, mem, segp, where, 32, fio->fileoffset, filename, f, ffmt);
+    rc = b2ihex(p, mem, segp, where, FIO_RECSIZE, fio->fileoffset, filename, f, ffmt);
     break;
 
   case FIO_READ:
@@ -1342,7 +1492,7 @@ static int fileio_srec(struct fioparms *fio, const char *filename, FILE *f,
 
   switch(fio->op) {
   case FIO_WRITE:
-    rc = b2srec(mem, segp, where, 32, fio->fileoffset, filename, f);
+    rc = b2srec(mem, segp, where, FIO_RECSIZE, fio->fileoffset, filename, f);
     break;
 
   case FIO_READ:
@@ -1381,8 +1531,270 @@ static int fileio_elf(struct fioparms *fio, const char *filename, FILE *f,
 }
 #endif
 
-static int b2num(const char *filename, FILE *f, const AVRMEM *mem, const Segment *segp, FILEFMT fmt) {
-  const char *prefix;
+/*
+ * AVRDUDE page image (:p)
+ *
+ * A binary file that stores one or more memories as sparse page records, each
+ * with the CRC-32 of its contents, so that the record headers double as a
+ * manifest of the image. All numbers are little endian.
+ *   - Header: 8 magic bytes "\211API\r\n\032\n", u16 version 1, u16 flags (bit 0:
+ *     multi-memory file with the flat addresses above), u8 n, n bytes part id
+ *   - Memory record: 'M', u32 address, u32 size, u32 page size, u8 n, n bytes
+ *     name; it precedes the page records of that memory
+ *   - Page record: 'P', u32 address, u32 length, u32 CRC-32 of the data, u8 flags
+ *     (reserved, 0), the data
+ *   - End record: 'E', u32 number of page records, u32 CRC-32 of the file so far
+ * Pages are aligned to the page size of their memory, or to 256 bytes for
+ * unpaged memories. As with avr_mem_hiaddr(), all-0xff flash pages are left
+ * out unless the trailing 0xff optimisation is switched off.
+ */
+
+static const unsigned char pimg_magic[8] = { 0211, 'A', 'P', 'I', '\r', '\n', 032, '\n' };
+
+#define PIMG_VERSION 1
+#define PIMG_MULTI 1            // Header flag
+#define PIMG_MAXPAGE (1 << 16)
+
+static unsigned char *pimg_put(unsigned char *s, unsigned long val, int n) {
+  for(int i = 0; i < n; i++, val >>= 8)
+    *s++ = val;
+  return s;
+}
+
+static unsigned long pimg_get(const unsigned char *s, int n) {
+  unsigned long ret = 0;
+
+  for(int i = n - 1; i >= 0; i--)
+    ret = ret << 8 | s[i];
+  return ret;
+}
+
+// Write n bytes and keep track of the CRC of the file
+static int pimg_write(FILE *f, const unsigned char *buf, size_t n) {
+  cx->fio_pimgcrc = crc32sum(buf, n, cx->fio_pimgcrc);
+  return fwrite(buf, 1, n, f) == n? 0: -1;
+}
+
+// Read n bytes updating the file CRC in *crcp; return 0 on EOF at the start
+static int pimg_read(FILE *f, unsigned char *buf, size_t n, unsigned long *crcp) {
+  size_t got = fread(buf, 1, n, f);
+
+  *crcp = crc32sum(buf, got, *crcp);
+  return got;
+}
+
+static int b2pimg(const AVRPART *p, const AVRMEM *mem, const Segment *segp, Segorder where,
+  int fileoffset, const char *outfile, FILE *outf) {
+
+  int multi = mem->size >= (int) ANY_MEM_SIZE;
+  unsigned char hdr[8 + 2 + 2 + 1 + 255 + 1 + 4 + 4 + 4 + 1 + 255], *s = hdr;
+  const char *id = p->id? p->id: "";
+  int len = strlen(id) > 255? 255: strlen(id);
+
+  if(where & FIRST_SEG) {
+    cx->fio_pimgcrc = 0;
+    cx->fio_pimgrecs = 0;
+    memcpy(s, pimg_magic, sizeof pimg_magic);
+    s = pimg_put(s + sizeof pimg_magic, PIMG_VERSION, 2);
+    s = pimg_put(s, multi? PIMG_MULTI: 0, 2);
+    *s++ = len;
+    memcpy(s, id, len);
+    s += len;
+  }
+
+  // Memory record with the page size for the page records
+  const AVRMEM *m = multi? flatmem(p, segp->addr, segp->len): mem;
+  const char *name = m? avr_mem_name(p, m): "unknown";
+  int pgsize = m && m->page_size > 1 && m->page_size <= PIMG_MAXPAGE? m->page_size: 256;
+  unsigned base = multi? segp->addr: 0;
+
+  len = strlen(name) > 255? 255: strlen(name);
+  *s++ = 'M';
+  s = pimg_put(s, base + fileoffset, 4);
+  s = pimg_put(s, m? m->size: segp->len, 4);
+  s = pimg_put(s, pgsize, 4);
+  *s++ = len;
+  memcpy(s, name, len);
+  s += len;
+  if(pimg_write(outf, hdr, s - hdr) < 0)
+    goto error;
+
+  int skipff = !cx->avr_disableffopt && m && mem_is_in_flash(m);
+  unsigned char *rec = mmt_malloc(14 + pgsize);
+
+  for(int addr = segp->addr, end = segp->addr + segp->len, n; addr < end; addr += n) {
+    n = pgsize - (addr - base)%pgsize;
+    if(n > end - addr)
+      n = end - addr;
+    if(skipff && is_memset(mem->buf + addr, 0xff, n))
+      continue;
+
+    s = rec;
+    *s++ = 'P';
+    s = pimg_put(s, addr + fileoffset, 4);
+    s = pimg_put(s, n, 4);
+    s = pimg_put(s, crc32sum(mem->buf + addr, n, 0), 4);
+    *s++ = 0;
+    memcpy(s, mem->buf + addr, n);
+    s += n;
+    if(pimg_write(outf, rec, s - rec) < 0) {
+      mmt_free(rec);
+      goto error;
+    }
+    cx->fio_pimgrecs++;
+  }
+  mmt_free(rec);
+
+  if(where & LAST_SEG) {
+    s = hdr;
+    *s++ = 'E';
+    s = pimg_put(s, cx->fio_pimgrecs, 4);
+    s = pimg_put(s, cx->fio_pimgcrc, 4);
+    if(pimg_write(outf, hdr, s - hdr) < 0)
+      goto error;
+  }
+
+  return segp->addr + segp->len;
+
+error:
+  pmsg_ext_error("unable to write to %s: %s\n", outfile, strerror(errno));
+  return -1;
+}
+
+/*
+ * Page image to binary buffer: copy the set bytes of those page records that
+ * fall into the segment segp of mem, which is located at its flat address
+ * when reading a multi-memory image. The CRC of each page and of the whole
+ * file is checked.
+ *
+ * Return 0 if nothing was written, otherwise the maximum memory address within
+ * mem->buf that was written plus one. On error, return -1.
+ */
+static int pimg2b(const char *infile, FILE *inf, const AVRPART *p, const AVRMEM *mem,
+  const Segment *segp, int fileoffset) {
+
+  unsigned char hdr[8 + 2 + 2 + 1 + 255], *data = NULL;
+  unsigned long crc = 0;
+  int rc = -1, maxaddr = 0, nrecs = 0, type;
+
+  rewind(inf);
+  if(pimg_read(inf, hdr, 13, &crc) != 13 || memcmp(hdr, pimg_magic, sizeof pimg_magic)) {
+    pmsg_error("%s is not a page image\n", infile);
+    return -1;
+  }
+  if(pimg_get(hdr + 8, 2) != PIMG_VERSION) {
+    pmsg_error("unsupported page image version %lu in %s\n", pimg_get(hdr + 8, 2), infile);
+    return -1;
+  }
+  int multi = pimg_get(hdr + 10, 2) & PIMG_MULTI, len = hdr[12];
+
+  if(pimg_read(inf, hdr, len, &crc) != len)
+    goto truncated;
+  hdr[len] = 0;
+  if(*hdr && p->id && !str_caseeq((char *) hdr, p->id))
+    pmsg_warning("page image %s was generated for part %s, not %s\n", infile, (char *) hdr, p->id);
+
+  unsigned location = multi && mem->size < (int) ANY_MEM_SIZE? fileio_mem_offset(p, mem): 0;
+
+  if(location == ~0U)
+    return -1;
+  if(!multi)
+    location -= fileoffset;
+
+  // Window of interest in file addresses
+  unsigned lo = location + segp->addr, hi = lo + segp->len;
+
+  while((type = fgetc(inf)) != EOF) {
+    unsigned char c = type, r[13];
+    unsigned long before = crc;   // The end record holds the CRC of the file before it
+
+    crc = crc32sum(&c, 1, crc);
+    switch(type) {
+    case 'M':
+      if(pimg_read(inf, r, 13, &crc) != 13 || pimg_read(inf, hdr, r[12], &crc) != r[12])
+        goto truncated;
+      hdr[r[12]] = 0;
+      pmsg_debug("page image memory %s at 0x%06lx, size %lu, page size %lu\n", (char *) hdr,
+        pimg_get(r, 4), pimg_get(r + 4, 4), pimg_get(r + 8, 4));
+      break;
+
+    case 'P': {
+      if(pimg_read(inf, r, 13, &crc) != 13)
+        goto truncated;
+      unsigned addr = pimg_get(r, 4), n = pimg_get(r + 4, 4), pcrc = pimg_get(r + 8, 4);
+
+      if(n == 0 || n > PIMG_MAXPAGE) {
+        pmsg_error("invalid page length %u at 0x%06x in %s\n", n, addr, infile);
+        goto done;
+      }
+      data = mmt_realloc(data, n);
+      if(pimg_read(inf, data, n, &crc) != (int) n)
+        goto truncated;
+      if(crc32sum(data, n, 0) != pcrc) {
+        pmsg_error("CRC mismatch of page at 0x%06x in %s\n", addr, infile);
+        goto done;
+      }
+      nrecs++;
+      // Copy the part of the page that overlaps the window
+      unsigned from = addr > lo? addr: lo, to = addr + n < hi? addr + n: hi;
+
+      if(from < to) {
+        memcpy(mem->buf + from - location, data + from - addr, to - from);
+        tag_set_range(mem->tags, from - location, to - from);
+        if((int) (to - location) > maxaddr)
+          maxaddr = to - location;
+      }
+      break;
+    }
+
+    case 'E':
+      if(fread(r, 1, 8, inf) != 8)
+        goto truncated;
+      if((int) pimg_get(r, 4) != nrecs || pimg_get(r + 4, 4) != before) {
+        pmsg_error("page image %s is corrupt: end record does not match contents\n", infile);
+        goto done;
+      }
+      rc = maxaddr;
+      goto done;
+
+    default:
+      pmsg_error("invalid record type 0x%02x in page image %s\n", type, infile);
+      goto done;
+    }
+  }
+
+truncated:
+  pmsg_error("page image %s is truncated\n", infile);
+
+done:
+  mmt_free(data);
+  return rc;
+}
+
+static int fileio_pimg(struct fioparms *fio, const char *filename, FILE *f,
+  const AVRPART *p, const AVRMEM *mem, const Segment *segp, Segorder where) {
+
+  int rc;
+
+  switch(fio->op) {
+  case FIO_WRITE:
+    rc = b2pimg(p, mem, segp, where, fio->fileoffset, filename, f);
+    break;
+
+  case FIO_READ:
+    rc = pimg2b(filename, f, p, mem, segp, fio->fileoffset);
+    break;
+
+  default:
+    rc = -1;
+    pmsg_error("invalid page image file I/O operation=%d\n", fio->op);
+  }
+
+  return rc < 0? -1: rc;
+}
+
+static int b2num(const char *filename, FILE *f, const AVRMEM *mem, const Segment *segp, FILEFMT fmt) {
+  const char *prefix;
   int base;
 
   switch(fmt) {
@@ -1467,7 +1879,7 @@ static int num2b(const char *filename, FILE *f, const AVRMEM *mem, const Segment
           mmt_free(line);
           return -1;
         }
-        memset(mem->tags + n, TAG_ALLOCATED, set);
+        tag_set_range(mem->tags, n, set);
         n += set;
       }
     }
@@ -1539,6 +1951,384 @@ FILE *fileio_fopenr(const char *fname) {
 #endif
 }
 
+/*
+ * Compressed files: input is recognised as gzip, xz or zstd compressed by its
+ * magic bytes and decompressed in memory before it is parsed; output to a file
+ * name ending in .gz, .xz or .zst is collected in memory and compressed once
+ * complete. Which methods are available depends on the libraries at build time.
+ */
+
+typedef enum {
+  ZIP_NONE,
+  ZIP_GZIP,
+  ZIP_XZ,
+  ZIP_ZSTD,
+  ZIP_N,
+} Zipmethod;
+
+static const struct {
+  const char *name, *suffix;
+  int nmagic;
+  unsigned char magic[6];
+  int compiled_in;
+} zipmethods[ZIP_N] = {
+  {"", "", 0, {0}, 0},
+#ifdef HAVE_LIBZ
+  {"gzip", ".gz", 2, {0x1f, 0x8b}, 1},
+#else
+  {"gzip", ".gz", 2, {0x1f, 0x8b}, 0},
+#endif
+#ifdef HAVE_LIBLZMA
+  {"xz", ".xz", 6, {0xfd, '7', 'z', 'X', 'Z', 0}, 1},
+#else
+  {"xz", ".xz", 6, {0xfd, '7', 'z', 'X', 'Z', 0}, 0},
+#endif
+#ifdef HAVE_LIBZSTD
+  {"zstd", ".zst", 4, {0x28, 0xb5, 0x2f, 0xfd}, 1},
+#else
+  {"zstd", ".zst", 4, {0x28, 0xb5, 0x2f, 0xfd}, 0},
+#endif
+};
+
+#define ZIP_MAXSIZE (1 << 28)   // Refuse to decompress to more than 256 MiB
+
+// Compression method from the magic bytes at the current position of the seekable stream f
+static Zipmethod zip_magic(FILE *f) {
+  unsigned char buf[6];
+  long pos = ftell(f);
+  size_t n = pos < 0? 0: fread(buf, 1, sizeof buf, f);
+
+  if(pos < 0 || fseek(f, pos, SEEK_SET) < 0)
+    return ZIP_NONE;
+  for(int z = ZIP_GZIP; z < ZIP_N; z++)
+    if(n >= (size_t) zipmethods[z].nmagic && !memcmp(buf, zipmethods[z].magic, zipmethods[z].nmagic))
+      return z;
+
+  return ZIP_NONE;
+}
+
+// Compression method implied by the file name suffix
+static Zipmethod zip_suffix(const char *fname) {
+  for(int z = ZIP_GZIP; z < ZIP_N; z++)
+    if(str_caseends(fname, zipmethods[z].suffix))
+      return z;
+
+  return ZIP_NONE;
+}
+
+static int zip_compiled_in(Zipmethod z, const char *fname) {
+  if(zipmethods[z].compiled_in)
+    return 1;
+  pmsg_error("cannot handle %s compressed file %s, %s support was not compiled in\n",
+    zipmethods[z].name, fname, zipmethods[z].name);
+  return 0;
+}
+
+#if defined(HAVE_LIBZ) || defined(HAVE_LIBLZMA) || defined(HAVE_LIBZSTD)
+// Ensure there are at least 32 kB free at the end of the buffer
+static int zip_grow(unsigned char **bufp, size_t *capp, size_t n, const char *fname) {
+  if(*capp - n >= 1 << 15)
+    return 0;
+  if(*capp >= ZIP_MAXSIZE) {
+    pmsg_error("decompressed %s exceeds %d MiB\n", fname, ZIP_MAXSIZE >> 20);
+    return -1;
+  }
+  *capp *= 2;
+  *bufp = mmt_realloc(*bufp, *capp);
+
+  return 0;
+}
+#endif
+
+// Decompress the remainder of f into an allocated buffer of *np bytes; return NULL on error
+static unsigned char *zip_inflate(FILE *f, Zipmethod z, const char *fname, size_t *np) {
+  if(!zip_compiled_in(z, fname))
+    return NULL;
+
+#if defined(HAVE_LIBZ) || defined(HAVE_LIBLZMA) || defined(HAVE_LIBZSTD)
+  size_t cap = 1 << 16, n = 0;
+  unsigned char *out = mmt_malloc(cap), *in = mmt_malloc(1 << 16);
+  int ok = 0, full = 0;
+
+  switch(z) {
+#ifdef HAVE_LIBZ
+  case ZIP_GZIP: {
+    z_stream zs;
+    int ret = Z_OK;
+
+    memset(&zs, 0, sizeof zs);
+    if(inflateInit2(&zs, 15 + 32) != Z_OK)
+      break;
+    for(;;) {
+      if(!zs.avail_in && !full) {
+        zs.next_in = in;
+        if(!(zs.avail_in = fread(in, 1, 1 << 16, f)))
+          break;
+      }
+      if(ret == Z_STREAM_END) { // Concatenated member; trailing garbage is ignored as by gunzip
+        if(*zs.next_in != 0x1f)
+          break;
+        inflateReset(&zs);
+      }
+      if(zip_grow(&out, &cap, n, fname) < 0)
+        break;
+      zs.next_out = out + n;
+      zs.avail_out = cap - n;
+      ret = inflate(&zs, Z_NO_FLUSH);
+      n = zs.next_out - out;
+      full = zs.avail_out == 0;
+      if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+        pmsg_error("gzip decompression of %s failed: %s\n", fname, zs.msg? zs.msg: "unknown error");
+        break;
+      }
+    }
+    ok = ret == Z_STREAM_END;
+    inflateEnd(&zs);
+    break;
+  }
+#endif
+
+#ifdef HAVE_LIBLZMA
+  case ZIP_XZ: {
+    lzma_stream ls = LZMA_STREAM_INIT;
+    lzma_action action = LZMA_RUN;
+    lzma_ret ret;
+
+    if(lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+      break;
+    for(;;) {
+      if(!ls.avail_in && action == LZMA_RUN) {
+        ls.next_in = in;
+        if(!(ls.avail_in = fread(in, 1, 1 << 16, f)))
+          action = LZMA_FINISH;
+      }
+      if(zip_grow(&out, &cap, n, fname) < 0)
+        break;
+      ls.next_out = out + n;
+      ls.avail_out = cap - n;
+      ret = lzma_code(&ls, action);
+      n = ls.next_out - out;
+      if(ret == LZMA_STREAM_END) {
+        ok = 1;
+        break;
+      }
+      if(ret == LZMA_BUF_ERROR && action == LZMA_FINISH) // Truncated input
+        break;
+      if(ret != LZMA_OK) {
+        pmsg_error("xz decompression of %s failed (error %d)\n", fname, (int) ret);
+        break;
+      }
+    }
+    lzma_end(&ls);
+    break;
+  }
+#endif
+
+#ifdef HAVE_LIBZSTD
+  case ZIP_ZSTD: {
+    ZSTD_DStream *zd = ZSTD_createDStream();
+    ZSTD_inBuffer ib = { in, 0, 0 };
+    size_t ret = 1;
+
+    if(!zd)
+      break;
+    ZSTD_initDStream(zd);
+    for(;;) {
+      if(ib.pos == ib.size && !full) {
+        ib.pos = 0;
+        if(!(ib.size = fread(in, 1, 1 << 16, f)))
+          break;
+      }
+      if(zip_grow(&out, &cap, n, fname) < 0)
+        break;
+      ZSTD_outBuffer ob = { out + n, cap - n, 0 };
+
+      ret = ZSTD_decompressStream(zd, &ob, &ib);
+      n += ob.pos;
+      full = ob.pos == ob.size;
+      if(ZSTD_isError(ret)) {
+        pmsg_error("zstd decompression of %s failed: %s\n", fname, ZSTD_getErrorName(ret));
+        break;
+      }
+    }
+    ok = ret == 0;
+    ZSTD_freeDStream(zd);
+    break;
+  }
+#endif
+
+  default:
+    break;
+  }
+
+  if(ferror(f)) {
+    pmsg_ext_error("cannot read %s: %s\n", fname, strerror(errno));
+    ok = 0;
+  } else if(!ok && feof(f))
+    pmsg_error("%s compressed file %s is truncated\n", zipmethods[z].name, fname);
+  mmt_free(in);
+  if(!ok) {
+    mmt_free(out);
+    return NULL;
+  }
+  *np = n;
+  return out;
+#else
+  return NULL;
+#endif
+}
+
+/*
+ * Open a read stream on the n bytes of buf: in memory where possible, otherwise,
+ * and always for ELF files as libelf needs a file descriptor, in a temporary file
+ */
+static FILE *zip_istream(unsigned char *buf, size_t n, const char *fname) {
+  FILE *f = NULL;
+
+#if !defined(WIN32)
+  if(n > 0 && !(n >= 4 && !memcmp(buf, "\177ELF", 4)))
+    f = fmemopen(buf, n, "r");
+#endif
+  if(!f && (f = tmpfile())) {
+    if(fwrite(buf, 1, n, f) != n) {
+      fclose(f);
+      f = NULL;
+    } else
+      rewind(f);
+  }
+  if(!f)
+    pmsg_ext_error("cannot buffer decompressed %s: %s\n", fname, strerror(errno));
+
+  return f;
+}
+
+/*
+ * Return a stream with the decompressed contents of the seekable stream f if it
+ * is compressed; f is closed then unless it is stdin, and *bufp must be freed
+ * after closing the returned stream. Return f if it is not compressed and NULL
+ * on error. For raw binary input only files with a compression suffix count.
+ */
+static FILE *zip_open_input(FILE *f, const char *fname, FILEFMT format, unsigned char **bufp) {
+  Zipmethod z = zip_magic(f);
+
+  if(!z || (format == FMT_RBIN && zip_suffix(fname) != z))
+    return f;
+
+  size_t n = 0;
+  unsigned char *buf = zip_inflate(f, z, fname, &n);
+  FILE *ret = buf? zip_istream(buf, n, fname): NULL;
+
+  if(f != stdin)
+    fclose(f);
+  if(ret)
+    pmsg_debug("%s file %s decompressed to %lu bytes\n", zipmethods[z].name, fname, (unsigned long) n);
+  *bufp = buf;
+
+  return ret;
+}
+
+/*
+ * Open a stream collecting output that is to be compressed on closing; this is in
+ * memory where possible and otherwise a temporary file
+ */
+static FILE *zip_open_output(char **bufp, size_t *sizep) {
+  *bufp = NULL;
+  *sizep = 0;
+#if !defined(WIN32)
+  return open_memstream(bufp, sizep);
+#else
+  return tmpfile();
+#endif
+}
+
+// Close the output stream f and write its compressed contents to out, which is closed, too
+static int zip_close_output(FILE *f, char **bufp, size_t *sizep, FILE *out, Zipmethod z,
+  const char *fname) {
+
+  int ok = 0;
+  size_t n, nz = 0;
+  unsigned char *zbuf = NULL;
+
+#if !defined(WIN32)
+  ok = fclose(f) == 0;
+  n = *sizep;
+#else
+  long len = ftell(f);
+
+  n = len < 0? 0: len;
+  *bufp = malloc(n + 1);
+  rewind(f);
+  ok = len >= 0 && *bufp && fread(*bufp, 1, n, f) == n;
+  fclose(f);
+#endif
+#if defined(HAVE_LIBZ) || defined(HAVE_LIBLZMA) || defined(HAVE_LIBZSTD)
+  unsigned char *buf = (unsigned char *) *bufp;
+#endif
+
+  switch(ok? z: ZIP_NONE) {
+#ifdef HAVE_LIBZ
+  case ZIP_GZIP: {
+    z_stream zs;
+
+    memset(&zs, 0, sizeof zs);
+    ok = 0;
+    if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+      zbuf = mmt_malloc(nz = deflateBound(&zs, n));
+      zs.next_in = buf;
+      zs.avail_in = n;
+      zs.next_out = zbuf;
+      zs.avail_out = nz;
+      ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+      nz = zs.next_out - zbuf;
+      deflateEnd(&zs);
+    }
+    break;
+  }
+#endif
+
+#ifdef HAVE_LIBLZMA
+  case ZIP_XZ: {
+    size_t pos = 0;
+
+    zbuf = mmt_malloc(nz = lzma_stream_buffer_bound(n));
+    ok = lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, NULL, buf, n, zbuf, &pos, nz) == LZMA_OK;
+    nz = pos;
+    break;
+  }
+#endif
+
+#ifdef HAVE_LIBZSTD
+  case ZIP_ZSTD:
+    zbuf = mmt_malloc(nz = ZSTD_compressBound(n));
+    nz = ZSTD_compress(zbuf, nz, buf, n, 19);
+    ok = !ZSTD_isError(nz);
+    break;
+#endif
+
+  default:
+    ok = 0;
+  }
+
+  if(!ok)
+    pmsg_error("%s compression of %s failed\n", zipmethods[z].name, fname);
+  else if(fwrite(zbuf, 1, nz, out) != nz) {
+    pmsg_ext_error("cannot write %s: %s\n", fname, strerror(errno));
+    ok = 0;
+  }
+  if(fclose(out) == EOF && ok) {
+    pmsg_ext_error("cannot write %s: %s\n", fname, strerror(errno));
+    ok = 0;
+  }
+  if(ok)
+    pmsg_debug("%s file %s compressed from %lu to %lu bytes\n", zipmethods[z].name, fname,
+      (unsigned long) n, (unsigned long) nz);
+  mmt_free(zbuf);
+  free(*bufp);                  // Allocated by open_memstream() or above
+  *bufp = NULL;
+
+  return ok? 0: -1;
+}
+
 static FILEFMT couldbe(int first, unsigned char *line) {
   int found;
   unsigned long i, nxdigs, len;
@@ -1547,6 +2337,10 @@ static FILEFMT couldbe(int first, unsigned char *line) {
   if(first && line[0] == 0177 && str_starts((char *) line + 1, "ELF"))
     return FMT_ELF;
 
+  // Check for page image
+  if(first && !memcmp(line, pimg_magic, 6))
+    return FMT_PIMG;
+
   len = strlen((char *) line);
   while(len > 0 && line[len - 1] && isspace(line[len - 1])) // Cr/lf etc
     line[--len] = 0;
@@ -1612,6 +2406,20 @@ static FILEFMT couldbe(int first, unsigned char *line) {
 int fileio_fmt_autodetect_fp(FILE *f) {
   const char *err = NULL;
   int ret = FMT_ERROR;
+  Zipmethod z;
+
+  if(f && fseek(f, 0, SEEK_CUR) == 0 && (z = zip_magic(f))) { // Sniff decompressed contents
+    size_t n = 0;
+    unsigned char *zbuf = zip_inflate(f, z, "input file", &n);
+    FILE *zf = zbuf? zip_istream(zbuf, n, "input file"): NULL;
+
+    if(zf) {
+      ret = fileio_fmt_autodetect_fp(zf);
+      fclose(zf);
+    }
+    mmt_free(zbuf);
+    return ret;
+  }
 
   if(f) {
     unsigned char *buf;
@@ -1668,6 +2476,149 @@ int fileio_mem(int op, const char *filename, FILEFMT format, const AVRPART *p, c
   return fileio_segments(op, filename, format, p, mem, 1, &seg);
 }
 
+/*
+ * Read a file into mem like fileio_mem() but reuse an earlier parse of the same
+ * regular file for the same part, memory, format and read operation if the file has
+ * not changed since, as determined by its size and modification time. Generated
+ * contents, eg, of urboot:... bootloaders, only depend on the part and the file
+ * name, so they are reused, too, unless they were empty (eg, _list or _show).
+ */
+// Index of the image parsed earlier from filename of size fsize and modification time mtime, -1 if none
+static int fio_find_image(int op, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+  long long fsize, long long mtime) {
+
+  for(int i = 0; i < cx->fio_nimages; i++) {
+    Fio_image *im = cx->fio_images + i;
+
+    if(im->format == format && im->op == op && im->fsize == fsize && im->mtime == mtime &&
+      str_eq(im->fname, filename) && str_eq(im->pdesc, p->desc) && str_eq(im->mdesc, mem->desc))
+      return i;
+  }
+
+  return -1;
+}
+
+// Remember the contents of mem parsed from the file with return value rc of fileio_mem()
+static void fio_add_image(int op, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+  long long fsize, long long mtime, int rc) {
+
+  // Only keep the image up to the last byte that was set
+  int len = mem->size;
+
+  while(len > 0 && !tag_isset(mem->tags, len-1))
+    len--;
+  if(len < rc)
+    len = rc;
+
+  cx->fio_images = mmt_realloc(cx->fio_images, (cx->fio_nimages + 1)*sizeof *cx->fio_images);
+  Fio_image *im = cx->fio_images + cx->fio_nimages++;
+
+  im->fname = mmt_strdup(filename);
+  im->pdesc = mmt_strdup(p->desc);
+  im->mdesc = mmt_strdup(mem->desc);
+  im->format = format;
+  im->op = op;
+  im->fsize = fsize;
+  im->mtime = mtime;
+  im->rc = rc;
+  im->len = len;
+  im->buf = mmt_malloc(len);
+  im->tags = mmt_malloc(tag_bytes(len));
+  memcpy(im->buf, mem->buf, len);
+  memcpy(im->tags, mem->tags, tag_bytes(len));
+}
+
+int fileio_mem_cached(int op, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem) {
+  struct stat st;
+  int gen = is_generated_fname(filename), i;
+
+  if((op != FIO_READ && op != FIO_READ_FOR_VERIFY) || format == FMT_IMM || str_eq(filename, "-"))
+    return fileio_mem(op, filename, format, p, mem, -1);
+  if(gen) {
+    memset(&st, 0, sizeof st);
+    st.st_size = -1;
+  } else if(stat(filename, &st) < 0 || !S_ISREG(st.st_mode))
+    return fileio_mem(op, filename, format, p, mem, -1);
+
+  if((i = fio_find_image(op, filename, format, p, mem, st.st_size, st.st_mtime)) >= 0) {
+    Fio_image *im = cx->fio_images + i;
+
+    memset(mem->buf, 0xff, mem->size);
+    memset(mem->tags, 0, tag_bytes(mem->size));
+    memcpy(mem->buf, im->buf, im->len);
+    memcpy(mem->tags, im->tags, tag_bytes(im->len));
+    pmsg_debug("reusing parsed contents of %s\n", filename);
+    return im->rc;
+  }
+
+  int rc = fileio_mem(op, filename, format, p, mem, -1);
+
+  if(rc < 0 || (gen && rc == 0))
+    return rc;
+  fio_add_image(op, filename, format, p, mem, st.st_size, st.st_mtime, rc);
+
+  return rc;
+}
+
+/*
+ * Has a regular file of size fsize and modification time mtime been parsed
+ * for fileio_mem_cached() already?
+ */
+int fileio_mem_iscached(int op, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+  long long fsize, long long mtime) {
+
+  return fio_find_image(op, filename, format, p, mem, fsize, mtime) >= 0;
+}
+
+/*
+ * Hand the contents of mem, which another thread parsed with fileio_mem()
+ * from a regular file of size fsize and modification time mtime with return
+ * value rc, to fileio_mem_cached() of this thread's context; should the file
+ * have changed since then fileio_mem_cached() will not use the contents
+ */
+void fileio_mem_adopt(int op, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+  long long fsize, long long mtime, int rc) {
+
+  if(rc >= 0 && fio_find_image(op, filename, format, p, mem, fsize, mtime) < 0)
+    fio_add_image(op, filename, format, p, mem, fsize, mtime, rc);
+}
+
+// Drop cached images of a file that is about to be overwritten
+static void fileio_forget(const char *filename) {
+  for(int i = 0; i < cx->fio_nimages; i++) {
+    Fio_image *im = cx->fio_images + i;
+
+    if(str_eq(im->fname, filename)) {
+      mmt_free(im->fname);
+      mmt_free(im->pdesc);
+      mmt_free(im->mdesc);
+      mmt_free(im->buf);
+      mmt_free(im->tags);
+      *im = cx->fio_images[--cx->fio_nimages];
+      i--;
+    }
+  }
+}
+
+// Free the parsed images and the ELF index of this thread's context
+void fileio_free_cache(void) {
+  for(int i = 0; i < cx->fio_nimages; i++) {
+    Fio_image *im = cx->fio_images + i;
+
+    mmt_free(im->fname);
+    mmt_free(im->pdesc);
+    mmt_free(im->mdesc);
+    mmt_free(im->buf);
+    mmt_free(im->tags);
+  }
+  mmt_free(cx->fio_images);
+  cx->fio_images = NULL;
+  cx->fio_nimages = 0;
+#ifdef HAVE_LIBELF
+  elf_drop();
+#endif
+}
+
 int fileio(int op, const char *filename, FILEFMT format, const AVRPART *p, const char *memstr, int size) {
   AVRMEM *mem = avr_locate_mem(p, memstr);
 
@@ -1713,6 +2664,42 @@ int segment_normalise(const AVRMEM *mem, Segment *segp) {
   return 0;
 }
 
+/*
+ * Return an input stream that can be repositioned after the file format has been
+ * sniffed: that is f itself when seekable, otherwise a temporary file holding all
+ * of the stream, eg, a pipe into stdin; f is closed then unless it is stdin. The
+ * parsers below need this anyway as they rewind the stream for each segment.
+ */
+static FILE *fileio_seekable(FILE *f, const char *fname, int using_stdio) {
+  if(fseek(f, 0, SEEK_CUR) == 0)
+    return f;
+
+  FILE *tmp = tmpfile();
+  char *buf = mmt_malloc(1 << 16);
+  size_t n;
+
+  if(!tmp)
+    pmsg_ext_error("cannot create temporary file for %s: %s\n", fname, strerror(errno));
+  while(tmp && (n = fread(buf, 1, 1 << 16, f)) > 0)
+    if(fwrite(buf, 1, n, tmp) != n) {
+      pmsg_ext_error("cannot write temporary file for %s: %s\n", fname, strerror(errno));
+      fclose(tmp);
+      tmp = NULL;
+    }
+  if(tmp && ferror(f)) {
+    pmsg_ext_error("cannot read %s: %s\n", fname, strerror(errno));
+    fclose(tmp);
+    tmp = NULL;
+  }
+  mmt_free(buf);
+  if(!using_stdio)
+    fclose(f);
+  if(tmp)
+    rewind(tmp);
+
+  return tmp;
+}
+
 static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT format,
   const AVRPART *p, const AVRMEM *mem, int n, Segment *seglist) {
 
@@ -1721,6 +2708,11 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
   const char *fname;
   struct fioparms fio;
   int using_stdio;
+  Zipmethod zipout = ZIP_NONE;
+  FILE *zf = NULL;              // Compressed output file
+  unsigned char *zbuf = NULL;   // Decompressed input
+  char *obuf = NULL;            // Output to be compressed
+  size_t osize = 0;
 
   op = oprwv == FIO_READ_FOR_VERIFY? FIO_READ: oprwv;
   rc = fileio_setparms(op, &fio, p, mem);
@@ -1740,36 +2732,29 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
     f = fio.op == FIO_READ? stdin: stdout;
   }
 
-  if(format == FMT_AUTO) {
-    int format_detect;
-
+  if(format == FMT_AUTO && fio.op == FIO_WRITE) {  // Keep the format of an existing output file
     if(using_stdio) {
-      pmsg_error("cannot auto detect file format when using stdin/out;\n");
+      pmsg_error("cannot auto detect file format when using stdout;\n");
       imsg_error("please specify a file format and try again\n");
       return -1;
     }
-
-    format_detect = fileio_fmt_autodetect(fname);
-    if(format_detect < 0) {
+    if((format = fileio_fmt_autodetect(fname)) < 0) {
       pmsg_error("cannot determine file format for %s, specify explicitly\n", fname);
       return -1;
     }
-    format = format_detect;
-
     if(quell_progress < 2)
       pmsg_notice("%s file %s auto detected as %s\n", fio.iodesc, fname, fileio_fmtstr(format));
   }
 
+  if(fio.op == FIO_WRITE && !using_stdio && (zipout = zip_suffix(fname)) && !zip_compiled_in(zipout, fname))
+    return -1;
+
 #if defined(WIN32)
-  // Open Raw Binary and ELF format in binary mode on Windows
-  if(format == FMT_RBIN || format == FMT_ELF) {
-    if(fio.op == FIO_READ) {
-      fio.mode = "rb";
-    }
-    if(fio.op == FIO_WRITE) {
-      fio.mode = "wb";
-    }
-  }
+  // Open input, and Raw Binary, ELF and compressed output in binary mode on Windows
+  if(fio.op == FIO_READ)
+    fio.mode = "rb";
+  if(fio.op == FIO_WRITE && (format == FMT_RBIN || format == FMT_ELF || format == FMT_PIMG || zipout))
+    fio.mode = "wb";
 #endif
 
   if(format != FMT_IMM) {
@@ -1779,7 +2764,45 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
         pmsg_ext_error("cannot open %s file %s: %s\n", fio.iodesc, fname, strerror(errno));
         return -1;
       }
+      if(fio.op == FIO_READ)    // Large blocks for line-by-line parsing of big hex files
+        setvbuf(f, NULL, _IOFBF, 1 << 16);
+    }
+    if(zipout) {                // Collect output and compress it when done
+      zf = f;
+      if(!(f = zip_open_output(&obuf, &osize))) {
+        pmsg_ext_error("cannot buffer output for %s: %s\n", fname, strerror(errno));
+        fclose(zf);
+        return -1;
+      }
+    }
+    if(fio.op == FIO_READ) {    // Seekable input, decompressed if need be
+      if(!(f = fileio_seekable(f, fname, using_stdio)))
+        return -1;
+      if(!(f = zip_open_input(f, fname, format, &zbuf))) {
+        mmt_free(zbuf);
+        return -1;
+      }
+      if(f != stdin)            // Stdin pipe spooled to a temporary file or decompressed
+        using_stdio = 0;
+    }
+  }
+
+  if(format == FMT_AUTO) {      // Sniff the format on the same stream that is parsed below
+    long pos = ftell(f);
+
+    format = fileio_fmt_autodetect_fp(f);
+    if(fseek(f, pos, SEEK_SET) < 0) {
+      pmsg_ext_error("cannot rewind %s file %s: %s\n", fio.iodesc, fname, strerror(errno));
+      format = FMT_ERROR;
+    }
+    if(format == FMT_ERROR) {
+      pmsg_error("cannot determine file format for %s, specify explicitly\n", fname);
+      rc = -1;
+      goto done;
     }
+
+    if(quell_progress < 2)
+      pmsg_notice("%s file %s auto detected as %s\n", fio.iodesc, fname, fileio_fmtstr(format));
   }
 
   rc = 0;
@@ -1791,7 +2814,7 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
 
     if(fio.op == FIO_READ)      // Fill unspecified memory in segment
       memset(mem->buf + addr, 0xff, len);
-    memset(mem->tags + addr, 0, len);
+    tag_clr_range(mem->tags, addr, len);
 
     Segorder where = i == 0? FIRST_SEG: 0;
 
@@ -1814,6 +2837,10 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
       thisrc = fileio_rbin(&fio, fname, f, mem, seglist + i);
       break;
 
+    case FMT_PIMG:
+      thisrc = fileio_pimg(&fio, fname, f, p, mem, seglist + i, where);
+      break;
+
     case FMT_ELF:
 
 #ifdef HAVE_LIBELF
@@ -1821,7 +2848,8 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
       break;
 #else
       pmsg_error("cannot handle ELF file %s, ELF file support was not compiled in\n", fname);
-      return -1;
+      rc = -1;
+      goto done;
 #endif
 
     case FMT_IMM:
@@ -1838,10 +2866,13 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
 
     default:
       pmsg_error("invalid %s file format: %d\n", fio.iodesc, format);
-      return -1;
+      rc = -1;
+      goto done;
+    }
+    if(thisrc < 0) {
+      rc = thisrc;
+      goto done;
     }
-    if(thisrc < 0)
-      return thisrc;
     if(thisrc > rc)
       rc = thisrc;
   }
@@ -1854,8 +2885,13 @@ static int fileio_segments_normalise(int oprwv, const char *filename, FILEFMT fo
       rc = hiaddr;
   }
 
-  if(format != FMT_IMM && !using_stdio)
+done:
+  if(zipout) {
+    if(zip_close_output(f, &obuf, &osize, zf, zipout, fname) < 0 && rc >= 0)
+      rc = -1;
+  } else if(f && !using_stdio)
     fclose(f);
+  mmt_free(zbuf);
 
   return rc;
 }
@@ -1865,6 +2901,8 @@ int fileio_segments(int oprwv, const char *filename, FILEFMT format,
 
   Segment *seglist = mmt_malloc(n*sizeof *seglist);
 
+  if(oprwv == FIO_WRITE)
+    fileio_forget(filename);
   memcpy(seglist, list, n*sizeof *seglist);
   int ret = fileio_segments_normalise(oprwv, filename, format, p, mem, n, seglist);
 
@@ -1872,3 +2910,166 @@ int fileio_segments(int oprwv, const char *filename, FILEFMT format,
 
   return ret;
 }
+
+struct fio_stream {
+  char *fname, *tmpname;        // Output file and the temporary file written until it is complete
+  FILE *f;
+  FILEFMT format;
+  const AVRPART *p;
+  const AVRMEM *mem;
+  struct fioparms fio;
+  int trim;                     // Trailing 0xff are not written, see avr_mem_hiaddr()
+  int scanned;                  // Bytes of mem->buf looked at for trailing 0xff
+  int hi;                       // End of data seen so far, beyond which there are only 0xff
+  int written;                  // Bytes of mem->buf written to the file
+  int nseg;                     // Number of calls of the writers of the file format
+  int rc;
+};
+
+/*
+ * Open a stream that writes the contents of mem to filename while they are
+ * still being read from the device: fileio_stream_write() writes what has
+ * arrived so far and fileio_stream_close() finishes the file, which then is
+ * the same as one written by fileio_mem(FIO_WRITE, ...) after the read. The
+ * output goes to a temporary file that replaces filename once complete, so a
+ * failed read leaves an existing file alone. Returns NULL if the output
+ * cannot be streamed, eg, for stdout, compressed files or formats other than
+ * raw binary, Intel Hex and Motorola S-Records; use fileio_mem() then.
+ */
+Fio_stream *fileio_stream_open(const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem) {
+  struct fioparms fio;
+  struct stat st;
+  int exists;
+
+  if((format != FMT_RBIN && format != FMT_IHEX && format != FMT_IHXC && format != FMT_SREC) ||
+    str_eq(filename, "-") || is_generated_fname(filename) || zip_suffix(filename) || !mem->buf)
+    return NULL;
+  if(!(exists = stat(filename, &st) >= 0) && errno != ENOENT)
+    return NULL;
+  if(exists && !S_ISREG(st.st_mode))
+    return NULL;
+  if(fileio_setparms(FIO_WRITE, &fio, p, mem) < 0 || fio.fileoffset%FIO_RECSIZE)
+    return NULL;
+
+#if defined(WIN32)
+  if(format == FMT_RBIN)
+    fio.mode = "wb";
+#endif
+
+  char *tmp = mmt_sprintf("%s.%ld", filename, (long) getpid());
+  FILE *f = fopen(tmp, fio.mode);
+
+  if(!f) {
+    mmt_free(tmp);
+    return NULL;
+  }
+  if(exists)
+    chmod(tmp, st.st_mode & 07777);
+  fileio_forget(filename);
+
+  Fio_stream *fs = mmt_malloc(sizeof *fs);
+
+  fs->fname = mmt_strdup(filename);
+  fs->tmpname = tmp;
+  fs->f = f;
+  fs->format = format;
+  fs->p = p;
+  fs->mem = mem;
+  fs->fio = fio;
+  fs->trim = !cx->avr_disableffopt && mem_is_in_flash(mem);
+
+  return fs;
+}
+
+// Write mem->buf[fs->written, end) to the stream
+static int fio_stream_seg(Fio_stream *fs, int end, Segorder where) {
+  Segment seg = { fs->written, end - fs->written };
+  int rc;
+
+  where |= fs->nseg? NEXT_SEG: FIRST_SEG;
+  switch(fs->format) {
+  case FMT_IHEX:
+  case FMT_IHXC:
+    rc = fileio_ihex(&fs->fio, fs->fname, fs->f, fs->p, fs->mem, &seg, fs->format, where);
+    break;
+  case FMT_SREC:
+    rc = fileio_srec(&fs->fio, fs->fname, fs->f, fs->p, fs->mem, &seg, where);
+    break;
+  default:
+    rc = fileio_rbin(&fs->fio, fs->fname, fs->f, fs->mem, &seg);
+  }
+  if(rc < 0)
+    return fs->rc = -1;
+  fs->written = end;
+  fs->nseg++;
+
+  return 0;
+}
+
+/*
+ * The first upto bytes of mem->buf hold final device contents: write those
+ * that are known to be in the file, ie, not in what could become a trailing
+ * run of 0xff, and, for hex formats, only whole records so that the output
+ * does not depend on how the data arrived; returns -1 on error
+ */
+int fileio_stream_write(Fio_stream *fs, int upto) {
+  const unsigned char *buf = fs->mem->buf;
+
+  if(fs->rc < 0)
+    return -1;
+  if(upto > fs->mem->size)
+    upto = fs->mem->size;
+  if(!fs->trim)
+    fs->hi = upto;
+  else {
+    for(int i = fs->scanned; i < upto; i++)
+      if(buf[i] != 0xff)
+        fs->hi = i + 1 + !(i & 1);      // Even size like avr_mem_hiaddr()
+  }
+  if(upto > fs->scanned)
+    fs->scanned = upto;
+
+  int end = fs->hi < upto? fs->hi: upto;
+
+  if(fs->format != FMT_RBIN)
+    end -= end%FIO_RECSIZE;
+  if(end > fs->written)
+    return fio_stream_seg(fs, end, 0);
+
+  return 0;
+}
+
+/*
+ * Write the remainder of the first size bytes of mem->buf, size being the
+ * return value of the read, finish the file and free the stream; size < 0
+ * drops the output. Returns size or -1 on error.
+ */
+int fileio_stream_close(Fio_stream *fs, int size) {
+  int rc = size;
+
+  if(!fs)
+    return -1;
+  if(size >= 0 && size < fs->written) {
+    pmsg_error("size %d of %s is below the %d bytes already written\n", size, fs->fname, fs->written);
+    rc = -1;
+  }
+  if(rc >= 0 && (fs->rc < 0 || fio_stream_seg(fs, size, LAST_SEG) < 0))
+    rc = -1;
+  if(rc >= 0)
+    tag_clr_range(fs->mem->tags, 0, size);
+  if((ferror(fs->f) | (fclose(fs->f) == EOF)) && rc >= 0) {
+    pmsg_ext_error("cannot write output file %s: %s\n", fs->tmpname, strerror(errno));
+    rc = -1;
+  }
+  if(rc >= 0 && rename(fs->tmpname, fs->fname) < 0) {
+    pmsg_ext_error("cannot rename %s to %s: %s\n", fs->tmpname, fs->fname, strerror(errno));
+    rc = -1;
+  }
+  if(rc < 0)
+    unlink(fs->tmpname);
+  mmt_free(fs->fname);
+  mmt_free(fs->tmpname);
+  mmt_free(fs);
+
+  return rc;
+}
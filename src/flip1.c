@@ -170,6 +170,8 @@ void flip1_initpgm(PROGRAMMER *pgm) {
   pgm->close = flip1_close;
   pgm->paged_load = flip1_paged_load;
   pgm->paged_write = flip1_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
   pgm->read_byte = flip1_read_byte;
   pgm->write_byte = flip1_write_byte;
   pgm->read_sig_bytes = flip1_read_sig_bytes;
@@ -400,6 +402,22 @@ static int flip1_write_byte(const PROGRAMMER *pgm, const AVRPART *part, const AV
   return flip1_write_memory(FLIP1(pgm)->dfu, mem_unit, addr, &value, 1);
 }
 
+/*
+ * Multi-page runs are split into requests of at most 1 KiB, or less if the DFU functional
+ * descriptor advertises a smaller wTransferSize, that never cross a 64 KiB memory page
+ */
+static unsigned int flip1_chunk(const struct dfu_dev *dfu, unsigned int addr, unsigned int size) {
+  unsigned int max = 0x400;
+
+  if(dfu->transfer_size >= 64 + 64 && dfu->transfer_size - 64 < max)
+    max = (dfu->transfer_size - 64) & ~31u;
+  if(size < max)
+    max = size;
+  if((addr & 0xFFFF) + max > 0x10000)
+    max = 0x10000 - (addr & 0xFFFF);
+  return max;
+}
+
 static int flip1_paged_load(const PROGRAMMER *pgm, const AVRPART *part, const AVRMEM *mem,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   enum flip1_mem_unit mem_unit;
@@ -418,7 +436,13 @@ static int flip1_paged_load(const PROGRAMMER *pgm, const AVRPART *part, const AV
     // 0x01 is used for blank check when reading, 0x02 is EEPROM
     mem_unit = 2;
 
-  return flip1_read_memory(pgm, mem_unit, addr, mem->buf + addr, n_bytes);
+  for(unsigned int end = addr + n_bytes, chunk; addr < end; addr += chunk) {
+    chunk = flip1_chunk(FLIP1(pgm)->dfu, addr, end - addr);
+    if(flip1_read_memory(pgm, mem_unit, addr, mem->buf + addr, chunk) < 0)
+      return -1;
+  }
+
+  return n_bytes;
 }
 
 static int flip1_paged_write(const PROGRAMMER *pgm, const AVRPART *part, const AVRMEM *mem,
@@ -442,7 +466,11 @@ static int flip1_paged_write(const PROGRAMMER *pgm, const AVRPART *part, const A
     return -1;
   }
 
-  result = flip1_write_memory(FLIP1(pgm)->dfu, mem_unit, addr, mem->buf + addr, n_bytes);
+  result = 0;
+  for(unsigned int end = addr + n_bytes, chunk; result == 0 && addr < end; addr += chunk) {
+    chunk = flip1_chunk(FLIP1(pgm)->dfu, addr, end - addr);
+    result = flip1_write_memory(FLIP1(pgm)->dfu, mem_unit, addr, mem->buf + addr, chunk);
+  }
 
   return result == 0? (int) n_bytes: -1;
 }
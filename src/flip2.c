@@ -169,6 +169,8 @@ void flip2_initpgm(PROGRAMMER *pgm) {
   pgm->close = flip2_close;
   pgm->paged_load = flip2_paged_load;
   pgm->paged_write = flip2_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
   pgm->read_byte = flip2_read_byte;
   pgm->write_byte = flip2_write_byte;
   pgm->read_sig_bytes = flip2_read_sig_bytes;
@@ -547,6 +549,28 @@ static void flip2_show_info(struct flip2 *flip2) {
     (unsigned short) flip2->dfu->dev_desc.bMaxPacketSize0);
 }
 
+/*
+ * Largest data block per FLIP2 read/write request: the protocol allows 1 KiB, which is
+ * further limited by a smaller wTransferSize in the DFU functional descriptor, if any;
+ * writes also carry a command packet and alignment padding of one bMaxPacketSize0 each
+ */
+static int flip2_max_block(const struct dfu_dev *dfu, int overhead) {
+  int max = 0x400;
+
+  if(dfu->transfer_size && (int) dfu->transfer_size - overhead >= 64 && (int) dfu->transfer_size - overhead < max)
+    max = (dfu->transfer_size - overhead) & ~63;
+  return max;
+}
+
+// Chunk size at addr that neither exceeds max nor crosses a 64 KiB memory page
+static int flip2_chunk(uint32_t addr, int size, int max) {
+  int chunk = size > max? max: size;
+
+  if((addr & 0xFFFF) + chunk > 0x10000)
+    chunk = 0x10000 - (addr & 0xFFFF);
+  return chunk;
+}
+
 static int flip2_read_memory(struct dfu_dev *dfu, enum flip2_mem_unit mem_unit,
   uint32_t addr, void *ptr, int size) {
 
@@ -588,7 +612,7 @@ static int flip2_read_memory(struct dfu_dev *dfu, enum flip2_mem_unit mem_unit,
       }
     }
 
-    read_size = (size > 0x400)? 0x400: size;
+    read_size = flip2_chunk(addr, size, flip2_max_block(dfu, 0));
     result = flip2_read_max1k(dfu, addr & 0xFFFF, ptr, read_size);
 
     if(result != 0) {
@@ -645,7 +669,7 @@ static int flip2_write_memory(struct dfu_dev *dfu, enum flip2_mem_unit mem_unit,
       }
     }
 
-    write_size = (size > 0x800)? 0x800: size;
+    write_size = flip2_chunk(addr, size, flip2_max_block(dfu, 2*dfu->dev_desc.bMaxPacketSize0));
     result = flip2_write_max1k(dfu, addr & 0xFFFF, ptr, write_size);
 
     if(result != 0) {
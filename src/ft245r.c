@@ -129,6 +129,10 @@ void ft245r_initpgm(PROGRAMMER *pgm) {
 #define FT245R_BUFSIZE       0x2000 // Receive buffer size
 #define FT245R_MIN_FIFO_SIZE    128 // Min of FTDI RX/TX FIFO size
 
+#if defined(HAVE_LIBFTDI1) && defined(HAVE_LIBUSB_1_0)
+#define FT245R_ASYNC 1          // Read back sampled data while writing the next chunk
+#endif
+
 struct pdata {
   struct ftdi_context *handle;
 
@@ -152,6 +156,11 @@ struct pdata {
     int wr;                     // Write pointer
     int rd;                     // Read pointer
     uint8_t buf[FT245R_BUFSIZE];        // Receive ring buffer
+#ifdef FT245R_ASYNC
+    struct ftdi_transfer_control *tc;   // Read in flight, if any
+    int tclen;                  // # of pending bytes it reads
+    uint8_t tcbuf[FT245R_MIN_FIFO_SIZE];        // Its data
+#endif
   } rx;
   struct ft245r_request {
     int addr;
@@ -159,6 +168,18 @@ struct pdata {
     int n;
     struct ft245r_request *next;
   } *req_head, *req_tail, *req_pool;
+  struct {                      // Bitbang samples of all SPI bytes for set_data()
+    int valid;
+    unsigned char base;         // ft245r_out with SDO and SCK low that samples were made for
+    unsigned char samples[256][8*FT245R_CYCLES];
+  } enc;
+  int sdi_valid;
+  unsigned char sdi[256];       // SDI pin value of a sample byte for extract_data()
+  unsigned char sdi_mask;       // SDI pin of target 0, the lowest of several SDI pins
+  int bc_n;                     // Number of further targets in broadcast mode
+  unsigned char bc_mask[7];     // Their SDI pins
+  int bc_last;                  // Last further target that answered a command differently, -1 if none
+  unsigned bc_reported;         // Further targets whose differing reads were reported by this paged load
 };
 
 // Use private programmer data as if they were a global structure my
@@ -169,16 +190,36 @@ static int ft245r_tpi_tx(const PROGRAMMER *pgm, uint8_t byte);
 static int ft245r_tpi_rx(const PROGRAMMER *pgm, uint8_t *bytep);
 
 // Discard all data from the receive buffer.
+// Bit number of the SDI pin of broadcast target k + 1
+static int target_pin(const PROGRAMMER *pgm, int k) {
+  int pin = 0;
+
+  while(!(my.bc_mask[k] & (1 << pin)))
+    pin++;
+
+  return pin;
+}
+
 static void ft245r_rx_buf_purge(const PROGRAMMER *pgm) {
   my.rx.len = 0;
   my.rx.rd = my.rx.wr = 0;
 }
 
-static void ft245r_rx_buf_put(const PROGRAMMER *pgm, uint8_t byte) {
-  my.rx.len++;
-  my.rx.buf[my.rx.wr++] = byte;
-  if(my.rx.wr >= (int) sizeof(my.rx.buf))
-    my.rx.wr = 0;
+// Append n bytes to the receive buffer
+static void ft245r_rx_buf_put(const PROGRAMMER *pgm, const uint8_t *src, int n) {
+  while(n > 0) {
+    int k = (int) sizeof(my.rx.buf) - my.rx.wr;
+
+    if(k > n)
+      k = n;
+    memcpy(my.rx.buf + my.rx.wr, src, k);
+    my.rx.wr += k;
+    if(my.rx.wr >= (int) sizeof(my.rx.buf))
+      my.rx.wr = 0;
+    my.rx.len += k;
+    src += k;
+    n -= k;
+  }
 }
 
 static uint8_t ft245r_rx_buf_get(const PROGRAMMER *pgm) {
@@ -190,10 +231,47 @@ static uint8_t ft245r_rx_buf_get(const PROGRAMMER *pgm) {
   return byte;
 }
 
+#ifdef FT245R_ASYNC
+// Wait for the read in flight and put its data into the receive buffer
+static int ft245r_reap(const PROGRAMMER *pgm) {
+  if(!my.rx.tc)
+    return 0;
+
+  int nread = ftdi_transfer_data_done(my.rx.tc); // Also frees the transfer
+
+  my.rx.tc = NULL;
+  my.rx.tclen = 0;
+  if(nread < 0)
+    return -1;
+  my.rx.pending -= nread;
+  ft245r_rx_buf_put(pgm, my.rx.tcbuf, nread);
+
+  return nread;
+}
+
+// Start reading back the bytes written so far unless a read is already in flight
+static int ft245r_submit(const PROGRAMMER *pgm) {
+  if(my.rx.tc || my.rx.pending <= 0)
+    return 0;
+  my.rx.tclen = my.rx.pending;
+  if(!(my.rx.tc = ftdi_read_data_submit(my.handle, my.rx.tcbuf, my.rx.tclen))) {
+    my.rx.tclen = 0;
+    return -1;
+  }
+
+  return 0;
+}
+#endif
+
 // Fill receive buffer with data from the FTDI receive FIFO
 static int ft245r_fill(const PROGRAMMER *pgm) {
   uint8_t raw[FT245R_MIN_FIFO_SIZE];
-  int i, nread;
+  int nread;
+
+#ifdef FT245R_ASYNC
+  if(my.rx.tc)                  // Earlier bytes first
+    return ft245r_reap(pgm);
+#endif
 
   nread = ftdi_read_data(my.handle, raw, my.rx.pending);
   if(nread < 0)
@@ -204,8 +282,7 @@ static int ft245r_fill(const PROGRAMMER *pgm) {
   msg_info("%s: read %d bytes (pending=%d)\n", __func__, nread, my.rx.pending);
 #endif
 
-  for(i = 0; i < nread; ++i)
-    ft245r_rx_buf_put(pgm, raw[i]);
+  ft245r_rx_buf_put(pgm, raw, nread);
   return nread;
 }
 
@@ -228,6 +305,35 @@ static int ft245r_flush(const PROGRAMMER *pgm) {
   if(!len)
     return 0;
 
+#ifdef FT245R_ASYNC
+  /*
+   * Write in half-FIFO chunks and keep a read of the earlier chunks in flight
+   * meanwhile, so that at most FT245R_MIN_FIFO_SIZE bytes await reading
+   */
+  while(len > 0) {
+    avail = len < FT245R_MIN_FIFO_SIZE/2? len: FT245R_MIN_FIFO_SIZE/2;
+    while(my.rx.pending + avail > FT245R_MIN_FIFO_SIZE)
+      if(ft245r_fill(pgm) < 0) {
+        pmsg_error("fill failed: %s\n", ftdi_get_error_string(my.handle));
+        return -1;
+      }
+    if(ft245r_submit(pgm) < 0) {
+      pmsg_error("cannot submit read: %s\n", ftdi_get_error_string(my.handle));
+      return -1;
+    }
+
+    rv = ftdi_write_data(my.handle, src, avail);
+    if(rv != avail) {
+      msg_error("write returned %d (expected %d): %s\n", rv, avail, ftdi_get_error_string(my.handle));
+      return -1;
+    }
+    src += avail;
+    len -= avail;
+    my.rx.pending += avail;
+  }
+
+  return ft245r_submit(pgm);
+#else
   while(len > 0) {
     avail = FT245R_MIN_FIFO_SIZE - my.rx.pending;
     if(avail <= 0) {
@@ -255,6 +361,7 @@ static int ft245r_flush(const PROGRAMMER *pgm) {
   }
 
   return 0;
+#endif
 }
 
 static int ft245r_send2(const PROGRAMMER *pgm, unsigned char *buf, size_t len, bool discard_rx_data) {
@@ -319,6 +426,9 @@ static int ft245r_recv(const PROGRAMMER *pgm, unsigned char *buf, size_t len) {
 static int ft245r_drain(const PROGRAMMER *pgm, int display) {
   int r;
 
+#ifdef FT245R_ASYNC
+  (void) ft245r_reap(pgm);      // Do not leave a read in flight across the mode change
+#endif
   // Flush the buffer in the chip by changing the mode ...
   r = ftdi_set_bitmode(my.handle, 0, BITMODE_RESET); // Reset
   if(r)
@@ -353,7 +463,7 @@ static int ft245r_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  ft245r_usleep(pgm, p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   return pgm->initialize(pgm, p);
 }
 
@@ -518,6 +628,9 @@ static int ft245r_program_enable(const PROGRAMMER *pgm, const AVRPART *p) {
   }
 
   pmsg_error("device is not responding to program enable; check connection\n");
+  if(my.bc_last >= 0)
+    imsg_error("the broadcast target on SDI pin %d answers differently than the others\n",
+      target_pin(pgm, my.bc_last));
   fflush(stderr);
 
   return -1;
@@ -545,6 +658,11 @@ static int ft245r_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
    */
   ft245r_usleep(pgm, 20000);    // 20ms
 
+  if(is_tpi(p) && my.bc_n) {
+    pmsg_error("broadcast programming with several SDI pins needs ISP, not TPI\n");
+    return -1;
+  }
+
   if(is_tpi(p)) {
     bool io_link_ok = true;
     uint8_t byte;
@@ -612,35 +730,64 @@ static inline void add_bit(const PROGRAMMER *pgm, unsigned char *buf, int *buf_p
   (*buf_pos)++;
 }
 
-static inline int set_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned char data) {
-  int j;
-  int buf_pos = 0;
-  unsigned char bit = 0x80;
+// Expand all 256 SPI bytes into their samples for the other output pins in base
+static void make_enc_samples(const PROGRAMMER *pgm, unsigned char base) {
+  for(int d = 0; d < 256; d++) {
+    int buf_pos = 0;
 
-  for(j = 0; j < 8; j++) {
-    add_bit(pgm, buf, &buf_pos, (data & bit) != 0);
-    bit >>= 1;
+    my.ft245r_out = base;
+    for(unsigned char bit = 0x80; bit; bit >>= 1)
+      add_bit(pgm, my.enc.samples[d], &buf_pos, (d & bit) != 0);
   }
-  return buf_pos;
+  my.enc.base = base;
+  my.enc.valid = 1;
+}
+
+static inline int set_data(const PROGRAMMER *pgm, unsigned char *buf, unsigned char data) {
+  // Samples only depend on the output pins other than SDO and SCK
+  unsigned char base = SET_BITS_0(my.ft245r_out, pgm, PIN_AVR_SDO, 0);
+
+  base = SET_BITS_0(base, pgm, PIN_AVR_SCK, 0);
+  if(!my.enc.valid || my.enc.base != base)
+    make_enc_samples(pgm, base);
+
+  memcpy(buf, my.enc.samples[data], 8*FT245R_CYCLES);
+  my.ft245r_out = buf[8*FT245R_CYCLES - 1];
+
+  return 8*FT245R_CYCLES;
 }
 
 static inline unsigned char extract_data(const PROGRAMMER *pgm, unsigned char *buf, int offset) {
   int j;
   int buf_pos = FT245R_CYCLES;  /* SDI data is valid AFTER rising SCK edge,
                                    i.e. in next clock cycle */
-  unsigned char bit = 0x80;
   unsigned char r = 0;
 
+  if(!my.sdi_valid) {
+    for(int b = 0; b < 256; b++)
+      my.sdi[b] = !!(GET_BITS_0(b, pgm, PIN_AVR_SDI) & my.sdi_mask);
+    my.sdi_valid = 1;
+  }
+
   buf += offset*(8*FT245R_CYCLES);
   for(j = 0; j < 8; j++) {
-    if(GET_BITS_0(buf[buf_pos], pgm, PIN_AVR_SDI))
-      r |= bit;
+    r = r << 1 | my.sdi[buf[buf_pos]];
     buf_pos += FT245R_CYCLES;
-    bit >>= 1;
   }
   return r;
 }
 
+// Data byte that broadcast target k + 1 returned, see extract_data()
+static unsigned char extract_target(const PROGRAMMER *pgm, unsigned char *buf, int offset, int k) {
+  unsigned char r = 0;
+
+  buf += offset*(8*FT245R_CYCLES) + FT245R_CYCLES;
+  for(int j = 0; j < 8; j++, buf += FT245R_CYCLES)
+    r = r << 1 | !!(GET_BITS_0(*buf, pgm, PIN_AVR_SDI) & my.bc_mask[k]);
+
+  return r;
+}
+
 // To check data
 
 #if 0
@@ -682,6 +829,20 @@ static int ft245r_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned
   res[2] = extract_data(pgm, buf, 2);
   res[3] = extract_data(pgm, buf, 3);
 
+  // Broadcast: return a differing answer so that polls wait for all targets and reads verify all
+  my.bc_last = -1;
+  for(int k = 0; k < my.bc_n; k++) {
+    unsigned char r[4];
+
+    for(i = 0; i < 4; i++)
+      r[i] = extract_target(pgm, buf, i, k);
+    if(memcmp(r, res, sizeof r)) {
+      memcpy(res, r, sizeof r);
+      my.bc_last = k;
+      break;
+    }
+  }
+
   return 0;
 }
 
@@ -729,17 +890,22 @@ static int ft245r_tpi_tx(const PROGRAMMER *pgm, uint8_t byte) {
   return 0;
 }
 
-static int ft245r_tpi_rx(const PROGRAMMER *pgm, uint8_t *bytep) {
-  uint8_t buf[128], bit, parity;
-  int i, buf_pos = 0, len = 0;
-  uint32_t res, m, byte;
+// Samples of the window in which a TPI byte is received, see ft245r_tpi_decode()
+static int ft245r_tpi_rx_window(const PROGRAMMER *pgm, uint8_t *buf) {
+  int len = 0;
 
   // Allow for up to 4 bits before we must see start bit; during that time, we must keep the SDO line high
-  for(i = 0; i < 2; ++i)
+  for(int i = 0; i < 2; ++i)
     len += set_data(pgm, &buf[len], 0xff);
 
-  ft245r_send(pgm, buf, len);
-  ft245r_recv(pgm, buf, len);
+  return len;
+}
+
+// Decode a TPI byte from the samples received during ft245r_tpi_rx_window()
+static int ft245r_tpi_decode(const PROGRAMMER *pgm, uint8_t *buf, uint8_t *bytep) {
+  uint8_t bit, parity;
+  int i, buf_pos = 0;
+  uint32_t res, m, byte;
 
   res = (extract_tpi_data(pgm, buf, &buf_pos)
     | ((uint32_t) extract_tpi_data(pgm, buf, &buf_pos) << 8));
@@ -772,6 +938,16 @@ static int ft245r_tpi_rx(const PROGRAMMER *pgm, uint8_t *bytep) {
   return 0;
 }
 
+static int ft245r_tpi_rx(const PROGRAMMER *pgm, uint8_t *bytep) {
+  uint8_t buf[128];
+  int len = ft245r_tpi_rx_window(pgm, buf);
+
+  ft245r_send(pgm, buf, len);
+  ft245r_recv(pgm, buf, len);
+
+  return ft245r_tpi_decode(pgm, buf, bytep);
+}
+
 static int ft245r_cmd_tpi(const PROGRAMMER *pgm, const unsigned char *cmd,
   int cmd_len, unsigned char *res, int res_len) {
 
@@ -795,6 +971,57 @@ static int ft245r_cmd_tpi(const PROGRAMMER *pgm, const unsigned char *cmd,
   return ret;
 }
 
+/*
+ * Send n TPI frames of cmd_len bytes each and collect res_len bytes per frame;
+ * all frames of a batch are queued as one sample stream and read back with a
+ * single receive, so a batch costs one USB round trip instead of one per byte
+ */
+static int ft245r_cmd_tpi_batch(const PROGRAMMER *pgm, const unsigned char *cmd,
+  int cmd_len, unsigned char *res, int res_len, int n) {
+
+  if(!res || !res_len) {        // Nothing to receive: sending never waits anyway
+    for(int k = 0; k < n; k++)
+      ft245r_cmd_tpi(pgm, cmd + k*cmd_len, cmd_len, NULL, 0);
+    return 0;
+  }
+
+  // Samples per sent byte (12 bits) and per receive window, see set_tpi_data() and ft245r_tpi_rx_window()
+  const int txlen = 2*12, rxlen = 2*8*FT245R_CYCLES;
+  int per_frame = cmd_len*txlen + res_len*rxlen;
+  // Keep the samples of one batch well within the receive ring buffer
+  int max_frames = FT245R_BUFSIZE/2/(per_frame*baud_multiplier);
+
+  if(max_frames < 1)
+    max_frames = 1;
+
+  uint8_t *buf = mmt_malloc(per_frame*(n < max_frames? n: max_frames));
+  int ret = 0;
+
+  for(int done = 0; done < n && !ret;) {
+    int nf = n - done < max_frames? n - done: max_frames, pos = 0;
+
+    for(int k = 0; k < nf; k++) {
+      for(int i = 0; i < cmd_len; i++)
+        pos += set_tpi_data(pgm, buf + pos, cmd[(done + k)*cmd_len + i]);
+      for(int i = 0; i < res_len; i++)
+        pos += ft245r_tpi_rx_window(pgm, buf + pos);
+    }
+    ft245r_send(pgm, buf, pos);
+    ft245r_recv(pgm, buf, pos);
+
+    for(int k = 0; k < nf && !ret; k++) {
+      uint8_t *win = buf + k*per_frame + cmd_len*txlen;
+
+      for(int i = 0; i < res_len && !ret; i++)
+        ret = ft245r_tpi_decode(pgm, win + i*rxlen, res + (done + k)*res_len + i);
+    }
+    done += nf;
+  }
+  mmt_free(buf);
+
+  return ret;
+}
+
 // Lower 8 pins are accepted, they might be also inverted
 static const struct pindef valid_pins = { {0xff}, {0xff} };
 
@@ -821,6 +1048,19 @@ static int ft245r_open(PROGRAMMER *pgm, const char *port) {
   }
 
   pgm->port = port;
+  my.enc.valid = my.sdi_valid = 0;      // Pin assignment may have changed
+
+  // Several SDI pins: broadcast to identical targets that share all other lines
+  unsigned char sdi = pgm->pin[PIN_AVR_SDI].mask[0];
+
+  my.sdi_mask = sdi & -sdi;
+  my.bc_n = 0;
+  my.bc_last = -1;
+  for(int b = 0; b < 8; b++)
+    if(sdi & ~my.sdi_mask & (1 << b))
+      my.bc_mask[my.bc_n++] = 1 << b;
+  if(my.bc_n)
+    pmsg_notice("broadcast programming %d targets, the first one on the lowest SDI pin\n", my.bc_n + 1);
 
   // Read device string cut after 8 chars (max. length of serial number)
   if((sscanf(port, "usb:%8s", device) != 1)) {
@@ -927,6 +1167,9 @@ cleanup_no_usb:
 
 static void ft245r_close(PROGRAMMER *pgm) {
   if(my.handle) {
+#ifdef FT245R_ASYNC
+    (void) ft245r_reap(pgm);
+#endif
     // I think the switch to BB mode and back flushes the buffer.
     ftdi_set_bitmode(my.handle, 0, BITMODE_SYNCBB); // Set Synchronous BitBang, all in puts
     ftdi_set_bitmode(my.handle, 0, BITMODE_RESET);  // Disable Synchronous BitBang
@@ -994,8 +1237,21 @@ static int do_request(const PROGRAMMER *pgm, const AVRMEM *m) {
   my.req_pool = p;
 
   ft245r_recv(pgm, buf, bytes);
-  for(j = 0; j < n; j++)
-    m->buf[addr++] = extract_data(pgm, buf, (j*4 + 3));
+  for(j = 0; j < n; j++, addr++) {
+    m->buf[addr] = extract_data(pgm, buf, (j*4 + 3));
+    // Broadcast: a target that reads differently makes verification fail at addr
+    for(int k = 0, read0 = m->buf[addr]; k < my.bc_n; k++) {
+      unsigned char r = extract_target(pgm, buf, j*4 + 3, k);
+
+      if(r != read0) {
+        if(!(my.bc_reported & (1 << k)))
+          pmsg_warning("broadcast target on SDI pin %d reads 0x%02x at %s address 0x%04x, not 0x%02x\n",
+            target_pin(pgm, k), r, m->desc, addr, read0);
+        my.bc_reported |= 1 << k;
+        m->buf[addr] = r;
+      }
+    }
+  }
   return 1;
 }
 
@@ -1082,38 +1338,31 @@ static int ft245r_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
   return -2;
 }
 
-static int ft245r_paged_load_gen(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
-  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
-
-  for(int i = 0; i < (int) n_bytes; i++) {
-    unsigned char rbyte;
-
-    if(avr_read_byte_default(pgm, p, m, addr + i, &rbyte) != 0)
-      return -2;
-
-    m->buf[addr + i] = rbyte;
-  }
-
-  return 0;
-}
-
-static int ft245r_paged_load_flash(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+/*
+ * Read flash, EEPROM or any other memory with SPI read commands that are
+ * queued up as requests so the FTDI FIFO is kept full
+ */
+static int ft245r_paged_load_spi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
 
-  int i, j, addr_save, buf_pos, req_count;
+  int i, j, addr_save, buf_pos, req_count, isflash = mem_is_flash(m);
   unsigned char buf[FT245R_FRAGMENT_SIZE + 1];
   unsigned char cmd[4];
 
-  if(m->op[AVR_OP_READ_LO] == NULL || m->op[AVR_OP_READ_HI] == NULL) {
+  if(isflash && (m->op[AVR_OP_READ_LO] == NULL || m->op[AVR_OP_READ_HI] == NULL)) {
     msg_error("AVR_OP_READ_HI/LO command not defined for %s\n", p->desc);
     return -1;
   }
+  if(!isflash && m->op[AVR_OP_READ] == NULL) {
+    msg_error("AVR_OP_READ command not defined for %s of %s\n", m->desc, p->desc);
+    return -1;
+  }
 
   /*
    * Always called with addr at page boundary, and n_bytes == m->page_size;
    * hence, OK to prepend load extended address command (at most) once
    */
-  if(m->op[AVR_OP_LOAD_EXT_ADDR]) {
+  if(isflash && m->op[AVR_OP_LOAD_EXT_ADDR]) {
     memset(cmd, 0, sizeof cmd);
     avr_set_bits(m->op[AVR_OP_LOAD_EXT_ADDR], cmd);
     avr_set_addr(m->op[AVR_OP_LOAD_EXT_ADDR], cmd, addr/2);
@@ -1126,13 +1375,14 @@ static int ft245r_paged_load_flash(const PROGRAMMER *pgm, const AVRPART *p, cons
 
   req_count = i = j = buf_pos = 0;
   addr_save = addr;
+  my.bc_reported = 0;
   while(i < (int) n_bytes) {
-    int spi = addr & 1? AVR_OP_READ_HI: AVR_OP_READ_LO;
+    int spi = !isflash? AVR_OP_READ: addr & 1? AVR_OP_READ_HI: AVR_OP_READ_LO;
 
     // Put the SPI read command as FT245R_CMD_SIZE bytes into buffer
     memset(cmd, 0, sizeof cmd);
     avr_set_bits(m->op[spi], cmd);
-    avr_set_addr(m->op[spi], cmd, addr/2);
+    avr_set_addr(m->op[spi], cmd, isflash? addr/2: addr);
     for(size_t k = 0; k < sizeof cmd; k++)
       buf_pos += set_data(pgm, buf + buf_pos, cmd[k]);
 
@@ -1174,11 +1424,8 @@ static int ft245r_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
   if(!n_bytes)
     return 0;
 
-  if(mem_is_flash(m))
-    return ft245r_paged_load_flash(pgm, p, m, page_size, addr, n_bytes);
-
-  if(mem_is_eeprom(m))
-    return ft245r_paged_load_gen(pgm, p, m, page_size, addr, n_bytes);
+  if(mem_is_flash(m) || m->op[AVR_OP_READ])
+    return ft245r_paged_load_spi(pgm, p, m, page_size, addr, n_bytes);
 
   return -2;
 }
@@ -1219,6 +1466,7 @@ void ft245r_initpgm(PROGRAMMER *pgm) {
   pgm->chip_erase = ft245r_chip_erase;
   pgm->cmd = ft245r_cmd;
   pgm->cmd_tpi = ft245r_cmd_tpi;
+  pgm->cmd_tpi_batch = ft245r_cmd_tpi_batch;
   pgm->open = ft245r_open;
   pgm->close = ft245r_close;
   pgm->read_byte = avr_read_byte_default;
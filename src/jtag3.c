@@ -131,6 +131,9 @@ struct pdata {
   int (*set_sck)(const PROGRAMMER *, unsigned char *);
 
   unsigned char signature_cache[2];     // Used in jtag3_read_byte()
+
+  int dap_packets;              // CMSIS-DAP packets the tool can buffer (DAP_Info), 0 if unknown
+  int batch;                    // -x batch: write commands queued per response round, 0 = off
 };
 
 #define my (*(struct pdata *) (pgm->cookie))
@@ -146,6 +149,9 @@ struct pdata {
 #define PGM_FL_IS_UPDI          (0x0010)
 #define PGM_FL_IS_TPI           (0x0020)
 
+// Largest memory block that -x batch reads in one CMD3_READ_MEMORY
+#define JTAG3_BATCH_MAX         896
+
 static int jtag3_open(PROGRAMMER *pgm, const char *port);
 static int jtag3_edbg_prepare(const PROGRAMMER *pgm);
 static int jtag3_edbg_signoff(const PROGRAMMER *pgm);
@@ -498,7 +504,10 @@ static int jtag3_edbg_send(const PROGRAMMER *pgm, unsigned char *data, size_t le
   if(nfragments > 1) {
     pmsg_debug("%s(): fragmenting into %d packets\n", __func__, nfragments);
   }
-  int frag;
+  int frag, pending = 0, acked = 0;
+
+  // Queue as many fragments as the tool buffers before collecting status
+  int depth = my.dap_packets > 1? my.dap_packets: 1;
 
   for(frag = 0; frag < nfragments; frag++) {
     int this_len;
@@ -535,24 +544,70 @@ static int jtag3_edbg_send(const PROGRAMMER *pgm, unsigned char *data, size_t le
       pmsg_notice("%s(): unable to send command to serial port\n", __func__);
       return -1;
     }
-    rv = serial_recv(&pgm->fd, status, max_xfer);
-
-    if(rv < 0) {
-      // Timeout in receive
-      pmsg_notice2("%s(): timeout receiving packet\n", __func__);
-      return -1;
-    }
-    if(status[0] != EDBG_VENDOR_AVR_CMD || (frag == nfragments - 1 && status[1] != 0x01)) {
-      // What to do in this case?
-      pmsg_notice("%s(): unexpected response 0x%02x, 0x%02x\n", __func__, status[0], status[1]);
-    }
     data += this_len;
     len -= this_len;
+    pending++;
+
+    while(pending && (pending >= depth || frag == nfragments - 1)) {
+      rv = serial_recv(&pgm->fd, status, max_xfer);
+
+      if(rv < 0) {
+        // Timeout in receive
+        pmsg_notice2("%s(): timeout receiving packet\n", __func__);
+        return -1;
+      }
+      pending--;
+      acked++;
+      if(status[0] != EDBG_VENDOR_AVR_CMD || (acked == nfragments && status[1] != 0x01)) {
+        // What to do in this case?
+        pmsg_notice("%s(): unexpected response 0x%02x, 0x%02x\n", __func__, status[0], status[1]);
+      }
+    }
   }
 
   return 0;
 }
 
+// Shortest valid CMSIS-DAP response: HID reports are always full size, bulk transfers are not padded
+static int jtag3_edbg_rsplen(const PROGRAMMER *pgm) {
+  return pgm->fd.usb.bulk_dap? 2: pgm->fd.usb.max_xfer;
+}
+
+// Ask for a numeric DAP_Info item; returns its value or -1
+static int jtag3_edbg_dap_info(const PROGRAMMER *pgm, unsigned char id) {
+  unsigned char buf[USBDEV_MAX_XFER_3] = { CMSISDAP_CMD_INFO, id };
+  unsigned char status[USBDEV_MAX_XFER_3];
+  int rv;
+
+  if(serial_send(&pgm->fd, buf, pgm->fd.usb.max_xfer) != 0)
+    return -1;
+  rv = serial_recv(&pgm->fd, status, pgm->fd.usb.max_xfer);
+  if(rv < jtag3_edbg_rsplen(pgm) || status[0] != CMSISDAP_CMD_INFO)
+    return -1;
+  if(status[1] == 1)
+    return status[2];
+  if(status[1] == 2)
+    return status[2] | status[3] << 8;
+
+  return -1;
+}
+
+/*
+ * Find out how many packets the tool can queue; over a CMSIS-DAP v2 bulk
+ * interface transfers are not tied to the endpoint size either, so also use
+ * the largest DAP packet the tool accepts. HID reports keep their size.
+ */
+static void jtag3_edbg_negotiate(PROGRAMMER *pgm) {
+  int size = pgm->fd.usb.bulk_dap? jtag3_edbg_dap_info(pgm, CMSISDAP_INFO_PACKET_SIZE): 0;
+
+  if(size >= 64) {
+    pgm->fd.usb.max_xfer = size < USBDEV_MAX_XFER_3? size: USBDEV_MAX_XFER_3;
+    pmsg_notice2("%s(): CMSIS-DAP packet size %d, using %d\n", __func__, size, pgm->fd.usb.max_xfer);
+  }
+  my.dap_packets = jtag3_edbg_dap_info(pgm, CMSISDAP_INFO_PACKET_COUNT);
+  pmsg_notice2("%s(): CMSIS-DAP packet count %d\n", __func__, my.dap_packets);
+}
+
 // Send out all the CMSIS-DAP stuff needed to prepare the ICE
 static int jtag3_edbg_prepare(const PROGRAMMER *pgm) {
   unsigned char buf[USBDEV_MAX_XFER_3];
@@ -572,7 +627,7 @@ static int jtag3_edbg_prepare(const PROGRAMMER *pgm) {
     return -1;
   }
   rv = serial_recv(&pgm->fd, status, pgm->fd.usb.max_xfer);
-  if(rv != pgm->fd.usb.max_xfer) {
+  if(rv < jtag3_edbg_rsplen(pgm)) {
     pmsg_error("unable to read from serial port (%d)\n", rv);
     return -1;
   }
@@ -588,7 +643,7 @@ static int jtag3_edbg_prepare(const PROGRAMMER *pgm) {
     return -1;
   }
   rv = serial_recv(&pgm->fd, status, pgm->fd.usb.max_xfer);
-  if(rv != pgm->fd.usb.max_xfer) {
+  if(rv < jtag3_edbg_rsplen(pgm)) {
     pmsg_error("unable to read from serial port (%d)\n", rv);
     return -1;
   }
@@ -618,7 +673,7 @@ static int jtag3_edbg_signoff(const PROGRAMMER *pgm) {
     return -1;
   }
   rv = serial_recv(&pgm->fd, status, pgm->fd.usb.max_xfer);
-  if(rv != pgm->fd.usb.max_xfer) {
+  if(rv < jtag3_edbg_rsplen(pgm)) {
     pmsg_notice("%s(): unable to read from serial port (%d)\n", __func__, rv);
     return -1;
   }
@@ -631,7 +686,7 @@ static int jtag3_edbg_signoff(const PROGRAMMER *pgm) {
     return -1;
   }
   rv = serial_recv(&pgm->fd, status, pgm->fd.usb.max_xfer);
-  if(rv != pgm->fd.usb.max_xfer) {
+  if(rv < jtag3_edbg_rsplen(pgm)) {
     pmsg_notice("%s(): unable to read from serial port (%d)\n", __func__, rv);
     return -1;
   }
@@ -690,15 +745,22 @@ static int jtag3_edbg_recv_frame(const PROGRAMMER *pgm, unsigned char **msg) {
 
   int nfrags = 0;
   int thisfrag = 0;
+  int requested = 0, got = 0;
+
+  // Keep as many requests for further fragments in flight as the tool buffers
+  int depth = my.dap_packets > 1? my.dap_packets: 1;
 
   do {
-    request[0] = EDBG_VENDOR_AVR_RSP;
+    while(requested < (nfrags? nfrags: 1) && requested - got < depth) {
+      request[0] = EDBG_VENDOR_AVR_RSP;
 
-    if(serial_send(&pgm->fd, request, pgm->fd.usb.max_xfer) != 0) {
-      pmsg_notice("%s(): unable to send CMSIS-DAP vendor command\n", __func__);
-      mmt_free(request);
-      mmt_free(*msg);
-      return -1;
+      if(serial_send(&pgm->fd, request, pgm->fd.usb.max_xfer) != 0) {
+        pmsg_notice("%s(): unable to send CMSIS-DAP vendor command\n", __func__);
+        mmt_free(request);
+        mmt_free(*msg);
+        return -1;
+      }
+      requested++;
     }
 
     rv = serial_recv(&pgm->fd, buf, pgm->fd.usb.max_xfer);
@@ -763,6 +825,7 @@ static int jtag3_edbg_recv_frame(const PROGRAMMER *pgm, unsigned char **msg) {
     }
     memmove(buf, buf + 4, thislen);
     thisfrag++;
+    got++;
     len += thislen;
     buf += thislen;
   } while(thisfrag <= nfrags);
@@ -815,16 +878,10 @@ int jtag3_recv(const PROGRAMMER *pgm, unsigned char **msg) {
   }
 }
 
-int jtag3_command(const PROGRAMMER *pgm, unsigned char *cmd, unsigned int cmdlen,
-  unsigned char **resp, const char *descr) {
-
-  int status;
+// Check the outcome of jtag3_recv() for a command; returns like jtag3_command()
+static int jtag3_check_resp(const PROGRAMMER *pgm, int status, unsigned char **resp, const char *descr) {
   unsigned char c;
 
-  pmsg_notice2("sending %s command: ", descr);
-  jtag3_send(pgm, cmd, cmdlen);
-
-  status = jtag3_recv(pgm, resp);
   if(status <= 0) {
     msg_notice2("\n");
     pmsg_notice2("%s command: timeout/error communicating with programmer (status %d)\n", descr, status);
@@ -854,6 +911,15 @@ int jtag3_command(const PROGRAMMER *pgm, unsigned char *cmd, unsigned int cmdlen
   return status;
 }
 
+int jtag3_command(const PROGRAMMER *pgm, unsigned char *cmd, unsigned int cmdlen,
+  unsigned char **resp, const char *descr) {
+
+  pmsg_notice2("sending %s command: ", descr);
+  jtag3_send(pgm, cmd, cmdlen);
+
+  return jtag3_check_resp(pgm, jtag3_recv(pgm, resp), resp, descr);
+}
+
 int jtag3_getsync(const PROGRAMMER *pgm, int mode) {
 
   unsigned char buf[3], *resp;
@@ -880,6 +946,13 @@ int jtag3_getsync(const PROGRAMMER *pgm, int mode) {
   return 0;
 }
 
+// Drop stale frames and sign on again after a failed paged transfer
+static int jtag3_resync(const PROGRAMMER *pgm) {
+  jtag3_drain(pgm, 0);
+
+  return jtag3_getsync(pgm, 0);
+}
+
 // Issue the 'chip erase' command to the AVR device
 static int jtag3_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   unsigned char buf[8], *resp;
@@ -1578,6 +1651,18 @@ static int jtag3_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       }
     }
 
+    if(str_eq(extended_param, "batch") || str_starts(extended_param, "batch=")) {
+      int n = 4;
+
+      if(extended_param[5] && (sscanf(extended_param, "batch=%i", &n) != 1 || n < 1 || n > 16)) {
+        pmsg_error("invalid value in -x %s; use -x batch or -x batch=<1..16>\n", extended_param);
+        rv = -1;
+        break;
+      }
+      my.batch = n;
+      continue;
+    }
+
     if(str_starts(extended_param, "mode") && (str_starts(pgmid, "pickit4") || str_starts(pgmid, "snap"))) {
       // Flag a switch to AVR mode
       if(str_caseeq(extended_param, "mode=avr")) {
@@ -1622,6 +1707,7 @@ static int jtag3_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       msg_error("  -x vtarg               Read on-board target supply voltage\n");
       msg_error("  -x vtarg=<dbl>         Set on-board target supply voltage to <dbl> V\n");
     }
+    msg_error("  -x batch[=<n>]         Queue <n> PDI/UPDI page writes per round trip (default 4)\n");
     if(str_starts(pgmid, "pickit4") || str_starts(pgmid, "snap")) {
       msg_error("  -x mode=avr            Set programmer to AVR mode and exit if it was not\n");
       msg_error("  -x mode=<mplab|pic>    Set programmer to MPLAB aka PIC mode and exit\n");
@@ -1786,6 +1872,7 @@ int jtag3_open_common(PROGRAMMER *pgm, const char *port, int mode_switch) {
   if(pgm->fd.usb.eep == 0) {
     pgm->flag |= PGM_FL_IS_EDBG;
     pmsg_notice2("found CMSIS-DAP compliant device, using EDBG protocol\n");
+    jtag3_edbg_negotiate(pgm);
   }
 
   // Make USB serial number available to programmer
@@ -1932,15 +2019,37 @@ static int jtag3_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   return 0;
 }
 
-static int jtag3_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
-  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+static unsigned short jtag3_seq_next(unsigned short seq) {
+  return ++seq == 0xffff? 0: seq;
+}
+
+// Number of write commands to queue with -x batch, 0 when batching is off
+static int jtag3_batch_depth(const PROGRAMMER *pgm, const AVRPART *p) {
+  if(!my.batch || (pgm->flag & PGM_FL_IS_DW) || !(p->prog_modes & (PM_PDI | PM_UPDI)))
+    return 0;
+  return my.batch;
+}
+
+/*
+ * Write the nr ranges rg[] of m; with -x batch the write commands of all
+ * ranges go through one queue, so the pipeline does not drain in between
+ */
+static int jtag3_paged_write_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, const Avr_range *rg, int nr) {
   unsigned int block_size;
-  unsigned int maxaddr = addr + n_bytes;
+  unsigned int addr, maxaddr;
   unsigned char *cmd;
   unsigned char *resp;
-  int status, dynamic_mtype = 0;
+  int status, dynamic_mtype = 0, n_bytes = 0;
   long otimeout = serial_recv_timeout;
 
+  for(int k = 0; k < nr; k++)
+    n_bytes += rg[k].n;
+  if(nr < 1 || !rg[0].n)
+    return n_bytes;
+  addr = rg[0].addr;
+  maxaddr = addr + rg[0].n;
+
   pmsg_notice2("jtag3_paged_write(.., %s, %d, 0x%04x, %d)\n", m->desc, page_size, addr, n_bytes);
 
   block_size = jtag3_memaddr(pgm, p, m, addr);
@@ -1969,13 +2078,14 @@ static int jtag3_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
        * jtag3_paged_write() to EEPROM attempted while in DW mode; use
        * jtag3_write_byte() instead.
        */
-      for(; addr < maxaddr; addr++) {
-        status = jtag3_write_byte(pgm, p, m, addr, m->buf[addr]);
-        if(status < 0) {
-          mmt_free(cmd);
-          return -1;
+      for(int k = 0; k < nr; k++)
+        for(addr = rg[k].addr; addr < rg[k].addr + rg[k].n; addr++) {
+          status = jtag3_write_byte(pgm, p, m, addr, m->buf[addr]);
+          if(status < 0) {
+            mmt_free(cmd);
+            return -1;
+          }
         }
-      }
       mmt_free(cmd);
       return n_bytes;
     }
@@ -1985,43 +2095,98 @@ static int jtag3_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
     cmd[3] = MTYPE_USERSIG;
   } else if(mem_is_boot(m)) {
     cmd[3] = MTYPE_BOOT_FLASH;
+  } else if(mem_is_fuses(m)) {  // Changed fuses in one block, see write_mem() in avr.c
+    cmd[3] = MTYPE_FUSE_BITS;
+    if(pgm->flag & PGM_FL_IS_DW) {
+      mmt_free(cmd);
+      return -1;
+    }
   } else if(p->prog_modes & (PM_PDI | PM_UPDI)) {
     cmd[3] = MTYPE_FLASH;
   } else {
     cmd[3] = MTYPE_SPM;
   }
+  /*
+   * With -x batch up to depth write commands are sent before their responses
+   * are collected; the sequence numbers of queued commands run ahead of
+   * my.command_sequence, which jtag3_recv() checks against and advances
+   */
+  int depth = jtag3_batch_depth(pgm, p), queued = 0;
+  if(depth < 1)
+    depth = 1;
+  int k = 0, ackk = 0;          // Range of the next page to send and of the oldest unconfirmed page
+  unsigned int acked = addr;
+  unsigned short sendseq = my.command_sequence;
+
   serial_recv_timeout = 100;
-  for(; addr < maxaddr; addr += page_size) {
-    if((maxaddr - addr) < page_size)
-      block_size = maxaddr - addr;
-    else
-      block_size = page_size;
-    pmsg_debug("%s(): block_size at addr %d is %d\n", __func__, addr, block_size);
+  while(k < nr || queued) {
+    if(k < nr && queued < depth) {
+      if((maxaddr - addr) < page_size)
+        block_size = maxaddr - addr;
+      else
+        block_size = page_size;
+      pmsg_debug("%s(): block_size at addr %d is %d\n", __func__, addr, block_size);
 
-    if(dynamic_mtype)
-      cmd[3] = jtag3_mtype(pgm, p, m, addr);
+      if(dynamic_mtype)
+        cmd[3] = jtag3_mtype(pgm, p, m, addr);
 
-    u32_to_b4(cmd + 8, page_size);
-    u32_to_b4(cmd + 4, jtag3_memaddr(pgm, p, m, addr));
-    cmd[12] = 0;
+      u32_to_b4(cmd + 8, page_size);
+      u32_to_b4(cmd + 4, jtag3_memaddr(pgm, p, m, addr));
+      cmd[12] = 0;
 
-    /*
-     * The JTAG ICE will refuse to write anything but a full page, at least for
-     * the flash ROM.  If a partial page has been requested, set the remainder
-     * to 0xff.  (Maybe we should rather read back the existing contents
-     * instead before?  Doesn't matter much, as bits cannot be written to 1
-     * anyway.)
-     */
-    memset(cmd + 13, 0xff, page_size);
-    memcpy(cmd + 13, m->buf + addr, block_size);
+      /*
+       * The JTAG ICE will refuse to write anything but a full page, at least
+       * for the flash ROM.  If a partial page has been requested, set the
+       * remainder to 0xff.  (Maybe we should rather read back the existing
+       * contents instead before?  Doesn't matter much, as bits cannot be
+       * written to 1 anyway.)
+       */
+      memset(cmd + 13, 0xff, page_size);
+      memcpy(cmd + 13, m->buf + addr, block_size);
+
+      unsigned short ackseq = my.command_sequence;
+
+      my.command_sequence = sendseq;
+      pmsg_notice2("sending write memory command: ");
+      status = jtag3_send(pgm, cmd, page_size + 13);
+      sendseq = jtag3_seq_next(sendseq);
+      my.command_sequence = ackseq;
+      if(status < 0)
+        goto failed;
+      queued++;
+      addr += page_size;
+      if(addr >= maxaddr && ++k < nr) {
+        addr = rg[k].addr;
+        maxaddr = addr + rg[k].n;
+      }
+      if(queued < depth && k < nr)
+        continue;
+    }
 
-    if((status = jtag3_command(pgm, cmd, page_size + 13, &resp, "write memory")) < 0) {
+    if((status = jtag3_check_resp(pgm, jtag3_recv(pgm, &resp), &resp, "write memory")) < 0)
+      goto failed;
+    mmt_free(resp);
+    queued--;
+    acked += page_size;
+    if(acked >= rg[ackk].addr + rg[ackk].n && ++ackk < nr)
+      acked = rg[ackk].addr;
+    continue;
+
+  failed:
+    my.command_sequence = sendseq;
+    if(depth == 1) {
       mmt_free(cmd);
       serial_recv_timeout = otimeout;
       return -1;
     }
-
-    mmt_free(resp);
+    // Give up on queueing for this session and redo unconfirmed pages one by one
+    pmsg_notice("batched write memory failed, falling back to one page per command\n");
+    my.batch = 0;
+    depth = 1;
+    queued = 0;
+    k = ackk;
+    addr = acked;
+    maxaddr = rg[k].addr + rg[k].n;
   }
 
   mmt_free(cmd);
@@ -2030,6 +2195,13 @@ static int jtag3_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
   return n_bytes;
 }
 
+static int jtag3_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+  Avr_range rg = {addr, n_bytes};
+
+  return jtag3_paged_write_multi(pgm, p, m, page_size, &rg, 1);
+}
+
 static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   unsigned int block_size;
@@ -2049,7 +2221,7 @@ static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   if(!(pgm->flag & PGM_FL_IS_DW) && jtag3_program_enable(pgm) < 0)
     return -1;
 
-  page_size = m->readsize;
+  page_size = m->readsize > 0? (unsigned int) m->readsize: n_bytes;
 
   cmd[0] = SCOPE_AVR;
   cmd[1] = CMD3_READ_MEMORY;
@@ -2070,6 +2242,10 @@ static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
     cmd[3] = MTYPE_USERSIG;
   } else if(mem_is_boot(m)) {
     cmd[3] = MTYPE_BOOT_FLASH;
+  } else if(mem_is_fuses(m)) {  // All fuses in one block, see avr_read_mem()
+    cmd[3] = MTYPE_FUSE_BITS;
+    if(pgm->flag & PGM_FL_IS_DW)
+      return -1;
   } else if(is_pdi(p)) {
     cmd[3] = MTYPE_FLASH;
   } else if(is_updi(p)) {
@@ -2077,8 +2253,12 @@ static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   } else {
     cmd[3] = MTYPE_SPM;
   }
+  // With -x batch read contiguous ranges in blocks as large as a jtag3 frame allows
+  if(jtag3_batch_depth(pgm, p) && page_size > 0 && page_size < JTAG3_BATCH_MAX)
+    page_size = JTAG3_BATCH_MAX/page_size*page_size;
+
   serial_recv_timeout = 100;
-  for(; addr < maxaddr; addr += page_size) {
+  for(; addr < maxaddr; addr += block_size) {
     if((maxaddr - addr) < page_size)
       block_size = maxaddr - addr;
     else
@@ -2091,19 +2271,22 @@ static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
     u32_to_b4(cmd + 8, block_size);
     u32_to_b4(cmd + 4, jtag3_memaddr(pgm, p, m, addr));
 
-    if((status = jtag3_command(pgm, cmd, 12, &resp, "read memory")) < 0)
-      return -1;
-
-    if(resp[1] != RSP3_DATA || status < (int) block_size + 4) {
+    status = jtag3_command(pgm, cmd, 12, &resp, "read memory");
+    if(status >= 0 && (resp[1] != RSP3_DATA || status < (int) block_size + 4)) {
       pmsg_error("wrong/short reply to read memory command\n");
-      serial_recv_timeout = otimeout;
       mmt_free(resp);
-      return -1;
+      status = -1;
     }
-
-    if(status < 4) {
-      pmsg_error("unexpected response from read memory jtag3_command()\n");
-      mmt_free(resp);
+    if(status < 0) {
+      if(page_size > (unsigned int) m->readsize && m->readsize > 0) {
+        // Give up on large blocks for this session and redo this one in readsize pieces
+        pmsg_notice("batched read memory failed, falling back to readsize blocks\n");
+        my.batch = 0;
+        page_size = m->readsize;
+        block_size = 0;
+        continue;
+      }
+      serial_recv_timeout = otimeout;
       return -1;
     }
 
@@ -2115,6 +2298,24 @@ static int jtag3_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   return n_bytes;
 }
 
+// With -x batch read neighbouring ranges in one command if they fit into a jtag3 frame
+static int jtag3_paged_load_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, const Avr_range *rg, int nr) {
+  unsigned int rs = m->readsize > 0? (unsigned int) m->readsize: page_size;
+  Avr_range *r = mmt_malloc(nr*sizeof *r);
+  int n = nr, rc = 0, n_bytes = 0;
+
+  for(int i = 0; i < nr; i++)
+    n_bytes += (r[i] = rg[i]).n;
+  if(jtag3_batch_depth(pgm, p) && rs > 0 && rs < JTAG3_BATCH_MAX)
+    n = avr_ranges_coalesce(r, nr, JTAG3_BATCH_MAX/rs*rs);
+  for(int i = 0; i < n && rc >= 0; i++)
+    rc = jtag3_paged_load(pgm, p, m, page_size, r[i].addr, r[i].n);
+  mmt_free(r);
+
+  return rc < 0? rc: n_bytes;
+}
+
 static int jtag3_read_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned long addr, unsigned char *value) {
   unsigned char cmd[12];
@@ -2295,6 +2496,47 @@ static int jtag3_read_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM
   return 0;
 }
 
+// Read sram or io in blocks as large as a jtag3 frame allows rather than byte by byte
+static int jtag3_read_block(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int addr, unsigned int n, unsigned char *buf) {
+
+  unsigned char cmd[12], *resp;
+  int status;
+
+  if(!mem_is_io(mem) && !mem_is_sram(mem))
+    return -2;
+  if(addr >= (unsigned int) mem->size || n > (unsigned int) mem->size - addr)
+    return -1;
+
+  pmsg_notice2("jtag3_read_block(.., %s, 0x%04x, %u)\n", mem->desc, addr, n);
+
+  if(!(pgm->flag & PGM_FL_IS_DW))
+    if((status = jtag3_program_enable(pgm)) < 0)
+      return status;
+
+  cmd[0] = SCOPE_AVR;
+  cmd[1] = CMD3_READ_MEMORY;
+  cmd[2] = 0;
+  cmd[3] = MTYPE_SRAM;
+  for(unsigned int done = 0, chunk; done < n; done += chunk) {
+    chunk = n - done > JTAG3_BATCH_MAX? JTAG3_BATCH_MAX: n - done;
+    u32_to_b4(cmd + 8, chunk);
+    u32_to_b4(cmd + 4, jtag3_memaddr(pgm, p, mem, addr + done));
+
+    if((status = jtag3_command(pgm, cmd, 12, &resp, "read memory")) < 0)
+      return status;
+    if(resp[1] != RSP3_DATA || status < (int) chunk + 4) {
+      pmsg_error("wrong/short reply to read memory command\n");
+      mmt_free(resp);
+      return -1;
+    }
+    memcpy(buf + done, resp + 3, chunk);
+    mmt_free(resp);
+  }
+
+  return n;
+}
+
 static int jtag3_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned long addr, unsigned char data) {
 
@@ -3260,7 +3502,14 @@ void jtag3_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = jtag3_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_write_multi = jtag3_paged_write_multi;
   pgm->paged_load = jtag3_paged_load;
+  pgm->read_block = jtag3_read_block;
+  pgm->resync = jtag3_resync;
+  pgm->multipage_load = 1;
+  pgm->max_load = 65536;
+  pgm->paged_load_multi = jtag3_paged_load_multi;
   pgm->page_erase = jtag3_page_erase;
   pgm->print_parms = jtag3_print_parms;
   pgm->set_sck_period = jtag3_set_sck_period;
@@ -3298,7 +3547,14 @@ void jtag3_dw_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = jtag3_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_write_multi = jtag3_paged_write_multi;
   pgm->paged_load = jtag3_paged_load;
+  pgm->read_block = jtag3_read_block;
+  pgm->resync = jtag3_resync;
+  pgm->multipage_load = 1;
+  pgm->max_load = 65536;
+  pgm->paged_load_multi = jtag3_paged_load_multi;
   pgm->page_erase = NULL;
   pgm->print_parms = jtag3_print_parms;
   pgm->parseextparams = jtag3_parseextparms;
@@ -3333,7 +3589,16 @@ void jtag3_pdi_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = jtag3_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_write_multi = jtag3_paged_write_multi;
   pgm->paged_load = jtag3_paged_load;
+  pgm->read_block = jtag3_read_block;
+  pgm->resync = jtag3_resync;
+  pgm->multipage_load = 1;
+  pgm->max_load = 65536;
+  pgm->paged_load_multi = jtag3_paged_load_multi;
+  pgm->range_load = 1;
+  pgm->range_write = 1;
   pgm->page_erase = jtag3_page_erase;
   pgm->print_parms = jtag3_print_parms;
   pgm->set_sck_period = jtag3_set_sck_period;
@@ -3371,7 +3636,16 @@ void jtag3_updi_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = jtag3_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_write_multi = jtag3_paged_write_multi;
   pgm->paged_load = jtag3_paged_load;
+  pgm->read_block = jtag3_read_block;
+  pgm->resync = jtag3_resync;
+  pgm->multipage_load = 1;
+  pgm->max_load = 65536;
+  pgm->paged_load_multi = jtag3_paged_load_multi;
+  pgm->range_load = 1;
+  pgm->range_write = 1;
   pgm->page_erase = jtag3_page_erase;
   pgm->print_parms = jtag3_print_parms;
   pgm->set_sck_period = jtag3_set_sck_period;
@@ -3412,6 +3686,7 @@ void jtag3_tpi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtag3_paged_write_tpi;
   pgm->paged_load = jtag3_paged_load_tpi;
+  pgm->resync = jtag3_resync;
   pgm->page_erase = NULL;
   pgm->print_parms = jtag3_print_parms;
   pgm->parseextparams = jtag3_parseextparms;
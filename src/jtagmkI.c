@@ -37,6 +37,7 @@
 
 struct pdata {
   int initial_baudrate;
+  long baudrate;                // Current baud rate of the ICE
 
   // See jtagmkI_read_byte() for an explanation of the flash and EEPROM page caches
   unsigned char *flash_pagecache;
@@ -426,10 +427,38 @@ static unsigned char jtagmkI_get_baud(long baud) {
   return 0;
 }
 
+static long jtagmkI_fastest_baud(void) {
+  long baud = 0;
+
+  for(size_t i = 0; i < sizeof baudtab/sizeof baudtab[0]; i++)
+    if(baudtab[i].baud > baud)
+      baud = baudtab[i].baud;
+
+  return baud;
+}
+
+// Switch ICE and serial line to another baud rate
+static int jtagmkI_switch_baud(const PROGRAMMER *pgm, long baud) {
+  unsigned char b;
+
+  if(!(serdev->flags & SERDEV_FL_CANSETSPEED) || baud == my.baudrate)
+    return 0;
+  if((b = jtagmkI_get_baud(baud)) == 0) {
+    pmsg_error("unsupported baudrate %ld\n", baud);
+    return -1;
+  }
+  pmsg_notice2("%s(): trying to set baudrate to %ld\n", __func__, baud);
+  if(jtagmkI_setparm(pgm, PARM_BITRATE, b) < 0)
+    return -1;
+  serial_setparams(&pgm->fd, baud, SERIAL_8N1);
+  my.baudrate = baud;
+
+  return 0;
+}
+
 // Initialize the AVR device and prepare it to accept commands
 static int jtagmkI_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
   unsigned char cmd[1], resp[5];
-  unsigned char b;
 
   if(!(p->prog_modes & (PM_JTAGmkI | PM_JTAG))) {
     pmsg_error("part %s has no JTAG interface\n", p->desc);
@@ -440,18 +469,6 @@ static int jtagmkI_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
 
   jtagmkI_drain(pgm, 0);
 
-  if((serdev->flags & SERDEV_FL_CANSETSPEED) && my.initial_baudrate != pgm->baudrate) {
-    if((b = jtagmkI_get_baud(pgm->baudrate)) == 0) {
-      pmsg_error("unsupported baudrate %d\n", pgm->baudrate);
-    } else {
-      pmsg_notice2("%s(): trying to set baudrate to %d\n", __func__, pgm->baudrate);
-      if(jtagmkI_setparm(pgm, PARM_BITRATE, b) == 0) {
-        my.initial_baudrate = pgm->baudrate; // Don't adjust again later
-        serial_setparams(&pgm->fd, pgm->baudrate, SERIAL_8N1);
-      }
-    }
-  }
-
   if(pgm->bitclock) {
     if(!(pgm->extra_features & HAS_BITCLOCK_ADJ))
       pmsg_warning("setting bitclock despite HAS_BITCLOCK_ADJ missing in pgm->extra_features\n");
@@ -530,8 +547,16 @@ static int jtagmkI_open(PROGRAMMER *pgm, const char *port) {
     jtagmkI_drain(pgm, 0);
 
     if(jtagmkI_getsync(pgm) == 0) {
-      my.initial_baudrate = baudtab[i].baud;
+      my.initial_baudrate = my.baudrate = baudtab[i].baud;
       pmsg_notice2("%s(): succeeded\n", __func__);
+
+      // Page transfers are dominated by the line speed: go as fast as requested or possible
+      long baud = pgm->baudrate && jtagmkI_get_baud(pgm->baudrate)? pgm->baudrate: jtagmkI_fastest_baud();
+
+      if(pgm->baudrate && baud != pgm->baudrate)
+        pmsg_warning("unsupported baudrate %d, using %ld\n", pgm->baudrate, baud);
+      jtagmkI_switch_baud(pgm, baud);
+
       return 0;
     }
 
@@ -545,24 +570,14 @@ static int jtagmkI_open(PROGRAMMER *pgm, const char *port) {
 }
 
 static void jtagmkI_close(PROGRAMMER *pgm) {
-  unsigned char b;
-
   pmsg_notice2("jtagmkI_close()\n");
 
   /*
    * Revert baud rate to what it used to be when we started.  This appears to
    * make AVR Studio happier when it is about to access the ICE later on.
    */
-  if((serdev->flags & SERDEV_FL_CANSETSPEED) && my.initial_baudrate != pgm->baudrate) {
-    if((b = jtagmkI_get_baud(my.initial_baudrate)) == 0) {
-      pmsg_error("unsupported baudrate %d\n", my.initial_baudrate);
-    } else {
-      pmsg_notice2("%s(): trying to set baudrate to %d\n", __func__, my.initial_baudrate);
-      if(jtagmkI_setparm(pgm, PARM_BITRATE, b) == 0) {
-        serial_setparams(&pgm->fd, pgm->baudrate, SERIAL_8N1);
-      }
-    }
-  }
+  if(pgm->fd.ifd != -1 && my.initial_baudrate > 0)
+    jtagmkI_switch_baud(pgm, my.initial_baudrate);
 
   if(pgm->fd.ifd != -1) {
     serial_close(&pgm->fd);
@@ -620,10 +635,7 @@ static int jtagmkI_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
       return -1;
     }
 
-    if(n_bytes < page_size)
-      block_size = n_bytes;
-    else
-      block_size = page_size;
+    block_size = maxaddr - addr < page_size? maxaddr - addr: page_size;
     pmsg_debug("%s(): block_size at addr %d is %d\n", __func__, addr, block_size);
 
     // We always write full pages
@@ -692,9 +704,15 @@ static int jtagmkI_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
   return n_bytes;
 }
 
+/*
+ * Reads contiguous pages with as few read memory commands as the ICE buffer
+ * allows (256 words of flash or 256 bytes of EEPROM), relying on the ICE to
+ * advance the address within each command
+ */
 static int jtagmkI_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   int block_size, read_size, is_flash = 0, tries;
+  unsigned int readsize, maxblock;
   unsigned int maxaddr = addr + n_bytes;
   unsigned char cmd[6], resp[256*2 + 3];
   long otimeout = serial_recv_timeout;
@@ -706,7 +724,7 @@ static int jtagmkI_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
   if(jtagmkI_program_enable(pgm) < 0)
     return -1;
 
-  page_size = m->readsize;
+  readsize = m->readsize > 0? (unsigned int) m->readsize: page_size;
 
   cmd[0] = CMD_READ_MEM;
   if(mem_is_flash(m)) {
@@ -716,13 +734,16 @@ static int jtagmkI_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
     cmd[1] = MTYPE_EEPROM_PAGE;
   }
 
-  if(page_size > (is_flash? 512: 256)) {
-    pmsg_error("page size %d too large\n", page_size);
+  maxblock = is_flash? 512: 256;
+  if(readsize > maxblock) {
+    pmsg_error("page size %d too large\n", readsize);
     return -1;
   }
+  if(!is_flash)                 // EEPROM is read in whole pages
+    maxblock -= maxblock%readsize;
 
   serial_recv_timeout = 1000;
-  for(; addr < maxaddr; addr += page_size) {
+  for(; addr < maxaddr; addr += block_size) {
     tries = 0;
   again:
     if(tries != 0 && jtagmkI_resync(pgm, 2000, 0) < 0) {
@@ -730,10 +751,7 @@ static int jtagmkI_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       return -1;
     }
 
-    if(n_bytes < page_size)
-      block_size = n_bytes;
-    else
-      block_size = page_size;
+    block_size = maxaddr - addr < maxblock? maxaddr - addr: maxblock;
     pmsg_debug("%s(): block_size at addr %d is %d\n", __func__, addr, block_size);
 
     if(is_flash) {
@@ -741,8 +759,8 @@ static int jtagmkI_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       cmd[2] = read_size/2 - 1;
       u32_to_b3(cmd + 3, addr/2);
     } else {
-      read_size = page_size;
-      cmd[2] = page_size - 1;
+      read_size = (block_size + readsize - 1)/readsize*readsize;
+      cmd[2] = read_size - 1;
       u32_to_b3(cmd + 3, addr);
     }
 
@@ -1179,6 +1197,7 @@ void jtagmkI_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkI_paged_write;
   pgm->paged_load = jtagmkI_paged_load;
+  pgm->multipage_load = 1;
   pgm->print_parms = jtagmkI_print_parms;
   pgm->set_sck_period = jtagmkI_set_sck_period;
   pgm->get_sck_period = jtagmkI_get_sck_period;
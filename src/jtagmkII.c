@@ -93,6 +93,9 @@ struct pdata {
   // Most recent operation was a memory write or erase
   int recently_written;
 
+  // Largest flash read block the firmware accepted; 0 means not yet probed
+  unsigned int max_read;
+
 #define FLAGS32_INIT_SMC      1 // Part will undergo chip erase
 #define FLAGS32_WRITE         2 // At least one write operation specified
   // Couple of flag bits for AVR32 programming
@@ -605,7 +608,7 @@ int jtagmkII_recv(const PROGRAMMER *pgm, unsigned char **msg) {
        */
       memmove(*msg, *msg + 8, rv);
 
-      if(verbose >= MSG_TRACE)
+      if(msg_lvl_on(MSG_TRACE))
         trace_buffer(__func__, *msg, rv);
 
       return rv;
@@ -1999,13 +2002,28 @@ static int jtagmkII_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AV
   } else {
     cmd[1] = MTYPE_SPM;
   }
+  /*
+   * Multi-page flash runs are read in blocks of up to JTAGMKII_READ_MAX bytes; the block
+   * size is halved whenever the firmware refuses a block and the result is remembered
+   */
+  int bigread = mem_is_in_flash(m) && !(pgm->flag & PGM_FL_IS_DW);
+
+  if(bigread && !my.max_read)
+    my.max_read = JTAGMKII_READ_MAX;
+
   serial_recv_timeout = 100;
-  for(; addr < maxaddr; addr += page_size) {
-    if((maxaddr - addr) < page_size)
+  for(; addr < maxaddr; addr += block_size) {
+    unsigned int chunk = bigread && my.max_read > page_size? my.max_read: page_size;
+
+    if((maxaddr - addr) < chunk)
       block_size = maxaddr - addr;
     else
-      block_size = page_size;
+      block_size = chunk;
+    if(dynamic_mtype && addr < my.boot_start && addr + block_size > my.boot_start)
+      block_size = my.boot_start - addr; // Do not straddle application and boot section
     pmsg_debug("%s(): block_size at addr %d is %d\n", __func__, addr, block_size);
+    if(block_size > page_size && serial_recv_timeout < 100 + (long) block_size/2)
+      serial_recv_timeout = 100 + block_size/2; // Allow for slow serial links
 
     if(dynamic_mtype)
       cmd[1] = jtagmkII_mtype(pgm, p, m, addr);
@@ -2020,6 +2038,15 @@ static int jtagmkII_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AV
     jtagmkII_send(pgm, cmd, 10);
 
     status = jtagmkII_recv(pgm, &resp);
+    if(block_size > page_size && (status <= 0 || resp[0] != RSP_MEMORY || status - 1 != (int) block_size)) {
+      msg_notice2("\n");
+      pmsg_notice2("%s(): read block of %u bytes refused, halving\n", __func__, block_size);
+      if(status > 0)
+        mmt_free(resp);
+      my.max_read = block_size/2;
+      block_size = 0;           // Loop re-reads from addr with the smaller block
+      continue;
+    }
     if(status <= 0) {
       msg_notice2("\n");
       pmsg_warning("timeout/error communicating with programmer (status %d)\n", status);
@@ -3728,6 +3755,7 @@ void jtagmkII_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->page_erase = jtagmkII_page_erase;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->set_sck_period = jtagmkII_set_sck_period;
@@ -3760,6 +3788,7 @@ void jtagmkII_dw_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->setup = jtagmkII_setup;
   pgm->teardown = jtagmkII_teardown;
@@ -3787,6 +3816,7 @@ void jtagmkII_pdi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->page_erase = jtagmkII_page_erase;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->setup = jtagmkII_setup;
@@ -3816,6 +3846,7 @@ void jtagmkII_updi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->page_erase = jtagmkII_page_erase;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->parseextparams = jtagmkII_parseextparms;
@@ -3848,6 +3879,7 @@ void jtagmkII_dragon_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->page_erase = jtagmkII_page_erase;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->set_sck_period = jtagmkII_set_sck_period;
@@ -3880,6 +3912,7 @@ void jtagmkII_dragon_dw_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->setup = jtagmkII_setup;
   pgm->teardown = jtagmkII_teardown;
@@ -3936,6 +3969,7 @@ void jtagmkII_dragon_pdi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = jtagmkII_paged_write;
   pgm->paged_load = jtagmkII_paged_load;
+  pgm->multipage_load = 1;
   pgm->page_erase = jtagmkII_page_erase;
   pgm->print_parms = jtagmkII_print_parms;
   pgm->setup = jtagmkII_setup;
@@ -67,6 +67,9 @@
  * check can only be done once the entire packet came it.
  */
 #define MAX_MESSAGE 100000
+
+// Largest flash read block tried in one CMND_READ_MEMORY before falling back to readsize
+#define JTAGMKII_READ_MAX 1024
 #endif                          // JTAGMKII_PRIVATE_EXPORTED
 
 // ICE command codes
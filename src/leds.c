@@ -86,7 +86,7 @@ static void led_physical(const PROGRAMMER *pgm, Leds *ls, int led, int what) {
   if(led < 0 || led >= LED_N)   // Sanity
     return;
 
-  unsigned long now = avr_mstimestamp();
+  unsigned long now = avr_mstimestamp_coarse();
 
   if(what == ON || what == OFF) {
     if(what)                    // Force on or off
@@ -267,6 +267,8 @@ int led_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, uns
 
   int rc = pgm->page_erase? led_set(pgm, LED_PGM), pgm->page_erase(pgm, p, m, baseaddr): -1;
 
+  devcache_forget(m, baseaddr, m->page_size);
+
   if(rc < 0)
     led_set(pgm, LED_ERR);
   led_clr(pgm, LED_PGM);
@@ -53,6 +53,19 @@
  * with the application.
  */
 
+// Storage class of per-session variables, see the notes on cx below
+#ifndef LIBAVRDUDE_THREAD_LOCAL
+#if defined(SWIG)
+#define LIBAVRDUDE_THREAD_LOCAL
+#elif defined(_MSC_VER)
+#define LIBAVRDUDE_THREAD_LOCAL __declspec(thread)
+#elif defined(__cplusplus)
+#define LIBAVRDUDE_THREAD_LOCAL thread_local
+#else
+#define LIBAVRDUDE_THREAD_LOCAL _Thread_local
+#endif
+#endif
+
 typedef uint32_t Pinmask;
 
 /*
@@ -112,6 +125,7 @@ enum msgmode {
 
 typedef void *LISTID;
 typedef void *LNODEID;
+typedef void *LHASHID;
 
 /*----------------------------------------------------------------------
   several defines to access the LIST structure as as stack or a queue
@@ -142,6 +156,7 @@ extern "C" {
 // .................... Function Prototypes ....................
 
   LISTID lcreat(void *liststruct, int poolsize);
+  LISTID lcreat_vec(void *liststruct, int poolsize); // Also keeps an array for lvec()
   void ldestroy(LISTID lid);
   void ldestroy_cb(LISTID lid, void (*ucleanup)(void *data_ptr));
 
@@ -151,6 +166,8 @@ extern "C" {
   LNODEID lprev(LNODEID);       // Previous item in the list
   void *ldata(LNODEID);         // Data at the current position
   int lsize(LISTID);            // Number of elements in the list
+  void **lvec(LISTID);          // Contiguous array of the lsize() data pointers
+  unsigned long lgen(LISTID);   // Changes when elements are removed, reordered or inserted before the end
 
   int ladd(LISTID lid, void *p);
   int laddo(LISTID lid, void *p, int (*compare)(const void *p1, const void *p2), LNODEID *firstdup);
@@ -175,6 +192,12 @@ extern "C" {
 
   int lprint(FILE *f, LISTID lid);
 
+  LHASHID lhcreat(void);
+  void lhdestroy(LHASHID hid);
+  void lhdestroy_cb(LHASHID hid, void (*ucleanup)(void *data_ptr));
+  int lhadd(LHASHID hid, const char *key, void *data);
+  void *lhget(LHASHID hid, const char *key);
+
 #ifdef __cplusplus
 }
 #endif
@@ -224,8 +247,23 @@ typedef struct cmdbit {
   int value;                    // Bit value if type == AVR_CMDBIT_VALUE
 } CMDBIT;
 
+#define OP_NRUNS 4               // Max number of distinct bit shifts per bit kind of compiled OPCODE
+
+// Bits of one kind that are moved by the same shift into/out of the 32-bit command word
+typedef struct oprun {
+  uint32_t mask[OP_NRUNS];      // Command word bits of this run
+  signed char shift[OP_NRUNS];  // Command bit number minus source bit number
+  int n;                        // Number of runs
+} OPRUN;
+
 typedef struct opcode {
   CMDBIT bit[32];               // Opcode bit specs
+  // Compiled form of bit[] set by avr_compile_opcode(); command bytes are a big-endian word
+  int compiled;                 // Fields below are valid
+  uint32_t fixmask, fixval;     // Command bits from 0, 1 and x bits and their values
+  uint32_t amask, imask, omask; // Command bits that are a, i and o bits, respectively
+  uint32_t abits;               // Address bits that the opcode provides
+  OPRUN arun, irun, orun;       // How to move a, i and o bits
 } OPCODE;
 
 // Any changes here, please also reflect in dev_part_strct() of developer_opts.c
@@ -317,6 +355,19 @@ typedef struct opcode {
 
 #define TAG_ALLOCATED         1 // Memory byte is allocated
 
+/*
+ * Allocation tags are a bitset with one bit per memory byte held in
+ * tag_bytes(size) bytes; a set bit means TAG_ALLOCATED. Access single tags
+ * with the macros below and ranges with tag_set_range() etc in avrpart.c
+ */
+#define tag_bytes(size) (((size) + 7)/8)
+#define tag_isset(tags, i) (!!((tags)[(i)/8] & (1 << ((i)%8))))
+#define tag_set(tags, i) ((tags)[(i)/8] |= 1 << ((i)%8))
+#define tag_clr(tags, i) ((tags)[(i)/8] &= ~(1 << ((i)%8)))
+
+// Test bit k of a page map returned by avr_page_map()
+#define page_is_allocated(map, k) (!!((map)[(k)/8] & (1 << ((k)%8))))
+
 /*
  * Any changes in AVRPART or AVRMEM, please also ensure changes are made in
  *  - lexer.l
@@ -408,6 +459,7 @@ typedef struct avrpart {
 
   LISTID mem;                   // AVR memory definitions
   LISTID mem_alias;             // Memory alias definitions
+  struct avrmem_index *mem_index;       // Memory lookup tables set by avr_initmem()
   const char *config_file;      // Config file where defined
   int lineno;                   // Config file line number
 } AVRPART;
@@ -585,7 +637,7 @@ typedef struct avrmem {
   int pollindex;                // Stk500 v2 xml file parameter
 
   unsigned char *buf;           // Pointer to memory buffer
-  unsigned char *tags;          // Allocation tags
+  unsigned char *tags;          // Allocation tags: bitset of tag_bytes(size) bytes
   OPCODE *op[AVR_OP_MAX];       // Opcodes
 } AVRMEM;
 
@@ -604,6 +656,7 @@ extern "C" {
 
   // Functions for OPCODE structures
   OPCODE *avr_new_opcode(void);
+  void avr_compile_opcode(OPCODE *op);
   void avr_free_opcode(OPCODE *op);
   int avr_set_bits(const OPCODE *op, unsigned char *cmd);
   int avr_set_addr(const OPCODE *op, unsigned char *cmd, unsigned long addr);
@@ -634,9 +687,17 @@ extern "C" {
   AVRMEM_ALIAS *avr_find_memalias(const AVRPART *p, const AVRMEM *m_orig);
   void avr_mem_display(FILE *f, const PROGRAMMER *pgm, const AVRPART *p, const char *prefix);
 
+  // Functions for allocation tag bitsets
+  void tag_set_range(unsigned char *tags, int from, int n);
+  void tag_clr_range(unsigned char *tags, int from, int n);
+  int tag_next(const unsigned char *tags, int from, int to, int set);
+  int tag_any(const unsigned char *tags, int from, int n);
+  void tag_copy(unsigned char *dst, int dfrom, const unsigned char *src, int sfrom, int n);
+
   // Functions for AVRPART structures
   AVRPART *avr_new_part(void);
   AVRPART *avr_dup_part(const AVRPART *d);
+  AVRPART *avr_dup_part_mem(const AVRPART *d, const AVRMEM *m);
   void avr_free_part(AVRPART *d);
   AVRPART *locate_part(const LISTID parts, const char *partdesc);
   AVRPART *locate_part_by_avr910_devcode(const LISTID parts, int devcode);
@@ -834,8 +895,8 @@ const char *pinmask_to_str(const Pinmask *const pinmask);
  * The target file will be selected at configure time.
  */
 
-extern long serial_recv_timeout;        // Milliseconds
-extern long serial_drain_timeout;       // Milliseconds
+extern LIBAVRDUDE_THREAD_LOCAL long serial_recv_timeout;  // Milliseconds
+extern LIBAVRDUDE_THREAD_LOCAL long serial_drain_timeout; // Milliseconds
 
 union filedescriptor {
   int ifd;
@@ -846,7 +907,9 @@ union filedescriptor {
     int wep;                    // Bulk write endpoint
     int eep;                    // Event read endpoint
     int max_xfer;               // Max transfer size
+    int wmaxpkt;                // Max packet size of write endpoint if known, 0 otherwise
     int use_interrupt_xfer;     // Device uses interrupt transfers
+    int bulk_dap;               // CMSIS-DAP v2 vendor interface: bulk, no report padding
   } usb;
 };
 
@@ -887,6 +950,8 @@ union pinfo {
 };
 
 struct serial_device {
+  const char *name;             // Transport name for statistics, eg, "serial" or "libusb"
+
   // Open should return -1 on error, other values on success
   int (*open)(const char *port, union pinfo pinfo, union filedescriptor *fd);
   int (*setparams)(const union filedescriptor *fd, long baud, unsigned long cflags);
@@ -906,28 +971,195 @@ struct serial_device {
 #define SERDEV_FL_CANSETSPEED 1 // Device can change speed
 };
 
-extern struct serial_device *serdev;
+extern LIBAVRDUDE_THREAD_LOCAL struct serial_device *serdev;
 extern struct serial_device serial_serdev;
 extern struct serial_device usb_serdev;
 extern struct serial_device usb_serdev_frame;
 extern struct serial_device avrdoper_serdev;
 extern struct serial_device usbhid_serdev;
 
-#define serial_open (serdev->open)
-#define serial_setparams (serdev->setparams)
-#define serial_close (serdev->close)
-#define serial_rawclose (serdev->rawclose)
-#define serial_send (serdev->send)
-#define serial_recv (serdev->recv)
-#define serial_drain (serdev->drain)
-#define serial_set_dtr_rts (serdev->set_dtr_rts)
+extern struct serial_device serial_replay_serdev;
+
+// Replaying a recorded session overrides whichever transport the programmer has chosen
+#define serial_dev (cx->strc_replay? &serial_replay_serdev: serdev)
+
+#define serial_open (serial_dev->open)
+#define serial_setparams (serial_dev->setparams)
+#define serial_close (serial_dev->close)
+#define serial_rawclose (serial_dev->rawclose)
+#define serial_send serial_trace_send // Record transfer in trace ring buffer, see sertrace.c
+#define serial_recv serial_trace_recv
+#define serial_drain (serial_dev->drain)
+#define serial_set_dtr_rts (serial_dev->set_dtr_rts)
+
+// See sertrace.c
+#define SERTRACE_SEND 0
+#define SERTRACE_RECV 1
+
+typedef struct {                // One recorded serial transaction
+  uint64_t us;                  // Timestamp from avr_ustimestamp()
+  uint64_t off;                 // Position of payload in the data ring
+  size_t len, n;                // Transfer length and number of payload bytes stored
+  int dir, rc;                  // SERTRACE_SEND/SERTRACE_RECV, return code of transfer
+} Sertrace_rec;
+
+#define SERSTAT_NBIN 25         // Log2 histogram bins: [0, 1], [2, 3], [4, 7], ..., 2^24 and above
+
+typedef struct {                // Transfer statistics of one transport
+  const struct serial_device *dev;
+  unsigned long nsend, nrecv, nerr;     // Number of sends, receives and failed transfers
+  uint64_t bsend, brecv;        // Bytes sent and received
+  unsigned long nrtt;           // Number of round trips (send followed by receive)
+  uint64_t rtt_sum, rtt_max;    // Sum and maximum of round trip times in us
+  uint64_t t_send;              // End of last send still waiting for its receive (0 if none)
+  unsigned long rtt[SERSTAT_NBIN];      // Histogram of round trip times in us
+  unsigned long xfer[SERSTAT_NBIN];     // Histogram of bytes per transfer
+} Serial_stats;
+
+typedef struct {                // Reply time estimate of an operation, see serial_rto()
+  int nsamples;                 // Number of samples so far
+  int backoff;                  // Number of timeouts since the last sample
+  int64_t srtt, rttvar;         // Smoothed reply time and its mean deviation in us
+} Serial_rtt;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int serial_trace_send(const union filedescriptor *fd, const unsigned char *buf, size_t buflen);
+  int serial_trace_recv(const union filedescriptor *fd, unsigned char *buf, size_t buflen);
+  void serial_trace_show(int nrec);
+  const Serial_stats *serial_stats(int *np);
+  void serial_stats_show(void);
+  void serial_rtt_sample(Serial_rtt *r, uint64_t us);
+  void serial_rtt_timeout(Serial_rtt *r);
+  long serial_rto(const Serial_rtt *r, long worst_ms);
+  int serial_trace_write(const char *fname);
+  int serial_record_open(const char *fname);
+  int serial_record_close(void);
+  int serial_replay_load(const char *fname);
+  void serial_replay_done(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See usb_enum.c
+struct usb_device;
+struct usb_dev_handle;
+struct libusb_context;
+struct libusb_device;
+struct libusb_device_handle;
+struct hid_device_info;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  const char *usb_enum_lookup(const char *bus, const char *addr, int vid, int pid, int index);
+  void usb_enum_remember(const char *bus, const char *addr, int vid, int pid, int index, const char *str);
+  void usb_enum_busses(void);
+  int usb_enum_string(struct usb_dev_handle **hp, struct usb_device *dev, int index, char *buf, size_t len);
+  struct libusb_context *usb_enum_context(void);
+  int usb_enum_devices(struct libusb_device ***listp);
+  int usb_enum_string_1_0(struct libusb_device_handle **hp, struct libusb_device *dev, int index,
+    char *buf, int len);
+  struct hid_device_info *usb_enum_hid(unsigned short vid, unsigned short pid);
+  void usb_enum_rescan(void);
+  void usb_enum_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See usb_hotplug.c
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int usb_hotplug_start(const PROGRAMMER *pgm);
+  int usb_hotplug_wait(int present, int timeout_ms);
+  int usb_hotplug_present(void);
+  void usb_hotplug_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See devcache.c
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int devcache_open(const PROGRAMMER *pgm, const AVRPART *p);
+  const unsigned char *devcache_page(const AVRMEM *mem, int addr);
+  void devcache_update(const AVRMEM *mem, int addr, int n, const unsigned char *data);
+  void devcache_forget(const AVRMEM *mem, int addr, int n);
+  void devcache_erased(void);
+  int devcache_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See tgtcache.c
+#define TGTCACHE_NBAUDS 12      // Room needed for the bauds of tgtcache_bauds()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void tgtcache_target(const PROGRAMMER *pgm, const AVRPART *p, const char *port);
+  const char *tgtcache_get(const char *field);
+  void tgtcache_put(const char *field, const char *value);
+  int tgtcache_bauds(long max, long *bauds);
+  int tgtcache_save(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See costmodel.c
+typedef enum {
+  COST_READ,                    // Paged reads
+  COST_WRITE,                   // Paged writes, including combined erase-writes
+  COST_ERASE,                   // Page erases
+  COST_CRC,                     // Range checks on the device, see pgm->verify_range()
+  COST_N
+} Cost_kind;
+
+#define COST_NCLASS 3           // Memory classes: flash, EEPROM and all others
+
+typedef struct {                // Accumulated measurements of one kind of access
+  double us, bytes, ops;
+} Cost_stat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void costmodel_open(void);
+  void costmodel_note(Cost_kind kind, const AVRMEM *mem, long nbytes, uint64_t us);
+  void costmodel_compared(const AVRMEM *mem, int changed);
+  double costmodel_us(Cost_kind kind, const AVRMEM *mem, long nbytes);
+  double costmodel_changed(const AVRMEM *mem);
+  void costmodel_close(void);
+
+#ifdef __cplusplus
+}
+#endif
 
 // See avrcache.c
 typedef struct {                // Memory cache for a subset of cached pages
   int size, page_size;          // Size of cache (flash or eeprom size) and page size
   unsigned int offset;          // Offset of flash/eeprom memory
-  unsigned char *cont, *copy;   // Current memory contens and device copy of it
-  unsigned char *iscached;      // iscached[i] set when page i has been loaded
+  unsigned char **pages;        // Page table: contents of page i followed by its device copy
+  unsigned char *iscached;      // iscached[i] set when page i has been loaded (blank if pages[i] is NULL)
+  unsigned char *isdirty;       // isdirty[i] set when page i might differ from device
+  unsigned int *lastuse;        // Time stamp of the last use of page i
+  unsigned int clock, epoch;    // Time stamp counter and its value when the current operation started
+  int nresident;                // Number of allocated pages
+  int nextpg, ahead;            // Next page of sequential reads and read-ahead in pages
 } AVR_Cache;
 
 // Formerly pgm.h
@@ -981,6 +1213,10 @@ typedef struct {
   unsigned long ms[LED_N];      // Time in ms after last physical change
 } Leds;
 
+typedef struct {                // Range [addr, addr+n) of a memory for scatter-gather paged access
+  unsigned int addr, n;
+} Avr_range;
+
 /*
  * Any changes in PROGRAMMER, please also ensure changes are made in
  *  - lexer.l
@@ -1020,6 +1256,11 @@ typedef struct programmer {
   int ppictrl;
   int ispdelay;                 // ISP clock delay
   int page_size;                // Page size if the programmer supports paged write/load
+  int multipage_write;          // Set by initpgm() if paged_write() can stream consecutive pages
+  int multipage_load;           // Set by initpgm() if paged_load() can stream consecutive pages
+  int max_load;                 // Set by initpgm() to the longest efficient such paged_load(); 0: 4096 bytes
+  int range_load;               // Set by initpgm() if paged_load() reads unpaged memories in one go
+  int range_write;              // Set by initpgm() if paged_write() writes unpaged memories in one go
   double bitclock;              // JTAG ICE clock period in microseconds
   Leds *leds;                   // State of LEDs as tracked by led_...()  functions in leds.c
 
@@ -1039,6 +1280,8 @@ typedef struct programmer {
   int (*cmd)(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res);
   int (*cmd_tpi)(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len,
     unsigned char *res, int res_len);
+  int (*cmd_tpi_batch)(const PROGRAMMER *pgm, const unsigned char *cmd, int cmd_len,
+    unsigned char *res, int res_len, int n);
   int (*spi)(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count);
   int (*open)(PROGRAMMER *pgm, const char *port);
   void (*close)(PROGRAMMER *pgm);
@@ -1047,6 +1290,22 @@ typedef struct programmer {
   int (*paged_load)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
     unsigned int pg_size, unsigned int addr, unsigned int n);
   int (*page_erase)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, unsigned int addr);
+  // Load or write a list of nr page ranges in as few transactions as possible; returns bytes or < 0
+  int (*paged_load_multi)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int pg_size, const Avr_range *r, int nr);
+  int (*paged_write_multi)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int pg_size, const Avr_range *r, int nr);
+  // Erase and write pages with one NVM command each; returns -2 if m needs page_erase() + paged_write()
+  int (*paged_erase_write)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int pg_size, unsigned int addr, unsigned int n);
+  // Re-establish the link after a failed paged transfer so the page can be retried
+  int (*resync)(const PROGRAMMER *pgm);
+  // Is device memory in [addr, addr+n) the same as data? 1: yes, 0: no, < 0: cannot tell
+  int (*verify_range)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int addr, unsigned int n, const unsigned char *data);
+  // Read [addr, addr+n) of a volatile memory such as sram or io in blocks; returns -2 if m is not supported
+  int (*read_block)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int addr, unsigned int n, unsigned char *buf);
   void (*write_setup)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m);
   int (*write_byte)(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
     unsigned long addr, unsigned char value);
@@ -1144,6 +1403,19 @@ extern "C" {
 
 typedef void (*FP_UpdateProgress)(int percent, double etime, const char *hdr, int finish);
 
+typedef struct {                // Timing span of a phase, see avr_span_begin()
+  const char *phase;            // Name of phase, eg, "open" or "write"
+  char *memory;                 // Memory the phase is for (or NULL)
+  int depth;                    // Nesting level
+  int detail;                   // Opened by avr_span_detail()
+  long nbytes;                  // Bytes moved (-1 if not applicable)
+  uint64_t start, duration;     // In us since program start
+} Avr_span;
+
+typedef struct {                // Per-thread options of avrdude.h, see avr_opts_save()
+  int verbose, quell_progress, ovsigck;
+} Avr_opts;
+
 extern struct avrpart parts[];
 extern Memtable avr_mem_order[100];
 
@@ -1155,6 +1427,9 @@ extern "C" {
 
   int avr_tpi_poll_nvmbsy(const PROGRAMMER *pgm);
   int avr_tpi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p);
+  int avr_isp_has_rdybsy(const AVRPART *p);
+  int avr_isp_ready_wait(const PROGRAMMER *pgm, const AVRPART *p, int delay, const char *what);
+  int avr_isp_erase_wait(const PROGRAMMER *pgm, const AVRPART *p);
   int avr_tpi_program_enable(const PROGRAMMER *pgm, const AVRPART *p, unsigned char guard_time);
   int avr_sigrow_offset(const AVRPART *p, const AVRMEM *mem, int addr);
   int avr_flash_offset(const AVRPART *p, const AVRMEM *mem, int addr);
@@ -1166,8 +1441,32 @@ extern "C" {
 
   uint64_t avr_ustimestamp(void);
   uint64_t avr_mstimestamp(void);
+  uint64_t avr_mstimestamp_coarse(void);
   double avr_timestamp(void);
+  int avr_span_begin(const char *phase, const char *memory);
+  int avr_span_detail(const char *phase, const char *memory);
+  void avr_span_end(int span, long nbytes);
+  void avr_bulk_phase(int begin);
+  void avr_timing_json(FILE *f, const char *pgmid, const char *partid, int exitrc);
+  void avr_timing_trace_event(FILE *f);
+  int avr_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned int page_size, unsigned int baseaddr, unsigned int n_bytes);
+  int avr_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned int page_size, unsigned int baseaddr, unsigned int n_bytes);
+  int avr_paged_load_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned int page_size, const Avr_range *r, int nr);
+  int avr_paged_write_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned int page_size, const Avr_range *r, int nr);
+  int avr_ranges_coalesce(Avr_range *r, int nr, unsigned int maxlen);
+  int avr_spi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int page_size, unsigned int addr, unsigned int n_bytes);
+  int avr_spi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+    unsigned int page_size, unsigned int addr, unsigned int n_bytes);
+  void avr_usleep(unsigned long us);
   void init_cx(PROGRAMMER *pgm);
+  void free_cx(void);
+  void avr_opts_save(Avr_opts *o);
+  void avr_opts_load(const Avr_opts *o);
   int avr_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
     unsigned long addr, unsigned char data);
   int avr_read_byte_silent(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
@@ -1177,11 +1476,17 @@ extern "C" {
   int avr_write_byte_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
     unsigned long addr, unsigned char data);
   int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size, int auto_erase);
+  int avr_write_mem_diff(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size);
+  int avr_write_mem_verified(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size,
+    int auto_erase, int diff, int *verified);
   int avr_write(const PROGRAMMER *pgm, const AVRPART *p, const char *memstr, int size, int auto_erase);
   int avr_signature(const PROGRAMMER *pgm, const AVRPART *p);
   int avr_mem_bitmask(const AVRPART *p, const AVRMEM *mem, int addr);
   int avr_verify(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const char *m, int size);
   int avr_verify_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const AVRMEM *a, int size);
+
+  int avr_verify_ranges(const PROGRAMMER *pgm, const AVRPART *p, const AVRPART *v, const AVRMEM *a, int size);
+  int avr_blank_check(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size, int *firstp);
   int avr_get_cycle_count(const PROGRAMMER *pgm, const AVRPART *p, int *cycles);
   int avr_put_cycle_count(const PROGRAMMER *pgm, const AVRPART *p, int cycles);
 
@@ -1196,12 +1501,15 @@ extern "C" {
   int avr_mem_is_known(const char *str);
   int avr_mem_might_be_known(const char *str);
   int avr_mem_hiaddr(const AVRMEM *mem);
+  unsigned char *avr_page_map(const AVRMEM *mem, int pgsize, int size);
+  int avr_untag_blank(const AVRMEM *mem, AVRMEM *vmem);
 
   int avr_chip_erase(const PROGRAMMER *pgm, const AVRPART *p);
   int avr_unlock(const PROGRAMMER *pgm, const AVRPART *p);
   void report_progress(int completed, int total, const char *hdr);
   void trace_buffer(const char *funstr, const unsigned char *buf, size_t buflen);
   int avr_has_paged_access(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m);
+  int avr_load_maxrun(const PROGRAMMER *pgm, const AVRMEM *mem);
   int avr_read_page_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
     int addr, unsigned char *buf);
   int avr_write_page_default(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
@@ -1213,11 +1521,16 @@ extern "C" {
     unsigned long addr, unsigned char *value);
   int avr_write_byte_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
     unsigned long addr, unsigned char data);
+  int avr_read_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned long addr, int len, unsigned char *buf);
+  int avr_write_range_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+    unsigned long addr, int len, const unsigned char *buf);
   int avr_chip_erase_cached(const PROGRAMMER *pgm, const AVRPART *p);
   int avr_page_erase_cached(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
     unsigned int addr);
   int avr_flush_cache(const PROGRAMMER *pgm, const AVRPART *p);
   int avr_reset_cache(const PROGRAMMER *pgm, const AVRPART *p);
+  void avr_cache_limit(long bytes);
 
 #ifdef __cplusplus
 }
@@ -1239,6 +1552,7 @@ typedef enum {
   FMT_BIN,
   FMT_ELF,
   FMT_IHXC,
+  FMT_PIMG,
 } FILEFMT;
 
 struct fioparms {
@@ -1254,6 +1568,23 @@ typedef struct {
   int addr, len;
 } Segment;
 
+typedef struct {                // Parsed input file image kept for reuse within the process
+  char *fname, *pdesc, *mdesc;  // Key: file name, part and memory descriptions,
+  int format, op;               // ... file format, read operation,
+  long long fsize, mtime;       // ... and file size and modification time
+  int rc, len;                  // Return value of fileio_mem() and length of buf/tags
+  unsigned char *buf, *tags;
+} Fio_image;
+
+typedef struct fio_stream Fio_stream; // See fileio_stream_open()
+
+typedef struct {                // Data block of an ELF section in a PT_LOAD segment, see elf_index()
+  unsigned lma, secsize;        // Load memory address and size of the section
+  unsigned d_off, d_size;       // Offset of the block within the section and its size
+  const unsigned char *data;    // Block contents as provided by libelf
+  const char *sname;            // Section name
+} Fio_elfblock;
+
 enum {
   FIO_READ,
   FIO_WRITE,
@@ -1276,10 +1607,19 @@ extern "C" {
   int fileio_fmt_autodetect_fp(FILE *f);
   int fileio_fmt_autodetect(const char *fname);
   int fileio_mem(int oprwv, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem, int size);
+  int fileio_mem_cached(int oprwv, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem);
+  int fileio_mem_iscached(int oprwv, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+    long long fsize, long long mtime);
+  void fileio_mem_adopt(int oprwv, const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem,
+    long long fsize, long long mtime, int rc);
+  void fileio_free_cache(void);
   int fileio(int oprwv, const char *filename, FILEFMT format, const AVRPART *p, const char *memstr, int size);
   int segment_normalise(const AVRMEM *mem, Segment *segp);
   int fileio_segments(int oprwv, const char *filename, FILEFMT format,
     const AVRPART *p, const AVRMEM *mem, int n, const Segment *seglist);
+  Fio_stream *fileio_stream_open(const char *filename, FILEFMT format, const AVRPART *p, const AVRMEM *mem);
+  int fileio_stream_write(Fio_stream *fs, int upto);
+  int fileio_stream_close(Fio_stream *fs, int size);
 
 #ifdef __cplusplus
 }
@@ -1299,6 +1639,15 @@ enum updateflags {
   UF_AUTO_ERASE = 2,
   UF_VERIFY = 4,
   UF_NOHEADING = 8,
+  UF_DIFFERENTIAL = 16,
+  UF_DIFF_EEPROM = 32,          // Differential write for EEPROM only
+  UF_INLINE_VERIFY = 64,        // Verify paged writes page by page right after writing
+};
+
+enum {                          // Verify policies, see update_set_verify_policy()
+  UPD_VFY_CRC,                  // Let programmers confirm ranges on the device, read back the rest
+  UPD_VFY_FULL,                 // Read back all bytes
+  UPD_VFY_SAMPLE,               // As UPD_VFY_CRC but also read back vector and random pages
 };
 
 typedef struct update {
@@ -1307,6 +1656,7 @@ typedef struct update {
   int op;                       // Symbolic memory operation DEVICE_... for -U
   char *filename;               // Filename for -U, can be -
   int format;                   // File format FMT_...
+  char *patch;                  // Overlay applied to the input of a single memory write/verify, or NULL
 } UPDATE;
 
 typedef struct {                // File reads for flash can exclude trailing 0xff, which are cut off
@@ -1319,6 +1669,8 @@ typedef struct {                // File reads for flash can exclude trailing 0xf
    lastaddr;                    // Highest address set by input file
 } Filestats;
 
+typedef struct update_prefetch Update_prefetch; // See update_prefetch()
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -1331,6 +1683,11 @@ extern "C" {
   char *update_str(const UPDATE *upd);
   int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd,
     enum updateflags flags);
+  int update_is_fuse_write(const AVRPART *p, const UPDATE *upd);
+  int do_fuse_group(const PROGRAMMER *pgm, const AVRPART *p, UPDATE *const *upds, int n,
+    enum updateflags flags);
+  int update_set_verify_policy(const char *spec);
+  const char *update_verify_policy(void);
   int memstats(const AVRPART *p, const char *memstr, int size, Filestats *fsp);
   int memstats_mem(const AVRPART *p, const AVRMEM *mem, int size, Filestats *fsp);
 
@@ -1340,6 +1697,9 @@ extern "C" {
   int update_is_readable(const char *fn);
 
   int update_dryrun(const AVRPART *p, UPDATE *upd);
+  int update_preload(const AVRPART *p, const UPDATE *upd);
+  Update_prefetch *update_prefetch(const AVRPART *p, const UPDATE *upd);
+  int update_prefetch_finish(Update_prefetch *pf);
 
   AVRMEM **memory_list(const char *mstr, const PROGRAMMER *pgm, const AVRPART *p,
     int *np, int *rwvsoftp, int *dry);
@@ -1349,6 +1709,84 @@ extern "C" {
 }
 #endif
 
+// See avrasync.c
+typedef struct avr_session Avr_session;
+typedef struct avr_async_op Avr_async_op;
+typedef int (*Avr_async_fn)(PROGRAMMER *pgm, const AVRPART *p, void *arg);
+typedef void (*Avr_async_cb)(Avr_async_op *op, int rc, void *ud);
+
+enum {                          // States of asynchronous operations
+  AVR_ASYNC_PENDING,            // Waiting in the session queue
+  AVR_ASYNC_RUNNING,
+  AVR_ASYNC_DONE,
+  AVR_ASYNC_CANCELLED,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  Avr_session *avr_session_new(PROGRAMMER *pgm, const AVRPART *p);
+  void avr_session_free(Avr_session *s);
+  int avr_session_fd(const Avr_session *s);
+  Avr_async_op *avr_async_call(Avr_session *s, Avr_async_fn fn, void *arg, Avr_async_cb cb, void *ud);
+  Avr_async_op *avr_async_read_mem(Avr_session *s, const AVRMEM *mem, const AVRPART *v,
+    Avr_async_cb cb, void *ud);
+  Avr_async_op *avr_async_write_mem(Avr_session *s, const AVRMEM *mem, int size, int auto_erase,
+    Avr_async_cb cb, void *ud);
+  Avr_async_op *avr_async_verify_mem(Avr_session *s, const AVRPART *v, const AVRMEM *mem, int size,
+    Avr_async_cb cb, void *ud);
+  Avr_async_op *avr_async_do_op(Avr_session *s, const UPDATE *upd, enum updateflags flags,
+    Avr_async_cb cb, void *ud);
+  int avr_async_poll(Avr_session *s);
+  int avr_async_state(const Avr_async_op *op);
+  int avr_async_result(const Avr_async_op *op);
+  int avr_async_progress(const Avr_async_op *op);
+  int avr_async_wait(Avr_async_op *op);
+  int avr_async_cancel(Avr_async_op *op);
+  int avr_async_free(Avr_async_op *op);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See avrsched.c
+typedef struct avr_sched Avr_sched;
+typedef int (*Avr_unit_fn)(PROGRAMMER *pgm, const AVRPART *p, int unit, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  Avr_sched *avr_sched_new(Avr_unit_fn fn, void *arg);
+  void avr_sched_free(Avr_sched *sc);
+  int avr_sched_add_worker(Avr_sched *sc, Avr_session *s);
+  void avr_sched_add_units(Avr_sched *sc, int first, int n);
+  int avr_sched_poll(Avr_sched *sc);
+  int avr_sched_run(Avr_sched *sc);
+  int avr_sched_stats(const Avr_sched *sc, int wno, int *nok, int *nfail, double *busy);
+
+#ifdef __cplusplus
+}
+#endif
+
+// See avrreactor.c
+typedef struct avr_reactor Avr_reactor;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  Avr_reactor *avr_reactor_new(void);
+  void avr_reactor_free(Avr_reactor *r);
+  int avr_reactor_add(Avr_reactor *r, PROGRAMMER *pgm, const AVRPART *p, Avr_async_fn fn, void *arg);
+  int avr_reactor_run(Avr_reactor *r);
+  int avr_reactor_result(const Avr_reactor *r, int jno);
+
+#ifdef __cplusplus
+}
+#endif
+
 // Formerly pgm_type.h
 
 typedef struct programmer_type {
@@ -1387,6 +1825,9 @@ extern int allow_subshells;
 // This name is fixed, it's only here for symmetry with default_parallel and default_serial
 #define DEFAULT_USB       "usb"
 
+// Configuration file name of the database compiled in with the BUILTIN_CONFIG build option
+#define CFG_BUILTIN       "<built-in avrdude.conf>"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -1394,10 +1835,15 @@ extern "C" {
   void *cfg_malloc(const char *funcname, size_t n);
   void *cfg_realloc(const char *funcname, void *p, size_t n);
   char *cfg_strdup(const char *funcname, const char *s);
+  void cfg_free(void *p);
   void mmt_f_free(void *ptr);
   int init_config(void);
   void cleanup_config(void);
+  void avr_db_lock(void);
+  void avr_db_unlock(void);
   int read_config(const char *file);
+  int read_config_lazy(const char *file, LISTID names);
+  int read_config_builtin(LISTID names);
   const char *cache_string(const char *file);
   size_t cfg_unescapen(unsigned char *d, const unsigned char *s);
   unsigned char *cfg_unescapeu(unsigned char *d, const unsigned char *s);
@@ -1802,6 +2248,56 @@ extern "C" {
 }
 #endif
 
+/*
+ * Shared part database
+ *
+ * The parsed configuration is the same for all sessions of a process and
+ * read-only once avrdude.conf has been read: the part and programmer lists,
+ * the strings interned by cache_string(), the comments kept for developer
+ * options output and the lookup indices built over them. All sessions share
+ * the single copy below, so that the per-thread context cx only holds
+ * session state, I/O buffers and a closed-circuit space that is allocated
+ * on first use. Parts from part_list must not be modified by a session:
+ * initialise memory buffers on a copy from avr_dup_part() instead. Indices
+ * and the intern table are still built lazily; avr_db_lock() and
+ * avr_db_unlock() serialise that where threads are available.
+ */
+
+typedef struct {
+  // From config.c
+  struct cfg_istr *cfg_istrs;   // Intern table for cache_string()
+  size_t cfg_nistrs, cfg_istrsize; // Number of interned strings and table size
+  LISTID cfg_comms;             // A chain of comment lines
+  LISTID cfg_prologue;          // Comment lines at start of avrdude.conf
+  char *cfg_lkw;                // Last seen keyword
+  int cfg_lkw_lineno;           // Line number of that
+  LISTID cfg_strctcomms;        // Passed on to config_gram.y
+  LISTID cfg_pushedcomms;       // Temporarily pushed main comments
+  int cfg_pushed;               // ... for memory sections
+  int cfg_init_search;          // Used in cfg_comp_search()
+  void *cfg_arena;              // Chain of arena blocks for config objects, newest first
+  char *cfg_arena_ptr;          // Next free byte in newest arena block
+  size_t cfg_arena_left;        // Bytes left in newest arena block
+
+  // From avrpart.c
+  LISTID avr_pidx_list;         // Part list that the index below was built for
+  unsigned long avr_pidx_gen;   // Generation of that list at the time
+  LNODEID avr_pidx_last;        // Last list node in the index
+  LHASHID avr_pidx_names;       // Part by id, desc and variant names
+  LHASHID avr_pidx_sigs;        // List of parts by signature
+
+  // From pgm.c
+  LISTID pgm_idx_list;          // Programmer list that the index below was built for
+  unsigned long pgm_idx_gen;    // Generation of that list at the time
+  LNODEID pgm_idx_last;         // Last list node in the index
+  LHASHID pgm_idx_ids;          // Programmer by id
+
+  // From avrintel.c
+  int *upi_mcuid, *upi_sig, *upi_name; // uP_table[] indices sorted by mcuid, signature and name
+} Avr_db;
+
+extern Avr_db avr_db;
+
 /*
  * Context structure
  *
@@ -1810,41 +2306,79 @@ extern "C" {
  * pointer libavrdude_context *cx; applications using libavrdude ought to
  * allocate cx = mmt_malloc(sizeof *cx) for each instantiation (and set initial
  * values if needed) and deallocate with mmt_free(cx).
+ *
+ * The pointer cx is thread local, so an application can run several
+ * independent programming sessions concurrently, one per thread, each with
+ * its own PROGRAMMER; every such thread needs to call init_cx() first and
+ * free_cx() when done. The few variables of the library that are not in cx
+ * are thread local, too: the options verbose, quell_progress and ovsigck of
+ * avrdude.h, which the application defines with LIBAVRDUDE_THREAD_LOCAL, as
+ * well as serdev, serial_recv_timeout and serial_drain_timeout. A new thread
+ * starts with all options 0; it should adopt those of its creator through
+ * avr_opts_save() and avr_opts_load(), as the session workers of avrasync.c
+ * do. Lazily computed tables and list generations are shared but guarded.
+ * What remains process wide is the parsed configuration (see Avr_db above),
+ * which should be read once before spawning the threads, and the callbacks
+ * update_progress and avrdude_message2(), which need to be thread safe.
  */
 
 typedef struct {
-  // Closed-circuit space for returning strings in a persistent buffer
+  // Closed-circuit space for returning strings in a persistent buffer, one per thread
+#define AVR_CC_SPACE 32768
 #define AVR_SAFETY_MARGIN 1024
-  char *avr_s, avr_space[32768 + AVR_SAFETY_MARGIN];
+  char *avr_s, *avr_space;      // avr_s points to next free byte; space allocated on first use
 
   // Static variables from avr.c
   int avr_disableffopt;         // Disables trailing 0xff flash optimisation
   uint64_t avr_epoch;           // Epoch for avr_ustimestamp()
   int avr_epoch_init;           // Whether above epoch is initialised
+  uint64_t avr_tickfreq;        // Performance counter frequency on Windows, 1 if there is none
   int avr_last_percent;         // Last valid percentage for report_progress()
   double avr_start_time;        // Start time in s of report_progress() activity
+  int avr_prog_total;           // Total of the last report_progress() call
+  int avr_prog_next;            // Completed count at which the percentage next changes
+  volatile int *avr_prog_slot;  // Shared gang progress slot: phase*128 + percent
+  int avr_prog_phase;           // Number of progress headers seen by this gang worker
+  int avr_timing;               // Record timing spans for --timing
+  Avr_span *avr_spans;          // Recorded timing spans
+  int avr_nspans, avr_spandepth;        // Number of spans and of currently open spans
+  void (*avr_bulk_hook)(int begin);     // Application throttle for bulk phases, see avr_bulk_phase()
+  int avr_bulkdepth;            // Nesting level of bulk phases
+  void (*avr_read_hook)(const AVRMEM *mem, int upto);   // Application sees reads progress, see avr_read_mem()
+  const AVRMEM *avr_wd_mem;     // Memory whose write completion times are tracked below
+  int avr_wd_max;               // Longest observed write completion time in us
+  int avr_wd_n;                 // Number of observed write completions
+  int avr_flash_erased;         // Flash known to be blank after avr_chip_erase()
+  unsigned char *avr_blank_map; // Pages the last flash write skipped as blank, see avr_untag_blank()
+  const char *avr_blank_desc;   // Memory of that write
+  int avr_blank_pgsize, avr_blank_npages;       // Its page size and number of pages
+
+  // Static variables from avr_opcodes.c
+#define OPC_NTABS 4
+  int opc_levels[OPC_NTABS];    // Architecture levels of the decode tables below
+  int opc_calls[OPC_NTABS];     // Number of lookups; tables are only built after a few
+  int16_t *opc_tabs[OPC_NTABS]; // AVR_mnemo of all 65536 16-bit opcodes for that level
 
   // Static variables from bitbang.c
   int bb_delay_decrement;
+  int bb_realtime;              // Real-time mode requested with --realtime
+  int bb_rt_active;             // Real-time mode is on, see bitbang_realtime_begin()
+  int bb_rt_policy, bb_rt_prio; // Previous scheduling policy (-1 if unchanged) and priority
+  void *bb_rt_cpus;             // Previous CPU affinity mask (or NULL)
+  int bb_rt_locked;             // Memory is locked
+  int bb_trim_ns;               // Amount by which bitbang_delay() shortens delays
 
 #if defined(WIN32)
   int bb_has_perfcount;
   uint64_t bb_freq;             // Should be LARGE_INTEGER but what to include?
 #else
+  int bb_has_monoclock;         // Delays busy-wait on a monotonic clock
   int bb_done;                  // Handshake variable in alarm handler
   void (*bb_saved_alarmf)(int); // Saved alarm handler
 #endif
 
-  // Static variables from config.c
-  char **cfg_hstrings[1 << 12]; // Hash lists for cache_string()
-  LISTID cfg_comms;             // A chain of comment lines
-  LISTID cfg_prologue;          // Comment lines at start of avrdude.conf
-  char *cfg_lkw;                // Last seen keyword
-  int cfg_lkw_lineno;           // Line number of that
-  LISTID cfg_strctcomms;        // Passed on to config_gram.y
-  LISTID cfg_pushedcomms;       // Temporarily pushed main comments
-  int cfg_pushed;               // ... for memory sections
-  int cfg_init_search;          // Used in cfg_comp_search()
+  // Static variable from config.c
+  int cfg_arena_on;             // Allocate from the arena while this thread reads config files
 
   // Static variable from dfu.c
   uint16_t dfu_wIndex;          // A running number for USB messages
@@ -1867,7 +2401,20 @@ typedef struct {
 #else
   struct termios ser_original_termios;
   int ser_saved_original_termios;
+  unsigned char ser_rxbuf[4096]; // Bytes read ahead by ser_recv()
+  int ser_rxlen;                // Amount of valid bytes in rx buffer
+  int ser_rxpos;                // Amount of bytes already consumed in rx buffer
+  int ser_rxfd;                 // File descriptor the rx buffer was filled from
+  int ser_isnet;                // Is ser_netfd the open connection of a net: port?
+  int ser_netfd;
+  unsigned char ser_txbuf[1024]; // Sends to the net: port coalesced by ser_send()
+  int ser_txlen;
 #endif
+  // Wait for fd to become readable (out = 0) or writable instead of poll(); returns 1, 0 on timeout or -1
+  int (*ser_wait_hook)(int fd, int out, int timeout_ms);
+
+  // Static variables from avrreactor.c
+  void *rct_job;                // Reactor job running in this context
 
   // Static variables from term.c
   int term_spi_mode;
@@ -1882,13 +2429,35 @@ typedef struct {
   char *term_header;
   int term_tty_last, term_tty_todo;
   int term_notty_last, term_notty_todo;
+  int term_batch;               // Stage writes of scripts in the buffers below
+  const AVRMEM *term_bmem;      // Memory of staged writes (NULL if none)
+  unsigned char *term_bbuf, *term_btags; // Staged data and which bytes are staged
+  int term_blo, term_bhi;       // Range of staged addresses
+  void *term_fusel;             // Snapshot of fuses and lock bits for config within a session
+  const AVRPART *term_fusel_part;
 
   // Static variables from update.c
   const char **upd_wrote, **upd_termcmds;
   int upd_nfwritten, upd_nterms;
-
-  // Static variable from fileio.c
+  int upd_msghold;              // Prefetch thread: count messages in upd_nheld rather than printing them
+  int upd_nheld;
+  void *upd_stream;             // Output stage of a streamed -U memory:r, see update_stream_open()
+  int upd_vfy_policy;           // Verify policy UPD_VFY_CRC (default), UPD_VFY_FULL or UPD_VFY_SAMPLE
+  int upd_vfy_samples;          // Number of random pages read back under UPD_VFY_SAMPLE
+  uint32_t upd_vfy_rng;         // State of the random number generator for choosing these pages
+
+  // Static variables from fileio.c
   int reccount;
+  Fio_image *fio_images;
+  int fio_nimages;
+  void *fio_elf;                // Elf handle of the last ELF file indexed
+  char *fio_elfname;            // Its name (NULL unless a regular file) and when it was indexed
+  long long fio_elfsize, fio_elfmtime;
+  int fio_elfclass, fio_elfdata, fio_elftype, fio_elfmachine;   // Header fields
+  Fio_elfblock *fio_elfblocks;  // Data blocks sorted by LMA
+  int fio_nelfblocks;
+  unsigned long fio_pimgcrc;    // CRC-32 of the page image written so far
+  int fio_pimgrecs;             // Number of its page records
 
   // Static variables from disasm.c
   int dis_initopts, dis_flashsz, dis_flashsz2, dis_addrwidth, dis_sramwidth;
@@ -1896,9 +2465,64 @@ typedef struct {
   Dis_options dis_opts;
   int dis_jumpcallN, dis_labelN, dis_symbolN, *dis_jcaddr, dis_start, dis_end;
   Dis_jumpcall *dis_jumpcalls;
+  int dis_jumpcallS;            // Number of leading jumpcalls that are sorted
+  unsigned char *dis_xref;      // Bitmap of buffer addresses that jumpcalls go to
   Dis_label *dis_labels;
   Dis_symbol *dis_symbols;
 
+  // Static variables from sertrace.c
+  Sertrace_rec *strc_rec;       // Ring of the last recorded transactions
+  unsigned char *strc_data;     // Ring of their payload bytes
+  uint64_t strc_nrec, strc_ndata;       // Number of transactions and payload bytes recorded so far
+#define SERSTAT_NDEV 4
+  Serial_stats strc_stats[SERSTAT_NDEV];        // Per transport statistics
+  int strc_nstats;
+  FILE *strc_recfile;           // Recording of the session with full payloads
+  int strc_replay;              // Replaying a recorded session?
+  Sertrace_rec *strc_rprec;     // Recorded transactions to be replayed
+  unsigned char *strc_rpdata;   // Their payload bytes
+  size_t strc_rpn, strc_rpi;    // Number of recorded and of replayed transactions
+
+  // Static variables from usb_hotplug.c
+#define USB_HOTPLUG_MAXDEVS 32
+  void *uhp_ctx;                // The libusb_context of the hotplug registry
+  int uhp_handle;               // Its libusb_hotplug_callback_handle
+  LISTID uhp_pids;              // USB PIDs of the programmer, any if empty
+  struct { int bus, addr, pid; } uhp_devs[USB_HOTPLUG_MAXDEVS]; // Connected matching devices
+  int uhp_ndevs;
+
+  // Static variables from usb_enum.c
+  void *uen_ctx;                // Shared libusb_context of libusb-1.0
+  void *uen_list;               // Its cached libusb_device list
+  int uen_nlist;
+  int uen_scanned;              // Have the libusb-0.1 buses been scanned?
+  struct usb_enum_str *uen_strs; // Cached string descriptors
+  int uen_nstrs;
+  struct usb_enum_hid *uen_hids; // Cached hid_enumerate() results
+  int uen_nhids;
+
+  // Static variables from avrcache.c
+  size_t avc_limit;             // Memory limit for the pages of each cache, 0 if none
+
+  // Static variables from devcache.c
+  char *dvc_key;                // Device signature and serial number
+  unsigned char *dvc_image;     // Flash contents as far as known, NULL if not caching
+  unsigned char *dvc_known;     // Bitmap of known pages
+  int dvc_size, dvc_pgsize;     // Flash size and page size
+  unsigned int dvc_offset;      // Flash offset
+
+  // Static variables from costmodel.c
+  Cost_stat cst_stats[COST_N][COST_NCLASS]; // Measurements of this and earlier sessions
+  double cst_compared[COST_NCLASS];     // Pages read by differential writes ...
+  double cst_changed[COST_NCLASS];      // ... and how many of these differed
+  int cst_open;                 // Measurements of earlier sessions have been added
+
+  // Static variables from tgtcache.c
+  char **tgt_lines;             // Cache entries <target> <field> <value>, most recent last
+  int tgt_nlines;
+  char *tgt_id;                 // Current target
+  int tgt_loaded, tgt_enabled, tgt_dirty;
+
   // Static variables from usb_libusb.c
 #define USBDEV_MAX_XFER_3         912 // Trust compiler complains if usbdevs.h redefines this
   char usb_buf[USBDEV_MAX_XFER_3];
@@ -1912,7 +2536,7 @@ typedef struct {
   int usb_access_error;
 } libavrdude_context;
 
-extern libavrdude_context *cx;
+extern LIBAVRDUDE_THREAD_LOCAL libavrdude_context *cx;
 
 // Formerly confwin.h
 
@@ -40,12 +40,12 @@ The following global variables are available in `ad.cvar`:
 // global variables referenced by library
 char * version  = AVRDUDE_FULL_VERSION;
 char * progname = "avrdude";
-int verbose;
-int quell_progress;
-int ovsigck;
+LIBAVRDUDE_THREAD_LOCAL int verbose;
+LIBAVRDUDE_THREAD_LOCAL int quell_progress;
+LIBAVRDUDE_THREAD_LOCAL int ovsigck;
 const char *partdesc = "";
 const char *pgmid = "";
-libavrdude_context *cx;
+LIBAVRDUDE_THREAD_LOCAL libavrdude_context *cx;
 
 static PyObject *msg_cb = NULL;
 static PyObject *progress_cb = NULL;
@@ -120,18 +120,20 @@ int avrdude_message2(FILE *fp, int lno, const char *file,
     va_end(ap);
 
     if (rc < 0) {
-      free(p);
+      cfg_free(p);
       return 0;
     }
 
     if (*p) {
       if (msg_cb) {
+        PyGILState_STATE gstate = PyGILState_Ensure(); // Might be a session worker thread
         PyObject *result =
           PyObject_CallFunction(msg_cb, "(sissiisO)",
                                 target, lno, file, func, msgmode, msglvl, p, backslash_v);
         Py_XDECREF(result);
+        PyGILState_Release(gstate);
       }
-      free(p);
+      cfg_free(p);
     }
 
     return rc;
@@ -140,9 +142,11 @@ int avrdude_message2(FILE *fp, int lno, const char *file,
 static void swig_progress(int percent, double etime, const char *hdr, int finish)
 {
   if (progress_cb) {
+    PyGILState_STATE gstate = PyGILState_Ensure();
     PyObject *result =
       PyObject_CallFunction(progress_cb, "(idsi)", percent, etime, hdr, finish);
     Py_XDECREF(result);
+    PyGILState_Release(gstate);
   }
 }
 
@@ -235,6 +239,17 @@ PyObject *get_config_table(const char *name) {
 
 %}
 
+// Long-running calls release the GIL so that Python threads can drive several programmers
+// in parallel; each such thread should call init_cx() first. Callbacks of messages and
+// progress reports re-acquire the GIL, see avrdude_message2() and swig_progress().
+%define RELEASE_GIL(function)
+%exception function {
+  Py_BEGIN_ALLOW_THREADS
+  $action
+  Py_END_ALLOW_THREADS
+}
+%enddef
+
 // globals from above are mapped to Python
 %immutable;
 char * version;
@@ -352,15 +367,37 @@ typedef struct avrmem_alias {
   }
 }
 
+%extend avrmem {
+%feature("autodoc", "m.view() => memoryview; Writable view of the whole memory buffer without copying") view;
+  PyObject *view() {
+    if ($self->buf == NULL)
+      // missing avr_initmem()?
+      return Py_None;
+    return PyMemoryView_FromMemory((char *) $self->buf, $self->size, PyBUF_WRITE);
+  }
+%feature("autodoc", "m.tagview() => memoryview; Writable view of the ALLOCATED tag bitmap, one bit per byte") tagview;
+  PyObject *tagview() {
+    if ($self->tags == NULL)
+      return Py_None;
+    return PyMemoryView_FromMemory((char *) $self->tags, tag_bytes($self->size), PyBUF_WRITE);
+  }
+}
+
 int avr_initmem(const AVRPART *p);
 
 %extend avrmem {
-  %typemap(in) (unsigned char *in, unsigned int len) {
-    Py_ssize_t len;
-    PyBytes_AsStringAndSize($input, (char **)&$1, &len);
-    $2 = len;
+  // Any object with the buffer protocol (bytes, bytearray, memoryview, ...) without a copy
+  %typemap(in) (unsigned char *in, unsigned int len) (Py_buffer view) {
+    if (PyObject_GetBuffer($input, &view, PyBUF_SIMPLE) < 0)
+      SWIG_fail;
+    $1 = (unsigned char *) view.buf;
+    $2 = (unsigned int) view.len;
+  }
+  %typemap(freearg) (unsigned char *in, unsigned int len) {
+    if ($1)
+      PyBuffer_Release(&view$argnum);
   }
-%feature("autodoc", "m.put(in: bytes, len: int, offset: int = 0) => return len; Copy to memory buffer, set ALLOCATED tag") put;
+%feature("autodoc", "m.put(in: bytes-like, len: int, offset: int = 0) => return len; Copy to memory buffer, set ALLOCATED tag") put;
   int put(unsigned char *in, unsigned int len, unsigned int offset = 0) {
     if ($self->buf == NULL)
       // missing avr_initmem()?
@@ -370,7 +407,7 @@ int avr_initmem(const AVRPART *p);
     if (offset + len > (unsigned)$self->size)
       len = $self->size - offset;
     memcpy($self->buf + offset, in, len);
-    memset($self->tags + offset, TAG_ALLOCATED, len);
+    tag_set_range($self->tags, offset, len);
     return len;
   }
 }
@@ -386,7 +423,7 @@ int avr_initmem(const AVRPART *p);
     if (offset + len > (unsigned)$self->size)
       len = $self->size - offset;
     memset($self->buf + offset, value, len);
-    memset($self->tags + offset, 0, len);
+    tag_clr_range($self->tags, offset, len);
     return len;
   }
 }
@@ -527,6 +564,10 @@ typedef enum {
   }
 }
 
+RELEASE_GIL(programmer::open)
+RELEASE_GIL(programmer::initialize)
+RELEASE_GIL(programmer::chip_erase)
+
 %immutable;
 typedef struct programmer {
   LISTID id;
@@ -658,6 +699,11 @@ PROGRAMMER *locate_programmer_set(const LISTID programmers, const char *id, cons
 PROGRAMMER *locate_programmer_starts_set(const LISTID programmers, const char *id, const char **setid, AVRPART *prt);
 PROGRAMMER *locate_programmer(const LISTID programmers, const char *configid);
 
+RELEASE_GIL(avr_read_mem)
+RELEASE_GIL(avr_write_mem)
+RELEASE_GIL(avr_write_byte)
+RELEASE_GIL(fileio)
+
 // Abuse the check typemaps to inject some code into the wrapper
 
 // avr_read_mem() and avr_write_mem() do not initialize progress
@@ -683,6 +729,43 @@ int avr_write_mem(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
 %feature("autodoc", "avr_write_byte(PROGRAMMER pgm, AVRPART p, AVRMEM mem, int addr, byte data) -> int") avr_write_byte;
 int avr_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
                    unsigned long addr, unsigned char data);
+// Asynchronous sessions, see avrasync.c; from Python pass None as callback and poll
+typedef struct avr_session Avr_session;
+typedef struct avr_async_op Avr_async_op;
+typedef void (*Avr_async_cb)(Avr_async_op *op, int rc, void *ud);
+
+enum {
+  AVR_ASYNC_PENDING,
+  AVR_ASYNC_RUNNING,
+  AVR_ASYNC_DONE,
+  AVR_ASYNC_CANCELLED,
+};
+
+// The session worker may need the GIL for messages while the caller waits for it
+RELEASE_GIL(avr_session_free)
+RELEASE_GIL(avr_async_wait)
+
+%feature("autodoc", "avr_session_new(PROGRAMMER pgm, AVRPART p) -> Avr_session") avr_session_new;
+Avr_session *avr_session_new(PROGRAMMER *pgm, const AVRPART *p);
+void avr_session_free(Avr_session *s);
+%feature("autodoc", "avr_session_fd(Avr_session s) -> int; readable when an operation has completed") avr_session_fd;
+int avr_session_fd(const Avr_session *s);
+Avr_async_op *avr_async_read_mem(Avr_session *s, const AVRMEM *mem, const AVRPART *v = NULL,
+  Avr_async_cb cb = NULL, void *ud = NULL);
+Avr_async_op *avr_async_write_mem(Avr_session *s, const AVRMEM *mem, int size, int auto_erase = false,
+  Avr_async_cb cb = NULL, void *ud = NULL);
+Avr_async_op *avr_async_verify_mem(Avr_session *s, const AVRPART *v, const AVRMEM *mem, int size,
+  Avr_async_cb cb = NULL, void *ud = NULL);
+%feature("autodoc", "avr_async_poll(Avr_session s) -> int; number of operations waiting or running") avr_async_poll;
+int avr_async_poll(Avr_session *s);
+int avr_async_state(const Avr_async_op *op);
+int avr_async_result(const Avr_async_op *op);
+%feature("autodoc", "avr_async_progress(Avr_async_op op) -> int; percent done, -1 if not started") avr_async_progress;
+int avr_async_progress(const Avr_async_op *op);
+int avr_async_wait(Avr_async_op *op);
+int avr_async_cancel(Avr_async_op *op);
+int avr_async_free(Avr_async_op *op);
+
 typedef enum {
   FMT_ERROR = -1,
   FMT_AUTO,
@@ -28,7 +28,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #ifdef HAVE_LIBGPIOD
 #include <gpiod.h>
@@ -54,6 +56,15 @@
 
 struct pdata {
   int sysfs_fds[N_GPIO];        // Open FDs of /sys/class/gpio/gpioXX/value for needed pins
+  volatile uint32_t *gpiomem;   // Mapped GPIO registers for -P gpiomem, NULL otherwise
+  struct {                      // SPI lines for -P gpiomem with banks and polarities resolved
+    int ok;                     // SCK, SDO and SDI are all GPIOs of the block
+    volatile uint32_t *sck_on, *sck_off;  // Registers that drive SCK to logic 1 and 0
+    volatile uint32_t *sdo_on, *sdo_off;
+    volatile uint32_t *sdi_lev; // Level register of SDI
+    uint32_t sck, sdo, sdi;     // Bit masks in these registers
+    int isdi;                   // SDI is inverted
+  } spi;
 };
 
 // Use private programmer data as if they were a global structure my
@@ -181,12 +192,10 @@ static int linuxgpio_sysfs_getpin(const PROGRAMMER *pgm, int pinfunc) {
   if(pin > PIN_MAX || my.sysfs_fds[pin] < 0)
     return -1;
 
-  if(lseek(my.sysfs_fds[pin], 0, SEEK_SET) < 0)
-    return -1;
-
   char c;
 
-  if(read(my.sysfs_fds[pin], &c, 1) != 1)
+  // A positioned read rewinds and reads the value attribute in one syscall
+  if(pread(my.sysfs_fds[pin], &c, 1, 0) != 1)
     return -1;
 
   return c == '0'? 0 + invert: c == '1'? 1 - invert: -1;
@@ -224,11 +233,295 @@ static void linuxgpio_powerup(const PROGRAMMER *pgm) {
 static void linuxgpio_powerdown(const PROGRAMMER *pgm) {
 }
 
+/*
+ * Direct register access backend for Raspberry Pi boards with a BCM283x or
+ * BCM2711 SoC: -P gpiomem maps the GPIO block via /dev/gpiomem and drives
+ * pins through the set/clear registers without any syscall per pin change
+ */
+
+#define GPIOMEM_DEV      "/dev/gpiomem"
+#define GPIOMEM_SIZE     4096
+#define GPIOMEM_NPINS    54     // GPIO lines of the BCM283x/BCM2711 GPIO block
+
+#define GPIOMEM_GPFSEL    0     // Word offsets of function select, set, clear and level registers
+#define GPIOMEM_GPSET     7
+#define GPIOMEM_GPCLR    10
+#define GPIOMEM_GPLEV    13
+
+static int linuxgpio_is_gpiomem(const char *port) {
+  return port && (str_eq(port, "gpiomem") || str_eq(port, GPIOMEM_DEV));
+}
+
+// Check the device tree for a SoC whose GPIO block follows the BCM2835 layout
+static int linuxgpio_gpiomem_soc_ok(void) {
+  char buf[256];
+  int fd = open("/proc/device-tree/compatible", O_RDONLY);
+
+  if(fd < 0)
+    return 0;
+  ssize_t n = read(fd, buf, sizeof buf - 1);
+
+  close(fd);
+  if(n <= 0)
+    return 0;
+  buf[n] = 0;
+
+  // List of NUL-separated compatible strings
+  for(char *s = buf; s < buf + n; s += strlen(s) + 1)
+    if(str_starts(s, "brcm,bcm283") || str_eq(s, "brcm,bcm2711"))
+      return 1;
+
+  return 0;
+}
+
+static void linuxgpio_gpiomem_dir(const PROGRAMMER *pgm, unsigned int pin, int out) {
+  volatile uint32_t *fsel = my.gpiomem + GPIOMEM_GPFSEL + pin/10;
+  unsigned int shift = 3*(pin%10);
+
+  *fsel = (*fsel & ~(7U << shift)) | ((out? 1U: 0U) << shift);
+}
+
+static int linuxgpio_gpiomem_setpin(const PROGRAMMER *pgm, int pinfunc, int value) {
+  if(pinfunc < 0 || pinfunc >= N_PINS)
+    return -1;
+
+  unsigned pin = pgm->pinno[pinfunc];
+
+  if(pin & PIN_INVERSE)
+    value = !value;
+  pin &= PIN_MASK;
+
+  if(pin >= GPIOMEM_NPINS)
+    return -1;
+
+  my.gpiomem[(value? GPIOMEM_GPSET: GPIOMEM_GPCLR) + pin/32] = 1U << (pin%32);
+  // Reading back a register waits for the write to reach the GPIO block and paces the clock
+  (void) my.gpiomem[GPIOMEM_GPLEV + pin/32];
+
+  if(pgm->ispdelay > 1)
+    bitbang_delay(pgm->ispdelay);
+
+  return 0;
+}
+
+static int linuxgpio_gpiomem_getpin(const PROGRAMMER *pgm, int pinfunc) {
+  if(pinfunc < 0 || pinfunc >= N_PINS)
+    return -1;
+
+  unsigned int pin = pgm->pinno[pinfunc];
+  int invert = !!(pin & PIN_INVERSE);
+
+  pin &= PIN_MASK;
+
+  if(pin >= GPIOMEM_NPINS)
+    return -1;
+
+  return !!(my.gpiomem[GPIOMEM_GPLEV + pin/32] & (1U << (pin%32))) ^ invert;
+}
+
+static int linuxgpio_gpiomem_highpulsepin(const PROGRAMMER *pgm, int pinfunc) {
+  if(pinfunc < 0 || pinfunc >= N_PINS)
+    return -1;
+
+  if((pgm->pinno[pinfunc] & PIN_MASK) >= GPIOMEM_NPINS)
+    return -1;
+
+  linuxgpio_gpiomem_setpin(pgm, pinfunc, 1);
+  linuxgpio_gpiomem_setpin(pgm, pinfunc, 0);
+
+  return 0;
+}
+
+// Resolve the SPI lines once so that the per-bit loop below only writes and reads registers
+static void linuxgpio_gpiomem_spi_setup(const PROGRAMMER *pgm) {
+  unsigned int sck = pgm->pinno[PIN_AVR_SCK], sdo = pgm->pinno[PIN_AVR_SDO], sdi = pgm->pinno[PIN_AVR_SDI];
+  int isck = !!(sck & PIN_INVERSE), isdo = !!(sdo & PIN_INVERSE);
+
+  sck &= PIN_MASK, sdo &= PIN_MASK, sdi &= PIN_MASK;
+  my.spi.ok = sck < GPIOMEM_NPINS && sdo < GPIOMEM_NPINS && sdi < GPIOMEM_NPINS && sck != sdo;
+  if(!my.spi.ok)
+    return;
+
+  my.spi.sck_on = my.gpiomem + (isck? GPIOMEM_GPCLR: GPIOMEM_GPSET) + sck/32;
+  my.spi.sck_off = my.gpiomem + (isck? GPIOMEM_GPSET: GPIOMEM_GPCLR) + sck/32;
+  my.spi.sdo_on = my.gpiomem + (isdo? GPIOMEM_GPCLR: GPIOMEM_GPSET) + sdo/32;
+  my.spi.sdo_off = my.gpiomem + (isdo? GPIOMEM_GPSET: GPIOMEM_GPCLR) + sdo/32;
+  my.spi.sdi_lev = my.gpiomem + GPIOMEM_GPLEV + sdi/32;
+  my.spi.sck = 1U << (sck%32);
+  my.spi.sdo = 1U << (sdo%32);
+  my.spi.sdi = 1U << (sdi%32);
+  my.spi.isdi = !!(pgm->pinno[PIN_AVR_SDI] & PIN_INVERSE);
+}
+
+/*
+ * Transmit and receive a byte with the same edges as bitbang_txrx() but
+ * without a setpin()/getpin() call per edge; each register write is read
+ * back to wait for it to reach the GPIO block as in the setpin() method
+ */
+static unsigned char linuxgpio_gpiomem_txrx(const PROGRAMMER *pgm, unsigned char byte) {
+  int rbyte = 0, delay = pgm->ispdelay > 1? pgm->ispdelay: 0;
+  volatile uint32_t *lev = my.spi.sdi_lev;
+
+  for(int i = 7; i >= 0; i--) {
+    *((byte >> i) & 1? my.spi.sdo_on: my.spi.sdo_off) = my.spi.sdo;
+    (void) *lev;
+    if(delay)
+      bitbang_delay(delay);
+
+    *my.spi.sck_on = my.spi.sck;
+    (void) *lev;
+    if(delay)
+      bitbang_delay(delay);
+
+    rbyte |= (!!(*lev & my.spi.sdi) ^ my.spi.isdi) << i;
+
+    *my.spi.sck_off = my.spi.sck;
+    (void) *lev;
+    if(delay)
+      bitbang_delay(delay);
+  }
+
+  return rbyte;
+}
+
+static int linuxgpio_gpiomem_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res) {
+  if(!my.spi.ok)
+    return bitbang_cmd(pgm, cmd, res);
+
+  for(int i = 0; i < 4; i++)
+    res[i] = linuxgpio_gpiomem_txrx(pgm, cmd[i]);
+
+  if(verbose >= MSG_DEBUG) {
+    msg_debug("%s(): [ ", __func__);
+    for(int i = 0; i < 4; i++)
+      msg_debug("%02X ", cmd[i]);
+    msg_debug("] [ ");
+    for(int i = 0; i < 4; i++)
+      msg_debug("%02X ", res[i]);
+    msg_debug("]\n");
+  }
+
+  return 0;
+}
+
+static int linuxgpio_gpiomem_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  if(!my.spi.ok)
+    return bitbang_spi(pgm, cmd, res, count);
+
+  pgm->setpin(pgm, PIN_LED_PGM, 0);
+  for(int i = 0; i < count; i++)
+    res[i] = linuxgpio_gpiomem_txrx(pgm, cmd[i]);
+  pgm->setpin(pgm, PIN_LED_PGM, 1);
+
+  return 0;
+}
+
+static void linuxgpio_gpiomem_display(const PROGRAMMER *pgm, const char *p) {
+  msg_info("%sPin assignment        : " GPIOMEM_DEV "\n", p);
+  pgm_display_generic_mask(pgm, p, SHOW_AVR_PINS);
+}
+
+static void linuxgpio_gpiomem_close(PROGRAMMER *pgm) {
+  bitbang_realtime_end();         // Back to normal scheduling
+
+  if(!my.gpiomem)
+    return;
+
+  // Configure all pins as input except RESET, which follows the exitspec
+  for(int i = 1; i < N_PINS; i++) {
+    unsigned int pin = pgm->pinno[i] & PIN_MASK;
+
+    if(pin < GPIOMEM_NPINS && i != PIN_AVR_RESET)
+      linuxgpio_gpiomem_dir(pgm, pin, 0);
+  }
+
+  unsigned int reset_pin = pgm->pinno[PIN_AVR_RESET] & PIN_MASK;
+
+  if(reset_pin < GPIOMEM_NPINS) {
+    if(pgm->exit_reset == EXIT_RESET_ENABLED) // Exit with RESET pin high
+      pgm->setpin(pgm, PIN_AVR_RESET, 1);
+    else if(pgm->exit_reset == EXIT_RESET_DISABLED) // Exit with RESET pin low
+      pgm->setpin(pgm, PIN_AVR_RESET, 0);
+    else                        // Exit with RESET pin as input (default behaviour)
+      linuxgpio_gpiomem_dir(pgm, reset_pin, 0);
+  }
+
+  munmap((void *) my.gpiomem, GPIOMEM_SIZE);
+  my.gpiomem = NULL;
+  my.spi.ok = 0;
+}
+
+static int linuxgpio_gpiomem_open(PROGRAMMER *pgm, const char *port) {
+  if(pgm->bitclock)
+    pmsg_warning("-c %s does not support adjustable bitclock speed; ignoring -B\n", pgmid);
+
+  if(bitbang_check_prerequisites(pgm) < 0)
+    return -1;
+
+  if(!linuxgpio_gpiomem_soc_ok()) {
+    pmsg_error("-P %s needs a Raspberry Pi with a BCM283x or BCM2711 SoC\n", port);
+    return -1;
+  }
+
+  for(int i = 1; i < N_PINS; i++) {
+    unsigned int pin = pgm->pinno[i] & PIN_MASK;
+
+    if(pin <= PIN_MAX && pin >= GPIOMEM_NPINS) {
+      pmsg_error("GPIO %u of %s not available with -P %s\n", pin, avr_pin_name(i), port);
+      return -1;
+    }
+  }
+
+  int fd = open(GPIOMEM_DEV, O_RDWR | O_SYNC);
+
+  if(fd < 0) {
+    pmsg_ext_error("cannot open %s: %s\n", GPIOMEM_DEV, strerror(errno));
+    return -1;
+  }
+
+  void *map = mmap(NULL, GPIOMEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);                    // The mapping stays valid
+  if(map == MAP_FAILED) {
+    pmsg_ext_error("cannot map %s: %s\n", GPIOMEM_DEV, strerror(errno));
+    return -1;
+  }
+  my.gpiomem = map;
+
+  pgm->display = linuxgpio_gpiomem_display;
+  pgm->close = linuxgpio_gpiomem_close;
+  pgm->setpin = linuxgpio_gpiomem_setpin;
+  pgm->getpin = linuxgpio_gpiomem_getpin;
+  pgm->highpulsepin = linuxgpio_gpiomem_highpulsepin;
+  pgm->cmd = linuxgpio_gpiomem_cmd;
+  pgm->spi = linuxgpio_gpiomem_spi;
+  linuxgpio_gpiomem_spi_setup(pgm);
+
+  // Outputs start low as with the other backends
+  for(int i = 1; i < N_PINS; i++) {
+    unsigned int pin = pgm->pinno[i] & PIN_MASK;
+
+    if(pin >= GPIOMEM_NPINS)
+      continue;
+    if(i == PIN_AVR_SDI) {
+      linuxgpio_gpiomem_dir(pgm, pin, 0);
+    } else {
+      my.gpiomem[GPIOMEM_GPCLR + pin/32] = 1U << (pin%32);
+      linuxgpio_gpiomem_dir(pgm, pin, 1);
+    }
+  }
+
+  return 0;
+}
+
 static int linuxgpio_sysfs_open(PROGRAMMER *pgm, const char *port) {
   int r, i, pin;
   char gpio_path[60];
   struct stat stat_buf;
 
+  if(linuxgpio_is_gpiomem(port))
+    return linuxgpio_gpiomem_open(pgm, port);
+
   if(bitbang_check_prerequisites(pgm) < 0)
     return -1;
 
@@ -298,6 +591,8 @@ static int linuxgpio_sysfs_open(PROGRAMMER *pgm, const char *port) {
 static void linuxgpio_sysfs_close(PROGRAMMER *pgm) {
   int i, reset_pin;
 
+  bitbang_realtime_end();         // Back to normal scheduling
+
   reset_pin = pgm->pinno[PIN_AVR_RESET] & PIN_MASK;
 
   // First configure all pins as input, except RESET
@@ -388,6 +683,7 @@ struct gpiod_line {
   struct gpiod_chip *chip;
   struct gpiod_line_request *line_request;
   unsigned int gpio_num;
+  int shared;                   // Line request is shared with other lines and released separately
 };
 
 struct gpiod_line *gpiod_line_get(const char *port, int gpio_num) {
@@ -514,7 +810,8 @@ err_out:
 }
 
 void gpiod_line_release(struct gpiod_line *gpio_line) {
-  gpiod_line_request_release(gpio_line->line_request);
+  if(!gpio_line->shared)
+    gpiod_line_request_release(gpio_line->line_request);
   gpiod_chip_close(gpio_line->chip);
   mmt_free(gpio_line);
 }
@@ -537,7 +834,165 @@ static inline unsigned int linuxgpio_get_gpio_num(struct gpiod_line *gpio_line)
 #endif
 }
 
-struct gpiod_line *linuxgpio_libgpiod_lines[N_PINS];
+static LIBAVRDUDE_THREAD_LOCAL struct gpiod_line *linuxgpio_libgpiod_lines[N_PINS]; // Per session
+
+#if HAVE_LIBGPIOD_V2
+// SCK, SDO and SDI share one line request so a single ioctl can drive several of them
+static LIBAVRDUDE_THREAD_LOCAL struct gpiod_line_request *linuxgpio_libgpiod_spi_req;
+
+static int linuxgpio_libgpiod_spi_pin(int pinfunc) {
+  return pinfunc == PIN_AVR_SCK || pinfunc == PIN_AVR_SDO || pinfunc == PIN_AVR_SDI;
+}
+
+// Request SCK and SDO as outputs and SDI as input in one line request; returns 0 on success
+static int linuxgpio_libgpiod_request_spi(void) {
+  struct gpiod_line *sck = linuxgpio_libgpiod_lines[PIN_AVR_SCK];
+  struct gpiod_line *sdo = linuxgpio_libgpiod_lines[PIN_AVR_SDO];
+  struct gpiod_line *sdi = linuxgpio_libgpiod_lines[PIN_AVR_SDI];
+  struct gpiod_line_settings *out_settings = NULL, *in_settings = NULL;
+  struct gpiod_line_config *line_config = NULL;
+  struct gpiod_request_config *req_cfg = NULL;
+  int retval = -1;
+
+  if(!sck || !sdo || !sdi)
+    return -1;
+
+  out_settings = gpiod_line_settings_new();
+  in_settings = gpiod_line_settings_new();
+  line_config = gpiod_line_config_new();
+  req_cfg = gpiod_request_config_new();
+
+  if(!out_settings || !in_settings || !line_config || !req_cfg)
+    goto err_out;
+
+  if(gpiod_line_settings_set_direction(out_settings, GPIOD_LINE_DIRECTION_OUTPUT) != 0 ||
+    gpiod_line_settings_set_output_value(out_settings, GPIOD_LINE_VALUE_INACTIVE) != 0 ||
+    gpiod_line_settings_set_direction(in_settings, GPIOD_LINE_DIRECTION_INPUT) != 0)
+    goto err_out;
+
+  if(gpiod_line_config_add_line_settings(line_config, &sck->gpio_num, 1, out_settings) != 0 ||
+    gpiod_line_config_add_line_settings(line_config, &sdo->gpio_num, 1, out_settings) != 0 ||
+    gpiod_line_config_add_line_settings(line_config, &sdi->gpio_num, 1, in_settings) != 0)
+    goto err_out;
+
+  gpiod_request_config_set_consumer(req_cfg, "avrdude");
+
+  linuxgpio_libgpiod_spi_req = gpiod_chip_request_lines(sck->chip, req_cfg, line_config);
+  if(!linuxgpio_libgpiod_spi_req)
+    goto err_out;
+
+  sck->line_request = sdo->line_request = sdi->line_request = linuxgpio_libgpiod_spi_req;
+  sck->shared = sdo->shared = sdi->shared = 1;
+  retval = 0;
+
+err_out:
+  gpiod_line_settings_free(out_settings);
+  gpiod_line_settings_free(in_settings);
+  gpiod_line_config_free(line_config);
+  gpiod_request_config_free(req_cfg);
+  return retval;
+}
+
+static inline enum gpiod_line_value linuxgpio_libgpiod_value(int value) {
+  return value? GPIOD_LINE_VALUE_ACTIVE: GPIOD_LINE_VALUE_INACTIVE;
+}
+
+/*
+ * Transmit and receive a byte via the shared SPI line request: each falling
+ * SCK edge sets the next SDO bit with the same ioctl, which is safe as the
+ * part samples SDO on the rising edge; returns the byte read or -1 on error
+ */
+static int linuxgpio_libgpiod_txrx(const PROGRAMMER *pgm, unsigned char byte) {
+  struct gpiod_line_request *req = linuxgpio_libgpiod_spi_req;
+  int isck = !!(pgm->pinno[PIN_AVR_SCK] & PIN_INVERSE);
+  int isdo = !!(pgm->pinno[PIN_AVR_SDO] & PIN_INVERSE);
+  int isdi = !!(pgm->pinno[PIN_AVR_SDI] & PIN_INVERSE);
+  unsigned int offsets[2] = {
+    linuxgpio_libgpiod_lines[PIN_AVR_SCK]->gpio_num,
+    linuxgpio_libgpiod_lines[PIN_AVR_SDO]->gpio_num,
+  };
+  unsigned int sdi = linuxgpio_libgpiod_lines[PIN_AVR_SDI]->gpio_num;
+  enum gpiod_line_value values[2];
+  int r, rbyte = 0;
+
+  // SCK is low: present the first bit
+  if(gpiod_line_request_set_value(req, offsets[1], linuxgpio_libgpiod_value(((byte >> 7) & 1) ^ isdo)) != 0)
+    return -1;
+  if(pgm->ispdelay > 1)
+    bitbang_delay(pgm->ispdelay);
+
+  for(int i = 7; i >= 0; i--) {
+    if(gpiod_line_request_set_value(req, offsets[0], linuxgpio_libgpiod_value(!isck)) != 0)
+      return -1;
+    if(pgm->ispdelay > 1)
+      bitbang_delay(pgm->ispdelay);
+
+    if((r = gpiod_line_request_get_value(req, sdi)) < 0)
+      return -1;
+    rbyte |= ((r == GPIOD_LINE_VALUE_ACTIVE) ^ isdi) << i;
+
+    values[0] = linuxgpio_libgpiod_value(isck);
+    if(i) {
+      values[1] = linuxgpio_libgpiod_value(((byte >> (i - 1)) & 1) ^ isdo);
+      r = gpiod_line_request_set_values_subset(req, 2, offsets, values);
+    } else {
+      r = gpiod_line_request_set_value(req, offsets[0], values[0]);
+    }
+    if(r != 0)
+      return -1;
+    if(pgm->ispdelay > 1)
+      bitbang_delay(pgm->ispdelay);
+  }
+
+  return rbyte;
+}
+
+// ISP command via the shared SPI line request if available, otherwise bit by bit
+static int linuxgpio_libgpiod_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res) {
+  if(!linuxgpio_libgpiod_spi_req)
+    return bitbang_cmd(pgm, cmd, res);
+
+  for(int i = 0; i < 4; i++) {
+    int r = linuxgpio_libgpiod_txrx(pgm, cmd[i]);
+
+    if(r < 0) {
+      pmsg_error("failed to transfer SPI byte: %s\n", strerror(errno));
+      return -1;
+    }
+    res[i] = r;
+  }
+
+  if(verbose >= MSG_DEBUG) {
+    msg_debug("%s(): [ ", __func__);
+    for(int i = 0; i < 4; i++)
+      msg_debug("%02X ", cmd[i]);
+    msg_debug("] [ ");
+    for(int i = 0; i < 4; i++)
+      msg_debug("%02X ", res[i]);
+    msg_debug("]\n");
+  }
+
+  return 0;
+}
+
+// Transfer count bytes via the shared SPI line request, eg, for avr_spi_paged_load()
+static int linuxgpio_libgpiod_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  if(!linuxgpio_libgpiod_spi_req)
+    return bitbang_spi(pgm, cmd, res, count);
+
+  for(int i = 0; i < count; i++) {
+    int r = linuxgpio_libgpiod_txrx(pgm, cmd[i]);
+
+    if(r < 0) {
+      pmsg_error("failed to transfer SPI byte: %s\n", strerror(errno));
+      return -1;
+    }
+    res[i] = r;
+  }
+
+  return 0;
+}
+#endif
 
 // Try to tell if libgpiod is going to work.
 // Returns True (non-zero) if it looks like libgpiod will work, False
@@ -561,6 +1016,9 @@ static void linuxgpio_libgpiod_display(const PROGRAMMER *pgm, const char *p) {
 }
 
 static int linuxgpio_libgpiod_open(PROGRAMMER *pgm, const char *port) {
+  if(linuxgpio_is_gpiomem(port))
+    return linuxgpio_gpiomem_open(pgm, port);
+
   if(pgm->bitclock)
     pmsg_warning("-c %s does not support adjustable bitclock speed; ignoring -B\n", pgmid);
 
@@ -569,6 +1027,9 @@ static int linuxgpio_libgpiod_open(PROGRAMMER *pgm, const char *port) {
 
   for(int i = 0; i < N_PINS; ++i)
     linuxgpio_libgpiod_lines[i] = NULL;
+#if HAVE_LIBGPIOD_V2
+  linuxgpio_libgpiod_spi_req = NULL;
+#endif
 
   // Avrdude assumes that if a pin number is invalid it means not used/available
   for(int i = 1; i < N_PINS; i++) { // The pin enumeration in libavrdude.h starts with PPI_AVR_VCC = 1
@@ -585,6 +1046,11 @@ static int linuxgpio_libgpiod_open(PROGRAMMER *pgm, const char *port) {
       return -1;
     }
 
+#if HAVE_LIBGPIOD_V2
+    if(linuxgpio_libgpiod_spi_pin(i)) // Requested together below
+      continue;
+#endif
+
     // Request the pin, select direction
     r = i == PIN_AVR_SDI?
       gpiod_line_request_input(linuxgpio_libgpiod_lines[i], "avrdude"):
@@ -597,12 +1063,35 @@ static int linuxgpio_libgpiod_open(PROGRAMMER *pgm, const char *port) {
 
   }
 
+#if HAVE_LIBGPIOD_V2
+  // Fall back to one request per SPI line if they cannot be requested together
+  if(linuxgpio_libgpiod_request_spi() != 0) {
+    pmsg_notice("cannot request SPI lines together, using one request per line\n");
+    for(int i = 1; i < N_PINS; i++) {
+      if(!linuxgpio_libgpiod_spi_pin(i) || !linuxgpio_libgpiod_lines[i])
+        continue;
+
+      int r = i == PIN_AVR_SDI?
+        gpiod_line_request_input(linuxgpio_libgpiod_lines[i], "avrdude"):
+        gpiod_line_request_output(linuxgpio_libgpiod_lines[i], "avrdude", 0);
+
+      if(r != 0) {
+        msg_error("failed to request %s line %u: %s\n", port,
+          linuxgpio_get_gpio_num(linuxgpio_libgpiod_lines[i]), strerror(errno));
+        return -1;
+      }
+    }
+  }
+#endif
+
   return 0;
 }
 
 static void linuxgpio_libgpiod_close(PROGRAMMER *pgm) {
   int i;
 
+  bitbang_realtime_end();         // Back to normal scheduling
+
   // First configure all pins as input, except RESET.
   // This should avoid possible conflicts when AVR firmware starts.
   for(i = 0; i < N_PINS; ++i) {
@@ -623,6 +1112,13 @@ static void linuxgpio_libgpiod_close(PROGRAMMER *pgm) {
     }
   }
 
+#if HAVE_LIBGPIOD_V2
+  if(linuxgpio_libgpiod_spi_req) {
+    gpiod_line_request_release(linuxgpio_libgpiod_spi_req);
+    linuxgpio_libgpiod_spi_req = NULL;
+  }
+#endif
+
   if(pgm->exit_reset == EXIT_RESET_ENABLED) // Exit with RESET pin high
     pgm->setpin(pgm, PIN_AVR_RESET, 1);
   else if(pgm->exit_reset == EXIT_RESET_DISABLED) // Exit with RESET pin low
@@ -747,6 +1243,7 @@ void linuxgpio_initpgm(PROGRAMMER *pgm) {
   pgm->chip_erase = bitbang_chip_erase;
   pgm->cmd = bitbang_cmd;
   pgm->cmd_tpi = bitbang_cmd_tpi;
+  pgm->cmd_tpi_batch = bitbang_cmd_tpi_batch;
   pgm->open = linuxgpio_sysfs_open;
   pgm->close = linuxgpio_sysfs_close;
   pgm->setpin = linuxgpio_sysfs_setpin;
@@ -754,6 +1251,11 @@ void linuxgpio_initpgm(PROGRAMMER *pgm) {
   pgm->highpulsepin = linuxgpio_sysfs_highpulsepin;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
+  pgm->spi = bitbang_spi;
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
   pgm->setup = linuxgpio_setup;
   pgm->teardown = linuxgpio_teardown;
   pgm->parseexitspecs = linuxgpio_parseexitspecs;
@@ -767,6 +1269,10 @@ void linuxgpio_initpgm(PROGRAMMER *pgm) {
     pgm->setpin = linuxgpio_libgpiod_setpin;
     pgm->getpin = linuxgpio_libgpiod_getpin;
     pgm->highpulsepin = linuxgpio_libgpiod_highpulsepin;
+#if HAVE_LIBGPIOD_V2
+    pgm->cmd = linuxgpio_libgpiod_cmd;
+    pgm->spi = linuxgpio_libgpiod_spi;
+#endif
   } else {
     msg_notice("falling back to sysfs for linuxgpio\n");
   }
@@ -328,6 +328,52 @@ static int linuxspi_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigne
   return linuxspi_spi_duplex(pgm, cmd, res, 4);
 }
 
+// Maximum number of 4-byte ISP commands sent in one SPI_IOC_MESSAGE() ioctl
+#define LINUXSPI_MAX_CMDS 128
+
+/*
+ * @brief Sends/receives n 4-byte commands as one message of n transfers per ioctl
+ * @return -1 on failure, otherwise 0
+ */
+static int linuxspi_spi_cmds(const PROGRAMMER *pgm, const unsigned char *tx, unsigned char *rx, int n) {
+  struct spi_ioc_transfer tr[LINUXSPI_MAX_CMDS];
+
+  for(int done = 0, k; done < n; done += k) {
+    k = n - done < LINUXSPI_MAX_CMDS? n - done: LINUXSPI_MAX_CMDS;
+    for(int i = 0; i < k; i++)
+      tr[i] = (struct spi_ioc_transfer) {
+        .tx_buf = (unsigned long) (tx + 4*(done + i)),
+        .rx_buf = (unsigned long) (rx + 4*(done + i)),
+        .len = 4,
+        .delay_usecs = 1,
+        .speed_hz = 1.0/pgm->bitclock,
+        .bits_per_word = 8,
+        .cs_change = i < k - 1, // Toggle CS between commands as separate messages would
+      };
+
+    errno = 0;
+    if(ioctl(my.fd_spidev, SPI_IOC_MESSAGE(k), tr) != 4*k) {
+      int ioctl_errno = errno;
+
+      pmsg_error("unable to send %d SPI commands", k);
+      if(ioctl_errno)
+        msg_error(": %s", strerror(ioctl_errno));
+      msg_error("\n");
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Multi-byte SPI transfer for avr_spi_paged_load() and avr_spi_paged_write();
+ * whole ISP commands go out as a message of 4-byte transfers
+ */
+static int linuxspi_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  return count%4? linuxspi_spi_duplex(pgm, cmd, res, count): linuxspi_spi_cmds(pgm, cmd, res, count/4);
+}
+
 static int linuxspi_program_enable(const PROGRAMMER *pgm, const AVRPART *p) {
   unsigned char cmd[4], res[4];
 
@@ -381,7 +427,7 @@ static int linuxspi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   memset(cmd, 0, sizeof(cmd));
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -467,12 +513,17 @@ void linuxspi_initpgm(PROGRAMMER *pgm) {
   pgm->program_enable = linuxspi_program_enable;
   pgm->chip_erase = linuxspi_chip_erase;
   pgm->cmd = linuxspi_cmd;
+  pgm->spi = linuxspi_spi;
   pgm->open = linuxspi_open;
   pgm->close = linuxspi_close;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
 
   // Optional functions
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->multipage_write = 1;
+  pgm->multipage_load = 1;
   pgm->setup = linuxspi_setup;
   pgm->teardown = linuxspi_teardown;
   pgm->parseexitspecs = linuxspi_parseexitspecs;
@@ -30,8 +30,10 @@
 
 #include <ac_cfg.h>
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "avrdude.h"
 #include "libavrdude.h"
@@ -90,12 +92,29 @@ typedef struct LIST {
   LISTNODE *next_ln;            // Next available list node
   NODEPOOL *np_top;             // Top of the node pool chain
   NODEPOOL *np_bottom;          // Bottom of the node pool chain
+  unsigned long gen;            // Generation, see lgen()
+  int is_vec;                   // Keep vec[] up to date on every ladd(), see lcreat_vec()
+  int vec_num, vec_cap;         // Number of valid and allocated entries in vec[]
+  unsigned long vec_gen;        // List generation when vec[] was last synchronised
+  void **vec;                   // Contiguous copy of the data pointers, see lvec()
 
 #if CHECK_MAGIC
   unsigned int magic2;
 #endif
 } LIST;
 
+// Source of list generations; never reused, so a new list never looks like a freed one
+static unsigned long lgen_counter;
+
+// Next generation; atomic as sessions in different threads create and change lists
+static unsigned long lgen_next(void) {
+#if defined(__GNUC__)
+  return __atomic_add_fetch(&lgen_counter, 1, __ATOMIC_RELAXED);
+#else
+  return ++lgen_counter;
+#endif
+}
+
 // Allocate list nodes in 512 byte chunks, giving 42 elements
 #define DEFAULT_POOLSIZE 512
 
@@ -421,6 +440,11 @@ LISTID lcreat(void *liststruct, int elements) {
   l->top = NULL;
   l->bottom = NULL;
   l->num = 0;
+  l->gen = lgen_next();
+  l->is_vec = 0;
+  l->vec_num = l->vec_cap = 0;
+  l->vec_gen = 0;
+  l->vec = NULL;
 
   if(elements == 0) {
     l->poolsize = DEFAULT_POOLSIZE;
@@ -446,6 +470,75 @@ LISTID lcreat(void *liststruct, int elements) {
   return (LISTID) l;
 }
 
+/*--------------------------------------------------
+|  lcreat_vec
+|
+|  create a list like lcreat() that also keeps a
+|  contiguous array of its data pointers up to date
+|  while elements are added at the end; meant for
+|  read-mostly lists that are scanned often, eg, part
+|  memories or the part and programmer lists. Such a
+|  list is used with the same API; in addition, lvec()
+|  returns the array in O(1) and lget_n() is O(1).
+ --------------------------------------------------*/
+LISTID lcreat_vec(void *liststruct, int elements) {
+  LIST *l = lcreat(liststruct, elements);
+
+  if(l)
+    l->is_vec = 1;
+
+  return (LISTID) l;
+}
+
+/*--------------------------------------------------
+|  vec_sync
+|
+|  bring the array of data pointers up to date; only
+|  the new tail needs copying if the list has only
+|  grown at the end since the last synchronisation
+ --------------------------------------------------*/
+static void vec_sync(LIST *l) {
+  LISTNODE *ln;
+  int i;
+
+  if(l->vec_gen == l->gen && l->vec_num == l->num)
+    return;
+
+  if(l->num > l->vec_cap) {
+    l->vec_cap = l->num < 16? 16: 2*l->num;
+    l->vec = mmt_realloc(l->vec, l->vec_cap*sizeof *l->vec);
+  }
+
+  if(l->vec_gen != l->gen) {    // Removed, reordered or inserted: copy all
+    for(i = 0, ln = l->top; ln; ln = ln->next)
+      l->vec[i++] = ln->data;
+  } else {                      // Appended only: copy the new tail
+    for(i = l->num, ln = l->bottom; i > l->vec_num; ln = ln->prev)
+      l->vec[--i] = ln->data;
+  }
+  l->vec_num = l->num;
+  l->vec_gen = l->gen;
+}
+
+/*--------------------------------------------------
+|  lvec
+|
+|  return a contiguous array of the lsize() data
+|  pointers of the list in list order; the array
+|  belongs to the list and is valid until the list
+|  is next changed. Any list can be viewed this way,
+|  but lists from lcreat_vec() do not need to build
+|  the array first.
+ --------------------------------------------------*/
+void **lvec(LISTID lid) {
+  LIST *l = (LIST *) lid;
+
+  CKLMAGIC(l);
+  vec_sync(l);
+
+  return l->vec;
+}
+
 /*--------------------------------------------------
 |  ldestroy_cb
 |
@@ -501,6 +594,8 @@ void ldestroy(LISTID lid) {
     p1 = p2;
   }
 
+  FREE(l->vec);
+
   /*--------------------------------------------------
   |  now free the memory occupied by the list itself
    --------------------------------------------------*/
@@ -548,6 +643,8 @@ int ladd(LISTID lid, void *p) {
     l->bottom = lnptr;
   }
   l->num++;
+  if(l->is_vec)
+    vec_sync(l);
 
   CKLMAGIC(l);
 
@@ -732,6 +829,11 @@ void *lget_n(LISTID lid, unsigned int n) {
     return NULL;
   }
 
+  if(l->is_vec) {
+    vec_sync(l);
+    return l->vec[n - 1];
+  }
+
   ln = l->top;
   i = 1;
   while(ln && (i != n)) {
@@ -815,6 +917,7 @@ static int insert_ln(LIST *l, LISTNODE *ln, void *data_ptr) {
   CKMAGIC(lnptr);
 
   lnptr->data = data_ptr;
+  l->gen = lgen_next();
 
   if(ln == l->top) {
 
@@ -953,6 +1056,8 @@ static void *remove_ln(LIST *l, LISTNODE *ln) {
 
   CKMAGIC(ln);
 
+  l->gen = lgen_next();
+
   if(ln == l->top) {
 
     /*------------------------------
@@ -1175,6 +1280,8 @@ void lsort(LISTID lid, int (*compare)(void *p1, void *p2)) {
 
   CKLMAGIC(l);
 
+  l->gen = lgen_next();
+
   while(unsorted) {
     lt = l->top;
     unsorted = 0;
@@ -1195,6 +1302,128 @@ void lsort(LISTID lid, int (*compare)(void *p1, void *p2)) {
   CKLMAGIC(l);
 }
 
+/*----------------------------------------------------------------------
+|  lgen
+|
+|  Return the generation of the list. This changes whenever elements are
+|  removed, reordered or inserted anywhere but at the end, so that users
+|  who keep an index of the list can tell whether they need to rebuild
+|  it or whether they only need to add the elements after the last one
+|  they have seen.
+ ----------------------------------------------------------------------*/
+unsigned long lgen(LISTID lid) {
+  return ((LIST *) lid)->gen;
+}
+
+/*----------------------------------------------------------------------
+|  Hash table from case-insensitive string keys to data pointers
+|
+|  lhadd() keeps the first data pointer for a key, so that lhget()
+|  mirrors a first-match search through a list
+ ----------------------------------------------------------------------*/
+typedef struct LHENTRY {
+  struct LHENTRY *next;
+  char *key;
+  void *data;
+} LHENTRY;
+
+typedef struct LHASH {
+  int num;                      // Number of keys
+  int size;                     // Number of buckets, a power of 2
+  LHENTRY **tab;
+} LHASH;
+
+static unsigned lhash_key(const char *key) {
+  unsigned c, hash = 5381;
+
+  while((c = (unsigned char) *key++))
+    hash = 33*hash ^ tolower(c);
+
+  return hash;
+}
+
+LHASHID lhcreat(void) {
+  LHASH *h = MALLOC(sizeof *h, "hash struct");
+
+  h->size = 64;
+  h->tab = MALLOC(h->size*sizeof *h->tab, "hash table");
+
+  return (LHASHID) h;
+}
+
+void lhdestroy_cb(LHASHID hid, void (*ucleanup)(void *data_ptr)) {
+  LHASH *h = (LHASH *) hid;
+
+  if(!h)
+    return;
+  for(int i = 0; i < h->size; i++)
+    for(LHENTRY *e = h->tab[i], *next; e; e = next) {
+      next = e->next;
+      if(ucleanup)
+        ucleanup(e->data);
+      FREE(e->key);
+      FREE(e);
+    }
+  FREE(h->tab);
+  FREE(h);
+}
+
+void lhdestroy(LHASHID hid) {
+  lhdestroy_cb(hid, NULL);
+}
+
+static LHENTRY **lhash_find(LHASH *h, const char *key) {
+  LHENTRY **ep = h->tab + (lhash_key(key) & (h->size - 1));
+
+  while(*ep && strcasecmp((*ep)->key, key))
+    ep = &(*ep)->next;
+
+  return ep;
+}
+
+// Add data under key unless key is already present; return 1 if it was, 0 otherwise
+int lhadd(LHASHID hid, const char *key, void *data) {
+  LHASH *h = (LHASH *) hid;
+  LHENTRY **ep = lhash_find(h, key);
+
+  if(*ep)
+    return 1;
+
+  if(h->num >= h->size) {       // Double the number of buckets
+    LHENTRY **old = h->tab;
+    int oldsize = h->size;
+
+    h->size *= 2;
+    h->tab = MALLOC(h->size*sizeof *h->tab, "hash table");
+    for(int i = 0; i < oldsize; i++)
+      for(LHENTRY *e = old[i], *next; e; e = next) {
+        next = e->next;
+        LHENTRY **np = h->tab + (lhash_key(e->key) & (h->size - 1));
+
+        e->next = *np;
+        *np = e;
+      }
+    FREE(old);
+    ep = lhash_find(h, key);
+  }
+
+  LHENTRY *e = MALLOC(sizeof *e, "hash entry");
+
+  e->key = mmt_strdup(key);
+  e->data = data;
+  *ep = e;
+  h->num++;
+
+  return 0;
+}
+
+// Return data stored under key or NULL if there is none
+void *lhget(LHASHID hid, const char *key) {
+  LHENTRY *e = *lhash_find((LHASH *) hid, key);
+
+  return e? e->data: NULL;
+}
+
 int lprint(FILE *f, LISTID lid) {
   LIST *l;
   LISTNODE *ln;
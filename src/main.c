@@ -47,6 +47,14 @@
 
 #if !defined(WIN32)
 #include <dirent.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #endif
 
 #include "avrdude.h"
@@ -109,6 +117,11 @@ int avrdude_message2(FILE *fp, int lno, const char *file, const char *func,
       break;
   }
 
+  if(cx && cx->upd_msghold) {   // Helper thread parsing ahead (see update_prefetch())
+    cx->upd_nheld += (quell_progress < 2 || fp != stderr? verbose: verbose + 1 - quell_progress) >= msglvl;
+    return 0;
+  }
+
   if(msglvl <= MSG_ERROR)       // Serious error? Free progress bars (if any)
     report_progress(1, -1, NULL);
 
@@ -210,7 +223,7 @@ struct list_walk_cookie {
   const char *prefix;
 };
 
-libavrdude_context *cx;         // Context pointer, eventually the only global variable
+LIBAVRDUDE_THREAD_LOCAL libavrdude_context *cx; // Per-thread context pointer
 
 static LISTID updates = NULL;
 
@@ -218,12 +231,17 @@ static LISTID extended_params = NULL;
 
 static LISTID additional_config_files = NULL;
 
+static LISTID gang_ports = NULL;
+
+static int gang_bulk_limit;     // Maximum concurrent bulk phases per USB hub, 0 for no limit
+static int gang_programming;    // Forked one worker per port
+
 static PROGRAMMER *pgm;
 
 // Global options
-int verbose;                    // Verbose output
-int quell_progress;             // Quell progress report and un-verbose output
-int ovsigck;                    // 1 = override sig check, 0 = don't
+LIBAVRDUDE_THREAD_LOCAL int verbose;        // Verbose output
+LIBAVRDUDE_THREAD_LOCAL int quell_progress; // Quell progress report and un-verbose output
+LIBAVRDUDE_THREAD_LOCAL int ovsigck;        // 1 = override sig check, 0 = don't
 const char *partdesc;           // Part -p string
 const char *pgmid;              // Programmer -c string
 
@@ -243,7 +261,7 @@ static void usage(void) {
     "                            Run developer options for matched AVR devices,\n"
     "                            e.g., -p ATmega328P/s or /S for part definition\n"
     "  -b, --baud <baudrate>     Override RS-232 baud rate\n"
-    "  -B, --bitclock <bitclock> Specify bit clock period (us)\n"
+    "  -B, --bitclock <bitclock> Specify bit clock period (us) or auto\n"
     "  -C, --config <config-file>\n"
     "                            Specify location of configuration file\n"
     "  -C, --config +<config-file>\n"
@@ -256,14 +274,26 @@ static void usage(void) {
     "                            e.g., -c 'ur*'/s for programmer info/definition\n"
     "  -A                        Disable trailing-0xff removal for file/AVR read\n"
     "  -D, --noerase             Disable auto-erase for flash memory; implies -A\n"
+    "  --differential            Only write pages that differ on the device; no\n"
+    "                            chip erase, pages are erased only when needed\n"
     "  -i <delay>                Bit state change delay [in microseconds] for\n"
     "                            bit-banged ISP and TPI programmers\n"
     "  -P, --port <port>         Connection; -P ?s or -P ?sa lists serial ones\n"
+    "                            A /dev/* or usb:* wildcard: gang programming\n"
+    "  --gang                    Gang program all of several -P ports\n"
+    "  --bulk-per-hub <n>        Gang: at most n read-backs at a time per USB hub\n"
+    "  --probe                   Use the first of several -P ports with the target\n"
+    "  --realtime                Bitbang: real-time scheduling, pinned CPU and\n"
+    "                            locked memory for more deterministic timing\n"
     "  -r, --reconnect           Reconnect to -P port after \"touching\" it; wait\n"
     "                            400 ms for each -r; needed for some USB boards\n"
     "  -F                        Override invalid signature or initial checks\n"
     "  -e, --erase               Perform a chip erase at the beginning\n"
     "  -O, --osccal              Perform RC oscillator calibration (see AVR053)\n"
+    "  --job <file>              Run production job <file>: images, fuses, lock,\n"
+    "                            serial numbers and number of units\n"
+    "  --hotplug                 Wait for the USB programmer to be plugged in;\n"
+    "                            job units start when it is re-plugged\n"
     "  -t, --terminal            Run an interactive terminal when it is its turn\n"
     "  -T <terminal cmd line>    Run terminal line when it is its turn\n"
     "  -U, --memory <memstr>:r|w|v:<filename>[:format]\n"
@@ -271,11 +301,26 @@ static void usage(void) {
     "                            Multiple -t, -T and -U options can be specified\n"
     "  -n, --test-memory         Do not write to the device whilst processing -U\n"
     "  -V, --noverify-memory     Do not automatically verify during -U\n"
+    "  --verify-policy <policy>  Verify with crc (default), full or sample[:<n>]\n"
+    "  --inline-verify           Verify each page right after writing it instead\n"
+    "                            of reading the memory back afterwards\n"
     "  -E <exitsp>[,<exitsp>]    List programmer exit specifications\n"
     "  -x <extended_param>       Pass <extended_param> to programmer, see -x help\n"
     "  -v, --verbose             Verbose output; -v -v for more\n"
     "  -q, --quell               Quell progress output; -q -q for less\n"
     "  -l, --logfile logfile     Use logfile rather than stderr for diagnostics\n"
+    "  --trace <file>            Write last serial transactions to pcap <file>\n"
+    "  --record <file>           Record all serial transactions to pcap <file>\n"
+    "  --replay <file>           Replay a --record <file> instead of using the port\n"
+    "  --timing json[:<file>]    Report time and throughput of each phase as JSON\n"
+    "  --timing chrome:<file>    Write detailed spans in Trace Event Format\n"
+#if !defined(WIN32)
+    "  --serve <socket>          Keep the programmer open after the -t, -T and -U\n"
+    "                            options and serve jobs on local socket <socket>\n"
+    "  --serve net:[<h>]:<port>  Serve jobs on TCP <port>, accepting pushed images;\n"
+    "                            <h> defaults to loopback, use * for all interfaces\n"
+    "  --remote <host>:<port>    Run -e, -T and -U on the avrdude server at <host>\n"
+#endif
     "  --version                 Print version and exit\n"
     "  -?, --help                Display this usage\n"
     "\navrdude version %s, https://github.com/avrdudes/avrdude\n",
@@ -284,6 +329,1104 @@ static void usage(void) {
   mmt_free(cfg);
 }
 
+#if !defined(WIN32)
+#define SERVE_RS '\036'         // Record separator that starts status lines of net servers
+
+/*
+ * Listen on TCP address [<host>]:<port> for jobs; returns the socket or -1.
+ * Without host only connections to 127.0.0.1 are accepted; host * listens
+ * on all interfaces.
+ */
+static int serve_listen_net(const char *addr) {
+  char *hp = mmt_strdup(addr), *hstr = hp, *pstr = strrchr(hp, ':');
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+  struct addrinfo *result, *rp;
+  int sfd = -1, on = 1, s;
+
+  if(!pstr || !pstr[1]) {
+    pmsg_error("mangled [host]:port string %s\n", addr);
+    goto error;
+  }
+  if(*hstr == '[' && pstr > hstr && pstr[-1] == ']') {
+    hstr++;
+    pstr[-1] = 0;
+  }
+  *pstr++ = 0;
+  if(str_eq(hstr, "*"))
+    hints.ai_flags = AI_PASSIVE;
+  else if(!*hstr)               // 127.0.0.1, which local clients try whether or not they have IPv6
+    hints.ai_family = AF_INET;
+  if((s = getaddrinfo(*hstr && !str_eq(hstr, "*")? hstr: NULL, pstr, &hints, &result))) {
+    pmsg_ext_error("cannot resolve host=\"%s\", port=\"%s\": %s\n", hstr, pstr, gai_strerror(s));
+    goto error;
+  }
+  for(rp = result; rp; rp = rp->ai_next) {
+    if((sfd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol)) < 0)
+      continue;
+    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    if(bind(sfd, rp->ai_addr, rp->ai_addrlen) == 0 && listen(sfd, 1) == 0)
+      break;
+    close(sfd);
+    sfd = -1;
+  }
+  if(sfd < 0)
+    pmsg_ext_error("cannot serve jobs on %s: %s\n", addr, strerror(errno));
+  freeaddrinfo(result);
+
+error:
+  mmt_free(hp);
+  return sfd;
+}
+
+// Listen on local socket path for jobs; returns the socket or -1
+static int serve_listen_local(const char *path) {
+  struct sockaddr_un sa = {.sun_family = AF_UNIX };
+  int sfd;
+
+  if(strlen(path) >= sizeof sa.sun_path) {
+    pmsg_error("socket name %s is too long\n", path);
+    return -1;
+  }
+  strcpy(sa.sun_path, path);
+  unlink(path);
+  if((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || bind(sfd, (struct sockaddr *) &sa, sizeof sa) < 0 ||
+    listen(sfd, 1) < 0) {
+    pmsg_ext_error("cannot serve jobs on %s: %s\n", path, strerror(errno));
+    if(sfd >= 0)
+      close(sfd);
+    return -1;
+  }
+
+  return sfd;
+}
+
+// Name of a pushed image: a plain file name in the image directory
+static int serve_image_name_ok(const char *name) {
+  return *name && *name != '.' && !strchr(name, '/') && !strchr(name, ':');
+}
+
+/*
+ * Jobs of net servers must only access files in the image directory: -U
+ * jobs need a file name that is acceptable for a pushed image unless they
+ * carry immediate or generated data, and terminal lines must neither contain
+ * a path, ie, any slash, nor a ! subshell command
+ */
+static int serve_job_ok(const char *job, const UPDATE *upd) {
+  if(upd) {
+    if(upd->format == FMT_IMM || is_generated_fname(upd->filename) ||
+      (serve_image_name_ok(upd->filename) && !str_eq(upd->filename, "-")))
+      return 1;
+    pmsg_error("-U file %s is not an image name; push it and use its plain name\n", upd->filename);
+    return 0;
+  }
+  if(strchr(job, '/')) {
+    pmsg_error("terminal line must not refer to paths outside the image directory\n");
+    return 0;
+  }
+  if(str_starts(job, "-T"))
+    job += 2;
+  for(const char *q = job; q; q = strchr(q, ';')) { // Any command of the line
+    q = str_ltrim(q + (*q == ';'));
+    if(*q == '!') {
+      pmsg_error("terminal line must not run a subshell\n");
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Receive a pushed image of size bytes and store it as name in the current directory
+static int serve_push(FILE *in, const char *name, long size) {
+  char buf[4096];
+  FILE *fp = NULL;
+  int rc = 0;
+
+  if(!serve_image_name_ok(name) || size < 0) {
+    pmsg_error("invalid image %s of size %ld\n", name, size);
+    rc = -1;                    // Still consume the image so the stream stays in sync
+  } else if(!(fp = fopen(name, "wb"))) {
+    pmsg_ext_error("cannot create image %s: %s\n", name, strerror(errno));
+    rc = -1;
+  }
+  while(size > 0) {
+    size_t n = fread(buf, 1, size < (long) sizeof buf? (size_t) size: sizeof buf, in);
+
+    if(!n) {
+      pmsg_error("connection closed while receiving image %s\n", name);
+      rc = -1;
+      break;
+    }
+    if(fp && fwrite(buf, 1, n, fp) != n)
+      rc = -1;
+    size -= n;
+  }
+  if(fp && fclose(fp))
+    rc = -1;
+
+  return rc;
+}
+
+// Send image name, eg, one that was written by a -U ...:r: job, back to the client
+static int serve_pull(FILE *out, const char *name) {
+  char buf[4096];
+  size_t n;
+  long size;
+  FILE *fp;
+
+  if(!serve_image_name_ok(name) || !(fp = fopen(name, "rb"))) {
+    pmsg_error("no image %s to send\n", name);
+    return -1;
+  }
+  if(fseek(fp, 0, SEEK_END) < 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) < 0) {
+    pmsg_ext_error("cannot determine size of image %s: %s\n", name, strerror(errno));
+    fclose(fp);
+    return -1;
+  }
+  fprintf(out, "%cdata %ld\n", SERVE_RS, size);
+  while(size > 0 && (n = fread(buf, 1, sizeof buf, fp)) > 0) {
+    fwrite(buf, 1, n, out);
+    size -= n;
+  }
+  while(size-- > 0)             // File shrank meanwhile: keep the announced length
+    putc(0, out);
+  fclose(fp);
+
+  return 0;
+}
+
+// Remove the image directory of a net server and all images in it
+static void serve_rmdir(const char *dir) {
+  DIR *dp = opendir(dir);
+  struct dirent *de;
+
+  if(dp) {
+    while((de = readdir(dp))) {
+      if(str_eq(de->d_name, ".") || str_eq(de->d_name, ".."))
+        continue;
+      char *fn = mmt_sprintf("%s/%s", dir, de->d_name);
+
+      unlink(fn);
+      mmt_free(fn);
+    }
+    closedir(dp);
+  }
+  rmdir(dir);
+}
+
+/*
+ * Keep the programmer open and serve jobs on a local socket or, if where is
+ * net:[<host>]:<port>, on a TCP port; every line a client sends is one job
+ * and is answered with ok or error <rc>
+ *   - init: re-initialise the target, eg, after the next board was connected
+ *   - -U <memstr>:r|w|v:<filename>[:format]: carry out the memory operation
+ *   - quit: stop serving and let avrdude exit
+ *   - -T <terminal cmd line> or any other line: run the terminal line
+ *
+ * A net server runs its jobs in a private image directory, so that a client
+ * on another host can push the input files of -U jobs first and pull the
+ * files of -U read jobs afterwards; then only the images and the job lines
+ * cross the network whilst the programmer protocol runs at local speed. Jobs
+ * of net servers cannot access files outside the image directory.
+ *   - push <name> <size>: the next <size> bytes are stored as image <name>
+ *   - pull <name>: send image <name> as data <size> line followed by its bytes
+ *
+ * All output of a net server job is sent to its client as it happens,
+ * including progress bars; so that the client can tell output from answers,
+ * these are sent as lines that start with an ASCII record separator 0x1e.
+ */
+static int serve_jobs(const PROGRAMMER *pgm, const AVRPART *p, const char *where, enum updateflags uflags) {
+  int net = str_starts(where, "net:"), sfd, running = 1, wrmem = 0, cwdfd = -1;
+  char imgdir[] = "/tmp/avrdude-serve-XXXXXX";
+
+  if((sfd = net? serve_listen_net(where + 4): serve_listen_local(where)) < 0)
+    return -1;
+  if(net) {
+    allow_subshells = 0;        // Whatever the configuration says: peers must not get a shell
+    signal(SIGPIPE, SIG_IGN);   // A client going away must not kill the server
+    if((cwdfd = open(".", O_RDONLY)) < 0 || !mkdtemp(imgdir) || chdir(imgdir) < 0) {
+      pmsg_ext_error("cannot create image directory %s: %s\n", imgdir, strerror(errno));
+      if(cwdfd >= 0)
+        close(cwdfd);
+      close(sfd);
+      return -1;
+    }
+  }
+  pmsg_info("serving jobs on %s\n", where);
+
+  while(running) {
+    int cfd = accept(sfd, NULL, NULL);
+
+    if(cfd < 0) {
+      if(errno == EINTR)
+        continue;
+      pmsg_ext_error("cannot accept connection on %s: %s\n", where, strerror(errno));
+      break;
+    }
+
+    FILE *in = fdopen(cfd, "r"), *out = fdopen(dup(cfd), "w");
+    const char *errstr;
+
+    if(!in || !out) {
+      pmsg_ext_error("cannot open stream for connection on %s: %s\n", where, strerror(errno));
+      if(in)
+        fclose(in);
+      else
+        close(cfd);
+      if(out)
+        fclose(out);
+      continue;
+    }
+
+    for(char *line; running && (line = str_fgets(in, &errstr)); mmt_free(line)) {
+      const char *job = str_trim(line);
+      int rc, sout = -1, serr = -1;
+      UPDATE *upd;
+
+      if(!*job || *job == '#')
+        continue;
+      if(net) {                 // Stream the output of the job to the client
+        fflush(stdout);
+        fflush(stderr);
+        sout = dup(STDOUT_FILENO);
+        serr = dup(STDERR_FILENO);
+        dup2(cfd, STDOUT_FILENO);
+        dup2(cfd, STDERR_FILENO);
+      }
+      if(str_eq(job, "quit")) {
+        running = 0;
+        rc = 0;
+      } else if(str_eq(job, "init")) { // Next target: forget cached contents of the previous one
+        pgm->reset_cache(pgm, p);
+        wrmem = 0;
+        if((rc = pgm->initialize(pgm, p)) < 0)
+          pmsg_error("initialization failed  (rc = %d)\n", rc);
+      } else if(net && str_starts(job, "push ")) {
+        char name[256];
+        long size;
+
+        if(sscanf(job + 5, "%255s %ld", name, &size) != 2) {
+          pmsg_error("unable to parse %s\n", job);
+          rc = -1;
+          running = 0;          // Cannot tell where the image ends
+        } else
+          rc = serve_push(in, name, size);
+      } else if(net && str_starts(job, "pull ")) {
+        rc = serve_pull(out, str_ltrim(job + 5));
+      } else if(str_starts(job, "-U")) {
+        if(!(upd = parse_op(str_ltrim(job + 2)))) {
+          pmsg_error("unable to parse update operation %s\n", str_ltrim(job + 2));
+          rc = -1;
+        } else if(net && !serve_job_ok(job, upd)) {
+          free_update(upd);
+          rc = -1;
+        } else {
+          if(!upd->memstr)
+            upd->memstr = mmt_strdup(is_pdi(p)? "application": "flash");
+          pgm->flush_cache(pgm, p);
+          wrmem |= upd->op == DEVICE_WRITE;
+          rc = update_dryrun(p, upd);
+          if(!rc || rc == LIBAVRDUDE_SOFTFAIL)
+            rc = do_op(pgm, p, upd, uflags | UF_NOHEADING);
+          free_update(upd);
+        }
+      } else if(net && !serve_job_ok(job, NULL)) {
+        rc = -1;
+      } else {
+        if(wrmem) {             // Invalidate cache if device was written to
+          wrmem = 0;
+          pgm->reset_cache(pgm, p);
+        }
+        rc = terminal_line(pgm, p, str_starts(job, "-T")? str_ltrim(job + 2): job);
+        if(rc > 0)              // Terminal quit only flushes the cache
+          rc = 0;
+      }
+      if(net) {
+        fflush(stdout);
+        fflush(stderr);
+        dup2(sout, STDOUT_FILENO);
+        dup2(serr, STDERR_FILENO);
+        close(sout);
+        close(serr);
+        putc(SERVE_RS, out);
+      }
+      if(rc < 0 && rc != LIBAVRDUDE_SOFTFAIL)
+        fprintf(out, "error %d\n", rc);
+      else
+        fprintf(out, "ok\n");
+      fflush(out);
+    }
+    fclose(in);
+    fclose(out);
+  }
+  pgm->flush_cache(pgm, p);
+  close(sfd);
+  if(net) {
+    if(fchdir(cwdfd) < 0)
+      pmsg_ext_error("cannot return to working directory: %s\n", strerror(errno));
+    close(cwdfd);
+    serve_rmdir(imgdir);
+  } else
+    unlink(where);
+
+  return running? -1: 0;
+}
+
+/*
+ * Wait for the answer of a net server to a job, relaying the job output to
+ * stderr; returns the rc of the job or -1 if the connection was lost. Data
+ * of a pull job are stored in *datap and *lenp unless datap is NULL.
+ */
+static int remote_answer(FILE *in, char **datap, size_t *lenp) {
+  const char *errstr;
+  char *line;
+  int c, rc;
+
+  while((c = getc(in)) != EOF) {
+    if(c != SERVE_RS) {
+      putc(c, stderr);
+      continue;
+    }
+    if(!(line = str_fgets(in, &errstr)))
+      break;
+
+    long size;
+
+    if(sscanf(line, "data %ld", &size) == 1 && size >= 0) {
+      char *data = mmt_malloc(size + 1);
+
+      if(fread(data, 1, size, in) != (size_t) size) {
+        mmt_free(data);
+        mmt_free(line);
+        break;
+      }
+      if(datap) {
+        mmt_free(*datap);
+        *datap = data;
+        *lenp = size;
+      } else
+        mmt_free(data);
+      mmt_free(line);
+      continue;
+    }
+    rc = str_starts(line, "ok")? 0: sscanf(line, "error %d", &rc) == 1? rc: -1;
+    mmt_free(line);
+    return rc;
+  }
+  fflush(stderr);
+  pmsg_error("lost connection to avrdude server\n");
+
+  return -1;
+}
+
+// Push file fn to the server as image name
+static int remote_push(FILE *in, FILE *out, const char *fn, const char *name) {
+  FILE *fp = str_eq(fn, "-")? stdin: fopen(fn, "rb");
+  char *data = NULL;
+  size_t len = 0, n;
+
+  if(!fp) {
+    pmsg_ext_error("cannot open %s: %s\n", fn, strerror(errno));
+    return -1;
+  }
+  do {
+    data = mmt_realloc(data, len + 4096);
+    len += (n = fread(data + len, 1, 4096, fp));
+  } while(n > 0);
+  if(fp != stdin)
+    fclose(fp);
+  fprintf(out, "push %s %lu\n", name, (unsigned long) len);
+  fwrite(data, 1, len, out);
+  fflush(out);
+  mmt_free(data);
+
+  return remote_answer(in, NULL, NULL);
+}
+
+// Name under which a local file is pushed to or pulled from the server
+static char *remote_image_name(const char *fn) {
+  const char *base = str_eq(fn, "-")? "stdio": strrchr(fn, '/')? strrchr(fn, '/') + 1: fn;
+  char *name = mmt_sprintf("%s", *base && *base != '.'? base: "image");
+
+  for(char *s = name; *s; s++)
+    if(*s == ':' || isspace(*s & 0xff))
+      *s = '_';
+
+  return name;
+}
+
+/*
+ * Run the -e, -U and -T options of the command line on the avrdude server
+ * at <host>:<port> that was started with --serve net:[<host>]:<port>;
+ * input files of -U operations are pushed to the server and files of -U
+ * read operations are pulled back, so only these and the job lines cross
+ * the network. Returns the exit code for avrdude.
+ */
+static int remote_jobs(const char *address, LISTID updates, int erase) {
+  union filedescriptor fd;
+  union pinfo pinfo = {.serialinfo = {.baud = 0, .cflags = 0 } };
+  char *addr = mmt_sprintf("net:%s", address);
+  int rc = -1;
+
+  signal(SIGPIPE, SIG_IGN);
+  if(serial_serdev.open(addr, pinfo, &fd) < 0) {
+    mmt_free(addr);
+    return 1;
+  }
+  mmt_free(addr);
+  // The serial layer made the socket non-blocking, but stdio streams need it blocking
+  fcntl(fd.ifd, F_SETFL, fcntl(fd.ifd, F_GETFL) & ~O_NONBLOCK);
+
+  FILE *in = fdopen(fd.ifd, "r"), *out = fdopen(dup(fd.ifd), "w");
+
+  if(!in || !out) {
+    pmsg_ext_error("cannot open stream to avrdude server: %s\n", strerror(errno));
+    goto done;
+  }
+  if(erase) {
+    fprintf(out, "erase\n");
+    fflush(out);
+    if((rc = remote_answer(in, NULL, NULL)) < 0)
+      goto done;
+  }
+  rc = 0;
+  for(LNODEID ln = lfirst(updates); ln && rc >= 0; ln = lnext(ln)) {
+    const UPDATE *upd = ldata(ln);
+
+    if(upd->cmdline) {
+      fprintf(out, "-T %s\n", upd->cmdline);
+      fflush(out);
+      rc = remote_answer(in, NULL, NULL);
+      continue;
+    }
+
+    int is_file = upd->format != FMT_IMM && !is_generated_fname(upd->filename);
+    char *name = is_file? remote_image_name(upd->filename): mmt_strdup(upd->filename);
+    char *data = NULL;
+    size_t len = 0;
+
+    if(is_file && upd->op != DEVICE_READ)
+      rc = remote_push(in, out, upd->filename, name);
+    if(rc >= 0) {
+      if(upd->memstr)
+        fprintf(out, "-U %s:%c:%s:%c\n", upd->memstr, upd->op == DEVICE_READ? 'r': upd->op == DEVICE_WRITE? 'w': 'v',
+          name, fileio_fmtchr(upd->format));
+      else
+        fprintf(out, "-U %s:%c\n", name, fileio_fmtchr(upd->format));
+      fflush(out);
+      rc = remote_answer(in, NULL, NULL);
+    }
+    if(rc >= 0 && is_file && upd->op == DEVICE_READ) {
+      fprintf(out, "pull %s\n", name);
+      fflush(out);
+      if((rc = remote_answer(in, &data, &len)) >= 0) {
+        FILE *fp = str_eq(upd->filename, "-")? stdout: fopen(upd->filename, "wb");
+
+        if(!fp || fwrite(data, 1, len, fp) != len) {
+          pmsg_ext_error("cannot write %s: %s\n", upd->filename, strerror(errno));
+          rc = -1;
+        }
+        if(fp && fp != stdout)
+          fclose(fp);
+      }
+    }
+    mmt_free(data);
+    mmt_free(name);
+  }
+
+done:
+  if(in)
+    fclose(in);
+  else
+    close(fd.ifd);
+  if(out)
+    fclose(out);
+
+  return rc < 0 && rc != LIBAVRDUDE_SOFTFAIL;
+}
+#endif
+
+/*
+ * Production job file given with --job <file>: one directive per line, lines
+ * starting with # are comments
+ *   - write <memlist> <file>[:<format>]: same as -U <memlist>:w:<file>[:<format>]
+ *   - fuse <fuse> <value>: write a fuse value, eg, fuse hfuse 0xd9
+ *   - lock <value>: write the lock byte
+ *   - patch <mem> <addr> <data>: overlay data (numbers or strings as for the
+ *     terminal write command) onto the image of the job's write to <mem>, or
+ *     write them with the terminal if the job does not write <mem>
+ *   - serial <mem> <addr> <template>: patch the serial number of each unit,
+ *     where <template> is the data with one %u, %x or %X conversion for the
+ *     serial number, eg, "SN%06u" for a string or %uL for a 4-byte number
+ *   - serial-start <n>: serial number of the first unit (default 1)
+ *   - serial-file <file>: file that keeps the next serial number across runs
+ *     and gang workers; it takes precedence over serial-start once it exists
+ *   - erase auto|yes|no|differential: auto-erase, chip erase as with -e, none
+ *     as with -D or only pages that differ as with --differential
+ *   - verify yes|no: verify writes or not as with -V
+ *   - units <n>: program n units one after another, 0 for until end of stdin
+ *   - -U ... and -T ...: as on the command line
+ * The writes and -U/-T lines are carried out in the order of the job file,
+ * followed by terminal writes of patches, the fuses and lastly the lock byte, so that
+ * neither fuses nor lock bits can get in the way of writing and verifying the
+ * memories. The chip is erased at most once per unit.
+ */
+typedef struct {
+  const char *name;             // Job file, NULL if none was given
+  LISTID upds;                  // The job's operations in the order they are carried out
+  int units;                    // Number of units, 0 for until end of stdin
+  int erase, verify;            // -1: as by command line, 0: no, 1: yes; erase 2: auto, 3: differential
+  UPDATE *serial;               // Write that carries the serial number or NULL
+  char *sermem, *seraddr;       // Memory and address of the serial number
+  char *serfmt;                 // printf format of its data
+  char *serbuf;                 // Command line buffer if serial is a terminal write
+  size_t serlen;                // Size of serbuf
+  char *serbase;                // Patch of the serial's file write without the serial number
+  unsigned long sernext;        // Next serial number unless there is a serial file
+  const char *serfile;          // File keeping the next serial number
+} Job;
+
+static Job job = {.units = 1, .erase = -1, .verify = -1, .sernext = 1};
+
+// Return serial template as printf format for an unsigned long; NULL if it has not exactly one conversion
+static char *job_serial_format(const char *tpl) {
+  const char *conv = NULL, *t;
+  char *ret;
+
+  for(const char *s = tpl; *s; s++) {
+    if(*s != '%')
+      continue;
+    if(s[1] == '%') {
+      s++;
+      continue;
+    }
+    t = s + 1 + (s[1] == '0');
+    if(isdigit(*t & 0xff) && isdigit(t[1] & 0xff))
+      t += 2;                   // At most two width digits
+    else if(isdigit(*t & 0xff))
+      t++;
+    if(conv || !*t || !strchr("uxX", *t))
+      return NULL;
+    s = conv = t;
+  }
+  if(!conv)
+    return NULL;
+  ret = mmt_malloc(strlen(tpl) + 2);
+  memcpy(ret, tpl, conv - tpl);
+  ret[conv - tpl] = 'l';
+  strcpy(ret + (conv - tpl) + 1, conv);
+
+  return ret;
+}
+
+// Last file write of the job to memory mstr or NULL
+static UPDATE *job_write(LISTID writes, const char *mstr) {
+  UPDATE *ret = NULL;
+
+  for(LNODEID ln = lfirst(writes); ln; ln = lnext(ln)) {
+    UPDATE *upd = ldata(ln);
+
+    if(!upd->cmdline && upd->op == DEVICE_WRITE && upd->memstr && str_eq(upd->memstr, mstr))
+      ret = upd;
+  }
+
+  return ret;
+}
+
+// Read job file and add its operations to the update list in planned order
+static int load_job(const char *path) {
+  FILE *f;
+  LISTID plan[4];               // Writes and -U/-T lines in file order, terminal patches, fuses, lock
+  LISTID patches;               // Patch directives as "<mem> <addr> <data>"
+  const char *errstr = NULL;
+  int lno = 0, ret = 0;
+
+  if(job.name) {
+    pmsg_error("only one --job file can be given\n");
+    return -1;
+  }
+  if(!(f = fopen(path, "r"))) {
+    pmsg_ext_error("cannot open job file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  job.name = path;
+  job.upds = lcreat(NULL, 0);
+  patches = lcreat(NULL, 0);
+  for(int i = 0; i < 4; i++)
+    plan[i] = lcreat(NULL, 0);
+
+  for(char *line; (line = str_fgets(f, &errstr)); mmt_free(line)) {
+    char *rest = str_trim(line), *key, *arg, *arg2, *op = NULL;
+    UPDATE *upd = NULL;
+    int cat = 0;
+
+    lno++;
+    if(!*rest || *rest == '#')
+      continue;
+    key = str_nexttok(rest, " \t", &rest);
+    if(str_eq(key, "write") || str_eq(key, "fuse")) {
+      arg = str_nexttok(rest, " \t", &rest);
+      if(*arg && *rest)
+        op = str_eq(key, "write")? mmt_sprintf("%s:w:%s", arg, rest): mmt_sprintf("%s:w:%s:m", arg, rest);
+      cat = *key == 'w'? 0: 2;
+    } else if(str_eq(key, "lock")) {
+      if(*rest)
+        op = mmt_sprintf("lock:w:%s:m", rest);
+      cat = 3;
+    } else if(str_eq(key, "-U")) {
+      if(*rest)
+        op = mmt_strdup(rest);
+    } else if(str_eq(key, "-T")) {
+      if(*rest)
+        upd = cmd_update(mmt_strdup(rest));
+    } else if(str_eq(key, "serial")) {
+      arg = str_nexttok(rest, " \t", &rest);
+      arg2 = str_nexttok(rest, " \t", &rest);
+      if(job.serfmt) {
+        pmsg_error("%s:%d: only one serial directive is allowed\n", path, lno);
+        ret = -1;
+        continue;
+      } else if(!*arg || !*arg2 || !*rest || !(job.serfmt = job_serial_format(rest))) {
+        pmsg_error("%s:%d: use serial <mem> <addr> <template> with one %%u, %%x or %%X in <template>\n",
+          path, lno);
+        ret = -1;
+        continue;
+      }
+      job.sermem = mmt_strdup(arg);
+      job.seraddr = mmt_strdup(arg2);
+      continue;                 // Attached to its memory's write once all writes are known
+    } else if(str_eq(key, "patch")) {
+      arg = str_nexttok(rest, " \t", &rest);
+      if(!*arg || !*rest) {
+        pmsg_error("%s:%d: use patch <mem> <addr> <data>\n", path, lno);
+        ret = -1;
+      } else
+        ladd(patches, mmt_sprintf("%s %s", arg, rest));
+      continue;
+    } else if(str_eq(key, "serial-start")) {
+      job.sernext = str_int(rest, STR_UINT32, &errstr);
+      if(errstr) {
+        pmsg_error("%s:%d: invalid serial-start %s: %s\n", path, lno, rest, errstr);
+        ret = -1;
+      }
+      errstr = NULL;
+      continue;
+    } else if(str_eq(key, "serial-file") && *rest) {
+      job.serfile = mmt_strdup(rest);
+      continue;
+    } else if(str_eq(key, "erase") || str_eq(key, "verify")) {
+      int val = str_eq(rest, "yes")? 1: str_eq(rest, "no")? 0: *key != 'e'? -1:
+        str_eq(rest, "auto")? 2: str_eq(rest, "differential")? 3: -1;
+
+      if(val < 0) {
+        pmsg_error("%s:%d: use %s %s\n", path, lno, key, *key == 'e'? "auto|yes|no|differential": "yes|no");
+        ret = -1;
+      }
+      *(*key == 'e'? &job.erase: &job.verify) = val;
+      continue;
+    } else if(str_eq(key, "units")) {
+      job.units = str_int(rest, STR_INT32, &errstr);
+      if(errstr || job.units < 0) {
+        pmsg_error("%s:%d: invalid number of units %s%s%s\n", path, lno, rest, errstr? ": ": "", errstr? errstr: "");
+        ret = -1;
+      }
+      errstr = NULL;
+      continue;
+    } else {
+      pmsg_error("%s:%d: unknown job directive %s\n", path, lno, key);
+      ret = -1;
+      continue;
+    }
+
+    if(op) {
+      if(!(upd = parse_op(op)))
+        pmsg_error("%s:%d: unable to parse update operation %s\n", path, lno, op);
+      mmt_free(op);
+    } else if(!upd)
+      pmsg_error("%s:%d: missing argument for %s\n", path, lno, key);
+    if(!upd)
+      ret = -1;
+    else if(!ret)
+      ladd(plan[cat], upd);
+  }
+  if(errstr) {
+    pmsg_error("cannot read job file %s: %s\n", path, errstr);
+    ret = -1;
+  }
+  fclose(f);
+
+  // Overlay patches and the serial number onto the images of the job's writes
+  for(LNODEID ln = lfirst(patches); ln; ln = lnext(ln)) {
+    char *rest, *mem = str_nexttok(ldata(ln), " \t", &rest);
+    UPDATE *w = job_write(plan[0], mem);
+
+    if(w) {
+      char *patch = w->patch? mmt_sprintf("%s; %s", w->patch, rest): mmt_strdup(rest);
+
+      mmt_free(w->patch);
+      w->patch = patch;
+    } else
+      ladd(plan[1], cmd_update(mmt_sprintf("write %s %s", mem, rest)));
+  }
+  ldestroy_cb(patches, mmt_f_free);
+  if(job.serfmt) {
+    if((job.serial = job_write(plan[0], job.sermem))) {
+      job.serbase = job.serial->patch? mmt_strdup(job.serial->patch): NULL;
+    } else {                    // Terminal write with room for width and digits of the serial number
+      job.serlen = strlen(job.sermem) + strlen(job.seraddr) + strlen(job.serfmt) + 128;
+      job.serbuf = mmt_malloc(job.serlen);
+      snprintf(job.serbuf, job.serlen, "write %s %s 0", job.sermem, job.seraddr);       // Until first unit
+      ladd(plan[1], job.serial = cmd_update(job.serbuf));
+    }
+  }
+
+  for(int i = 0; i < 4; i++) {
+    for(LNODEID ln = lfirst(plan[i]); ln; ln = lnext(ln)) {
+      ladd(updates, ldata(ln));
+      ladd(job.upds, ldata(ln));
+    }
+    ldestroy(plan[i]);
+  }
+  if(!ret)
+    pmsg_notice("job %s has %d operation%s for %d unit%s\n", path, lsize(job.upds), str_plural(lsize(job.upds)),
+      job.units, str_plural(job.units));
+
+  return ret;
+}
+
+/*
+ * Parse the input files of the job once before any programming, so all units
+ * and gang workers reuse the parsed contents
+ */
+static int job_preload(const AVRPART *p) {
+  for(LNODEID ln = lfirst(job.upds); ln; ln = lnext(ln)) {
+    UPDATE *upd = ldata(ln);
+
+    if(upd->cmdline || !upd->memstr || upd->op == DEVICE_READ || upd->format == FMT_IMM ||
+      !update_is_readable(upd->filename))
+      continue;                 // No file to parse or update_dryrun() reports the problem
+    if(upd->format == FMT_AUTO && !str_eq(upd->filename, "-")) {
+      int format = fileio_fmt_autodetect(upd->filename);
+
+      if(format < 0)
+        continue;
+      upd->format = format;
+    }
+    if(update_preload(p, upd) < 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+// Allocate the serial number of the next unit and set the update's terminal line accordingly
+static int job_next_serial(void) {
+  unsigned long sn = job.sernext;
+
+  if(!job.serial)
+    return 0;
+  if(job.serfile) {
+    int fd = open(job.serfile, O_RDWR | O_CREAT, 0644);
+    FILE *f = fd < 0? NULL: fdopen(fd, "r+");
+
+    if(!f) {
+      pmsg_ext_error("cannot open serial file %s: %s\n", job.serfile, strerror(errno));
+      if(fd >= 0)
+        close(fd);
+      return -1;
+    }
+#if !defined(WIN32)
+    if(lockf(fd, F_LOCK, 0) < 0)  // Gang workers take turns
+      pmsg_warning("cannot lock serial file %s: %s\n", job.serfile, strerror(errno));
+#endif
+    if(fscanf(f, "%lu", &sn) != 1)
+      sn = job.sernext;         // New file
+    rewind(f);
+    if(fprintf(f, "%lu\n", sn + 1) < 0 || fflush(f) == EOF) {
+      pmsg_ext_error("cannot update serial file %s: %s\n", job.serfile, strerror(errno));
+      fclose(f);
+      return -1;
+    }
+    fclose(f);                  // Also releases the lock
+  }
+  job.sernext = sn + 1;
+
+  char *data = mmt_sprintf(job.serfmt, sn);
+
+  if(job.serial->cmdline) {
+    snprintf(job.serbuf, job.serlen, "write %s %s %s", job.sermem, job.seraddr, data);
+  } else {
+    mmt_free(job.serial->patch);
+    job.serial->patch = job.serbase? mmt_sprintf("%s; %s %s", job.serbase, job.seraddr, data):
+      mmt_sprintf("%s %s", job.seraddr, data);
+  }
+  mmt_free(data);
+  pmsg_info("serial number of this unit is %lu\n", sn);
+
+  return 0;
+}
+
+// Carry out the -t, -T and -U operations in turn; return 1 if one failed and 0 otherwise
+static int run_updates(const PROGRAMMER *pgm, const AVRPART *p, enum updateflags uflags, int *ce_delayed) {
+  int wrmem = 0, terminal = 0, rc, ret = 0;
+  UPDATE *upd;
+
+  Update_prefetch *pf = NULL;
+
+  if(lsize(updates) <= 1)
+    uflags |= UF_NOHEADING;
+  for(LNODEID ln = lfirst(updates); ln; ln = lnext(ln)) {
+    const AVRMEM *m;
+
+    upd = ldata(ln);
+    update_prefetch_finish(pf);
+    pf = NULL;
+    // Consecutive writes of single fuses are carried out as one group
+    int ngroup = 0;
+    LNODEID last = ln;
+
+    if(!(uflags & UF_NOWRITE) && !is_spm(pgm))
+      for(LNODEID lg = ln; lg && update_is_fuse_write(p, ldata(lg)); lg = lnext(lg))
+        ngroup++, last = lg;
+    if(ngroup < 2)
+      last = ln;
+    // Parse the next input file while the device is busy unless this operation might write that file
+    UPDATE *next = lnext(last)? ldata(lnext(last)): NULL;
+
+    if(next && !upd->cmdline && !(upd->op == DEVICE_READ && str_eq(upd->filename, next->filename)))
+      pf = update_prefetch(p, next);
+    if(upd->cmdline && wrmem) { // Invalidate cache if device was written to
+      wrmem = 0;
+      pgm->reset_cache(pgm, p);
+    } else if(!upd->cmdline) {  // Flush cache before any device memory access
+      pgm->flush_cache(pgm, p);
+      wrmem |= upd->op == DEVICE_WRITE;
+    }
+    if((uflags & UF_NOWRITE) && upd->cmdline && !terminal++)
+      pmsg_warning("the terminal ignores option -n, that is, it writes to the device\n");
+    if(ngroup > 1) {
+      UPDATE **group = mmt_malloc(ngroup*sizeof *group);
+      LNODEID lg = ln;
+
+      for(int i = 0; i < ngroup; i++, lg = lnext(lg))
+        group[i] = ldata(lg);
+      ln = last;
+      rc = do_fuse_group(pgm, p, group, ngroup, uflags);
+      mmt_free(group);
+    } else
+      rc = do_op(pgm, p, upd, uflags);
+    if(rc && rc != LIBAVRDUDE_SOFTFAIL) {
+      ret = 1;
+      break;
+    } else if(rc == 0 && upd->op == DEVICE_WRITE && (m = avr_locate_mem(p, upd->memstr)) && mem_is_in_flash(m))
+      *ce_delayed = 0;          // Redeemed chip erase promise
+  }
+  update_prefetch_finish(pf);
+  pgm->flush_cache(pgm, p);
+
+  return ret;
+}
+
+// Wait until the USB programmer has been unplugged and plugged in again, then reopen it
+static int job_replug(PROGRAMMER *pgm, const AVRPART *p, const char *port, int *is_openp) {
+  int rc;
+
+  if(*is_openp) {
+    led_set(pgm, LED_END);
+    pgm->powerdown(pgm);
+    pgm->disable(pgm);
+    pgm->close(pgm);
+    *is_openp = 0;
+  }
+  if(usb_hotplug_wait(0, -1) < 0 || usb_hotplug_wait(1, -1) < 0)
+    return LIBAVRDUDE_EXIT_FAIL;
+  usleep(250*1000);             // Give the OS time to set up the device
+  if((rc = pgm->open(pgm, port)) < 0) {
+    pmsg_error("unable to reopen port %s for programmer %s\n", port, pgmid);
+    return rc;
+  }
+  *is_openp = 1;
+  pgm->enable(pgm, p);
+
+  return 0;
+}
+
+/*
+ * Program the remaining units of a job: wait for the operator to connect the
+ * next unit and to press enter (or, with --hotplug, to re-plug the USB
+ * programmer), then initialise it, erase it if the first unit was erased and
+ * carry out the same operations with the images parsed before; returns 1 if
+ * any unit failed and 0 otherwise
+ */
+static int job_units(PROGRAMMER *pgm, const AVRPART *p, const char *port, int hotplug, int *is_openp,
+  enum updateflags uflags, int erase, int exitrc, int *ce_delayed) {
+
+  int nok = !exitrc, nfail = !!exitrc, unit, rc;
+
+  if(job.units == 1)
+    return exitrc;
+#if !defined(WIN32)
+  if(gang_programming) {
+    pmsg_warning("gang programming one unit per port; ignoring units %d of job %s\n", job.units, job.name);
+    return exitrc;
+  }
+#endif
+
+  for(unit = 2; !job.units || unit <= job.units; unit++) {
+    const char *errstr;
+    char *line;
+
+    msg_info("\n");
+    if(hotplug) {
+      pmsg_info("unplug the programmer and plug it into unit %d\n", unit);
+      if((rc = job_replug(pgm, p, port, is_openp)) == LIBAVRDUDE_EXIT_FAIL)
+        break;
+      if(rc < 0) {
+        nfail++;
+        continue;
+      }
+    } else {
+      pmsg_info("connect unit %d and press enter (end of input stops)\n", unit);
+      if(!(line = str_fgets(stdin, &errstr)))
+        break;
+      mmt_free(line);
+    }
+
+    pgm->reset_cache(pgm, p);
+    if((rc = pgm->initialize(pgm, p)) < 0) {
+      pmsg_error("initialization of unit %d failed (rc = %d)\n", unit, rc);
+      nfail++;
+      continue;
+    }
+    if(erase && !(uflags & UF_NOWRITE)) {
+      rc = avr_chip_erase(pgm, p);
+      if(rc == LIBAVRDUDE_SOFTFAIL) {
+        *ce_delayed = 1;
+      } else if(rc) {
+        pmsg_error("chip erase of unit %d failed\n", unit);
+        nfail++;
+        continue;
+      }
+    }
+    if(job_next_serial() < 0 || run_updates(pgm, p, uflags, ce_delayed))
+      nfail++;
+    else
+      nok++;
+  }
+
+  msg_info("\n");
+  pmsg_info("job %s: %d unit%s OK, %d failed\n", job.name, nok, str_plural(nok), nfail);
+
+  return nfail > 0;
+}
+
+// Does the target work at SCK period t (in s)? Re-initialise and compare signature and sample
+static int sck_period_ok(PROGRAMMER *pgm, const AVRPART *p, double t, const AVRMEM *sig,
+  const unsigned char *sigref, const AVRMEM *mem, const unsigned char *ref, unsigned char *buf, int len) {
+
+  pgm->bitclock = t;
+  if(pgm->set_sck_period(pgm, t) < 0 || pgm->initialize(pgm, p) < 0)
+    return 0;
+  if(avr_signature(pgm, p) < 0 || memcmp(sig->buf, sigref, sig->size))
+    return 0;
+  if(mem && (avr_read_page_default(pgm, p, mem, 0, buf) < 0 || memcmp(buf, ref, len)))
+    return 0;
+
+  return 1;
+}
+
+/*
+ * Binary search for the shortest SCK period at which the signature and the
+ * first flash page read back the same as at the current (slow) period, then
+ * settle on twice that period as safety margin; returns the period in s, 0 if
+ * the programmer cannot tune its clock or -1 if the target stopped responding
+ */
+static double autotune_bitclock(PROGRAMMER *pgm, const AVRPART *p) {
+  const AVRMEM *sig = avr_locate_signature(p), *mem = avr_locate_flash(p);
+  unsigned char sigref[16], *ref = NULL, *buf = NULL;
+  int len = 0, ok, trials = 0, quell = quell_progress;
+  double lo = 0.0625e-6, hi = 0, slow, best;
+
+  if(!pgm->set_sck_period || !(pgm->extra_features & HAS_BITCLOCK_ADJ) || is_spm(pgm)) {
+    pmsg_warning("programmer %s cannot adjust its bit clock; ignoring -B auto\n", pgmid);
+    return 0;
+  }
+  if(!sig || sig->size > (int) sizeof sigref) {
+    pmsg_warning("no signature memory for %s; ignoring -B auto\n", p->desc);
+    return 0;
+  }
+  if(!pgm->get_sck_period || pgm->get_sck_period(pgm, &hi) < 0 || hi <= 0)
+    hi = pgm->bitclock > 0? pgm->bitclock: 8e-6;
+  if((slow = hi) <= lo)
+    return hi;
+
+  memcpy(sigref, sig->buf, sig->size);
+  if(mem && (len = mem->paged && mem->page_size > 0? mem->page_size: 0) > 0) {
+    ref = mmt_malloc(len);
+    buf = mmt_malloc(len);
+    if(avr_read_page_default(pgm, p, mem, 0, ref) < 0)
+      mem = NULL;
+  } else
+    mem = NULL;
+
+  // Period found earlier for this target? Revalidate with a single trial
+  char sighex[2*sizeof sigref + 1];
+  const char *cached = tgtcache_get("sck");
+  double t;
+  int n;
+
+  for(int i = 0; i < sig->size; i++)
+    sprintf(sighex + 2*i, "%02x", sigref[i]);
+  if(cached && str_starts(cached, sighex) && cached[2*sig->size] == ' ' &&
+    sscanf(cached + 2*sig->size, "%lf%n", &t, &n) == 1 && !cached[2*sig->size + n] && t > 0 && t <= slow) {
+
+    quell_progress = verbose + 5;
+    ok = sck_period_ok(pgm, p, t, sig, sigref, mem, ref, buf, len);
+    quell_progress = quell;
+    if(ok) {
+      pmsg_notice("cached bit clock period %.3f us still works\n", t*1e6);
+      mmt_free(ref);
+      mmt_free(buf);
+      return t;
+    }
+    pmsg_notice("cached bit clock period %.3f us no longer works\n", t*1e6);
+  }
+
+  pmsg_notice("auto-tuning bit clock period between %.3f us and %.3f us\n", lo*1e6, hi*1e6);
+  quell_progress = verbose + 5; // Candidates that are too fast are expected to fail: keep quiet
+  best = hi;
+  while(hi - lo > hi/8 && trials++ < 12) {
+    double mid = (lo + hi)/2;
+
+    ok = sck_period_ok(pgm, p, mid, sig, sigref, mem, ref, buf, len);
+    quell_progress = quell;
+    pmsg_debug("bit clock period %.3f us %s\n", mid*1e6, ok? "works": "fails");
+    quell_progress = verbose + 5;
+    if(ok)
+      best = hi = mid;
+    else
+      lo = mid;
+  }
+
+  // Apply safety factor without becoming slower than the period we started with
+  best = 2*best < slow? 2*best: slow;
+  ok = sck_period_ok(pgm, p, best, sig, sigref, mem, ref, buf, len);
+  if(!ok && best < slow)
+    ok = sck_period_ok(pgm, p, best = slow, sig, sigref, mem, ref, buf, len);
+  quell_progress = quell;
+  if(!ok)
+    best = -1;
+  else {
+    char *val = mmt_sprintf("%s %.9g", sighex, best);
+
+    tgtcache_put("sck", val);
+    mmt_free(val);
+  }
+  mmt_free(ref);
+  mmt_free(buf);
+
+  return best;
+}
+
 // Potentially shorten copy of prog description if it's the suggested mode
 static void pmshorten(char *desc, const char *modes) {
   struct {
@@ -464,6 +1607,499 @@ static void list_parts(FILE *f, const char *prefix, LISTID avrparts, int pm) {
   }
 }
 
+#if !defined(WIN32)
+
+/*
+ * Add port to list; a device file port with wildcards is expanded to all
+ * matching device files, whereas usb:<pattern> ports are kept for
+ * gang_expand_usb(); returns whether the port has wildcards
+ */
+static int gang_add_port(LISTID ports, const char *port) {
+  int wild = !!strpbrk(port, "*?[");
+  glob_t gl;
+
+  if(wild && *port == '/' && glob(port, 0, NULL, &gl) == 0) {
+    for(size_t i = 0; i < gl.gl_pathc; i++)
+      ladd(ports, mmt_strdup(gl.gl_pathv[i]));
+    globfree(&gl);
+  } else
+    ladd(ports, mmt_strdup(port));
+
+  return wild;
+}
+
+#if defined(__linux__)
+// Read hexadecimal number from sysfs file of USB device dev; returns -1 on error
+static int gang_usb_id(const char *dev, const char *file) {
+  char *fn = mmt_sprintf("/sys/bus/usb/devices/%s/%s", dev, file);
+  FILE *f = fopen(fn, "r");
+  int ret = -1;
+
+  if(f) {
+    if(fscanf(f, "%x", (unsigned int *) &ret) != 1)
+      ret = -1;
+    fclose(f);
+  }
+  mmt_free(fn);
+
+  return ret;
+}
+#endif
+
+/*
+ * Replace each usb:<pattern> port of the list with usb:<serialno> ports of
+ * the USB devices of the programmer's vendor and product IDs whose serial
+ * number matches the pattern; the devices are looked up in sysfs, so this
+ * only works on Linux
+ */
+static LISTID gang_expand_usb(LISTID ports, const PROGRAMMER *pgm) {
+  LISTID ret = lcreat(NULL, 0);
+
+  for(LNODEID ln = lfirst(ports); ln; ln = lnext(ln)) {
+    char *port = ldata(ln);
+    int n = 0;
+
+    if(!str_starts(port, "usb:") || !strpbrk(port, "*?[")) {
+      ladd(ret, mmt_strdup(port));
+      continue;
+    }
+#if defined(__linux__)
+    DIR *dir = opendir("/sys/bus/usb/devices");
+    struct dirent *de;
+    char buf[256];
+
+    while(dir && (de = readdir(dir))) {
+      int vid = gang_usb_id(de->d_name, "idVendor"), pid = gang_usb_id(de->d_name, "idProduct"), pidok = 0;
+
+      if(vid < 0 || (pgm->usbvid && vid != pgm->usbvid))
+        continue;
+      for(LNODEID pn = lfirst(pgm->usbpid); pn && !pidok; pn = lnext(pn))
+        pidok = *(int *) ldata(pn) == pid;
+      if(lsize(pgm->usbpid) && !pidok)
+        continue;
+
+      char *fn = mmt_sprintf("/sys/bus/usb/devices/%s/serial", de->d_name);
+      FILE *f = fopen(fn, "r");
+
+      if(f) {
+        if(fgets(buf, sizeof buf, f)) {
+          buf[strcspn(buf, "\r\n")] = 0;
+          if(*buf && fnmatch(port + 4, buf, 0) == 0)
+            ladd(ret, mmt_sprintf("usb:%s", buf)), n++;
+        }
+        fclose(f);
+      }
+      mmt_free(fn);
+    }
+    if(dir)
+      closedir(dir);
+#endif
+    if(!n) {
+      pmsg_warning("no USB device of programmer %s matches -P %s\n", pgmid, port);
+      ladd(ret, mmt_strdup(port));
+    }
+  }
+  ldestroy_cb(ports, mmt_f_free);
+
+  return ret;
+}
+
+/*
+ * USB hub that the device behind port hangs off, eg, "1-2" or "usb1" for the
+ * root hub of bus 1; NULL if unknown. Full-speed devices behind the same hub
+ * share its transaction translator and thus its bandwidth. The topology is
+ * taken from sysfs, so this only works on Linux, for serial ports of USB
+ * devices and for -P usb:<serial>.
+ */
+static char *gang_usb_hub(const char *port) {
+#if defined(__linux__)
+  char *dev = NULL, *ret = NULL, *s, buf[PATH_MAX];
+
+  if(str_starts(port, "/dev/")) {
+    if(!realpath(port, buf))
+      return NULL;
+    char *sys = mmt_sprintf("/sys/class/tty/%s/device", strrchr(buf, '/') + 1);
+
+    if(realpath(sys, buf))
+      dev = mmt_strdup(buf);
+    mmt_free(sys);
+  } else if(str_starts(port, "usb:") && port[4]) {
+    char serno[64], *t = serno;
+    DIR *dir = opendir("/sys/bus/usb/devices");
+    struct dirent *de;
+
+    for(const char *p = port + 4; *p && t < serno + sizeof serno - 1; p++)
+      if(*p != ':')
+        *t++ = *p;
+    *t = 0;
+    while(dir && !dev && (de = readdir(dir))) {
+      char *fn = mmt_sprintf("/sys/bus/usb/devices/%s/serial", de->d_name);
+      FILE *f = fopen(fn, "r");
+
+      if(f) {
+        if(fgets(buf, sizeof buf, f)) {
+          int x;
+
+          buf[strcspn(buf, "\r\n")] = 0;
+          x = strlen(buf) - strlen(serno);
+          if(x >= 0 && str_caseeq(buf + x, serno)) {
+            mmt_free(fn);
+            fn = mmt_sprintf("/sys/bus/usb/devices/%s", de->d_name);
+            if(realpath(fn, buf))
+              dev = mmt_strdup(buf);
+          }
+        }
+        fclose(f);
+      }
+      mmt_free(fn);
+    }
+    if(dir)
+      closedir(dir);
+  }
+  if(!dev)
+    return NULL;
+
+  // Walk up to the USB device, eg, .../usb1/1-2/1-2.3 from .../1-2.3/1-2.3:1.0/ttyUSB0
+  while((s = strrchr(dev, '/')) && s > dev && (strchr(s, ':') || !strchr(s, '-')) && !str_starts(s, "/usb"))
+    *s = 0;
+  if((s = strrchr(dev, '/')) && strchr(s, '-')) {
+    char *d = strrchr(s, '.');
+
+    if(d)                       // Behind hub 1-2 for device 1-2.3
+      ret = mmt_sprintf("%.*s", (int) (d - s - 1), s + 1);
+    else                        // On root hub of bus 1 for device 1-2
+      ret = mmt_sprintf("usb%.*s", (int) strcspn(s + 1, "-"), s + 1);
+  }
+  mmt_free(dev);
+
+  return ret;
+#else
+  (void) port;
+  return NULL;
+#endif
+}
+
+// Shared between gang workers: bulk phases running per hub and the hub group of each worker
+static volatile int *gang_bulk;
+static int gang_worker = -1, gang_nworkers;
+
+#define gang_bulk_count(g) (gang_bulk + (g))                      // Per group
+#define gang_bulk_busy(i)  (gang_bulk + gang_nworkers + (i))      // Per worker
+#define gang_bulk_group(i) (gang_bulk[2*gang_nworkers + (i)])     // Group of worker, -1 if none
+
+// cx->avr_bulk_hook of gang workers: wait until fewer than gang_bulk_limit workers on the hub read back
+static void gang_bulk_hook(int begin) {
+  int g = gang_bulk_group(gang_worker);
+
+  if(g < 0)
+    return;
+  if(begin) {
+    for(int n, waited = 0; ; waited = 1) {
+      n = *gang_bulk_count(g);
+      if(n < gang_bulk_limit && __atomic_compare_exchange_n(gang_bulk_count(g), &n, n + 1, 0,
+          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        break;
+      if(!waited)
+        pmsg_notice2("waiting for USB bandwidth on the hub\n");
+      usleep(2*1000);
+    }
+    *gang_bulk_busy(gang_worker) = 1;
+  } else if(*gang_bulk_busy(gang_worker)) {
+    *gang_bulk_busy(gang_worker) = 0;
+    __atomic_fetch_sub(gang_bulk_count(g), 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+// Parent: release the bulk slot of a worker that has exited
+static void gang_bulk_reaped(int i) {
+  if(gang_bulk && gang_bulk_group(i) >= 0 && *gang_bulk_busy(i)) {
+    *gang_bulk_busy(i) = 0;
+    __atomic_fetch_sub(gang_bulk_count(gang_bulk_group(i)), 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+// Group ports by USB hub for --bulk-per-hub; a group is numbered after its first worker
+static void gang_bulk_setup(LISTID ports) {
+  int n = lsize(ports), i, j, ngrouped = 0;
+  char **hubs = mmt_malloc(n*sizeof *hubs);
+  LNODEID ln;
+
+  gang_nworkers = n;
+  gang_bulk = mmap(NULL, 3*n*sizeof *gang_bulk, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(gang_bulk == MAP_FAILED) {
+    pmsg_warning("cannot share bulk phase counters; ignoring --bulk-per-hub\n");
+    gang_bulk = NULL;
+    mmt_free(hubs);
+    return;
+  }
+  for(i = 0, ln = lfirst(ports); ln; i++, ln = lnext(ln)) {
+    hubs[i] = gang_usb_hub(ldata(ln));
+    *gang_bulk_count(i) = *gang_bulk_busy(i) = 0;
+    gang_bulk_group(i) = -1;
+    for(j = 0; hubs[i] && j <= i; j++)
+      if(hubs[j] && str_eq(hubs[i], hubs[j])) {
+        gang_bulk_group(i) = j;
+        break;
+      }
+    if(hubs[i]) {
+      ngrouped++;
+      pmsg_notice("port %s is on USB hub %s\n", (char *) ldata(ln), hubs[i]);
+    } else
+      pmsg_notice("USB hub of port %s unknown; its read-back is not throttled\n", (char *) ldata(ln));
+  }
+  if(!ngrouped)
+    pmsg_warning("USB topology of the ports unknown; --bulk-per-hub has no effect\n");
+  for(i = 0; i < n; i++)
+    mmt_free(hubs[i]);
+  mmt_free(hubs);
+}
+
+/*
+ * Gang programming: fork one worker per port once command line and config
+ * files have been parsed; each worker runs the usual open, initialise and
+ * -U/-T sequence on its own port. The parent waits for all workers, prints a
+ * summary table and exits with 1 if any worker failed. Only the worker
+ * processes return from this function with their port.
+ */
+static char *gang_fork(LISTID ports) {
+  int n = lsize(ports), nfail = 0, len = 4;
+  pid_t *pids = mmt_malloc(n*sizeof *pids);
+  int *status = mmt_malloc(n*sizeof *status);
+  volatile int *slots = NULL;
+  LNODEID ln;
+  int i;
+
+  pmsg_info("entering gang mode: programming %d targets with one worker per port\n", n);
+  gang_programming = 1;
+  if(gang_bulk_limit > 0)
+    gang_bulk_setup(ports);
+  fflush(stdout);
+  fflush(stderr);
+
+  // Workers publish phase*128 + percent in their own slot; the parent shows one combined bar
+  if(update_progress && !quell_progress) {
+    slots = mmap(NULL, n*sizeof *slots, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(slots == MAP_FAILED)
+      slots = NULL;
+  }
+
+  for(i = 0, ln = lfirst(ports); ln; i++, ln = lnext(ln)) {
+    char *port = ldata(ln);
+
+    if((int) strlen(port) > len)
+      len = strlen(port);
+    if(slots)
+      slots[i] = 0;
+    if((pids[i] = fork()) == 0) {
+      mmt_free(pids);
+      mmt_free(status);
+      progname = mmt_sprintf("%s [%s]", progname, port);
+      if(gang_bulk) {
+        gang_worker = i;
+        cx->avr_bulk_hook = gang_bulk_hook;
+      }
+      if(!quell_progress) {     // Interleaved progress bars are not readable
+        quell_progress = 1;
+        update_progress = NULL;
+        if(slots)
+          cx->avr_prog_slot = slots + i;
+      }
+      return mmt_strdup(port);
+    }
+    if(pids[i] < 0)
+      pmsg_ext_error("cannot fork worker for port %s: %s\n", port, strerror(errno));
+  }
+
+  for(i = 0; i < n; i++)
+    status[i] = -1;
+
+  if(slots) {                   // Poll workers and aggregate their progress
+    int left = 0, phase = 0, shown = 0;
+
+    for(i = 0; i < n; i++)
+      left += pids[i] > 0;
+    while(left) {
+      int ph = 0, sum = 0;
+
+      for(i = 0; i < n; i++) {
+        if(pids[i] > 0 && status[i] == -1) {
+          pid_t r = waitpid(pids[i], status + i, WNOHANG);
+
+          if(r > 0)
+            left--, gang_bulk_reaped(i);
+          else if(r < 0 && errno != EINTR)
+            pids[i] = 0, left--, gang_bulk_reaped(i);
+        }
+      }
+      for(i = 0; i < n; i++)
+        if(slots[i]/128 > ph)
+          ph = slots[i]/128;
+      for(i = 0; i < n; i++)    // Finished or failed workers count as complete
+        sum += pids[i] <= 0 || status[i] != -1 || slots[i]/128 > ph? 100: slots[i]/128 < ph? 0: slots[i]%128;
+      if(ph > phase) {
+        phase = ph;
+        shown = 1;
+        report_progress(0, 100*n, "Gang");
+      }
+      if(shown)
+        report_progress(sum, 100*n, NULL);
+      if(left)
+        usleep(100*1000);
+    }
+    if(shown)
+      report_progress(1, 1, NULL);
+    munmap((void *) slots, n*sizeof *slots);
+  } else {                      // Reap workers in any order so their bulk slots are freed early
+    int left = 0, st;
+    pid_t r;
+
+    for(i = 0; i < n; i++)
+      left += pids[i] > 0;
+    while(left > 0) {
+      if((r = waitpid(-1, &st, 0)) < 0) {
+        if(errno == EINTR)
+          continue;
+        break;
+      }
+      for(i = 0; i < n; i++)
+        if(pids[i] == r && status[i] == -1) {
+          status[i] = st;
+          gang_bulk_reaped(i);
+          left--;
+        }
+    }
+  }
+  if(gang_bulk) {
+    munmap((void *) gang_bulk, 3*n*sizeof *gang_bulk);
+    gang_bulk = NULL;
+  }
+
+  msg_info("\n");
+  pmsg_info("gang programming summary\n");
+  imsg_info("%-*s  Result\n", len, "Port");
+  for(i = 0, ln = lfirst(ports); ln; i++, ln = lnext(ln)) {
+    int st = status[i];
+
+    if(st == -1 || !WIFEXITED(st) || WEXITSTATUS(st))
+      nfail++;
+    imsg_info("%-*s  %s\n", len, (char *) ldata(ln), st == -1? "not run":
+      WIFSIGNALED(st)? str_ccprintf("killed by signal %d", WTERMSIG(st)):
+      !WIFEXITED(st) || WEXITSTATUS(st)? "failed": "OK");
+  }
+  if(nfail)
+    pmsg_error("%d out of %d targets failed\n", nfail, n);
+
+  mmt_free(pids);
+  mmt_free(status);
+  exit(nfail > 0);
+}
+
+#define PROBE_RECV_TIMEOUT 250  // Serial receive timeout in ms while probing
+
+// Shared with probe workers: index of the worker that found the target, -1 if none yet
+static volatile int *probe_winner;
+static int probe_worker = -1;   // This probe worker, -1 if not probing
+static int probe_stderr = -1;   // Saved stderr of a probe worker that has not won (yet)
+static long probe_timeout;      // Saved serial receive timeout
+
+// Probe worker has found the target: returns 1 if it is the first to do so, 0 otherwise
+static int probe_claim(const AVRPART *p, const char *port) {
+  int none = -1;
+
+  if(!__atomic_compare_exchange_n(probe_winner, &none, probe_worker, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    return 0;
+  fflush(stderr);
+  dup2(probe_stderr, 2);
+  close(probe_stderr);
+  probe_stderr = -1;
+  serial_recv_timeout = probe_timeout;
+  pmsg_info("found %s on port %s\n", p->desc, port);
+
+  return 1;
+}
+
+/*
+ * Port autodetection: fork one probe worker per port, which opens the
+ * programmer with short serial timeouts, initialises the part and checks its
+ * signature with its output silenced. The first worker that succeeds wins
+ * and carries on with the usual -U/-T sequence; the others close their port
+ * and exit, or are terminated by the parent once the winner is known. Only
+ * the worker processes return from this function with their port. The
+ * parent waits for the winner and exits with its exit code.
+ */
+static char *probe_fork(LISTID ports, const AVRPART *p) {
+  int n = lsize(ports), winner = -1, wst = -1, left = 0, killed = 0, st;
+  pid_t *pids = mmt_malloc(n*sizeof *pids), r;
+  LNODEID ln;
+  int i;
+
+  probe_winner = mmap(NULL, sizeof *probe_winner, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(probe_winner == MAP_FAILED) {
+    pmsg_ext_error("cannot share probe state: %s\n", strerror(errno));
+    exit(1);
+  }
+  *probe_winner = -1;
+  pmsg_notice("probing %d ports for %s\n", n, p? p->desc: "the part");
+  fflush(stdout);
+  fflush(stderr);
+
+  for(i = 0, ln = lfirst(ports); ln; i++, ln = lnext(ln)) {
+    char *port = ldata(ln);
+
+    if((pids[i] = fork()) == 0) {
+      int fd = open("/dev/null", O_WRONLY);
+
+      mmt_free(pids);
+      probe_worker = i;
+      probe_stderr = dup(2);
+      if(fd >= 0) {
+        dup2(fd, 2);
+        close(fd);
+      }
+      probe_timeout = serial_recv_timeout;
+      if(serial_recv_timeout > PROBE_RECV_TIMEOUT)
+        serial_recv_timeout = PROBE_RECV_TIMEOUT;
+      return mmt_strdup(port);
+    }
+    if(pids[i] < 0)
+      pmsg_ext_error("cannot fork probe for port %s: %s\n", port, strerror(errno));
+    else
+      left++;
+  }
+
+  while(left > 0) {
+    if((r = waitpid(-1, &st, WNOHANG)) < 0) {
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    for(i = 0; r > 0 && i < n; i++)
+      if(pids[i] == r) {
+        pids[i] = 0;
+        left--;
+        if(i == *probe_winner)
+          wst = st;
+      }
+    if(!killed && (winner = *probe_winner) >= 0) { // Stop workers still busy handshaking
+      killed = 1;
+      for(i = 0; i < n; i++)
+        if(pids[i] > 0 && i != winner)
+          kill(pids[i], SIGTERM);
+    }
+    if(r == 0)
+      usleep(10*1000);
+  }
+  munmap((void *) probe_winner, sizeof *probe_winner);
+  mmt_free(pids);
+
+  if(winner < 0) {
+    pmsg_error("none of the %d ports has the programmer connected to %s\n", n, p? p->desc: "the part");
+    exit(1);
+  }
+  exit(wst != -1 && WIFEXITED(wst)? WEXITSTATUS(wst): 1);
+}
+#endif
+
 static void exithook(void) {
   if(pgm->teardown)
     pgm->teardown(pgm);
@@ -482,6 +2118,10 @@ static void cleanup_main(void) {
     ldestroy(additional_config_files);
     additional_config_files = NULL;
   }
+  if(gang_ports) {
+    ldestroy_cb(gang_ports, mmt_f_free);
+    gang_ports = NULL;
+  }
 
   cleanup_config();
 }
@@ -679,6 +2319,109 @@ static char *concatpath(char *dst, char *dir, char *file, size_t n) {
 }
 #endif
 
+// Read system wide, user and additional configuration files, the former lazily if lazy is a list of wanted names
+static void read_configs(const char *sys_config, int no_avrduderc, LISTID lazy) {
+  struct stat sb;
+  int rc, span = avr_span_begin("config", NULL);
+
+  if(str_eq(sys_config, CFG_BUILTIN)) {
+    pmsg_notice("system wide configuration file is %s\n", CFG_BUILTIN);
+    if(read_config_builtin(lazy)) {
+      pmsg_error("unable to process %s\n", CFG_BUILTIN);
+      exit(1);
+    }
+  } else if(*sys_config) {
+    char *real_sys_config = realpath(sys_config, NULL);
+
+    if(real_sys_config) {
+      pmsg_notice("system wide configuration file is %s\n", real_sys_config);
+    } else
+      pmsg_warning("cannot determine realpath() of config file %s: %s\n", sys_config, strerror(errno));
+
+    rc = lazy? read_config_lazy(real_sys_config, lazy): read_config(real_sys_config);
+    if(rc) {
+      pmsg_error("unable to process system wide configuration file %s\n", real_sys_config);
+      exit(1);
+    }
+    mmt_free(real_sys_config);
+  }
+
+  if(usr_config[0] != 0 && !no_avrduderc) {
+    int ok = (rc = stat(usr_config, &sb)) >= 0 && (sb.st_mode & S_IFREG);
+
+    pmsg_notice("user configuration file %s%s%s\n", ok? "is ": "", usr_config,
+      rc < 0? " does not exist": !(sb.st_mode & S_IFREG)? " is not a regular file, skipping": "");
+
+    if(ok) {
+      rc = read_config(usr_config);
+      if(rc) {
+        pmsg_error("unable to process user configuration file %s\n", usr_config);
+        exit(1);
+      }
+    }
+  }
+
+  if(!str_eq(avrdude_conf_version, AVRDUDE_FULL_VERSION)) {
+    pmsg_warning("system wide configuration file version (%s)\n", avrdude_conf_version);
+    imsg_warning("does not match Avrdude build version (%s)\n", AVRDUDE_FULL_VERSION);
+  }
+
+  if(lsize(additional_config_files) > 0) {
+    LNODEID ln1;
+    const char *p = NULL;
+
+    for(ln1 = lfirst(additional_config_files); ln1; ln1 = lnext(ln1)) {
+      p = ldata(ln1);
+      pmsg_notice("additional configuration file is %s\n", p);
+
+      rc = read_config(p);
+      if(rc) {
+        pmsg_error("unable to process additional configuration file %s\n", p);
+        exit(1);
+      }
+    }
+  }
+  avr_span_end(span, -1);
+}
+
+/*
+ * Return the list of names of part, programmer and serial adapter entries
+ * this run needs if it is safe to parse the system wide configuration file
+ * lazily; NULL if all entries are needed, eg, for listings or developer options
+ */
+static LISTID lazy_config_names(const char *port, int explicit_c, int no_avrduderc) {
+  if(!explicit_c || !partdesc || !*partdesc || !pgmid || !*pgmid)
+    return NULL;
+  if(strpbrk(partdesc, "?*/") || strpbrk(pgmid, "?*/") || (port && *port == '?'))
+    return NULL;
+
+  LISTID names = lcreat(NULL, 0);
+
+  ladd(names, (void *) partdesc);
+  ladd(names, (void *) pgmid);
+  ladd(names, "dryrun");
+  if(port && *port && *port != '/') {
+    const char *colon = strchr(port, ':');
+
+    ladd(names, (void *) cache_string(colon? str_ccprintf("%.*s", (int) (colon - port), port): port));
+  }
+
+  // Entries in other configuration files may inherit from any entry in the system wide one
+  struct stat sb;
+  int ok = 1;
+
+  if(usr_config[0] && !no_avrduderc && stat(usr_config, &sb) >= 0 && (sb.st_mode & S_IFREG))
+    ok = cfg_lazy_parents(usr_config, names) == 0;
+  for(LNODEID ln = lfirst(additional_config_files); ln && ok; ln = lnext(ln))
+    ok = cfg_lazy_parents(ldata(ln), names) == 0;
+
+  if(!ok) {
+    ldestroy(names);
+    names = NULL;
+  }
+
+  return names;
+}
 
 int main(int argc, char *argv[]) {
   int rc;                       // General return code checking
@@ -710,12 +2453,24 @@ int main(int argc, char *argv[]) {
   int baudrate;                 // Override default programmer baud rate
   int touch_1200bps;            // Touch serial port prior to programming
   double bitclock;              // Specify programmer bit clock (JTAG ICE)
+  int autobitclock;             // -B auto: search for the fastest working bit clock
   int ispdelay;                 // Specify the delay for ISP clock
   int init_ok;                  // Device initialization worked well
   int is_open;                  // Device open succeeded
   int ce_delayed;               // Chip erase delayed
   char *logfile;                // Use logfile rather than stderr for diagnostics
   int showversion;              // Show version and exit
+  int differential;             // Only write flash/EEPROM pages that differ on the device
+  int hotplug;                  // Wait for the USB programmer to be (re)plugged
+  int inline_verify;            // Verify paged writes page by page right after writing
+  int probe;                    // Autodetect which of several -P ports has the target
+  int gang;                     // Gang program several -P ports; implied by a wildcard port
+  int realtime;                 // Real-time scheduling and locked memory for bitbang programmers
+  const char *serve_path;       // Local socket or net:[<host>]:<port> for serving jobs after the command line ones
+  const char *remote_addr;      // <host>:<port> of an avrdude server that runs the -e, -U and -T options
+  const char *trace_path;       // File for the serial transaction trace
+  const char *timing_path;      // File for the JSON timing report, "-" for stdout
+  const char *chrome_path;      // File for detailed timing in Trace Event Format
   enum updateflags uflags = UF_AUTO_ERASE | UF_VERIFY;  // Flags for do_op()
 
   init_cx(NULL);
@@ -782,6 +2537,8 @@ int main(int argc, char *argv[]) {
     exit(1);
   }
 
+  gang_ports = lcreat(NULL, 0);
+
   partdesc = NULL;
   port = NULL;
   erase = 0;
@@ -800,11 +2557,23 @@ int main(int argc, char *argv[]) {
   baudrate = 0;
   touch_1200bps = 0;
   bitclock = 0.0;
+  autobitclock = 0;
   ispdelay = 0;
   is_open = 0;
   ce_delayed = 0;
   logfile = NULL;
   showversion = 0;
+  differential = 0;
+  hotplug = 0;
+  inline_verify = 0;
+  realtime = 0;
+  probe = 0;
+  gang = 0;
+  serve_path = NULL;
+  remote_addr = NULL;
+  trace_path = NULL;
+  timing_path = NULL;
+  chrome_path = NULL;
 
   if(argc == 1) {               // No arguments?
     usage();
@@ -824,14 +2593,21 @@ int main(int argc, char *argv[]) {
 #endif
 
   // Process command line arguments
+  enum { OPT_SERVE = 0x100, OPT_TRACE, OPT_TIMING, OPT_RECORD, OPT_REPLAY, OPT_JOB, OPT_BULK, OPT_REMOTE, OPT_VFYPOLICY };
   struct option longopts[] = {
     {"help",       no_argument,       NULL, '?'},
     {"baud",       required_argument, NULL, 'b'},
     {"bitclock",   required_argument, NULL, 'B'},
+    {"bulk-per-hub",required_argument,NULL, OPT_BULK},
     {"programmer", required_argument, NULL, 'c'},
     {"config",     required_argument, NULL, 'C'},
     {"noerase",    no_argument,       NULL, 'D'},
+    {"differential",no_argument,      &differential, 1},
     {"erase",      no_argument,       NULL, 'e'},
+    {"gang",       no_argument,       &gang, 1},
+    {"hotplug",    no_argument,       &hotplug, 1},
+    {"inline-verify",no_argument,     &inline_verify, 1},
+    {"job",        required_argument, NULL, OPT_JOB},
     {"logfile",    required_argument, NULL, 'l'},
     {"test-memory",no_argument,       NULL, 'n'},
     {"noconfig",   no_argument,       NULL, 'N'},
@@ -839,9 +2615,18 @@ int main(int argc, char *argv[]) {
     {"part",       required_argument, NULL, 'p'},
     {"port",       required_argument, NULL, 'P'},
     {"quell",      no_argument,       NULL, 'q'},
+    {"probe",      no_argument,       &probe, 1},
+    {"realtime",   no_argument,       &realtime, 1},
     {"reconnect",  no_argument,       NULL, 'r'},
+    {"record",     required_argument, NULL, OPT_RECORD},
+    {"remote",     required_argument, NULL, OPT_REMOTE},
+    {"replay",     required_argument, NULL, OPT_REPLAY},
+    {"serve",      required_argument, NULL, OPT_SERVE},
     {"terminal",   no_argument,       NULL, 't'},
+    {"timing",     required_argument, NULL, OPT_TIMING},
+    {"trace",      required_argument, NULL, OPT_TRACE},
     {"memory",     required_argument, NULL, 'U'},
+    {"verify-policy",required_argument,NULL, OPT_VFYPOLICY},
     {"verbose",    no_argument,       NULL, 'v'},
     {"noverify-memory",no_argument,   NULL, 'V'},
     {"version",    no_argument,       &showversion, 0},
@@ -863,6 +2648,10 @@ int main(int argc, char *argv[]) {
       break;
 
     case 'B':                  // Specify bit clock period
+      if(str_caseeq(optarg, "auto")) {
+        autobitclock = 1;
+        break;
+      }
       bitclock = strtod(optarg, &e);
       if((e == optarg) || bitclock <= 0.0) {
         pmsg_error("invalid bit clock period %s\n", optarg);
@@ -954,6 +2743,12 @@ int main(int argc, char *argv[]) {
 
     case 'P':
       port = mmt_strdup(optarg);
+
+#if !defined(WIN32)
+      if(gang_add_port(gang_ports, optarg))
+        gang = 1;
+#endif
+
       break;
 
     case 'q':                  // Quell progress output
@@ -993,6 +2788,84 @@ int main(int argc, char *argv[]) {
       ladd(extended_params, optarg);
       break;
 
+    case OPT_SERVE:
+#if defined(WIN32)
+      pmsg_error("option --serve is not supported on Windows\n");
+      exit(1);
+#else
+      serve_path = optarg;
+#endif
+      break;
+
+    case OPT_REMOTE:
+#if defined(WIN32)
+      pmsg_error("option --remote is not supported on Windows\n");
+      exit(1);
+#else
+      remote_addr = optarg;
+#endif
+      break;
+
+    case OPT_BULK:
+      gang_bulk_limit = str_int(optarg, STR_INT32, &errstr);
+      if(errstr || gang_bulk_limit < 0) {
+        pmsg_error("invalid --bulk-per-hub %s, expected a number >= 0\n", optarg);
+        exit(1);
+      }
+      break;
+
+    case OPT_JOB:
+      if(load_job(optarg) < 0)
+        exit(1);
+      if(job.erase == 1) {      // Same as -e
+        erase = 1;
+        explicit_e = 1;
+        uflags &= ~UF_AUTO_ERASE;
+      } else if(job.erase == 0) { // Same as -D
+        uflags &= ~UF_AUTO_ERASE;
+        cx->avr_disableffopt = 1;
+      } else if(job.erase == 3) {
+        differential = 1;
+      }
+      if(job.verify >= 0)
+        uflags = job.verify? uflags | UF_VERIFY: uflags & ~UF_VERIFY;
+      break;
+
+    case OPT_TRACE:
+      trace_path = optarg;
+      break;
+
+    case OPT_RECORD:
+      if(serial_record_open(optarg) < 0)
+        exit(1);
+      break;
+
+    case OPT_REPLAY:
+      if(serial_replay_load(optarg) < 0)
+        exit(1);
+      break;
+
+    case OPT_VFYPOLICY:
+      if(update_set_verify_policy(optarg) < 0) {
+        pmsg_error("invalid --verify-policy %s; use crc, full or sample[:<n>]\n", optarg);
+        exit(1);
+      }
+      break;
+
+    case OPT_TIMING:           // --timing json, --timing json:<file> or --timing chrome:<file>
+      if(str_starts(optarg, "chrome:") && optarg[7]) {
+        chrome_path = optarg + 7;
+        cx->avr_timing = 2;
+      } else if(str_eq(optarg, "json") || (str_starts(optarg, "json:") && optarg[5])) {
+        timing_path = optarg[4]? optarg + 5: "-";
+        if(!cx->avr_timing)
+          cx->avr_timing = 1;
+      } else {
+        pmsg_error("invalid --timing %s; use json, json:<file> or chrome:<file>\n", optarg);
+        exit(1);
+      }
+      break;
+
     case 0:
       if(longopts[option_idx].flag)
         *longopts[option_idx].flag = 1;
@@ -1040,6 +2913,11 @@ int main(int argc, char *argv[]) {
   if(1 != sscanf("42", "%zi", &ztest) || ztest != 42)
     pmsg_warning("linked C library does not conform to C99; %s may not work as expected\n", progname);
 
+#if !defined(WIN32)
+  if(remote_addr)               // The server has the programmer and part: avrdude.conf is not needed
+    exit(remote_jobs(remote_addr, updates, erase));
+#endif
+
   // Search for system configuration file unless -C conffile was given
   if(strlen(sys_config) == 0) {
     /*
@@ -1126,6 +3004,8 @@ int main(int argc, char *argv[]) {
         sys_config_found = true;
       }
     }
+    if(!sys_config_found && cfg_builtin(NULL)) // No avrdude.conf installed: use the compiled-in one
+      strcpy(sys_config, CFG_BUILTIN);
   }
   // Debug output
   msg_trace2("sys_config = %s\n", sys_config);
@@ -1139,56 +3019,18 @@ int main(int argc, char *argv[]) {
   pmsg_notice("%s version %s\n", progname, AVRDUDE_FULL_VERSION);
   pmsg_notice("Copyright see https://github.com/avrdudes/avrdude/blob/main/AUTHORS\n\n");
 
-  if(*sys_config) {
-    char *real_sys_config = realpath(sys_config, NULL);
-
-    if(real_sys_config) {
-      pmsg_notice("system wide configuration file is %s\n", real_sys_config);
-    } else
-      pmsg_warning("cannot determine realpath() of config file %s: %s\n", sys_config, strerror(errno));
-
-    rc = read_config(real_sys_config);
-    if(rc) {
-      pmsg_error("unable to process system wide configuration file %s\n", real_sys_config);
-      exit(1);
-    }
-    mmt_free(real_sys_config);
-  }
-
-  if(usr_config[0] != 0 && !no_avrduderc) {
-    int ok = (rc = stat(usr_config, &sb)) >= 0 && (sb.st_mode & S_IFREG);
-
-    pmsg_notice("user configuration file %s%s%s\n", ok? "is ": "", usr_config,
-      rc < 0? " does not exist": !(sb.st_mode & S_IFREG)? " is not a regular file, skipping": "");
-
-    if(ok) {
-      rc = read_config(usr_config);
-      if(rc) {
-        pmsg_error("unable to process user configuration file %s\n", usr_config);
-        exit(1);
-      }
-    }
-  }
-
-  if(!str_eq(avrdude_conf_version, AVRDUDE_FULL_VERSION)) {
-    pmsg_warning("system wide configuration file version (%s)\n", avrdude_conf_version);
-    imsg_warning("does not match Avrdude build version (%s)\n", AVRDUDE_FULL_VERSION);
-  }
-
-  if(lsize(additional_config_files) > 0) {
-    LNODEID ln1;
-    const char *p = NULL;
-
-    for(ln1 = lfirst(additional_config_files); ln1; ln1 = lnext(ln1)) {
-      p = ldata(ln1);
-      pmsg_notice("additional configuration file is %s\n", p);
+  // Only parse the avrdude.conf entries needed for -p, -c and -P unless these ask for listings
+  LISTID lazy = lazy_config_names(port, explicit_c, no_avrduderc);
 
-      rc = read_config(p);
-      if(rc) {
-        pmsg_error("unable to process additional configuration file %s\n", p);
-        exit(1);
-      }
+  read_configs(sys_config, no_avrduderc, lazy);
+  if(lazy) {                    // Re-read everything if a part or programmer cannot be found
+    if(!locate_part(part_list, partdesc) || !locate_programmer_starts_set(programmers, pgmid, NULL, NULL)) {
+      pmsg_debug("rereading all configuration files\n");
+      cleanup_config();
+      init_config();
+      read_configs(sys_config, no_avrduderc, NULL);
     }
+    ldestroy(lazy);
   }
 
   // Sort memories of all parts in canonical order
@@ -1385,6 +3227,22 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if(job.name && p && job_preload(p) < 0) // Before forking, so gang workers share the images
+    exit(1);
+
+#if !defined(WIN32)
+  gang_ports = gang_expand_usb(gang_ports, pgm);
+  if(lsize(gang_ports) > 1 && (gang || probe)) {
+    mmt_free(port);
+    port = probe? probe_fork(gang_ports, p): gang_fork(gang_ports);
+  } else if(lsize(gang_ports) > 1) {
+    pmsg_notice("using the last of %d -P ports; use --gang to program all of them\n", lsize(gang_ports));
+  } else if(lsize(gang_ports) == 1 && !str_eq(port, ldata(lfirst(gang_ports)))) {
+    mmt_free(port);             // Single match of a wildcard port
+    port = mmt_strdup(ldata(lfirst(gang_ports)));
+  }
+#endif
+
   int is_dryrun = str_eq(pgm->type, "dryrun") || (dry && pgm->initpgm == dry->initpgm);
 
   if((port[0] == 0 || str_eq(port, "unknown")) && !is_dryrun) {
@@ -1492,8 +3350,27 @@ int main(int argc, char *argv[]) {
     pmsg_notice("setting ISP clk delay : %3i us\n", ispdelay);
     pgm->ispdelay = ispdelay;
   }
+  cx->bb_realtime = realtime;
+
+  if(hotplug) {
+    if(usb_hotplug_start(pgm) < 0) {
+      exitrc = 1;
+      goto main_exit;
+    }
+    if(!usb_hotplug_present()) {
+      pmsg_info("waiting for programmer %s to be plugged in\n", pgmid);
+      if(usb_hotplug_wait(1, -1) < 0) {
+        exitrc = 1;
+        goto main_exit;
+      }
+      usleep(250*1000);         // Give the OS time to set up the device
+    }
+  }
+
+  int span = avr_span_begin("open", NULL);
 
   rc = pgm->open(pgm, port);
+  avr_span_end(span, -1);
   if(rc < 0) {
     if(rc == LIBAVRDUDE_EXIT_FAIL || rc == LIBAVRDUDE_EXIT_OK) {
       exitrc = rc == LIBAVRDUDE_EXIT_FAIL;
@@ -1515,6 +3392,8 @@ int main(int argc, char *argv[]) {
     goto main_exit;
   }
   is_open = 1;
+  tgtcache_target(pgm, p, port);
+  costmodel_open();
 
   if(partdesc == NULL) {
     part_not_found(NULL);
@@ -1545,6 +3424,7 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  p = avr_dup_part(p);          // Memory buffers go into a copy: part_list stays read-only
   if(avr_initmem(p) != 0) {
     msg_error("\n");
     pmsg_error("unable to initialize memories\n");
@@ -1626,7 +3506,9 @@ int main(int argc, char *argv[]) {
   int reinitialised = 0;
   int erased_by_unlock = 0;
 init_again:
+  span = avr_span_begin("initialize", NULL);
   init_ok = (rc = pgm->initialize(pgm, p)) >= 0;
+  avr_span_end(span, -1);
   if(!init_ok) {
     if(rc == LIBAVRDUDE_EXIT_FAIL || rc == LIBAVRDUDE_EXIT_OK) {
       exitrc = rc == LIBAVRDUDE_EXIT_FAIL;
@@ -1814,6 +3696,45 @@ init_again:
     }
   }
 
+#if !defined(WIN32)
+  if(probe_worker >= 0 && !probe_claim(p, port)) {
+    exitrc = 1;                 // Another probe worker was faster
+    goto main_exit;
+  }
+#endif
+
+  if(autobitclock && init_ok) {
+    double t = autotune_bitclock(pgm, p);
+
+    if(t > 0)
+      pmsg_info("auto-tuned bit clock period: %.3f us (%.1f kHz)\n", t*1e6, 1e-3/t);
+    else if(t < 0 && !ovsigck) {
+      pmsg_error("target no longer responds after bit clock auto-tuning\n");
+      exitrc = 1;
+      goto main_exit;
+    }
+  }
+
+  if(init_ok)
+    devcache_open(pgm, p);
+
+  if(differential) {
+    if(explicit_e) {
+      pmsg_notice("ignoring --differential as -e erases the chip anyway\n");
+    } else if(!pgm->page_erase && !is_spm(pgm)) {
+      pmsg_warning("programmer %s cannot erase pages; --differential only applies to EEPROM\n", pgmid);
+      uflags |= UF_DIFF_EEPROM;
+    } else {
+      uflags |= UF_DIFFERENTIAL;
+      uflags &= ~UF_AUTO_ERASE;   // Pages that differ are erased individually when needed
+      cx->avr_disableffopt = 1;   // Trailing 0xff in the file may differ from the device
+      pmsg_notice("NOT erasing chip as only pages that differ on the device will be written\n");
+    }
+  }
+
+  if(inline_verify)
+    uflags |= UF_INLINE_VERIFY;
+
   if(uflags & UF_AUTO_ERASE) {
     if((p->prog_modes & (PM_PDI | PM_UPDI)) && pgm->page_erase && lsize(updates) > 0) {
       for(ln = lfirst(updates); ln; ln = lnext(ln)) {
@@ -1882,38 +3803,34 @@ init_again:
     goto main_exit;
   }
 
-  int wrmem = 0, terminal = 0;
-
-  if(lsize(updates) <= 1)
-    uflags |= UF_NOHEADING;
-  for(ln = lfirst(updates); ln; ln = lnext(ln)) {
-    const AVRMEM *m;
+  if(job_next_serial() < 0)
+    exitrc = 1;
+  else
+    exitrc = run_updates(pgm, p, uflags, &ce_delayed);
+  if(job.name)
+    exitrc = job_units(pgm, p, port, hotplug, &is_open, uflags, erase, exitrc, &ce_delayed);
 
-    upd = ldata(ln);
-    if(upd->cmdline && wrmem) { // Invalidate cache if device was written to
-      wrmem = 0;
-      pgm->reset_cache(pgm, p);
-    } else if(!upd->cmdline) {  // Flush cache before any device memory access
-      pgm->flush_cache(pgm, p);
-      wrmem |= upd->op == DEVICE_WRITE;
-    }
-    if((uflags & UF_NOWRITE) && upd->cmdline && !terminal++)
-      pmsg_warning("the terminal ignores option -n, that is, it writes to the device\n");
-    rc = do_op(pgm, p, upd, uflags);
-    if(rc && rc != LIBAVRDUDE_SOFTFAIL) {
-      exitrc = 1;
-      break;
-    } else if(rc == 0 && upd->op == DEVICE_WRITE && (m = avr_locate_mem(p, upd->memstr)) && mem_is_in_flash(m))
-      ce_delayed = 0;           // Redeemed chip erase promise
-  }
-  pgm->flush_cache(pgm, p);
+#if !defined(WIN32)
+  if(serve_path && !exitrc && serve_jobs(pgm, p, serve_path, uflags) < 0)
+    exitrc = 1;
+#endif
 
-  if(pgm->end_programming)
+  if(is_open && pgm->end_programming)
     if(pgm->end_programming(pgm, p) < 0)
       pmsg_error("could not end programming, aborting\n");
 
 main_exit:
 
+#if !defined(WIN32)
+  if(probe_worker >= 0 && probe_stderr >= 0) { // Probe worker that has not found the target
+    if(is_open) {
+      pgm->disable(pgm);
+      pgm->close(pgm);
+    }
+    exit(1);
+  }
+#endif
+
   // Program complete
   if(is_open) {
     // Clear rdy LED and summarise interaction in err, pgm and vfy LEDs
@@ -1923,6 +3840,44 @@ main_exit:
     pgm->close(pgm);
   }
 
+  if(exitrc && verbose >= MSG_NOTICE && verbose < MSG_TRACE)
+    serial_trace_show(16);
+  serial_stats_show();
+  serial_replay_done();
+  devcache_close();
+  costmodel_close();
+  tgtcache_save();
+  usb_hotplug_stop();
+  usb_enum_free();
+  if(trace_path && serial_trace_write(trace_path) < 0)
+    exitrc = 1;
+  if(serial_record_close() < 0)
+    exitrc = 1;
+
+  if(timing_path) {
+    FILE *f = str_eq(timing_path, "-")? stdout: fopen(timing_path, "w");
+
+    if(!f) {
+      pmsg_ext_error("cannot create timing file %s: %s\n", timing_path, strerror(errno));
+      exitrc = 1;
+    } else {
+      avr_timing_json(f, pgmid, partdesc, ce_delayed? 1: exitrc);
+      if(f != stdout)
+        fclose(f);
+    }
+  }
+  if(chrome_path) {
+    FILE *f = fopen(chrome_path, "w");
+
+    if(!f) {
+      pmsg_ext_error("cannot create trace event file %s: %s\n", chrome_path, strerror(errno));
+      exitrc = 1;
+    } else {
+      avr_timing_trace_event(f);
+      fclose(f);
+    }
+  }
+
   if(cx->usb_access_error) {
     pmsg_info("\nUSB access errors detected; this could have many reasons; if it is\n"
       "USB permission problems, avrdude is likely to work when run as root\n"
@@ -75,6 +75,7 @@
 #define MICRONUCLEUS_CMD_START 4
 
 #define MICRONUCLEUS_DEFAULT_TIMEOUT 500
+#define MICRONUCLEUS_POLL_TIMEOUT 5     // Milliseconds per readiness poll with -x poll
 #define MICRONUCLEUS_MAX_MAJOR_VERSION 2
 
 #define my (*(struct pdata *) (pgm->cookie))
@@ -103,6 +104,8 @@ struct pdata {
   uint16_t user_reset_vector;   // Reset vector of user program
   bool write_last_page;         // Last page already programmed
   bool start_program;           // Require start after flash
+  bool erased;                  // Device erased in this session, so blank pages can be skipped
+  bool poll_ready;              // Poll for readiness instead of sleeping the worst case
 };
 
 // -----------------------------------------------------------------------------
@@ -111,31 +114,45 @@ static void delay_ms(uint32_t duration) {
   usleep(duration*1000);
 }
 
+// Request the info block (6 bytes for protocol v2, 4 bytes for v1); return usb_control_msg() result
+static int micronucleus_query_info(struct pdata *pdata, int timeout) {
+  uint8_t buffer[6] = { 0 };
+
+  return usb_control_msg(pdata->usb_handle,
+    USB_ENDPOINT_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
+    MICRONUCLEUS_CMD_INFO,
+    0, 0,
+    (char *) buffer, pdata->major_version >= 2? 6: 4,
+    timeout);
+}
+
 static int micronucleus_check_connection(struct pdata *pdata) {
-  if(pdata->major_version >= 2) {
-    uint8_t buffer[6] = { 0 };
-    int result = usb_control_msg(pdata->usb_handle,
-      USB_ENDPOINT_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-      MICRONUCLEUS_CMD_INFO,
-      0, 0,
-      (char *) buffer, sizeof(buffer),
-      MICRONUCLEUS_DEFAULT_TIMEOUT);
-
-    if(result < 0)
-      cx->usb_access_error = 1;
-    return result == sizeof(buffer)? 0: -1;
-  } else {
-    uint8_t buffer[4] = { 0 };
-    int result = usb_control_msg(pdata->usb_handle,
-      USB_ENDPOINT_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-      MICRONUCLEUS_CMD_INFO,
-      0, 0,
-      (char *) buffer, sizeof(buffer),
-      MICRONUCLEUS_DEFAULT_TIMEOUT);
+  int result = micronucleus_query_info(pdata, MICRONUCLEUS_DEFAULT_TIMEOUT);
+
+  if(result < 0)
+    cx->usb_access_error = 1;
+  return result == (pdata->major_version >= 2? 6: 4)? 0: -1;
+}
 
-    if(result < 0)
-      cx->usb_access_error = 1;
-    return result == sizeof(buffer)? 0: -1;
+/*
+ * Wait until the bootloader has finished a page write or erase. The device does not
+ * answer USB requests while the CPU is halted for SPM, so with -x poll it is asked for
+ * its info block in short intervals; the bootloader-reported duration stays the upper
+ * bound and is what is slept without -x poll.
+ */
+static void micronucleus_wait_ready(struct pdata *pdata, uint32_t max_ms) {
+  if(!pdata->poll_ready || !pdata->usb_handle) {
+    delay_ms(max_ms);
+    return;
+  }
+
+  uint64_t start = avr_mstimestamp();
+
+  delay_ms(1);
+  while(avr_mstimestamp() - start < max_ms) {
+    if(micronucleus_query_info(pdata, MICRONUCLEUS_POLL_TIMEOUT) == (pdata->major_version >= 2? 6: 4))
+      return;
+    delay_ms(1);
   }
 }
 
@@ -304,7 +321,7 @@ static int micronucleus_erase_device(struct pdata *pdata) {
     }
   }
 
-  delay_ms(pdata->erase_sleep);
+  micronucleus_wait_ready(pdata, pdata->erase_sleep);
 
   result = micronucleus_check_connection(pdata);
   if(result < 0) {
@@ -316,6 +333,7 @@ static int micronucleus_erase_device(struct pdata *pdata) {
       return result;
     }
   }
+  pdata->erased = true;
 
   return 0;
 }
@@ -458,7 +476,7 @@ static int micronucleus_write_page(struct pdata *pdata, uint32_t address, uint8_
     return result;
   }
 
-  delay_ms(pdata->write_sleep);
+  micronucleus_wait_ready(pdata, pdata->write_sleep);
 
   return 0;
 }
@@ -764,9 +782,20 @@ static int micronucleus_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
       memcpy(page_buffer, mem->buf + addr, chunk_size);
       memset(page_buffer + chunk_size, 0xFF, pdata->page_size - chunk_size);
 
-      result = micronucleus_write_page(pdata, addr, page_buffer, pdata->page_size);
-      if(result < 0) {
-        break;
+      // Blank pages after an erase need no write, except those carrying patched vectors
+      int skip = pdata->erased && addr != 0 && addr < (uint32_t) (pdata->bootloader_start - pdata->page_size);
+
+      for(size_t i = 0; skip && i < pdata->page_size; i++)
+        if(page_buffer[i] != 0xFF)
+          skip = 0;
+
+      if(skip) {
+        pmsg_debug("skipping blank page at 0x%04X\n", addr);
+      } else {
+        result = micronucleus_write_page(pdata, addr, page_buffer, pdata->page_size);
+        if(result < 0) {
+          break;
+        }
       }
 
       addr += chunk_size;
@@ -804,6 +833,11 @@ static int micronucleus_parseextparams(const PROGRAMMER *pgm, const LISTID xpara
       continue;
     }
 
+    if(str_eq(extended_param, "poll")) {
+      pdata->poll_ready = true;
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rv = LIBAVRDUDE_EXIT_OK;
@@ -816,6 +850,7 @@ static int micronucleus_parseextparams(const PROGRAMMER *pgm, const LISTID xpara
     msg_error("%s -c %s extended options:\n", progname, pgmid);
     msg_error("  -x wait     Wait for the device to be plugged in if not connected\n");
     msg_error("  -x wait=<n> Wait <n> s for the device to be plugged in if not connected\n");
+    msg_error("  -x poll     Poll for readiness after page writes and erase instead of sleeping\n");
     msg_error("  -x help     Show this help menu and exit\n");
     return rv;
   }
@@ -23,6 +23,42 @@
 #include <mmsystem.h>
 #pragma comment(lib, "winmm.lib")
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Waitable timer of the calling thread: sessions in different threads wait independently
+class WaitTimer
+{
+public:
+    WaitTimer()
+    {
+        // High-resolution timers need Windows 10 1803 or later
+        m_timer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    }
+
+    ~WaitTimer()
+    {
+        if (m_timer)
+        {
+            ::CloseHandle(m_timer);
+        }
+    }
+
+    // Block for about us microseconds; returns false if there is no high-resolution timer
+    bool Wait(DWORD us)
+    {
+        LARGE_INTEGER due{};
+        due.QuadPart = -10LL * us; // Relative time in 100 ns units
+
+        return m_timer && ::SetWaitableTimerEx(m_timer, &due, 0, nullptr, nullptr, nullptr, 0) &&
+            ::WaitForSingleObject(m_timer, INFINITE) == WAIT_OBJECT_0;
+    }
+
+private:
+    HANDLE m_timer = nullptr;
+};
+
 class MicroSleep
 {
 public:
@@ -42,6 +78,7 @@ public:
         }
     }
 
+    // Sleep through the bulk of the delay and only spin on the performance counter for the tail
     int Sleep(DWORD us)
     {
         if (us == 0)
@@ -55,14 +92,18 @@ public:
             LARGE_INTEGER start{};
             QueryPerformanceCounter(&start);
 
-            if (us > 10000)
-            {
-                ::Sleep((us - 5000) / 1000);
-            }
-
             LARGE_INTEGER end{};
             end.QuadPart = start.QuadPart + (frequency.QuadPart * us / 1000000);
 
+            static thread_local WaitTimer timer;
+            if (us <= spinPrecise || !timer.Wait(us - spinPrecise))
+            {
+                if (us > spinCoarse)
+                {
+                    ::Sleep((us - spinCoarse) / 1000);
+                }
+            }
+
             while (true)
             {
                 LARGE_INTEGER current;
@@ -83,6 +124,8 @@ public:
 
 private:
     static const UINT timerPeriod = 1; // 1ms
+    static const DWORD spinPrecise = 200; // Spin for the last 200 us after a high-resolution wait
+    static const DWORD spinCoarse = 2000; // Sleep() with a 1 ms timer period may overrun by up to 2 ms
     bool m_resetTimerPeriod = false;
 };
 
@@ -152,6 +152,70 @@ static int par_getpin(const PROGRAMMER *pgm, int pinfunc) {
   return value;
 }
 
+// Port pin of pinfunc, NULL if none; *inv is set if the logic level is inverted on the port
+static const struct ppipins *par_ppipin(const PROGRAMMER *pgm, int pinfunc, int *inv) {
+  int pin = pgm->pinno[pinfunc];
+
+  *inv = !!(pin & PIN_INVERSE);
+  pin &= PIN_MASK;
+  if(pin < 1 || pin > 17)
+    return NULL;
+  *inv ^= ppipins[pin - 1].inverted;
+
+  return ppipins + pin - 1;
+}
+
+/*
+ * SPI transfer that pushes the clock edges of each byte as one sequence of
+ * data register values; SDO changes together with the falling SCK edge of
+ * the previous bit. Falls back to bitbang_spi() unless SCK and SDO are data
+ * pins and SDI a status pin or if an ISP delay is requested.
+ */
+static int par_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  int isck, isdo, isdi;
+  const struct ppipins *sck = par_ppipin(pgm, PIN_AVR_SCK, &isck), *sdo = par_ppipin(pgm, PIN_AVR_SDO, &isdo),
+    *sdi = par_ppipin(pgm, PIN_AVR_SDI, &isdi);
+
+  if(!sck || !sdo || !sdi || sck->reg != PPIDATA || sdo->reg != PPIDATA || sdi->reg != PPISTATUS ||
+    sck == sdo || pgm->ispdelay > 1)
+    return bitbang_spi(pgm, cmd, res, count);
+
+  unsigned char vals[16], status[8], low = isck? sck->bit: 0;
+  int mask = sck->bit | sdo->bit;
+
+  pgm->setpin(pgm, PIN_LED_PGM, 0);
+  for(int i = 0; i < count; i++) {
+    for(int b = 7; b >= 0; b--) {
+      vals[2*(7 - b)] = low | ((((cmd[i] >> b) & 1) ^ isdo)? sdo->bit: 0);
+      vals[2*(7 - b) + 1] = vals[2*(7 - b)] ^ sck->bit;
+    }
+    if(ppi_writeseq(&pgm->fd, PPIDATA, mask, vals, 16, status) < 0)
+      return -1;
+    res[i] = 0;
+    for(int b = 7; b >= 0; b--)
+      res[i] |= (!!(status[7 - b] & sdi->bit) ^ isdi) << b;
+  }
+  if(ppi_writeseq(&pgm->fd, PPIDATA, sck->bit, &low, 1, NULL) < 0)
+    return -1;
+  pgm->setpin(pgm, PIN_LED_PGM, 1);
+
+  if(verbose >= MSG_DEBUG) {
+    msg_debug("%s(): [ ", __func__);
+    for(int i = 0; i < count; i++)
+      msg_debug("%02X ", cmd[i]);
+    msg_debug("] [ ");
+    for(int i = 0; i < count; i++)
+      msg_debug("%02X ", res[i]);
+    msg_debug("]\n");
+  }
+
+  return 0;
+}
+
+static int par_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res) {
+  return par_spi(pgm, cmd, res, 4);
+}
+
 static int par_highpulsepin(const PROGRAMMER *pgm, int pinfunc) {
   int inverted, pin;
 
@@ -257,6 +321,7 @@ static int par_open(PROGRAMMER *pgm, const char *port) {
 }
 
 static void par_close(PROGRAMMER *pgm) {
+  bitbang_realtime_end();         // Back to normal scheduling
 
   // Restore pin values before closing, but ensure that buffers are turned off
   ppi_setall(&pgm->fd, PPIDATA, pgm->ppidata);
@@ -390,9 +455,10 @@ void par_initpgm(PROGRAMMER *pgm) {
   pgm->powerdown = par_powerdown;
   pgm->program_enable = bitbang_program_enable;
   pgm->chip_erase = bitbang_chip_erase;
-  pgm->cmd = bitbang_cmd;
+  pgm->cmd = par_cmd;
   pgm->cmd_tpi = bitbang_cmd_tpi;
-  pgm->spi = bitbang_spi;
+  pgm->cmd_tpi_batch = bitbang_cmd_tpi_batch;
+  pgm->spi = par_spi;
   pgm->open = par_open;
   pgm->close = par_close;
   pgm->setpin = par_setpin;
@@ -401,6 +467,10 @@ void par_initpgm(PROGRAMMER *pgm) {
   pgm->parseexitspecs = par_parseexitspecs;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
 }
 
 #else                           // ! HAVE_PARPORT
@@ -92,10 +92,14 @@ void pgm_init_functions(PROGRAMMER *pgm) {
   pgm->unlock = NULL;
   pgm->cmd = NULL;
   pgm->cmd_tpi = NULL;
+  pgm->cmd_tpi_batch = NULL;
   pgm->spi = NULL;
   pgm->paged_write = NULL;
   pgm->paged_load = NULL;
   pgm->page_erase = NULL;
+  pgm->paged_erase_write = NULL;
+  pgm->resync = NULL;
+  pgm->read_block = NULL;
   pgm->write_setup = NULL;
   pgm->read_sig_bytes = NULL;
   pgm->read_sib = NULL;
@@ -301,11 +305,20 @@ PROGRAMMER *locate_programmer_starts_set(const LISTID programmers, const char *p
   if(!pgid || !(p1 = tolower((unsigned char) *pgid)))
     return NULL;
 
+  // An exact match wins straight away
+  if((pgm = locate_programmer_set(programmers, pgid, &matchid)) && is_programmer(pgm) && (pgm->prog_modes & pmode)) {
+    matchp = pgm;
+    matches = 1;
+    goto done;
+  }
+
   l = strlen(pgid);
   matches = 0;
   matchp = NULL;
-  for(LNODEID ln1 = lfirst(programmers); ln1; ln1 = lnext(ln1)) {
-    pgm = ldata(ln1);
+  void **v = lvec(programmers);
+
+  for(int i = 0, n = lsize(programmers); i < n; i++) {
+    pgm = v[i];
     if(is_programmer(pgm) && (pgm->prog_modes & pmode)) {
       int thispgmmatch = 0;
 
@@ -338,23 +351,44 @@ done:
   return NULL;
 }
 
+// Bring the index of programmer ids up to date (see part_index_update() in avrpart.c)
+static void pgm_index_update(const LISTID programmers) {
+  if(programmers != avr_db.pgm_idx_list || lgen(programmers) != avr_db.pgm_idx_gen || !avr_db.pgm_idx_ids) {
+    lhdestroy(avr_db.pgm_idx_ids);
+    avr_db.pgm_idx_ids = lhcreat();
+    avr_db.pgm_idx_list = programmers;
+    avr_db.pgm_idx_gen = lgen(programmers);
+    avr_db.pgm_idx_last = NULL;
+  }
+
+  for(LNODEID ln = avr_db.pgm_idx_last? lnext(avr_db.pgm_idx_last): lfirst(programmers); ln; ln = lnext(ln)) {
+    PROGRAMMER *p = ldata(ln);
+
+    for(LNODEID ln2 = lfirst(p->id); ln2; ln2 = lnext(ln2))
+      lhadd(avr_db.pgm_idx_ids, ldata(ln2), p);
+    avr_db.pgm_idx_last = ln;
+  }
+}
+
 // Locate a programmer (or serial adapter) by full name and set the matching id
 PROGRAMMER *locate_programmer_set(const LISTID programmers, const char *configid, const char **setid) {
-  for(LNODEID ln1 = lfirst(programmers); ln1; ln1 = lnext(ln1)) {
-    PROGRAMMER *p = ldata(ln1);
+  PROGRAMMER *p;
 
-    for(LNODEID ln2 = lfirst(p->id); ln2; ln2 = lnext(ln2)) {
-      const char *id = (const char *) ldata(ln2);
+  if(!programmers || !configid)
+    return NULL;
 
-      if(str_caseeq(configid, id)) {
-        if(setid)
-          *setid = id;
-        return p;
+  avr_db_lock();
+  pgm_index_update(programmers);
+  p = lhget(avr_db.pgm_idx_ids, configid);
+  avr_db_unlock();
+  if(p && setid)
+    for(LNODEID ln = lfirst(p->id); ln; ln = lnext(ln))
+      if(str_caseeq(configid, ldata(ln))) {
+        *setid = ldata(ln);
+        break;
       }
-    }
-  }
 
-  return NULL;
+  return p;
 }
 
 PROGRAMMER *locate_programmer(const LISTID programmers, const char *configid) {
@@ -120,6 +120,7 @@ struct pdata {
 
   uint8_t clock_period;         // SPI clock period in us
   int transaction_timeout;      // USB trans timeout in ms
+  int bulk;                     // Stream paged access through the firmware buffers (-x bulk)
 };
 
 #define my (*(struct pdata *) (pgm->cookie))
@@ -129,11 +130,14 @@ struct pdata {
 #define CMD_SET_VDD_4(v)    0xA0, (uint8_t)((v)*2048+672), (uint8_t)(((v)*2048+672)/256), (uint8_t)((v)*36)
 #define CMD_SET_VPP_4(v)    0xA1, 0x40, (uint8_t)((v)*18.61), (uint8_t)((v)*13)
 #define CMD_READ_VDD_VPP    0xA3
+#define CMD_DOWNLOAD_SCRIPT_3(n, len)  0xA4, (n), (len)
+#define CMD_RUN_SCRIPT_3(n, times)  0xA5, (n), (times)
 #define CMD_EXEC_SCRIPT_2(len)  0xA6, (len)
 #define CMD_CLR_DLOAD_BUFF  0xA7
 #define CMD_DOWNLOAD_DATA_2(len)  0xA8, (len)
 #define CMD_CLR_ULOAD_BUFF  0xA9
 #define CMD_UPLOAD_DATA     0xAA
+#define CMD_CLR_SCRIPT_BUFF 0xAB
 #define CMD_UPLOAD_DATA_NO_LEN     0xAC
 #define CMD_END_OF_BUFFER   0xAD
 
@@ -155,8 +159,21 @@ struct pdata {
 #define SCR_SET_AUX_2(ad, av)   0xCF, (((ad)!=0) | (((av)!=0)<<1))
 #define SCR_SPI_SETUP_PINS_4    SCR_SET_PINS_2(1,0,0,0), SCR_SET_AUX_2(0,0)
 #define SCR_SPI             0xC3
+#define SCR_SPI_WR          0xC6
 #define SCR_SPI_LIT_2(v)    0xC7,(v)
 
+/*
+ * Bulk mode: paged access streams the ISP commands into the firmware's
+ * download buffer in full reports and has them clocked out by two scripts
+ * that are stored once in the script buffer. The read script only keeps the
+ * last byte of each ISP command, so 60 read commands need four reports to
+ * the PICkit 2 and a single one back, and writes need no reports back.
+ */
+#define BULK_SCR_WRITE      0   // Script: clock out one byte of the download buffer
+#define BULK_SCR_READ       1   // Script: clock out one ISP command and upload its last byte
+#define BULK_WCHUNK         248 // Bytes per write script run (download buffer has 256 bytes)
+#define BULK_RCHUNK         60  // Commands per read script run (results fit one upload report)
+
 static void pickit2_setup(PROGRAMMER *pgm) {
   pgm->cookie = mmt_malloc(sizeof(struct pdata));
   my.transaction_timeout = 1500;  // Can be changed with -x timeout=ms
@@ -282,6 +299,20 @@ static int pickit2_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
         pmsg_error("pickit2_read_report failed (ec %d). %s\n", errorCode, usb_strerror());
         return -1;
       }
+
+      if(my.bulk) {             // Store the scripts for bulk paged access
+        static const unsigned char scripts[65] = {
+          0, CMD_CLR_SCRIPT_BUFF,
+          CMD_DOWNLOAD_SCRIPT_3(BULK_SCR_WRITE, 1), SCR_SPI_WR,
+          CMD_DOWNLOAD_SCRIPT_3(BULK_SCR_READ, 4), SCR_SPI_WR, SCR_SPI_WR, SCR_SPI_WR, SCR_SPI,
+          CMD_END_OF_BUFFER
+        };
+
+        if(pickit2_write_report(pgm, scripts) < 0) {
+          pmsg_error("cannot download bulk scripts. %s\n", usb_strerror());
+          return -1;
+        }
+      }
     } else {
       pmsg_error("pickit2_read_report failed (ec %d). %s\n", errorCode, usb_strerror());
       return -1;
@@ -422,12 +453,198 @@ static int pickit2_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
 }
 
+// Report being assembled for bulk mode
+typedef struct {
+  uint8_t report[65];
+  int fill;
+} Bulk_report;
+
+static void bulk_init(Bulk_report *b) {
+  b->report[0] = 0;
+  b->report[1] = CMD_CLR_DLOAD_BUFF;
+  b->report[2] = CMD_CLR_ULOAD_BUFF;
+  b->fill = 3;
+}
+
+static int bulk_flush(const PROGRAMMER *pgm, Bulk_report *b) {
+  int rc = 0;
+
+  if(b->fill > 1) {
+    memset(b->report + b->fill, CMD_END_OF_BUFFER, sizeof b->report - b->fill);
+    rc = pickit2_write_report(pgm, b->report) < 0? -1: 0;
+  }
+  b->fill = 1;
+
+  return rc;
+}
+
+// Append a firmware command, sending the report first if the command does not fit
+static int bulk_put(const PROGRAMMER *pgm, Bulk_report *b, const uint8_t *cmd, int len) {
+  if(b->fill + len > (int) sizeof b->report && bulk_flush(pgm, b) < 0)
+    return -1;
+  memcpy(b->report + b->fill, cmd, len);
+  b->fill += len;
+
+  return 0;
+}
+
+// Append n bytes to the download buffer using up the space left in each report
+static int bulk_download(const PROGRAMMER *pgm, Bulk_report *b, const uint8_t *data, int n) {
+  while(n > 0) {
+    int k = (int) sizeof b->report - b->fill - 2;
+
+    if(k < 1) {
+      if(bulk_flush(pgm, b) < 0)
+        return -1;
+      continue;
+    }
+    k = MIN(k, n);
+    uint8_t hd[] = { CMD_DOWNLOAD_DATA_2(k) };
+
+    memcpy(b->report + b->fill, hd, sizeof hd);
+    b->fill += sizeof hd;
+    memcpy(b->report + b->fill, data, k);
+    b->fill += k;
+    data += k, n -= k;
+  }
+
+  return 0;
+}
+
+// Clock out n bytes; the report is sent once full or by the next bulk_flush()
+static int bulk_write(const PROGRAMMER *pgm, Bulk_report *b, const uint8_t *data, int n) {
+  while(n > 0) {
+    int k = MIN(n, BULK_WCHUNK);
+    uint8_t run[] = { CMD_RUN_SCRIPT_3(BULK_SCR_WRITE, k) };
+
+    if(bulk_download(pgm, b, data, k) < 0 || bulk_put(pgm, b, run, sizeof run) < 0)
+      return -1;
+    data += k, n -= k;
+  }
+
+  return 0;
+}
+
+// Clock out nc ISP commands and store the last byte of each answer in res
+static int bulk_read(const PROGRAMMER *pgm, Bulk_report *b, const uint8_t *cmds, int nc, uint8_t *res) {
+  while(nc > 0) {
+    int k = MIN(nc, BULK_RCHUNK);
+    uint8_t run[] = { CMD_RUN_SCRIPT_3(BULK_SCR_READ, k), CMD_UPLOAD_DATA };
+
+    if(bulk_download(pgm, b, cmds, 4*k) < 0 || bulk_put(pgm, b, run, sizeof run) < 0 || bulk_flush(pgm, b) < 0)
+      return -1;
+    if(pickit2_read_report(pgm, b->report) < 0 || b->report[1] != k) {
+      pmsg_error("unexpected bulk upload of %d instead of %d bytes\n", b->report[1], k);
+      return -1;
+    }
+    memcpy(res, b->report + 2, k);
+    cmds += 4*k, res += k, nc -= k;
+  }
+
+  return 0;
+}
+
+// Read flash or EEPROM in bulk mode; returns -2 if the memory needs the normal path
+static int pickit2_bulk_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int addr, unsigned int n_bytes) {
+
+  int isflash = mem->op[AVR_OP_READ_LO] && mem->op[AVR_OP_READ_HI];
+  OPCODE *lext = isflash? mem->op[AVR_OP_LOAD_EXT_ADDR]: NULL;
+
+  // The read script only returns the last byte of each command
+  if(isflash? avr_get_output_index(mem->op[AVR_OP_READ_LO]) != 3 ||
+    avr_get_output_index(mem->op[AVR_OP_READ_HI]) != 3:
+    !mem->op[AVR_OP_READ] || avr_get_output_index(mem->op[AVR_OP_READ]) != 3)
+    return -2;
+
+  int nc = 0, maxc = n_bytes + n_bytes/0x20000 + 2;
+  uint8_t *cmds = mmt_malloc(4*maxc), *res = mmt_malloc(maxc);
+
+  for(unsigned int a = addr; a < addr + n_bytes; a++) {
+    if(lext && (a == addr || a%0x20000 == 0)) {
+      avr_set_bits(lext, cmds + 4*nc);
+      avr_set_addr(lext, cmds + 4*nc++, a/2);
+    }
+    OPCODE *rop = mem->op[!isflash? AVR_OP_READ: a & 1? AVR_OP_READ_HI: AVR_OP_READ_LO];
+
+    avr_set_bits(rop, cmds + 4*nc);
+    avr_set_addr(rop, cmds + 4*nc++, isflash? a/2: a);
+  }
+
+  Bulk_report b;
+
+  bulk_init(&b);
+  int ret = bulk_read(pgm, &b, cmds, nc, res);
+
+  if(ret >= 0) {
+    nc = 0;
+    for(unsigned int a = addr; a < addr + n_bytes; a++) {
+      uint8_t answer[4] = { 0, 0, 0, 0 };
+
+      if(lext && (a == addr || a%0x20000 == 0))
+        nc++;
+      answer[3] = res[nc++];
+      mem->buf[a] = 0;
+      avr_get_output(mem->op[!isflash? AVR_OP_READ: a & 1? AVR_OP_READ_HI: AVR_OP_READ_LO], answer, mem->buf + a);
+    }
+  }
+  mmt_free(cmds);
+  mmt_free(res);
+
+  return ret < 0? -1: (int) n_bytes;
+}
+
+// Write paged flash or EEPROM in bulk mode; returns -2 if the memory needs the normal path
+static int pickit2_bulk_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  OPCODE *wp = mem->op[AVR_OP_WRITEPAGE], *lext = mem->op[AVR_OP_LOAD_EXT_ADDR];
+  int isword = mem->op[AVR_OP_LOADPAGE_HI] && mem->op[AVR_OP_LOADPAGE_LO];
+
+  if(!mem->paged || page_size <= 1 || !wp || !mem->op[AVR_OP_LOADPAGE_LO])
+    return -2;
+
+  uint8_t *cmds = mmt_malloc(4*(page_size + 2));
+  Bulk_report b;
+  int ret = 0;
+
+  bulk_init(&b);
+  for(unsigned int pg = addr - addr%page_size; ret >= 0 && pg < addr + n_bytes; pg += page_size) {
+    unsigned int lo = pg < addr? addr: pg, hi = MIN(pg + page_size, addr + n_bytes);
+    int nc = 0;
+
+    for(unsigned int a = lo; a < hi; a++) {
+      OPCODE *lop = mem->op[isword && (a & 1)? AVR_OP_LOADPAGE_HI: AVR_OP_LOADPAGE_LO];
+
+      memset(cmds + 4*nc, 0, 4);
+      avr_set_bits(lop, cmds + 4*nc);
+      avr_set_addr(lop, cmds + 4*nc, isword? a/2: a);
+      avr_set_input(lop, cmds + 4*nc++, mem->buf[a]);
+    }
+    if(lext) {
+      memset(cmds + 4*nc, 0, 4);
+      avr_set_bits(lext, cmds + 4*nc);
+      avr_set_addr(lext, cmds + 4*nc++, isword? pg/2: pg);
+    }
+    memset(cmds + 4*nc, 0, 4);
+    avr_set_bits(wp, cmds + 4*nc);
+    avr_set_addr(wp, cmds + 4*nc++, isword? pg/2: pg);
+
+    if(bulk_write(pgm, &b, cmds, 4*nc) < 0 || bulk_flush(pgm, &b) < 0)
+      ret = -1;
+    usleep(mem->max_write_delay);
+  }
+  mmt_free(cmds);
+
+  return ret < 0? -1: (int) n_bytes;
+}
+
 static int pickit2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
 
@@ -436,6 +653,13 @@ static int pickit2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
     return -1;
   }
 
+  if(my.bulk) {
+    int rc = pickit2_bulk_paged_load(pgm, p, mem, addr, n_bytes);
+
+    if(rc != -2)
+      return rc;
+  }
+
   DEBUG("paged read ps %d, mem %s\n", page_size, mem->desc);
 
   OPCODE *readop = 0, *lext = mem->op[AVR_OP_LOAD_EXT_ADDR];
@@ -559,6 +783,13 @@ static int pickit2_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
     return -1;
   }
 
+  if(my.bulk) {
+    int rc = pickit2_bulk_paged_write(pgm, p, mem, page_size, addr, n_bytes);
+
+    if(rc != -2)
+      return rc;
+  }
+
   DEBUG("page size %d mem %s supported: %d\n", page_size, mem->desc, mem->paged);
   DEBUG("loadpagehi %x, loadpagelow %x, writepage %x\n",
     (int) mem->op[AVR_OP_LOADPAGE_HI], (int) mem->op[AVR_OP_LOADPAGE_LO], (int) mem->op[AVR_OP_WRITEPAGE]);
@@ -1039,6 +1270,11 @@ static int pickit2_parseextparams(const PROGRAMMER *pgm, const LISTID extparms)
       continue;
     }
 
+    if(str_eq(extended_param, "bulk")) {
+      my.bulk = 1;
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rv = LIBAVRDUDE_EXIT_OK;
@@ -1051,6 +1287,7 @@ static int pickit2_parseextparams(const PROGRAMMER *pgm, const LISTID extparms)
     msg_error("%s -c %s extended options:\n", progname, pgmid);
     msg_error("  -x clockrate=<n> Set the SPI clock rate to <n> Hz\n");
     msg_error("  -x timeout=<n>   Set the timeout for USB read/write to <n> ms\n");
+    msg_error("  -x bulk          Stream paged access through the firmware buffers\n");
     msg_error("  -x help          Show this help menu and exit\n");
     return rv;
   }
@@ -50,6 +50,7 @@
 #define USB_PK5_DATA_WRITE_EP 0x04
 
 #define USB_PK5_MAX_XFER    512 // That's the size Pickit reports
+#define PK5_MAX_READ_RUN   1024 // Largest flash block read by one script
 
 #define CHECK_ERROR        0x01
 #define BIST_TEST          0x02
@@ -101,8 +102,12 @@ struct pdata {
   unsigned char prodsig[256];   // Buffer for Prodsig that contains more then one memory
   unsigned int prod_sig_len;    // Length of read prodsig (to know if it got  filled)
   unsigned char txBuf[2048];    // Buffer for transfers
+  const unsigned char *tx_script; // Lookup-table script whose bytes are currently held in txBuf
+  unsigned int tx_script_pos, tx_script_len;
   unsigned char rxBuf[2048];    // 2048 because of WriteEEmem_dw with 1728 bytes length
   SCRIPT scripts;
+  SCRIPT dw_scripts, isp_scripts; // debugWIRE: both script sets, resolved once at initialize
+  unsigned char isp_scripts_ok;
 };
 
 #define my (*(struct pdata *)(pgm->cookie))
@@ -414,6 +419,17 @@ static int pickit5_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
 #define SCR_UPLOAD    0x80000102
 #define SCR_DOWNLOAD 0x0C0000101
 
+/*
+ * Page scripts come from the read-only lookup tables and are sent again for
+ * every page; other scripts are often arrays on the stack whose address can
+ * be reused with different contents, so only page scripts are cached in txBuf
+ */
+static int pickit5_cached_script(const PROGRAMMER *pgm, const unsigned char *script) {
+  return script == my.scripts.ReadProgmem || script == my.scripts.WriteProgmem ||
+    script == my.scripts.ReadBootMem || script == my.scripts.WriteBootMem ||
+    script == my.scripts.ReadDataEEmem || script == my.scripts.WriteDataEEmem;
+}
+
 static int pickit5_send_script(const PROGRAMMER *pgm, unsigned int script_type,
   const unsigned char *script, unsigned int script_len,
   const unsigned char *param, unsigned int param_len, unsigned int payload_len) {
@@ -440,7 +456,17 @@ static int pickit5_send_script(const PROGRAMMER *pgm, unsigned int script_type,
   if(param != NULL)
     memcpy(&buf[24], param, param_len);
 
-  memcpy(&buf[preamble_len], script, script_len);
+  /*
+   * Page transfers repeat the same script, so only copy it when txBuf holds a
+   * different one; this saves host-side copying only, as the whole message is
+   * sent each time
+   */
+  if(script != my.tx_script || preamble_len != my.tx_script_pos || script_len != my.tx_script_len) {
+    memcpy(&buf[preamble_len], script, script_len);
+    my.tx_script = pickit5_cached_script(pgm, script)? script: NULL;
+    my.tx_script_pos = preamble_len;
+    my.tx_script_len = script_len;
+  }
 
   if(serial_send(&pgm->fd, buf, message_len) < 0) {
     return LIBAVRDUDE_GENERAL_FAILURE;
@@ -501,6 +527,7 @@ static int pickit5_get_status(const PROGRAMMER *pgm, unsigned char status) {
   const unsigned int type = 0x0105;
   unsigned int key_len = 0;
 
+  my.tx_script = NULL;          // Key below overwrites any script held in txBuf
   if(CHECK_ERROR == status) {
     key_len = strlen("ERROR_STATUS_KEY") + 1;
     memcpy(&buf[16], "ERROR_STATUS_KEY", key_len);
@@ -1012,7 +1039,10 @@ static int pickit5_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
   unsigned int default_baud;
 
   if(both_debugwire(pgm, p)) {
-    rc = get_pickit_dw_script(&(my.scripts), p->desc);
+    rc = get_pickit_dw_script(&(my.dw_scripts), p->desc);
+    my.scripts = my.dw_scripts;
+    // Fuse access switches to ISP; resolve its scripts now rather than on every switch
+    my.isp_scripts_ok = get_pickit_isp_script(&(my.isp_scripts), p->desc) >= 0;
     default_baud = 125000;      // debugWIRE does not allow to select speed, this is for ISP mode
   } else if(both_isp(pgm, p)) {
     rc = get_pickit_isp_script(&(my.scripts), p->desc);
@@ -1197,10 +1227,26 @@ static int pickit5_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   return LIBAVRDUDE_GENERAL_FAILURE;
 }
 
+/*
+ * Flash runs of several pages are streamed through one read script; other memories go page-wise.
+ * Streamed blocks are capped at PK5_MAX_READ_RUN, which is the flash read size that ISP, debugWIRE
+ * and PDI have always used with this driver (see readsize in pickit5_enable()), so UPDI flash reads
+ * are no longer than ReadProgmem uploads the programmer is known to handle; JTAG keeps its 512 bytes.
+ */
 static int pickit5_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned int page_size, unsigned int address, unsigned int n_bytes) {
 
-  return pickit5_read_array(pgm, p, mem, address, n_bytes, &mem->buf[address]);
+  int stream = mem_is_in_flash(mem) && !is_tpi(pgm) && !(is_isp(pgm) && mem->mode == 0x04);
+  unsigned int max = both_jtag(pgm, p) || page_size > PK5_MAX_READ_RUN? page_size: PK5_MAX_READ_RUN;
+  unsigned int chunk = page_size == 0? n_bytes: stream? max: page_size;
+
+  for(unsigned int end = address + n_bytes; address < end; address += chunk) {
+    if(chunk > end - address)
+      chunk = end - address;
+    if(pickit5_read_array(pgm, p, mem, address, chunk, &mem->buf[address]) < 0)
+      return -1;
+  }
+  return n_bytes;
 }
 
 static int pickit5_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
@@ -1701,10 +1747,11 @@ static void pickit5_dw_switch_to_isp(const PROGRAMMER *pgm, const AVRPART *p) {
     if(pickit5_send_script_cmd(pgm, my.scripts.switchtoISP, my.scripts.switchtoISP_len, NULL, 0) >= 0) {
       my.dW_switched_isp = 1;
       pickit5_program_disable(pgm, p);
-      if(get_pickit_isp_script(&(my.scripts), p->desc) < 0) {
+      if(!my.isp_scripts_ok) {
         pmsg_error("failed switching scripts, aborting\n");
         return;
       }
+      my.scripts = my.isp_scripts;
       pmsg_notice("switched to ISP mode\n");
       pickit5_set_sck_period(pgm, 1.0 / my.actual_pgm_clk);
       pickit5_program_enable(pgm, p);
@@ -1722,10 +1769,7 @@ static void pickit5_isp_switch_to_dw(const PROGRAMMER *pgm, const AVRPART *p) {
     if(my.power_source == POWER_SOURCE_INT) {
       pickit5_program_disable(pgm, p);
       pickit5_set_vtarget(pgm, 0.0); // Has a little delay already built in
-      if(get_pickit_dw_script(&(my.scripts), p->desc) < 0) {
-        pmsg_error("failed switching scripts, aborting\n");
-        return;
-      }
+      my.scripts = my.dw_scripts;
       pickit5_set_vtarget(pgm, my.target_voltage);
       pickit5_program_enable(pgm, p);
       my.dW_switched_isp = 0;
@@ -2211,6 +2255,7 @@ void pickit5_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = pickit5_paged_write;
   pgm->paged_load = pickit5_paged_load;
+  pgm->multipage_load = 1;
   pgm->setup = pickit5_setup;
   pgm->teardown = pickit5_teardown;
   pgm->set_sck_period = pickit5_set_sck_period;
@@ -2235,10 +2280,7 @@ static int usbdev_check_connected(unsigned int vid, unsigned int pid) {
   struct usb_bus *bus;
   struct usb_device *dev;
 
-  usb_init();
-
-  usb_find_busses();
-  usb_find_devices();
+  usb_enum_busses();
 
   for(bus = usb_get_busses(); bus; bus = bus->next) {
     for(dev = bus->devices; dev; dev = dev->next) {
@@ -2282,7 +2324,7 @@ static int usbdev_bulk_recv(const union filedescriptor *fd, unsigned char *buf,
     i += amnt;
   }
 
-  if(verbose > 4)
+  if(msg_lvl_on(MSG_TRACE2))
     trace_buffer(__func__, p, i);
 
   return 0;
@@ -2315,7 +2357,7 @@ static int usbdev_bulk_send(const union filedescriptor *fd, const unsigned char
     i += tx_size;
   } while(mlen > 0);
 
-  if(verbose > 3)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, p, i);
   return 0;
 }
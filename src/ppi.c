@@ -87,8 +87,10 @@ int ppi_set(const union filedescriptor *fdp, int reg, int bit) {
   int rc;
 
   rc = ppi_shadow_access(fdp, reg, &v, PPI_SHADOWREAD);
-  v |= bit;
-  rc |= ppi_shadow_access(fdp, reg, &v, PPI_WRITE);
+  if(!rc && (v | bit) != v) { // Only write on actual change
+    v |= bit;
+    rc = ppi_shadow_access(fdp, reg, &v, PPI_WRITE);
+  }
 
   if(rc)
     return -1;
@@ -102,8 +104,10 @@ int ppi_clr(const union filedescriptor *fdp, int reg, int bit) {
   int rc;
 
   rc = ppi_shadow_access(fdp, reg, &v, PPI_SHADOWREAD);
-  v &= ~bit;
-  rc |= ppi_shadow_access(fdp, reg, &v, PPI_WRITE);
+  if(!rc && (v & ~bit) != v) { // Only write on actual change
+    v &= ~bit;
+    rc = ppi_shadow_access(fdp, reg, &v, PPI_WRITE);
+  }
 
   if(rc)
     return -1;
@@ -167,6 +171,34 @@ int ppi_setall(const union filedescriptor *fdp, int reg, int val) {
   return 0;
 }
 
+/*
+ * Write the bits in mask of vals[0], ..., vals[n-1] to reg in turn, keeping
+ * the other bits as they are and skipping writes that would not change the
+ * register. If status is not NULL, the status register is read after every
+ * second value into status[i/2], eg, after each rising clock edge when the
+ * values are pairs of clock low and clock high.
+ */
+int ppi_writeseq(const union filedescriptor *fdp, int reg, int mask, const unsigned char *vals, int n,
+  unsigned char *status) {
+
+  unsigned char v, cur;
+
+  if(ppi_shadow_access(fdp, reg, &cur, PPI_SHADOWREAD))
+    return -1;
+
+  for(int i = 0; i < n; i++) {
+    v = (cur & ~mask) | (vals[i] & mask);
+    if(v != cur) {
+      ppi_shadow_access(fdp, reg, &v, PPI_WRITE);
+      cur = v;
+    }
+    if(status && i%2)
+      ppi_shadow_access(fdp, PPISTATUS, status + i/2, PPI_READ);
+  }
+
+  return 0;
+}
+
 void ppi_open(const char *port, union filedescriptor *fdp) {
   int fd;
   unsigned char v;
@@ -179,13 +211,12 @@ void ppi_open(const char *port, union filedescriptor *fdp) {
   }
 
   ppi_claim(fd);
+  fdp->ifd = fd;
 
   // Initialize shadow registers
   ppi_shadow_access(fdp, PPIDATA, &v, PPI_READ);
   ppi_shadow_access(fdp, PPICTRL, &v, PPI_READ);
   ppi_shadow_access(fdp, PPISTATUS, &v, PPI_READ);
-
-  fdp->ifd = fd;
 }
 
 void ppi_close(const union filedescriptor *fdp) {
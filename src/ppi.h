@@ -42,6 +42,9 @@ extern "C" {
 
   int ppi_toggle(const union filedescriptor *fdp, int reg, int bit);
 
+  int ppi_writeseq(const union filedescriptor *fdp, int reg, int mask, const unsigned char *vals, int n,
+    unsigned char *status);
+
   void ppi_open(const char *port, union filedescriptor *fdp);
 
   void ppi_close(const union filedescriptor *fdp);
@@ -21,6 +21,13 @@
 # m.get(3) == p.signature
 # stop_programmer(pgm)
 
+# Zero-copy access to memory buffers, eg, for comparing whole flash images:
+# m = ad.avr_locate_mem(p, 'flash')
+# v = m.view()
+# v[:4] = b'\x0c\x94\x34\x00'
+# bytes(v) == open('image.bin', 'rb').read()
+# m.put(bytearray(128), 0x100)  # Any bytes-like object, sets ALLOCATED tags
+
 # ad.fileio(ad.FIO_WRITE, "test.hex", ad.fileio_format("i"), p, "flash", -1)
 
 # cfg=ad.get_config_table('atmega128')
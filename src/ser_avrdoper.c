@@ -250,8 +250,9 @@ static int avrdoper_send(const union filedescriptor *fdp, const unsigned char *b
 
 // -------------------------------------------------------------------------
 
-static int avrdoperFillBuffer(const union filedescriptor *fdp) {
-  int bytesPending = reportDataSizes[1];        // Guess how much data is buffered in device
+// Fill the rx buffer starting with a report that fits the wanted bytes, which is a guess of what the device holds
+static int avrdoperFillBuffer(const union filedescriptor *fdp, int wanted) {
+  int bytesPending = wanted > reportDataSizes[1]? wanted: reportDataSizes[1];
 
   cx->sad_avrdoperRxPosition = cx->sad_avrdoperRxLength = 0;
   while(bytesPending > 0) {
@@ -290,7 +291,7 @@ static int avrdoper_recv(const union filedescriptor *fdp, unsigned char *buf, si
     int len, available = cx->sad_avrdoperRxLength - cx->sad_avrdoperRxPosition;
 
     if(available <= 0) {        // Buffer is empty
-      if(avrdoperFillBuffer(fdp) < 0)
+      if(avrdoperFillBuffer(fdp, remaining) < 0)
         return -1;
       continue;
     }
@@ -309,7 +310,7 @@ static int avrdoper_recv(const union filedescriptor *fdp, unsigned char *buf, si
 
 static int avrdoper_drain(const union filedescriptor *fdp, int display) {
   do {
-    if(avrdoperFillBuffer(fdp) < 0)
+    if(avrdoperFillBuffer(fdp, 0) < 0)
       return -1;
   } while(cx->sad_avrdoperRxLength > 0);
   return 0;
@@ -325,6 +326,7 @@ static int avrdoper_set_dtr_rts(const union filedescriptor *fdp, int is_on) {
 // -------------------------------------------------------------------------
 
 struct serial_device avrdoper_serdev = {
+  .name = "avrdoper",
   .open = avrdoper_open,
   .close = avrdoper_close,
   .rawclose = avrdoper_close,
@@ -32,7 +32,10 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 
 #include <fcntl.h>
@@ -46,8 +49,8 @@
 #include "avrdude.h"
 #include "libavrdude.h"
 
-long serial_recv_timeout = 5000;        // ms
-long serial_drain_timeout = 250;        // ms
+LIBAVRDUDE_THREAD_LOCAL long serial_recv_timeout = 5000; // ms, per session
+LIBAVRDUDE_THREAD_LOCAL long serial_drain_timeout = 250; // ms, per session
 
 struct baud_mapping {
   long baud;
@@ -278,6 +281,106 @@ static int ser_setparams(const union filedescriptor *fd, long baud, unsigned lon
   return 0;
 }
 
+// Is fd the TCP connection of a net: port?
+static int ser_isnet(const union filedescriptor *fd) {
+  return cx->ser_isnet && cx->ser_netfd == fd->ifd;
+}
+
+// Write all len bytes to fd, chunked if chunk > 0, waiting while the non-blocking fd is full
+static int ser_write(const union filedescriptor *fd, const unsigned char *buf, size_t len, size_t chunk) {
+  while(len) {
+    ssize_t rc = write(fd->ifd, buf, chunk && len > chunk? chunk: len);
+
+    if(rc < 0) {
+      if(errno == EINTR)
+        continue;
+      if(errno == EAGAIN || errno == EWOULDBLOCK) {
+        struct pollfd pfd = {.fd = fd->ifd, .events = POLLOUT };
+        int n = cx->ser_wait_hook? cx->ser_wait_hook(fd->ifd, 1, serial_recv_timeout):
+          poll(&pfd, 1, serial_recv_timeout);
+
+        if(n > 0 || (n < 0 && errno == EINTR))
+          continue;
+        if(n == 0)
+          errno = ETIMEDOUT;
+      }
+      pmsg_ext_error("unable to write: %s\n", strerror(errno));
+      return -1;
+    }
+    buf += rc;
+    len -= rc;
+  }
+
+  return 0;
+}
+
+// Send what ser_send() has coalesced for a net: port
+static int ser_txflush(const union filedescriptor *fd) {
+  int len = cx->ser_txlen;
+
+  if(!len || !ser_isnet(fd))
+    return 0;
+  cx->ser_txlen = 0;
+
+  return ser_write(fd, cx->ser_txbuf, len, 0);
+}
+
+// Forget the net: port state when its connection is closed
+static void ser_netforget(const union filedescriptor *fd) {
+  if(ser_isnet(fd)) {
+    ser_txflush(fd);
+    cx->ser_isnet = 0;
+    cx->ser_txlen = 0;
+  }
+}
+
+/*
+ * Ask the kernel to acknowledge received data at once: a bridge that waits
+ * for the ACK before sending the rest of a reply would otherwise stall for
+ * the delayed-ACK timeout. Linux resets this after some time, so ser_recv()
+ * renews it after each read.
+ */
+static void net_quickack(int fd) {
+#if defined(TCP_QUICKACK)
+  int on = 1;
+
+  setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof on);
+#else
+  (void) fd;
+#endif
+}
+
+/*
+ * Tune a TCP connection to a serial bridge for the short request/response
+ * exchanges of programmer protocols: send small packets right away rather
+ * than waiting for the ACK of the previous one (Nagle), detect a bridge that
+ * silently went away, and make the socket non-blocking as ser_recv() only
+ * waits in poll(), which honours serial_recv_timeout
+ */
+static void net_tune(int fd) {
+  int on = 1, bufsize = 64*1024;
+
+  if(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on) < 0)
+    pmsg_warning("cannot set TCP_NODELAY: %s\n", strerror(errno));
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof on);
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+  int idle = 10, intvl = 5, cnt = 3;
+
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof idle);
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof intvl);
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof cnt);
+#endif
+  // Room for a full flash page write or read-back in flight
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof bufsize);
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof bufsize);
+  net_quickack(fd);
+
+  int flags = fcntl(fd, F_GETFL);
+
+  if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    pmsg_warning("cannot make socket non-blocking: %s\n", strerror(errno));
+}
+
 /*
  * Given a port description of the form <host>:<port>, open a TCP connection to
  * the specified destination, which is assumed to be a terminal/console server
@@ -335,7 +438,11 @@ static int net_open(const char *port, union filedescriptor *fdp) {
   if(rp == NULL) {
     pmsg_ext_error("cannot connect: %s\n", strerror(errno));
   } else {
+    net_tune(fd);
     fdp->ifd = fd;
+    cx->ser_netfd = fd;
+    cx->ser_isnet = 1;
+    cx->ser_txlen = 0;
     ret = 0;
   }
   freeaddrinfo(result);
@@ -349,6 +456,9 @@ static int ser_set_dtr_rts(const union filedescriptor *fdp, int is_on) {
   unsigned int ctl;
   int r;
 
+  if(ser_isnet(fdp))            // No modem control lines on a TCP connection
+    return ser_txflush(fdp);
+
   r = ioctl(fdp->ifd, TIOCMGET, &ctl);
   if(r < 0) {
     pmsg_ext_error("ioctl(\"TIOCMGET\"): %s\n", strerror(errno));
@@ -403,7 +513,16 @@ static int ser_open(const char *port, union pinfo pinfo, union filedescriptor *f
   return 0;
 }
 
+// Forget bytes read ahead from fd, eg, when it is closed
+static void ser_rxforget(const union filedescriptor *fd) {
+  if(cx->ser_rxfd == fd->ifd)
+    cx->ser_rxlen = cx->ser_rxpos = 0;
+}
+
 static void ser_close(union filedescriptor *fd) {
+  ser_rxforget(fd);
+  ser_netforget(fd);
+
   // Restore original termios settings from ser_open
   if(cx->ser_saved_original_termios) {
     int rc = tcsetattr(fd->ifd, TCSANOW | TCSADRAIN, &cx->ser_original_termios);
@@ -418,117 +537,177 @@ static void ser_close(union filedescriptor *fd) {
 
 // Close but don't restore attributes
 static void ser_rawclose(union filedescriptor *fd) {
+  ser_rxforget(fd);
+  ser_netforget(fd);
   cx->ser_saved_original_termios = 0;
   close(fd->ifd);
 }
 
+/*
+ * Send len bytes. Many protocols send a request in several pieces, eg, a
+ * command and then its payload or end-of-packet byte; for a net: port these
+ * are coalesced and only written once the reply is awaited in ser_recv(), so
+ * that each request travels as a single TCP segment.
+ */
 static int ser_send(const union filedescriptor *fd, const unsigned char *buf, size_t len) {
-  int rc;
-
-  if(verbose >= MSG_TRACE)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, buf, len);
 
-  while(len) {
-    rc = write(fd->ifd, buf, len > 1024? 1024: len);
-    if(rc < 0) {
-      pmsg_ext_error("unable to write: %s\n", strerror(errno));
+  if(!ser_isnet(fd))
+    return ser_write(fd, buf, len, 1024);
+
+  if(cx->ser_txlen + len > sizeof cx->ser_txbuf && ser_txflush(fd) < 0)
+    return -1;
+  if(len >= sizeof cx->ser_txbuf)
+    return ser_write(fd, buf, len, 0);
+  memcpy(cx->ser_txbuf + cx->ser_txlen, buf, len);
+  cx->ser_txlen += len;
+
+  return 0;
+}
+
+/*
+ * Wait until fd has data to read; returns 1 if so, 0 on timeout and -1 on
+ * error
+ */
+static int ser_waitrx(const union filedescriptor *fd, int timeout_ms) {
+  struct pollfd pfd = {.fd = fd->ifd, .events = POLLIN};
+
+  if(cx->ser_wait_hook)         // Eg, yield to the reactor of avrreactor.c
+    return cx->ser_wait_hook(fd->ifd, 0, timeout_ms);
+
+  while(1) {
+    int nfds = poll(&pfd, 1, timeout_ms);
+
+    if(nfds > 0)
+      return 1;
+    if(nfds == 0)
+      return 0;
+    if(errno != EINTR && errno != EAGAIN) {
+      pmsg_ext_error("poll(): %s\n", strerror(errno));
       return -1;
     }
-    buf += rc;
-    len -= rc;
   }
-
-  return 0;
 }
 
+/*
+ * Receive buflen bytes. The fd is non-blocking, so read() is tried first and
+ * poll() only waits when nothing is pending. Short requests read ahead into
+ * a buffer so that the typical status byte followed by a payload costs one
+ * read() rather than two; long requests go straight into the caller's buffer.
+ */
 static int ser_recv(const union filedescriptor *fd, unsigned char *buf, size_t buflen) {
-  struct timeval timeout, to2;
-  fd_set rfds;
-  int nfds;
-  int rc;
   unsigned char *p = buf;
   size_t len = 0;
+  int polled = 0, net = ser_isnet(fd);
 
-  timeout.tv_sec = serial_recv_timeout/1000L;
-  timeout.tv_usec = (serial_recv_timeout%1000L)*1000;
+  if(net && ser_txflush(fd) < 0)
+    return -1;
 
   while(len < buflen) {
-    to2 = timeout;
-  reselect:
-    FD_ZERO(&rfds);
-    FD_SET(fd->ifd, &rfds);
+    // Serve bytes read ahead on this descriptor first
+    if(cx->ser_rxpos < cx->ser_rxlen && cx->ser_rxfd == fd->ifd) {
+      size_t n = cx->ser_rxlen - cx->ser_rxpos;
+
+      if(n > buflen - len)
+        n = buflen - len;
+      memcpy(p, cx->ser_rxbuf + cx->ser_rxpos, n);
+      cx->ser_rxpos += n;
+      p += n;
+      len += n;
+      continue;
+    }
 
-    nfds = select(fd->ifd + 1, &rfds, NULL, NULL, &to2);
-    if(nfds == 0) {
-      pmsg_notice2("%s(): programmer is not responding\n", __func__);
-      return -1;
-    } else if(nfds == -1) {
-      if(errno == EINTR || errno == EAGAIN) {
-        pmsg_warning("programmer is not responding, reselecting\n");
-        goto reselect;
+    // Read ahead only if the request is short and the buffer is not in use for another fd
+    int ahead = buflen - len < sizeof cx->ser_rxbuf && cx->ser_rxpos >= cx->ser_rxlen;
+    ssize_t rc = ahead? read(fd->ifd, cx->ser_rxbuf, sizeof cx->ser_rxbuf): read(fd->ifd, p, buflen - len);
+
+    if(rc > 0) {
+      polled = 0;
+      if(net)
+        net_quickack(fd->ifd);
+      if(ahead) {
+        cx->ser_rxfd = fd->ifd;
+        cx->ser_rxpos = 0;
+        cx->ser_rxlen = rc;
       } else {
-        pmsg_ext_error("select(): %s\n", strerror(errno));
-        return -1;
+        p += rc;
+        len += rc;
       }
+      continue;
     }
 
-    rc = read(fd->ifd, p, buflen - len > 1024? 1024: buflen - len);
-    if(rc < 0) {
+    if(rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
       pmsg_ext_error("unable to read: %s\n", strerror(errno));
       return -1;
     }
-    p += rc;
-    len += rc;
+
+    if(rc == 0 && polled) {     // Readable but nothing to read: end of file
+      pmsg_ext_error("unable to read: connection closed\n");
+      return -1;
+    }
+
+    int ready = ser_waitrx(fd, serial_recv_timeout);
+
+    if(ready == 0) {
+      pmsg_notice2("%s(): programmer is not responding\n", __func__);
+      return -1;
+    }
+    if(ready < 0)
+      return -1;
+    polled = 1;
   }
 
-  if(verbose >= MSG_TRACE)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, buf, len);
 
   return 0;
 }
 
+// Discard all input, reading whatever the kernel has buffered in bulk
 static int ser_drain(const union filedescriptor *fd, int display) {
-  struct timeval timeout;
-  fd_set rfds;
-  int nfds;
+  unsigned char buf[1024];
   int rc;
-  unsigned char buf;
 
-  timeout.tv_sec = 0;
-  timeout.tv_usec = serial_drain_timeout*1000L;
+  if(ser_txflush(fd) < 0)
+    return -1;
 
   if(display) {
     msg_info("drain>");
   }
 
-  while(1) {
-    FD_ZERO(&rfds);
-    FD_SET(fd->ifd, &rfds);
+  // Bytes read ahead are part of what is to be drained
+  if(cx->ser_rxfd == fd->ifd) {
+    if(display)
+      for(int i = cx->ser_rxpos; i < cx->ser_rxlen; i++)
+        msg_info("%02x ", cx->ser_rxbuf[i]);
+    cx->ser_rxlen = cx->ser_rxpos = 0;
+  }
 
-  reselect:
-    nfds = select(fd->ifd + 1, &rfds, NULL, NULL, &timeout);
-    if(nfds == 0) {
+  while(1) {
+    rc = ser_waitrx(fd, serial_drain_timeout);
+    if(rc == 0) {
       if(display) {
         msg_info("<drain\n");
       }
 
       break;
-    } else if(nfds == -1) {
-      if(errno == EINTR) {
-        goto reselect;
-      } else {
-        pmsg_ext_error("select(): %s\n", strerror(errno));
-        return -1;
-      }
+    } else if(rc < 0) {
+      return -1;
     }
 
-    rc = read(fd->ifd, &buf, 1);
+    rc = read(fd->ifd, buf, sizeof buf);
     if(rc < 0) {
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        continue;
       pmsg_ext_error("unable to read: %s\n", strerror(errno));
       return -1;
     }
+    if(rc == 0)                 // End of file
+      break;
     if(display) {
-      msg_info("%02x ", buf);
+      for(int i = 0; i < rc; i++)
+        msg_info("%02x ", buf[i]);
     }
   }
 
@@ -536,6 +715,7 @@ static int ser_drain(const union filedescriptor *fd, int display) {
 }
 
 struct serial_device serial_serdev = {
+  .name = "serial",
   .open = ser_open,
   .setparams = ser_setparams,
   .close = ser_close,
@@ -547,5 +727,5 @@ struct serial_device serial_serdev = {
   .flags = SERDEV_FL_CANSETSPEED,
 };
 
-struct serial_device *serdev = &serial_serdev;
+LIBAVRDUDE_THREAD_LOCAL struct serial_device *serdev = &serial_serdev;
 #endif                          // WIN32
@@ -27,16 +27,37 @@
 #include <winsock2.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>              // For isprint
 #include <errno.h>              // ENOTTY
 
 #include "avrdude.h"
 #include "libavrdude.h"
 
-long serial_recv_timeout = 5000;        // ms
-long serial_drain_timeout = 250;        // ms
+LIBAVRDUDE_THREAD_LOCAL long serial_recv_timeout = 5000; // ms, per session
+LIBAVRDUDE_THREAD_LOCAL long serial_drain_timeout = 250; // ms, per session
 
 #define W32SERBUFSIZE 1024
+#define W32RXBUFSIZE 4096       // Receive buffer filled by the background read
+#define W32RXIDLE 1000          // ms a background read waits for a first byte before it is reissued
+
+/*
+ * Serial ports are opened for overlapped I/O: a background ReadFile()
+ * collects incoming bytes into rxbuf between calls, and COMMTIMEOUTS let it
+ * complete as soon as at least one byte has arrived, so ser_recv() and
+ * ser_drain() mostly copy out of the buffer rather than wait for the driver.
+ */
+typedef struct {
+  HANDLE h;
+  OVERLAPPED rov, wov;          // Background read and current write
+  int rpending;                 // Background read into rxbuf + rxlen outstanding
+  DWORD rxpos, rxlen;           // Bytes consumed and bytes valid in rxbuf
+  unsigned char rxbuf[W32RXBUFSIZE];
+} W32port;
+
+#define w32port(fd) ((W32port *) (fd)->pfd)
+
+static void ser_close(union filedescriptor *fd);
 
 struct baud_mapping {
   long baud;
@@ -70,26 +91,94 @@ static DWORD serial_baud_lookup(long baud) {
   return baud;
 }
 
-// Set read timeout in ms
-static BOOL serial_w32SetTimeOut(HANDLE hComPort, DWORD timeout) {
-  COMMTIMEOUTS ctmo;
+/*
+ * Set timeouts once at open: reads return as soon as at least one byte is
+ * there or after W32RXIDLE ms; writes may take 100 ms per byte plus 2 s,
+ * which caters for 110 baud or faster
+ */
+static BOOL serial_w32SetTimeOuts(HANDLE hComPort) {
+  COMMTIMEOUTS ctmo = {0};
 
-  ZeroMemory(&ctmo, sizeof(COMMTIMEOUTS));
-  ctmo.ReadIntervalTimeout = 0;
-  ctmo.ReadTotalTimeoutMultiplier = 0;
-  ctmo.ReadTotalTimeoutConstant = timeout;
+  ctmo.ReadIntervalTimeout = MAXDWORD;
+  ctmo.ReadTotalTimeoutMultiplier = MAXDWORD;
+  ctmo.ReadTotalTimeoutConstant = W32RXIDLE;
+  ctmo.WriteTotalTimeoutMultiplier = 100;
+  ctmo.WriteTotalTimeoutConstant = 2000;
 
   return SetCommTimeouts(hComPort, &ctmo);
 }
 
-// Set read/write timeout in ms
-static BOOL serial_w32SetRWTimeOut(HANDLE hComPort, DWORD timeout) {
-  COMMTIMEOUTS ctmo = {0};
+static void serial_w32error(const char *what) {
+  LPVOID lpMsgBuf;
+
+  FormatMessage(
+    FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+    NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // Default language
+    (LPTSTR) & lpMsgBuf, 0, NULL);
+  pmsg_error("%s: %s\n", what, (char *) lpMsgBuf);
+  LocalFree(lpMsgBuf);
+}
 
-  ctmo.ReadTotalTimeoutConstant = timeout;
-  ctmo.WriteTotalTimeoutConstant = timeout;
+// Issue a background read into the free part of rxbuf unless one is outstanding or rxbuf is full
+static int w32_rxstart(W32port *wp) {
+  DWORD n;
 
-  return SetCommTimeouts(hComPort, &ctmo);
+  if(wp->rpending)
+    return 0;
+  if(wp->rxpos) {               // Move unconsumed bytes to the front
+    memmove(wp->rxbuf, wp->rxbuf + wp->rxpos, wp->rxlen - wp->rxpos);
+    wp->rxlen -= wp->rxpos;
+    wp->rxpos = 0;
+  }
+  if(wp->rxlen == W32RXBUFSIZE)
+    return 0;
+
+  ResetEvent(wp->rov.hEvent);
+  if(ReadFile(wp->h, wp->rxbuf + wp->rxlen, W32RXBUFSIZE - wp->rxlen, NULL, &wp->rov)) {
+    if(!GetOverlappedResult(wp->h, &wp->rov, &n, FALSE)) { // Completed right away
+      serial_w32error("unable to read");
+      return -1;
+    }
+    wp->rxlen += n;
+    return 0;
+  }
+  if(GetLastError() != ERROR_IO_PENDING) {
+    serial_w32error("unable to read");
+    return -1;
+  }
+  wp->rpending = 1;
+
+  return 0;
+}
+
+// Wait up to ms for more bytes; returns the number of bytes added to rxbuf or -1 on error
+static int w32_rxwait(W32port *wp, DWORD ms) {
+  DWORD n, before = wp->rxlen - wp->rxpos;
+
+  if(w32_rxstart(wp) < 0)
+    return -1;
+  if(wp->rxlen - wp->rxpos > before)
+    return wp->rxlen - wp->rxpos - before;
+  if(!wp->rpending)             // Buffer full
+    return 0;
+
+  switch(WaitForSingleObject(wp->rov.hEvent, ms)) {
+  case WAIT_OBJECT_0:
+    break;
+  case WAIT_TIMEOUT:
+    return 0;
+  default:
+    serial_w32error("unable to wait for serial data");
+    return -1;
+  }
+  wp->rpending = 0;
+  if(!GetOverlappedResult(wp->h, &wp->rov, &n, FALSE)) {
+    serial_w32error("unable to read");
+    return -1;
+  }
+  wp->rxlen += n;
+
+  return n;
 }
 
 static int ser_setparams(const union filedescriptor *fd, long baud, unsigned long cflags) {
@@ -97,7 +186,7 @@ static int ser_setparams(const union filedescriptor *fd, long baud, unsigned lon
     return -ENOTTY;
 
   DCB dcb;
-  HANDLE hComPort = (HANDLE) fd->pfd;
+  HANDLE hComPort = w32port(fd)->h;
 
   ZeroMemory(&dcb, sizeof(DCB));
   dcb.DCBlength = sizeof(DCB);
@@ -210,6 +299,12 @@ static int net_open(const char *port, union filedescriptor *fdp) {
     return -1;
   }
 
+  // Send the short requests of programmer protocols right away rather than waiting for ACKs (Nagle)
+  BOOL on = TRUE;
+
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *) &on, sizeof on);
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (const char *) &on, sizeof on);
+
   fdp->ifd = fd;
 
   cx->ser_serial_over_ethernet = 1;
@@ -239,7 +334,8 @@ static int ser_open(const char *port, union pinfo pinfo, union filedescriptor *f
     port = newname;
   }
 
-  hComPort = CreateFile(port, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  hComPort = CreateFile(port, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
 
   if(hComPort == INVALID_HANDLE_VALUE) {
     FormatMessage(
@@ -257,23 +353,37 @@ static int ser_open(const char *port, union pinfo pinfo, union filedescriptor *f
     return -1;
   }
 
-  fdp->pfd = (void *) hComPort;
+  W32port *wp = mmt_malloc(sizeof *wp);
+
+  wp->h = hComPort;
+  wp->rov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  wp->wov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  fdp->pfd = wp;
+  if(!wp->rov.hEvent || !wp->wov.hEvent) {
+    pmsg_error("cannot create events for %s\n", port);
+    goto error;
+  }
+
   if(ser_setparams(fdp, pinfo.serialinfo.baud, pinfo.serialinfo.cflags) != 0) {
-    CloseHandle(hComPort);
     pmsg_error("cannot set com-state for %s\n", port);
-    return -1;
+    goto error;
   }
 
-  if(!serial_w32SetTimeOut(hComPort, 0)) {
-    CloseHandle(hComPort);
-    pmsg_error("cannot set initial timeout for %s\n", port);
-    return -1;
+  if(!serial_w32SetTimeOuts(hComPort)) {
+    pmsg_error("cannot set timeouts for %s\n", port);
+    goto error;
   }
 
-  if(newname != 0) {
-    mmt_free(newname);
-  }
+  if(w32_rxstart(wp) < 0)       // Start collecting input right away
+    goto error;
+
+  mmt_free(newname);
   return 0;
+
+error:
+  ser_close(fdp);
+  mmt_free(newname);
+  return -1;
 }
 
 static void ser_close(union filedescriptor *fd) {
@@ -281,12 +391,22 @@ static void ser_close(union filedescriptor *fd) {
     closesocket(fd->ifd);
     WSACleanup();
   } else {
-    HANDLE hComPort = (HANDLE) fd->pfd;
-
-    if(hComPort != INVALID_HANDLE_VALUE)
-      CloseHandle(hComPort);
-
-    hComPort = INVALID_HANDLE_VALUE;
+    W32port *wp = w32port(fd);
+    DWORD n;
+
+    if(!wp)
+      return;
+    if(wp->rpending) {          // Cancel the background read and wait until it is given up
+      CancelIo(wp->h);
+      GetOverlappedResult(wp->h, &wp->rov, &n, TRUE);
+    }
+    CloseHandle(wp->h);
+    if(wp->rov.hEvent)
+      CloseHandle(wp->rov.hEvent);
+    if(wp->wov.hEvent)
+      CloseHandle(wp->wov.hEvent);
+    mmt_free(wp);
+    fd->pfd = NULL;
   }
 }
 
@@ -294,7 +414,7 @@ static int ser_set_dtr_rts(const union filedescriptor *fd, int is_on) {
   if(cx->ser_serial_over_ethernet)
     return 0;
 
-  HANDLE hComPort = (HANDLE) fd->pfd;
+  HANDLE hComPort = w32port(fd)->h;
 
   EscapeCommFunction(hComPort, is_on? SETDTR: CLRDTR);
   EscapeCommFunction(hComPort, is_on? SETRTS: CLRRTS);
@@ -314,7 +434,7 @@ static int net_send(const union filedescriptor *fd, const unsigned char *buf, si
   if(!len)
     return 0;
 
-  if(verbose >= MSG_TRACE)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, buf, len);
 
   while(len) {
@@ -340,10 +460,9 @@ static int ser_send(const union filedescriptor *fd, const unsigned char *buf, si
     return net_send(fd, buf, len);
 
   DWORD written;
+  W32port *wp = w32port(fd);
 
-  HANDLE hComPort = (HANDLE) fd->pfd;
-
-  if(hComPort == INVALID_HANDLE_VALUE) {
+  if(!wp) {
     pmsg_error("port not open\n");
     return -1;
   }
@@ -351,17 +470,16 @@ static int ser_send(const union filedescriptor *fd, const unsigned char *buf, si
   if(!len)
     return 0;
 
-  if(verbose >= MSG_TRACE)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, buf, len);
 
-  // Set minimum r/w timeout to 2000 ms or higher to cater for 110 baud or faster
-  if(!serial_w32SetRWTimeOut(hComPort, (len > 20? len: 20)*100)) {
-    pmsg_error("cannot set r/w timeout for serial port\n");
+  ResetEvent(wp->wov.hEvent);
+  if(!WriteFile(wp->h, buf, len, NULL, &wp->wov) && GetLastError() != ERROR_IO_PENDING) {
+    serial_w32error("unable to write");
     return -1;
   }
-
-  if(!WriteFile(hComPort, buf, len, &written, NULL)) {
-    pmsg_error("unable to write: %s\n", "sorry no info avail"); // TODO
+  if(!GetOverlappedResult(wp->h, &wp->wov, &written, TRUE)) {
+    serial_w32error("unable to write");
     return -1;
   }
 
@@ -429,7 +547,7 @@ static int net_recv(const union filedescriptor *fd, unsigned char *buf, size_t b
     len += rc;
   }
 
-  if(verbose >= MSG_TRACE)
+  if(msg_lvl_on(MSG_TRACE))
     trace_buffer(__func__, buf, len);
 
   return 0;
@@ -439,42 +557,45 @@ static int ser_recv(const union filedescriptor *fd, unsigned char *buf, size_t b
   if(cx->ser_serial_over_ethernet)
     return net_recv(fd, buf, buflen);
 
-  DWORD read;
-
-  HANDLE hComPort = (HANDLE) fd->pfd;
+  W32port *wp = w32port(fd);
+  size_t got = 0;
 
-  if(hComPort == INVALID_HANDLE_VALUE) {
+  if(!wp) {
     pmsg_error("port not open\n");
     return -1;
   }
 
   // Ensure can receive buflen bytes at 8N1 at 110 baud or higher: one byte takes 91 ms at 110 baud
   long timeout = (long) buflen*100 > serial_recv_timeout? (long) buflen*100: serial_recv_timeout;
-  if(!serial_w32SetTimeOut(hComPort, timeout)) {
-    pmsg_error("cannot set read timeout for serial port\n");
-    return -1;
-  }
+  uint64_t start = avr_mstimestamp();
+
+  while(got < buflen) {
+    size_t n = wp->rxlen - wp->rxpos;
+
+    if(n) {
+      if(n > buflen - got)
+        n = buflen - got;
+      memcpy(buf + got, wp->rxbuf + wp->rxpos, n);
+      wp->rxpos += n;
+      got += n;
+      continue;
+    }
 
-  if(!ReadFile(hComPort, buf, buflen, &read, NULL)) {
-    LPVOID lpMsgBuf;
+    long left = timeout - (long) (avr_mstimestamp() - start);
 
-    FormatMessage(
-      FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-      NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // Default language
-      (LPTSTR) & lpMsgBuf, 0, NULL);
-    pmsg_error("unable to read: %s\n", (char *) lpMsgBuf);
-    LocalFree(lpMsgBuf);
-    return -1;
+    if(left <= 0) {             // Time out detected
+      pmsg_notice2("%s(): programmer is not responding\n", __func__);
+      return -1;
+    }
+    if(w32_rxwait(wp, left) < 0)
+      return -1;
   }
 
-  // Time out detected
-  if(read < buflen) {
-    pmsg_notice2("%s(): programmer is not responding\n", __func__);
+  if(w32_rxstart(wp) < 0)       // Keep collecting in the background
     return -1;
-  }
 
-  if(verbose >= MSG_TRACE)
-    trace_buffer(__func__, buf, read);
+  if(msg_lvl_on(MSG_TRACE))
+    trace_buffer(__func__, buf, got);
 
   return 0;
 }
@@ -548,49 +669,35 @@ static int ser_drain(const union filedescriptor *fd, int display) {
   if(cx->ser_serial_over_ethernet)
     return net_drain(fd, display);
 
-  unsigned char buf[10];
-  BOOL readres;
-  DWORD read;
-
-  HANDLE hComPort = (HANDLE) fd->pfd;
+  W32port *wp = w32port(fd);
+  int n;
 
-  if(hComPort == INVALID_HANDLE_VALUE) {
+  if(!wp) {
     pmsg_error("port not open\n");
     return -1;
   }
 
-  serial_w32SetTimeOut(hComPort, serial_drain_timeout);
-
   if(display)
     msg_info("drain>");
 
-  while(1) {
-    readres = ReadFile(hComPort, buf, 1, &read, NULL);
-    if(!readres) {
-      LPVOID lpMsgBuf;
-
-      FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // Default language
-        (LPTSTR) & lpMsgBuf, 0, NULL);
-      pmsg_error("unable to read: %s\n", (char *) lpMsgBuf);
-      LocalFree(lpMsgBuf);
+  // Discard whatever has been collected until nothing arrives for serial_drain_timeout ms
+  do {
+    if(display)
+      for(DWORD i = wp->rxpos; i < wp->rxlen; i++)
+        msg_info("%02x ", wp->rxbuf[i]);
+    wp->rxpos = wp->rxlen;
+    if((n = w32_rxwait(wp, serial_drain_timeout)) < 0)
       return -1;
-    }
+  } while(n > 0);
+
+  if(display)
+    msg_info("<drain\n");
 
-    if(read) {                  // Data avail
-      if(display)
-        msg_info("%02x ", buf[0]);
-    } else {                    // No more data
-      if(display)
-        msg_info("<drain\n");
-      break;
-    }
-  }
   return 0;
 }
 
 struct serial_device serial_serdev = {
+  .name = "serial",
   .open = ser_open,
   .setparams = ser_setparams,
   .close = ser_close,
@@ -602,5 +709,5 @@ struct serial_device serial_serdev = {
   .flags = SERDEV_FL_CANSETSPEED,
 };
 
-struct serial_device *serdev = &serial_serdev;
+LIBAVRDUDE_THREAD_LOCAL struct serial_device *serdev = &serial_serdev;
 #endif                          // WIN32
@@ -42,6 +42,7 @@
 
 struct pdata {
   struct termios oldmode;
+  unsigned int mctl;            // Shadow copy of the modem control lines
 };
 
 // Use private programmer data as if they were a global structure my
@@ -106,20 +107,16 @@ static int serbb_setpin(const PROGRAMMER *pgm, int pinfunc, int value) {
 
   case 4:                      // dtr
   case 7:                      // rts
-    r = ioctl(pgm->fd.ifd, TIOCMGET, &ctl);
-    if(r < 0) {
-      pmsg_ext_error("ioctl(\"TIOCMGET\"): %s\n", strerror(errno));
-      return -1;
-    }
-    if(value)
-      ctl |= serregbits[pin];
-    else
-      ctl &= ~(serregbits[pin]);
+    // Update the shadow copy and only touch the port if the line changes
+    ctl = value? my.mctl | serregbits[pin]: my.mctl & ~serregbits[pin];
+    if(ctl == my.mctl)
+      return 0;
     r = ioctl(pgm->fd.ifd, TIOCMSET, &ctl);
     if(r < 0) {
       pmsg_ext_error("ioctl(\"TIOCMSET\"): %s\n", strerror(errno));
       return -1;
     }
+    my.mctl = ctl;
     break;
 
   default:                     // Impossible
@@ -200,6 +197,94 @@ static int serbb_highpulsepin(const PROGRAMMER *pgm, int pinfunc) {
   return 0;
 }
 
+// Modem control bit of an output pin on DTR or RTS, 0 otherwise; *inv is set for inverted pins
+static unsigned int serbb_outbit(const PROGRAMMER *pgm, int pinfunc, int *inv) {
+  int pin = pgm->pinno[pinfunc];
+
+  *inv = !!(pin & PIN_INVERSE);
+  pin &= PIN_MASK;
+
+  return pin == 4 || pin == 7? (unsigned int) serregbits[pin]: 0;
+}
+
+// Modem status bit of an input pin on CD, DSR, CTS or RI, 0 otherwise
+static unsigned int serbb_inbit(const PROGRAMMER *pgm, int pinfunc, int *inv) {
+  int pin = pgm->pinno[pinfunc];
+
+  *inv = !!(pin & PIN_INVERSE);
+  pin &= PIN_MASK;
+
+  return pin == 1 || pin == 6 || pin == 8 || pin == 9? (unsigned int) serregbits[pin]: 0;
+}
+
+static int serbb_setctl(const PROGRAMMER *pgm, unsigned int ctl) {
+  if(ctl != my.mctl) {
+    if(ioctl(pgm->fd.ifd, TIOCMSET, &ctl) < 0) {
+      pmsg_ext_error("ioctl(\"TIOCMSET\"): %s\n", strerror(errno));
+      return -1;
+    }
+    my.mctl = ctl;
+  }
+  if(pgm->ispdelay > 1)
+    bitbang_delay(pgm->ispdelay);
+
+  return 0;
+}
+
+/*
+ * SPI transfer with one TIOCMSET per half clock: SDO changes together with
+ * the falling SCK edge of the previous bit, which is SPI mode 0 as the target
+ * samples SDO on the rising edge; falls back to bitbang_spi() unless SCK and
+ * SDO are on DTR/RTS and SDI on a modem status line
+ */
+static int serbb_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  int isck, isdo, isdi;
+  unsigned int sck = serbb_outbit(pgm, PIN_AVR_SCK, &isck), sdo = serbb_outbit(pgm, PIN_AVR_SDO, &isdo);
+  unsigned int sdi = serbb_inbit(pgm, PIN_AVR_SDI, &isdi), ctl, in;
+
+  if(!sck || !sdo || sck == sdo || !sdi)
+    return bitbang_spi(pgm, cmd, res, count);
+
+  pgm->setpin(pgm, PIN_LED_PGM, 0);
+  for(int i = 0; i < count; i++) {
+    unsigned char rbyte = 0;
+
+    for(int b = 7; b >= 0; b--) {
+      ctl = my.mctl & ~(sck | sdo);
+      ctl |= isck? sck: 0;      // SCK low
+      ctl |= (((cmd[i] >> b) & 1) ^ isdo)? sdo: 0;
+      if(serbb_setctl(pgm, ctl) < 0 || serbb_setctl(pgm, ctl ^ sck) < 0)
+        return -1;
+      if(ioctl(pgm->fd.ifd, TIOCMGET, &in) < 0) {
+        pmsg_ext_error("ioctl(\"TIOCMGET\"): %s\n", strerror(errno));
+        return -1;
+      }
+      rbyte |= (!!(in & sdi) ^ isdi) << b;
+    }
+    res[i] = rbyte;
+  }
+  ctl = (my.mctl & ~sck) | (isck? sck: 0);
+  if(serbb_setctl(pgm, ctl) < 0)
+    return -1;
+  pgm->setpin(pgm, PIN_LED_PGM, 1);
+
+  if(verbose >= MSG_DEBUG) {
+    msg_debug("%s(): [ ", __func__);
+    for(int i = 0; i < count; i++)
+      msg_debug("%02X ", cmd[i]);
+    msg_debug("] [ ");
+    for(int i = 0; i < count; i++)
+      msg_debug("%02X ", res[i]);
+    msg_debug("]\n");
+  }
+
+  return 0;
+}
+
+static int serbb_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res) {
+  return serbb_spi(pgm, cmd, res, 4);
+}
+
 static void serbb_display(const PROGRAMMER *pgm, const char *p) {
 }
 
@@ -266,10 +351,17 @@ static int serbb_open(PROGRAMMER *pgm, const char *port) {
     return (-1);
   }
 
+  if(ioctl(pgm->fd.ifd, TIOCMGET, &my.mctl) < 0) {
+    pmsg_ext_error("ioctl(\"TIOCMGET\"): %s\n", strerror(errno));
+    return (-1);
+  }
+
   return (0);
 }
 
 static void serbb_close(PROGRAMMER *pgm) {
+  bitbang_realtime_end();         // Back to normal scheduling
+
   if(pgm->fd.ifd != -1) {
     (void) tcsetattr(pgm->fd.ifd, TCSANOW, &my.oldmode);
     pgm->setpin(pgm, PIN_AVR_RESET, 1);
@@ -308,8 +400,10 @@ void serbb_initpgm(PROGRAMMER *pgm) {
   pgm->powerdown = serbb_powerdown;
   pgm->program_enable = bitbang_program_enable;
   pgm->chip_erase = bitbang_chip_erase;
-  pgm->cmd = bitbang_cmd;
+  pgm->cmd = serbb_cmd;
+  pgm->spi = serbb_spi;
   pgm->cmd_tpi = bitbang_cmd_tpi;
+  pgm->cmd_tpi_batch = bitbang_cmd_tpi_batch;
   pgm->open = serbb_open;
   pgm->close = serbb_close;
   pgm->setpin = serbb_setpin;
@@ -317,5 +411,9 @@ void serbb_initpgm(PROGRAMMER *pgm) {
   pgm->highpulsepin = serbb_highpulsepin;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
 }
 #endif                          // WIN32
@@ -79,6 +79,10 @@ static int serbb_setpin(const PROGRAMMER *pgm, int pinfunc, int value) {
   if(pin < 1 || pin > DB9PINS)
     return -1;
 
+  // Only call into the driver if the line changes, eg, SDO between SPI bits of the same value
+  if((pin == 3 && my.txd == value) || (pin == 4 && my.dtr == value) || (pin == 7 && my.rts == value))
+    goto done;
+
   switch(pin) {
   case 3:                      // txd
     dwFunc = value? SETBREAK: CLRBREAK;
@@ -114,6 +118,7 @@ static int serbb_setpin(const PROGRAMMER *pgm, int pinfunc, int value) {
     return -1;
   }
 
+done:
   if(pgm->ispdelay > 1)
     bitbang_delay(pgm->ispdelay);
 
@@ -320,7 +325,9 @@ void serbb_initpgm(PROGRAMMER *pgm) {
   pgm->program_enable = bitbang_program_enable;
   pgm->chip_erase = bitbang_chip_erase;
   pgm->cmd = bitbang_cmd;
+  pgm->spi = bitbang_spi;
   pgm->cmd_tpi = bitbang_cmd_tpi;
+  pgm->cmd_tpi_batch = bitbang_cmd_tpi_batch;
   pgm->open = serbb_open;
   pgm->close = serbb_close;
   pgm->setpin = serbb_setpin;
@@ -328,5 +335,9 @@ void serbb_initpgm(PROGRAMMER *pgm) {
   pgm->highpulsepin = serbb_highpulsepin;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
 }
 #endif                          // WIN32
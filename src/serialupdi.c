@@ -197,7 +197,54 @@ static void serialupdi_close(PROGRAMMER *pgm) {
   updi_link_close(pgm);
 }
 
-static int serialupdi_wait_for_unlock(const PROGRAMMER *pgm, unsigned int ms) {
+/*
+ * Polls ASI_SYS_STATUS until (status & mask) == want or ms milliseconds have
+ * passed; with release set the first read goes out in the same transfer as
+ * the write that releases reset. The first few reads follow each other
+ * immediately, as the bits usually flip within a couple of round trips;
+ * after that the gap between reads starts at the measured round-trip time
+ * and doubles up to 1 ms. Returns 0 once the status matches and -1 on
+ * timeout; *last, if given, receives the last status read.
+ */
+static int serialupdi_wait_sys_status(const PROGRAMMER *pgm, unsigned int ms, uint8_t mask, uint8_t want,
+  int release, uint8_t *last) {
+
+  uint64_t start = avr_ustimestamp(), now, rtt = 0, gap = 0;
+  uint8_t status = 0;
+  int rc;
+
+  for(int n = 0; ; n++) {
+    if(release) {
+      rc = updi_write_read_cs(pgm, UPDI_ASI_RESET_REQ, 0x00, UPDI_ASI_SYS_STATUS, &status);
+      if(rc < 0)
+        pmsg_debug("release reset with status read failed\n");
+      release = 0;
+    } else {
+      rc = updi_read_cs(pgm, UPDI_ASI_SYS_STATUS, &status);
+    }
+    now = avr_ustimestamp();
+    if(!rtt)
+      rtt = now - start + 1;
+    if(rc >= 0 && (status & mask) == want)
+      break;
+    if(now - start >= ms*1000ULL) {
+      if(last)
+        *last = status;
+      return -1;
+    }
+    if(n >= 4) {
+      gap = gap? 2*gap: rtt;
+      if(gap > 1000)
+        gap = 1000;
+      usleep(gap);
+    }
+  }
+  if(last)
+    *last = status;
+  return 0;
+}
+
+static int serialupdi_wait_for_unlock(const PROGRAMMER *pgm, unsigned int ms, int release) {
 /*
     def wait_unlocked(self, timeout_ms):
         """
@@ -216,22 +263,11 @@ static int serialupdi_wait_for_unlock(const PROGRAMMER *pgm, unsigned int ms) {
         self.logger.error("Timeout waiting for device to unlock")
         return False
 */
-  unsigned long start_time;
-  unsigned long current_time;
-  uint8_t status;
-
-  start_time = avr_ustimestamp();
-  do {
-    if(updi_read_cs(pgm, UPDI_ASI_SYS_STATUS, &status) >= 0) {
-      if(!(status & (1 << UPDI_ASI_SYS_STATUS_LOCKSTATUS))) {
-        return 0;
-      }
-    }
-    current_time = avr_ustimestamp();
-  } while((current_time - start_time) < (ms*1000));
-
-  pmsg_error("timeout waiting for device to unlock\n");
-  return -1;
+  if(serialupdi_wait_sys_status(pgm, ms, 1 << UPDI_ASI_SYS_STATUS_LOCKSTATUS, 0, release, NULL) < 0) {
+    pmsg_error("timeout waiting for device to unlock\n");
+    return -1;
+  }
+  return 0;
 }
 
 typedef enum {
@@ -239,7 +275,7 @@ typedef enum {
   WAIT_FOR_UROW_HIGH
 } urow_wait_mode;
 
-static int serialupdi_wait_for_urow(const PROGRAMMER *pgm, unsigned int ms, urow_wait_mode mode) {
+static int serialupdi_wait_for_urow(const PROGRAMMER *pgm, unsigned int ms, urow_wait_mode mode, int release) {
 /*
     def wait_urow_prog(self, timeout_ms, wait_for_high):
         """
@@ -263,48 +299,24 @@ static int serialupdi_wait_for_urow(const PROGRAMMER *pgm, unsigned int ms, urow
         self.logger.error("Timeout waiting for device to enter UROW WRITE mode")
         return False
 */
-  unsigned long start_time;
-  unsigned long current_time;
-  uint8_t status;
-
-  start_time = avr_ustimestamp();
-  do {
-    if(updi_read_cs(pgm, UPDI_ASI_SYS_STATUS, &status) >= 0) {
-      if(mode == WAIT_FOR_UROW_HIGH) {
-        if(status & (1 << UPDI_ASI_SYS_STATUS_UROWPROG)) {
-          return 0;
-        }
-      } else {
-        if(!(status & (1 << UPDI_ASI_SYS_STATUS_UROWPROG))) {
-          return 0;
-        }
-      }
-    }
-    current_time = avr_ustimestamp();
-  } while((current_time - start_time) < (ms*1000));
+  uint8_t mask = 1 << UPDI_ASI_SYS_STATUS_UROWPROG;
 
-  pmsg_error("timeout waiting for device to complete UROW WRITE\n");
-  return -1;
+  if(serialupdi_wait_sys_status(pgm, ms, mask, mode == WAIT_FOR_UROW_HIGH? mask: 0, release, NULL) < 0) {
+    pmsg_error("timeout waiting for device to complete UROW WRITE\n");
+    return -1;
+  }
+  return 0;
 }
 
-static int serialupdi_wait_for_nvmprog(const PROGRAMMER *pgm, unsigned int ms) {
+// Waits for the device to be unlocked and in NVMPROG mode
+static int serialupdi_wait_for_nvmprog(const PROGRAMMER *pgm, unsigned int ms, int release) {
+  uint8_t status, nvmprog = 1 << UPDI_ASI_SYS_STATUS_NVMPROG, lock = 1 << UPDI_ASI_SYS_STATUS_LOCKSTATUS;
 
-  unsigned long start_time;
-  unsigned long current_time;
-  uint8_t status;
-
-  start_time = avr_ustimestamp();
-  do {
-    if(updi_read_cs(pgm, UPDI_ASI_SYS_STATUS, &status) >= 0) {
-      if(status & (1 << UPDI_ASI_SYS_STATUS_NVMPROG)) {
-        return 0;
-      }
-    }
-    current_time = avr_ustimestamp();
-  } while((current_time - start_time) < (ms*1000));
-
-  pmsg_error("timeout waiting for device to enter NVMPROG mode\n");
-  return -1;
+  if(serialupdi_wait_sys_status(pgm, ms, nvmprog | lock, nvmprog, release, &status) < 0) {
+    pmsg_error("timeout waiting for device to %s\n", status & lock? "unlock": "enter NVMPROG mode");
+    return -1;
+  }
+  return 0;
 }
 
 static int serialupdi_in_prog_mode(const PROGRAMMER *pgm, uint8_t *in_prog_mode) {
@@ -392,8 +404,9 @@ def enter_progmode(self):
     return -1;
   }
 
+  // Reset stays applied while the key goes out, so the reset request can follow in the same transfer
   memcpy(buffer, UPDI_KEY_NVM, sizeof(buffer));
-  if(updi_write_key(pgm, buffer, UPDI_KEY_64, sizeof(buffer)) < 0) {
+  if(updi_write_key_reset(pgm, buffer, UPDI_KEY_64, sizeof(buffer)) < 0) {
     pmsg_error("writing NVM KEY failed\n");
     return -1;
   }
@@ -408,22 +421,8 @@ def enter_progmode(self):
     pmsg_warning("key was not accepted\n");
   }
 
-  if(serialupdi_reset(pgm, APPLY_RESET) < 0) {
-    pmsg_error("apply reset operation failed\n");
-    return -1;
-  }
-
-  if(serialupdi_reset(pgm, RELEASE_RESET) < 0) {
-    pmsg_error("release reset operation failed\n");
-    return -1;
-  }
-
-  if(serialupdi_wait_for_unlock(pgm, 100) < 0) {
-    pmsg_error("unable to enter NVM programming mode: device is locked\n");
-    return -1;
-  }
-
-  if(serialupdi_wait_for_nvmprog(pgm, 500) < 0) {
+  // Release reset and poll for unlocked NVMPROG mode, the first read going out with the release
+  if(serialupdi_wait_for_nvmprog(pgm, 500, 1) < 0) {
     pmsg_error("unable to enter NVM programming mode\n");
     return -1;
   }
@@ -533,12 +532,7 @@ static int serialupdi_write_userrow(const PROGRAMMER *pgm, const AVRPART *p, con
     return -1;
   }
 
-  if(serialupdi_reset(pgm, RELEASE_RESET) < 0) {
-    pmsg_error("release reset operation failed\n");
-    return -1;
-  }
-
-  if(serialupdi_wait_for_urow(pgm, 500, WAIT_FOR_UROW_HIGH) < 0) {
+  if(serialupdi_wait_for_urow(pgm, 500, WAIT_FOR_UROW_HIGH, 1) < 0) {
     pmsg_error("unable to enter USERROW programming mode\n");
     return -1;
   }
@@ -569,7 +563,7 @@ static int serialupdi_write_userrow(const PROGRAMMER *pgm, const AVRPART *p, con
     return -1;
   }
 
-  if(serialupdi_wait_for_urow(pgm, 500, WAIT_FOR_UROW_LOW) < 0) {
+  if(serialupdi_wait_for_urow(pgm, 500, WAIT_FOR_UROW_LOW, 0) < 0) {
     pmsg_debug("unable to exit USERROW programming mode\n");
 
     if(serialupdi_reset(pgm, APPLY_RESET) < 0) {
@@ -607,6 +601,60 @@ static int serialupdi_write_userrow(const PROGRAMMER *pgm, const AVRPART *p, con
   return 0;
 }
 
+// Host baud rates tried by -x autobaud in ascending order
+static const int serialupdi_bauds[] = {
+  115200, 230400, 345600, 460800, 500000, 691200, 921600, 1000000, 1500000, 2000000,
+};
+
+/*
+ * Raise the UPDI clock to 16 MHz and step the host baud rate up while a link
+ * check round trip succeeds; stays at the last good rate where a step fails
+ */
+static void serialupdi_autobaud(const PROGRAMMER *pgm) {
+  int good = updi_get_baud(pgm), max = updi_get_autobaud(pgm), clk16 = 0;
+
+  for(size_t i = 0; i < sizeof serialupdi_bauds/sizeof *serialupdi_bauds; i++) {
+    int baud = serialupdi_bauds[i];
+
+    if(baud <= good)
+      continue;
+    if(baud > max)
+      break;
+    if(!clk16 && baud > UPDI_ASI_CTRLA_MAX_4MHZ_BAUD) {
+      if(updi_write_cs(pgm, UPDI_ASI_CTRLA, UPDI_ASI_CTRLA_UPDICLKSEL_16MHZ) < 0)
+        break;
+      clk16 = 1;
+    }
+    if(updi_link_set_baud(pgm, baud) < 0) {
+      pmsg_notice2("UPDI link check failed at %d baud\n", baud);
+      // Go back to the last good rate; a reinitialisation falls back to -b
+      if(updi_link_set_baud(pgm, good) < 0 && updi_link_init(pgm) < 0)
+        pmsg_warning("cannot restore UPDI link after failed baud rate step\n");
+      break;
+    }
+    good = baud;
+  }
+  pmsg_notice("UPDI link running at %d baud\n", updi_get_baud(pgm));
+}
+
+// Drop to the next lower -x autobaud rate after an error; returns 0 if a retry makes sense
+static int serialupdi_baud_down(const PROGRAMMER *pgm) {
+  int base = pgm->baudrate? pgm->baudrate: 115200, baud = updi_get_baud(pgm), lower = base;
+
+  if(!updi_get_autobaud(pgm) || baud <= base)
+    return -1;
+
+  for(size_t i = 0; i < sizeof serialupdi_bauds/sizeof *serialupdi_bauds; i++)
+    if(serialupdi_bauds[i] < baud && serialupdi_bauds[i] > lower)
+      lower = serialupdi_bauds[i];
+
+  pmsg_notice("UPDI error at %d baud, retrying at %d baud\n", baud, lower);
+  if(updi_link_set_baud(pgm, lower) < 0 && updi_link_init(pgm) < 0)
+    return -1;
+
+  return 0;
+}
+
 static int serialupdi_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
   uint8_t value;
   uint8_t reset_link_required = 0;
@@ -677,6 +725,8 @@ static int serialupdi_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
     pmsg_error("decode SIB_INFO failed\n");
     return -1;
   }
+  if(updi_nvm_resolve(pgm) < 0)
+    return -1;
 
   if(updi_link_init(pgm) < 0) {
     pmsg_error("UPDI link initialization failed\n");
@@ -700,6 +750,9 @@ static int serialupdi_initialize(const PROGRAMMER *pgm, const AVRPART *p) {
     }
   }
 
+  if(updi_get_autobaud(pgm))
+    serialupdi_autobaud(pgm);
+
   return 0;
 }
 
@@ -797,38 +850,23 @@ static int serialupdi_write_byte(const PROGRAMMER *pgm, const AVRPART *p, const
   return updi_write_byte(pgm, mem->offset + addr, value);
 }
 
-static int serialupdi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+static int serialupdi_paged_load_once(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   if(n_bytes > 65535) {
     pmsg_error("%s() called with implausibly high n_bytes = %u\n", __func__, n_bytes);
     return -1;
   }
 
-  if((int) n_bytes > m->readsize) {
-    unsigned int read_offset = addr;
-    int remaining_bytes = n_bytes;
-    int read_bytes = 0;
-    int rc;
+  int chunk = updi_get_read_chunk(pgm);
+  int rc = updi_read_data_bulk(pgm, m->offset + addr, m->buf + addr, n_bytes,
+    chunk > 0? chunk: UPDI_MAX_REPEAT_SIZE << 1);
 
-    while(remaining_bytes > 0) {
-      rc = updi_read_data(pgm, m->offset + read_offset, m->buf + read_offset,
-        remaining_bytes > m->readsize? m->readsize: remaining_bytes);
-      if(rc < 0) {
-        pmsg_error("paged load operation failed\n");
-        return rc;
-      } else {
-        read_bytes += rc;
-        read_offset += m->readsize;
-        remaining_bytes -= m->readsize;
-      }
-    }
-    return read_bytes;
-  } else {
-    return updi_read_data(pgm, m->offset + addr, m->buf + addr, n_bytes);
-  }
+  if(rc < 0)
+    pmsg_error("paged load operation failed\n");
+  return rc;
 }
 
-static int serialupdi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+static int serialupdi_paged_write_once(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   int rc;
 
@@ -841,6 +879,13 @@ static int serialupdi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
     int remaining_bytes = n_bytes;
     int write_bytes = 0;
 
+    if(mem_is_flash(m)) {       // Stream consecutive flash pages
+      rc = updi_nvm_write_flash_pages(pgm, p, m->offset + addr, m->buf + addr, n_bytes, m->page_size);
+      if(rc < 0)
+        pmsg_error("paged write operation failed\n");
+      return rc;
+    }
+
     while(remaining_bytes > 0) {
 
       if(mem_is_eeprom(m)) {
@@ -893,6 +938,74 @@ static int serialupdi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   }
 }
 
+// Paged access that retries at lower baud rates after link errors with -x autobaud
+static int serialupdi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+  int rc;
+
+  while((rc = serialupdi_paged_load_once(pgm, p, m, page_size, addr, n_bytes)) < 0)
+    if(serialupdi_baud_down(pgm) < 0)
+      break;
+
+  return rc;
+}
+
+static int serialupdi_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+  int rc;
+
+  while((rc = serialupdi_paged_write_once(pgm, p, m, page_size, addr, n_bytes)) < 0)
+    if(serialupdi_baud_down(pgm) < 0)
+      break;
+
+  return rc;
+}
+
+// Scatter-gather flash writes share one NVM write command on controllers without page buffer
+static int serialupdi_paged_write_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, const Avr_range *rg, int nr) {
+  int rc = 0, n_bytes = 0;
+
+  for(int i = 0; i < nr; i++) {
+    if(rg[i].n > 65535) {
+      pmsg_error("%s() called with implausibly high range length %u\n", __func__, rg[i].n);
+      return -1;
+    }
+    n_bytes += rg[i].n;
+  }
+  if(!mem_is_flash(m)) {
+    for(int i = 0; i < nr && rc >= 0; i++)
+      rc = serialupdi_paged_write(pgm, p, m, page_size, rg[i].addr, rg[i].n);
+    return rc < 0? rc: n_bytes;
+  }
+
+  while((rc = updi_nvm_write_flash_ranges(pgm, p, m->offset, m->buf, rg, nr, m->page_size)) < 0)
+    if(serialupdi_baud_down(pgm) < 0)
+      break;
+  if(rc < 0)
+    pmsg_error("paged write operation failed\n");
+
+  return rc < 0? rc: n_bytes;
+}
+
+// Replaces page_erase() + paged_write() for flash on NVM controllers with an erase-write page command
+static int serialupdi_paged_erase_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+  int rc;
+
+  if(!mem_is_flash(m) || n_bytes > 65535)
+    return -2;
+
+  while((rc = updi_nvm_erase_write_flash_pages(pgm, p, m->offset + addr, m->buf + addr, n_bytes,
+    m->page_size)) == -1)
+    if(serialupdi_baud_down(pgm) < 0)
+      break;
+  if(rc == -1)
+    pmsg_error("paged erase-write operation failed\n");
+
+  return rc;
+}
+
 static int serialupdi_unlock(const PROGRAMMER *pgm, const AVRPART *p) {
 /*
     def unlock(self):
@@ -943,12 +1056,7 @@ static int serialupdi_unlock(const PROGRAMMER *pgm, const AVRPART *p) {
     return -1;
   }
 
-  if(serialupdi_reset(pgm, RELEASE_RESET) < 0) {
-    pmsg_error("release reset operation failed\n");
-    return -1;
-  }
-
-  if(serialupdi_wait_for_unlock(pgm, 500) < 0) {
+  if(serialupdi_wait_for_unlock(pgm, 500, 1) < 0) {
     pmsg_error("waiting for unlock failed\n");
     return -1;
   }
@@ -981,6 +1089,27 @@ static int serialupdi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   return -1;
 }
 
+// Read sram or io with repeated bursts rather than one UPDI transaction per byte
+static int serialupdi_read_block(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int addr, unsigned int n, unsigned char *buf) {
+
+  if(!mem_is_io(m) && !mem_is_sram(m))
+    return -2;
+  if(addr >= (unsigned int) m->size || n > (unsigned int) m->size - addr)
+    return -1;
+
+  // Byte rather than word bursts so io registers are accessed exactly as with read_byte()
+  for(unsigned int done = 0, chunk; done < n; done += chunk) {
+    chunk = n - done > UPDI_MAX_REPEAT_SIZE? UPDI_MAX_REPEAT_SIZE: n - done;
+    if(updi_read_data(pgm, m->offset + addr + done, buf + done, chunk) < 0) {
+      pmsg_error("block read of %s failed\n", m->desc);
+      return -1;
+    }
+  }
+
+  return n;
+}
+
 static int serialupdi_page_erase(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, unsigned int baseaddr) {
   return updi_nvm_erase_flash_page(pgm, p, m->offset + baseaddr);
 }
@@ -1038,6 +1167,35 @@ static int serialupdi_parseextparms(const PROGRAMMER *pgm, const LISTID extparms
       continue;
     }
 
+    if(str_starts(extended_param, "readchunk=")) {
+      int chunk;
+
+      if(sscanf(extended_param, "readchunk=%i", &chunk) != 1 || chunk < 1 || chunk > UPDI_MAX_REPEAT_SIZE << 1) {
+        pmsg_error("-x readchunk=<n>: block size must be between 1 and %d\n", UPDI_MAX_REPEAT_SIZE << 1);
+        rv = -1;
+        break;
+      }
+      updi_set_read_chunk(pgm, chunk);
+      continue;
+    }
+
+    if(str_eq(extended_param, "autobaud")) {
+      updi_set_autobaud(pgm, 2000000);
+      continue;
+    }
+
+    if(str_starts(extended_param, "autobaud=")) {
+      int max;
+
+      if(sscanf(extended_param, "autobaud=%i", &max) != 1 || max <= 0) {
+        pmsg_error("-x autobaud=<max>: maximum baud rate must be a positive number\n");
+        rv = -1;
+        break;
+      }
+      updi_set_autobaud(pgm, max);
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rv = LIBAVRDUDE_EXIT_OK;
@@ -1049,6 +1207,9 @@ static int serialupdi_parseextparms(const PROGRAMMER *pgm, const LISTID extparms
     }
     msg_error("%s -c %s extended options:\n", progname, pgmid);
     msg_error("  -x rtsdtr=[low|high] Set RTS/DTR lines low/high during programming\n");
+    msg_error("  -x autobaud[=<max>]  Step baud rate up from -b to <max> (2000000)\n");
+    msg_error("  -x readchunk=<n>     Bytes per block in paged reads, 1..%d (%d)\n",
+      UPDI_MAX_REPEAT_SIZE << 1, UPDI_MAX_REPEAT_SIZE << 1);
     msg_error("  -x help              Show this help menu and exit\n");
     return rv;
   }
@@ -1076,10 +1237,16 @@ void serialupdi_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->unlock = serialupdi_unlock;
   pgm->paged_write = serialupdi_paged_write;
+  pgm->paged_write_multi = serialupdi_paged_write_multi;
+  pgm->multipage_write = 1;
   pgm->read_sig_bytes = serialupdi_read_signature;
   pgm->read_sib = serialupdi_read_sib;
   pgm->paged_load = serialupdi_paged_load;
+  pgm->multipage_load = 1;
+  pgm->max_load = 32768;       // serialupdi_paged_load() reads up to 65535 bytes
   pgm->page_erase = serialupdi_page_erase;
+  pgm->paged_erase_write = serialupdi_paged_erase_write;
+  pgm->read_block = serialupdi_read_block;
   pgm->setup = serialupdi_setup;
   pgm->teardown = serialupdi_teardown;
 
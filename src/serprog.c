@@ -44,6 +44,8 @@ struct pdata {
   unsigned char cmd_bitmap[32];
   unsigned int cs;
   uint32_t actual_frequency;
+  uint32_t max_spiop;           // Maximum data length of one S_CMD_O_SPIOP transfer
+  uint32_t serbuf;              // Size of programmer's serial buffer for pipelined commands
 };
 
 #define my (*(struct pdata *)(pgm->cookie))
@@ -233,6 +235,29 @@ static int serprog_open(PROGRAMMER *pgm, const char *port) {
     return -1;
   }
 
+  // Limits for batched SPI operations: use what the programmer reports, assume modest ones otherwise
+  my.max_spiop = 4096;
+  for(int i = 0; i < 2; i++) {
+    unsigned char qcmd = i? S_CMD_Q_RDNMAXLEN: S_CMD_Q_WRNMAXLEN;
+
+    memset(buf, 0, sizeof buf);
+    if(is_serprog_cmd_supported(my.cmd_bitmap, qcmd) && perform_serprog_cmd(pgm, qcmd, NULL, 0, buf, 3) == 0) {
+      uint32_t len = buf[0] | (buf[1] << 8) | (buf[2] << 16);
+
+      if(len == 0)              // 0 means 2^24 by the specification
+        len = (1 << 24) - 1;
+      if(len < my.max_spiop)
+        my.max_spiop = len;
+    }
+  }
+  my.serbuf = 16;
+  memset(buf, 0, sizeof buf);
+  if(is_serprog_cmd_supported(my.cmd_bitmap, S_CMD_Q_SERBUF) &&
+    perform_serprog_cmd(pgm, S_CMD_Q_SERBUF, NULL, 0, buf, 2) == 0 && read_le16(buf))
+    my.serbuf = read_le16(buf);
+  pmsg_notice2("SPI operations of up to %u bytes, serial buffer %u bytes\n",
+    (unsigned) my.max_spiop, (unsigned) my.serbuf);
+
   return 0;
 }
 
@@ -276,6 +301,71 @@ static int serprog_cmd(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned
   return serprog_spi_duplex(pgm, cmd, res, 4);
 }
 
+/*
+ * Sends n 4-byte ISP commands and receives their responses. Reset is held by
+ * CS throughout, so the commands are packed into as few S_CMD_O_SPIOP
+ * transfers as the programmer's length limit allows. Further transfers are
+ * sent before earlier responses are read as long as all unanswered transfers
+ * fit into the programmer's serial buffer.
+ *
+ * @return -1 on failure, otherwise 0
+ */
+static int serprog_spi_cmds(const PROGRAMMER *pgm, const unsigned char *tx, unsigned char *rx, int n) {
+  int total = 4*n, chunk = my.max_spiop/4*4;
+
+  if(chunk < 4)
+    chunk = 4;
+  if(chunk > 4096)
+    chunk = 4096;
+
+  unsigned char *frame = mmt_malloc(7 + chunk);
+  int sent = 0, done = 0, pending = 0, ret = 0;
+
+  while(done < total) {
+    // Queue transfers while the unanswered ones fit into the serial buffer
+    while(sent < total) {
+      int len = total - sent < chunk? total - sent: chunk;
+
+      if(pending && (uint32_t) (pending + 7 + len) > my.serbuf)
+        break;
+      frame[0] = S_CMD_O_SPIOP;
+      write_le24(frame + 1, len);
+      write_le24(frame + 4, len);
+      memcpy(frame + 7, tx + sent, len);
+      if(serial_send(&pgm->fd, frame, 7 + len) < 0) {
+        ret = -1;
+        goto out;
+      }
+      sent += len;
+      pending += 7 + len;
+    }
+
+    // Collect the response of the oldest transfer
+    int len = total - done < chunk? total - done: chunk;
+    unsigned char status = 0;
+
+    if(serial_recv(&pgm->fd, &status, 1) < 0 || serial_recv(&pgm->fd, rx + done, len) < 0 || status != S_ACK) {
+      pmsg_error("SPI operation of %d bytes failed\n", len);
+      ret = -1;
+      goto out;
+    }
+    done += len;
+    pending -= 7 + len;
+  }
+
+out:
+  mmt_free(frame);
+  return ret;
+}
+
+/*
+ * Multi-byte SPI transfer for avr_spi_paged_load() and avr_spi_paged_write();
+ * whole ISP commands go out as few S_CMD_O_SPIOP transfers
+ */
+static int serprog_spi(const PROGRAMMER *pgm, const unsigned char *cmd, unsigned char *res, int count) {
+  return count%4? serprog_spi_duplex(pgm, cmd, res, count): serprog_spi_cmds(pgm, cmd, res, count/4);
+}
+
 static int serprog_initialize(const PROGRAMMER *pgm, const AVRPART *part) {
   if(is_tpi(part)) {
     // We do not support TPI; this is a dedicated SPI thing
@@ -416,7 +506,7 @@ static int serprog_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   memset(cmd, 0, sizeof cmd);
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -506,12 +596,17 @@ void serprog_initpgm(PROGRAMMER *pgm) {
   pgm->program_enable = serprog_program_enable;
   pgm->chip_erase = serprog_chip_erase;
   pgm->cmd = serprog_cmd;
+  pgm->spi = serprog_spi;
   pgm->open = serprog_open;
   pgm->close = serprog_close;
   pgm->read_byte = avr_read_byte_default;
   pgm->write_byte = avr_write_byte_default;
 
   // Optional fields
+  pgm->paged_load = avr_spi_paged_load;
+  pgm->paged_write = avr_spi_paged_write;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
   pgm->setup = serprog_setup;
   pgm->teardown = serprog_teardown;
   pgm->parseextparams = serprog_parseextparams;
@@ -0,0 +1,497 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Binary trace of serial transactions
+ *
+ * serial_send() and serial_recv() pass through the functions below, which
+ * record a timestamp, the direction, the return code and the payload of
+ * every transfer in a ring buffer of the last SERTRACE_NREC transactions
+ * and the last SERTRACE_NDATA payload bytes. Recording costs one memcpy()
+ * and a timestamp per transfer, so it is always on and does not change
+ * link timing the way -vvvv does. The ring can be shown after an error or
+ * written to a pcap file (link type DLT_USER0) for offline decoding, where
+ * each packet starts with a direction byte (0: host to device, 1: device
+ * to host) and a return code byte followed by the payload.
+ *
+ * The same functions also keep per transport statistics: counts and bytes
+ * of transfers, a histogram of bytes per transfer and a histogram of round
+ * trip times from the end of a send to the end of the receive following it.
+ * They are shown at exit with -v and available through serial_stats().
+ *
+ * Protocols that retry lost frames can keep a Serial_rtt estimate of the
+ * reply time of an operation, which serial_rtt_sample() updates the way TCP
+ * does (RFC 6298). serial_rto() then derives a timeout from it that is a
+ * small multiple of the usual reply time rather than the worst case, so a
+ * lost frame is noticed and retried after milliseconds instead of seconds.
+ * After each timeout, which the caller reports with serial_rtt_timeout(),
+ * the timeout doubles until it reaches the worst case again.
+ *
+ * serial_record_open() additionally writes every transaction with its full
+ * payload to a pcap file of the same format as the session goes along.
+ * serial_replay_load() reads such a recording back; from then on all
+ * serial_*() calls go to serial_replay_serdev, which checks that sends are
+ * identical to the recorded ones and serves the recorded receives without
+ * any hardware. The host-side code of the programmer thus runs exactly as
+ * in the recorded session, which makes its CPU cost reproducible.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+#define SERTRACE_NREC  1024     // Number of transactions kept
+#define SERTRACE_NDATA 65536    // Number of payload bytes kept
+#define SERTRACE_MAXREC (SERTRACE_NDATA/4)      // Payload bytes stored per transaction
+#define SERTRACE_SNAPLEN 262144 // Maximum pcap packet size of session recordings
+#define SERRTT_NMIN 4           // Samples before serial_rto() adapts the timeout
+#define SERRTT_MINRTO 50        // Smallest adaptive timeout in ms
+
+// Histogram bin of x: 0 for x <= 1, otherwise floor(log2(x)) capped at SERSTAT_NBIN - 1
+static int serstat_bin(uint64_t x) {
+  int bin = 0;
+
+  while(x > 1 && bin < SERSTAT_NBIN - 1)
+    x >>= 1, bin++;
+  return bin;
+}
+
+static Serial_stats *serstat_get(void) {
+  for(int i = 0; i < cx->strc_nstats; i++)
+    if(cx->strc_stats[i].dev == serdev)
+      return cx->strc_stats + i;
+  Serial_stats *st = cx->strc_stats + (cx->strc_nstats < SERSTAT_NDEV? cx->strc_nstats++: SERSTAT_NDEV - 1);
+
+  memset(st, 0, sizeof *st);
+  st->dev = serdev;
+  return st;
+}
+
+static void serstat_record(int dir, size_t len, int rc, uint64_t now) {
+  Serial_stats *st = serstat_get();
+
+  if(rc < 0) {
+    st->nerr++;
+    st->t_send = 0;
+    return;
+  }
+  st->xfer[serstat_bin(len)]++;
+  if(dir == SERTRACE_SEND) {
+    st->nsend++;
+    st->bsend += len;
+    st->t_send = now? now: 1;
+  } else {
+    st->nrecv++;
+    st->brecv += len;
+    if(st->t_send) {
+      uint64_t rtt = now - st->t_send;
+
+      st->nrtt++;
+      st->rtt_sum += rtt;
+      if(rtt > st->rtt_max)
+        st->rtt_max = rtt;
+      st->rtt[serstat_bin(rtt)]++;
+      st->t_send = 0;
+    }
+  }
+}
+
+static void sertrace_pcap_header(FILE *f, uint32_t snaplen) {
+  struct {
+    uint32_t magic;
+    uint16_t major, minor;
+    int32_t zone;
+    uint32_t sigfigs, snaplen, network;
+  } hdr = { 0xa1b2c3d4, 2, 4, 0, 0, snaplen, 147 };
+
+  fwrite(&hdr, sizeof hdr, 1, f);
+}
+
+// Write n payload bytes of transaction r as pcap packet: direction byte, return code byte, payload
+static void sertrace_pcap_packet(FILE *f, const Sertrace_rec *r, const unsigned char *payload, size_t n) {
+  unsigned char pre[2] = { r->dir != SERTRACE_SEND, (unsigned char) r->rc };
+
+  if(n > SERTRACE_SNAPLEN - 2)
+    n = SERTRACE_SNAPLEN - 2;
+  uint32_t ph[4] = { r->us/1000000, r->us%1000000, n + 2, r->len + 2 };
+
+  fwrite(ph, sizeof ph, 1, f);
+  fwrite(pre, 1, 2, f);
+  if(n)
+    fwrite(payload, 1, n, f);
+}
+
+static void sertrace_record(int dir, const unsigned char *buf, size_t len, int rc) {
+  Sertrace_rec *r;
+  size_t pos, n;
+
+  if(!cx->strc_rec) {
+    cx->strc_rec = mmt_malloc(SERTRACE_NREC*sizeof *cx->strc_rec);
+    cx->strc_data = mmt_malloc(SERTRACE_NDATA);
+  }
+  r = cx->strc_rec + cx->strc_nrec++%SERTRACE_NREC;
+  r->us = avr_ustimestamp();
+  r->dir = dir;
+  r->rc = rc;
+  r->len = len;
+  r->off = cx->strc_ndata;
+  r->n = n = rc < 0 && dir == SERTRACE_RECV? 0: len > SERTRACE_MAXREC? SERTRACE_MAXREC: len;
+
+  pos = cx->strc_ndata%SERTRACE_NDATA;
+  if(pos + n > SERTRACE_NDATA) {
+    memcpy(cx->strc_data + pos, buf, SERTRACE_NDATA - pos);
+    memcpy(cx->strc_data, buf + SERTRACE_NDATA - pos, pos + n - SERTRACE_NDATA);
+  } else if(n)
+    memcpy(cx->strc_data + pos, buf, n);
+  cx->strc_ndata += n;
+  serstat_record(dir, len, rc, r->us);
+  if(cx->strc_recfile)
+    sertrace_pcap_packet(cx->strc_recfile, r, buf, rc < 0 && dir == SERTRACE_RECV? 0: len);
+}
+
+int serial_trace_send(const union filedescriptor *fd, const unsigned char *buf, size_t buflen) {
+  int span = avr_span_detail("send", NULL);
+  int rc = serial_dev->send(fd, buf, buflen);
+
+  avr_span_end(span, rc < 0? 0: (long) buflen);
+  sertrace_record(SERTRACE_SEND, buf, buflen, rc);
+  return rc;
+}
+
+int serial_trace_recv(const union filedescriptor *fd, unsigned char *buf, size_t buflen) {
+  int span = avr_span_detail("recv", NULL);
+  int rc = serial_dev->recv(fd, buf, buflen);
+
+  avr_span_end(span, rc < 0? 0: (long) buflen);
+  sertrace_record(SERTRACE_RECV, buf, buflen, rc);
+  return rc;
+}
+
+// Number of recorded transactions still available in the ring
+static size_t sertrace_avail(void) {
+  return cx->strc_nrec < SERTRACE_NREC? cx->strc_nrec: SERTRACE_NREC;
+}
+
+// Pointer to i-th oldest available transaction
+static const Sertrace_rec *sertrace_rec(size_t i) {
+  return cx->strc_rec + (cx->strc_nrec - sertrace_avail() + i)%SERTRACE_NREC;
+}
+
+// Copy payload of r to buf; returns number of bytes still in the ring
+static size_t sertrace_payload(const Sertrace_rec *r, unsigned char *buf) {
+  size_t pos, n = r->n;
+
+  if(cx->strc_ndata - r->off > SERTRACE_NDATA)  // Overwritten by later transactions
+    return 0;
+  pos = r->off%SERTRACE_NDATA;
+  if(pos + n > SERTRACE_NDATA) {
+    memcpy(buf, cx->strc_data + pos, SERTRACE_NDATA - pos);
+    memcpy(buf + SERTRACE_NDATA - pos, cx->strc_data, pos + n - SERTRACE_NDATA);
+  } else if(n)
+    memcpy(buf, cx->strc_data + pos, n);
+  return n;
+}
+
+// Show the last nrec transactions, at most 16 payload bytes each
+void serial_trace_show(int nrec) {
+  size_t avail = sertrace_avail(), i = nrec < 0 || (size_t) nrec > avail? 0: avail - nrec;
+  unsigned char buf[SERTRACE_MAXREC];
+
+  if(!avail)
+    return;
+  pmsg_info("last %d serial transaction%s\n", (int) (avail - i), str_plural((int) (avail - i)));
+  for(; i < avail; i++) {
+    const Sertrace_rec *r = sertrace_rec(i);
+    size_t n = sertrace_payload(r, buf);
+
+    imsg_info("%10.6f s %s %lu byte%s, rc %d%s%s\n", r->us/1e6, r->dir == SERTRACE_SEND? "send": "recv",
+      (unsigned long) r->len, str_plural((int) r->len), r->rc, n? ": ": "", n? str_cchex(buf, n > 16? 16: n, 1): "");
+  }
+}
+
+// Write the ring as pcap file with link type DLT_USER0
+int serial_trace_write(const char *fname) {
+  unsigned char buf[SERTRACE_MAXREC];
+  size_t avail = sertrace_avail();
+  FILE *f;
+
+  if(!(f = fopen(fname, "wb"))) {
+    pmsg_ext_error("cannot create trace file %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+  sertrace_pcap_header(f, SERTRACE_MAXREC + 2);
+  for(size_t i = 0; i < avail; i++) {
+    const Sertrace_rec *r = sertrace_rec(i);
+
+    sertrace_pcap_packet(f, r, buf, sertrace_payload(r, buf));
+  }
+  if(fclose(f) == EOF) {
+    pmsg_ext_error("cannot write trace file %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+// Update the reply time estimate with a new sample of us microseconds
+void serial_rtt_sample(Serial_rtt *r, uint64_t us) {
+  int64_t s = us > INT32_MAX? INT32_MAX: (int64_t) us;
+
+  if(!r->nsamples) {
+    r->srtt = s;
+    r->rttvar = s/2;
+  } else {
+    int64_t d = s - r->srtt;
+
+    r->rttvar += ((d < 0? -d: d) - r->rttvar)/4;
+    r->srtt += d/8;
+  }
+  if(r->nsamples < INT_MAX)
+    r->nsamples++;
+  r->backoff = 0;
+}
+
+// The timeout of serial_rto() has expired
+void serial_rtt_timeout(Serial_rtt *r) {
+  if(r->backoff < 16)
+    r->backoff++;
+}
+
+/*
+ * Timeout in ms for the next operation estimated by r: the smoothed reply
+ * time plus four times its deviation, but at least twice the reply time and
+ * SERRTT_MINRTO ms, doubled for every timeout since the last sample; returns
+ * worst_ms while there are too few samples or if that is less
+ */
+long serial_rto(const Serial_rtt *r, long worst_ms) {
+  if(r->nsamples < SERRTT_NMIN)
+    return worst_ms;
+
+  int64_t us = r->srtt + (4*r->rttvar > r->srtt? 4*r->rttvar: r->srtt);
+  int64_t ms = ((us + 999)/1000) << r->backoff;
+
+  if(ms < SERRTT_MINRTO)
+    ms = SERRTT_MINRTO;
+
+  return ms < worst_ms? (long) ms: worst_ms;
+}
+
+const Serial_stats *serial_stats(int *np) {
+  if(np)
+    *np = cx->strc_nstats;
+  return cx->strc_stats;
+}
+
+// Show transfer statistics and histograms of each transport used
+void serial_stats_show(void) {
+  for(int i = 0; i < cx->strc_nstats; i++) {
+    const Serial_stats *st = cx->strc_stats + i;
+    const char *name = st->dev && st->dev->name? st->dev->name: "unnamed";
+
+    pmsg_notice("%s transport: %lu send%s (%llu bytes), %lu receive%s (%llu bytes), %lu error%s\n",
+      name, st->nsend, str_plural(st->nsend), (unsigned long long) st->bsend,
+      st->nrecv, str_plural(st->nrecv), (unsigned long long) st->brecv, st->nerr, str_plural(st->nerr));
+    if(st->nrtt)
+      imsg_notice("%lu round trip%s, mean %llu us, max %llu us\n", st->nrtt, str_plural(st->nrtt),
+        (unsigned long long) (st->rtt_sum/st->nrtt), (unsigned long long) st->rtt_max);
+    if(st->nsend + st->nrecv)
+      imsg_notice("%18s  round trips (us)  transfers (bytes)\n", "range");
+    for(int b = 0; b < SERSTAT_NBIN; b++)
+      if(st->rtt[b] || st->xfer[b])
+        imsg_notice("%8llu..%-8llu  %16lu  %17lu\n",
+          b? 1ULL << b: 0ULL, (2ULL << b) - 1, st->rtt[b], st->xfer[b]);
+  }
+}
+
+// Start writing all subsequent transactions with full payload to pcap file fname
+int serial_record_open(const char *fname) {
+  if(!(cx->strc_recfile = fopen(fname, "wb"))) {
+    pmsg_ext_error("cannot create recording file %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+  sertrace_pcap_header(cx->strc_recfile, SERTRACE_SNAPLEN);
+  return 0;
+}
+
+int serial_record_close(void) {
+  int ret = 0;
+
+  if(cx->strc_recfile && fclose(cx->strc_recfile) == EOF) {
+    pmsg_ext_error("cannot write recording file: %s\n", strerror(errno));
+    ret = -1;
+  }
+  cx->strc_recfile = NULL;
+  return ret;
+}
+
+// Load a recording made with serial_record_open() and replay it from now on
+int serial_replay_load(const char *fname) {
+  uint32_t hdr[6], ph[4];
+  unsigned char pre[2];
+  size_t nrec = 0, ndata = 0, nalloc = 0, dcap = SERTRACE_NDATA;
+  FILE *f;
+
+  if(!(f = fopen(fname, "rb"))) {
+    pmsg_ext_error("cannot open recording file %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+  if(fread(hdr, sizeof hdr, 1, f) != 1 || hdr[0] != 0xa1b2c3d4 || hdr[5] != 147) {
+    pmsg_error("%s is not a pcap recording of avrdude serial transactions\n", fname);
+    fclose(f);
+    return -1;
+  }
+
+  cx->strc_rpdata = mmt_malloc(dcap);
+  while(fread(ph, sizeof ph, 1, f) == 1) {
+    if(ph[2] < 2 || ph[2] > SERTRACE_SNAPLEN || ph[2] > ph[3] || fread(pre, 1, 2, f) != 2) {
+      pmsg_error("corrupt packet %lu in recording file %s\n", (unsigned long) nrec + 1, fname);
+      goto error;
+    }
+    if(nrec >= nalloc) {
+      nalloc = nalloc? 2*nalloc: 1024;
+      cx->strc_rprec = mmt_realloc(cx->strc_rprec, nalloc*sizeof *cx->strc_rprec);
+    }
+    Sertrace_rec *r = cx->strc_rprec + nrec++;
+
+    r->us = ph[0]*(uint64_t) 1000000 + ph[1];
+    r->dir = pre[0]? SERTRACE_RECV: SERTRACE_SEND;
+    r->rc = (signed char) pre[1];
+    r->len = ph[3] - 2;
+    r->n = ph[2] - 2;
+    r->off = ndata;
+    if(ndata + r->n > dcap) {
+      while(ndata + r->n > dcap)
+        dcap *= 2;
+      cx->strc_rpdata = mmt_realloc(cx->strc_rpdata, dcap);
+    }
+    if(r->n && fread(cx->strc_rpdata + ndata, 1, r->n, f) != r->n) {
+      pmsg_error("truncated packet %lu in recording file %s\n", (unsigned long) nrec, fname);
+      goto error;
+    }
+    ndata += r->n;
+  }
+  fclose(f);
+  cx->strc_rpn = nrec;
+  cx->strc_rpi = 0;
+  cx->strc_replay = 1;
+  pmsg_notice("replaying %lu serial transaction%s from %s\n", (unsigned long) nrec, str_plural(nrec), fname);
+  return 0;
+
+error:
+  fclose(f);
+  mmt_free(cx->strc_rprec);
+  mmt_free(cx->strc_rpdata);
+  cx->strc_rprec = NULL;
+  cx->strc_rpdata = NULL;
+  return -1;
+}
+
+// Next recorded transaction if it has direction dir and length len, NULL otherwise
+static const Sertrace_rec *replay_next(int dir, size_t len) {
+  const char *what = dir == SERTRACE_SEND? "send": "recv";
+
+  if(cx->strc_rpi >= cx->strc_rpn) {
+    pmsg_error("replay exhausted after %lu transactions at %s of %lu byte%s\n",
+      (unsigned long) cx->strc_rpn, what, (unsigned long) len, str_plural(len));
+    return NULL;
+  }
+  const Sertrace_rec *r = cx->strc_rprec + cx->strc_rpi;
+
+  if(r->dir != dir || r->len != len) {
+    pmsg_error("replay diverges at transaction %lu: %s of %lu byte%s but recorded %s of %lu byte%s\n",
+      (unsigned long) cx->strc_rpi + 1, what, (unsigned long) len, str_plural(len),
+      r->dir == SERTRACE_SEND? "send": "recv", (unsigned long) r->len, str_plural(r->len));
+    return NULL;
+  }
+  cx->strc_rpi++;
+  return r;
+}
+
+static int replay_open(const char *port, union pinfo pinfo, union filedescriptor *fd) {
+  fd->ifd = -1;
+  return 0;
+}
+
+static int replay_setparams(const union filedescriptor *fd, long baud, unsigned long cflags) {
+  return 0;
+}
+
+static void replay_close(union filedescriptor *fd) {
+}
+
+static int replay_send(const union filedescriptor *fd, const unsigned char *buf, size_t buflen) {
+  const Sertrace_rec *r = replay_next(SERTRACE_SEND, buflen);
+
+  if(!r)
+    return -1;
+  if(memcmp(buf, cx->strc_rpdata + r->off, r->n)) {
+    pmsg_error("replay diverges at transaction %lu: sent data differs from recording\n",
+      (unsigned long) cx->strc_rpi);
+    return -1;
+  }
+  return r->rc;
+}
+
+static int replay_recv(const union filedescriptor *fd, unsigned char *buf, size_t buflen) {
+  const Sertrace_rec *r = replay_next(SERTRACE_RECV, buflen);
+
+  if(!r)
+    return -1;
+  memcpy(buf, cx->strc_rpdata + r->off, r->n);
+  if(r->n < buflen)
+    memset(buf + r->n, 0, buflen - r->n);
+  return r->rc;
+}
+
+static int replay_drain(const union filedescriptor *fd, int display) {
+  return 0;
+}
+
+static int replay_set_dtr_rts(const union filedescriptor *fd, int is_on) {
+  return 0;
+}
+
+// Report how much of the recording was replayed
+void serial_replay_done(void) {
+  if(!cx->strc_replay)
+    return;
+  if(cx->strc_rpi < cx->strc_rpn)
+    pmsg_warning("only %lu of %lu recorded serial transactions were replayed\n",
+      (unsigned long) cx->strc_rpi, (unsigned long) cx->strc_rpn);
+  else
+    pmsg_notice("replayed all %lu recorded serial transactions\n", (unsigned long) cx->strc_rpn);
+}
+
+struct serial_device serial_replay_serdev = {
+  .name = "replay",
+  .open = replay_open,
+  .setparams = replay_setparams,
+  .close = replay_close,
+  .rawclose = replay_close,
+  .send = replay_send,
+  .recv = replay_recv,
+  .drain = replay_drain,
+  .set_dtr_rts = replay_set_dtr_rts,
+  .flags = SERDEV_FL_CANSETSPEED,
+};
@@ -42,6 +42,7 @@
 
 #define STK500_XTAL 7372800U
 #define MAX_SYNC_ATTEMPTS 10
+#define STK500_PROBE_MS 10      // Interval between sync probes of stk500_fastsync()
 
 static double f_to_kHz_MHz(double f, const char **unit) {
   if(f >= 1e6) {
@@ -141,6 +142,42 @@ int stk500_getsync(const PROGRAMMER *pgm) {
   return 0;
 }
 
+/*
+ * Adaptive bootloader entry right after a reset: rather than waiting a fixed
+ * time for the bootloader, send a Cmnd_STK_GET_SYNC probe every few ms and
+ * accept the first Resp_STK_INSYNC Resp_STK_OK pair; the replies to probes
+ * still in flight are drained with a short timeout. Returns 0 on success and
+ * -1 if the bootloader has not answered within ms milliseconds.
+ */
+int stk500_fastsync(const PROGRAMMER *pgm, int ms) {
+  unsigned char probe[2] = { Cmnd_STK_GET_SYNC, Sync_CRC_EOP }, c, prev = 0;
+  long bak_recv = serial_recv_timeout, bak_drain = serial_drain_timeout;
+  uint64_t start = avr_mstimestamp(), now = start;
+  int rc = -1;
+
+  serial_recv_timeout = STK500_PROBE_MS;
+  while(rc && now - start < (uint64_t) ms) {
+    stk500_send(pgm, probe, 2);
+    // Scan all bytes coming in until the line is quiet for a probe interval
+    while(rc && serial_recv(&pgm->fd, &c, 1) >= 0 && avr_mstimestamp() - start < (uint64_t) ms) {
+      if(prev == Resp_STK_INSYNC && c == Resp_STK_OK)
+        rc = 0;
+      prev = c;
+    }
+    now = avr_mstimestamp();
+  }
+
+  if(rc == 0) {
+    pmsg_notice2("%s(): bootloader in sync after %d ms\n", __func__, (int) (now - start));
+    serial_drain_timeout = STK500_PROBE_MS;
+    stk500_drain(pgm, 0);
+  }
+  serial_recv_timeout = bak_recv;
+  serial_drain_timeout = bak_drain;
+
+  return rc;
+}
+
 /*
  * Transmit an AVR device command and return the results; 'cmd' and 'res' must
  * point to at least a 4 byte data buffer
@@ -198,7 +235,7 @@ static int stk500_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   memset(cmd, 0, sizeof(cmd));
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -609,6 +646,24 @@ retry:
   return pgm->program_enable(pgm, p);
 }
 
+/*
+ * Parse -x blocksize=<n>: the programmer or bootloader declares it accepts
+ * Cmnd_STK_READ_PAGE and Cmnd_STK_PROG_PAGE for up to n bytes at a time
+ */
+int stk500_parse_blocksize(const PROGRAMMER *pgm, const char *extended_param) {
+  const char *errptr;
+  int n = str_int(extended_param + strlen("blocksize="), STR_INT32, &errptr);
+
+  if(errptr || n < 1 || n > 4096) {
+    pmsg_error("invalid value in -x %s; use -x blocksize=<1..4096>\n", extended_param);
+    return -1;
+  }
+  my.read_block = n;
+  my.write_block = n;
+
+  return 0;
+}
+
 static int stk500_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
   int attempts;
   int rv = 0;
@@ -623,6 +678,14 @@ static int stk500_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       continue;
     }
 
+    if(str_starts(extended_param, "blocksize=")) {
+      if(stk500_parse_blocksize(pgm, extended_param) < 0) {
+        rv = -1;
+        break;
+      }
+      continue;
+    }
+
     if(str_starts(extended_param, "vtarg")) {
       if((pgm->extra_features & HAS_VTARG_ADJ) && (str_starts(extended_param, "vtarg="))) {
         // Set target voltage
@@ -765,6 +828,7 @@ static int stk500_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
     }
     msg_error("%s -c %s extended options:\n", progname, pgmid);
     msg_error("  -x attempts=<n>   Specify the number <n> of connection retry attempts\n");
+    msg_error("  -x blocksize=<n>  Read/write blocks of up to <n> bytes (multiple pages)\n");
     if(pgm->extra_features & HAS_VTARG_READ) {
       msg_error("  -x vtarg          Read target supply voltage\n");
     }
@@ -879,17 +943,45 @@ static void stk500_close(PROGRAMMER *pgm) {
   pgm->fd.ifd = -1;
 }
 
-// Address is byte address; a_div == 2: send word address; a_div == 1: send byte address
-static int stk500_loadaddr(const PROGRAMMER *pgm, const AVRMEM *mem, unsigned int addr, int a_div) {
-  unsigned char buf[16];
-  int tries;
-  unsigned char ext_byte;
+/*
+ * Receive the Resp_STK_INSYNC, Resp_STK_OK pair that closes most commands;
+ * returns 0 on success, 1 if the programmer is out of sync and -1 on error
+ */
+static int stk500_recv_insync_ok(const PROGRAMMER *pgm) {
+  unsigned char buf[2];
 
-  addr /= a_div;
+  if(stk500_recv(pgm, buf, 1) < 0)
+    return -1;
+  if(buf[0] == Resp_STK_NOSYNC)
+    return 1;
+  if(buf[0] != Resp_STK_INSYNC) {
+    pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
+    return -1;
+  }
 
-  tries = 0;
-retry:
-  tries++;
+  if(stk500_recv(pgm, buf, 1) < 0)
+    return -1;
+  if(buf[0] == Resp_STK_OK)
+    return 0;
+
+  pmsg_error("protocol expects OK byte 0x%02x but got 0x%02x\n", Resp_STK_OK, buf[0]);
+
+  return -1;
+}
+
+/*
+ * Load the extended address byte if the addressed len bytes need one and put
+ * the Cmnd_STK_LOAD_ADDRESS command into buf, so the caller can send it
+ * together with the following command; returns the length of that command
+ *
+ * Address is byte address; a_div == 2: send word address; a_div == 1: send byte address
+ */
+static int stk500_loadaddr_cmd(const PROGRAMMER *pgm, const AVRMEM *mem, unsigned int addr, int a_div,
+  unsigned int len, unsigned char *buf) {
+
+  unsigned char ext_byte, cmd[4];
+
+  addr /= a_div;
 
   // Support large flash by sending the correct extended address byte when needed
 
@@ -897,16 +989,16 @@ retry:
     if(mem->size/a_div > 64*1024) { // Extended addressing needed
       ext_byte = (addr >> 16) & 0xff;
       if(ext_byte != my.ext_addr_byte) { // First addr load or a different 64k section
-        buf[0] = 0x4d;          // Protocol bytes that bootloaders expect
-        buf[1] = 0x00;
-        buf[2] = ext_byte;
-        buf[3] = 0x00;
-        if(stk500_cmd(pgm, buf, buf) == 0)
+        cmd[0] = 0x4d;          // Protocol bytes that bootloaders expect
+        cmd[1] = 0x00;
+        cmd[2] = ext_byte;
+        cmd[3] = 0x00;
+        if(stk500_cmd(pgm, cmd, cmd) == 0)
           my.ext_addr_byte = ext_byte;
       }
       /*
-       * Ensure next paged r/w will load ext addr again if page sits just below
-       * a 64k boundary
+       * Ensure next paged r/w will load ext addr again if the block sits just
+       * below a 64k boundary
        *
        * Some bootloaders increment their copy of ext_addr_byte in that
        * situation, eg, when they use elpm rx, Z+ to read a byte from flash or
@@ -917,7 +1009,7 @@ retry:
        * bootloader has been auto-incremented. Verifying the code from start
        * exposes the discrepancy.
        */
-      if((addr & 0xffff0000) != ((addr + mem->page_size/a_div) & 0xffff0000))
+      if((addr & 0xffff0000) != ((addr + len/a_div) & 0xffff0000))
         my.ext_addr_byte = 0xff;
     }
   } else {                      // Programmer *not* for bootloaders? Original stk500v1 protocol!
@@ -926,10 +1018,10 @@ retry:
     if(lext) {
       ext_byte = (addr >> 16) & 0xff;
       if(ext_byte != my.ext_addr_byte) { // First addr load or a different 64k section
-        memset(buf, 0, 4);      // Part's load_ext_addr command is typically 4d 00 ext_addr 00
-        avr_set_bits(lext, buf);
-        avr_set_addr(lext, buf, addr);
-        if(stk500_cmd(pgm, buf, buf) == 0)
+        memset(cmd, 0, 4);      // Part's load_ext_addr command is typically 4d 00 ext_addr 00
+        avr_set_bits(lext, cmd);
+        avr_set_addr(lext, cmd, addr);
+        if(stk500_cmd(pgm, cmd, cmd) == 0)
           my.ext_addr_byte = ext_byte;
       }
     }
@@ -940,11 +1032,23 @@ retry:
   buf[2] = (addr >> 8) & 0xff;
   buf[3] = Sync_CRC_EOP;
 
-  stk500_send(pgm, buf, 4);
+  return 4;
+}
 
-  if(stk500_recv(pgm, buf, 1) < 0)
-    return -1;
-  if(buf[0] == Resp_STK_NOSYNC) {
+// Address is byte address; a_div == 2: send word address; a_div == 1: send byte address
+static int stk500_loadaddr(const PROGRAMMER *pgm, const AVRMEM *mem, unsigned int addr, int a_div,
+  unsigned int len) {
+
+  unsigned char buf[16];
+  int tries, rc;
+
+  tries = 0;
+retry:
+  tries++;
+
+  stk500_send(pgm, buf, stk500_loadaddr_cmd(pgm, mem, addr, a_div, len, buf));
+
+  if((rc = stk500_recv_insync_ok(pgm)) == 1) {
     if(tries > 33) {
       pmsg_error("cannot get into sync\n");
       return -1;
@@ -952,19 +1056,9 @@ retry:
     if(stk500_getsync(pgm) < 0)
       return -1;
     goto retry;
-  } else if(buf[0] != Resp_STK_INSYNC) {
-    pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
-    return -1;
   }
 
-  if(stk500_recv(pgm, buf, 1) < 0)
-    return -1;
-  if(buf[0] == Resp_STK_OK)
-    return 0;
-
-  pmsg_error("protocol expects OK byte 0x%02x but got 0x%02x\n", Resp_STK_OK, buf[0]);
-
-  return -1;
+  return rc;
 }
 
 static int set_memchr_a_div(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m, int *memchrp, int *a_divp) {
@@ -990,20 +1084,41 @@ static int set_memchr_a_div(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   return -1;
 }
 
+/*
+ * Size of the next block from addr to n with at most max bytes, but at
+ * least one page; blocks that are larger than a page do not straddle the
+ * boundary of a 64k extended address section
+ */
+static unsigned int stk500_block_size(const AVRMEM *m, unsigned int page_size, unsigned int addr,
+  unsigned int n, unsigned int max, int a_div) {
+
+  unsigned int block_size = max > page_size? max/page_size*page_size: page_size;
+
+  if(block_size > page_size) {
+    unsigned int sect = 0x10000*a_div, left = sect - addr%sect;
+
+    if(m->size/a_div > 64*1024 && block_size > left)
+      block_size = left > page_size? left/page_size*page_size: page_size;
+  }
+
+  return n - addr < block_size? n - addr: block_size;
+}
+
 static int stk500_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
-  unsigned char *buf = alloca(page_size + 16);
   int memchr;
   int a_div;
   int block_size;
-  int tries;
+  int tries, rc;
   unsigned int n;
   unsigned int i;
+  int mib510 = str_eq(pgmid, "mib510");
 
   if(set_memchr_a_div(pgm, p, m, &memchr, &a_div) < 0)
     return -2;
 
   n = addr + n_bytes;
+  unsigned char *buf = mmt_malloc((mib510? 256: my.write_block > page_size? my.write_block: page_size) + 16);
 
 #if 0
   msg_debug("n_bytes   = %d\n" "n         = %u\n" "a_div     = %d\n" "page_size = %d\n", n_bytes, n, a_div, page_size);
@@ -1011,22 +1126,24 @@ static int stk500_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
 
   for(; addr < n; addr += block_size) {
     // MIB510 uses fixed blocks size of 256 bytes
-    if(str_eq(pgmid, "mib510")) {
+    if(mib510)
       block_size = 256;
-    } else {
-      if(n - addr < page_size)
-        block_size = n - addr;
-      else
-        block_size = page_size;
-    }
+    else
+      block_size = stk500_block_size(m, page_size, addr, n, my.write_block, a_div);
     tries = 0;
   retry:
     tries++;
-    stk500_loadaddr(pgm, m, addr, a_div);
 
-    /* build command block and avoid multiple send commands as it leads to a crash
-       of the silabs usb serial driver on mac os x */
+    /*
+     * Build one command block with the address load followed by the page
+     * program command: avoids multiple send commands as it leads to a crash of
+     * the silabs usb serial driver on mac os x and saves a round trip per block
+     */
     i = 0;
+    if(mib510)
+      stk500_loadaddr(pgm, m, addr, a_div, block_size);
+    else
+      i = stk500_loadaddr_cmd(pgm, m, addr, a_div, block_size, buf);
     buf[i++] = Cmnd_STK_PROG_PAGE;
     buf[i++] = (block_size >> 8) & 0xff;
     buf[i++] = block_size & 0xff;
@@ -1036,73 +1153,141 @@ static int stk500_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
     buf[i++] = Sync_CRC_EOP;
     stk500_send(pgm, buf, i);
 
-    if(stk500_recv(pgm, buf, 1) < 0)
-      return -1;
-    if(buf[0] == Resp_STK_NOSYNC) {
+    rc = mib510? 0: stk500_recv_insync_ok(pgm);
+    if(rc == 0 && (rc = stk500_recv(pgm, buf, 1)) == 0) {
+      if(buf[0] == Resp_STK_NOSYNC)
+        rc = 1;
+      else if(buf[0] != Resp_STK_INSYNC) {
+        msg_error("\n");
+        pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
+        mmt_free(buf);
+        return -4;
+      }
+    }
+    if(rc == 1) {
       if(tries > 33) {
         msg_error("\n");
         pmsg_error("cannot get into sync\n");
+        mmt_free(buf);
         return -3;
       }
-      if(stk500_getsync(pgm) < 0)
+      if(stk500_getsync(pgm) < 0) {
+        mmt_free(buf);
         return -1;
+      }
       goto retry;
-    } else if(buf[0] != Resp_STK_INSYNC) {
-      msg_error("\n");
-      pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
-      return -4;
     }
 
-    if(stk500_recv(pgm, buf, 1) < 0)
+    if(rc < 0 || stk500_recv(pgm, buf, 1) < 0) {
+      mmt_free(buf);
       return -1;
+    }
     if(buf[0] != Resp_STK_OK) {
       msg_error("\n");
       pmsg_error("protocol expects OK byte 0x%02x but got 0x%02x\n", Resp_STK_OK, buf[0]);
+      mmt_free(buf);
       return -5;
     }
   }
 
+  mmt_free(buf);
   return n_bytes;
 }
 
+/*
+ * Find out once whether the programmer answers Cmnd_STK_READ_PAGE for 256
+ * bytes at a time, the maximum of the STK500 v1 protocol; bootloaders read
+ * straight from memory, so this is independent of their page buffer size
+ */
+static void stk500_probe_read_block(const PROGRAMMER *pgm, const AVRMEM *m, unsigned int page_size,
+  unsigned int addr, int memchr, int a_div) {
+
+  unsigned char buf[16], *data = mmt_malloc(256);
+  long otimeout = serial_recv_timeout;
+  int i;
+
+  // Nothing to gain or no room for a probe here: try again on a later call
+  if(page_size >= 256 || (unsigned int) m->size < addr + 256 ||
+    (m->size/a_div > 64*1024 && addr/(0x10000*a_div) != (addr + 255)/(0x10000*a_div))) {
+    mmt_free(data);
+    return;
+  }
+  my.read_block = 1;            // One page per command unless proven otherwise below
+
+  i = stk500_loadaddr_cmd(pgm, m, addr, a_div, 256, buf);
+  buf[i++] = Cmnd_STK_READ_PAGE;
+  buf[i++] = 1;
+  buf[i++] = 0;
+  buf[i++] = memchr;
+  buf[i++] = Sync_CRC_EOP;
+  stk500_send(pgm, buf, i);
+
+  serial_recv_timeout = 500;
+  if(serial_recv(&pgm->fd, buf, 3) >= 0 && buf[0] == Resp_STK_INSYNC && buf[1] == Resp_STK_OK &&
+    buf[2] == Resp_STK_INSYNC && serial_recv(&pgm->fd, data, 256) >= 0 &&
+    serial_recv(&pgm->fd, buf, 1) >= 0 && buf[0] == Resp_STK_OK)
+    my.read_block = 256;
+  serial_recv_timeout = otimeout;
+
+  if(my.read_block != 256) {
+    stk500_drain(pgm, 0);
+    my.ext_addr_byte = 0xff;
+    (void) stk500_getsync(pgm);
+  }
+  pmsg_notice2("%s(): reading %s per block\n", __func__, my.read_block == 256? "256 bytes": "one page");
+  mmt_free(data);
+}
+
 static int stk500_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   unsigned char buf[16];
   int memchr;
   int a_div;
-  int tries;
-  unsigned int n;
+  int tries, rc;
+  unsigned int n, i;
   int block_size;
+  int mib510 = str_eq(pgmid, "mib510");
 
   if(set_memchr_a_div(pgm, p, m, &memchr, &a_div) < 0)
     return -2;
 
+  if(!mib510 && !my.read_block && n_bytes > page_size)
+    stk500_probe_read_block(pgm, m, page_size, addr, memchr, a_div);
+
   n = addr + n_bytes;
   for(; addr < n; addr += block_size) {
     // MIB510 uses fixed blocks size of 256 bytes
-    if(str_eq(pgmid, "mib510")) {
+    if(mib510)
       block_size = 256;
-    } else {
-      if(n - addr < page_size)
-        block_size = n - addr;
-      else
-        block_size = page_size;
-    }
+    else
+      block_size = stk500_block_size(m, page_size, addr, n, my.read_block, a_div);
 
     tries = 0;
   retry:
     tries++;
-    stk500_loadaddr(pgm, m, addr, a_div);
-    buf[0] = Cmnd_STK_READ_PAGE;
-    buf[1] = (block_size >> 8) & 0xff;
-    buf[2] = block_size & 0xff;
-    buf[3] = memchr;
-    buf[4] = Sync_CRC_EOP;
-    stk500_send(pgm, buf, 5);
+    i = 0;
+    if(mib510)
+      stk500_loadaddr(pgm, m, addr, a_div, block_size);
+    else
+      i = stk500_loadaddr_cmd(pgm, m, addr, a_div, block_size, buf);
+    buf[i++] = Cmnd_STK_READ_PAGE;
+    buf[i++] = (block_size >> 8) & 0xff;
+    buf[i++] = block_size & 0xff;
+    buf[i++] = memchr;
+    buf[i++] = Sync_CRC_EOP;
+    stk500_send(pgm, buf, i);
 
-    if(stk500_recv(pgm, buf, 1) < 0)
-      return -1;
-    if(buf[0] == Resp_STK_NOSYNC) {
+    rc = mib510? 0: stk500_recv_insync_ok(pgm);
+    if(rc == 0 && (rc = stk500_recv(pgm, buf, 1)) == 0) {
+      if(buf[0] == Resp_STK_NOSYNC)
+        rc = 1;
+      else if(buf[0] != Resp_STK_INSYNC) {
+        msg_error("\n");
+        pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
+        return -4;
+      }
+    }
+    if(rc == 1) {
       if(tries > 33) {
         msg_error("\n");
         pmsg_error("cannot get into sync\n");
@@ -1111,11 +1296,9 @@ static int stk500_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
       if(stk500_getsync(pgm) < 0)
         return -1;
       goto retry;
-    } else if(buf[0] != Resp_STK_INSYNC) {
-      msg_error("\n");
-      pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
-      return -4;
     }
+    if(rc < 0)
+      return -1;
 
     if(stk500_recv(pgm, &m->buf[addr], block_size) < 0)
       return -1;
@@ -1123,7 +1306,7 @@ static int stk500_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRM
     if(stk500_recv(pgm, buf, 1) < 0)
       return -1;
 
-    if(str_eq(pgmid, "mib510")) {
+    if(mib510) {
       if(buf[0] != Resp_STK_INSYNC) {
         msg_error("\n");
         pmsg_error("protocol expects sync byte 0x%02x but got 0x%02x\n", Resp_STK_INSYNC, buf[0]);
@@ -1573,6 +1756,8 @@ void stk500_initpgm(PROGRAMMER *pgm) {
   pgm->setup = stk500_setup;
   pgm->teardown = stk500_teardown;
   pgm->page_size = 256;
+  pgm->multipage_load = 1;
+  pgm->multipage_write = 1;
 
   // Hardware dependent functions
   if(pgm->extra_features & HAS_VTARG_ADJ)
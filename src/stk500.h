@@ -28,7 +28,9 @@ extern "C" {
 
   // Used by arduino.c to avoid duplicate code
   int stk500_getsync(const PROGRAMMER *pgm);
+  int stk500_fastsync(const PROGRAMMER *pgm, int ms);
   int stk500_drain(const PROGRAMMER *pgm, int display);
+  int stk500_parse_blocksize(const PROGRAMMER *pgm, const char *extended_param);
 
 #ifdef __cplusplus
 }
@@ -39,6 +41,7 @@ struct pdata {
   unsigned char ext_addr_byte;  // Record ext-addr byte set in the target device (if used)
   int retry_attempts;           // Number of connection attempts provided by the user
   int xbeeResetPin;             // Piggy back variable used by xbee programmmer
+  int xbeeWindow;               // Piggy back variable: max unacknowledged xbee packets
   struct serial_device xbee_serdev;     // Piggy back device descriptor for XBee framing
 
   // Get/set flags for adjustable target voltage
@@ -60,6 +63,11 @@ struct pdata {
 
   // Flag to enable/disable autoreset for the arduino programmer
   bool autoreset;
+  bool fastsync;                // Probe for the bootloader right after reset (arduino -x fastsync)
+  bool autobaud;                // Find the fastest baud the bootloader answers at (arduino -x autobaud)
+
+  unsigned read_block;          // Max bytes per Cmnd_STK_READ_PAGE: 0 = not yet probed, 1 = one page
+  unsigned write_block;         // Max bytes per Cmnd_STK_PROG_PAGE from -x blocksize, 0 = one page
 };
 
 #define my (*(struct pdata *) (pgm->cookie))
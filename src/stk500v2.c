@@ -50,6 +50,7 @@
 #include "stk500v2.h"
 #include "stk500v2_private.h"
 #include "usbdevs.h"
+#include "crc16.h"
 
 /*
  * We need to import enough from the JTAG ICE mkII definitions to be able to
@@ -74,6 +75,10 @@
 
 // Retry count
 #define RETRIES 5
+#define PROBE_MS 10             // Interval between sign-on probes of stk500v2_fastsync()
+
+// Largest CMD_READ_FLASH_ISP/CMD_READ_EEPROM_ISP block ever tried
+#define STK500V2_READ_MAX 512
 
 #define DEBUG(...) msg_trace2(__VA_ARGS__)
 
@@ -490,10 +495,12 @@ static int stk500v2_send(const PROGRAMMER *pgm, unsigned char *data, size_t len)
   for(size_t i = 0; i < 5 + len; i++)
     buf[5 + len] ^= buf[i];
 
-  DEBUG("STK500V2: stk500v2_send(");
-  for(size_t i = 0; i < len + 6; i++)
-    DEBUG("0x%02x ", buf[i]);
-  DEBUG(", %d)\n", (int) len + 6);
+  if(msg_lvl_on(MSG_TRACE2)) {
+    DEBUG("STK500V2: stk500v2_send(");
+    for(size_t i = 0; i < len + 6; i++)
+      DEBUG("0x%02x ", buf[i]);
+    DEBUG(", %d)\n", (int) len + 6);
+  }
 
   if(serial_send(&pgm->fd, buf, len + 6) != 0) {
     pmsg_error("unable to send command to serial port\n");
@@ -689,7 +696,10 @@ static int stk500v2_recv(const PROGRAMMER *pgm, unsigned char *msg, size_t maxsi
     tnow = avr_timestamp();
     if(tnow - tstart > timeoutval) {
     timedout:
-      pmsg_error("timeout\n");
+      if(my.rto_active)
+        pmsg_notice("no reply within %ld ms, retrying\n", serial_recv_timeout);
+      else
+        pmsg_error("timeout\n");
       return -1;
     }
 
@@ -699,6 +709,43 @@ static int stk500v2_recv(const PROGRAMMER *pgm, unsigned char *msg, size_t maxsi
   return (int) (msglen + 6);
 }
 
+/*
+ * Probe for a bootloader right after reset (wiring -x fastsync): rather than
+ * waiting a fixed time, send CMD_SIGN_ON every few ms and return 0 as soon
+ * as a sign-on answer comes in, after draining the answers to probes still
+ * in flight with a short timeout; the caller then signs on properly with
+ * stk500v2_getsync(). Returns -1 if there was no answer within ms ms.
+ */
+int stk500v2_fastsync(const PROGRAMMER *pgm, int ms) {
+  unsigned char probe[1] = { CMD_SIGN_ON }, win[7] = { 0 };
+  long bak_recv = serial_recv_timeout, bak_drain = serial_drain_timeout;
+  uint64_t start = avr_mstimestamp(), now = start;
+  int rc = -1;
+
+  serial_recv_timeout = PROBE_MS;
+  while(rc && now - start < (uint64_t) ms) {
+    stk500v2_send(pgm, probe, 1);
+    // Look for the start of a sign-on answer until the line is quiet for a probe interval
+    while(rc && serial_recv(&pgm->fd, win + 6, 1) >= 0 && avr_mstimestamp() - start < (uint64_t) ms) {
+      if(win[0] == MESSAGE_START && win[1] == my.command_sequence && win[4] == TOKEN &&
+        win[5] == CMD_SIGN_ON && win[6] == STATUS_CMD_OK)
+        rc = 0;
+      memmove(win, win + 1, 6);
+    }
+    now = avr_mstimestamp();
+  }
+
+  if(rc == 0) {
+    pmsg_notice2("%s(): bootloader answered after %d ms\n", __func__, (int) (now - start));
+    serial_drain_timeout = PROBE_MS;
+    stk500v2_drain(pgm, 0);
+  }
+  serial_recv_timeout = bak_recv;
+  serial_drain_timeout = bak_drain;
+
+  return rc;
+}
+
 int stk500v2_getsync(const PROGRAMMER *pgm) {
   int tries = 0;
   unsigned char buf[1], resp[32];
@@ -781,9 +828,63 @@ retry:
   return 0;
 }
 
+/*
+ * Serial STK500v2 programmers time out by serial_recv_timeout if a frame is
+ * lost, after which stk500v2_command() signs on again and retries. Rather
+ * than waiting the worst case every time, the timeout adapts to the reply
+ * times seen so far for the same command, see serial_rto(); a command that
+ * takes longer than usual is not lost, as the timeout doubles on each retry.
+ */
+static int stk500v2_adaptive(const PROGRAMMER *pgm) {
+  return !my.fixed_timeouts && my.pgmtype != PGMTYPE_AVRISP_MKII && my.pgmtype != PGMTYPE_STK600 &&
+    my.pgmtype != PGMTYPE_JTAGICE_MKII && my.pgmtype != PGMTYPE_JTAGICE3;
+}
+
+// Drop stale bytes and sign on again after a failed paged transfer
+static int stk500v2_resync(const PROGRAMMER *pgm) {
+  long bak_drain = serial_drain_timeout;
+  int rc = 0;
+
+  if(stk500v2_adaptive(pgm))    // The line is quiet once no reply is due any more
+    serial_drain_timeout = serial_rto(&my.rtt_all, bak_drain);
+  if(stk500v2_drain(pgm, 0) < 0 || stk500v2_getsync(pgm) < 0 || stk500v2_drain(pgm, 0) < 0)
+    rc = -1;
+  serial_drain_timeout = bak_drain;
+
+  return rc;
+}
+
+// Does the device address move on with the command, so that repeating it would be wrong?
+static int stk500v2_advances(unsigned char cmd) {
+  switch(cmd) {
+  case CMD_PROGRAM_FLASH_ISP:
+  case CMD_READ_FLASH_ISP:
+  case CMD_PROGRAM_EEPROM_ISP:
+  case CMD_READ_EEPROM_ISP:
+  case CMD_PROGRAM_FLASH_PP:
+  case CMD_READ_FLASH_PP:
+  case CMD_PROGRAM_EEPROM_PP:
+  case CMD_READ_EEPROM_PP:
+  case CMD_PROGRAM_FLASH_HVSP:
+  case CMD_READ_FLASH_HVSP:
+  case CMD_PROGRAM_EEPROM_HVSP:
+  case CMD_READ_EEPROM_HVSP:
+    return 1;
+  }
+
+  return 0;
+}
+
 static int stk500v2_command(const PROGRAMMER *pgm, unsigned char *buf, size_t len, size_t maxlen) {
   int tries = 0;
   int status;
+  Serial_rtt *rtt = stk500v2_adaptive(pgm)? my.rtt + buf[0]: NULL;
+  long bak_timeout = serial_recv_timeout;
+  unsigned char cmd[64];        // Copy of short commands for repeating them after a lost reply
+  int repeatable = len <= sizeof cmd && !stk500v2_advances(buf[0]);
+
+  if(repeatable)
+    memcpy(cmd, buf, len);
 
   DEBUG("STK500V2: stk500v2_command(");
   for(size_t i = 0; i < len; i++)
@@ -793,11 +894,36 @@ static int stk500v2_command(const PROGRAMMER *pgm, unsigned char *buf, size_t le
 retry:
   tries++;
 
+  if(rtt) {
+    serial_recv_timeout = serial_rto(rtt, bak_timeout);
+    my.rto_active = serial_recv_timeout < bak_timeout && tries <= RETRIES;
+  }
+  uint64_t start = avr_ustimestamp();
+
   // Send the command to the programmer
   stk500v2_send(pgm, buf, len);
   // Attempt to read the status back
   status = stk500v2_recv(pgm, buf, maxlen);
 
+  if(rtt) {
+    if(status > 0 && tries == 1) { // Only unambiguous samples, not those of retries
+      uint64_t us = avr_ustimestamp() - start;
+
+      serial_rtt_sample(rtt, us);
+      serial_rtt_sample(&my.rtt_all, us);
+    } else if(status == -1)
+      serial_rtt_timeout(rtt);
+    if(status == -1 && my.rto_active) { // Drop a late reply before signing on again
+      long bak_drain = serial_drain_timeout;
+
+      serial_drain_timeout = serial_recv_timeout;
+      stk500v2_drain(pgm, 0);
+      serial_drain_timeout = bak_drain;
+    }
+    serial_recv_timeout = bak_timeout;
+    my.rto_active = false;
+  }
+
   DEBUG("STK500V2: stk500v2_command() received content: [ ");
   for(size_t i = 0; i < len; i++)
     DEBUG("0x%02x ", buf[i]);
@@ -892,6 +1018,15 @@ retry:
       goto retry;
   }
 
+  // In sync again but the reply was lost: repeat the command or let the caller recover
+  if(rtt) {
+    if(repeatable && tries <= RETRIES) {
+      memcpy(buf, cmd, len);
+      goto retry;
+    }
+    return -1;
+  }
+
   DEBUG(" = 0\n");
   return 0;
 }
@@ -944,13 +1079,17 @@ static int stk500v2_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
     return -1;
   }
 
+  // Let the firmware poll RDY/BSY, if supported, with the delay as timeout
+  int rdybsy = avr_isp_has_rdybsy(p);
+
   buf[0] = CMD_CHIP_ERASE_ISP;
   buf[1] = p->chip_erase_delay/1000;
-  buf[2] = 0;                   // Use delay (?)
+  buf[2] = rdybsy;              // Poll method: 0 = use delay, 1 = RDY/BSY polling
   memset(buf + 3, 0, 4);
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], buf + 3);
   result = stk500v2_command(pgm, buf, 7, sizeof(buf));
-  usleep(p->chip_erase_delay);  // Should not be needed
+  if(!rdybsy)
+    usleep(p->chip_erase_delay);        // Should not be needed
   if(my.pgmtype != PGMTYPE_JTAGICE_MKII) { // Skip for JTAGICE mkII (FW v7.39)
     pgm->initialize(pgm, p);    // Should not be needed
   }
@@ -1845,6 +1984,11 @@ static int stk500v2_parseextparms(const PROGRAMMER *pgm, const LISTID extparms)
       }
     }
 
+    if(str_eq(extended_param, "fixedtimeouts")) {
+      my.fixed_timeouts = true;
+      continue;
+    }
+
     if(str_starts(extended_param, "xtal")) {
       // Set clock generator frequency
       if(str_starts(extended_param, "xtal=")) {
@@ -1909,6 +2053,7 @@ static int stk500v2_parseextparms(const PROGRAMMER *pgm, const LISTID extparms)
       msg_error("  -x fosc=off       Switch the oscillator clock off\n");
     }
     msg_error("  -x xtal=<n>[unit] Set programmer xtal frequency to <n> Hz (or kHz/MHz)\n");
+    msg_error("  -x fixedtimeouts  Always wait the worst case for replies, do not adapt timeouts\n");
     msg_error("  -x help           Show this help menu and exit\n");
     return rv;
   }
@@ -2812,8 +2957,12 @@ static int stk500v2_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const A
     // Do not send request to write empty flash pages except for bootloaders (fixes Issue #425)
     unsigned char *p = m->buf + addr;
 
-    result = is_spm(pgm) || !addrshift || *p != 0xff || memcmp(p, p + 1, block_size - 1)?
-      stk500v2_command(pgm, buf, block_size + 10, sizeof buf): 0;
+    if(is_spm(pgm) || !addrshift || *p != 0xff || memcmp(p, p + 1, block_size - 1))
+      result = stk500v2_command(pgm, buf, block_size + 10, sizeof buf);
+    else {                      // Skipped page: device address no longer follows last_addr
+      result = 0;
+      last_addr = UINT_MAX;
+    }
 
     if(result < 0) {
       pmsg_error("write command failed\n");
@@ -2924,12 +3073,29 @@ static int stk500hvsp_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const
   return stk500hv_paged_write(pgm, p, m, page_size, addr, n_bytes, HVSPMODE);
 }
 
+/*
+ * Largest ISP read block worth trying for the connected tool: the STK500 and
+ * AVRISP serial message body holds 275 bytes and the AVRISP mkII firmware
+ * is not known to buffer more than 256 data bytes behind its 64-byte USB
+ * endpoint; the STK600 and the JTAG ICE backends may accept larger blocks
+ */
+static unsigned int stk500v2_read_ceiling(const PROGRAMMER *pgm) {
+  switch(my.pgmtype) {
+  case PGMTYPE_STK600:
+  case PGMTYPE_JTAGICE_MKII:
+  case PGMTYPE_JTAGICE3:
+    return STK500V2_READ_MAX;
+  default:
+    return 256;
+  }
+}
+
 static int stk500v2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   unsigned int block_size, hiaddr, addrshift, use_ext_addr;
   unsigned int maxaddr = addr + n_bytes;
   unsigned char commandbuf[4];
-  unsigned char buf[275];       // Max buffer size for stk500v2 at this point
+  unsigned char buf[STK500V2_READ_MAX + 19];
   unsigned char cmds[4];
   int result;
   OPCODE *rop;
@@ -2970,11 +3136,24 @@ static int stk500v2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AV
   avr_set_bits(rop, cmds);
   commandbuf[3] = cmds[0];
 
-  for(; addr < maxaddr; addr += page_size) {
-    if((maxaddr - addr) < page_size)
+  if(page_size == 0 || page_size > STK500V2_READ_MAX)
+    page_size = 256;
+
+  for(; addr < maxaddr; addr += block_size) {
+    /*
+     * Read in multiples of readsize up to the largest block the tool is known
+     * to accept; until that is established, larger blocks are tried first
+     */
+    unsigned int max = my.max_read? my.max_read: stk500v2_read_ceiling(pgm);
+    unsigned int full = max > page_size? max/page_size*page_size: page_size;
+
+    block_size = full;
+    if((maxaddr - addr) < block_size)
       block_size = maxaddr - addr;
-    else
-      block_size = page_size;
+    if(block_size > page_size && ((addr + block_size - 1) & ~0xFFFF) != (addr & ~0xFFFF))
+      block_size = (addr | 0xFFFF) + 1 - addr; // Do not straddle a 64 KB boundary
+    if(!my.max_read_ok && block_size < full && block_size > page_size)
+      block_size = page_size;   // Only probe with full-sized blocks
     DEBUG("block_size at addr %d is %d\n", addr, block_size);
 
     memcpy(buf, commandbuf, sizeof(commandbuf));
@@ -2989,10 +3168,31 @@ static int stk500v2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AV
         return -1;
     }
 
-    result = stk500v2_command(pgm, buf, 4, sizeof(buf));
-    if(result < 0) {
-      pmsg_error("read command failed\n");
-      return -1;
+    if(block_size > page_size && !my.max_read_ok) {
+      // Probe quietly: a tool refusing the block size is not an error
+      stk500v2_send(pgm, buf, 4);
+      result = stk500v2_recv(pgm, buf, sizeof buf);
+      if(result < (int) block_size + 3 || buf[0] != commandbuf[0] || buf[1] != STATUS_CMD_OK ||
+        buf[2 + block_size] != STATUS_CMD_OK) {
+
+        if(result <= 0)
+          (void) stk500v2_getsync(pgm);
+        my.max_read = block_size/2 > page_size? block_size/2: page_size;
+        my.max_read_ok = my.max_read == page_size;
+        pmsg_notice2("%s(): %u byte read refused, trying %u bytes\n", __func__, block_size, my.max_read);
+        hiaddr = UINT_MAX;      // Device address is unknown now
+        block_size = 0;
+        continue;
+      }
+      my.max_read = full;
+      my.max_read_ok = true;
+      pmsg_notice2("%s(): reading up to %u bytes per command\n", __func__, full);
+    } else {
+      result = stk500v2_command(pgm, buf, 4, sizeof(buf));
+      if(result < 0) {
+        pmsg_error("read command failed\n");
+        return -1;
+      }
     }
 
 #if 0
@@ -3009,6 +3209,27 @@ static int stk500v2_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AV
   return n_bytes;
 }
 
+/*
+ * Read neighbouring ranges in one command if they fit into the largest read
+ * block the tool is known to accept, which saves the load address command
+ * and the round trip of a separate read
+ */
+static int stk500v2_paged_load_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, const Avr_range *rg, int nr) {
+  Avr_range *r = mmt_malloc(nr*sizeof *r);
+  int n = nr, rc = 0, n_bytes = 0;
+
+  for(int i = 0; i < nr; i++)
+    n_bytes += (r[i] = rg[i]).n;
+  if(my.max_read_ok && my.max_read > 0)
+    n = avr_ranges_coalesce(r, nr, my.max_read);
+  for(int i = 0; i < n && rc >= 0; i++)
+    rc = stk500v2_paged_load(pgm, p, m, page_size, r[i].addr, r[i].n);
+  mmt_free(r);
+
+  return rc < 0? rc: n_bytes;
+}
+
 // Read pages of flash/EEPROM, generic HV mode
 static int stk500hv_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes, enum hvmode mode) {
@@ -4424,16 +4645,60 @@ static int stk600_xprog_read_byte(const PROGRAMMER *pgm, const AVRPART *p, const
   return 0;
 }
 
+// Tools on raw USB frames carry no sequence numbers, so XPROG commands can be queued
+static bool stk600_xprog_can_queue(const PROGRAMMER *pgm) {
+  return my.pgmtype == PGMTYPE_AVRISP_MKII || my.pgmtype == PGMTYPE_STK600;
+}
+
+// Send XPROG command b without waiting for the reply
+static int stk600_xprog_send(const PROGRAMMER *pgm, const unsigned char *b, unsigned int cmdsize) {
+  unsigned char *newb = mmt_malloc(cmdsize + 1);
+
+  newb[0] = CMD_XPROG;
+  memcpy(newb + 1, b, cmdsize);
+  int rv = stk500v2_send(pgm, newb, cmdsize + 1);
+
+  mmt_free(newb);
+
+  return rv;
+}
+
+// Receive the status reply of an earlier XPROG command xcmd
+static int stk600_xprog_status(const PROGRAMMER *pgm, unsigned char xcmd) {
+  unsigned char r[16];
+  int rv = stk500v2_recv(pgm, r, sizeof r);
+
+  return rv < 3 || r[0] != CMD_XPROG || r[1] != xcmd || r[2] != XPRG_ERR_OK? -1: 0;
+}
+
+/*
+ * Issue an XPROG write command; if queue is set, only collect the reply of
+ * the previous command, so that at most one reply is outstanding (*pending)
+ */
+static int stk600_xprog_write_cmd(const PROGRAMMER *pgm, unsigned char *b, unsigned int cmdsize,
+  bool queue, int *pending) {
+
+  if(!queue)
+    return stk600_xprog_command(pgm, b, cmdsize, 2);
+  if(stk600_xprog_send(pgm, b, cmdsize) < 0)
+    return -1;
+  if(++*pending < 2)
+    return 0;
+  --*pending;
+
+  return stk600_xprog_status(pgm, b[0]);
+}
+
 static int stk600_xprog_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
   unsigned char *b;
-  unsigned int offset;
+  unsigned int offset, block_size;
   unsigned char mtype;
   int n_bytes_orig = n_bytes, dynamic_mtype = 0;
   unsigned long use_ext_addr = 0;
 
-  // The XPROG read command supports at most 256 bytes in one transfer
-  if(page_size > 256)
+  // All tools accept XPROG reads of 256 bytes; larger blocks are probed below
+  if(page_size == 0 || page_size > 256)
     page_size = 256;            // Not really a page size anymore
 
   /*
@@ -4476,13 +4741,26 @@ static int stk600_xprog_paged_load(const PROGRAMMER *pgm, const AVRPART *p, cons
   offset = addr;
   addr += mem->offset;
 
-  b = mmt_malloc(page_size + 2);
+  b = mmt_malloc(STK500V2_READ_MAX + 3);
   if(stk500v2_loadaddr(pgm, use_ext_addr) < 0) {
     mmt_free(b);
     return -1;
   }
 
   while(n_bytes != 0) {
+    /*
+     * Runs of pages are read in blocks up to the largest the tool is known to
+     * accept; until that is established, full-sized blocks are tried first
+     */
+    unsigned int max = my.xprog_max_read? my.xprog_max_read: stk500v2_read_ceiling(pgm);
+    unsigned int full = max > page_size? max/page_size*page_size: page_size;
+
+    block_size = n_bytes >= full? full: n_bytes > page_size? n_bytes/page_size*page_size: page_size;
+    if(dynamic_mtype && addr - mem->offset < my.boot_start && addr - mem->offset + block_size > my.boot_start)
+      block_size = my.boot_start - (addr - mem->offset); // Boot section needs its own memory type
+    if(!my.xprog_max_read_ok && block_size < full && block_size > page_size)
+      block_size = page_size;
+
     if(dynamic_mtype)
       mtype = stk600_xprog_mtype(pgm, addr - mem->offset);
 
@@ -4492,35 +4770,58 @@ static int stk600_xprog_paged_load(const PROGRAMMER *pgm, const AVRPART *p, cons
     b[3] = addr >> 16;
     b[4] = addr >> 8;
     b[5] = addr;
-    b[6] = page_size >> 8;
-    b[7] = page_size;
-    if(stk600_xprog_command(pgm, b, 8, page_size + 2) < 0) {
+    b[6] = block_size >> 8;
+    b[7] = block_size;
+    if(block_size > page_size && !my.xprog_max_read_ok) {
+      // Probe quietly: a tool refusing the block size is not an error
+      int result = stk600_xprog_send(pgm, b, 8) < 0? -1: stk500v2_recv(pgm, b, STK500V2_READ_MAX + 3);
+
+      if(result < (int) block_size + 3 || b[0] != CMD_XPROG || b[1] != XPRG_CMD_READ_MEM || b[2] != XPRG_ERR_OK) {
+        if(result <= 0)
+          (void) stk500v2_drain(pgm, 0);
+        my.xprog_max_read = block_size/2 > page_size? block_size/2: page_size;
+        my.xprog_max_read_ok = my.xprog_max_read == page_size;
+        pmsg_notice2("%s(): %u byte read refused, trying %u bytes\n", __func__, block_size, my.xprog_max_read);
+        continue;
+      }
+      my.xprog_max_read = full;
+      my.xprog_max_read_ok = true;
+      pmsg_notice2("%s(): reading up to %u bytes per command\n", __func__, full);
+      memmove(b + 2, b + 3, block_size); // Same layout as after stk600_xprog_command()
+    } else if(stk600_xprog_command(pgm, b, 8, block_size + 2) < 0) {
       pmsg_error("XPRG_CMD_READ_MEM failed\n");
       mmt_free(b);
       return -1;
     }
-    memcpy(mem->buf + offset, b + 2, page_size);
-    if(n_bytes < page_size) {
-      n_bytes = page_size;
+    memcpy(mem->buf + offset, b + 2, block_size);
+    if(n_bytes < block_size) {
+      n_bytes = block_size;
     }
-    offset += page_size;
-    addr += page_size;
-    n_bytes -= page_size;
+    offset += block_size;
+    addr += block_size;
+    n_bytes -= block_size;
   }
   mmt_free(b);
 
   return n_bytes_orig;
 }
 
-static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
-  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+/*
+ * Write pages with XPRG_CMD_WRITE_MEM, optionally erasing each page first in
+ * the same command. Tools on raw USB frames receive the next command while
+ * the current page is still being programmed, so the host round trip
+ * overlaps with the NVM write.
+ */
+static int stk600_xprog_write_pages(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes, bool erase) {
   unsigned char *b;
   unsigned int offset;
   unsigned char mtype;
-  int n_bytes_orig = n_bytes, dynamic_mtype = 0;
+  int n_bytes_orig = n_bytes, dynamic_mtype = 0, pending = 0;
   size_t writesize;
   unsigned long use_ext_addr = 0;
   unsigned char writemode;
+  bool queue = stk600_xprog_can_queue(pgm);
 
   // The XPROG read command supports at most 256 bytes in one transfer
   if(page_size > 512) {
@@ -4596,8 +4897,7 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
        */
       if(page_size%256 != 0) {
         pmsg_error("page size not multiple of 256\n");
-        mmt_free(b);
-        return -1;
+        goto fail;
       }
       unsigned int chunk;
 
@@ -4610,7 +4910,7 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
         }
         b[0] = XPRG_CMD_WRITE_MEM;
         b[1] = mtype;
-        b[2] = writemode;
+        b[2] = writemode | (erase && chunk == 0? 1 << XPRG_MEM_WRITE_ERASE: 0);
         b[3] = addr >> 24;
         b[4] = addr >> 16;
         b[5] = addr >> 8;
@@ -4618,10 +4918,9 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
         b[7] = 1;
         b[8] = 0;
         memcpy(b + 9, mem->buf + offset, writesize);
-        if(stk600_xprog_command(pgm, b, 256 + 9, 2) < 0) {
+        if(stk600_xprog_write_cmd(pgm, b, 256 + 9, queue, &pending) < 0) {
           pmsg_error("XPRG_CMD_WRITE_MEM failed\n");
-          mmt_free(b);
-          return -1;
+          goto fail;
         }
         if(n_bytes < 256)
           n_bytes = 256;
@@ -4640,7 +4939,7 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
       }
       b[0] = XPRG_CMD_WRITE_MEM;
       b[1] = mtype;
-      b[2] = writemode;
+      b[2] = writemode | (erase? 1 << XPRG_MEM_WRITE_ERASE: 0);
       b[3] = addr >> 24;
       b[4] = addr >> 16;
       b[5] = addr >> 8;
@@ -4648,10 +4947,9 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
       b[7] = page_size >> 8;
       b[8] = page_size;
       memcpy(b + 9, mem->buf + offset, writesize);
-      if(stk600_xprog_command(pgm, b, page_size + 9, 2) < 0) {
+      if(stk600_xprog_write_cmd(pgm, b, page_size + 9, queue, &pending) < 0) {
         pmsg_error("XPRG_CMD_WRITE_MEM failed\n");
-        mmt_free(b);
-        return -1;
+        goto fail;
       }
       if(n_bytes < page_size)
         n_bytes = page_size;
@@ -4662,8 +4960,71 @@ static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, con
     }
   }
   mmt_free(b);
+  if(pending && stk600_xprog_status(pgm, XPRG_CMD_WRITE_MEM) < 0) {
+    pmsg_error("XPRG_CMD_WRITE_MEM failed\n");
+    return -1;
+  }
 
   return n_bytes_orig;
+
+fail:
+  mmt_free(b);
+  if(pending)                   // Discard the reply still in flight
+    (void) stk500v2_drain(pgm, 0);
+  return -1;
+}
+
+static int stk600_xprog_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  return stk600_xprog_write_pages(pgm, p, mem, page_size, addr, n_bytes, false);
+}
+
+// Erase and write flash pages with one XPRG_CMD_WRITE_MEM each
+static int stk600_xprog_paged_erase_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  if(is_tpi(p) || !(mem_is_flash(mem) || mem_is_application(mem) || mem_is_apptable(mem) || mem_is_boot(mem)))
+    return -2;
+
+  return stk600_xprog_write_pages(pgm, p, mem, page_size, addr, n_bytes, true);
+}
+
+/*
+ * Confirm a whole application section, boot section or flash on the device
+ * by the CRC that the XPROG firmware has the NVM controller compute; other
+ * ranges cannot be checked this way. XPRG_CMD_CRC returns the 24-bit NVM
+ * CRC, which is compared with crc24sum() of data. Should a part compute a
+ * different checksum the range is merely read back as usual.
+ */
+static int stk600_xprog_verify_range(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
+  unsigned int addr, unsigned int n, const unsigned char *data) {
+
+  unsigned char b[5];
+
+  if(!is_pdi(p) || addr != 0 || n != (unsigned int) mem->size)
+    return -1;
+  if(mem_is_application(mem))
+    b[1] = XPRG_CRC_APP;
+  else if(mem_is_boot(mem))
+    b[1] = XPRG_CRC_BOOT;
+  else if(mem_is_flash(mem))
+    b[1] = XPRG_CRC_FLASH;
+  else
+    return -1;
+
+  b[0] = XPRG_CMD_CRC;
+  if(stk600_xprog_command(pgm, b, 2, 5) < 0) {
+    pmsg_debug("XPRG_CMD_CRC failed\n");
+    return -1;
+  }
+
+  unsigned long devcrc = (unsigned long) b[2] << 16 | b[3] << 8 | b[4];
+  unsigned long crc = crc24sum(data, n, 0);
+
+  pmsg_debug("%s(%s): device CRC 0x%06lx, expected 0x%06lx\n", __func__, mem->desc, devcrc, crc);
+
+  return devcrc == crc;
 }
 
 static int stk600_xprog_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
@@ -4729,9 +5090,13 @@ static void stk600_setup_xprog(PROGRAMMER *pgm) {
   pgm->read_byte = stk600_xprog_read_byte;
   pgm->write_byte = stk600_xprog_write_byte;
   pgm->paged_load = stk600_xprog_paged_load;
+  pgm->multipage_load = 1;
   pgm->paged_write = stk600_xprog_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_erase_write = stk600_xprog_paged_erase_write;
   pgm->page_erase = stk600_xprog_page_erase;
   pgm->chip_erase = stk600_xprog_chip_erase;
+  pgm->verify_range = stk600_xprog_verify_range;
 }
 
 // Modify pgm's methods for ISP operation
@@ -4741,9 +5106,14 @@ static void stk600_setup_isp(PROGRAMMER *pgm) {
   pgm->read_byte = stk500isp_read_byte;
   pgm->write_byte = stk500isp_write_byte;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->multipage_load = 1;
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
+  pgm->paged_erase_write = NULL;
   pgm->page_erase = NULL;
   pgm->chip_erase = stk500v2_chip_erase;
+  pgm->verify_range = NULL;
 }
 
 const char stk500v2_desc[] = "Atmel STK500 Version 2.x firmware";
@@ -4766,7 +5136,11 @@ void stk500v2_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->resync = stk500v2_resync;
+  pgm->multipage_load = 1;
   pgm->page_erase = NULL;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_set_sck_period;
@@ -4812,6 +5186,7 @@ void stk500pp_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = stk500pp_paged_write;
   pgm->paged_load = stk500pp_paged_load;
+  pgm->resync = stk500v2_resync;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_set_sck_period;
   pgm->parseextparams = stk500v2_parseextparms;
@@ -4848,6 +5223,7 @@ void stk500hvsp_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = stk500hvsp_paged_write;
   pgm->paged_load = stk500hvsp_paged_load;
+  pgm->resync = stk500v2_resync;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_set_sck_period;
   pgm->parseextparams = stk500v2_parseextparms;
@@ -4884,7 +5260,10 @@ void stk500v2_jtagmkII_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->multipage_load = 1;
   pgm->page_erase = NULL;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_set_sck_period_mk2;
@@ -4915,7 +5294,10 @@ void stk500v2_dragon_isp_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->multipage_load = 1;
   pgm->page_erase = NULL;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_set_sck_period_mk2;
@@ -5002,7 +5384,11 @@ void stk600_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->resync = stk500v2_resync;
+  pgm->multipage_load = 1;
   pgm->page_erase = NULL;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_vtarget = stk600_set_vtarget;
@@ -5040,6 +5426,7 @@ void stk600pp_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = stk500pp_paged_write;
   pgm->paged_load = stk500pp_paged_load;
+  pgm->resync = stk500v2_resync;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_vtarget = stk600_set_vtarget;
   pgm->get_vtarget = stk500v2_get_vtarget;
@@ -5075,6 +5462,7 @@ void stk600hvsp_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = stk500hvsp_paged_write;
   pgm->paged_load = stk500hvsp_paged_load;
+  pgm->resync = stk500v2_resync;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_vtarget = stk600_set_vtarget;
   pgm->get_vtarget = stk500v2_get_vtarget;
@@ -5110,7 +5498,10 @@ void stk500v2_jtag3_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = stk500v2_paged_write;
+  pgm->multipage_write = 1;
   pgm->paged_load = stk500v2_paged_load;
+  pgm->paged_load_multi = stk500v2_paged_load_multi;
+  pgm->multipage_load = 1;
   pgm->page_erase = NULL;
   pgm->print_parms = stk500v2_print_parms;
   pgm->set_sck_period = stk500v2_jtag3_set_sck_period;
@@ -51,6 +51,7 @@ extern "C" {
   void stk500v2_teardown(PROGRAMMER *pgm);
   int stk500v2_drain(const PROGRAMMER *pgm, int display);
   int stk500v2_getsync(const PROGRAMMER *pgm);
+  int stk500v2_fastsync(const PROGRAMMER *pgm, int ms);
 
 #ifdef __cplusplus
 }
@@ -295,6 +295,19 @@ struct pdata {
   // Start address of Xmega boot area
   unsigned long boot_start;
 
+  // Largest ISP read block the tool accepts (0 = not yet known) and whether that is established
+  unsigned int max_read;
+  bool max_read_ok;
+
+  // Same for XPROG reads
+  unsigned int xprog_max_read;
+  bool xprog_max_read_ok;
+
+  // Reply times of serial commands by command byte for adaptive timeouts, see stk500v2_command()
+  Serial_rtt rtt[256], rtt_all; // ... and of all commands together
+  bool rto_active;              // Adaptive timeout in force: a timeout is retried, not an error
+  bool fixed_timeouts;          // -x fixedtimeouts
+
   /*
    * Chained pdata for the JTAG ICE mkII backend.  This is used when calling
    * the backend functions for ISP/HVSP/PP programming functionality of the
@@ -27,6 +27,11 @@
 #include <ctype.h>
 #include <math.h>
 
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#include <pthread.h>
+#define STR_THREADS 1
+#endif
+
 #include "avrdude.h"
 #include "libavrdude.h"
 
@@ -296,7 +301,7 @@ char *str_sprintf(const char *fmt, ...) {
 
 // Return a string in closed-circuit space with the sprintf() result
 const char *str_ccprintf(const char *fmt, ...) {
-  int size = 0, avail = sizeof cx->avr_space - AVR_SAFETY_MARGIN;
+  int size = 0, avail = AVR_CC_SPACE;
   va_list ap;
 
   // Compute size
@@ -324,7 +329,7 @@ const char *str_ccprintf(const char *fmt, ...) {
 
 // Returns a temporary, possibly abbreviated copy of str in closed-circuit space
 const char *str_ccstrdup(const char *str) {
-  size_t size = strlen(str) + 1, avail = sizeof cx->avr_space - AVR_SAFETY_MARGIN;
+  size_t size = strlen(str) + 1, avail = AVR_CC_SPACE;
 
   if(size > avail)
     size = avail;
@@ -1413,17 +1418,21 @@ static size_t qwertydist(size_t w, unsigned char c1, unsigned char c2) {
   return ret > w? w: ret > 0? ret: 1;
 }
 
-// Substitution cost considering qwerty keyboard typos and case
-static size_t csubs(size_t w, unsigned char c1, unsigned char c2) {
-  if(c1 >= 128 || c2 >= 128)
-    return c1 != c2? w: 0;
+static size_t wmat[128][128];   // Compute once, read-only cache
+
+#ifdef STR_THREADS
+static pthread_mutex_t wmat_mutex = PTHREAD_MUTEX_INITIALIZER; // Sessions may look up names concurrently
+#endif
 
+// Initialise the weight matrix of csubs() unless done before
+static void csubs_init(size_t w) {
   if(w < 8)
     w = 8;
 
-  static size_t wmat[128][128]; // Compute once, read-only cache
-
-  if(!wmat[0][1])               // Initialize weight matrix
+#ifdef STR_THREADS
+  pthread_mutex_lock(&wmat_mutex);
+#endif
+  if(!wmat[0][1])
     for(size_t k1 = 0; k1 < 128; k1++)
       for(size_t k2 = 0; k2 < 128; k2++)
         wmat[k1][k2] =
@@ -1431,6 +1440,15 @@ static size_t csubs(size_t w, unsigned char c1, unsigned char c2) {
           !isalnum(k1) && !isalnum(k2)? w/8:
           !isalnum(k1) || !isalnum(k2)? w:
           isalpha(k1) && isalpha(k2) && tolower(k1) == tolower(k2)? w/8: qwertydist(w, k1, k2);
+#ifdef STR_THREADS
+  pthread_mutex_unlock(&wmat_mutex);
+#endif
+}
+
+// Substitution cost considering qwerty keyboard typos and case
+static size_t csubs(size_t w, unsigned char c1, unsigned char c2) {
+  if(c1 >= 128 || c2 >= 128)
+    return c1 != c2? w: 0;
 
   return wmat[c1][c2];
 }
@@ -1445,6 +1463,7 @@ size_t str_weighted_damerau_levenshtein(const char *s1, const char *s2) {
   size_t *row2 = mmt_malloc((len2 + 1)*sizeof *row2);
   unsigned char *str1 = (unsigned char *) s1, *str2 = (unsigned char *) s2;
 
+  csubs_init(subst);
   for(j = 0; j < len2; j++)
     row1[j + 1] = row1[j] + wchr(add, str2[j]);
   for(i = 0; i < len1; i++) {
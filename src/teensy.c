@@ -76,6 +76,7 @@ struct pdata {
   uint8_t sig_bytes[3];
   // State
   bool erase_flash;
+  bool erased;                  // Flash was erased by a page 0 write in this session
   bool reboot;
 };
 
@@ -203,7 +204,11 @@ static int teensy_erase_flash(struct pdata *pdata) {
   pmsg_debug("teensy_erase_flash()\n");
 
   // Write a dummy page at address 0 to explicitly erase the flash.
-  return teensy_write_page(pdata, 0, NULL, 0, false);
+  int result = teensy_write_page(pdata, 0, NULL, 0, false);
+
+  if(result == 0)
+    pdata->erased = true;
+  return result;
 }
 
 static int teensy_reboot(struct pdata *pdata) {
@@ -448,11 +453,25 @@ static int teensy_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       pdata->erase_flash = false;
     }
 
+    // Once HalfKay has erased the flash, blank blocks need not be sent
+    if(pdata->erased && addr != 0) {
+      unsigned int i;
+
+      for(i = 0; i < n_bytes && mem->buf[addr + i] == 0xFF; i++)
+        continue;
+      if(i == n_bytes) {
+        pmsg_debug("skipping blank page at 0x%06X\n", addr);
+        return 0;
+      }
+    }
+
     int result = teensy_write_page(pdata, addr, mem->buf + addr, n_bytes, false);
 
     if(result < 0) {
       return result;
     }
+    if(addr == 0)               // Writing page 0 has erased the flash
+      pdata->erased = true;
     // Schedule a reboot.
     pdata->reboot = true;
 
@@ -67,6 +67,8 @@ static int cmd_save(const PROGRAMMER *pgm, const AVRPART *p, int argc, const cha
 static int cmd_backup(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
 static int cmd_restore(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
 static int cmd_verify(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
+static int cmd_blank(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
+static int cmd_bench(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
 static int cmd_flush(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
 static int cmd_abort(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
 static int cmd_erase(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]);
@@ -102,6 +104,8 @@ static const struct command cmd[] = {
   {"backup", cmd_backup, _fo(write_byte_cached), "backup memories to file"},
   {"restore", cmd_restore, _fo(write_byte_cached), "restore memories from file"},
   {"verify", cmd_verify, _fo(write_byte_cached), "compare memories with file"},
+  {"blank", cmd_blank, _fo(open), "check that a memory is erased"},
+  {"bench", cmd_bench, _fo(read_byte), "measure throughput and latency of memory accesses"},
   {"flush", cmd_flush, _fo(flush_cache), "synchronise flash and EEPROM cache with the device"},
   {"abort", cmd_abort, _fo(reset_cache), "abort flash and EEPROM writes, ie, reset the r/w cache"},
   {"erase", cmd_erase, _fo(chip_erase_cached), "perform a chip or memory erase"},
@@ -428,17 +432,22 @@ static unsigned char *readbuf(const PROGRAMMER *pgm, const AVRPART *p, int argc,
   }
 
   report_progress(0, 1, "Reading");
-  for(int j = 0; j < toread; j++) {
+  for(int j = 0, n; j < toread; j += n) { // Read in chunks that do not wrap around
     int addr = (whence + j)%maxsize;
-    int rc = pgm->read_byte_cached(pgm, p, mem, addr, &buf[j]);
 
-    if(rc != 0) {
+    n = toread - j;
+    if(n > maxsize - addr)
+      n = maxsize - addr;
+    if(n > 256)
+      n = 256;
+    if(avr_read_range_cached(pgm, p, mem, addr, n, buf + j) != 0) {
       report_progress(1, -1, NULL);
-      pmsg_error("(%s) error reading %s address 0x%05lx of part %s\n", cmd, mem->desc, (long) whence + j, p->desc);
+      pmsg_error("(%s) error reading %s address range [0x%05lx, 0x%05lx] of part %s\n", cmd, mem->desc,
+        (long) whence + j, (long) whence + j + n - 1, p->desc);
       mmt_free(buf);
       return NULL;
     }
-    report_progress(j, toread, NULL);
+    report_progress(j + n, toread, NULL);
   }
   report_progress(1, 1, NULL);
 
@@ -648,6 +657,111 @@ static size_t maxstrlen(int argc, const char **argv) {
   return max;
 }
 
+// Report a mismatch between written byte b and read back cell if it matters under the memory bitmask
+static void write_verify_error(const AVRPART *p, const AVRMEM *mem, int addr, uint8_t b, uint8_t cell) {
+  int bitmask = avr_mem_bitmask(p, mem, addr);
+
+  if((cell & bitmask) != (b & bitmask)) {
+    pmsg_error("(write) verification error writing 0x%02x at 0x%05x cell=0x%02x", b, addr, cell);
+    if(bitmask != 0xff)
+      msg_error(" using bit mask 0x%02x", bitmask);
+    msg_error("\n");
+  }
+}
+
+static void write_byte_verified(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int addr, uint8_t b) {
+  uint8_t cell;
+  int rc = pgm->write_byte_cached(pgm, p, mem, addr, b);
+
+  if(rc == LIBAVRDUDE_SOFTFAIL) {
+    pmsg_warning("(write) programmer write protects %s address 0x%04x\n", mem->desc, addr);
+  } else if(rc) {
+    pmsg_error("(write) error writing 0x%02x at 0x%05x (rc = %d)\n", b, addr, (int) rc);
+    // if(rc == -1)
+    //   imsg_error("write operation not supported on memory %s\n", mem->desc);
+  } else if(pgm->read_byte_cached(pgm, p, mem, addr, &cell) < 0) {
+    pmsg_error("(write) readback from %s failed\n", mem->desc);
+  } else {                      // Read back byte cell is now set
+    write_verify_error(p, mem, addr, b, cell);
+  }
+}
+
+// Write the bytes of buf that are tagged to mem from addr onwards and verify them
+static void write_tagged(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int addr,
+  const unsigned char *buf, const unsigned char *tags, int total) {
+
+  int paged = avr_has_paged_access(pgm, p, mem);
+  unsigned char *rb = paged? mmt_malloc(4096): NULL;
+
+  if(0 < total)
+    report_progress(0, 1, paged? "Caching": "Writing");
+  for(int i = 0; i < total;) {
+    report_progress(i, total, NULL);
+    if(!tags[i]) {
+      i++;
+      continue;
+    }
+    int n = 1;                  // Bulk write runs of tagged bytes, eg, from ... fill, into the cache
+
+    while(paged && n < 4096 && i + n < total && tags[i + n])
+      n++;
+    if(paged && avr_write_range_cached(pgm, p, mem, addr + i, n, buf + i) == 0 &&
+      avr_read_range_cached(pgm, p, mem, addr + i, n, rb) == 0) {
+      for(int j = 0; j < n; j++)
+        if(rb[j] != buf[i + j])
+          write_verify_error(p, mem, addr + i + j, buf[i + j], rb[j]);
+    } else {                    // Bytewise to pinpoint write protection and errors
+      for(int j = i; j < i + n; j++)
+        write_byte_verified(pgm, p, mem, addr + j, buf[j]);
+    }
+    i += n;
+  }
+  mmt_free(rb);
+  report_progress(1, 1, NULL);
+}
+
+/*
+ * Scripts (-T and include) stage the writes to a cached memory and only put
+ * them into the cache, merged into as few range writes as possible, before
+ * the next command other than write or at the end of the script
+ */
+static void write_commit(const PROGRAMMER *pgm, const AVRPART *p) {
+  const AVRMEM *mem = cx->term_bmem;
+
+  if(!mem)
+    return;
+  cx->term_bmem = NULL;
+  if(cx->term_blo <= cx->term_bhi)
+    write_tagged(pgm, p, mem, cx->term_blo, cx->term_bbuf + cx->term_blo, cx->term_btags + cx->term_blo,
+      cx->term_bhi - cx->term_blo + 1);
+  mmt_free(cx->term_bbuf);
+  mmt_free(cx->term_btags);
+  cx->term_bbuf = cx->term_btags = NULL;
+}
+
+static void write_stage(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int addr,
+  const unsigned char *buf, const unsigned char *tags, int total) {
+
+  if(cx->term_bmem != mem) {
+    write_commit(pgm, p);
+    cx->term_bmem = mem;
+    cx->term_bbuf = mmt_malloc(mem->size);
+    cx->term_btags = mmt_malloc(mem->size);
+    cx->term_blo = mem->size;
+    cx->term_bhi = -1;
+  }
+
+  for(int i = 0; i < total && addr + i < mem->size; i++)
+    if(tags[i]) {
+      cx->term_bbuf[addr + i] = buf[i];
+      cx->term_btags[addr + i] = 1;
+      if(addr + i < cx->term_blo)
+        cx->term_blo = addr + i;
+      if(addr + i > cx->term_bhi)
+        cx->term_bhi = addr + i;
+    }
+}
+
 typedef enum {
   WRITE_MODE_STANDARD = 0,
   WRITE_MODE_FILL = 1,
@@ -843,7 +957,7 @@ static int cmd_write(const PROGRAMMER *pgm, const AVRPART *p, int argc, const ch
       if(sd->size < end)
         end = sd->size;
       for(int j = 0; j < end; j++, n++) {
-        if(sd->mem->tags[j]) {
+        if(tag_isset(sd->mem->tags, j)) {
           buf[n] = sd->mem->buf[j];
           tags[n] = TAG_ALLOCATED;
         }
@@ -888,38 +1002,15 @@ static int cmd_write(const PROGRAMMER *pgm, const AVRPART *p, int argc, const ch
     msg_notice2("; remaining space filled with %s", argv[argc - 2]);
   msg_notice2("\n");
 
-  if(0 < len + bytes_grown)
-    report_progress(0, 1, avr_has_paged_access(pgm, p, mem)? "Caching": "Writing");
-  for(i = 0; i < len + bytes_grown; i++) {
-    report_progress(i, len + bytes_grown, NULL);
-    if(!tags[i])
-      continue;
+  int total = len + bytes_grown;
 
-    uint8_t b;
-    int rc = pgm->write_byte_cached(pgm, p, mem, addr + i, buf[i]);
-
-    if(rc == LIBAVRDUDE_SOFTFAIL) {
-      pmsg_warning("(write) programmer write protects %s address 0x%04x\n", mem->desc, addr + i);
-    } else if(rc) {
-      pmsg_error("(write) error writing 0x%02x at 0x%05x (rc = %d)\n", buf[i], addr + i, (int) rc);
-      // if(rc == -1)
-      //   imsg_error("write operation not supported on memory %s\n", mem->desc);
-    } else if(pgm->read_byte_cached(pgm, p, mem, addr + i, &b) < 0) {
-      pmsg_error("(write) readback from %s failed\n", mem->desc);
-    } else {                    // Read back byte b is now set
-      int bitmask = avr_mem_bitmask(p, mem, addr + i);
-
-      if((b & bitmask) != (buf[i] & bitmask)) {
-        pmsg_error("(write) verification error writing 0x%02x at 0x%05x cell=0x%02x", buf[i], addr + i, b);
-        if(bitmask != 0xff)
-          msg_error(" using bit mask 0x%02x", bitmask);
-        msg_error("\n");
-      }
-    }
-  }
-  report_progress(1, 1, NULL);
+  if(cx->term_batch && avr_has_paged_access(pgm, p, mem))
+    write_stage(pgm, p, mem, addr, buf, tags, total);
+  else
+    write_tagged(pgm, p, mem, addr, buf, tags, total);
 
   mmt_free(buf);
+  mmt_free(tags);
 
   return 0;
 }
@@ -997,17 +1088,18 @@ static int cmd_save(const PROGRAMMER *pgm, const AVRPART *p, int argc, const cha
   }
   // Read memory from device/cache
   report_progress(0, 1, "Reading");
-  for(int i = 0; i < n; i++) {
-    for(int j = seglist[i].addr; j < seglist[i].addr + seglist[i].len; j++) {
-      int rc = pgm->read_byte_cached(pgm, p, mem, j, mem->buf + j);
-
-      if(rc < 0) {
+  for(int i = 0, done = 0; i < n; i++) {
+    for(int j = seglist[i].addr, k; j < seglist[i].addr + seglist[i].len; j += k) {
+      k = seglist[i].addr + seglist[i].len - j;
+      if(k > 256)
+        k = 256;
+      if(avr_read_range_cached(pgm, p, mem, j, k, mem->buf + j) < 0) {
         report_progress(1, -1, NULL);
-        pmsg_error("(save) error reading %s address 0x%0*x of part %s\n",
-          mem->desc, j < 16? 1: j < 256? 2: j < 65536? 4: 5, j, p->desc);
+        pmsg_error("(save) error reading %s address range [0x%0*x, 0x%0*x] of part %s\n", mem->desc,
+          j < 16? 1: j < 256? 2: j < 65536? 4: 5, j, j < 16? 1: j < 256? 2: j < 65536? 4: 5, j + k - 1, p->desc);
         return -1;
       }
-      report_progress(j, nbytes, NULL);
+      report_progress(done += k, nbytes, NULL);
     }
   }
   report_progress(1, 1, NULL);
@@ -1147,6 +1239,227 @@ static int cmd_verify(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
   return ret <= 0? ret: 0;
 }
 
+static int cmd_blank(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]) {
+  if(argc > 3 || (argc > 1 && str_eq(argv[1], "-?"))) {
+    msg_error("Syntax: blank [<mem> [<len>]]\n"
+      "Function: check that a memory is erased\n"
+      "Notes:\n"
+      "  - <mem> defaults to flash and <len> to the whole memory\n"
+      "  - Blank check flushes the cache before checking the device\n"
+      "  - Programmers that can compare memory on the device do so without read-back\n");
+    return -1;
+  }
+
+  const char *memstr = argc > 1? argv[1]: "flash";
+  const AVRMEM *mem = avr_locate_mem(p, memstr);
+  const char *errptr;
+  int len = -1, first;
+
+  if(!mem) {
+    pmsg_error("(blank) memory %s not defined for part %s\n", memstr, p->desc);
+    return -1;
+  }
+  if(argc > 2) {
+    len = str_int(argv[2], STR_INT32, &errptr);
+    if(errptr || len < 0 || len > mem->size) {
+      pmsg_error("(blank) length %s %s\n", argv[2], errptr? errptr: "out of range");
+      return -1;
+    }
+  }
+
+  pgm->flush_cache(pgm, p);     // Flush cache before any device memory access
+  int rc = avr_blank_check(pgm, p, mem, len, &first);
+
+  if(rc < 0) {
+    pmsg_error("(blank) unable to check %s\n", avr_mem_name(p, mem));
+    return -1;
+  }
+  if(!rc) {
+    pmsg_error("(blank) %s is not blank: first non-0xff byte at 0x%04x\n", avr_mem_name(p, mem), first);
+    return -1;
+  }
+  term_out("%s is blank\n", avr_mem_name(p, mem));
+
+  return 0;
+}
+
+// Benchmark command
+
+#define BENCH_PAGED_MAX 4096    // Bytes read per memory in the paged read test
+#define BENCH_BYTES_MAX 64      // Bytes read or written in the byte-wise tests
+
+// Print n bytes done in us microseconds with k transactions
+static void bench_report(const char *what, int n, int k, uint64_t us) {
+  double ms = us/1000.0;
+
+  term_out("  %-14s %6d byte%s in %8.1f ms: %8.2f kB/s, %7.3f ms per %s\n", what, n, str_plural(n), ms,
+    us? n*1000.0/us: 0.0, k? ms/k: 0.0, k == n? "byte": "transaction");
+}
+
+// Read throughput and latency of paged and byte-wise access to mem
+static int bench_read(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem) {
+  unsigned char *buf = mmt_malloc(mem->size > BENCH_PAGED_MAX? BENCH_PAGED_MAX: mem->size);
+  uint64_t start;
+  int n, k, rc = 0;
+
+  term_out("%s (%d bytes, page size %d)\n", avr_mem_name(p, mem), mem->size, mem->page_size);
+  if(avr_has_paged_access(pgm, p, mem)) {
+    n = mem->size > BENCH_PAGED_MAX? BENCH_PAGED_MAX/mem->page_size*mem->page_size: mem->size;
+    start = avr_ustimestamp();
+    for(k = 0; rc >= 0 && k*mem->page_size < n; k++)
+      rc = avr_read_page_default(pgm, p, mem, k*mem->page_size, buf + k*mem->page_size);
+    if(rc < 0) {
+      pmsg_error("(bench) unable to read %s page at 0x%04x\n", mem->desc, (k - 1)*mem->page_size);
+      goto done;
+    }
+    bench_report("paged read", n, k, avr_ustimestamp() - start);
+  }
+
+  n = mem->size > BENCH_BYTES_MAX? BENCH_BYTES_MAX: mem->size;
+  start = avr_ustimestamp();
+  for(k = 0; rc >= 0 && k < n; k++)
+    rc = pgm->read_byte(pgm, p, mem, k, buf + k);
+  if(rc < 0) {
+    pmsg_error("(bench) unable to read %s byte at 0x%04x\n", mem->desc, k - 1);
+    goto done;
+  }
+  bench_report("byte read", n, n, avr_ustimestamp() - start);
+
+done:
+  mmt_free(buf);
+  return rc < 0? -1: 0;
+}
+
+/*
+ * Write throughput of the scratch area [addr, addr+len) of mem: the area is
+ * overwritten with its complement through the cache, flushed, and then
+ * restored to its original contents, which is flushed again
+ */
+static int bench_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int addr, int len) {
+  unsigned char *orig = mmt_malloc(len), *pat = mmt_malloc(len);
+  int pg = mem->page_size > 0? mem->page_size: 1, rc = -1;
+  int npages = (addr + len - 1)/pg - addr/pg + 1;
+  uint64_t start;
+
+  term_out("%s scratch area [0x%04x, 0x%04x]\n", avr_mem_name(p, mem), addr, addr + len - 1);
+  if(avr_read_range_cached(pgm, p, mem, addr, len, orig) < 0) {
+    pmsg_error("(bench) unable to read %s scratch area\n", mem->desc);
+    goto done;
+  }
+  for(int i = 0; i < len; i++)
+    pat[i] = ~orig[i];
+
+  start = avr_ustimestamp();
+  if(avr_write_range_cached(pgm, p, mem, addr, len, pat) < 0) {
+    pmsg_error("(bench) unable to write %s scratch area to cache\n", mem->desc);
+    goto done;
+  }
+  bench_report("cache write", len, len, avr_ustimestamp() - start);
+
+  start = avr_ustimestamp();
+  if(pgm->flush_cache(pgm, p) < 0) {
+    pmsg_error("(bench) unable to flush cache; %s scratch area may have changed\n", mem->desc);
+    goto done;
+  }
+  bench_report("cache flush", len, npages, avr_ustimestamp() - start);
+
+  start = avr_ustimestamp();
+  if(avr_write_range_cached(pgm, p, mem, addr, len, orig) < 0 || pgm->flush_cache(pgm, p) < 0) {
+    pmsg_error("(bench) unable to restore %s scratch area\n", mem->desc);
+    goto done;
+  }
+  bench_report("restore", len, npages, avr_ustimestamp() - start);
+  rc = 0;
+
+  if(mem_is_eeprom(mem)) {      // Rewrite the original contents byte by byte
+    int n = len > BENCH_BYTES_MAX? BENCH_BYTES_MAX: len, k;
+
+    start = avr_ustimestamp();
+    for(k = 0; rc >= 0 && k < n; k++)
+      rc = pgm->write_byte(pgm, p, mem, addr + k, orig[k]);
+    if(rc < 0)
+      pmsg_error("(bench) unable to write %s byte at 0x%04x\n", mem->desc, addr + k - 1);
+    else
+      bench_report("byte write", n, n, avr_ustimestamp() - start);
+    pgm->reset_cache(pgm, p);
+  }
+
+done:
+  mmt_free(orig);
+  mmt_free(pat);
+  return rc < 0? -1: 0;
+}
+
+static int cmd_bench(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]) {
+  int wr = argc > 1 && str_eq(argv[1], "-w");
+
+  if((wr && argc != 5) || (argc > 1 && str_eq(argv[1], "-?"))) {
+    msg_error("Syntax: bench [<mem> ...]\n"
+      "        bench -w <mem> <addr> <len>\n"
+      "Function: measure throughput and latency of memory accesses\n"
+      "Notes:\n"
+      "  - Without -w only reads: paged reads of up to %d bytes and byte-wise reads of up\n"
+      "    to %d bytes for each <mem>, by default flash and EEPROM\n"
+      "  - With -w the scratch area [<addr>, <addr>+<len>) of <mem> is overwritten through\n"
+      "    the cache and restored, measuring the cost of cache write, flush and restore;\n"
+      "    for EEPROM also the byte-wise write rate\n"
+      "  - Bench flushes the cache before measuring\n"
+      "  - Run non-interactively with -T bench\n", BENCH_PAGED_MAX, BENCH_BYTES_MAX);
+    return -1;
+  }
+
+  if(pgm->flush_cache(pgm, p) < 0)      // Do not let pending writes distort measurements
+    return -1;
+
+  if(wr) {
+    const AVRMEM *mem = avr_locate_mem(p, argv[2]);
+    const char *errptr;
+    int addr, len;
+
+    if(!mem) {
+      pmsg_error("(bench) memory %s not defined for part %s\n", argv[2], p->desc);
+      return -1;
+    }
+    addr = str_int(argv[3], STR_INT32, &errptr);
+    if(errptr || addr < 0 || addr >= mem->size) {
+      pmsg_error("(bench) address %s %s\n", argv[3], errptr? errptr: "out of range");
+      return -1;
+    }
+    len = str_int(argv[4], STR_INT32, &errptr);
+    if(errptr || len < 1 || len > mem->size - addr) {
+      pmsg_error("(bench) length %s %s\n", argv[4], errptr? errptr: "out of range");
+      return -1;
+    }
+    if(!avr_has_paged_access(pgm, p, mem)) {
+      pmsg_error("(bench) %s memory is not cached, so cannot be write-benchmarked\n", mem->desc);
+      return -1;
+    }
+    return bench_read(pgm, p, mem) < 0 || bench_write(pgm, p, mem, addr, len) < 0? -1: 0;
+  }
+
+  const char *dflt[] = { "flash", "eeprom" };
+  const char **mems = argc > 1? argv + 1: dflt;
+  int nmems = argc > 1? argc - 1: 2, ret = 0;
+
+  for(int i = 0; i < nmems; i++) {
+    const AVRMEM *mem = avr_locate_mem(p, mems[i]);
+
+    if(!mem) {
+      if(argc > 1) {
+        pmsg_error("(bench) memory %s not defined for part %s\n", mems[i], p->desc);
+        ret = -1;
+      }
+      continue;
+    }
+    if(mem->size < 1)
+      continue;
+    if(bench_read(pgm, p, mem) < 0)
+      ret = -1;
+  }
+
+  return ret;
+}
+
 static int cmd_flush(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]) {
   if(argc > 1) {
     msg_error("Syntax: flush\n" "Function: synchronise flash and EEPROM cache with the device\n");
@@ -1313,10 +1626,13 @@ static int cmd_erase(const PROGRAMMER *pgm, const AVRPART *p, int argc, const ch
     }
 
     msg_info("[0x%04x, 0x%04x]; undo with abort\n", beg, end);
-    for(int addr = beg; addr <= end; addr++)
-      if(!pgm->readonly || !pgm->readonly(pgm, p, flm, addr))
-        if(pgm->write_byte_cached(pgm, p, flm, addr, 0xff) == -1)
-          return -1;
+    unsigned char *ff = mmt_malloc(end - beg + 1);
+
+    memset(ff, 0xff, end - beg + 1);    // Write protected bytes are skipped (soft fail)
+    rc = avr_write_range_cached(pgm, p, flm, beg, end - beg + 1, ff);
+    mmt_free(ff);
+    if(rc == -1)
+      return -1;
     return 0;
   }
 
@@ -1462,6 +1778,32 @@ back:
   return err? -1: 0;
 }
 
+/*
+ * Successive config commands share a snapshot of the fuses and lock bits, so
+ * they are read only once; the snapshot is forgotten when any other command
+ * runs, as that might change the fuses, and at the end of terminal sessions
+ */
+static void config_forget(void) {
+  mmt_free(cx->term_fusel);
+  cx->term_fusel = NULL;
+  cx->term_fusel_part = NULL;
+}
+
+static Part_FL *config_snapshot(const PROGRAMMER *pgm, const AVRPART *p, const Cnfg *cc, int nc) {
+  if(cx->term_fusel && cx->term_fusel_part == p)
+    return cx->term_fusel;
+
+  config_forget();
+  Part_FL *fl = cx->term_fusel = mmt_malloc(sizeof *fl);
+
+  cx->term_fusel_part = p;
+  for(int i = 0; i < nc; i++)   // Read all involved fuses and lock bits in one go
+    if(cc[i].ok)
+      getfusel(pgm, p, fl, cc + i, NULL);
+
+  return fl;
+}
+
 static int setmatches(const char *str, int n, Cnfg *cc) {
   int matches = 0;
 
@@ -1763,15 +2105,13 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
   int idx = -1;                 // Index in uP_table[]
   const Configitem *ct;         // Configuration bitfield table
   int nc;                       // Number of config properties, some may not be available
-  Part_FL fusel;                // Copy of fuses and lock bits
+  Part_FL *fuselp;              // Copy of fuses and lock bits
   const Configvalue *vt;        // Pointer to symbolic labels and associated values
   int nv;                       // Number of symbolic labels
   Cnfg *cc;                     // Current configuration; cc[] and ct[] are parallel arrays
   FL_item *fc;                  // Current fuse and lock bits memories
   int nf = 0;                   // Number of involved fuse and lock bits memories
 
-  memset(&fusel, 0, sizeof fusel);
-
   if(p->mcuid >= 0)
     idx = upidxmcuid(p->mcuid);
   if(idx < 0 && p->desc && *p->desc)
@@ -1821,6 +2161,7 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
     fc[nf - 1].mask |= ct[i].mask;
   }
 
+  fuselp = config_snapshot(pgm, p, cc, nc);
   const char *item = argc < 2? "*": argv[1];
 
   char *rhs = strchr(item, '=');
@@ -1845,7 +2186,7 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
     for(int printed = 0, i = 0; i < nc; i++) {
       if(!cc[i].match || !cc[i].ok)
         continue;
-      if(gatherval(pgm, p, cc, i, &fusel, fc, nf) < 0) {
+      if(gatherval(pgm, p, cc, i, fuselp, fc, nf) < 0) {
         for(int ii = i + 1; ii < nc; ii++)
           if(str_eq(cc[i].memstr, cc[ii].memstr))
             cc[ii].ok = 0;
@@ -1960,7 +2301,7 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
   // Reload current value of fuse that the property lives on
   const char *errstr = NULL;
 
-  getfusel(pgm, p, &fusel, cc + ci, &errstr);
+  getfusel(pgm, p, fuselp, cc + ci, &errstr);
   if(errstr) {
     if(!str_contains(errstr, "cannot read "))
       pmsg_error("(config) cannot handle %s in %s: %s\n", cc[ci].t->name, cc[ci].memstr, errstr);
@@ -1970,7 +2311,7 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
 
   Intbytes towrite;
 
-  towrite.i = (fusel.current & ~ct[ci].mask) | (toassign << ct[ci].lsh);
+  towrite.i = (fuselp->current & ~ct[ci].mask) | (toassign << ct[ci].lsh);
   const AVRMEM *mem = avr_locate_mem(p, cc[ci].memstr);
 
   if(!mem) {
@@ -1979,15 +2320,19 @@ static int cmd_config(const PROGRAMMER *pgm, const AVRPART *p, int argc, const c
     goto finished;
   }
 
-  if((fusel.islock && mem->size != 4 && mem->size != 1) || (!fusel.islock && mem->size != 2 && mem->size != 1)) {
+  if((fuselp->islock && mem->size != 4 && mem->size != 1) || (!fuselp->islock && mem->size != 2 && mem->size != 1)) {
     pmsg_error("(config) %s's %s memory has unexpected size %d\n", p->desc, mem->desc, mem->size);
     ret = -1;
     goto finished;
   }
 
   int confirm = 0;
-  if(towrite.i != fusel.current) {
+  if(towrite.i != fuselp->current) {
     confirm = o.confirm;
+    if(fuselp->islock)          // Force re-read of the written memory
+      fuselp->lread = 0;
+    else
+      fuselp->fread[cc[ci].t->memoffset] = 0;
     for(int i = 0; i < mem->size; i++)
       if(led_write_byte(pgm, p, mem, i, towrite.b[i]) < 0) {
         pmsg_error("(config) cannot write to %s's %s memory\n", p->desc, mem->desc);
@@ -2775,8 +3120,13 @@ static int do_cmd(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char
         }
       }
 
-  if(matches == 1)
+  if(matches == 1) {
+    if(cmd[hold].func != cmd_write)     // Staged writes go first
+      write_commit(pgm, p);
+    if(cmd[hold].func != cmd_config)
+      config_forget();
     return cmd[hold].func(pgm, p, argc, argv);
+  }
 
   pmsg_error("(cmd) command %s is %s", argv[0], matches > 1? "ambiguous": "invalid");
   if(matches > 1)
@@ -2876,8 +3226,14 @@ static int process_line(char *q, const PROGRAMMER *pgm, const AVRPART *p) {
 
 int terminal_line(const PROGRAMMER *pgm, const AVRPART *p, const char *line) {
   char *ln = mmt_strdup(line);
+  int batch = cx->term_batch;
+
+  cx->term_batch = 1;           // Stage writes and commit them at the end
   int ret = process_line(ln, pgm, p);
 
+  if(!(cx->term_batch = batch))
+    write_commit(pgm, p);
+  config_forget();
   mmt_free(ln);
 
   return ret;
@@ -3002,6 +3358,7 @@ int terminal_mode_noninteractive(const PROGRAMMER *pgm, const AVRPART *p) {
 
 // Terminal shell that is called on avrdude -t
 int terminal_mode(const PROGRAMMER *pgm, const AVRPART *p) {
+  int rc;
 
 #if defined(HAVE_LIBREADLINE)
   /*
@@ -3010,10 +3367,13 @@ int terminal_mode(const PROGRAMMER *pgm, const AVRPART *p) {
    * uses version 4.2 (0x0402).
    */
   if(isatty(fileno(stdin)) || rl_readline_version > 0x0500)
-    return terminal_mode_interactive(pgm, p);
+    rc = terminal_mode_interactive(pgm, p);
+  else
 #endif
+    rc = terminal_mode_noninteractive(pgm, p);
 
-  return terminal_mode_noninteractive(pgm, p);
+  config_forget();              // Fuses may change before the next session
+  return rc;
 }
 
 static int cmd_include(const PROGRAMMER *pgm, const AVRPART *p, int argc, const char *argv[]) {
@@ -3061,6 +3421,9 @@ static int cmd_include(const PROGRAMMER *pgm, const AVRPART *p, int argc, const
     return -1;
   }
 
+  int batch = cx->term_batch;
+
+  cx->term_batch = 1;           // Stage writes of the whole file
   for(char *buffer; (buffer = str_fgets(fp, &errstr)); mmt_free(buffer)) {
     lineno++;
     if(echo) {
@@ -3074,6 +3437,8 @@ static int cmd_include(const PROGRAMMER *pgm, const AVRPART *p, int argc, const
       rc = -1;
     lterm_out("");
   }
+  if(!(cx->term_batch = batch))
+    write_commit(pgm, p);
   if(errstr) {
     pmsg_error("(include) read error in file %s: %s\n", argv[1], errstr);
     return -1;
@@ -0,0 +1,231 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cache of target identification results
+ *
+ * Identifying the target can take a good deal longer than programming a
+ * small sketch: -B auto searches for the fastest working bit clock, and
+ * urclock probes the flash of bootloaders that do not describe themselves
+ * and hashes up to 4 kB of top flash to recognise known ones. A production
+ * fixture normally connects the same board type through the same
+ * programmer many times over, so these results are remembered per target,
+ * ie, per programmer, its USB serial number (or the port) and the part.
+ *
+ * Like the configuration cache (see confcache.c) the target cache is opt-in
+ * and only used if the user has created the directory $XDG_CACHE_HOME/avrdude
+ * or ~/.cache/avrdude. The file targets in there has one text line
+ * <target> <field> <value> per entry, the most recently used ones last.
+ * Users of the cache must revalidate cached entries cheaply (eg, by checking
+ * the signature or the top flash bytes) before relying on them, as a
+ * different board might have been connected since.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+#include "config.h"
+
+#define TGTCACHE_MAXLINES 1000  // Older entries are dropped when the cache is saved
+
+#define tc_lines  (cx->tgt_lines)
+#define tc_nlines (cx->tgt_nlines)
+
+// Name of the target cache file if the user has created a cache directory, NULL otherwise
+static char *tgtcache_filename(void) {
+  char *dir = cfg_cache_dir(), *ret;
+
+  if(!dir)
+    return NULL;
+  ret = mmt_sprintf("%s/targets", dir);
+  mmt_free(dir);
+
+  return ret;
+}
+
+static void tgtcache_load(void) {
+  char *fname = tgtcache_filename(), *line;
+  FILE *f;
+
+  cx->tgt_loaded = 1;
+  if(!fname)
+    return;
+  cx->tgt_enabled = 1;
+  if((f = fopen(fname, "r"))) {
+    while((line = str_fgets(f, NULL))) {
+      size_t n = strlen(line);
+
+      while(n && isspace((unsigned char) line[n-1]))
+        line[--n] = 0;
+      if(n && tc_nlines < 2*TGTCACHE_MAXLINES) {
+        tc_lines = mmt_realloc(tc_lines, (tc_nlines+1)*sizeof *tc_lines);
+        tc_lines[tc_nlines++] = line;
+      } else
+        mmt_free(line);
+    }
+    fclose(f);
+  }
+  mmt_free(fname);
+}
+
+// Index of the entry for field of the current target or -1 if there is none
+static int tgtcache_find(const char *field) {
+  if(!cx->tgt_id)
+    return -1;
+
+  size_t nid = strlen(cx->tgt_id), nfield = strlen(field);
+
+  for(int i = tc_nlines-1; i >= 0; i--) {
+    const char *l = tc_lines[i];
+
+    if(str_starts(l, cx->tgt_id) && l[nid] == ' ' && !strncmp(l+nid+1, field, nfield) &&
+      l[nid+1+nfield] == ' ')
+      return i;
+  }
+
+  return -1;
+}
+
+/*
+ * Set the target for subsequent tgtcache_get() and tgtcache_put() calls;
+ * the target is identified by the programmer, its USB serial number or,
+ * failing that, the port, and the part
+ */
+void tgtcache_target(const PROGRAMMER *pgm, const AVRPART *p, const char *port) {
+  if(!cx->tgt_loaded)
+    tgtcache_load();
+  mmt_free(cx->tgt_id);
+  cx->tgt_id = NULL;
+  if(!cx->tgt_enabled || !pgm || !p)
+    return;
+
+  const char *sn = pgm->usbsn && *pgm->usbsn? pgm->usbsn: port && *port? port: "-";
+  const char *pid = pgm->id && lsize(pgm->id)? (const char *) ldata(lfirst(pgm->id)): "-";
+
+  cx->tgt_id = mmt_sprintf("%s/%s/%s", pid, sn, p->id);
+  for(char *s = cx->tgt_id; *s; s++)
+    if(isspace((unsigned char) *s))
+      *s = '_';
+}
+
+// Cached value of field for the current target or NULL if not known
+const char *tgtcache_get(const char *field) {
+  int i = tgtcache_find(field);
+
+  return i < 0? NULL: tc_lines[i] + strlen(cx->tgt_id) + 1 + strlen(field) + 1;
+}
+
+// Remember value of field for the current target
+void tgtcache_put(const char *field, const char *value) {
+  if(!cx->tgt_id || !field || !value)
+    return;
+
+  int i = tgtcache_find(field);
+  char *line = mmt_sprintf("%s %s %s", cx->tgt_id, field, value);
+
+  for(char *s = line; *s; s++)  // Keep the entry on one line
+    if(*s == '\n' || *s == '\r')
+      *s = ' ';
+  if(i >= 0) {
+    if(str_eq(tc_lines[i], line)) {
+      mmt_free(line);
+      return;
+    }
+    mmt_free(tc_lines[i]);
+    memmove(tc_lines+i, tc_lines+i+1, (tc_nlines-i-1)*sizeof *tc_lines);
+    tc_nlines--;
+  } else
+    tc_lines = mmt_realloc(tc_lines, (tc_nlines+1)*sizeof *tc_lines);
+  tc_lines[tc_nlines++] = line; // Most recently used entries last
+  cx->tgt_dirty = 1;
+}
+
+/*
+ * Bauds that autobaud modes of bootloader programmers try in this order:
+ * the last winner for the current target first, then the usual rates from
+ * fastest to slowest; max > 0 skips faster ones. Returns the number of
+ * bauds put into bauds[], which must have room for TGTCACHE_NBAUDS entries.
+ */
+int tgtcache_bauds(long max, long *bauds) {
+  static const long rates[] = {
+    2000000, 1000000, 500000, 460800, 250000, 230400, 115200, 57600, 38400, 19200, 9600,
+  };
+  const char *val = tgtcache_get("baud");
+  const char *errptr;
+  int n = 0;
+  long cached = val? str_int(val, STR_INT32, &errptr): 0;
+
+  if(val && !errptr && cached > 0 && (max <= 0 || cached <= max))
+    bauds[n++] = cached;
+  else
+    cached = 0;
+  for(size_t i = 0; i < sizeof rates/sizeof *rates && n < TGTCACHE_NBAUDS; i++)
+    if(rates[i] != cached && (max <= 0 || rates[i] <= max))
+      bauds[n++] = rates[i];
+
+  return n;
+}
+
+// Write changed entries back to the cache file and free the cache; returns -1 on error
+int tgtcache_save(void) {
+  int rc = 0;
+
+  if(cx->tgt_dirty) {
+    char *fname = tgtcache_filename(), *tmp;
+    FILE *f;
+
+    if(fname) {
+      tmp = mmt_sprintf("%s.%ld", fname, (long) getpid());
+      if((f = fopen(tmp, "w"))) {
+        for(int i = tc_nlines > TGTCACHE_MAXLINES? tc_nlines - TGTCACHE_MAXLINES: 0; i < tc_nlines; i++)
+          fprintf(f, "%s\n", tc_lines[i]);
+        if(fclose(f) == EOF || rename(tmp, fname) < 0) {
+          pmsg_warning("cannot update target cache %s: %s\n", fname, strerror(errno));
+          unlink(tmp);
+          rc = -1;
+        }
+      } else {
+        pmsg_warning("cannot create target cache %s: %s\n", tmp, strerror(errno));
+        rc = -1;
+      }
+      mmt_free(tmp);
+      mmt_free(fname);
+    }
+    cx->tgt_dirty = 0;
+  }
+
+  for(int i = 0; i < tc_nlines; i++)
+    mmt_free(tc_lines[i]);
+  mmt_free(tc_lines);
+  tc_lines = NULL;
+  tc_nlines = 0;
+  mmt_free(cx->tgt_id);
+  cx->tgt_id = NULL;
+  cx->tgt_loaded = 0;
+  cx->tgt_enabled = 0;
+
+  return rc;
+}
@@ -50,6 +50,9 @@ static const unsigned char tpi_skey[] = {
 #define TPI_CMD_SSTPR      0x68
 #define TPI_CMD_SKEY       0xE0
 
+// Max number of frames handed to pgm->cmd_tpi_batch() at once
+#define TPI_BATCH_MAX      256
+
 // For TPI_CMD_SIN & TPI_CMD_SOUT
 #define TPI_SIO_ADDR(x) ((x & 0x30) << 1 | (x & 0x0F))
 
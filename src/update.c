@@ -23,6 +23,7 @@
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -30,6 +31,11 @@
 
 #include <ac_cfg.h>
 
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+#define UPD_THREADS 1
+#include <pthread.h>
+#endif
+
 #include "avrdude.h"
 #include "libavrdude.h"
 
@@ -98,6 +104,7 @@ UPDATE *dup_update(const UPDATE *upd) {
   memcpy(u, upd, sizeof *u);
   u->memstr = upd->memstr? mmt_strdup(upd->memstr): NULL;
   u->filename = mmt_strdup(upd->filename);
+  u->patch = upd->patch? mmt_strdup(upd->patch): NULL;
 
   return u;
 }
@@ -125,6 +132,7 @@ void free_update(UPDATE *u) {
   if(u) {
     mmt_free(u->memstr);
     mmt_free(u->filename);
+    mmt_free(u->patch);
     memset(u, 0, sizeof *u);
     mmt_free(u);
   }
@@ -133,9 +141,9 @@ void free_update(UPDATE *u) {
 char *update_str(const UPDATE *upd) {
   if(upd->cmdline)
     return mmt_sprintf("-%c %s", str_eq("interactive terminal", upd->cmdline)? 't': 'T', upd->cmdline);
-  return mmt_sprintf("-U %s:%c:%s:%c", upd->memstr,
+  return mmt_sprintf("-U %s:%c:%s:%c%s%s", upd->memstr,
     upd->op == DEVICE_READ? 'r': upd->op == DEVICE_WRITE? 'w': 'v',
-    upd->filename, fileio_fmtchr(upd->format));
+    upd->filename, fileio_fmtchr(upd->format), upd->patch? " patched with ": "", upd->patch? upd->patch: "");
 }
 
 // Memory statistics considering holes after a file read returned size bytes
@@ -150,34 +158,63 @@ int memstats(const AVRPART *p, const char *memstr, int size, Filestats *fsp) {
   return memstats_mem(p, mem, size, fsp);
 }
 
-int memstats_mem(const AVRPART *p, const AVRMEM *mem, int size, Filestats *fsp) {
-  Filestats ret = { 0 };
-
-  if(!mem->buf || !mem->tags) {
-    pmsg_error("%s %s is not set\n", p->desc, mem->desc);
-    return LIBAVRDUDE_GENERAL_FAILURE;
-  }
-
-  int pgsize = mem->page_size;
-
-  if(pgsize < 1)
-    pgsize = 1;
+#define UPD_PAR_MIN (1 << 20)   // Memory statistics of larger memories are computed in parallel ...
+#define UPD_PAR_MAX 8           // ... by up to this many threads
 
-  if(size < 0 || size > mem->size) {
-    pmsg_error("size %d at odds with %s %s size %d\n", size, p->desc, mem->desc, mem->size);
-    return LIBAVRDUDE_GENERAL_FAILURE;
-  }
+/*
+ * Statistics of the pages in [from, to) of mem as in memstats_mem(); from
+ * must be a multiple of the page size. Sections are counted as if the chunk
+ * was preceded by a hole.
+ */
+static void memstats_chunk(const AVRMEM *mem, int size, int pgsize, int from, int to, Filestats *fsp) {
+  Filestats ret = { 0 };
 
   ret.lastaddr = -1;
   int firstset = 0, insection = 0;
 
-  // Scan all memory
-  for(int addr = 0; addr < mem->size;) {
+  for(int addr = from; addr < to;) {
     int pageset = 0;
 
     // Go page by page
     for(int pgi = 0; pgi < pgsize; pgi++, addr++) {
-      if(mem->tags[addr] & TAG_ALLOCATED) {
+      // Take tag bytes that are all unallocated or all allocated in one go
+      if(addr%8 == 0 && pgi + 8 <= pgsize && addr + 8 <= mem->size) {
+        unsigned char t = mem->tags[addr/8];
+
+        if(t == 0) {
+          insection = 0;
+          if(pageset)
+            ret.nfill += 8;
+          pgi += 7, addr += 7;
+          continue;
+        }
+        if(t == 0xff && (addr + 8 <= size || addr >= size)) {
+          if(!firstset) {
+            firstset = 1;
+            ret.firstaddr = addr;
+          }
+          ret.lastaddr = addr + 7;
+          if(addr < size) {
+            ret.nbytes += 8;
+            if(!pageset) {
+              pageset = 1;
+              ret.nfill += pgi;
+              ret.npages++;
+            }
+            if(!insection) {
+              insection = 1;
+              ret.nsections++;
+            }
+          } else {
+            ret.ntrailing += 8;
+            if(pageset)
+              ret.nfill += 8;
+          }
+          pgi += 7, addr += 7;
+          continue;
+        }
+      }
+      if(tag_isset(mem->tags, addr)) {
         if(!firstset) {
           firstset = 1;
           ret.firstaddr = addr;
@@ -208,6 +245,96 @@ int memstats_mem(const AVRPART *p, const AVRMEM *mem, int size, Filestats *fsp)
     }
   }
 
+  *fsp = ret;
+}
+
+#ifdef UPD_THREADS
+typedef struct {
+  const AVRMEM *mem;
+  int size, pgsize, from, to;
+  Filestats fs;
+  pthread_t tid;
+  int running;
+} Memstats_job;
+
+static void *memstats_worker(void *arg) {
+  Memstats_job *job = arg;
+
+  memstats_chunk(job->mem, job->size, job->pgsize, job->from, job->to, &job->fs);
+  return NULL;
+}
+#endif
+
+/*
+ * Statistics of the first size bytes of mem, eg, after a file read returned
+ * size bytes: the number of bytes, pages, sections, pad bytes and trailing
+ * 0xff bytes that were cut off, and the first and last address with data.
+ * Large memories, in particular the multi-memory address space of combined
+ * inputs, are split into page-aligned chunks that are scanned in parallel
+ * when threads are available; the chunk statistics are then merged.
+ */
+int memstats_mem(const AVRPART *p, const AVRMEM *mem, int size, Filestats *fsp) {
+  Filestats ret = { 0 };
+
+  if(!mem->buf || !mem->tags) {
+    pmsg_error("%s %s is not set\n", p->desc, mem->desc);
+    return LIBAVRDUDE_GENERAL_FAILURE;
+  }
+
+  int pgsize = mem->page_size;
+
+  if(pgsize < 1)
+    pgsize = 1;
+
+  if(size < 0 || size > mem->size) {
+    pmsg_error("size %d at odds with %s %s size %d\n", size, p->desc, mem->desc, mem->size);
+    return LIBAVRDUDE_GENERAL_FAILURE;
+  }
+
+#ifdef UPD_THREADS
+  long ncpu = mem->size < UPD_PAR_MIN? 1: sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(ncpu > 1) {
+    Memstats_job jobs[UPD_PAR_MAX];
+    int njobs = ncpu < UPD_PAR_MAX? ncpu: UPD_PAR_MAX, align = 8*pgsize;
+    int chunk = (mem->size/njobs + align - 1)/align*align;
+
+    njobs = 0;
+    for(int from = 0; from < mem->size; from += chunk, njobs++) {
+      Memstats_job *job = jobs + njobs;
+
+      job->mem = mem, job->size = size, job->pgsize = pgsize;
+      job->from = from, job->to = mem->size - from > chunk? from + chunk: mem->size;
+      // First chunk is scanned by this thread, as are all that did not get one
+      job->running = njobs && !pthread_create(&job->tid, NULL, memstats_worker, job);
+    }
+
+    ret.lastaddr = -1;
+    for(int i = 0; i < njobs; i++) {
+      Memstats_job *job = jobs + i;
+
+      if(job->running)
+        pthread_join(job->tid, NULL);
+      else
+        memstats_chunk(mem, size, pgsize, job->from, job->to, &job->fs);
+      if(job->fs.lastaddr >= 0) {
+        if(ret.lastaddr < 0)
+          ret.firstaddr = job->fs.firstaddr;
+        ret.lastaddr = job->fs.lastaddr;
+      }
+      ret.nbytes += job->fs.nbytes;
+      ret.nsections += job->fs.nsections;
+      ret.npages += job->fs.npages;
+      ret.nfill += job->fs.nfill;
+      ret.ntrailing += job->fs.ntrailing;
+      // A section that spans the chunk boundary was counted twice
+      if(i && job->from < size && tag_isset(mem->tags, job->from) && tag_isset(mem->tags, job->from - 1))
+        ret.nsections--;
+    }
+  } else
+#endif
+    memstats_chunk(mem, size, pgsize, 0, mem->size, &ret);
+
   if(fsp)
     *fsp = ret;
 
@@ -419,8 +546,10 @@ int update_dryrun(const AVRPART *p, UPDATE *upd) {
 
   if(!known && upd->format == FMT_AUTO) {
     if(str_eq(upd->filename, "-")) {
-      pmsg_error("cannot auto detect file format for stdin/out, specify explicitly\n");
-      ret = LIBAVRDUDE_GENERAL_FAILURE;
+      if(upd->op == DEVICE_READ) {
+        pmsg_error("cannot auto detect file format for stdout, specify explicitly\n");
+        ret = LIBAVRDUDE_GENERAL_FAILURE;
+      }                         // Else fileio detects the format when reading stdin
     } else if((format_detect = fileio_fmt_autodetect(upd->filename)) < 0) {
       pmsg_error("cannot determine file format for %s, specify explicitly\n", upd->filename);
       ret = LIBAVRDUDE_GENERAL_FAILURE;
@@ -463,13 +592,330 @@ int update_dryrun(const AVRPART *p, UPDATE *upd) {
   return ret;
 }
 
+/*
+ * Parse the input file of a -U write or verify ahead of do_op(), which then
+ * reuses the parsed contents as long as the file does not change (see
+ * fileio_mem_cached()); returns the size of the contents, 0 if nothing needs
+ * parsing or a negative error code
+ */
+int update_preload(const AVRPART *p, const UPDATE *upd) {
+  if(upd->cmdline || !upd->memstr || !upd->filename || upd->op == DEVICE_READ ||
+    upd->format == FMT_IMM || upd->format == FMT_AUTO || str_eq(upd->filename, "-"))
+    return 0;
+
+  const AVRMEM *mem = is_multimem(upd->memstr)? fileio_any_memory("any"): avr_locate_mem(p, upd->memstr);
+
+  if(!mem)
+    return 0;                   // do_op() skips the operation
+
+  // Parse into a scratch copy as the part's memories might not have buffers yet
+  AVRMEM *m = avr_dup_mem(mem);
+  int op = upd->op == DEVICE_WRITE? FIO_READ: FIO_READ_FOR_VERIFY;
+
+  if(!m->buf) {
+    m->buf = mmt_malloc(m->size);
+    m->tags = mmt_malloc(tag_bytes(m->size));
+  }
+  int span = avr_span_begin("file input", avr_mem_name(p, mem));
+  int rc = fileio_mem_cached(op, upd->filename, upd->format, p, m);
+
+  avr_span_end(span, rc < 0? 0: rc);
+  avr_free_mem(m);
+  if(rc < 0 && !is_generated_fname(upd->filename))
+    pmsg_error("reading from file %s failed\n", str_infilename(upd->filename));
+
+  return rc;
+}
+
+struct update_prefetch {
+  const AVRPART *p;
+  const UPDATE *upd;
+  AVRMEM *any, *mem;            // Scratch memory that receives the file contents
+  int op, rc, nheld;            // File operation, return value of fileio_mem() and messages held back
+  long long fsize, mtime;       // The file when parsing started
+  Avr_opts opts;                // Options of the session for the helper
+#ifdef UPD_THREADS
+  pthread_t tid;
+#endif
+};
+
+#ifdef UPD_THREADS
+static void *prefetch_worker(void *arg) {
+  Update_prefetch *pf = arg;
+
+  init_cx(NULL);                // The helper's own context
+  avr_opts_load(&pf->opts);
+  cx->upd_msghold = 1;          // Messages would appear out of order: do_op() parses again if any
+  pf->rc = fileio_mem(pf->op, pf->upd->filename, pf->upd->format, pf->p, pf->mem, -1);
+  pf->nheld = cx->upd_nheld;
+  fileio_free_cache();
+  free_cx();
+
+  return NULL;
+}
+#endif
+
+/*
+ * Start parsing the input file of a -U write or verify in a helper thread
+ * while the device is busy with a previous operation; update_prefetch_finish()
+ * must be called before do_op() of the update, which then finds the parsed
+ * contents in the cache of fileio_mem_cached(). Returns NULL if there is
+ * nothing to parse, eg, because the file was parsed before, or if the helper
+ * thread cannot be started.
+ */
+Update_prefetch *update_prefetch(const AVRPART *p, const UPDATE *upd) {
+#ifdef UPD_THREADS
+  struct stat st;
+
+  if(upd->cmdline || !upd->memstr || !upd->filename || upd->op == DEVICE_READ ||
+    upd->format == FMT_IMM || upd->format == FMT_AUTO || str_eq(upd->filename, "-") ||
+    is_generated_fname(upd->filename) || stat(upd->filename, &st) < 0 || !S_ISREG(st.st_mode))
+    return NULL;
+
+  AVRMEM *any = is_multimem(upd->memstr)? fileio_any_memory("any"): NULL;
+  const AVRMEM *mem = any? any: avr_locate_mem(p, upd->memstr);
+  int op = upd->op == DEVICE_WRITE? FIO_READ: FIO_READ_FOR_VERIFY;
+
+  if(!mem || fileio_mem_iscached(op, upd->filename, upd->format, p, mem, st.st_size, st.st_mtime)) {
+    avr_free_mem(any);
+    return NULL;
+  }
+
+  Update_prefetch *pf = mmt_malloc(sizeof *pf);
+
+  pf->p = p;
+  pf->upd = upd;
+  pf->any = any;
+  pf->mem = avr_dup_mem(mem);
+  if(!pf->mem->buf) {
+    pf->mem->buf = mmt_malloc(pf->mem->size);
+    pf->mem->tags = mmt_malloc(tag_bytes(pf->mem->size));
+  }
+  pf->op = op;
+  pf->fsize = st.st_size;
+  pf->mtime = st.st_mtime;
+  avr_opts_save(&pf->opts);
+  if(pthread_create(&pf->tid, NULL, prefetch_worker, pf)) {
+    avr_free_mem(pf->mem);
+    avr_free_mem(any);
+    mmt_free(pf);
+    return NULL;
+  }
+  pmsg_debug("parsing %s ahead in a helper thread\n", upd->filename);
+
+  return pf;
+#else
+  (void) p, (void) upd;
+  return NULL;
+#endif
+}
+
+/*
+ * Wait for the helper thread of update_prefetch() and keep the parsed contents
+ * unless parsing failed or printed messages, in which case do_op() parses the
+ * file again and reports them; returns the return value of fileio_mem()
+ */
+int update_prefetch_finish(Update_prefetch *pf) {
+  int rc = 0;
+
+#ifdef UPD_THREADS
+  if(!pf)
+    return 0;
+  pthread_join(pf->tid, NULL);
+  rc = pf->rc;
+  if(!pf->nheld)
+    fileio_mem_adopt(pf->op, pf->upd->filename, pf->upd->format, pf->p, pf->mem, pf->fsize, pf->mtime, rc);
+  avr_free_mem(pf->mem);
+  avr_free_mem(pf->any);
+  mmt_free(pf);
+#else
+  (void) pf;
+#endif
+
+  return rc;
+}
+
+#define UPD_STREAM_MIN 4096     // Smallest memory for which -U memory:r streams the output file
+
+typedef struct {
+  Fio_stream *fs;
+  const AVRMEM *mem;
+  int upto, size, done, rc;     // Final bytes in mem->buf, size of the file once done and result
+  Avr_opts opts;                // Options of the session for the helper
+#ifdef UPD_THREADS
+  pthread_t tid;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} Update_stream;
+
+#ifdef UPD_THREADS
+// Called by avr_read_mem() as pages come in: wake up the output stage
+static void stream_read_hook(const AVRMEM *mem, int upto) {
+  Update_stream *us = cx->upd_stream;
+
+  if(!us || mem != us->mem)
+    return;
+  pthread_mutex_lock(&us->lock);
+  us->upto = upto;
+  pthread_cond_signal(&us->cond);
+  pthread_mutex_unlock(&us->lock);
+}
+
+static void *stream_worker(void *arg) {
+  Update_stream *us = arg;
+  int seen = 0;
+
+  init_cx(NULL);                // The helper's own context
+  avr_opts_load(&us->opts);
+  pthread_mutex_lock(&us->lock);
+  while(1) {
+    while(!us->done && us->upto == seen)
+      pthread_cond_wait(&us->cond, &us->lock);
+    if(us->done)
+      break;
+    seen = us->upto;
+    pthread_mutex_unlock(&us->lock);
+    fileio_stream_write(us->fs, seen); // Errors are reported by fileio_stream_close()
+    pthread_mutex_lock(&us->lock);
+  }
+  int size = us->size;
+
+  pthread_mutex_unlock(&us->lock);
+  us->rc = fileio_stream_close(us->fs, size);
+  free_cx();
+
+  return NULL;
+}
+#endif
+
+/*
+ * Start writing the output file of a single-memory -U ...:r in a helper
+ * thread while the memory is being read, so that a big backup is complete
+ * soon after its last page has arrived; update_stream_close() must be called
+ * once the read is over. Returns NULL if the output is not streamed, eg, for
+ * small memories or if fileio_stream_open() cannot stream the file format.
+ */
+static Update_stream *update_stream_open(const AVRPART *p, const AVRMEM *mem, const UPDATE *upd) {
+#ifdef UPD_THREADS
+  Fio_stream *fs;
+
+  if(mem->size < UPD_STREAM_MIN || cx->upd_stream ||
+    !(fs = fileio_stream_open(upd->filename, upd->format, p, mem)))
+    return NULL;
+
+  Update_stream *us = mmt_malloc(sizeof *us);
+
+  us->fs = fs;
+  us->mem = mem;
+  avr_opts_save(&us->opts);
+  pthread_mutex_init(&us->lock, NULL);
+  pthread_cond_init(&us->cond, NULL);
+  if(pthread_create(&us->tid, NULL, stream_worker, us)) {
+    fileio_stream_close(fs, -1);
+    pthread_cond_destroy(&us->cond);
+    pthread_mutex_destroy(&us->lock);
+    mmt_free(us);
+    return NULL;
+  }
+  cx->upd_stream = us;
+  cx->avr_read_hook = stream_read_hook;
+  pmsg_debug("writing %s in a helper thread while reading\n", upd->filename);
+
+  return us;
+#else
+  (void) p, (void) mem, (void) upd;
+  return NULL;
+#endif
+}
+
+// Let the output stage finish the file with size bytes (< 0: drop it); returns size or -1 on error
+static int update_stream_close(Update_stream *us, int size) {
+  int rc = -1;
+
+#ifdef UPD_THREADS
+  if(!us)
+    return -1;
+  cx->avr_read_hook = NULL;
+  cx->upd_stream = NULL;
+  pthread_mutex_lock(&us->lock);
+  us->size = size;
+  us->done = 1;
+  pthread_cond_signal(&us->cond);
+  pthread_mutex_unlock(&us->lock);
+  pthread_join(us->tid, NULL);
+  rc = us->rc;
+  pthread_cond_destroy(&us->cond);
+  pthread_mutex_destroy(&us->lock);
+  mmt_free(us);
+#else
+  (void) us, (void) size;
+#endif
+
+  return rc;
+}
+
+/*
+ * Writing size bytes of mem rewrites every page with input data (flash
+ * pages are erased first). So would a differential write, but that first
+ * reads the pages that the device cache does not know and then rewrites only
+ * the pages that differ. Returns whether the cost model predicts that the
+ * differential write is faster; if so, or if both can be predicted, -v
+ * explains the choice.
+ */
+static int update_diff_is_faster(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem, int size) {
+  int pgsz = mem->page_size, npages = 0, nknown = 0, nchanged = 0;
+  const char *m_name = avr_mem_name(p, mem);
+
+  if(pgsz < 2 || size < 1 || !avr_has_paged_access(pgm, p, mem))
+    return 0;
+
+  double rd = costmodel_us(COST_READ, mem, pgsz), wr = costmodel_us(COST_WRITE, mem, pgsz);
+  double er = mem_is_eeprom(mem)? 0: costmodel_us(COST_ERASE, mem, pgsz);
+
+  if(rd < 0 || wr < 0) {
+    pmsg_notice2("cost model cannot predict writing %s yet; using full write\n", m_name);
+    return 0;
+  }
+  if(er < 0)                    // Not measured, eg, as the programmer erases and writes in one go
+    er = 0;
+
+  for(int addr = 0; addr < size; addr += pgsz) {
+    if(!tag_any(mem->tags, addr, size - addr < pgsz? size - addr: pgsz))
+      continue;
+    npages++;
+    const unsigned char *dev = devcache_page(mem, addr);
+
+    if(dev) {
+      nknown++;
+      if(memcmp(mem->buf + addr, dev, pgsz))
+        nchanged++;
+    }
+  }
+  if(!npages)
+    return 0;
+
+  double share = costmodel_changed(mem), more = (npages - nknown)*share;
+  double full = npages*(er + wr), diff = (npages - nknown)*rd + (nchanged + more)*(er + wr);
+  int ret = diff < full;
+
+  pmsg_notice("cost model predicts %.3f s for a differential and %.3f s for a full write of %s; using %s write\n",
+    diff/1e6, full/1e6, m_name, ret? "differential": "full");
+  imsg_notice("%d page%s to write: %d known from device cache (%d changed), %.0f%% of the others expected to change\n",
+    npages, str_plural(npages), nknown, nchanged, 100*share);
+
+  return ret;
+}
+
+// Returns highest address written plus 1 and sets *verified if the write has been verified inline
 static int update_avr_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
-  const UPDATE *upd, enum updateflags flags, int size, int multiple) {
+  const UPDATE *upd, enum updateflags flags, int size, int multiple, int *verified) {
 
   int rc = 0, pbar = (mem->size > 32 || verbose > 1) && update_progress;
   Filestats fs, fs_patched;
   const char *m_name = avr_mem_name(p, mem);
 
+  *verified = 0;
   if(memstats_mem(p, mem, size, &fs) < 0)
     return -1;
   if(multiple)                  // Single file writes multiple memories, say which ones
@@ -523,45 +969,197 @@ static int update_avr_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRME
   } else {
     if(pbar)
       report_progress(0, 1, "Writing");
-    rc = avr_write_mem(pgm, p, mem, size, (flags & UF_AUTO_ERASE) != 0);
+    int diff = (flags & UF_DIFFERENTIAL) || ((flags & UF_DIFF_EEPROM) && mem_is_eeprom(mem));
+
+    // Choose a differential write where it would leave the device in the same state
+    if(!diff && (mem_is_eeprom(mem) || (mem_is_in_flash(mem) && (flags & UF_AUTO_ERASE) && pgm->page_erase &&
+      !cx->avr_flash_erased)))
+      diff = update_diff_is_faster(pgm, p, mem, size);
+    int span = avr_span_begin("write", m_name);
+
+    if((flags & UF_INLINE_VERIFY) && (flags & UF_VERIFY))
+      rc = avr_write_mem_verified(pgm, p, mem, size, (flags & UF_AUTO_ERASE) != 0, diff, verified);
+    else
+      rc = diff? avr_write_mem_diff(pgm, p, mem, size):
+        avr_write_mem(pgm, p, mem, size, (flags & UF_AUTO_ERASE) != 0);
+    avr_span_end(span, rc < 0? 0: fs.nbytes);
     report_progress(1, 1, NULL);
   }
 
   if(rc < 0)
     return -1;
   // @@@ has there has been output in the meantime to make the ", x bytes written" look out of place?
-  if(pbar && !(flags & UF_VERIFY))
+  if(pbar && *verified)
+    pmsg_info("%d byte%s of %s written and verified page by page\n", fs.nbytes, str_plural(fs.nbytes), m_name);
+  else if(pbar && !(flags & UF_VERIFY))
     pmsg_info("%d byte%s of %s written", fs.nbytes, str_plural(fs.nbytes), m_name);
   else if(!pbar)
-    msg_info(", %d byte%s written", fs.nbytes, str_plural(fs.nbytes));
+    msg_info(", %d byte%s written%s", fs.nbytes, str_plural(fs.nbytes), *verified? " and verified\n": "");
 
   return rc;                    // Highest memory address written plus 1
 }
 
+/*
+ * Set the verify policy from spec, which is one of
+ *  - crc: programmers that can confirm input ranges on the device, eg, with a
+ *    device-side CRC, do so; all other ranges are read back (default)
+ *  - full: always read back all input bytes from the device
+ *  - sample[:<n>]: as crc, but also read back byte for byte the pages with the
+ *    vector table, the last page with data and n (default 8) randomly chosen
+ *    pages of paged memories
+ * Returns 0 on success and -1 if spec is invalid.
+ */
+int update_set_verify_policy(const char *spec) {
+  const char *errstr = NULL;
+  int n = 8;
+
+  if(str_eq(spec, "crc"))
+    cx->upd_vfy_policy = UPD_VFY_CRC;
+  else if(str_eq(spec, "full"))
+    cx->upd_vfy_policy = UPD_VFY_FULL;
+  else if(str_eq(spec, "sample") || str_starts(spec, "sample:")) {
+    if(spec[6] && ((n = str_int(spec + 7, STR_INT32, &errstr)), errstr || n < 0))
+      return -1;
+    cx->upd_vfy_policy = UPD_VFY_SAMPLE;
+    cx->upd_vfy_samples = n;
+    cx->upd_vfy_rng = (uint32_t) avr_ustimestamp() | 1;
+  } else
+    return -1;
+
+  return 0;
+}
+
+// Verify policy as string for reports
+const char *update_verify_policy(void) {
+  switch(cx->upd_vfy_policy) {
+  case UPD_VFY_FULL:
+    return "full";
+  case UPD_VFY_SAMPLE:
+    return str_ccprintf("sample:%d", cx->upd_vfy_samples);
+  default:
+    return "crc";
+  }
+}
+
+static uint32_t update_random(void) {
+  uint32_t x = cx->upd_vfy_rng;  // Xorshift32
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return cx->upd_vfy_rng = x;
+}
+
+/*
+ * Tag the sample pages of the verify policy UPD_VFY_SAMPLE in vmem for
+ * reading back from the device: pages of the vector table, the last page
+ * with input data and cx->upd_vfy_samples randomly chosen other pages with
+ * input data. Returns the number of pages tagged.
+ */
+static int update_tag_samples(const AVRPART *p, const AVRMEM *mem, const AVRMEM *vmem, int size) {
+  int pgsize = mem->page_size, npages = (size + pgsize - 1)/pgsize, nvec = 0, last = -1, ncand = 0;
+
+  if(pgsize < 2 || npages < 1)
+    return 0;
+  if(mem_is_in_flash(mem) && mem->offset == avr_locate_flash(p)->offset) { // Vector table at 0
+    int vecsz = mem->size <= 8192? 2: 4, nvbytes = (p->n_interrupts > 0? p->n_interrupts: 1)*vecsz;
+
+    nvec = (nvbytes + pgsize - 1)/pgsize;
+  }
+
+  int *cand = mmt_malloc(npages*sizeof *cand), ret = 0;
+
+  for(int k = 0; k < npages; k++)
+    if(tag_any(mem->tags, k*pgsize, k == npages - 1? size - k*pgsize: pgsize))
+      last = k;
+  for(int k = 0; k < npages; k++) {
+    int len = k == npages - 1? size - k*pgsize: pgsize;
+
+    if(!tag_any(mem->tags, k*pgsize, len))
+      continue;
+    if(k < nvec || k == last) {
+      tag_copy(vmem->tags, k*pgsize, mem->tags, k*pgsize, len);
+      ret++;
+    } else
+      cand[ncand++] = k;
+  }
+
+  // Partial Fisher-Yates shuffle picks the random pages among the others
+  for(int i = 0; i < ncand && i < cx->upd_vfy_samples; i++) {
+    int j = i + update_random()%(ncand - i), k = cand[j];
+
+    cand[j] = cand[i];
+    tag_copy(vmem->tags, k*pgsize, mem->tags, k*pgsize, k == npages - 1? size - k*pgsize: pgsize);
+    ret++;
+  }
+  mmt_free(cand);
+
+  return ret;
+}
+
+/*
+ * Would confirming n bytes of mem on the device (see pgm->verify_range) be
+ * faster than reading them back? The answer is yes unless the cost model
+ * predicts otherwise; -v explains the choice if both can be predicted.
+ */
+static int update_crc_is_faster(const AVRPART *p, const AVRMEM *mem, int n) {
+  double crc = costmodel_us(COST_CRC, mem, n), rd = costmodel_us(COST_READ, mem, n);
+
+  if(crc < 0 || rd < 0)
+    return 1;
+
+  pmsg_notice("cost model predicts %.3f s for checking %s on the device and %.3f s for reading it back; %s\n",
+    crc/1e6, avr_mem_name(p, mem), rd/1e6, crc <= rd? "checking on device": "reading back");
+
+  return crc <= rd;
+}
+
 static int update_avr_verify(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *mem,
   const UPDATE *upd, int size, const char *caption) {
 
   int retval = LIBAVRDUDE_GENERAL_FAILURE, pbar = (mem->size > 32 || verbose > 1) && update_progress;
   Filestats fs;
-  AVRPART *v = avr_dup_part(p);
+  AVRPART *v = avr_dup_part_mem(p, mem);  // Verification only needs a copy of mem
   const char *m_name = avr_mem_name(p, mem);
 
   if(memstats_mem(p, mem, size, &fs) < 0)
     goto error;
+  // Pages that were skipped as blank after chip erase are expected to read 0xff
+  avr_untag_blank(mem, avr_locate_mem(v, mem->desc));
 
   led_set(pgm, LED_VFY);
   if(pbar)
     report_progress(0, 1, caption);
-  int rc = avr_read_mem(pgm, p, mem, v);
+  int span = avr_span_begin("verify", m_name);
+
+  avr_bulk_phase(1);
+  // Skip reading back input ranges that the programmer can confirm on the device
+  int rc, left = 1;
+
+  if(pgm->verify_range && cx->upd_vfy_policy != UPD_VFY_FULL &&
+    update_crc_is_faster(p, mem, fs.nbytes + fs.ntrailing)) {
+    left = avr_verify_ranges(pgm, p, v, mem, size);
+    if(cx->upd_vfy_policy == UPD_VFY_SAMPLE) {
+      int ns = update_tag_samples(p, mem, avr_locate_mem(v, mem->desc), size);
+
+      pmsg_notice2("reading back %d sampled page%s of %s\n", ns, str_plural(ns), m_name);
+      left += ns;
+    }
+  }
+  rc = left? avr_read_mem(pgm, p, mem, v): 0;
 
+  avr_bulk_phase(0);
   report_progress(1, 1, NULL);
   if(rc < 0) {
+    avr_span_end(span, 0);
     pmsg_error("unable to read all of %s (rc = %d)\n", m_name, rc);
     led_set(pgm, LED_ERR);
     goto error;
   }
 
   rc = avr_verify_mem(pgm, p, v, mem, size);
+  avr_span_end(span, rc < 0? 0: fs.nbytes + fs.ntrailing);
   if(rc < 0) {
     pmsg_error("%s verification mismatch\n", mem->desc);
     led_set(pgm, LED_ERR);
@@ -597,22 +1195,85 @@ static int update_mem_from_all(const UPDATE *upd, const AVRPART *p, const AVRMEM
 
   if(allsize - off < size)      // Clip to available data in input
     size = allsize > off? allsize - off: 0;
-  if(is_memset(all->tags + off, 0, size)) // Nothing set? This memory was not present
+  if(!tag_any(all->tags, off, size)) // Nothing set? This memory was not present
     size = 0;
   if(size == 0)
     pmsg_warning("%s has no data for %s, skipping ...\n", str_infilename(upd->filename), m_name);
 
   memcpy(m->buf, all->buf + off, size);
-  memcpy(m->tags, all->tags + off, size);
+  tag_copy(m->tags, 0, all->tags, off, size);
 
   return size;
 }
 
+/*
+ * Apply the overlay patch to the contents of mem that were read from a file:
+ * semicolon separated items <addr> <data> {<data>}, where the data are
+ * numbers and strings as for the terminal write command, eg, 0x3f0 "SN001234";
+ * 0x3fc 0x47 0x11. The parsed file stays untouched in the image cache, so
+ * per-unit patches do not require parsing the file again. Returns the size of
+ * the patched contents, which is at least size, or -1 on error.
+ */
+static int update_patch(const AVRPART *p, const AVRMEM *mem, const char *patch, int size) {
+  char *spec = mmt_strdup(patch), *next = spec, *item, *rest, *tok;
+  const char *errstr;
+  int ret = size;
+
+  while(ret >= 0 && *(item = str_nexttok(next, ";", &next))) {
+    tok = str_nexttok(item, " \t\n\r\v\f", &rest);
+    int addr = str_int(tok, STR_INT32, &errstr);
+
+    if(errstr || addr < 0 || addr >= mem->size) {
+      pmsg_error("invalid %s patch address %s%s%s\n", mem->desc, tok, errstr? ": ": "", errstr? errstr: "");
+      ret = -1;
+      break;
+    }
+    while(*(tok = str_nexttok(rest, " \t\n\r\v\f", &rest))) {
+      Str2data *sd = str_todata(tok, STR_NUMBER | STR_STRING, p, mem->desc);
+      const unsigned char *data = NULL;
+      int n = 0;
+
+      if(!sd->type || sd->errstr) {
+        pmsg_error("%s patch data %s: %s\n", mem->desc, tok, sd->errstr? sd->errstr: "str_todata");
+        ret = -1;
+      } else if(sd->type == STR_STRING && sd->str_ptr) {
+        data = (unsigned char *) sd->str_ptr;
+        n = strlen(sd->str_ptr) + 1;    // Including terminating nul as the terminal does
+      } else if(sd->size > 0 && (sd->type & STR_NUMBER)) {
+        if(is_bigendian())      // Always write little endian
+          change_endian(sd->a, sd->size);
+        data = sd->a;
+        n = sd->size;
+      }
+      if(ret >= 0 && addr + n > mem->size) {
+        pmsg_error("%s patch data %s at 0x%04x exceed memory size %d\n", mem->desc, tok, addr, mem->size);
+        ret = -1;
+      }
+      if(ret >= 0 && n) {
+        memcpy(mem->buf + addr, data, n);
+        tag_set_range(mem->tags, addr, n);
+        addr += n;
+        if(addr > ret)
+          ret = addr;
+      }
+      str_freedata(sd);
+      if(ret < 0)
+        break;
+    }
+  }
+  mmt_free(spec);
+
+  return ret;
+}
+
 static int update_all_from_file(const UPDATE *upd, const PROGRAMMER *pgm, const AVRPART *p,
   const AVRMEM *all, const char *mem_desc, Filestats *fsp) {
   // On writing to the device trailing 0xff might be cut off
   int op = upd->op == DEVICE_WRITE? FIO_READ: FIO_READ_FOR_VERIFY;
-  int allsize = fileio_mem(op, upd->filename, upd->format, p, all, -1);
+  int span = avr_span_begin("file input", mem_desc);
+  int allsize = fileio_mem_cached(op, upd->filename, upd->format, p, all);
+
+  avr_span_end(span, allsize < 0? 0: allsize);
 
   if(is_generated_fname(upd->filename)) // Autogeneration prints its own errors
     if(allsize <= 0)
@@ -622,7 +1283,19 @@ static int update_all_from_file(const UPDATE *upd, const PROGRAMMER *pgm, const
     pmsg_error("reading from file %s failed\n", str_infilename(upd->filename));
     return -1;
   }
-  if(memstats_mem(p, all, allsize, fsp) < 0)
+  if(upd->patch) {
+    if(is_multimem(upd->memstr)) {
+      pmsg_error("patches need a single memory, not %s\n", upd->memstr);
+      return -1;
+    }
+    if((allsize = update_patch(p, all, upd->patch, allsize)) < 0)
+      return -1;
+  }
+  span = avr_span_begin("memstats", mem_desc);
+  int rc = memstats_mem(p, all, allsize, fsp);
+
+  avr_span_end(span, rc < 0? 0: allsize);
+  if(rc < 0)
     return -1;
   pmsg_info(upd->op == DEVICE_WRITE?
     "reading %d byte%s for %s from input file %s\n":
@@ -633,12 +1306,42 @@ static int update_all_from_file(const UPDATE *upd, const PROGRAMMER *pgm, const
   return allsize;
 }
 
+/*
+ * Plan the processing of a memory list: work out the location offs[i] of each
+ * memory in the flat multi-memory address space and which other listed memory
+ * cover[i], if any, contains it there (-1 if none), eg, fuses contains fuse0
+ * and prodsig contains tempsense on UPDI parts. The largest containing memory
+ * is chosen, so covering memories are not themselves covered. Reads of covered
+ * memories can then be taken from the covering one and writes be skipped when
+ * the covering memory has already written the same file data.
+ */
+static void memlist_plan(const AVRPART *p, AVRMEM **ml, int n, unsigned *offs, int *cover) {
+  for(int i = 0; i < n; i++)
+    offs[i] = fileio_mem_offset(p, ml[i]);
+
+  for(int i = 0; i < n; i++) {
+    cover[i] = -1;
+    if(offs[i] == ~0U)
+      continue;
+    for(int j = 0; j < n; j++) {
+      if(j == i || offs[j] == ~0U || offs[j] > offs[i] || offs[j] + ml[j]->size < offs[i] + ml[i]->size)
+        continue;
+      if(ml[j]->size == ml[i]->size && j > i) // Equal ones are covered by the first one
+        continue;
+      if(cover[i] < 0 || ml[j]->size > ml[cover[i]]->size)
+        cover[i] = j;
+    }
+  }
+}
+
 int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updateflags flags) {
-  int retval = LIBAVRDUDE_GENERAL_FAILURE, rwvproblem = 0, rwvsoftfail = 0;
+  int retval = LIBAVRDUDE_GENERAL_FAILURE, rwvproblem = 0, rwvsoftfail = 0, verified;
   AVRMEM *mem, **umemlist = NULL, *m;
   Segment *seglist = NULL;
   Filestats fs;
   const char *umstr = upd->memstr;
+  unsigned *offs = NULL;
+  int *cover = NULL, *done = NULL;
 
   if(!(flags & UF_NOHEADING)) {
     char *heading = update_str(upd);
@@ -672,6 +1375,10 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
         maxrlen = len;
 
     seglist = mmt_malloc(ns*sizeof *seglist);
+    offs = mmt_malloc(ns*sizeof *offs);
+    cover = mmt_malloc(ns*sizeof *cover);
+    done = mmt_malloc(ns*sizeof *done);
+    memlist_plan(p, umemlist, ns, offs, cover);
   }
 
   mem = umemlist? fileio_any_memory("any"): avr_locate_mem(p, umstr);
@@ -708,19 +1415,36 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
       int dffo = cx->avr_disableffopt;
 
       cx->avr_disableffopt = 1;
-      if(upd->format != FMT_IHEX && upd->format != FMT_IHXC && upd->format != FMT_SREC && upd->format != FMT_ELF) {
+      if(upd->format != FMT_IHEX && upd->format != FMT_IHXC && upd->format != FMT_SREC && upd->format != FMT_ELF &&
+        upd->format != FMT_PIMG) {
         pmsg_warning("generating %s file format with multiple memories that cannot\n", fileio_fmtstr(upd->format));
-        imsg_warning("be read by %s; consider using :I :i or :s instead\n", progname);
+        imsg_warning("be read by %s; consider using :I :i :s or :p instead\n", progname);
       }
       pmsg_info("reading %s ...\n", mem_desc);
       int nn = 0, nbytes = 0;
 
+      for(int ii = 0; ii < ns; ii++)
+        done[ii] = INT_MIN;     // Not yet read
       for(int ii = 0; ii < ns; ii++) {
         m = umemlist[ii];
         const char *m_name = avr_mem_name(p, m);
+        int ret, jj = cover[ii];
 
         report_progress(0, 1, str_ccprintf(" - %-*s", maxrlen, m_name));
-        int ret = avr_read_mem(pgm, p, m, NULL);
+        int span = avr_span_begin("read", m_name);
+
+        avr_bulk_phase(1);
+        if(jj >= 0 && done[jj] == INT_MIN)      // Read covering memory ahead of its turn
+          done[jj] = avr_read_mem(pgm, p, umemlist[jj], NULL);
+        if(jj >= 0 && done[jj] >= (int) (offs[ii] - offs[jj]) + m->size) {
+          // Take contents from covering memory instead of reading the device again
+          memcpy(m->buf, umemlist[jj]->buf + offs[ii] - offs[jj], m->size);
+          ret = m->size;
+        } else
+          ret = done[ii] != INT_MIN? done[ii]: avr_read_mem(pgm, p, m, NULL);
+        avr_bulk_phase(0);
+        done[ii] = ret;
+        avr_span_end(span, ret < 0? 0: ret);
 
         report_progress(1, 1, NULL);
         if(ret < 0) {
@@ -728,7 +1452,7 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
           rwvproblem = 1;
           continue;
         }
-        unsigned off = fileio_mem_offset(p, m);
+        unsigned off = offs[ii];
 
         if(off == ~0U) {
           pmsg_warning("cannot map %s to flat address space, skipping ...\n", m_name);
@@ -746,25 +1470,37 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
       }
 
       pmsg_info("writing %d byte%s to output file %s\n", nbytes, str_plural(nbytes), str_outfilename(upd->filename));
-      if(nn)
+      if(nn) {
+        int span = avr_span_begin("file output", mem_desc);
+
         rc = fileio_segments(FIO_WRITE, upd->filename, upd->format, p, mem, nn, seglist);
-      else
+        avr_span_end(span, rc < 0? 0: nbytes);
+      } else
         pmsg_notice("empty memory, resulting file has no contents\n");
       cx->avr_disableffopt = dffo;
     } else {                    // Regular file
       pmsg_info("reading %s memory ...\n", mem_desc);
       if(mem->size > 32)
         report_progress(0, 1, rcap);
+      int span = avr_span_begin("read", mem_desc);
+      Update_stream *us = update_stream_open(p, mem, upd);
+
+      avr_bulk_phase(1);
       rc = avr_read(pgm, p, umstr, 0);
+      avr_bulk_phase(0);
+      avr_span_end(span, rc < 0? 0: rc);
       report_progress(1, 1, NULL);
       if(rc < 0) {
+        update_stream_close(us, -1);
         pmsg_error("unable to read all of %s (rc = %d)\n", mem_desc, rc);
         goto error;
       }
       if(rc == 0)
         pmsg_notice("empty memory, resulting file has no contents\n");
       pmsg_info("writing %d byte%s to output file %s\n", rc, str_plural(rc), str_outfilename(upd->filename));
-      rc = fileio_mem(FIO_WRITE, upd->filename, upd->format, p, mem, rc);
+      span = avr_span_begin("file output", mem_desc);
+      rc = us? update_stream_close(us, rc): fileio_mem(FIO_WRITE, upd->filename, upd->format, p, mem, rc);
+      avr_span_end(span, rc < 0? 0: rc);
     }
 
     if(rc < 0) {
@@ -780,14 +1516,23 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
     if(allsize == 0)
        break;
     if(umemlist) {
-      for(int i = 0; i < ns; i++) {
+      // Write covering memories first (pass 0) so covered ones can often be skipped (pass 1)
+      for(int i = 0; i < ns; i++)
+        done[i] = 0;            // Size of data written and verified
+      for(int pass = 0; pass < 2; pass++) for(int i = 0; i < ns; i++) {
+        if((cover[i] >= 0) != pass)
+          continue;
         m = umemlist[i];
         // Silently skip readonly memories and fuses/lock in bootloaders
         if(mem_is_readonly(m) || (is_spm(pgm) && (mem_is_in_fuses(m) || mem_is_lock(m))))
           continue;
 
-        int ret, size = update_mem_from_all(upd, p, m, mem, allsize);
+        int ret, size = update_mem_from_all(upd, p, m, mem, allsize), j = cover[i];
 
+        if(j >= 0 && size > 0 && done[j] >= (int) (offs[i] - offs[j]) + size) {
+          pmsg_notice2("%s already written with %s\n", avr_mem_name(p, m), avr_mem_name(p, umemlist[j]));
+          continue;
+        }
         switch(size) {
         case LIBAVRDUDE_GENERAL_FAILURE:
           rwvproblem = 1;
@@ -796,24 +1541,25 @@ int do_op(const PROGRAMMER *pgm, const AVRPART *p, const UPDATE *upd, enum updat
           rwvsoftfail = 1;
           break;
         default:
-          if((ret = update_avr_write(pgm, p, m, upd, flags, size, 1)) < 0) {
+          if((ret = update_avr_write(pgm, p, m, upd, flags, size, 1, &verified)) < 0) {
             pmsg_warning("unable to write %s (ret = %d), skipping...\n", avr_mem_name(p, m), ret);
             rwvproblem = 1;
             continue;
           }
           // @@@ verify size could be too small if file was not a multi-file and had trailing 0xff
-          if((flags & UF_VERIFY) && update_avr_verify(pgm, p, m, upd, size, rcap) < 0) {
+          if((flags & UF_VERIFY) && !verified && update_avr_verify(pgm, p, m, upd, size, rcap) < 0) {
             rwvproblem = 1;
             continue;
           }
+          done[i] = size;
         }
       }
     } else {
-      if((rc = update_avr_write(pgm, p, mem, upd, flags, allsize, 0)) < 0) {
+      if((rc = update_avr_write(pgm, p, mem, upd, flags, allsize, 0, &verified)) < 0) {
         pmsg_error("unable to write %s (rc = %d)\n", mem_desc, rc);
         goto error;
       }
-      if((flags & UF_VERIFY) && update_avr_verify(pgm, p, mem, upd, fs.lastaddr + 1, rcap) < 0)
+      if((flags & UF_VERIFY) && !verified && update_avr_verify(pgm, p, mem, upd, fs.lastaddr + 1, rcap) < 0)
         goto error;
       if(str_starts(upd->filename, "urboot:")) {
         pmsg_info("setting fuses for bootloader %s\n", upd->filename);
@@ -866,6 +1612,125 @@ error:
     avr_free_mem(mem);
     mmt_free(umemlist);
     mmt_free(seglist);
+    mmt_free(offs);
+    mmt_free(cover);
+    mmt_free(done);
   }
   return retval;
 }
+
+// Is upd a write of one fuse of a part with a fuses memory that contains it?
+int update_is_fuse_write(const AVRPART *p, const UPDATE *upd) {
+  const AVRMEM *m, *fz;
+
+  return upd && !upd->cmdline && upd->op == DEVICE_WRITE && upd->memstr && !is_multimem(upd->memstr) &&
+    (m = avr_locate_mem(p, upd->memstr)) && mem_is_a_fuse(m) && (fz = avr_locate_fuses(p)) &&
+    m->offset >= fz->offset && m->offset + m->size <= fz->offset + fz->size;
+}
+
+/*
+ * Carry out n consecutive single-fuse writes (see update_is_fuse_write()) as
+ * one group: all fuses are read once, only bytes that change are written,
+ * in one block if the programmer can (pgm->range_write), and verification
+ * reads all fuses once more. Returns LIBAVRDUDE_SUCCESS or a negative code.
+ */
+int do_fuse_group(const PROGRAMMER *pgm, const AVRPART *p, UPDATE *const *upds, int n, enum updateflags flags) {
+  const AVRMEM *fz = avr_locate_fuses(p);
+  AVRMEM *all = avr_dup_mem(fz);
+  int retval = LIBAVRDUDE_GENERAL_FAILURE, nchg = 0, *sizes = mmt_malloc(n*sizeof *sizes);
+  Filestats fs;
+
+  pmsg_info("reading %s to update %d fuse%s in one go ...\n", avr_mem_name(p, fz), n, str_plural(n));
+  int span = avr_span_begin("read", avr_mem_name(p, fz));
+  int rc = avr_read_mem(pgm, p, all, NULL);
+
+  avr_span_end(span, rc < 0? 0: rc);
+  if(rc < 0) {
+    pmsg_error("unable to read %s (rc = %d)\n", avr_mem_name(p, fz), rc);
+    goto error;
+  }
+  memset(all->tags, 0, tag_bytes(all->size));
+
+  for(int i = 0; i < n; i++) {
+    const AVRMEM *m = avr_locate_mem(p, upds[i]->memstr);
+    const char *m_name = avr_mem_name(p, m);
+    int off = m->offset - fz->offset;
+
+    if(!(flags & UF_NOHEADING)) {
+      char *heading = update_str(upds[i]);
+
+      lmsg_info("\n");
+      pmsg_info("processing %s\n", heading);
+      mmt_free(heading);
+    }
+    if((sizes[i] = update_all_from_file(upds[i], pgm, p, m, m_name, &fs)) < 0)
+      goto error;
+    for(int k = 0; k < sizes[i]; k++)
+      if(tag_isset(m->tags, k) && all->buf[off + k] != m->buf[k]) {
+        all->buf[off + k] = m->buf[k];
+        tag_set(all->tags, off + k);
+      }
+  }
+  for(int k = 0; k < all->size; k++)
+    nchg += tag_isset(all->tags, k);
+
+  lmsg_info("\n");
+  if(!nchg) {
+    pmsg_info("all %d fuse%s already hold the requested values\n", n, str_plural(n));
+    retval = LIBAVRDUDE_SUCCESS;
+    goto error;
+  }
+
+  // A contiguous block rewrites bytes in between with what the device holds
+  int lo = 0, hi = all->size;
+
+  while(!tag_isset(all->tags, lo))
+    lo++;
+  while(!tag_isset(all->tags, hi - 1))
+    hi--;
+  if(pgm->range_write)
+    for(int k = lo; k < hi; k++)
+      tag_set(all->tags, k);
+
+  pmsg_info("writing %d changed fuse byte%s to %s", nchg, str_plural(nchg), avr_mem_name(p, fz));
+  span = avr_span_begin("write", avr_mem_name(p, fz));
+  rc = avr_write_mem(pgm, p, all, hi, 0);
+  avr_span_end(span, rc < 0? 0: nchg);
+  if(rc < 0) {
+    msg_info("\n");
+    pmsg_error("unable to write %s (rc = %d)\n", avr_mem_name(p, fz), rc);
+    goto error;
+  }
+  msg_info(", %d byte%s written", nchg, str_plural(nchg));
+
+  if(flags & UF_VERIFY) {
+    span = avr_span_begin("verify", avr_mem_name(p, fz));
+    led_set(pgm, LED_VFY);
+    rc = avr_read_mem(pgm, p, all, NULL);
+    for(int i = 0; rc >= 0 && i < n; i++) {
+      AVRMEM *m = avr_locate_mem(p, upds[i]->memstr);
+      AVRPART *v = avr_dup_part_mem(p, m);  // Input data for comparison
+
+      memcpy(m->buf, all->buf + (m->offset - fz->offset), m->size);
+      if(avr_verify_mem(pgm, p, v, m, sizes[i]) < 0) {
+        pmsg_error("%s verification mismatch\n", m->desc);
+        rc = -1;
+      }
+      avr_free_part(v);
+    }
+    led_clr(pgm, LED_VFY);
+    avr_span_end(span, rc < 0? 0: n);
+    if(rc < 0) {
+      led_set(pgm, LED_ERR);
+      goto error;
+    }
+    msg_info(", %d verified", nchg);
+  }
+  msg_info("\n");
+  retval = LIBAVRDUDE_SUCCESS;
+
+error:
+  avr_free_mem(all);
+  mmt_free(sizes);
+  return retval;
+}
@@ -79,6 +79,9 @@
 #define UPDI_ASI_SYS_STATUS 0x0B
 #define UPDI_ASI_CRC_STATUS 0x0C
 
+#define UPDI_ASI_CTRLA_UPDICLKSEL_16MHZ 0x01
+#define UPDI_ASI_CTRLA_MAX_4MHZ_BAUD    225000  // Highest baud rate for the default 4 MHz UPDI clock
+
 #define UPDI_CTRLA_IBDLY_BIT    7
 #define UPDI_CTRLB_CCDETDIS_BIT 3
 #define UPDI_CTRLB_UPDIDIS_BIT  2
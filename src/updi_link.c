@@ -143,9 +143,11 @@ static int updi_physical_send_double_break(const PROGRAMMER *pgm) {
 
   serial_drain(&pgm->fd, 0);
 
+  // A double break resets the UPDI clock, so restart from the -b baud rate
   if(serial_setparams(&pgm->fd, pgm->baudrate? pgm->baudrate: 115200, SERIAL_8E2) < 0) {
     return -1;
   }
+  updi_set_baud(pgm, pgm->baudrate? pgm->baudrate: 115200);
 
   updi_set_rtsdtr_mode(pgm);
 
@@ -185,6 +187,7 @@ int updi_link_open(PROGRAMMER *pgm) {
   if(updi_physical_open(pgm, pgm->baudrate? pgm->baudrate: 115200, SERIAL_8E2) < 0) {
     return -1;
   }
+  updi_set_baud(pgm, pgm->baudrate? pgm->baudrate: 115200);
 
   init_buffer[0] = UPDI_BREAK;
   return updi_physical_send(pgm, init_buffer, 1);
@@ -286,6 +289,19 @@ int updi_link_init(const PROGRAMMER *pgm) {
   return 0;
 }
 
+// Switch the host to a new baud rate and check the link with a round trip
+int updi_link_set_baud(const PROGRAMMER *pgm, int baud) {
+  pmsg_debug("switching UPDI link to %d baud\n", baud);
+  if(serial_setparams(&pgm->fd, baud, SERIAL_8E2) < 0) {
+    return -1;
+  }
+  updi_set_baud(pgm, baud);
+  updi_set_rtsdtr_mode(pgm);
+  serial_drain(&pgm->fd, 0);
+
+  return updi_link_check(pgm);
+}
+
 int updi_link_ldcs(const PROGRAMMER *pgm, uint8_t address, uint8_t *value) {
 /*
     def ldcs(self, address):
@@ -346,6 +362,34 @@ int updi_link_stcs(const PROGRAMMER *pgm, uint8_t address, uint8_t value) {
   return updi_physical_send(pgm, buffer, 3);
 }
 
+// STCS of value to st_address immediately followed by an LDCS from ld_address in one transfer
+int updi_link_stcs_ldcs(const PROGRAMMER *pgm, uint8_t st_address, uint8_t value, uint8_t ld_address,
+  uint8_t *result) {
+
+  unsigned char buffer[5];
+  int rc;
+
+  pmsg_debug("STCS 0x%02X to address 0x%02X, LDCS from 0x%02X\n", value, st_address, ld_address);
+  buffer[0] = UPDI_PHY_SYNC;
+  buffer[1] = UPDI_STCS | (st_address & 0x0F);
+  buffer[2] = value;
+  buffer[3] = UPDI_PHY_SYNC;
+  buffer[4] = UPDI_LDCS | (ld_address & 0x0F);
+  if(updi_physical_send(pgm, buffer, 5) < 0) {
+    pmsg_debug("STCS/LDCS send operation failed\n");
+    return -1;
+  }
+  rc = updi_physical_recv(pgm, buffer, 1);
+  if(rc != 1) {
+    if(rc >= 0) {
+      pmsg_debug("incorrect response size, received %d instead of %d bytes\n", rc, 1);
+    }
+    return -1;
+  }
+  *result = buffer[0];
+  return 0;
+}
+
 int updi_link_ld_ptr_inc(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size) {
 /*
     def ld_ptr_inc(self, size):
@@ -395,7 +439,7 @@ int updi_link_ld_ptr_inc16(const PROGRAMMER *pgm, unsigned char *buffer, uint16_
     pmsg_debug("LD_PTR_INC send operation failed\n");
     return -1;
   }
-  return updi_physical_recv(pgm, buffer, words << 2);
+  return updi_physical_recv(pgm, buffer, words << 1);
 }
 
 int updi_link_st_ptr_inc(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size) {
@@ -626,6 +670,53 @@ int updi_link_st_ptr_inc16_RSD(const PROGRAMMER *pgm, unsigned char *buffer, uin
   return 0;
 }
 
+/*
+ * Store many 16-bit words to *ptr++ keeping RSD (response signature disable)
+ * on throughout: one STCS, then a REPEAT + ST ptr++ block per chunk of at
+ * most UPDI_MAX_REPEAT_SIZE words, then the STCS that re-enables responses,
+ * all in a single send. The pointer keeps incrementing across blocks, so a
+ * multi-page run only needs one ST_PTR in front of it.
+ */
+int updi_link_st_ptr_inc16_RSD_stream(const PROGRAMMER *pgm, unsigned char *buffer, uint32_t words) {
+  pmsg_debug("ST16 to *ptr++ with RSD across blocks, data length: 0x%05X\n", (unsigned) words*2);
+
+  if(!words)
+    return 0;
+
+  unsigned int nblocks = (words + UPDI_MAX_REPEAT_SIZE - 1)/UPDI_MAX_REPEAT_SIZE;
+  unsigned int temp_buffer_size = 3 + nblocks*(3 + 2) + words*2 + 3;
+  unsigned char *temp_buffer = mmt_malloc(temp_buffer_size), *q = temp_buffer;
+
+  *q++ = UPDI_PHY_SYNC;
+  *q++ = UPDI_STCS | UPDI_CS_CTRLA;
+  *q++ = 0x0E;
+  while(words) {
+    uint32_t n = words > UPDI_MAX_REPEAT_SIZE? UPDI_MAX_REPEAT_SIZE: words;
+
+    *q++ = UPDI_PHY_SYNC;
+    *q++ = UPDI_REPEAT | UPDI_REPEAT_BYTE;
+    *q++ = (n - 1) & 0xFF;
+    *q++ = UPDI_PHY_SYNC;
+    *q++ = UPDI_ST | UPDI_PTR_INC | UPDI_DATA_16;
+    memcpy(q, buffer, n*2);
+    q += n*2;
+    buffer += n*2;
+    words -= n;
+  }
+  *q++ = UPDI_PHY_SYNC;
+  *q++ = UPDI_STCS | UPDI_CS_CTRLA;
+  *q++ = 0x06;
+
+  int rc = updi_physical_send(pgm, temp_buffer, temp_buffer_size);
+
+  mmt_free(temp_buffer);
+  if(rc < 0) {
+    pmsg_debug("unable to send package\n");
+    return -1;
+  }
+  return 0;
+}
+
 int updi_link_repeat(const PROGRAMMER *pgm, uint16_t repeats) {
 /*
     def repeat(self, repeats):
@@ -682,26 +773,42 @@ int updi_link_key(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_typ
         self.updi_phy.send([constants.UPDI_PHY_SYNC, constants.UPDI_KEY | constants.UPDI_KEY_KEY | size])
         self.updi_phy.send(list(reversed(list(key))))
 */
-  unsigned char send_buffer[2];
-  unsigned char reversed_key[256];
-  int index;
+  return updi_link_key_stcs(pgm, buffer, size_type, size, 0, 0, 0);
+}
+
+/*
+ * Sends the KEY instruction, the reversed key and, if stcs is set, an STCS
+ * of value to address in one transfer; as neither KEY nor STCS is answered
+ * by the device this saves the echo round trips in between
+ */
+int updi_link_key_stcs(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size,
+  int stcs, uint8_t address, uint8_t value) {
+
+  unsigned char send_buffer[2 + 256 + 3];
+  int index, len = 0;
 
   pmsg_debug("UPDI writing key\n");
-  if(size != (8 << size_type)) {
+  if(size != (8 << size_type) || size > 256) {
     pmsg_debug("invalid key length\n");
     return -1;
   }
-  send_buffer[0] = UPDI_PHY_SYNC;
-  send_buffer[1] = UPDI_KEY | UPDI_KEY_KEY | size_type;
-  if(updi_physical_send(pgm, send_buffer, 2) < 0) {
-    pmsg_debug("UPDI key send message failed\n");
-    return -1;
-  }
+  send_buffer[len++] = UPDI_PHY_SYNC;
+  send_buffer[len++] = UPDI_KEY | UPDI_KEY_KEY | size_type;
   // Reverse key contents
   for(index = 0; index < size; index++) {
-    reversed_key[index] = buffer[size - index - 1];
+    send_buffer[len++] = buffer[size - index - 1];
   }
-  return updi_physical_send(pgm, reversed_key, size);
+  if(stcs) {
+    pmsg_debug("STCS 0x%02X to address 0x%02X\n", value, address);
+    send_buffer[len++] = UPDI_PHY_SYNC;
+    send_buffer[len++] = UPDI_STCS | (address & 0x0F);
+    send_buffer[len++] = value;
+  }
+  if(updi_physical_send(pgm, send_buffer, len) < 0) {
+    pmsg_debug("UPDI key send message failed\n");
+    return -1;
+  }
+  return 0;
 }
 
 int updi_link_ld(const PROGRAMMER *pgm, uint32_t address, uint8_t *value) {
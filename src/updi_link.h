@@ -34,16 +34,22 @@ extern "C" {
   int updi_link_open(PROGRAMMER *pgm);
   void updi_link_close(PROGRAMMER *pgm);
   int updi_link_init(const PROGRAMMER *pgm);
+  int updi_link_set_baud(const PROGRAMMER *pgm, int baud);
   int updi_link_ldcs(const PROGRAMMER *pgm, uint8_t address, uint8_t *value);
   int updi_link_stcs(const PROGRAMMER *pgm, uint8_t address, uint8_t value);
+  int updi_link_stcs_ldcs(const PROGRAMMER *pgm, uint8_t st_address, uint8_t value, uint8_t ld_address,
+    uint8_t *result);
   int updi_link_ld_ptr_inc(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size);
   int updi_link_ld_ptr_inc16(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t words);
   int updi_link_st_ptr_inc(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size);
   int updi_link_st_ptr_inc16(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t words);
   int updi_link_st_ptr_inc16_RSD(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t words, int blocksize);
+  int updi_link_st_ptr_inc16_RSD_stream(const PROGRAMMER *pgm, unsigned char *buffer, uint32_t words);
   int updi_link_repeat(const PROGRAMMER *pgm, uint16_t repeats);
   int updi_link_read_sib(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size);
   int updi_link_key(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size);
+  int updi_link_key_stcs(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size,
+    int stcs, uint8_t address, uint8_t value);
   int updi_link_ld(const PROGRAMMER *pgm, uint32_t address, uint8_t *value);
   int updi_link_ld16(const PROGRAMMER *pgm, uint32_t address, uint16_t *value);
   int updi_link_st(const PROGRAMMER *pgm, uint32_t address, uint8_t value);
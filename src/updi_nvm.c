@@ -42,230 +42,312 @@
 #include "updi_nvm_v6.h"
 #include "updi_state.h"
 
-int updi_nvm_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
+#include "updi_readwrite.h"
+
+// Map the NVM mode decoded from the SIB to its controller description once per session
+int updi_nvm_resolve(const PROGRAMMER *pgm) {
+  const updi_nvm_ctrl *ctrl;
+
   switch(updi_get_nvm_mode(pgm)) {
   case UPDI_NVM_MODE_V0:
-    return updi_nvm_chip_erase_V0(pgm, p);
+    ctrl = &updi_nvm_ctrl_V0;
+    break;
   case UPDI_NVM_MODE_V2:
-    return updi_nvm_chip_erase_V2(pgm, p);
+    ctrl = &updi_nvm_ctrl_V2;
+    break;
   case UPDI_NVM_MODE_V3:
-    return updi_nvm_chip_erase_V3(pgm, p);
+    ctrl = &updi_nvm_ctrl_V3;
+    break;
   case UPDI_NVM_MODE_V4:
-    return updi_nvm_chip_erase_V4(pgm, p);
+    ctrl = &updi_nvm_ctrl_V4;
+    break;
   case UPDI_NVM_MODE_V5:
-    return updi_nvm_chip_erase_V5(pgm, p);
+    ctrl = &updi_nvm_ctrl_V5;
+    break;
   case UPDI_NVM_MODE_V6:
-    return updi_nvm_chip_erase_V6(pgm, p);
+    ctrl = &updi_nvm_ctrl_V6;
+    break;
   default:
     pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
+    updi_set_nvm_ctrl(pgm, NULL);
     return -1;
   }
+  pmsg_debug("using NVM controller %s\n", ctrl->name);
+  updi_set_nvm_ctrl(pgm, ctrl);
+  return 0;
+}
+
+static const updi_nvm_ctrl *nvm_ctrl(const PROGRAMMER *pgm) {
+  if(!updi_get_nvm_ctrl(pgm))
+    updi_nvm_resolve(pgm);
+  return updi_get_nvm_ctrl(pgm);
+}
+
+static int nvm_wait_ready(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl) {
+  unsigned long start_time;
+  unsigned long current_time;
+  uint8_t status;
+
+  start_time = avr_ustimestamp();
+  do {
+    if(updi_read_byte(pgm, p->nvm_base + ctrl->status, &status) >= 0) {
+      if(status & ctrl->error_mask) {
+        pmsg_error("unable to write NVM status, error code %d\n", (status & ctrl->error_mask) >> ctrl->error_shift);
+        return -1;
+      }
+      if(!(status & ctrl->busy_mask)) {
+        return 0;
+      }
+    }
+    current_time = avr_ustimestamp();
+  } while((current_time - start_time) < 10000000);
+
+  pmsg_error("wait NVM ready timed out\n");
+  return -1;
+}
+
+int updi_nvm_ctrl_wait_ready(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl) {
+  int span = avr_span_detail("NVM wait ready", NULL);
+  int rc = nvm_wait_ready(pgm, p, ctrl);
+
+  avr_span_end(span, -1);
+  return rc;
+}
+
+int updi_nvm_ctrl_command(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl,
+  uint8_t command) {
+
+  pmsg_debug("NVMCMD %d executing\n", command);
+
+  return updi_write_byte(pgm, p->nvm_base + ctrl->ctrla, command);
+}
+
+int updi_nvm_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->chip_erase(pgm, p): -1;
 }
 
 int updi_nvm_erase_flash_page(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_erase_flash_page_V0(pgm, p, address);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_erase_flash_page_V2(pgm, p, address);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_erase_flash_page_V3(pgm, p, address);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_erase_flash_page_V4(pgm, p, address);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_erase_flash_page_V5(pgm, p, address);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_erase_flash_page_V6(pgm, p, address);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->erase_flash_page(pgm, p, address): -1;
 }
 
 int updi_nvm_erase_eeprom(const PROGRAMMER *pgm, const AVRPART *p) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_erase_eeprom_V0(pgm, p);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_erase_eeprom_V2(pgm, p);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_erase_eeprom_V3(pgm, p);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_erase_eeprom_V4(pgm, p);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_erase_eeprom_V5(pgm, p);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_erase_eeprom_V6(pgm, p);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->erase_eeprom(pgm, p): -1;
+}
+
+int updi_nvm_erase_user_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint16_t size) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->erase_user_row(pgm, p, address, size): -1;
+}
+
+int updi_nvm_write_flash(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+  unsigned char *buffer, uint16_t size) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->write_flash(pgm, p, address, buffer, size): -1;
+}
+
+// Clear, load and commit each page of a page buffer controller with the given commit command
+static int nvm_write_buffered_pages(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl,
+  uint32_t address, unsigned char *buffer, uint32_t size, uint16_t page_size, uint8_t commit) {
+
+  int status;
+
+  while(size) {
+    uint16_t chunk = size > page_size? page_size: size;
+
+    if(updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_page_buffer_clear) < 0) {
+      pmsg_error("clear page operation failed\n");
+      return -1;
+    }
+    if(updi_nvm_ctrl_wait_ready(pgm, p, ctrl) < 0) {
+      pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
+      return -1;
+    }
+    if(updi_write_data_words(pgm, address, buffer, chunk) < 0) {
+      pmsg_error("write data words operation failed\n");
+      return -1;
+    }
+    if(updi_nvm_ctrl_command(pgm, p, ctrl, commit) < 0) {
+      pmsg_error("commit data command failed\n");
+      return -1;
+    }
+    status = updi_nvm_ctrl_wait_ready(pgm, p, ctrl);
+    if(ctrl->clear_command && updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_nocmd) < 0) {
+      pmsg_error("command buffer erase failed\n");
+      return -1;
+    }
+    if(status < 0) {
+      pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
+      return -1;
+    }
+    address += chunk;
+    buffer += chunk;
+    size -= chunk;
+  }
+  return 0;
+}
+
+/*
+ * Writes size bytes of consecutive flash pages of page_size each. Without
+ * a page buffer the flash write command stays active for the whole run and
+ * the data go out as one RSD stream, polling only before and after. With a
+ * page buffer each page is cleared, loaded and committed, but the ready
+ * poll after one commit doubles as the poll before the next clear.
+ */
+int updi_nvm_write_flash_pages(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+  unsigned char *buffer, uint32_t size, uint16_t page_size) {
+
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+  int status;
+
+  if(!ctrl)
+    return -1;
+  if(updi_nvm_ctrl_wait_ready(pgm, p, ctrl) < 0) {
+    pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
     return -1;
   }
+
+  if(!ctrl->page_buffer) {
+    pmsg_debug("NVM write command\n");
+    if(updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_flash_write) < 0) {
+      pmsg_error("flash write command failed\n");
+      return -1;
+    }
+    if(updi_write_data_words_stream(pgm, address, buffer, size) < 0) {
+      pmsg_error("write data words operation failed\n");
+      updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_nocmd);
+      return -1;
+    }
+    status = updi_nvm_ctrl_wait_ready(pgm, p, ctrl);
+    pmsg_debug("clear NVM command\n");
+    if(updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_nocmd) < 0) {
+      pmsg_error("command buffer erase failed\n");
+      return -1;
+    }
+    if(status < 0) {
+      pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
+      return -1;
+    }
+    return 0;
+  }
+
+  return nvm_write_buffered_pages(pgm, p, ctrl, address, buffer, size, page_size, ctrl->cmd_flash_write);
 }
 
-int updi_nvm_erase_user_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint16_t size) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_erase_user_row_V0(pgm, p, address, size);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_erase_user_row_V2(pgm, p, address, size);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_erase_user_row_V3(pgm, p, address, size);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_erase_user_row_V4(pgm, p, address, size);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_erase_user_row_V5(pgm, p, address, size);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_erase_user_row_V6(pgm, p, address, size);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
+/*
+ * Writes the nr flash ranges r[] of buffer, which is mapped to address
+ * offset; NVM controllers without page buffer enter flash write mode only
+ * once for all ranges, the others write them page by page
+ */
+int updi_nvm_write_flash_ranges(const PROGRAMMER *pgm, const AVRPART *p, uint32_t offset,
+  unsigned char *buffer, const Avr_range *r, int nr, uint16_t page_size) {
+
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+  int status;
+
+  if(!ctrl)
+    return -1;
+  if(ctrl->page_buffer) {
+    for(int i = 0; i < nr; i++)
+      if(updi_nvm_write_flash_pages(pgm, p, offset + r[i].addr, buffer + r[i].addr, r[i].n, page_size) < 0)
+        return -1;
+    return 0;
+  }
+
+  if(updi_nvm_ctrl_wait_ready(pgm, p, ctrl) < 0) {
+    pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
+    return -1;
+  }
+  pmsg_debug("NVM write command\n");
+  if(updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_flash_write) < 0) {
+    pmsg_error("flash write command failed\n");
+    return -1;
+  }
+  for(int i = 0; i < nr; i++)
+    if(updi_write_data_words_stream(pgm, offset + r[i].addr, buffer + r[i].addr, r[i].n) < 0) {
+      pmsg_error("write data words operation failed\n");
+      updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_nocmd);
+      return -1;
+    }
+  status = updi_nvm_ctrl_wait_ready(pgm, p, ctrl);
+  pmsg_debug("clear NVM command\n");
+  if(updi_nvm_ctrl_command(pgm, p, ctrl, ctrl->cmd_nocmd) < 0) {
+    pmsg_error("command buffer erase failed\n");
     return -1;
   }
+  if(status < 0) {
+    pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
+    return -1;
+  }
+
+  return 0;
 }
 
-int updi_nvm_write_flash(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
-  unsigned char *buffer, uint16_t size) {
+/*
+ * Erases and writes consecutive flash pages with one erase-write page
+ * command each, so partial updates need neither chip erase nor a separate
+ * page erase command per page; returns -2 if the NVM controller has no such
+ * command (the NVM variants without page buffer erase pages separately)
+ */
+int updi_nvm_erase_write_flash_pages(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+  unsigned char *buffer, uint32_t size, uint16_t page_size) {
 
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_write_flash_V0(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_write_flash_V2(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_write_flash_V3(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_write_flash_V4(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_write_flash_V5(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_write_flash_V6(pgm, p, address, buffer, size);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  if(!ctrl)
+    return -1;
+  if(!ctrl->page_buffer || ctrl->cmd_flash_erase_write == ctrl->cmd_nocmd)
+    return -2;
+  if(updi_nvm_ctrl_wait_ready(pgm, p, ctrl) < 0) {
+    pmsg_error("updi_nvm_ctrl_wait_ready() failed\n");
     return -1;
   }
+
+  return nvm_write_buffered_pages(pgm, p, ctrl, address, buffer, size, page_size, ctrl->cmd_flash_erase_write);
 }
 
 int updi_nvm_write_user_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
   unsigned char *buffer, uint16_t size) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
 
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_write_user_row_V0(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_write_user_row_V2(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_write_user_row_V3(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_write_user_row_V4(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_write_user_row_V5(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_write_user_row_V6(pgm, p, address, buffer, size);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  return ctrl? ctrl->write_user_row(pgm, p, address, buffer, size): -1;
 }
 
 int updi_nvm_write_boot_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
   unsigned char *buffer, uint16_t size) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
 
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_write_boot_row_V0(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_write_boot_row_V2(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_write_boot_row_V3(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_write_boot_row_V4(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_write_boot_row_V5(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_write_boot_row_V6(pgm, p, address, buffer, size);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  return ctrl? ctrl->write_boot_row(pgm, p, address, buffer, size): -1;
 }
 
 int updi_nvm_write_eeprom(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
   unsigned char *buffer, uint16_t size) {
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
 
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_write_eeprom_V0(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_write_eeprom_V2(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_write_eeprom_V3(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_write_eeprom_V4(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_write_eeprom_V5(pgm, p, address, buffer, size);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_write_eeprom_V6(pgm, p, address, buffer, size);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  return ctrl? ctrl->write_eeprom(pgm, p, address, buffer, size): -1;
 }
 
 int updi_nvm_write_fuse(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint8_t value) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_write_fuse_V0(pgm, p, address, value);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_write_fuse_V2(pgm, p, address, value);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_write_fuse_V3(pgm, p, address, value);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_write_fuse_V4(pgm, p, address, value);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_write_fuse_V5(pgm, p, address, value);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_write_fuse_V6(pgm, p, address, value);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? ctrl->write_fuse(pgm, p, address, value): -1;
 }
 
 int updi_nvm_wait_ready(const PROGRAMMER *pgm, const AVRPART *p) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_wait_ready_V0(pgm, p);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_wait_ready_V2(pgm, p);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_wait_ready_V3(pgm, p);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_wait_ready_V4(pgm, p);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_wait_ready_V5(pgm, p);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_wait_ready_V6(pgm, p);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? updi_nvm_ctrl_wait_ready(pgm, p, ctrl): -1;
 }
 
 int updi_nvm_command(const PROGRAMMER *pgm, const AVRPART *p, uint8_t command) {
-  switch(updi_get_nvm_mode(pgm)) {
-  case UPDI_NVM_MODE_V0:
-    return updi_nvm_command_V0(pgm, p, command);
-  case UPDI_NVM_MODE_V2:
-    return updi_nvm_command_V2(pgm, p, command);
-  case UPDI_NVM_MODE_V3:
-    return updi_nvm_command_V3(pgm, p, command);
-  case UPDI_NVM_MODE_V4:
-    return updi_nvm_command_V4(pgm, p, command);
-  case UPDI_NVM_MODE_V5:
-    return updi_nvm_command_V5(pgm, p, command);
-  case UPDI_NVM_MODE_V6:
-    return updi_nvm_command_V6(pgm, p, command);
-  default:
-    pmsg_error("invalid NVM Mode %d\n", updi_get_nvm_mode(pgm));
-    return -1;
-  }
+  const updi_nvm_ctrl *ctrl = nvm_ctrl(pgm);
+
+  return ctrl? updi_nvm_ctrl_command(pgm, p, ctrl, command): -1;
 }
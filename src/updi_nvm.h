@@ -27,16 +27,56 @@
 
 #include "libavrdude.h"
 
+/*
+ * Description of one generation of UPDI NVM controller: register layout,
+ * status bits, the commands the generic flash writer needs and the
+ * generation-specific operations; resolved once per session from the SIB
+ */
+typedef struct updi_nvm_ctrl {
+  const char *name;
+  uint8_t ctrla, status;        // Register offsets from p->nvm_base
+  uint8_t error_mask, error_shift, busy_mask; // STATUS bits
+  int page_buffer;              // Flash is written via a page buffer that needs clear and commit
+  int clear_command;            // Commands stay active until NOCMD is written
+  uint8_t cmd_nocmd, cmd_page_buffer_clear, cmd_flash_write;
+  uint8_t cmd_flash_erase_write; // Page buffer commit that erases the page first, cmd_nocmd if none
+
+  int (*chip_erase)(const PROGRAMMER *pgm, const AVRPART *p);
+  int (*erase_flash_page)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address);
+  int (*erase_eeprom)(const PROGRAMMER *pgm, const AVRPART *p);
+  int (*erase_user_row)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint16_t size);
+  int (*write_flash)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint16_t size);
+  int (*write_user_row)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint16_t size);
+  int (*write_boot_row)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint16_t size);
+  int (*write_eeprom)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint16_t size);
+  int (*write_fuse)(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint8_t value);
+} updi_nvm_ctrl;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+  int updi_nvm_resolve(const PROGRAMMER *pgm);
+  int updi_nvm_ctrl_wait_ready(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl);
+  int updi_nvm_ctrl_command(const PROGRAMMER *pgm, const AVRPART *p, const updi_nvm_ctrl *ctrl,
+    uint8_t command);
+
   int updi_nvm_chip_erase(const PROGRAMMER *pgm, const AVRPART *p);
   int updi_nvm_erase_flash_page(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address);
   int updi_nvm_erase_eeprom(const PROGRAMMER *pgm, const AVRPART *p);
   int updi_nvm_erase_user_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address, uint16_t size);
   int updi_nvm_write_flash(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
     unsigned char *buffer, uint16_t size);
+  int updi_nvm_write_flash_pages(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint32_t size, uint16_t page_size);
+  int updi_nvm_write_flash_ranges(const PROGRAMMER *pgm, const AVRPART *p, uint32_t offset,
+    unsigned char *buffer, const Avr_range *r, int nr, uint16_t page_size);
+  int updi_nvm_erase_write_flash_pages(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
+    unsigned char *buffer, uint32_t size, uint16_t page_size);
   int updi_nvm_write_user_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
     unsigned char *buffer, uint16_t size);
   int updi_nvm_write_boot_row(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
@@ -269,6 +269,7 @@ int updi_nvm_write_flash_V4(const PROGRAMMER *pgm, const AVRPART *p, uint32_t ad
   return nvm_write_V4(pgm, p, address, buffer, size, USE_WORD_ACCESS);
 }
 
+
 int updi_nvm_write_user_row_V4(const PROGRAMMER *pgm, const AVRPART *p, uint32_t address,
   unsigned char *buffer, uint16_t size) {
 /*
@@ -477,26 +478,7 @@ int updi_nvm_wait_ready_V4(const PROGRAMMER *pgm, const AVRPART *p) {
         self.logger.error("Wait NVM ready timed out")
         return False
 */
-  unsigned long start_time;
-  unsigned long current_time;
-  uint8_t status;
-
-  start_time = avr_ustimestamp();
-  do {
-    if(updi_read_byte(pgm, p->nvm_base + UPDI_V4_NVMCTRL_STATUS, &status) >= 0) {
-      if(status & UPDI_V4_NVM_STATUS_WRITE_ERROR_MASK) {
-        pmsg_error("unable to write NVM status, error %d\n", status >> UPDI_V4_NVM_STATUS_WRITE_ERROR_BIT);
-        return -1;
-      }
-      if(!(status & ((1 << UPDI_V4_NVM_STATUS_EEPROM_BUSY_BIT) | (1 << UPDI_V4_NVM_STATUS_FLASH_BUSY_BIT)))) {
-        return 0;
-      }
-    }
-    current_time = avr_ustimestamp();
-  } while((current_time - start_time) < 10000000);
-
-  pmsg_error("wait NVM ready timed out\n");
-  return -1;
+  return updi_nvm_ctrl_wait_ready(pgm, p, &updi_nvm_ctrl_V4);
 }
 
 int updi_nvm_command_V4(const PROGRAMMER *pgm, const AVRPART *p, uint8_t command) {
@@ -510,7 +492,29 @@ int updi_nvm_command_V4(const PROGRAMMER *pgm, const AVRPART *p, uint8_t command
         self.logger.debug("NVMCMD %d executing", command)
         return self.readwrite.write_byte(self.device.nvmctrl_address + constants.UPDI_NVMCTRL_CTRLA, command)
 */
-  pmsg_debug("NVMCMD %d executing\n", command);
-
-  return updi_write_byte(pgm, p->nvm_base + UPDI_V4_NVMCTRL_CTRLA, command);
+  return updi_nvm_ctrl_command(pgm, p, &updi_nvm_ctrl_V4, command);
 }
+
+const updi_nvm_ctrl updi_nvm_ctrl_V4 = {
+  .name = "V4",
+  .ctrla = UPDI_V4_NVMCTRL_CTRLA,
+  .status = UPDI_V4_NVMCTRL_STATUS,
+  .error_mask = UPDI_V4_NVM_STATUS_WRITE_ERROR_MASK,
+  .error_shift = UPDI_V4_NVM_STATUS_WRITE_ERROR_BIT,
+  .busy_mask = (1 << UPDI_V4_NVM_STATUS_EEPROM_BUSY_BIT) | (1 << UPDI_V4_NVM_STATUS_FLASH_BUSY_BIT),
+  .page_buffer = 0,
+  .clear_command = 1,
+  .cmd_nocmd = UPDI_V4_NVMCTRL_CTRLA_NOCMD,
+  .cmd_page_buffer_clear = 0,
+  .cmd_flash_write = UPDI_V4_NVMCTRL_CTRLA_FLASH_WRITE,
+  .cmd_flash_erase_write = UPDI_V4_NVMCTRL_CTRLA_NOCMD,
+  .chip_erase = updi_nvm_chip_erase_V4,
+  .erase_flash_page = updi_nvm_erase_flash_page_V4,
+  .erase_eeprom = updi_nvm_erase_eeprom_V4,
+  .erase_user_row = updi_nvm_erase_user_row_V4,
+  .write_flash = updi_nvm_write_flash_V4,
+  .write_user_row = updi_nvm_write_user_row_V4,
+  .write_boot_row = updi_nvm_write_boot_row_V4,
+  .write_eeprom = updi_nvm_write_eeprom_V4,
+  .write_fuse = updi_nvm_write_fuse_V4,
+};
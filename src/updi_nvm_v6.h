@@ -26,6 +26,7 @@
 #define updi_nvm_v6_h
 
 #include "libavrdude.h"
+#include "updi_nvm.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,8 @@ extern "C" {
   int updi_nvm_wait_ready_V6(const PROGRAMMER *pgm, const AVRPART *p);
   int updi_nvm_command_V6(const PROGRAMMER *pgm, const AVRPART *p, uint8_t command);
 
+  extern const updi_nvm_ctrl updi_nvm_ctrl_V6;
+
 #ifdef __cplusplus
 }
 #endif
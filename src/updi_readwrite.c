@@ -79,6 +79,17 @@ int updi_write_key(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_ty
   return updi_link_key(pgm, buffer, size_type, size);
 }
 
+// Write a KEY and apply reset in the same transfer
+int updi_write_key_reset(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size) {
+  return updi_link_key_stcs(pgm, buffer, size_type, size, 1, UPDI_ASI_RESET_REQ, UPDI_RESET_REQ_VALUE);
+}
+
+// Write to one Control/Status register and read another in the same transfer
+int updi_write_read_cs(const PROGRAMMER *pgm, uint8_t st_address, uint8_t value, uint8_t ld_address,
+  uint8_t *result) {
+  return updi_link_stcs_ldcs(pgm, st_address, value, ld_address, result);
+}
+
 int updi_read_sib(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size) {
 /*
     def read_sib(self):
@@ -165,6 +176,43 @@ int updi_read_data(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uin
   return updi_link_ld_ptr_inc(pgm, buffer, size);
 }
 
+/*
+ * Reads size bytes from address on with a single ST_PTR followed by one
+ * REPEAT + LD ptr++ per block of up to chunk bytes; even blocks at even
+ * addresses use 16-bit loads so that one REPEAT covers up to 512 bytes
+ */
+int updi_read_data_bulk(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint32_t size,
+  uint16_t chunk) {
+
+  pmsg_debug("bulk reading %u bytes from 0x%06X in blocks of %u\n", (unsigned) size, address, chunk);
+
+  if(chunk < 1 || chunk > UPDI_MAX_REPEAT_SIZE << 1) {
+    pmsg_debug("invalid block size %u\n", chunk);
+    return -1;
+  }
+  if(updi_link_st_ptr(pgm, address) < 0) {
+    pmsg_debug("ST_PTR operation failed\n");
+    return -1;
+  }
+  for(uint32_t done = 0; done < size; ) {
+    uint16_t n = size - done > chunk? chunk: size - done;
+    int words = (address + done) % 2 == 0 && n % 2 == 0;
+
+    if(!words && n > UPDI_MAX_REPEAT_SIZE)
+      n = UPDI_MAX_REPEAT_SIZE;
+    if(n > (words? 2: 1) && updi_link_repeat(pgm, words? n/2: n) < 0) {
+      pmsg_debug("repeat operation failed\n");
+      return -1;
+    }
+    if((words? updi_link_ld_ptr_inc16(pgm, buffer + done, n/2): updi_link_ld_ptr_inc(pgm, buffer + done, n)) < 0) {
+      pmsg_debug("LD_PTR_INC operation failed\n");
+      return -1;
+    }
+    done += n;
+  }
+  return size;
+}
+
 int updi_write_data(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint16_t size) {
 /*
     def write_data(self, address, data):
@@ -302,3 +350,14 @@ int updi_write_data_words(const PROGRAMMER *pgm, uint32_t address, uint8_t *buff
   }
   return updi_link_st_ptr_inc16_RSD(pgm, buffer, size >> 1, -1);
 }
+
+// Writes size bytes as words from address on, possibly spanning several REPEAT blocks
+int updi_write_data_words_stream(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint32_t size) {
+  if(size <= UPDI_MAX_REPEAT_SIZE << 1)
+    return updi_write_data_words(pgm, address, buffer, size);
+  if(updi_link_st_ptr(pgm, address) < 0) {
+    pmsg_debug("ST_PTR operation failed\n");
+    return -1;
+  }
+  return updi_link_st_ptr_inc16_RSD_stream(pgm, buffer, size >> 1);
+}
@@ -34,13 +34,19 @@ extern "C" {
   int updi_read_cs(const PROGRAMMER *pgm, uint8_t address, uint8_t *value);
   int updi_write_cs(const PROGRAMMER *pgm, uint8_t address, uint8_t value);
   int updi_write_key(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size);
+  int updi_write_key_reset(const PROGRAMMER *pgm, unsigned char *buffer, uint8_t size_type, uint16_t size);
+  int updi_write_read_cs(const PROGRAMMER *pgm, uint8_t st_address, uint8_t value, uint8_t ld_address,
+    uint8_t *result);
   int updi_read_sib(const PROGRAMMER *pgm, unsigned char *buffer, uint16_t size);
   int updi_read_byte(const PROGRAMMER *pgm, uint32_t address, uint8_t *value);
   int updi_write_byte(const PROGRAMMER *pgm, uint32_t address, uint8_t value);
   int updi_read_data(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint16_t size);
+  int updi_read_data_bulk(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint32_t size,
+    uint16_t chunk);
   int updi_write_data(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint16_t size);
   int updi_read_data_words(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint16_t size);
   int updi_write_data_words(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint16_t size);
+  int updi_write_data_words_stream(const PROGRAMMER *pgm, uint32_t address, uint8_t *buffer, uint32_t size);
 
 #ifdef __cplusplus
 }
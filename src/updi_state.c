@@ -47,6 +47,14 @@ void updi_set_nvm_mode(const PROGRAMMER *pgm, updi_nvm_mode mode) {
   ((updi_state *) (pgm->cookie))->nvm_mode = mode;
 }
 
+const struct updi_nvm_ctrl *updi_get_nvm_ctrl(const PROGRAMMER *pgm) {
+  return ((updi_state *) (pgm->cookie))->nvm_ctrl;
+}
+
+void updi_set_nvm_ctrl(const PROGRAMMER *pgm, const struct updi_nvm_ctrl *ctrl) {
+  ((updi_state *) (pgm->cookie))->nvm_ctrl = ctrl;
+}
+
 updi_rts_mode updi_get_rts_mode(const PROGRAMMER *pgm) {
   return ((updi_state *) (pgm->cookie))->rts_mode;
 }
@@ -54,3 +62,27 @@ updi_rts_mode updi_get_rts_mode(const PROGRAMMER *pgm) {
 void updi_set_rts_mode(const PROGRAMMER *pgm, updi_rts_mode mode) {
   ((updi_state *) (pgm->cookie))->rts_mode = mode;
 }
+
+int updi_get_baud(const PROGRAMMER *pgm) {
+  return ((updi_state *) (pgm->cookie))->baud;
+}
+
+void updi_set_baud(const PROGRAMMER *pgm, int baud) {
+  ((updi_state *) (pgm->cookie))->baud = baud;
+}
+
+int updi_get_autobaud(const PROGRAMMER *pgm) {
+  return ((updi_state *) (pgm->cookie))->autobaud;
+}
+
+void updi_set_autobaud(const PROGRAMMER *pgm, int baud) {
+  ((updi_state *) (pgm->cookie))->autobaud = baud;
+}
+
+int updi_get_read_chunk(const PROGRAMMER *pgm) {
+  return ((updi_state *) (pgm->cookie))->read_chunk;
+}
+
+void updi_set_read_chunk(const PROGRAMMER *pgm, int chunk) {
+  ((updi_state *) (pgm->cookie))->read_chunk = chunk;
+}
@@ -65,11 +65,17 @@ typedef enum {
   RTS_MODE_HIGH
 } updi_rts_mode;
 
+struct updi_nvm_ctrl;
+
 typedef struct {
   updi_sib_info sib_info;
   updi_datalink_mode datalink_mode;
   updi_nvm_mode nvm_mode;
+  const struct updi_nvm_ctrl *nvm_ctrl; // NVM controller description resolved from nvm_mode
   updi_rts_mode rts_mode;
+  int baud;                     // Current host baud rate of the UPDI link
+  int autobaud;                 // Highest baud rate to try with -x autobaud, 0 if off
+  int read_chunk;               // Bytes per REPEAT block in paged reads (-x readchunk)
 } updi_state;
 
 #ifdef __cplusplus
@@ -81,8 +87,16 @@ extern "C" {
   void updi_set_datalink_mode(const PROGRAMMER *pgm, updi_datalink_mode mode);
   updi_nvm_mode updi_get_nvm_mode(const PROGRAMMER *pgm);
   void updi_set_nvm_mode(const PROGRAMMER *pgm, updi_nvm_mode mode);
+  const struct updi_nvm_ctrl *updi_get_nvm_ctrl(const PROGRAMMER *pgm);
+  void updi_set_nvm_ctrl(const PROGRAMMER *pgm, const struct updi_nvm_ctrl *ctrl);
   updi_rts_mode updi_get_rts_mode(const PROGRAMMER *pgm);
   void updi_set_rts_mode(const PROGRAMMER *pgm, updi_rts_mode mode);
+  int updi_get_baud(const PROGRAMMER *pgm);
+  void updi_set_baud(const PROGRAMMER *pgm, int baud);
+  int updi_get_autobaud(const PROGRAMMER *pgm);
+  void updi_set_autobaud(const PROGRAMMER *pgm, int baud);
+  int updi_get_read_chunk(const PROGRAMMER *pgm);
+  void updi_set_read_chunk(const PROGRAMMER *pgm, int chunk);
 
 #ifdef __cplusplus
 }
@@ -1827,7 +1827,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
   }
 
   memset(mem->buf, 0xff, msize);
-  memset(mem->tags, 0, msize);
+  tag_clr_range(mem->tags, 0, msize);
 
   pp.n_ursegs = 0;
 
@@ -1846,7 +1846,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
     } else {
       uint32tobuf(mem->buf, jmp_opcode(pp.start));
     }
-    memset(mem->tags, TAG_ALLOCATED, vecsz);
+    tag_set_range(mem->tags, 0, vecsz);
   }
 
   // Bootloader code
@@ -1854,7 +1854,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
   pp.ursegs[pp.n_ursegs].len = bsize - 6;
   pp.n_ursegs++;
   memcpy(mem->buf + pp.start, bloader, bsize - 6);
-  memset(mem->tags + pp.start, TAG_ALLOCATED, bsize - 6);
+  tag_set_range(mem->tags, pp.start, bsize - 6);
 
   // Filler section
   if(pp.n_fill && pp.fill && remain <= pp.n_serialno)
@@ -1867,7 +1867,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
       if(p >= pp.fill+pp.n_fill)
         p = pp.fill;
     }
-    memset(mem->tags + addr, TAG_ALLOCATED, len);
+    tag_set_range(mem->tags, addr, len);
     pp.ursegs[pp.n_ursegs].addr = addr;
     pp.ursegs[pp.n_ursegs].len = len;
     pp.n_ursegs++;
@@ -1890,7 +1890,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
     pp.ursegs[pp.n_ursegs].len = len;
     pp.n_ursegs++;
     memcpy(mem->buf + addr, pp.serialno + off, len);
-    memset(mem->tags + addr, TAG_ALLOCATED, len);
+    tag_set_range(mem->tags, addr, len);
   }
 
   // Version and bootloader features table
@@ -1898,7 +1898,7 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
   pp.ursegs[pp.n_ursegs].len = 6;
   pp.n_ursegs++;
   memcpy(mem->buf + msize - 6, bloader + bsize - 6, 6);
-  memset(mem->tags + msize - 6, TAG_ALLOCATED, 6);
+  tag_set_range(mem->tags, msize - 6, 6);
 
   if(pp.save) {
     if(!pp.savefname)
@@ -1926,14 +1926,14 @@ int urbootautogen(const AVRPART *part, const AVRMEM *mem, const char *filename)
     mmt_free(p);
 
     memset(mem->buf, 0xff, msize);
-    memset(mem->tags, 0, msize);
+    tag_clr_range(mem->tags, 0, msize);
   }
 
   if(pp.configs) {
     if(is_classic(part))
       classic_configuration(pp.up, NULL, part, pp.ut->features & URFEATURE_HW? pp.ut->usage: 0);
     memset(mem->buf, 0xff, msize);
-    memset(mem->tags, 0, msize);
+    tag_clr_range(mem->tags, 0, msize);
   }
 
   ret = pp.show || pp.configs? 0: msize;
@@ -319,7 +319,10 @@ typedef struct {
       nometadata,               // Don't support metadata at all
       noautoreset,              // Don't reset the board after opening the serial port
       delay,                    // Additional delay [ms] after resetting the board, can be negative
-      strict;                   // Use strict synchronisation protocol
+      strict,                   // Use strict synchronisation protocol
+      autobaud,                 // Find the fastest baud the bootloader answers at
+      sync_tries,               // Sync attempts of urclock_getsync() if > 0
+      window;                   // Send next flash page whilst bootloader writes the current one
 
   char title[254];              // Use instead of filename for metadata - same size as filename
   char iddesc[64];              // Location of Urclock ID, eg F.12324.6 or E.-4.4 (default E.257.6)
@@ -538,6 +541,58 @@ static int set_reset(const PROGRAMMER *pgm, unsigned char *jmptoboot, int vecsz)
 }
 
 
+/*
+ * Emulate chip erase by marking flash below maxsize for writing with 0xff. Pages that the input
+ * covers in part are written anyway, so they are filled up with 0xff. For pages that the input
+ * does not cover at all check whether they are blank on the device and only erase those that are
+ * not; this way an emulated chip erase costs as many page writes as the previously used flash.
+ */
+static void ur_emulate_ce(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *flm, int maxsize) {
+  int pgsize = ur.uP.pagesize > 0? ur.uP.pagesize: 1, nerase = 0, nblank = 0, ai, end, i;
+  int readable = !ur.urprotocol || (ur.urfeatures & UB_READ_FLASH);
+  unsigned char *page = mmt_malloc(pgsize);
+
+  for(ai = 0; ai < maxsize; ai = end) {
+    end = urmin(maxsize, ai - ai%pgsize + pgsize);
+    for(i = ai; i < end; i++)
+      if(tag_isset(flm->tags, i))
+        break;
+
+    if(i == end && readable) {  // Page not covered by input: is it blank on the device?
+      const unsigned char *dev = end - ai == pgsize? devcache_page(flm, ai): NULL;
+
+      if(!dev) {
+        if(ur_readEF(pgm, p, page, ai, end - ai, 'F') < 0) {
+          pmsg_warning("cannot read flash at 0x%04x; erasing the remaining flash regardless\n", ai);
+          readable = 0;
+        } else {
+          devcache_update(flm, ai, end - ai, page);
+          dev = page;
+        }
+      }
+      if(dev) {
+        for(i = 0; i < end - ai && dev[i] == 0xff; i++)
+          continue;
+        if(i == end - ai) {
+          nblank++;
+          continue;
+        }
+      }
+    }
+
+    for(i = ai; i < end; i++)
+      if(!tag_isset(flm->tags, i)) {
+        flm->buf[i] = 0xff;
+        tag_set(flm->tags, i);
+      }
+    nerase++;
+  }
+  mmt_free(page);
+
+  pmsg_notice2("emulated chip erase: %d page%s written, %d blank page%s skipped\n",
+    nerase, str_plural(nerase), nblank, str_plural(nblank));
+}
+
 // Called after the input file has been read for writing or verifying flash
 static int urclock_flash_readhook(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *flm,
   const char *fname, int size) { // Size is max memory address + 1
@@ -556,10 +611,10 @@ static int urclock_flash_readhook(const PROGRAMMER *pgm, const AVRPART *p, const
 
   // Compute begin and length of first contiguous block in input
   for(firstbeg=0; firstbeg < size; firstbeg++)
-    if(flm->tags[firstbeg] & TAG_ALLOCATED)
+    if(tag_isset(flm->tags, firstbeg))
       break;
   for(firstlen=0; firstbeg+firstlen < size; firstlen++)
-    if(!(flm->tags[firstbeg+firstlen] & TAG_ALLOCATED))
+    if(!tag_isset(flm->tags, firstbeg+firstlen))
       break;
 
   pmsg_notice2("%s %04d.%02d.%02d %02d.%02d meta %d boot %d\n", ur.filename,
@@ -728,10 +783,10 @@ nopatch:
       *p++ = ur.mcode;          // Save metadata code
 
       // Set tags so metadata get burned onto chip
-      memset(flm->tags + maxsize - nmdata, TAG_ALLOCATED, nmdata);
+      tag_set_range(flm->tags, maxsize - nmdata, nmdata);
 
       if(ur.initstore)          // Zap the pgm store
-        memset(flm->tags + size, TAG_ALLOCATED, nfree);
+        tag_set_range(flm->tags, size, nfree);
 
       size = maxsize;
     }
@@ -740,7 +795,7 @@ nopatch:
   // Storing no metadata? Still put a 0xff byte just below bootloader if there is space
   if(size < maxsize && nmdata == 0) {
     flm->buf[ur.pfend] = 0xff;
-    flm->tags[ur.pfend] = TAG_ALLOCATED;
+    tag_set(flm->tags, ur.pfend);
     size = ur.pfend+1;
   }
 
@@ -752,18 +807,17 @@ nopatch_nometa:
     if(ur_readEF(pgm, p, &devmcode, ur.pfend, 1, 'F') == 0) {
       int devnmeta=nmeta(devmcode, ur.uP.flashsize);
       for(int addr=ur.pfend+1-devnmeta; addr < ur.pfend+1; addr++) {
-        if(addr >= 0 && addr < flm->size && !(flm->tags[addr] & TAG_ALLOCATED)) {
-          flm->tags[addr] |= TAG_ALLOCATED;
+        if(addr >= 0 && addr < flm->size && !tag_isset(flm->tags, addr)) {
+          tag_set(flm->tags, addr);
           flm->buf[addr] = 0xff;
         }
       }
     }
   }
 
-  // Emulate chip erase if bootloader unable to: mark all bytes for programming on first -U flash:w:...
+  // Emulate chip erase if bootloader unable to: mark non-blank flash for programming on first -U flash:w:...
   if(ur.emulate_ce) {
-    for(int ai = 0; ai < maxsize; ai++)
-      flm->tags[ai] = TAG_ALLOCATED;
+    ur_emulate_ce(pgm, p, flm, maxsize);
     ur.emulate_ce = 0;
   }
 
@@ -771,7 +825,7 @@ nopatch_nometa:
   if(ur.boothigh && ur.blstart && ur.vbllevel == 1) {
     int rc, set=0;
     for(int i=0; i < vecsz; i++)
-      if(flm->tags[i] & TAG_ALLOCATED)
+      if(tag_isset(flm->tags, i))
         set++;
 
     // Reset vector not programmed? Or -F? Ensure a jmp to bootloader
@@ -790,20 +844,20 @@ nopatch_nometa:
 
           // Mix with already set bytes
           for(int i=0; i < vecsz; i++)
-            if(!(flm->tags[i] & TAG_ALLOCATED))
+            if(!tag_isset(flm->tags, i))
               flm->buf[i] = device[i];
         }
 
         if(reset2addr(flm->buf, vecsz, flm->size, &resetdest) < 0 || resetdest != ur.blstart) {
           for(int i=0; i < resetsize; i++) {
             flm->buf[i] = jmptoboot[i];
-            flm->tags[i] |= TAG_ALLOCATED;
+            tag_set(flm->tags, i);
           }
         }
       } else {                  // Flash not readable: patch reset vector unconditionally
         for(int i=0; i < resetsize; i++) {
           flm->buf[i] = jmptoboot[i];
-          flm->tags[i] |= TAG_ALLOCATED;
+          tag_set(flm->tags, i);
         }
       }
     } else if(firstbeg < vecsz) { // Double-check reset vector jumps to bootloader
@@ -835,7 +889,7 @@ nopatch_nometa:
       for(addr = 0; addr < maxsize; addr += pgsize) {
         // How many bytes are set in this effective page?
         for(ai = addr, nset = 0; ai < addr + pgsize; ai++)
-          if(flm->tags[ai] & TAG_ALLOCATED)
+          if(tag_isset(flm->tags, ai))
             nset++;
 
         // Holes in this page that needs writing? read them in from the chip
@@ -849,14 +903,14 @@ nopatch_nometa:
 
             // Lowest address with unset byte (there might be none)
             for(ai = beg; ai < end; ai++)
-              if(!(flm->tags[ai] & TAG_ALLOCATED))
+              if(!tag_isset(flm->tags, ai))
                 break;
             istart = ai;
 
             if(istart < end) {
               // Highest address with unset byte
               for(ai = end - 1; ai >= istart; ai--)
-                if(!(flm->tags[ai] & TAG_ALLOCATED))
+                if(!tag_isset(flm->tags, ai))
                   break;
               isize = ai - istart + 1;
 
@@ -867,8 +921,8 @@ nopatch_nometa:
                 pmsg_debug("padding [0x%04x, 0x%04x]\n", istart, istart+isize-1);
 
                 for(ai = istart; ai < istart + isize; ai++)
-                  if(!(flm->tags[ai] & TAG_ALLOCATED)) {
-                    flm->tags[ai] |= TAG_ALLOCATED;
+                  if(!tag_isset(flm->tags, ai)) {
+                    tag_set(flm->tags, ai);
                     flm->buf[ai] = spc[ai-istart];
                   }
               } else {
@@ -888,14 +942,14 @@ nopatch_nometa:
 
   for(addr = 0; addr < maxsize; addr += pgsize) {
     for(ai = addr, nset = 0; ai < addr + pgsize; ai++)
-      if(flm->tags[ai] & TAG_ALLOCATED)
+      if(tag_isset(flm->tags, ai))
         nset++;
 
     if(nset && nset != pgsize) { // Page has holes: fill them
       pmsg_debug("0xff padding page addr 0x%04d\n", addr);
       for(ai = addr, nset = 0; ai < addr + pgsize; ai++)
-        if(!(flm->tags[ai] & TAG_ALLOCATED)) {
-          flm->tags[ai] |= TAG_ALLOCATED;
+        if(!tag_isset(flm->tags, ai)) {
+          tag_set(flm->tags, ai);
           flm->buf[ai] = 0xff;
         }
     }
@@ -962,10 +1016,8 @@ static const char *vblvecname(const PROGRAMMER *pgm, int num) {
 }
 
 
-// Check protocol bytes and read result if needed
-static int urclock_res_check(const PROGRAMMER *pgm, const char *funcname, int ignore,
-  unsigned char *res, int expected) {
-
+// Check the sync byte that opens a reply
+static int urclock_res_insync(const PROGRAMMER *pgm, const char *funcname) {
   unsigned char chr;
 
   if(urclock_recv(pgm, &chr, 1) < 0)
@@ -976,15 +1028,13 @@ static int urclock_res_check(const PROGRAMMER *pgm, const char *funcname, int ig
     return -1;
   }
 
-  // Potentially ignore some initial bytes of the reply
-  while(ignore--)
-    if(urclock_recv(pgm, &chr, 1) < 0)
-      return -1;
+  return 0;
+}
 
-  // Read the reply from previous command if requested
-  if(res && expected > 0)
-    if(urclock_recv(pgm, res, expected) < 0)
-      return -1;
+
+// Check the OK byte that closes a reply
+static int urclock_res_ok(const PROGRAMMER *pgm, const char *funcname) {
+  unsigned char chr;
 
   if(urclock_recv(pgm, &chr, 1) < 0)
     return -1;
@@ -998,6 +1048,29 @@ static int urclock_res_check(const PROGRAMMER *pgm, const char *funcname, int ig
 }
 
 
+// Check protocol bytes and read result if needed
+static int urclock_res_check(const PROGRAMMER *pgm, const char *funcname, int ignore,
+  unsigned char *res, int expected) {
+
+  unsigned char chr;
+
+  if(urclock_res_insync(pgm, funcname) < 0)
+    return -1;
+
+  // Potentially ignore some initial bytes of the reply
+  while(ignore--)
+    if(urclock_recv(pgm, &chr, 1) < 0)
+      return -1;
+
+  // Read the reply from previous command if requested
+  if(res && expected > 0)
+    if(urclock_recv(pgm, res, expected) < 0)
+      return -1;
+
+  return urclock_res_ok(pgm, funcname);
+}
+
+
 // Set ur.uP from mcuid, potentially overwritten by p
 static void set_uP(const PROGRAMMER *pgm, const AVRPART *p, int mcuid, int mcuid_wins) {
   int idx_m = -1, idx_p = -1;
@@ -1254,8 +1327,70 @@ static int urclock_read_sig_bytes(const PROGRAMMER *pgm, const AVRPART *p, const
   return ur_initstruct(pgm, p);
 }
 
+/*
+ * Key for the cached bootloader location of a target (see tgtcache.c): the
+ * signature, the top 6 flash bytes and 16 bytes at the bootloader start;
+ * returns -1 if the bytes at the bootloader start cannot be read
+ */
+static int ur_blcache_key(const PROGRAMMER *pgm, const AVRPART *p, const uint8_t *top6, int blstart,
+  char *key) {
+
+  uint8_t b16[16];
+
+  if(blstart < 0 || blstart + 16 > ur.uP.flashsize || ur_readEF(pgm, p, b16, blstart, 16, 'F'))
+    return -1;
+  for(int i = 0; i < 3; i++)
+    key += sprintf(key, "%02x", ur.uP.sigs[i]);
+  *key++ = '-';
+  for(int i = 0; i < 6; i++)
+    key += sprintf(key, "%02x", top6[i]);
+  *key++ = '-';
+  for(int i = 0; i < 16; i++)
+    key += sprintf(key, "%02x", b16[i]);
+
+  return 0;
+}
+
+// Set bootloader location from the target cache if it still matches the target; returns 1 if so
+static int ur_blcache_get(const PROGRAMMER *pgm, const AVRPART *p, const uint8_t *top6) {
+  const char *val = tgtcache_get("urclock");
+  char key[80], ckey[80];
+  int blstart, blend, pfend, eerw, level, vecnum, guessed;
+
+  if(!val || sscanf(val, "%79s %d %d %d %d %d %d %d", ckey, &blstart, &blend, &pfend, &eerw,
+    &level, &vecnum, &guessed) != 8)
+    return 0;
+  if(blend != ur.uP.flashsize-1 || blstart >= blend || pfend != blstart-1)
+    return 0;
+  if(ur_blcache_key(pgm, p, top6, blstart, key) < 0 || !str_eq(key, ckey))
+    return 0;
+
+  ur.blstart = blstart;
+  ur.blend = blend;
+  ur.pfend = pfend;
+  ur.bleepromrw = !!eerw;
+  ur.vbllevel = level;
+  ur.vblvectornum = vecnum;
+  ur.blguessed = guessed;
+  pmsg_debug("bootloader location [0x%04x, 0x%04x] from target cache\n", blstart, blend);
+
+  return 1;
+}
+
+static void ur_blcache_put(const PROGRAMMER *pgm, const AVRPART *p, const uint8_t *top6) {
+  char key[80], *val;
+
+  if(ur_blcache_key(pgm, p, top6, ur.blstart, key) < 0)
+    return;
+  val = mmt_sprintf("%s %d %d %d %d %d %d %d", key, ur.blstart, ur.blend, ur.pfend, ur.bleepromrw,
+    ur.vbllevel, ur.vblvectornum, ur.blguessed);
+  tgtcache_put("urclock", val);
+  mmt_free(val);
+}
+
 static int ur_initstruct(const PROGRAMMER *pgm, const AVRPART *p) {
-  uint8_t spc[2048];
+  uint8_t spc[2048], top6[6];
+  int blprobed = 0;             // Bootloader location found by probing flash?
   AVRMEM *flm;
   int rc;
 
@@ -1355,6 +1490,7 @@ static int ur_initstruct(const PROGRAMMER *pgm, const AVRPART *p) {
     uint8_t cap = spc[4];       // Capability byte
     uint8_t urver = spc[5];     // Urboot version (low three bits are minor version: 076 is v7.6)
     v16 = buf2uint16(spc+4);    // Combo word for neatly printed version line of urboot bootloader
+    memcpy(top6, spc, sizeof top6);
 
     // Extensively check this is an urboot bootloader v7.2 .. v12.7 == 0147 and extract properties
     if(urver >= 072 && urver <= 0147 && (isRjmp(rjmpwp) || rjmpwp == ret_opcode)) { // Prob urboot
@@ -1410,6 +1546,11 @@ static int ur_initstruct(const PROGRAMMER *pgm, const AVRPART *p) {
       ur.bloptiversion = (urver<<8) + cap;
     }
 
+    // Probing below is expensive: revalidate a bootloader location found earlier for this target
+    if(ur.blend <= ur.blstart && ur_blcache_get(pgm, p, top6))
+      goto vblvecfound;
+    blprobed = ur.blend <= ur.blstart;
+
     if(ur.blend <= ur.blstart && ur.vbllevel) { // An older version urboot vector bootloader?
       int vecsz = ur.uP.flashsize <= 8192? 2: 4;
 
@@ -1502,6 +1643,8 @@ static int ur_initstruct(const PROGRAMMER *pgm, const AVRPART *p) {
   }
 
 vblvecfound:
+  if(blprobed && ur.blend > ur.blstart)
+    ur_blcache_put(pgm, p, top6);
   urbootPutVersion(pgm, ur.desc, v16, rjmpwp);
 
   ur.mcode = 0xff;
@@ -1976,7 +2119,9 @@ static int urclock_getsync(const PROGRAMMER *pgm) {
   ur.sync_silence = 2;
   serial_drain_timeout = 20 + (kbd < 115? 80/kbd: 0); // ms: longer for low baud rates
 
-  for(attempt = 0; attempt < MAX_SYNC_ATTEMPTS; attempt++) {
+  int max_attempts = ur.sync_tries > 0? ur.sync_tries: MAX_SYNC_ATTEMPTS;
+
+  for(attempt = 0; attempt < max_attempts; attempt++) {
     /*
      * The initial byte for autobaud must be the sync byte/Sync_CRC_EOP sequence; thereafter it
      * should normally be Cmnd_STK_GET_SYNC/Sync_CRC_EOP. However, both urboot and optiboot are
@@ -2009,7 +2154,7 @@ static int urclock_getsync(const PROGRAMMER *pgm) {
       usleep(slp*1000);
     }
     if(attempt > 5) {           // Don't report first six attempts
-      if(attempt == MAX_SYNC_ATTEMPTS-1)
+      if(attempt == max_attempts-1)
         ur.sync_silence = 1;
       pmsg_warning("attempt %d of %d: not in sync\n", attempt - 5, MAX_SYNC_ATTEMPTS-6);
     }
@@ -2029,8 +2174,8 @@ static int urclock_getsync(const PROGRAMMER *pgm) {
 
   serial_recv_timeout = 500;    // ms
 
-  if(attempt == MAX_SYNC_ATTEMPTS)
-    return -1;
+  if(attempt == max_attempts)   // Not in sync
+    return -2;
 
   ur.STK_INSYNC = ur.gs.stk_insync;
   ur.STK_OK     = ur.gs.stk_ok;
@@ -2252,6 +2397,52 @@ static void urclock_disable(const PROGRAMMER *pgm) {
 }
 
 
+#define URCLOCK_AUTOBAUD_TRIES 4 // Sync attempts at each candidate baud
+
+/*
+ * Reset the board at each candidate baud and try to get in sync with the
+ * bootloader; the first baud that works is remembered in the target cache
+ * and tried first next time. Urboot autobaud bootloaders adapt to any baud
+ * they support, so this normally ends with the fastest rate of the adapter.
+ */
+static int urclock_autobaud(PROGRAMMER *pgm, const char *port) {
+  long bauds[TGTCACHE_NBAUDS];
+  const AVRPART *part = partdesc? locate_part(part_list, partdesc): NULL;
+
+  tgtcache_target(pgm, part, port);
+  int n = tgtcache_bauds(pgm->baudrate, bauds);
+
+  for(int i = 0; i < n; i++) {
+    if(serial_setparams(&pgm->fd, bauds[i], SERIAL_8N1) < 0) {
+      pmsg_notice2("%s(): port does not support %ld baud\n", __func__, bauds[i]);
+      continue;
+    }
+    serial_set_dtr_rts(&pgm->fd, 1);
+    usleep(100);
+    serial_set_dtr_rts(&pgm->fd, 0);
+    if((120+ur.delay) > 0)
+      usleep((120+ur.delay)*1000);
+
+    pgm->baudrate = bauds[i];
+    ur.gs.seen = 0;
+    ur.sync_tries = URCLOCK_AUTOBAUD_TRIES;
+    int rc = urclock_getsync(pgm);
+
+    ur.sync_tries = 0;
+    if(rc == 0) {
+      pmsg_notice("bootloader answers at %ld baud\n", bauds[i]);
+      tgtcache_put("baud", str_ccprintf("%ld", bauds[i]));
+      return 0;
+    }
+    if(rc != -2)                // In sync but the bootloader is not usable
+      return -1;
+    pmsg_notice2("%s(): no answer at %ld baud\n", __func__, bauds[i]);
+  }
+  pmsg_error("bootloader does not answer at any baud%s\n", pgm->baudrate? " up to -b": "");
+
+  return -1;
+}
+
 static int urclock_open(PROGRAMMER *pgm, const char *port) {
   if(pgm->bitclock)
     pmsg_warning("-c %s does not support adjustable bitclock speed; ignoring -B\n", pgmid);
@@ -2270,6 +2461,8 @@ static int urclock_open(PROGRAMMER *pgm, const char *port) {
     // Set RTS/DTR high to discharge the series-capacitor, if present
     serial_set_dtr_rts(&pgm->fd, 0);
     usleep(20*1000);
+    if(ur.autobaud)             // Resets the board for each baud it tries
+      return urclock_autobaud(pgm, port);
     // Pull the RTS/DTR line low to reset AVR
     serial_set_dtr_rts(&pgm->fd, 1);
     // Max 100 us: charging a cap longer creates a high reset spike above Vcc
@@ -2278,6 +2471,8 @@ static int urclock_open(PROGRAMMER *pgm, const char *port) {
     serial_set_dtr_rts(&pgm->fd, 0);
   }
 
+  if(ur.autobaud)
+    pmsg_warning("-x autobaud needs to reset the board; ignoring it with -x noautoreset\n");
   if((120+ur.delay) > 0)
     usleep((120+ur.delay)*1000); // Wait until board comes out of reset
 
@@ -2298,11 +2493,15 @@ static void urclock_close(PROGRAMMER *pgm) {
 }
 
 
-static int urclock_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
-  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+// Write the nr ranges rg[] of m; windowed flash writes carry on from one range to the next
+static int urclock_paged_write_multi(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, const Avr_range *rg, int nr) {
 
-  int mchr, chunk;
-  unsigned int n;
+  int mchr, chunk, n_bytes = 0;
+  unsigned int addr, n;
+
+  for(int k = 0; k < nr; k++)
+    n_bytes += rg[k].n;
 
   if(n_bytes) {
     // Paged writes only valid for flash and eeprom
@@ -2314,15 +2513,33 @@ static int urclock_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
       Return("bootloader %s not have paged EEPROM write%s", ur.blurversion? "does": "might",
         ur.blurversion? " capability": ", try -x eepromrw if it has");
 
-    n = addr + n_bytes;
-
-    for(; addr < n; addr += chunk) {
-      chunk = n-addr < page_size? n-addr: page_size;
-
-      if(urclock_paged_rdwr(pgm, p, Cmnd_STK_PROG_PAGE, addr, chunk, mchr, (char *) m->buf+addr)<0)
-        return -3;
-      if(urclock_res_check(pgm, __func__, 0, NULL, 0) < 0)
-        return -4;
+    /*
+     * Windowed flash writes: the bootloader sends its sync byte once it has
+     * received a page and then erases and programs it from its single page
+     * buffer. Sending the next page after the maximum erase and write time
+     * has elapsed since that sync byte is safe and overlaps the OK reply and
+     * the next page with the USB-serial latency of both directions.
+     */
+    int window = ur.window && ur.urprotocol && mchr == 'F', pending = 0;
+    unsigned int wait_us = 2*(m->max_write_delay > 0? m->max_write_delay: 4500);
+
+    for(int k = 0; k < nr; k++) {
+      n = rg[k].addr + rg[k].n;
+      for(addr = rg[k].addr; addr < n; addr += chunk) {
+        chunk = n-addr < page_size? n-addr: page_size;
+
+        if(urclock_paged_rdwr(pgm, p, Cmnd_STK_PROG_PAGE, addr, chunk, mchr, (char *) m->buf+addr)<0)
+          return -3;
+        if(pending && urclock_res_ok(pgm, __func__) < 0) // Previous page is now written
+          return -4;
+        pending = window && (addr + chunk < n || k < nr-1);
+        if(pending) {
+          if(urclock_res_insync(pgm, __func__) < 0)
+            return -4;
+          usleep(wait_us);
+        } else if(urclock_res_check(pgm, __func__, 0, NULL, 0) < 0)
+          return -4;
+      }
     }
   }
 
@@ -2330,6 +2547,15 @@ static int urclock_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
 }
 
 
+static int urclock_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
+  unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
+
+  Avr_range rg = {addr, n_bytes};
+
+  return urclock_paged_write_multi(pgm, p, m, page_size, &rg, 1);
+}
+
+
 static int urclock_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVRMEM *m,
   unsigned int page_size, unsigned int addr, unsigned int n_bytes) {
 
@@ -2499,6 +2725,8 @@ static int urclock_parseextparms(const PROGRAMMER *pgm, LISTID extparms) {
     {"noautoreset", &ur.nometadata, NA,   "Do not reset the board after opening the serial port"},
     {"delay", &ur.delay, ARG,             "Additional <n> ms delay after reset, can be negative"},
     {"strict", &ur.strict, NA,            "Use strict synchronisation protocol"},
+    {"autobaud", &ur.autobaud, NA,        "Use the fastest baud the b/loader answers at, up to -b"},
+    {"window", &ur.window, NA,            "Overlap sending a flash page with writing the previous"},
     {"help", &help, NA,                   "Show this help menu and exit"},
   };
 
@@ -2609,6 +2837,7 @@ void urclock_initpgm(PROGRAMMER *pgm) {
 
   // Optional functions
   pgm->paged_write = urclock_paged_write;
+  pgm->paged_write_multi = urclock_paged_write_multi;
   pgm->paged_load = urclock_paged_load;
   pgm->setup = urclock_setup;
   pgm->teardown = urclock_teardown;
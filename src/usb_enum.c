@@ -0,0 +1,268 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Process-wide cache of USB enumeration results
+ *
+ * The USB backends used to scan all buses each time they opened a device,
+ * and they opened every device with a matching VID/PID to read its serial
+ * number and product strings, only to discover that -P usb:<serial> asked
+ * for a different one. Programmers that try several PIDs (jtag3, pickit5)
+ * or several transports (HID and libusb) repeated all that for each
+ * attempt, which takes seconds with a dozen programmers on a hub tree.
+ *
+ * This module scans the buses once per process for each USB library:
+ * usb_enum_busses() for libusb-0.1, usb_enum_devices() with a shared
+ * context from usb_enum_context() for libusb-1.0 and usb_enum_hid() for
+ * hidapi. String descriptors read through usb_enum_string() and
+ * usb_enum_string_1_0() are remembered per bus, device address, VID, PID
+ * and descriptor index, so that a device need not even be opened again to
+ * tell that its serial number does not match. usb_enum_rescan() forgets
+ * everything but the libusb-1.0 context, eg, after a hotplug event, and
+ * usb_enum_free() releases the cache at exit.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(HAVE_LIBUSB)
+#if defined(HAVE_USB_H)
+#include <usb.h>
+#elif defined(HAVE_LUSB0_USB_H)
+#include <lusb0_usb.h>
+#else
+#error "libusb needs either <usb.h> or <lusb0_usb.h>"
+#endif
+#endif
+
+#if defined(HAVE_LIBUSB_1_0)
+#if defined(HAVE_LIBUSB_1_0_LIBUSB_H)
+#include <libusb-1.0/libusb.h>
+#else
+#include <libusb.h>
+#endif
+#endif
+
+#if defined(HAVE_LIBHIDAPI)
+#include <hidapi/hidapi.h>
+#endif
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+struct usb_enum_str {           // Cached string descriptor
+  char *bus, *addr;             // Bus and device address as shown by the USB library
+  int vid, pid, index;
+  char *str;
+};
+
+struct usb_enum_hid {           // Cached hid_enumerate() result
+  int vid, pid;
+  struct hid_device_info *list;
+};
+
+// Cached string descriptor of a device or NULL if it has not been read yet
+const char *usb_enum_lookup(const char *bus, const char *addr, int vid, int pid, int index) {
+  for(int i = 0; i < cx->uen_nstrs; i++) {
+    struct usb_enum_str *s = cx->uen_strs + i;
+
+    if(s->vid == vid && s->pid == pid && s->index == index && str_eq(s->bus, bus) && str_eq(s->addr, addr))
+      return s->str;
+  }
+
+  return NULL;
+}
+
+// Remember a string descriptor that has been read from a device
+void usb_enum_remember(const char *bus, const char *addr, int vid, int pid, int index, const char *str) {
+  if(!bus || !addr || !str || usb_enum_lookup(bus, addr, vid, pid, index))
+    return;
+
+  cx->uen_strs = mmt_realloc(cx->uen_strs, (cx->uen_nstrs + 1)*sizeof *cx->uen_strs);
+  cx->uen_strs[cx->uen_nstrs++] = (struct usb_enum_str) {
+    .bus = mmt_strdup(bus), .addr = mmt_strdup(addr), .vid = vid, .pid = pid, .index = index,
+    .str = mmt_strdup(str),
+  };
+}
+
+#if defined(HAVE_LIBUSB)
+
+// Scan the libusb-0.1 buses unless that has been done since the last usb_enum_rescan()
+void usb_enum_busses(void) {
+  if(cx->uen_scanned)
+    return;
+  usb_init();
+  usb_find_busses();
+  usb_find_devices();
+  cx->uen_scanned = 1;
+}
+
+/*
+ * Read string descriptor index of dev into buf of size len, preferably from
+ * the cache; *hp is opened on demand when the string has not been cached,
+ * so leaves *hp NULL if the device could not be opened. Returns the string
+ * length or a negative value on error.
+ */
+int usb_enum_string(struct usb_dev_handle **hp, struct usb_device *dev, int index, char *buf, size_t len) {
+  const char *bus = dev->bus? dev->bus->dirname: NULL, *addr = dev->filename, *s;
+  int vid = dev->descriptor.idVendor, pid = dev->descriptor.idProduct, n;
+
+  if(!len)
+    return -1;
+  if(bus && (s = usb_enum_lookup(bus, addr, vid, pid, index))) {
+    strncpy(buf, s, len - 1);
+    buf[len - 1] = 0;
+    return strlen(buf);
+  }
+  if(!*hp && !(*hp = usb_open(dev)))
+    return -1;
+  if((n = usb_get_string_simple(*hp, index, buf, len)) < 0)
+    return n;
+  usb_enum_remember(bus, addr, vid, pid, index, buf);
+
+  return n;
+}
+#endif
+
+#if defined(HAVE_LIBUSB_1_0)
+
+// libusb-1.0 context shared by all backends; it lives until usb_enum_free()
+struct libusb_context *usb_enum_context(void) {
+  if(!cx->uen_ctx) {
+    libusb_context *ctx = NULL;
+    int rc = libusb_init(&ctx);
+
+    if(rc < 0) {
+      pmsg_error("cannot initialise libusb: %s\n", libusb_strerror(rc));
+      return NULL;
+    }
+    cx->uen_ctx = ctx;
+  }
+
+  return cx->uen_ctx;
+}
+
+// Cached libusb-1.0 device list; the caller must neither free nor unref it
+int usb_enum_devices(struct libusb_device ***listp) {
+  libusb_context *ctx = usb_enum_context();
+
+  *listp = NULL;
+  if(!ctx)
+    return LIBUSB_ERROR_OTHER;
+  if(!cx->uen_list) {
+    libusb_device **list;
+    ssize_t n = libusb_get_device_list(ctx, &list);
+
+    if(n < 0)
+      return (int) n;
+    cx->uen_list = list;
+    cx->uen_nlist = n;
+  }
+  *listp = cx->uen_list;
+
+  return cx->uen_nlist;
+}
+
+// Same as usb_enum_string() for libusb-1.0; returns a libusb error code on failure
+int usb_enum_string_1_0(struct libusb_device_handle **hp, struct libusb_device *dev, int index,
+  char *buf, int len) {
+
+  struct libusb_device_descriptor desc;
+  char bus[16], addr[16];
+  const char *s;
+  int n;
+
+  if(len <= 0)
+    return LIBUSB_ERROR_INVALID_PARAM;
+  if((n = libusb_get_device_descriptor(dev, &desc)) < 0)
+    return n;
+  snprintf(bus, sizeof bus, "%03d", libusb_get_bus_number(dev));
+  snprintf(addr, sizeof addr, "%03d", libusb_get_device_address(dev));
+  if((s = usb_enum_lookup(bus, addr, desc.idVendor, desc.idProduct, index))) {
+    strncpy(buf, s, len - 1);
+    buf[len - 1] = 0;
+    return strlen(buf);
+  }
+  if(!*hp && (n = libusb_open(dev, hp)) < 0) {
+    *hp = NULL;
+    return n;
+  }
+  if((n = libusb_get_string_descriptor_ascii(*hp, index, (unsigned char *) buf, len)) < 0)
+    return n;
+  buf[n < len? n: len - 1] = 0;
+  usb_enum_remember(bus, addr, desc.idVendor, desc.idProduct, index, buf);
+
+  return n;
+}
+#endif
+
+#if defined(HAVE_LIBHIDAPI)
+
+// Cached hid_enumerate() list of devices with vid and pid; the caller must not free it
+struct hid_device_info *usb_enum_hid(unsigned short vid, unsigned short pid) {
+  for(int i = 0; i < cx->uen_nhids; i++)
+    if(cx->uen_hids[i].vid == vid && cx->uen_hids[i].pid == pid)
+      return cx->uen_hids[i].list;
+
+  cx->uen_hids = mmt_realloc(cx->uen_hids, (cx->uen_nhids + 1)*sizeof *cx->uen_hids);
+  cx->uen_hids[cx->uen_nhids] = (struct usb_enum_hid) { .vid = vid, .pid = pid, .list = hid_enumerate(vid, pid) };
+
+  return cx->uen_hids[cx->uen_nhids++].list;
+}
+#endif
+
+// Forget all enumeration results, eg, after devices have been connected or removed
+void usb_enum_rescan(void) {
+  for(int i = 0; i < cx->uen_nstrs; i++) {
+    mmt_free(cx->uen_strs[i].bus);
+    mmt_free(cx->uen_strs[i].addr);
+    mmt_free(cx->uen_strs[i].str);
+  }
+  mmt_free(cx->uen_strs);
+  cx->uen_strs = NULL;
+  cx->uen_nstrs = 0;
+
+#if defined(HAVE_LIBHIDAPI)
+  for(int i = 0; i < cx->uen_nhids; i++)
+    if(cx->uen_hids[i].list)
+      hid_free_enumeration(cx->uen_hids[i].list);
+#endif
+  mmt_free(cx->uen_hids);
+  cx->uen_hids = NULL;
+  cx->uen_nhids = 0;
+
+#if defined(HAVE_LIBUSB_1_0)
+  if(cx->uen_list)              // Open device handles keep their own reference
+    libusb_free_device_list(cx->uen_list, 1);
+#endif
+  cx->uen_list = NULL;
+  cx->uen_nlist = 0;
+  cx->uen_scanned = 0;
+}
+
+// Release the cache and the shared libusb-1.0 context
+void usb_enum_free(void) {
+  usb_enum_rescan();
+#if defined(HAVE_LIBUSB_1_0)
+  if(cx->uen_ctx)
+    libusb_exit(cx->uen_ctx);
+#endif
+  cx->uen_ctx = NULL;
+}
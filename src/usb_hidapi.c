@@ -37,6 +37,13 @@
 
 #include "usbdevs.h"
 
+// Same as hid_open(vid, pid, NULL) but using the cached enumeration
+static hid_device *usbhid_open_first(unsigned short vid, unsigned short pid) {
+  struct hid_device_info *list = usb_enum_hid(vid, pid);
+
+  return list? hid_open_path(list->path): NULL;
+}
+
 /*
  * The "baud" parameter is meaningless for USB devices, so we reuse it to pass
  * the desired USB device ID.
@@ -67,7 +74,7 @@ static int usbhid_open(const char *port, union pinfo pinfo, union filedescriptor
     int vid, pid;
 
     if(sscanf(vidp + 1, "%x", &vid) == 1 && sscanf(pidp + 1, "%x", &pid) == 1) {
-      if((dev = hid_open(vid, pid, NULL))) {
+      if((dev = usbhid_open_first(vid, pid))) {
         pmsg_notice2("USB device with VID: 0x%04x and PID: 0x%04x\n", vid, pid);
         pinfo.usbinfo.vid = vid;
         pinfo.usbinfo.pid = pid;
@@ -92,7 +99,7 @@ static int usbhid_open(const char *port, union pinfo pinfo, union filedescriptor
      */
     struct hid_device_info *list, *walk;
 
-    list = hid_enumerate(pinfo.usbinfo.vid, pinfo.usbinfo.pid);
+    list = usb_enum_hid(pinfo.usbinfo.vid, pinfo.usbinfo.pid);
     if(list == NULL) {
       pmsg_error("no USB HID devices found\n");
       return -1;
@@ -113,18 +120,16 @@ static int usbhid_open(const char *port, union pinfo pinfo, union filedescriptor
     }
     if(walk == NULL) {
       pmsg_error("no matching device found\n");
-      hid_free_enumeration(list);
       return -1;
     }
     pmsg_debug("%s(): opening path %s\n", __func__, walk->path);
     dev = hid_open_path(walk->path);
-    hid_free_enumeration(list);
     if(dev == NULL) {
       pmsg_error("found device, but hid_open_path() failed\n");
       return -1;
     }
   } else if(!dev) {
-    dev = hid_open(pinfo.usbinfo.vid, pinfo.usbinfo.pid, NULL);
+    dev = usbhid_open_first(pinfo.usbinfo.vid, pinfo.usbinfo.pid);
     if(dev == NULL) {
       pmsg_notice2("USB device with VID: 0x%04x and PID: 0x%04x not found\n", pinfo.usbinfo.vid, pinfo.usbinfo.pid);
       return -1;
@@ -292,9 +297,10 @@ static int usbhid_recv(const union filedescriptor *fd, unsigned char *buf, size_
   if(udev == NULL)
     return -1;
 
-  rv = i = hid_read_timeout(udev, buf, nbytes, 10000);
+  // Reports that arrived while the caller was busy are queued by hidapi and returned right away
+  rv = i = hid_read_timeout(udev, buf, nbytes, serial_recv_timeout);
   if(i < 0)
-    pmsg_error("hid_read_timeout(usb, %lu, 10000) failed\n", (unsigned long) nbytes);
+    pmsg_error("hid_read_timeout(usb, %lu, %ld) failed\n", (unsigned long) nbytes, serial_recv_timeout);
   else if((size_t) i != nbytes)
     pmsg_error("short read, read only %d out of %lu bytes\n", i, (unsigned long) nbytes);
 
@@ -319,6 +325,7 @@ static int usbhid_drain(const union filedescriptor *fd, int display) {
 
 // Device descriptor
 struct serial_device usbhid_serdev = {
+  .name = "hidapi",
   .open = usbhid_open,
   .close = usbhid_close,
   .rawclose = usbhid_close,
@@ -0,0 +1,197 @@
+/*
+ * avrdude - A Downloader/Uploader for AVR device programmers
+ * Copyright (C) 2026 The AVRDUDE authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Hotplug registry of USB programmers
+ *
+ * usb_hotplug_start() registers a libusb-1.0 hotplug callback for the USB
+ * VID/PIDs of a programmer; the callback keeps a registry of the matching
+ * devices that are currently connected, starting with those already present
+ * when the callback is registered. usb_hotplug_wait() then blocks in
+ * libusb's event handling until a matching programmer is connected or all
+ * have been removed, so that a fixture can start the next job the moment
+ * the operator re-plugs the programmer instead of relaunching AVRDUDE and
+ * re-scanning all buses in a loop.
+ */
+
+#include <ac_cfg.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "avrdude.h"
+#include "libavrdude.h"
+
+#ifdef HAVE_LIBUSB_1_0
+
+#if defined(HAVE_LIBUSB_1_0_LIBUSB_H)
+#include <libusb-1.0/libusb.h>
+#else
+#include <libusb.h>
+#endif
+
+#define uhp_lctx ((libusb_context *) cx->uhp_ctx)
+
+// Does pid belong to the programmer? An empty list of PIDs matches all
+static int uhp_pid_matches(int pid) {
+  if(!cx->uhp_pids || !lsize(cx->uhp_pids))
+    return 1;
+  for(LNODEID ln = lfirst(cx->uhp_pids); ln; ln = lnext(ln))
+    if(*(int *) ldata(ln) == pid)
+      return 1;
+
+  return 0;
+}
+
+// Runs in the thread that handles libusb events; must not do synchronous USB I/O
+static int LIBUSB_CALL uhp_callback(libusb_context *ctx, libusb_device *dev,
+  libusb_hotplug_event event, void *user_data) {
+
+  struct libusb_device_descriptor desc;
+  int bus = libusb_get_bus_number(dev), addr = libusb_get_device_address(dev), i;
+
+  if(libusb_get_device_descriptor(dev, &desc) < 0 || !uhp_pid_matches(desc.idProduct))
+    return 0;
+
+  for(i = 0; i < cx->uhp_ndevs; i++)
+    if(cx->uhp_devs[i].bus == bus && cx->uhp_devs[i].addr == addr)
+      break;
+  usb_enum_rescan();            // Enumeration results are stale now
+
+  if(event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+    if(i == cx->uhp_ndevs && i < USB_HOTPLUG_MAXDEVS) {
+      cx->uhp_devs[i].bus = bus;
+      cx->uhp_devs[i].addr = addr;
+      cx->uhp_devs[i].pid = desc.idProduct;
+      cx->uhp_ndevs++;
+    }
+    pmsg_notice("USB device %04x:%04x connected on bus %03d address %03d\n",
+      desc.idVendor, desc.idProduct, bus, addr);
+  } else if(event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+    if(i < cx->uhp_ndevs)
+      cx->uhp_devs[i] = cx->uhp_devs[--cx->uhp_ndevs];
+    pmsg_notice("USB device %04x:%04x removed from bus %03d address %03d\n",
+      desc.idVendor, desc.idProduct, bus, addr);
+  }
+
+  return 0;
+}
+
+// Start keeping a registry of connected USB devices that match the programmer
+int usb_hotplug_start(const PROGRAMMER *pgm) {
+  libusb_context *ctx = NULL;
+  libusb_hotplug_callback_handle handle;
+  int rc;
+
+  if(cx->uhp_ctx)
+    return 0;
+  if(pgm->conntype != CONNTYPE_USB || !pgm->usbvid) {
+    pmsg_error("hotplug mode needs a USB programmer with a known VID, not %s\n", pgmid);
+    return -1;
+  }
+  if((rc = libusb_init(&ctx)) < 0) {
+    pmsg_error("cannot initialise libusb: %s\n", libusb_strerror(rc));
+    return -1;
+  }
+  if(!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+    pmsg_error("libusb does not support hotplug events on this platform\n");
+    libusb_exit(ctx);
+    return -1;
+  }
+
+  cx->uhp_ctx = ctx;
+  cx->uhp_pids = pgm->usbpid;
+  cx->uhp_ndevs = 0;
+  // Enumerate flag: devices already connected are reported as arrivals right away
+  rc = libusb_hotplug_register_callback(ctx,
+    LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_ENUMERATE,
+    pgm->usbvid, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, uhp_callback, NULL, &handle);
+  if(rc != LIBUSB_SUCCESS) {
+    pmsg_error("cannot register hotplug callback: %s\n", libusb_strerror(rc));
+    libusb_exit(ctx);
+    cx->uhp_ctx = NULL;
+    return -1;
+  }
+  cx->uhp_handle = handle;
+
+  return 0;
+}
+
+/*
+ * Handle hotplug events until a matching programmer is connected (present
+ * == 1) or none is (present == 0); timeout_ms < 0 waits indefinitely.
+ * Returns 1 once the condition holds, 0 on timeout and -1 on error.
+ */
+int usb_hotplug_wait(int present, int timeout_ms) {
+  uint64_t start = avr_mstimestamp();
+
+  if(!cx->uhp_ctx)
+    return -1;
+
+  for(;;) {
+    if((cx->uhp_ndevs > 0) == !!present)
+      return 1;
+
+    int left = timeout_ms < 0? 250: timeout_ms - (int) (avr_mstimestamp() - start);
+
+    if(left <= 0)
+      return 0;
+
+    struct timeval tv = { .tv_sec = left/1000, .tv_usec = (left%1000)*1000 };
+    int rc = libusb_handle_events_timeout_completed(uhp_lctx, &tv, NULL);
+
+    if(rc < 0 && rc != LIBUSB_ERROR_INTERRUPTED) {
+      pmsg_error("cannot handle USB hotplug events: %s\n", libusb_strerror(rc));
+      return -1;
+    }
+  }
+}
+
+// Number of matching programmers currently connected
+int usb_hotplug_present(void) {
+  return cx->uhp_ctx? cx->uhp_ndevs: 0;
+}
+
+void usb_hotplug_stop(void) {
+  if(!cx->uhp_ctx)
+    return;
+  libusb_hotplug_deregister_callback(uhp_lctx, cx->uhp_handle);
+  libusb_exit(uhp_lctx);
+  cx->uhp_ctx = NULL;
+  cx->uhp_ndevs = 0;
+}
+
+#else
+
+int usb_hotplug_start(const PROGRAMMER *pgm) {
+  pmsg_error("hotplug mode needs libusb-1.0, which this avrdude was compiled without\n");
+  return -1;
+}
+
+int usb_hotplug_wait(int present, int timeout_ms) {
+  return -1;
+}
+
+int usb_hotplug_present(void) {
+  return 0;
+}
+
+void usb_hotplug_stop(void) {
+}
+#endif
@@ -53,6 +53,50 @@
  * The baud parameter is meaningless for USB devices, so we reuse it to pass
  * the desired USB device ID.
  */
+/*
+ * Look for a CMSIS-DAP v2 interface: vendor-specific class, an interface
+ * string that contains "CMSIS-DAP" and a pair of bulk endpoints, the first
+ * of which carry the DAP commands. Return its index or -1 if there is none.
+ */
+static int usbdev_find_dap_v2(usb_dev_handle *udev, struct usb_device *dev, int *rep, int *wep) {
+  char name[256];
+
+  for(int iface = 0; iface < dev->config[0].bNumInterfaces; iface++) {
+    struct usb_interface_descriptor *id = &dev->config[0].interface[iface].altsetting[0];
+    int in = 0, out = 0;
+
+    if(id->bInterfaceClass != USB_CLASS_VENDOR_SPEC || !id->iInterface)
+      continue;
+    if(usb_enum_string(&udev, dev, id->iInterface, name, sizeof name) < 0 || !str_contains(name, "CMSIS-DAP"))
+      continue;
+    for(int i = 0; i < id->bNumEndpoints; i++) {
+      struct usb_endpoint_descriptor *ep = &id->endpoint[i];
+
+      if((ep->bmAttributes & USB_ENDPOINT_TYPE_MASK) != USB_ENDPOINT_TYPE_BULK)
+        continue;
+      if(ep->bEndpointAddress & USB_ENDPOINT_DIR_MASK) {
+        if(!in)
+          in = ep->bEndpointAddress;
+      } else if(!out)
+        out = ep->bEndpointAddress;
+    }
+    if(in && out) {
+      *rep = in;
+      *wep = out;
+      return iface;
+    }
+  }
+
+  return -1;
+}
+
+// Does the serial number sn match the requested one, comparing right-to-left?
+static int usbdev_serno_matches(const char *sn, const char *serno) {
+  int x = strlen(sn) - strlen(serno);
+
+  return x >= 0 && str_caseeq(sn + x, serno);
+}
+
 static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor *fd) {
   char string[256];
   char product[256];
@@ -60,8 +104,8 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
   struct usb_device *dev;
   usb_dev_handle *udev;
   char *s, serno[64] = { 0 };
-  const char *serp;
-  int i, iface;
+  const char *serp, *sn;
+  int i, iface, dapif;
 
   /*
    * The syntax for usb devices is defined as:
@@ -83,18 +127,21 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
   if(fd->usb.max_xfer == 0)
     fd->usb.max_xfer = USBDEV_MAX_XFER_MKII;
 
-  usb_init();
-
-  usb_find_busses();
-  usb_find_devices();
+  usb_enum_busses();
 
   for(bus = usb_get_busses(); bus; bus = bus->next) {
     for(dev = bus->devices; dev; dev = dev->next) {
       if(dev->descriptor.idVendor == pinfo.usbinfo.vid && dev->descriptor.idProduct == pinfo.usbinfo.pid) {
+        // Skip devices known not to match without opening them
+        if(*serno && (sn = usb_enum_lookup(bus->dirname, dev->filename, pinfo.usbinfo.vid, pinfo.usbinfo.pid,
+          dev->descriptor.iSerialNumber)) && !usbdev_serno_matches(sn, serno)) {
+          pmsg_debug("%s(): cached serial number %s does not match\n", __func__, sn);
+          continue;
+        }
         udev = usb_open(dev);
         if(udev) {
           // Yeah, we found something
-          if(usb_get_string_simple(udev, dev->descriptor.iSerialNumber, string, sizeof(string)) < 0) {
+          if(usb_enum_string(&udev, dev, dev->descriptor.iSerialNumber, string, sizeof(string)) < 0) {
             pmsg_warning("reading serial number, %s\n", usb_strerror());
             /*
              * On some systems, libusb appears to have problems sending control
@@ -108,7 +155,7 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
           }
           if(serdev)
             serdev->usbsn = cache_string(string);
-          if(usb_get_string_simple(udev, dev->descriptor.iProduct, product, sizeof(product)) < 0) {
+          if(usb_enum_string(&udev, dev, dev->descriptor.iProduct, product, sizeof(product)) < 0) {
             pmsg_warning("reading product name, %s\n", usb_strerror());
             strcpy(product, "[unnamed product]");
           }
@@ -129,32 +176,32 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
            * compliant to that protocol.  Use this for the decisision whether
            * we have to search for a HID interface below.
            */
+          dapif = -1;
+          fd->usb.bulk_dap = 0;
           if(str_contains(product, "CMSIS-DAP")) {
-            pinfo.usbinfo.flags |= PINFO_FL_USEHID;
+            // Prefer a CMSIS-DAP v2 bulk interface over 64/512-byte HID reports
+            if(dev->config && (dapif = usbdev_find_dap_v2(udev, dev, &fd->usb.rep, &fd->usb.wep)) >= 0) {
+              fd->usb.bulk_dap = 1;
+              pmsg_notice2("%s(): using CMSIS-DAP v2 bulk endpoints 0x%02x/0x%02x\n", __func__,
+                fd->usb.rep, fd->usb.wep);
+            } else
+              pinfo.usbinfo.flags |= PINFO_FL_USEHID;
             /* The JTAGICE3 running the CMSIS-DAP firmware doesn't
              * use a separate endpoint for event reception */
             fd->usb.eep = 0;
           }
 
-          if(str_contains(product, "mEDBG")) {
+          if(str_contains(product, "mEDBG") && !fd->usb.bulk_dap) {
             // The AVR Xplained Mini uses different endpoints
             fd->usb.rep = 0x81;
             fd->usb.wep = 0x02;
           }
 
           pmsg_notice("found %s with serno = %s\n", product, string);
-          if(*serno) {
-            /*
-             * See if the serial number requested by the user matches what we
-             * found, matching right-to-left.
-             */
-            int x = strlen(string) - strlen(serno);
-
-            if(x < 0 || !str_caseeq(string + x, serno)) {
-              pmsg_debug("%s(): serial number does not match\n", __func__);
-              usb_close(udev);
-              continue;
-            }
+          if(*serno && !usbdev_serno_matches(string, serno)) {
+            pmsg_debug("%s(): serial number does not match\n", __func__);
+            usb_close(udev);
+            continue;
           }
 
           if(dev->config == NULL) {
@@ -168,6 +215,8 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
           }
 
           for(iface = 0; iface < dev->config[0].bNumInterfaces; iface++) {
+            if(dapif >= 0 && iface != dapif)
+              continue;
             cx->usb_interface = dev->config[0].interface[iface].altsetting[0].bInterfaceNumber;
 
 #ifdef LIBUSB_HAS_GET_DRIVER_NP
@@ -214,7 +263,10 @@ static int usbdev_open(const char *port, union pinfo pinfo, union filedescriptor
               fd->usb.rep = USBDEV_BULK_EP_READ_MKII;
             }
           }
+          fd->usb.wmaxpkt = 0;
           for(i = 0; i < dev->config[0].interface[iface].altsetting[0].bNumEndpoints; i++) {
+            if(dev->config[0].interface[iface].altsetting[0].endpoint[i].bEndpointAddress == fd->usb.wep)
+              fd->usb.wmaxpkt = dev->config[0].interface[iface].altsetting[0].endpoint[i].wMaxPacketSize;
             if((dev->config[0].interface[iface].altsetting[0].endpoint[i].bEndpointAddress == fd->usb.rep ||
                 dev->config[0].interface[iface].altsetting[0].endpoint[i].bEndpointAddress == fd->usb.wep) &&
               dev->config[0].interface[iface].altsetting[0].endpoint[i].wMaxPacketSize < fd->usb.max_xfer) {
@@ -282,9 +334,15 @@ static int usbdev_send(const union filedescriptor *fd, const unsigned char *bp,
    * finish with a short packet, or else the device won't know the frame is
    * finished.  For example, if we need to send 64 bytes, we must send a packet
    * of length 64 followed by a packet of length 0.
+   *
+   * If the chunk size is the endpoint's max packet size a bulk write of the
+   * whole frame puts the same packets on the bus, but in a single request that
+   * the host controller can schedule back to back.
    */
+  int whole = !fd->usb.use_interrupt_xfer && fd->usb.wmaxpkt > 0 && fd->usb.max_xfer == fd->usb.wmaxpkt;
+
   do {
-    tx_size = ((int) mlen < fd->usb.max_xfer)? (int) mlen: fd->usb.max_xfer;
+    tx_size = whole || (int) mlen < fd->usb.max_xfer? (int) mlen: fd->usb.max_xfer;
     if(fd->usb.use_interrupt_xfer)
       rv = usb_interrupt_write(udev, fd->usb.wep, (char *) bp, tx_size, 10000);
     else
@@ -443,6 +501,7 @@ static int usbdev_drain(const union filedescriptor *fd, int display) {
 
 // Device descriptor for the JTAG ICE mkII
 struct serial_device usb_serdev = {
+  .name = "libusb",
   .open = usbdev_open,
   .close = usbdev_close,
   .rawclose = usbdev_close,
@@ -454,6 +513,7 @@ struct serial_device usb_serdev = {
 
 // Device descriptor for the AVRISP mkII
 struct serial_device usb_serdev_frame = {
+  .name = "libusb frame",
   .open = usbdev_open,
   .close = usbdev_close,
   .rawclose = usbdev_close,
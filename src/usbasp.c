@@ -81,11 +81,8 @@ struct pdata {
   int sck_3mhz;
 
 #ifdef USE_LIBUSB_1_0
-  libusb_context *ctx;
   char msg[30];                 // Used in errstr()
 #endif
-
-  int USB_init;                 // Used in both usbOpenDevice() variants
 };
 
 #define my (*(struct pdata *) (pgm->cookie))
@@ -452,13 +449,8 @@ static int usbOpenDevice(const PROGRAMMER *pgm, libusb_device_handle **device, i
   int j;
   int r;
 
-  if(!my.USB_init) {
-    my.USB_init = 1;
-    libusb_init(&my.ctx);
-  }
-
   libusb_device **dev_list;
-  int dev_list_len = libusb_get_device_list(my.ctx, &dev_list);
+  int dev_list_len = usb_enum_devices(&dev_list);
 
   for(j = 0; j < dev_list_len; ++j) {
     libusb_device *dev = dev_list[j];
@@ -468,18 +460,17 @@ static int usbOpenDevice(const PROGRAMMER *pgm, libusb_device_handle **device, i
     if(descriptor.idVendor == vendor && descriptor.idProduct == product) {
       char string[256];
 
-      // We need to open the device in order to query strings
-      r = libusb_open(dev, &handle);
-      if(!handle) {
+      // Strings come from the enumeration cache; the device is only opened to query missing ones
+      handle = NULL;
+      errorCode = 0;
+      // Do the names match? If vendorName not given ignore it (any vendor matches)
+      r = usb_enum_string_1_0(&handle, dev, descriptor.iManufacturer & 0xff, string, sizeof(string));
+      if(r < 0 && !handle) {
         cx->usb_access_error = 1;
         errorCode = USB_ERROR_ACCESS;
         pmsg_warning("cannot open USB device: %s\n", errstr(pgm, r));
         continue;
       }
-      errorCode = 0;
-      // Do the names match? If vendorName not given ignore it (any vendor matches)
-      r = libusb_get_string_descriptor_ascii(handle, descriptor.iManufacturer & 0xff,
-        (unsigned char *) string, sizeof(string));
       if(r < 0) {
         cx->usb_access_error = 1;
         if((vendorName != NULL) && (vendorName[0] != 0)) {
@@ -492,8 +483,7 @@ static int usbOpenDevice(const PROGRAMMER *pgm, libusb_device_handle **device, i
           errorCode = USB_ERROR_NOTFOUND;
       }
       // If productName not given ignore it (any product matches)
-      r = libusb_get_string_descriptor_ascii(handle, descriptor.iProduct & 0xff,
-        (unsigned char *) string, sizeof(string));
+      r = usb_enum_string_1_0(&handle, dev, descriptor.iProduct & 0xff, string, sizeof(string));
       if(r < 0) {
         cx->usb_access_error = 1;
         if((productName != NULL) && (productName[0] != 0)) {
@@ -508,8 +498,8 @@ static int usbOpenDevice(const PROGRAMMER *pgm, libusb_device_handle **device, i
       if(errorCode == 0) {
         if(!str_eq(port, DEFAULT_USB)) {
           // -P option given
-          libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber,
-            (unsigned char *) string, sizeof(string));
+          if(usb_enum_string_1_0(&handle, dev, descriptor.iSerialNumber, string, sizeof(string)) < 0)
+            *string = 0;
 
           char bus_num[21], dev_addr[21];
           sprintf(bus_num, "%03d", libusb_get_bus_number(dev));
@@ -519,13 +509,20 @@ static int usbOpenDevice(const PROGRAMMER *pgm, libusb_device_handle **device, i
             errorCode = USB_ERROR_NOTFOUND;
         }
       }
+      if(errorCode == 0 && !handle && (r = libusb_open(dev, &handle)) < 0) {
+        handle = NULL;
+        cx->usb_access_error = 1;
+        errorCode = USB_ERROR_ACCESS;
+        pmsg_warning("cannot open USB device: %s\n", errstr(pgm, r));
+        continue;
+      }
       if(errorCode == 0)
         break;
-      libusb_close(handle);
+      if(handle)
+        libusb_close(handle);
       handle = NULL;
     }
   }
-  libusb_free_device_list(dev_list, 1);
   if(handle != NULL) {
     errorCode = 0;
     *device = handle;
@@ -541,29 +538,24 @@ static int usbOpenDevice(const PROGRAMMER *pgm, usb_dev_handle **device, int ven
   usb_dev_handle *handle = NULL;
   int errorCode = USB_ERROR_NOTFOUND;
 
-  if(!my.USB_init) {
-    my.USB_init = 1;
-    usb_init();
-  }
-  usb_find_busses();
-  usb_find_devices();
+  usb_enum_busses();
   for(bus = usb_get_busses(); bus; bus = bus->next) {
     for(dev = bus->devices; dev; dev = dev->next) {
       if(dev->descriptor.idVendor == vendor && dev->descriptor.idProduct == product) {
         char string[256];
         int len;
 
-        // We need to open the device in order to query strings
-        handle = usb_open(dev);
-        if(!handle) {
+        // Strings come from the enumeration cache; the device is only opened to query missing ones
+        handle = NULL;
+        errorCode = 0;
+        // Do the names match? If vendorName not given ignore it (any vendor matches)
+        len = usb_enum_string(&handle, dev, dev->descriptor.iManufacturer, string, sizeof(string));
+        if(len < 0 && !handle) {
           cx->usb_access_error = 1;
           errorCode = USB_ERROR_ACCESS;
           pmsg_warning("cannot open USB device: %s\n", usb_strerror());
           continue;
         }
-        errorCode = 0;
-        // Do the names match? If vendorName not given ignore it (any vendor matches)
-        len = usb_get_string_simple(handle, dev->descriptor.iManufacturer, string, sizeof(string));
         if(len < 0) {
           cx->usb_access_error = 1;
           if((vendorName != NULL) && (vendorName[0] != 0)) {
@@ -576,7 +568,7 @@ static int usbOpenDevice(const PROGRAMMER *pgm, usb_dev_handle **device, int ven
             errorCode = USB_ERROR_NOTFOUND;
         }
         // If productName not given ignore it (any product matches)
-        len = usb_get_string_simple(handle, dev->descriptor.iProduct, string, sizeof(string));
+        len = usb_enum_string(&handle, dev, dev->descriptor.iProduct, string, sizeof(string));
         if(len < 0) {
           cx->usb_access_error = 1;
           if((productName != NULL) && (productName[0] != 0)) {
@@ -591,14 +583,22 @@ static int usbOpenDevice(const PROGRAMMER *pgm, usb_dev_handle **device, int ven
         if(errorCode == 0) {
           if(!str_eq(port, "usb")) {
             // -P option given
-            usb_get_string_simple(handle, dev->descriptor.iSerialNumber, string, sizeof(string));
+            if(usb_enum_string(&handle, dev, dev->descriptor.iSerialNumber, string, sizeof(string)) < 0)
+              *string = 0;
             if(!check_for_port_argument_match(port, bus->dirname, dev->filename, string))
               errorCode = USB_ERROR_NOTFOUND;
           }
         }
+        if(errorCode == 0 && !handle && !(handle = usb_open(dev))) {
+          cx->usb_access_error = 1;
+          errorCode = USB_ERROR_ACCESS;
+          pmsg_warning("cannot open USB device: %s\n", usb_strerror());
+          continue;
+        }
         if(errorCode == 0)
           break;
-        usb_close(handle);
+        if(handle)
+          usb_close(handle);
         handle = NULL;
       }
     }
@@ -687,11 +687,6 @@ static void usbasp_close(PROGRAMMER *pgm) {
 #endif
   }
 
-#ifdef USE_LIBUSB_1_0
-  libusb_exit(my.ctx);
-#else
-  // Nothing for usb 0.1?
-#endif
 }
 
 static void usbasp_disable(const PROGRAMMER *pgm) {
@@ -805,7 +800,7 @@ static int usbasp_spi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
 
   avr_set_bits(p->op[AVR_OP_CHIP_ERASE], cmd);
   pgm->cmd(pgm, cmd, res);
-  usleep(p->chip_erase_delay);
+  avr_isp_erase_wait(pgm, p);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -838,21 +833,26 @@ static int usbasp_spi_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const
     blocksize = USBASP_READBLOCKSIZE;
   }
 
-  while(wbytes) {
+  for(int first = 1; wbytes; first = 0) {
     if(wbytes <= blocksize) {
       blocksize = wbytes;
     }
     wbytes -= blocksize;
 
-    // Set address (new mode) - if firmware on usbasp support newmode, then they use address from this command
-    unsigned char temp[4];
-
-    memset(temp, 0, sizeof(temp));
-    cmd[0] = address & 0xFF;
-    cmd[1] = address >> 8;
-    cmd[2] = address >> 16;
-    cmd[3] = address >> 24;
-    usbasp_transmit(pgm, 1, USBASP_FUNC_SETLONGADDRESS, cmd, temp, sizeof(temp));
+    /*
+     * Set address (new mode) - if firmware on usbasp support newmode, then they use address from this command;
+     * newmode firmware advances the address while reading, so only the first block of a call needs this
+     */
+    if(first) {
+      unsigned char temp[4];
+
+      memset(temp, 0, sizeof(temp));
+      cmd[0] = address & 0xFF;
+      cmd[1] = address >> 8;
+      cmd[2] = address >> 16;
+      cmd[3] = address >> 24;
+      usbasp_transmit(pgm, 1, USBASP_FUNC_SETLONGADDRESS, cmd, temp, sizeof(temp));
+    }
 
     /* send command with address (compatibility mode) - if firmware on
        usbasp doesn't support newmode, then they use address from this */
@@ -1156,7 +1156,6 @@ static int usbasp_tpi_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
   usbasp_tpi_send_byte(pgm, 0x00);
   usbasp_tpi_nvm_waitbusy(pgm);
 
-  usleep(p->chip_erase_delay);
   pgm->initialize(pgm, p);
 
   return 0;
@@ -1362,6 +1361,7 @@ void usbasp_initpgm(PROGRAMMER *pgm) {
   // Optional functions
   pgm->paged_write = usbasp_paged_write;
   pgm->paged_load = usbasp_paged_load;
+  pgm->multipage_load = 1;
   pgm->setup = usbasp_setup;
   pgm->teardown = usbasp_teardown;
   pgm->set_sck_period = usbasp_set_sck_period;
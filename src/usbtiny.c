@@ -67,6 +67,7 @@ struct pdata {
   usb_dev_handle *usb_handle;
   int sck_period;
   int chunk_size;
+  int chunk_tuned;              // Chunk size has been refined by timing a full transfer
   int retries;
 };
 
@@ -372,6 +373,26 @@ static void usbtiny_set_chunk_size(const PROGRAMMER *pgm, int period) {
     my.chunk_size >>= 1;
     period >>= 1;
   }
+  my.chunk_tuned = 0;
+}
+
+/* Refine the chunk size once from the measured duration of a full chunk transfer: pick
+   the largest chunk that is expected to take no more than half the USB timeout, which
+   also accounts for the round-trip latency of hubs that the SCK heuristic cannot see */
+static void usbtiny_tune_chunk_size(const PROGRAMMER *pgm, int nbytes, uint64_t usecs) {
+  if(my.chunk_tuned || nbytes < 8 || nbytes != my.chunk_size)
+    return;
+
+  uint64_t us_per_byte = usecs/nbytes + 1;
+  int chunk = CHUNK_SIZE;
+
+  while(chunk > 8 && chunk*us_per_byte > USB_TIMEOUT*1000/2)
+    chunk >>= 1;
+  if(chunk != my.chunk_size)
+    pmsg_notice2("measured %d us per byte, changing chunk size from %d to %d\n",
+      (int) us_per_byte, my.chunk_size, chunk);
+  my.chunk_size = chunk;
+  my.chunk_tuned = 1;
 }
 
 /* Given a SCK bit-clock speed (in useconds) we verify its an OK speed and tell the
@@ -578,7 +599,7 @@ static int usbtiny_chip_erase(const PROGRAMMER *pgm, const AVRPART *p) {
     // Estimated time it takes to erase all pages in bootloader
     usleep(p->chip_erase_delay*(fl? fl->num_pages: 999));
   } else
-    usleep(p->chip_erase_delay);
+    avr_isp_erase_wait(pgm, p);
 
   // Prepare for further instruction
   pgm->initialize(pgm, p);
@@ -644,6 +665,8 @@ static int usbtiny_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       chunk = maxaddr - addr;
 
     // Send the chunk of data to the USBtiny with the function we want to perform
+    uint64_t start = avr_ustimestamp();
+
     if(usb_in(pgm, function,    // EEPROM or flash
         0,                      // Delay between SPI commands
         addr,                   // Address in memory
@@ -653,6 +676,7 @@ static int usbtiny_paged_load(const PROGRAMMER *pgm, const AVRPART *p, const AVR
       // usb_in() multiplies this per byte
       return -1;
     }
+    usbtiny_tune_chunk_size(pgm, chunk, avr_ustimestamp() - start);
   }
 
   check_retries(pgm, "read");
@@ -701,6 +725,8 @@ static int usbtiny_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
     if(m->paged && chunk > (int) page_size)
       chunk = page_size;
 
+    uint64_t start = avr_ustimestamp();
+
     if(usb_out(pgm, function,   // Flash or EEPROM
         delay,                  // How much to wait between each byte
         addr,                   // Address in memory
@@ -710,6 +736,7 @@ static int usbtiny_paged_write(const PROGRAMMER *pgm, const AVRPART *p, const AV
         32*my.sck_period + delay) < 0) {
       return -1;
     }
+    usbtiny_tune_chunk_size(pgm, chunk, avr_ustimestamp() - start);
 
     next = addr + chunk;        // Calculate what address we're at now
     if(m->paged && (next%page_size == 0 || next == (int) maxaddr)) {
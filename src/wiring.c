@@ -51,7 +51,7 @@
 
 struct wiringpdata {
   int snoozetime, delay;
-  bool noautoreset;
+  bool noautoreset, fastsync;
 };
 
 // wiringpdata is our private data
@@ -114,6 +114,11 @@ static int wiring_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       continue;
     }
 
+    if(str_eq(extended_param, "fastsync")) {
+      mywiring.fastsync = true;
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rv = LIBAVRDUDE_EXIT_OK;
@@ -127,6 +132,7 @@ static int wiring_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
     msg_error("  -x snooze=<n>   Wait snooze <n> ms before protocol sync after port open\n");
     msg_error("  -x delay=<n>    Add delay [n] ms after reset, can be negative\n");
     msg_error("  -x noautoreset  Don't toggle RTS/DTR lines on port open to prevent a hardware reset\n");
+    msg_error("  -x fastsync     Probe for the bootloader right after reset instead of waiting\n");
     msg_error("  -x help         Show this help menu and exit\n");
     return rv;
   }
@@ -138,7 +144,7 @@ static int wiring_open(PROGRAMMER *pgm, const char *port) {
   if(pgm->bitclock)
     pmsg_warning("-c %s does not support adjustable bitclock speed; ignoring -B\n", pgmid);
 
-  int timetosnooze;
+  int timetosnooze, drained = 0;
   union pinfo pinfo;
 
   pgm->port = port;
@@ -172,11 +178,14 @@ static int wiring_open(PROGRAMMER *pgm, const char *port) {
 
     int delay = mywiring.delay;
 
-    if((100 + delay) > 0)
+    if(mywiring.fastsync)       // Probes drain the input; stk500v2_getsync() below does the rest
+      drained = stk500v2_fastsync(pgm, 500 + delay) == 0;
+    else if((100 + delay) > 0)
       usleep((100 + delay)*1000);     // Wait until board comes out of reset
   }
   // Drain any extraneous input
-  stk500v2_drain(pgm, 0);
+  if(!drained)
+    stk500v2_drain(pgm, 0);
 
   if(stk500v2_getsync(pgm) < 0) {
     pmsg_error("stk500v2_getsync() failed; try -x delay=n with some n in [-80, 100]\n");
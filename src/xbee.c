@@ -95,6 +95,16 @@
 #define XBEE_MAX_INTERMEDIATE_HOPS 40
 #endif
 
+/*
+ * Maximum number of unacknowledged XBeeBoot packets in flight with -x window.
+ * XBeeBoot only accepts a packet with the next sequence number, so a lost
+ * packet makes it ignore the rest of the window; the sender then goes back to
+ * the first unacknowledged packet.
+ */
+#ifndef XBEE_MAX_WINDOW
+#define XBEE_MAX_WINDOW 16
+#endif
+
 // Protocol
 #define XBEEBOOT_PACKET_TYPE_ACK 0
 #define XBEEBOOT_PACKET_TYPE_REQUEST 1
@@ -178,6 +188,10 @@ struct XBeeBootSession {
 
   int xbeeResetPin;
 
+  int maxWindow;                // Largest transmit window, 1 for stop-and-wait
+  int window;                   // Current transmit window, adapted to packet loss
+  unsigned char lastAck;        // Sequence number of the last ACK seen by xbeedev_poll()
+
   size_t inInIndex;
   size_t inOutIndex;
   unsigned char inBuffer[256];
@@ -255,6 +269,8 @@ static void XBeeBootSessionInit(struct XBeeBootSession *xbs) {
   xbs->serialDevice = &serial_serdev;
   xbs->directMode = 1;
   xbs->xbeeResetPin = XBEE_DEFAULT_RESET_PIN;
+  xbs->maxWindow = 1;
+  xbs->window = 1;
   xbs->outSequence = 0;
   xbs->inSequence = 0;
   xbs->txSequence = 0;
@@ -283,6 +299,13 @@ static void xbeedev_setresetpin(const union filedescriptor *fdp, int xbeeResetPi
   xbs->xbeeResetPin = xbeeResetPin;
 }
 
+static void xbeedev_setwindow(const union filedescriptor *fdp, int window) {
+  struct XBeeBootSession *xbs = xbeebootsession(fdp);
+
+  xbs->maxWindow = window < 1? 1: window > XBEE_MAX_WINDOW? XBEE_MAX_WINDOW: window;
+  xbs->window = xbs->maxWindow;
+}
+
 enum xbee_stat_is_retry_enum { XBEE_STATS_NOT_RETRY, XBEE_STATS_IS_RETRY };
 typedef enum xbee_stat_is_retry_enum xbee_stat_is_retry;
 
@@ -531,6 +554,7 @@ static void xbeedev_record16Bit(struct XBeeBootSession *xbs, const unsigned char
  * Return -512 + XBee AT Response code
  */
 #define XBEE_AT_RETURN_CODE(x) (((x) >= -512 && (x) <= -256)? (x) + 512: -1)
+#define XBEE_WAIT_ANY_ACK (-2)  // For waitForAck: return on any XBeeBoot ACK, see xbs->lastAck
 static int xbeedev_poll(struct XBeeBootSession *xbs, unsigned char **buf, size_t *buflen,
   int waitForAck, int waitForSequence) {
 
@@ -756,7 +780,8 @@ static int xbeedev_poll(struct XBeeBootSession *xbs, unsigned char **buf, size_t
           xbeedev_stats_receive(xbs, "XBeeBoot ACK", XBEE_STATS_TRANSMIT, sequence, &receiveTime);
 
           // We can't update outSequence here, we already do that somewhere else
-          if(waitForAck >= 0 && waitForAck == sequence)
+          xbs->lastAck = sequence;
+          if((waitForAck >= 0 && waitForAck == sequence) || waitForAck == XBEE_WAIT_ANY_ACK)
             return 0;
         } else if(protocolType == XBEEBOOT_PACKET_TYPE_REQUEST && dataLength >= 4 && dataStart[2] == 24) {
           // REQUEST FRAME_REPLY
@@ -1159,12 +1184,116 @@ static int xbeedev_open(const char *port, union pinfo pinfo, union filedescripto
   return 0;
 }
 
+/*
+ * Sliding window variant of xbeedev_send() for -x window=<n>: up to xbs->window packets
+ * are sent before their ACKs arrive.  As XBeeBoot accepts packets strictly in sequence,
+ * an ACK for any packet in flight also acknowledges all earlier ones.  A timeout halves
+ * the window and resends from the oldest unacknowledged packet; each further window's
+ * worth of ACKed packets grows the window by one again, up to xbs->maxWindow.
+ */
+static int xbeedev_send_window(struct XBeeBootSession *xbs, const unsigned char *buf, size_t buflen) {
+  // Record the potential trigger of a RECEIVE as xbeedev_send() does
+  {
+    unsigned char nextSequence = xbs->inSequence;
+
+    while((++nextSequence & 0xff) == 0);
+
+    struct timeval sendTime;
+
+    gettimeofday(&sendTime, NULL);
+    xbeedev_stats_send(xbs, "send() hints possible triggered RECEIVE",
+      nextSequence, XBEE_STATS_RECEIVE, nextSequence, 0, &sendTime);
+  }
+
+  // Same chunk size as in xbeedev_send(), but fixed for the whole window
+  unsigned char maximum_chunk = XBEEBOOT_MAX_CHUNK;
+  const int hops = xbs->sourceRouteHops;
+
+  if(hops > 0 && (hops*2 + 2) < XBEEBOOT_MAX_CHUNK)
+    maximum_chunk -= hops*2 + 2;
+
+  const size_t npackets = (buflen + maximum_chunk - 1)/maximum_chunk;
+  unsigned char *sequences = mmt_malloc(2*npackets), *sent = sequences + npackets;
+  unsigned char sequence = xbs->outSequence;
+
+  for(size_t i = 0; i < npackets; i++) {
+    while((++sequence & 0xff) == 0);
+    sequences[i] = sequence;
+  }
+  xbs->outSequence = sequence;
+
+  size_t base = 0, next = 0;
+  int retries = 0, acked = 0, rc = 0;
+
+  while(base < npackets) {
+    for(; next < npackets && next < base + xbs->window; next++) {
+      const size_t offset = next*maximum_chunk;
+      const unsigned char blockLength = buflen - offset > maximum_chunk? maximum_chunk: buflen - offset;
+
+      rc = sendPacket(xbs, "Transmit Request Data [window], expect ACK for TRANSMIT",
+        XBEEBOOT_PACKET_TYPE_REQUEST, sequences[next],
+        sent[next]? XBEE_STATS_IS_RETRY: XBEE_STATS_NOT_RETRY,
+        23,                     // FIRMWARE_DELIVER
+        blockLength, buf + offset);
+      if(rc < 0)
+        goto fail;
+      sent[next] = 1;
+    }
+
+    rc = xbeedev_poll(xbs, NULL, NULL, XBEE_WAIT_ANY_ACK, -1);
+    if(rc == 0) {
+      size_t i;
+
+      for(i = base; i < next && sequences[i] != xbs->lastAck; i++)
+        continue;
+      if(i < next) {            // ACK for packet i implies all before it arrived
+        acked += i + 1 - base;
+        base = i + 1;
+        retries = 0;
+        if(acked >= xbs->window && xbs->window < xbs->maxWindow) {
+          xbs->window++;
+          acked = 0;
+        }
+      }
+      continue;
+    }
+
+    if(xbs->transportUnusable || ++retries >= XBEE_MAX_RETRIES)
+      goto fail;
+
+    // Timeout: shrink the window and go back to the oldest unacknowledged packet
+    xbs->window = xbs->window > 1? xbs->window/2: 1;
+    acked = 0;
+    next = base;
+    pmsg_debug("%s(): timeout, window now %d\n", __func__, xbs->window);
+
+    localAsyncAT(xbs, "Local XBee ping [send window]", 'A', 'P', -1);
+    if(xbs->inSequence != 0) {
+      rc = sendPacket(xbs, "Transmit Request ACK [Retry in send window] for RECEIVE",
+        XBEEBOOT_PACKET_TYPE_ACK, xbs->inSequence, XBEE_STATS_IS_RETRY, -1, 0, NULL);
+      if(rc < 0)
+        goto fail;
+    }
+  }
+  mmt_free(sequences);
+  return 0;
+
+fail:
+  // There is no way to recover from a failure mid-send
+  xbs->transportUnusable = 1;
+  mmt_free(sequences);
+  return rc < 0? rc: -1;
+}
+
 static int xbeedev_send(const union filedescriptor *fdp, const unsigned char *buf, size_t buflen) {
   struct XBeeBootSession *xbs = xbeebootsession(fdp);
 
   if(xbs->transportUnusable)    // Don't attempt to continue on an unusable transport layer
     return -1;
 
+  if(xbs->maxWindow > 1 && buflen > 0)
+    return xbeedev_send_window(xbs, buf, buflen);
+
   while(buflen > 0) {
     unsigned char sequence = xbs->outSequence;
 
@@ -1429,6 +1558,7 @@ static int xbee_open(PROGRAMMER *pgm, const char *port) {
   serial_recv_timeout = 1000;
 
   serdev = &my.xbee_serdev;
+  serdev->name = "xbee";
   serdev->open = xbeedev_open;
   serdev->close = xbeedev_close;
   serdev->rawclose = xbeedev_close;
@@ -1443,6 +1573,7 @@ static int xbee_open(PROGRAMMER *pgm, const char *port) {
   }
 
   xbeedev_setresetpin(&pgm->fd, my.xbeeResetPin);
+  xbeedev_setwindow(&pgm->fd, my.xbeeWindow);
 
   // Clear DTR and RTS
   serial_set_dtr_rts(&pgm->fd, 0);
@@ -1522,6 +1653,19 @@ static int xbee_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
       continue;
     }
 
+    if(str_starts(extended_param, "window=")) {
+      int window;
+
+      if(sscanf(extended_param, "window=%i", &window) != 1 || window < 1 || window > XBEE_MAX_WINDOW) {
+        pmsg_error("invalid value in -x %s; must be in [1, %d]\n", extended_param, XBEE_MAX_WINDOW);
+        rc = -1;
+        break;
+      }
+
+      my.xbeeWindow = window;
+      continue;
+    }
+
     if(str_eq(extended_param, "help")) {
       help = true;
       rc = LIBAVRDUDE_EXIT_OK;
@@ -1533,6 +1677,7 @@ static int xbee_parseextparms(const PROGRAMMER *pgm, const LISTID extparms) {
     }
     msg_error("%s -c %s extended options:\n", progname, pgmid);
     msg_error("  -x xbeeresetpin=<1..7> Set XBee pin DIO<1..7> as reset pin\n");
+    msg_error("  -x window=<1..%d>      Allow up to <n> unacknowledged packets in flight\n", XBEE_MAX_WINDOW);
     msg_error("  -x help                Show this help menu and exit\n");
     return rc;
   }